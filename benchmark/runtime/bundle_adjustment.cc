@@ -0,0 +1,69 @@
+#include "colmap/estimators/batched_bundle_adjustment.h"
+#include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/scene/synthetic.h"
+#include "colmap/util/logging.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace colmap;
+
+static Reconstruction CreateSyntheticReconstruction(const int num_frames) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions options;
+  options.num_rigs = 1;
+  options.num_cameras_per_rig = 1;
+  options.num_frames_per_rig = num_frames;
+  options.num_points3D = 50 * num_frames;
+  options.point2D_stddev = 0.5;
+  SynthesizeDataset(options, &reconstruction);
+  return reconstruction;
+}
+
+// Runs the batched bundle adjuster with double or single precision Jacobians.
+// The counters report the final cost and the memory of the stored Jacobians.
+static void BM_BatchedBundleAdjustment(benchmark::State& state) {
+  const Reconstruction orig_reconstruction =
+      CreateSyntheticReconstruction(static_cast<int>(state.range(0)));
+
+  BundleAdjustmentConfig config;
+  for (const image_t image_id : orig_reconstruction.RegImageIds()) {
+    config.AddImage(image_id);
+  }
+  config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  BundleAdjustmentOptions options;
+  options.print_summary = false;
+  options.use_mixed_precision = state.range(1) != 0;
+
+  double final_cost = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Reconstruction reconstruction = orig_reconstruction;
+    state.ResumeTiming();
+    const ceres::Solver::Summary summary =
+        CreateBatchedBundleAdjuster(options, config, reconstruction)->Solve();
+    CHECK_NE(summary.termination_type, ceres::FAILURE);
+    final_cost = summary.final_cost;
+  }
+
+  // Pose, point, and camera parameter Jacobians of each observation.
+  size_t num_jacobian_values = 0;
+  for (const image_t image_id : config.Images()) {
+    const Image& image = orig_reconstruction.Image(image_id);
+    num_jacobian_values +=
+        2 * (6 + 3 + image.CameraPtr()->params.size()) * image.NumPoints3D();
+  }
+  state.counters["final_cost"] = final_cost;
+  state.counters["jacobian_bytes"] = benchmark::Counter(
+      num_jacobian_values *
+          (options.use_mixed_precision ? sizeof(float) : sizeof(double)),
+      benchmark::Counter::kDefaults,
+      benchmark::Counter::kIs1024);
+}
+
+BENCHMARK(BM_BatchedBundleAdjustment)
+    ->ArgsProduct({{25, 100, 400}, {0, 1}})
+    ->ArgNames({"num_frames", "mixed_precision"})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+#include "colmap/scene/camera.h"
+#include "colmap/sensor/models.h"
+#include "colmap/util/types.h"
+
+#include <optional>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace colmap;
+
+struct CameraModelData {
+  Camera camera;
+  std::vector<Eigen::Vector3d> cam_points;
+  std::vector<Eigen::Vector2d> image_points;
+};
+
+template <typename CameraModel>
+static CameraModelData CreateCameraModelData(const size_t num_points) {
+  CameraModelData data;
+  data.camera = Camera::CreateFromModelId(1,
+                                          CameraModel::model_id,
+                                          /*focal_length=*/500,
+                                          /*width=*/640,
+                                          /*height=*/480);
+  for (const size_t idx : CameraModel::extra_params_idxs) {
+    data.camera.params[idx] = 0.01;
+  }
+  data.cam_points.reserve(num_points);
+  data.image_points.reserve(num_points);
+  while (data.cam_points.size() < num_points) {
+    const Eigen::Vector3d cam_point =
+        (2 + Eigen::Vector2d::Random().x()) *
+        Eigen::Vector2d::Random().homogeneous().eval();
+    const std::optional<Eigen::Vector2d> image_point =
+        data.camera.ImgFromCam(cam_point);
+    if (image_point) {
+      data.cam_points.push_back(cam_point);
+      data.image_points.push_back(*image_point);
+    }
+  }
+  return data;
+}
+
+template <typename CameraModel>
+static void BM_ImgFromCamScalar(benchmark::State& state) {
+  const auto data = CreateCameraModelData<CameraModel>(state.range(0));
+  std::vector<Eigen::Vector2d> image_points(data.cam_points.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < data.cam_points.size(); ++i) {
+      const std::optional<Eigen::Vector2d> image_point =
+          data.camera.ImgFromCam(data.cam_points[i]);
+      if (image_point) {
+        image_points[i] = *image_point;
+      }
+    }
+    benchmark::DoNotOptimize(image_points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename CameraModel>
+static void BM_ImgFromCamBatch(benchmark::State& state) {
+  const auto data = CreateCameraModelData<CameraModel>(state.range(0));
+  std::vector<Eigen::Vector2d> image_points(data.cam_points.size());
+  for (auto _ : state) {
+    data.camera.ImgFromCamBatch(
+        span<const Eigen::Vector3d>(data.cam_points.data(),
+                                    data.cam_points.size()),
+        span<Eigen::Vector2d>(image_points.data(), image_points.size()));
+    benchmark::DoNotOptimize(image_points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename CameraModel>
+static void BM_CamFromImgScalar(benchmark::State& state) {
+  const auto data = CreateCameraModelData<CameraModel>(state.range(0));
+  std::vector<Eigen::Vector2d> cam_points(data.image_points.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < data.image_points.size(); ++i) {
+      const std::optional<Eigen::Vector2d> cam_point =
+          data.camera.CamFromImg(data.image_points[i]);
+      if (cam_point) {
+        cam_points[i] = *cam_point;
+      }
+    }
+    benchmark::DoNotOptimize(cam_points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename CameraModel>
+static void BM_CamFromImgBatch(benchmark::State& state) {
+  const auto data = CreateCameraModelData<CameraModel>(state.range(0));
+  std::vector<Eigen::Vector2d> cam_points(data.image_points.size());
+  for (auto _ : state) {
+    data.camera.CamFromImgBatch(
+        span<const Eigen::Vector2d>(data.image_points.data(),
+                                    data.image_points.size()),
+        span<Eigen::Vector2d>(cam_points.data(), cam_points.size()));
+    benchmark::DoNotOptimize(cam_points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+#define REGISTER_CAMERA_MODEL_BENCHMARKS(CameraModel)                       \
+  BENCHMARK_TEMPLATE(BM_ImgFromCamScalar, CameraModel)->Arg(10000);         \
+  BENCHMARK_TEMPLATE(BM_ImgFromCamBatch, CameraModel)->Arg(10000);          \
+  BENCHMARK_TEMPLATE(BM_CamFromImgScalar, CameraModel)->Arg(10000);         \
+  BENCHMARK_TEMPLATE(BM_CamFromImgBatch, CameraModel)->Arg(10000);
+
+REGISTER_CAMERA_MODEL_BENCHMARKS(SimplePinholeCameraModel)
+REGISTER_CAMERA_MODEL_BENCHMARKS(PinholeCameraModel)
+REGISTER_CAMERA_MODEL_BENCHMARKS(SimpleRadialCameraModel)
+REGISTER_CAMERA_MODEL_BENCHMARKS(RadialCameraModel)
+REGISTER_CAMERA_MODEL_BENCHMARKS(OpenCVCameraModel)
+REGISTER_CAMERA_MODEL_BENCHMARKS(OpenCVFisheyeCameraModel)
+REGISTER_CAMERA_MODEL_BENCHMARKS(FullOpenCVCameraModel)
+
+BENCHMARK_MAIN();
@@ -5,107 +5,183 @@
 #include "colmap/util/eigen_alignment.h"
 #include "colmap/util/logging.h"
 
+#include <chrono>
+#include <memory>
+#include <vector>
+
 #include <benchmark/benchmark.h>
 #include <ceres/ceres.h>
 
 using namespace colmap;
-using camera_model = SimpleRadialCameraModel;
 
 struct ReprojErrorData {
   Rigid3d cam_from_world;
+  Rigid3d cam_from_rig;
   Eigen::Vector3d point3D;
   Eigen::Vector2d point2D;
   std::vector<double> camera_params;
 };
 
+template <typename CameraModel>
 static ReprojErrorData CreateReprojErrorData() {
   ReprojErrorData data{
       Rigid3d(Eigen::Quaterniond(0.9, 0.1, 0.1, 0.1), Eigen::Vector3d::Zero()),
+      Rigid3d(Eigen::Quaterniond(0.95, 0.05, -0.1, 0.1),
+              Eigen::Vector3d(0.1, 0, 0)),
       Eigen::Vector3d(1, 2, 10),
       Eigen::Vector2d(0.1, 0.2),
-      {1, 0, 0, 0.1},
+      CameraModel::InitializeParams(
+          /*focal_length=*/1, /*width=*/0, /*height=*/0),
   };
-  CHECK_EQ(data.camera_params.size(), camera_model::num_params);
-  return std::move(data);
+  for (const size_t idx : CameraModel::extra_params_idxs) {
+    data.camera_params[idx] = 0.01;
+  }
+  CHECK_EQ(data.camera_params.size(), CameraModel::num_params);
+  return data;
 }
 
-class BM_ReprojErrorCostFunction : public benchmark::Fixture {
- public:
-  void SetUp(::benchmark::State& state) {
-    cost_function.reset(
-        ReprojErrorCostFunctor<camera_model>::Create(data.point2D));
+// Creates either the automatically differentiated cost function of the given
+// functor or the analytic one, as selected by CreateCameraCostFunction.
+template <template <typename> class CostFunctor,
+          typename CameraModel,
+          bool kAnalytic,
+          typename... Args>
+static ceres::CostFunction* CreateCostFunction(Args&&... args) {
+  if constexpr (kAnalytic) {
+    return CreateCameraCostFunction<CostFunctor>(CameraModel::model_id,
+                                                 std::forward<Args>(args)...);
+  } else {
+    return CostFunctor<CameraModel>::Create(std::forward<Args>(args)...);
   }
+}
 
-  ReprojErrorData data = CreateReprojErrorData();
-  const double* parameters[4] = {data.cam_from_world.rotation.coeffs().data(),
-                                 data.cam_from_world.translation.data(),
-                                 data.point3D.data(),
-                                 data.camera_params.data()};
+// Evaluates the cost function with Jacobians and, for the analytic variants,
+// reports the speedup over automatic differentiation as a counter.
+static void RunCostFunction(benchmark::State& state,
+                            const ceres::CostFunction& cost_function,
+                            const ceres::CostFunction* autodiff_cost_function,
+                            const double* const* parameters) {
   double residuals[2];
-  double jacobian_q[2 * 4];
-  double jacobian_t[2 * 3];
-  double jacobian_p[2 * 3];
-  double jacobian_params[2 * camera_model::num_params];
-  double* jacobians[4] = {jacobian_q, jacobian_t, jacobian_p, jacobian_params};
-  std::unique_ptr<ceres::CostFunction> cost_function;
-};
+  std::vector<std::vector<double>> jacobians_data;
+  std::vector<double*> jacobians;
+  for (const int32_t block_size : cost_function.parameter_block_sizes()) {
+    jacobians_data.emplace_back(2 * block_size);
+    jacobians.push_back(jacobians_data.back().data());
+  }
 
-BENCHMARK_F(BM_ReprojErrorCostFunction, Run)(benchmark::State& state) {
   for (auto _ : state) {
-    cost_function->Evaluate(parameters, residuals, jacobians);
+    cost_function.Evaluate(parameters, residuals, jacobians.data());
+    benchmark::DoNotOptimize(residuals);
   }
-}
 
-class BM_ReprojErrorConstantPoseCostFunction : public benchmark::Fixture {
- public:
-  void SetUp(::benchmark::State& state) {
-    cost_function.reset(
-        ReprojErrorConstantPoseCostFunctor<camera_model>::Create(
-            data.point2D, data.cam_from_world));
+  if (autodiff_cost_function != nullptr) {
+    const auto time_evaluations = [&](const ceres::CostFunction& function) {
+      constexpr int kNumEvaluations = 100000;
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < kNumEvaluations; ++i) {
+        function.Evaluate(parameters, residuals, jacobians.data());
+        benchmark::DoNotOptimize(residuals);
+      }
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           start)
+          .count();
+    };
+    state.counters["speedup"] =
+        time_evaluations(*autodiff_cost_function) /
+        time_evaluations(cost_function);
   }
+}
 
-  ReprojErrorData data = CreateReprojErrorData();
-  const double* parameters[2] = {data.point3D.data(),
+template <typename CameraModel, bool kAnalytic>
+static void BM_ReprojErrorCostFunction(benchmark::State& state) {
+  const auto data = CreateReprojErrorData<CameraModel>();
+  std::unique_ptr<ceres::CostFunction> cost_function(
+      CreateCostFunction<ReprojErrorCostFunctor, CameraModel, kAnalytic>(
+          data.point2D));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      kAnalytic ? ReprojErrorCostFunctor<CameraModel>::Create(data.point2D)
+                : nullptr);
+  const double* parameters[4] = {data.cam_from_world.rotation.coeffs().data(),
+                                 data.cam_from_world.translation.data(),
+                                 data.point3D.data(),
                                  data.camera_params.data()};
-  double residuals[2];
-  double jacobian_p[2 * 3];
-  double jacobian_params[2 * camera_model::num_params];
-  double* jacobians[2] = {jacobian_p, jacobian_params};
-  std::unique_ptr<ceres::CostFunction> cost_function;
-};
-
-BENCHMARK_F(BM_ReprojErrorConstantPoseCostFunction, Run)
-(benchmark::State& state) {
-  for (auto _ : state) {
-    cost_function->Evaluate(parameters, residuals, jacobians);
-  }
+  RunCostFunction(
+      state, *cost_function, autodiff_cost_function.get(), parameters);
 }
 
-class BM_ReprojErrorConstantPoint3DCostFunction : public benchmark::Fixture {
- public:
-  void SetUp(::benchmark::State& state) {
-    cost_function.reset(
-        ReprojErrorConstantPoint3DCostFunctor<camera_model>::Create(
-            data.point2D, data.point3D));
-  }
+template <typename CameraModel, bool kAnalytic>
+static void BM_ReprojErrorConstantPoseCostFunction(benchmark::State& state) {
+  const auto data = CreateReprojErrorData<CameraModel>();
+  std::unique_ptr<ceres::CostFunction> cost_function(
+      CreateCostFunction<ReprojErrorConstantPoseCostFunctor,
+                         CameraModel,
+                         kAnalytic>(data.point2D, data.cam_from_world));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      kAnalytic ? ReprojErrorConstantPoseCostFunctor<CameraModel>::Create(
+                      data.point2D, data.cam_from_world)
+                : nullptr);
+  const double* parameters[2] = {data.point3D.data(),
+                                 data.camera_params.data()};
+  RunCostFunction(
+      state, *cost_function, autodiff_cost_function.get(), parameters);
+}
 
-  ReprojErrorData data = CreateReprojErrorData();
+template <typename CameraModel, bool kAnalytic>
+static void BM_ReprojErrorConstantPoint3DCostFunction(
+    benchmark::State& state) {
+  const auto data = CreateReprojErrorData<CameraModel>();
+  std::unique_ptr<ceres::CostFunction> cost_function(
+      CreateCostFunction<ReprojErrorConstantPoint3DCostFunctor,
+                         CameraModel,
+                         kAnalytic>(data.point2D, data.point3D));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      kAnalytic ? ReprojErrorConstantPoint3DCostFunctor<CameraModel>::Create(
+                      data.point2D, data.point3D)
+                : nullptr);
   const double* parameters[3] = {data.cam_from_world.rotation.coeffs().data(),
                                  data.cam_from_world.translation.data(),
                                  data.camera_params.data()};
-  double residuals[2];
-  double jacobian_q[2 * 4];
-  double jacobian_t[2 * 3];
-  double jacobian_params[2 * camera_model::num_params];
-  double* jacobians[3] = {jacobian_q, jacobian_t, jacobian_params};
-  std::unique_ptr<ceres::CostFunction> cost_function;
-};
+  RunCostFunction(
+      state, *cost_function, autodiff_cost_function.get(), parameters);
+}
 
-BENCHMARK_F(BM_ReprojErrorConstantPoint3DCostFunction, Run)
-(benchmark::State& state) {
-  for (auto _ : state) {
-    cost_function->Evaluate(parameters, residuals, jacobians);
-  }
+template <typename CameraModel, bool kAnalytic>
+static void BM_RigReprojErrorCostFunction(benchmark::State& state) {
+  const auto data = CreateReprojErrorData<CameraModel>();
+  std::unique_ptr<ceres::CostFunction> cost_function(
+      CreateCostFunction<RigReprojErrorCostFunctor, CameraModel, kAnalytic>(
+          data.point2D));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      kAnalytic ? RigReprojErrorCostFunctor<CameraModel>::Create(data.point2D)
+                : nullptr);
+  const double* parameters[6] = {data.cam_from_rig.rotation.coeffs().data(),
+                                 data.cam_from_rig.translation.data(),
+                                 data.cam_from_world.rotation.coeffs().data(),
+                                 data.cam_from_world.translation.data(),
+                                 data.point3D.data(),
+                                 data.camera_params.data()};
+  RunCostFunction(
+      state, *cost_function, autodiff_cost_function.get(), parameters);
 }
 
+#define REGISTER_COST_FUNCTION_BENCHMARKS(CameraModel)                      \
+  BENCHMARK_TEMPLATE(BM_ReprojErrorCostFunction, CameraModel, false);       \
+  BENCHMARK_TEMPLATE(BM_ReprojErrorCostFunction, CameraModel, true);        \
+  BENCHMARK_TEMPLATE(                                                       \
+      BM_ReprojErrorConstantPoseCostFunction, CameraModel, false);          \
+  BENCHMARK_TEMPLATE(                                                       \
+      BM_ReprojErrorConstantPoseCostFunction, CameraModel, true);           \
+  BENCHMARK_TEMPLATE(                                                       \
+      BM_ReprojErrorConstantPoint3DCostFunction, CameraModel, false);       \
+  BENCHMARK_TEMPLATE(                                                       \
+      BM_ReprojErrorConstantPoint3DCostFunction, CameraModel, true);        \
+  BENCHMARK_TEMPLATE(BM_RigReprojErrorCostFunction, CameraModel, false);    \
+  BENCHMARK_TEMPLATE(BM_RigReprojErrorCostFunction, CameraModel, true);
+
+REGISTER_COST_FUNCTION_BENCHMARKS(SimplePinholeCameraModel)
+REGISTER_COST_FUNCTION_BENCHMARKS(PinholeCameraModel)
+REGISTER_COST_FUNCTION_BENCHMARKS(SimpleRadialCameraModel)
+REGISTER_COST_FUNCTION_BENCHMARKS(RadialCameraModel)
+REGISTER_COST_FUNCTION_BENCHMARKS(OpenCVCameraModel)
+
 BENCHMARK_MAIN();
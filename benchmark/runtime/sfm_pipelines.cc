@@ -0,0 +1,74 @@
+#include "colmap/controllers/global_pipeline.h"
+#include "colmap/controllers/incremental_pipeline.h"
+#include "colmap/scene/database.h"
+#include "colmap/scene/synthetic.h"
+#include "colmap/util/logging.h"
+
+#include <filesystem>
+
+#include <benchmark/benchmark.h>
+
+using namespace colmap;
+
+// Synthesizes a database with the given number of frames, which is shared by
+// the incremental and global pipeline benchmarks.
+static std::string CreateSyntheticDatabase(const int num_frames) {
+  const std::string database_path =
+      (std::filesystem::temp_directory_path() /
+       ("colmap_benchmark_sfm_" + std::to_string(num_frames) + ".db"))
+          .string();
+  if (std::filesystem::exists(database_path)) {
+    return database_path;
+  }
+  Database database(database_path);
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions options;
+  options.num_rigs = 1;
+  options.num_cameras_per_rig = 1;
+  options.num_frames_per_rig = num_frames;
+  options.num_points3D = 500;
+  options.point2D_stddev = 0.5;
+  SynthesizeDataset(options, &reconstruction, &database);
+  return database_path;
+}
+
+static void BM_IncrementalPipeline(benchmark::State& state) {
+  const std::string database_path =
+      CreateSyntheticDatabase(static_cast<int>(state.range(0)));
+  auto options = std::make_shared<IncrementalPipelineOptions>();
+  options->extract_colors = false;
+  for (auto _ : state) {
+    auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+    IncrementalPipeline mapper(
+        options, /*image_path=*/"", database_path, reconstruction_manager);
+    mapper.Run();
+    CHECK_EQ(reconstruction_manager->Size(), 1);
+  }
+}
+
+static void BM_GlobalPipeline(benchmark::State& state) {
+  const std::string database_path =
+      CreateSyntheticDatabase(static_cast<int>(state.range(0)));
+  GlobalPipeline::Options options;
+  options.database_path = database_path;
+  options.incremental_options.extract_colors = false;
+  for (auto _ : state) {
+    auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+    GlobalPipeline mapper(options, reconstruction_manager);
+    mapper.Run();
+    CHECK_EQ(reconstruction_manager->Size(), 1);
+  }
+}
+
+BENCHMARK(BM_IncrementalPipeline)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(100)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GlobalPipeline)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(100)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
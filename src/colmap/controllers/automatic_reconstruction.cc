@@ -87,6 +87,7 @@ AutomaticReconstructionController::AutomaticReconstructionController(
   option_manager_.sequential_pairing->num_threads = options_.num_threads;
   option_manager_.vocab_tree_pairing->num_threads = options_.num_threads;
   option_manager_.mapper->num_threads = options_.num_threads;
+  option_manager_.patch_match_stereo->num_threads = options_.num_threads;
   option_manager_.poisson_meshing->num_threads = options_.num_threads;
 
   option_manager_.two_view_geometry->ransac_options.random_seed =
@@ -108,6 +109,7 @@ AutomaticReconstructionController::AutomaticReconstructionController(
   option_manager_.feature_extraction->use_gpu = options_.use_gpu;
   option_manager_.feature_matching->use_gpu = options_.use_gpu;
   option_manager_.mapper->ba_use_gpu = options_.use_gpu;
+  option_manager_.patch_match_stereo->use_gpu = options_.use_gpu;
   option_manager_.bundle_adjustment->use_gpu = options_.use_gpu;
 
   option_manager_.feature_extraction->gpu_index = options_.gpu_index;
@@ -301,7 +303,6 @@ void AutomaticReconstructionController::RunDenseMapper() {
 
     // Patch match stereo.
 
-#if defined(COLMAP_CUDA_ENABLED)
     {
       mvs::PatchMatchController patch_match_controller(
           *option_manager_.patch_match_stereo, dense_path, "COLMAP", "");
@@ -309,10 +310,6 @@ void AutomaticReconstructionController::RunDenseMapper() {
           [&]() { return IsStopped(); });
       patch_match_controller.Run();
     }
-#else   // COLMAP_CUDA_ENABLED
-    LOG(WARNING) << "Skipping patch match stereo because CUDA is not available";
-    return;
-#endif  // COLMAP_CUDA_ENABLED
 
     if (IsStopped()) {
       return;
@@ -63,8 +63,11 @@ class BundleAdjustmentIterationCallback : public ceres::IterationCallback {
 
 BundleAdjustmentController::BundleAdjustmentController(
     const OptionManager& options,
-    std::shared_ptr<Reconstruction> reconstruction)
-    : options_(options), reconstruction_(std::move(reconstruction)) {}
+    std::shared_ptr<Reconstruction> reconstruction,
+    std::optional<PartitionedBundleAdjustmentOptions> partitioned_options)
+    : options_(options),
+      reconstruction_(std::move(reconstruction)),
+      partitioned_options_(std::move(partitioned_options)) {}
 
 void BundleAdjustmentController::Run() {
   THROW_CHECK_NOTNULL(reconstruction_);
@@ -98,8 +101,16 @@ void BundleAdjustmentController::Run() {
   ba_config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
 
   // Run bundle adjustment.
-  std::unique_ptr<BundleAdjuster> bundle_adjuster = CreateDefaultBundleAdjuster(
-      std::move(ba_options), std::move(ba_config), *reconstruction_);
+  std::unique_ptr<BundleAdjuster> bundle_adjuster;
+  if (partitioned_options_) {
+    bundle_adjuster = CreatePartitionedBundleAdjuster(std::move(ba_options),
+                                                      *partitioned_options_,
+                                                      std::move(ba_config),
+                                                      *reconstruction_);
+  } else {
+    bundle_adjuster = CreateDefaultBundleAdjuster(
+        std::move(ba_options), std::move(ba_config), *reconstruction_);
+  }
   bundle_adjuster->Solve();
   reconstruction_->UpdatePoint3DErrors();
 
@@ -30,22 +30,31 @@
 #pragma once
 
 #include "colmap/controllers/option_manager.h"
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/util/base_controller.h"
 
+#include <optional>
+
 namespace colmap {
 
-// Class that controls the global bundle adjustment procedure.
+// Class that controls the global bundle adjustment procedure. If partitioned
+// options are given, the problem is split into partitions that are solved in
+// parallel, see CreatePartitionedBundleAdjuster.
 class BundleAdjustmentController : public BaseController {
  public:
-  BundleAdjustmentController(const OptionManager& options,
-                             std::shared_ptr<Reconstruction> reconstruction);
+  BundleAdjustmentController(
+      const OptionManager& options,
+      std::shared_ptr<Reconstruction> reconstruction,
+      std::optional<PartitionedBundleAdjustmentOptions> partitioned_options =
+          std::nullopt);
 
   void Run();
 
  private:
   const OptionManager options_;
   std::shared_ptr<Reconstruction> reconstruction_;
+  const std::optional<PartitionedBundleAdjustmentOptions> partitioned_options_;
 };
 
 }  // namespace colmap
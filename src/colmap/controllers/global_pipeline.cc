@@ -0,0 +1,167 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/controllers/global_pipeline.h"
+
+#include "colmap/scene/database.h"
+#include "colmap/scene/database_cache.h"
+#include "colmap/util/misc.h"
+#include "colmap/util/timer.h"
+
+namespace colmap {
+
+bool GlobalPipeline::Options::Check() const {
+  CHECK_OPTION(global_mapper_options.Check());
+  CHECK_OPTION(incremental_options.Check());
+  return true;
+}
+
+GlobalPipeline::GlobalPipeline(
+    const Options& options,
+    std::shared_ptr<ReconstructionManager> reconstruction_manager)
+    : options_(options),
+      reconstruction_manager_(std::move(reconstruction_manager)) {
+  THROW_CHECK(options_.Check());
+}
+
+void GlobalPipeline::Run() {
+  Timer run_timer;
+  run_timer.Start();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Load database
+  //////////////////////////////////////////////////////////////////////////////
+
+  PrintHeading1("Loading database");
+
+  std::shared_ptr<DatabaseCache> database_cache;
+  std::vector<std::pair<image_pair_t, TwoViewGeometry>> two_view_geometries;
+  {
+    Database database(options_.database_path);
+    Timer timer;
+    timer.Start();
+    const std::unordered_set<std::string> image_names(
+        options_.incremental_options.image_names.begin(),
+        options_.incremental_options.image_names.end());
+    database_cache = DatabaseCache::Create(
+        database,
+        static_cast<size_t>(options_.incremental_options.min_num_matches),
+        options_.incremental_options.ignore_watermarks,
+        image_names);
+    two_view_geometries = database.ReadTwoViewGeometries();
+    timer.PrintMinutes();
+  }
+
+  if (database_cache->NumImages() == 0) {
+    LOG(WARNING) << "No images with matches found in the database";
+    return;
+  }
+
+  if (CheckIfStopped()) {
+    return;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Estimate global poses
+  //////////////////////////////////////////////////////////////////////////////
+
+  PrintHeading1("Estimating global poses");
+
+  GlobalMapperOptions global_mapper_options = options_.global_mapper_options;
+  if (global_mapper_options.num_threads < 0) {
+    global_mapper_options.num_threads =
+        options_.incremental_options.num_threads;
+  }
+  if (global_mapper_options.random_seed < 0) {
+    global_mapper_options.random_seed =
+        options_.incremental_options.random_seed;
+  }
+
+  const size_t reconstruction_idx = reconstruction_manager_->Add();
+  std::shared_ptr<Reconstruction> reconstruction =
+      reconstruction_manager_->Get(reconstruction_idx);
+
+  GlobalMapper global_mapper(database_cache);
+  const size_t num_reg_frames =
+      global_mapper.EstimatePoses(global_mapper_options,
+                                  std::move(two_view_geometries),
+                                  *reconstruction);
+  if (num_reg_frames < 2) {
+    LOG(WARNING) << "Failed to estimate global poses";
+    reconstruction_manager_->Delete(reconstruction_idx);
+    return;
+  }
+
+  LOG(INFO) << StringPrintf("=> Registered %zu / %zu frames",
+                            num_reg_frames,
+                            database_cache->NumFrames());
+
+  if (CheckIfStopped()) {
+    return;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Triangulation and global bundle adjustment
+  //////////////////////////////////////////////////////////////////////////////
+
+  PrintHeading1("Triangulation and global bundle adjustment");
+
+  IncrementalMapper::Options mapper_options =
+      options_.incremental_options.Mapper();
+  // All frames are registered before the refinement, so none of them must be
+  // treated as an existing, fixed frame.
+  mapper_options.fix_existing_frames = false;
+  const IncrementalTriangulator::Options tri_options =
+      options_.incremental_options.Triangulation();
+
+  IncrementalMapper mapper(database_cache);
+  mapper.BeginReconstruction(reconstruction);
+
+  for (const image_t image_id : reconstruction->RegImageIds()) {
+    mapper.TriangulateImage(tri_options, image_id);
+  }
+  LOG(INFO) << "=> Triangulated points: " << reconstruction->NumPoints3D();
+
+  mapper.IterativeGlobalRefinement(
+      options_.incremental_options.ba_global_max_refinements,
+      options_.incremental_options.ba_global_max_refinement_change,
+      mapper_options,
+      options_.incremental_options.GlobalBundleAdjustment(),
+      tri_options);
+  mapper.FilterFrames(mapper_options);
+  mapper.EndReconstruction(/*discard=*/false);
+
+  if (options_.incremental_options.extract_colors) {
+    reconstruction->ExtractColorsForAllImages(options_.image_path);
+  }
+
+  run_timer.PrintMinutes();
+}
+
+}  // namespace colmap
@@ -30,6 +30,7 @@
 #include "colmap/controllers/hierarchical_pipeline.h"
 
 #include "colmap/estimators/alignment.h"
+#include "colmap/estimators/bundle_adjustment.h"
 #include "colmap/scene/scene_clustering.h"
 #include "colmap/sfm/observation_manager.h"
 #include "colmap/util/misc.h"
@@ -38,18 +39,18 @@
 namespace colmap {
 namespace {
 
-void MergeClusters(const SceneClustering::Cluster& cluster,
-                   std::unordered_map<const SceneClustering::Cluster*,
-                                      std::shared_ptr<ReconstructionManager>>*
-                       reconstruction_managers) {
+// Merges the reconstructions of all child clusters into a new reconstruction
+// manager for the given cluster. The child clusters must already be merged.
+std::shared_ptr<ReconstructionManager> MergeChildClusters(
+    const SceneClustering::Cluster& cluster,
+    const std::unordered_map<const SceneClustering::Cluster*,
+                             std::shared_ptr<ReconstructionManager>>&
+        reconstruction_managers) {
   // Extract all reconstructions from all child clusters.
   std::vector<std::shared_ptr<Reconstruction>> reconstructions;
   for (const auto& child_cluster : cluster.child_clusters) {
-    if (!child_cluster.child_clusters.empty()) {
-      MergeClusters(child_cluster, reconstruction_managers);
-    }
-
-    auto& reconstruction_manager = reconstruction_managers->at(&child_cluster);
+    const auto& reconstruction_manager =
+        reconstruction_managers.at(&child_cluster);
     for (size_t i = 0; i < reconstruction_manager->Size(); ++i) {
       reconstructions.push_back(reconstruction_manager->Get(i));
     }
@@ -86,19 +87,102 @@ void MergeClusters(const SceneClustering::Cluster& cluster,
     }
   }
 
-  // Insert a new reconstruction manager for merged cluster.
-  auto& reconstruction_manager = (*reconstruction_managers)[&cluster];
-  reconstruction_manager = std::make_shared<ReconstructionManager>();
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
   for (const auto& reconstruction : reconstructions) {
     reconstruction_manager->Get(reconstruction_manager->Add()) = reconstruction;
   }
+  return reconstruction_manager;
+}
 
-  // Delete all merged child cluster reconstruction managers.
+void CollectInnerClustersByDepth(
+    const SceneClustering::Cluster& cluster,
+    const size_t depth,
+    std::vector<std::vector<const SceneClustering::Cluster*>>*
+        clusters_by_depth) {
+  if (cluster.child_clusters.empty()) {
+    return;
+  }
+  if (clusters_by_depth->size() <= depth) {
+    clusters_by_depth->resize(depth + 1);
+  }
+  (*clusters_by_depth)[depth].push_back(&cluster);
   for (const auto& child_cluster : cluster.child_clusters) {
-    reconstruction_managers->erase(&child_cluster);
+    CollectInnerClustersByDepth(child_cluster, depth + 1, clusters_by_depth);
+  }
+}
+
+// Merges the cluster tree bottom-up. The clusters at the same depth of the tree
+// are independent of each other and merged concurrently, such that the merge
+// time scales with the depth of the tree rather than the number of clusters.
+void MergeClusters(const SceneClustering::Cluster& root_cluster,
+                   ThreadPool& thread_pool,
+                   std::unordered_map<const SceneClustering::Cluster*,
+                                      std::shared_ptr<ReconstructionManager>>*
+                       reconstruction_managers) {
+  std::vector<std::vector<const SceneClustering::Cluster*>> clusters_by_depth;
+  CollectInnerClustersByDepth(root_cluster, 0, &clusters_by_depth);
+
+  for (auto clusters_it = clusters_by_depth.rbegin();
+       clusters_it != clusters_by_depth.rend();
+       ++clusters_it) {
+    const std::vector<const SceneClustering::Cluster*>& clusters =
+        *clusters_it;
+
+    // The map of reconstruction managers is only read while merging.
+    std::vector<std::shared_ptr<ReconstructionManager>> merged_managers(
+        clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i) {
+      thread_pool.AddTask([&clusters,
+                           &merged_managers,
+                           reconstruction_managers,
+                           i]() {
+        merged_managers[i] =
+            MergeChildClusters(*clusters[i], *reconstruction_managers);
+      });
+    }
+    thread_pool.Wait();
+
+    // Insert the merged cluster and delete all merged child clusters.
+    for (size_t i = 0; i < clusters.size(); ++i) {
+      (*reconstruction_managers)[clusters[i]] = std::move(merged_managers[i]);
+      for (const auto& child_cluster : clusters[i]->child_clusters) {
+        reconstruction_managers->erase(&child_cluster);
+      }
+    }
   }
 }
 
+// Jointly refines all merged clusters, since the separately reconstructed
+// clusters are only aligned but not adjusted to each other by merging.
+void AdjustGlobalBundle(const IncrementalPipelineOptions& options,
+                        Reconstruction& reconstruction) {
+  const std::vector<image_t> reg_image_ids = reconstruction.RegImageIds();
+  if (reg_image_ids.size() < 2) {
+    return;
+  }
+
+  ObservationManager obs_manager(reconstruction);
+  obs_manager.FilterObservationsWithNegativeDepth();
+
+  BundleAdjustmentConfig ba_config;
+  for (const image_t image_id : reg_image_ids) {
+    ba_config.AddImage(image_id);
+  }
+  for (const camera_t camera_id : options.constant_cameras) {
+    ba_config.SetConstantCamIntrinsics(camera_id);
+  }
+  ba_config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  std::unique_ptr<BundleAdjuster> bundle_adjuster = CreateDefaultBundleAdjuster(
+      options.GlobalBundleAdjustment(), std::move(ba_config), reconstruction);
+  bundle_adjuster->Solve();
+
+  const size_t num_filtered_observations =
+      obs_manager.FilterAllPoints3D(options.mapper.filter_max_reproj_error,
+                                    options.mapper.filter_min_tri_angle);
+  VLOG(1) << "=> Filtered observations: " << num_filtered_observations;
+}
+
 }  // namespace
 
 bool HierarchicalPipeline::Options::Check() const {
@@ -238,7 +322,9 @@ void HierarchicalPipeline::Run() {
   if (leaf_clusters.size() > 1) {
     PrintHeading1("Merging clusters");
 
-    MergeClusters(*scene_clustering.GetRootCluster(), &reconstruction_managers);
+    MergeClusters(*scene_clustering.GetRootCluster(),
+                  thread_pool,
+                  &reconstruction_managers);
   }
 
   THROW_CHECK_EQ(reconstruction_managers.size(), 1);
@@ -246,6 +332,17 @@ void HierarchicalPipeline::Run() {
       reconstruction_managers.begin()->second->Get(0)->NumRegImages(), 0);
   *reconstruction_manager_ = *reconstruction_managers.begin()->second;
 
+  if (options_.final_global_ba) {
+    PrintHeading1("Global bundle adjustment");
+    for (size_t i = 0; i < reconstruction_manager_->Size(); ++i) {
+      thread_pool.AddTask([this, i]() {
+        AdjustGlobalBundle(options_.incremental_options,
+                           *reconstruction_manager_->Get(i));
+      });
+    }
+    thread_pool.Wait();
+  }
+
   for (size_t i = 0; i < reconstruction_manager_->Size(); ++i) {
     auto reconstruction = reconstruction_manager_->Get(i);
     reconstruction->UpdatePoint3DErrors();
@@ -55,9 +55,15 @@ class HierarchicalPipeline : public BaseController {
     // The maximum number of trials to initialize a cluster.
     int init_num_trials = 10;
 
-    // The number of workers used to reconstruct clusters in parallel.
+    // The number of workers used to reconstruct and merge clusters in
+    // parallel.
     int num_workers = -1;
 
+    // Whether to run a global bundle adjustment over each merged
+    // reconstruction, which distributes the alignment errors between the
+    // separately reconstructed clusters.
+    bool final_global_ba = false;
+
     // Options for clustering the scene graph.
     SceneClustering::Options clustering_options;
 
@@ -93,6 +93,36 @@ TEST(HierarchicalPipeline, WithoutNoise) {
                              /*num_obs_tolerance=*/0);
 }
 
+TEST(HierarchicalPipeline, WithNoiseAndFinalGlobalBA) {
+  const std::string database_path = CreateTestDir() + "/database.db";
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 20;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 0.5;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  HierarchicalPipeline::Options mapper_options;
+  mapper_options.database_path = database_path;
+  mapper_options.clustering_options.leaf_max_num_images = 5;
+  mapper_options.clustering_options.image_overlap = 3;
+  mapper_options.final_global_ba = true;
+  HierarchicalPipeline mapper(mapper_options, reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  ExpectEqualReconstructions(gt_reconstruction,
+                             *reconstruction_manager->Get(0),
+                             /*max_rotation_error_deg=*/1e-1,
+                             /*max_proj_center_error=*/1e-1,
+                             /*num_obs_tolerance=*/0.02);
+}
+
 TEST(HierarchicalPipeline, WithoutNoiseAndNonTrivialFrames) {
   const std::string database_path = CreateTestDir() + "/database.db";
 
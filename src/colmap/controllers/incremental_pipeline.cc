@@ -31,6 +31,7 @@
 
 #include "colmap/estimators/alignment.h"
 #include "colmap/util/file.h"
+#include "colmap/util/threading.h"
 #include "colmap/util/timer.h"
 
 namespace colmap {
@@ -74,6 +75,58 @@ void WriteSnapshot(const Reconstruction& reconstruction,
   reconstruction.Write(path);
 }
 
+// Writes snapshots either inline or asynchronously on a single background
+// thread. In asynchronous mode, the reconstruction is copied on the calling
+// thread and the copy is serialized in the background, so that at most one
+// snapshot copy is alive at any time. Snapshot requests that arrive while the
+// previous snapshot is still being written are skipped.
+class SnapshotWriter {
+ public:
+  SnapshotWriter(std::string snapshot_path, bool async)
+      : snapshot_path_(std::move(snapshot_path)) {
+    if (async) {
+      thread_pool_ = std::make_unique<ThreadPool>(1);
+    }
+  }
+
+  ~SnapshotWriter() { Wait(); }
+
+  void Write(const Reconstruction& reconstruction) {
+    if (!thread_pool_) {
+      WriteSnapshot(reconstruction, snapshot_path_);
+      return;
+    }
+
+    if (pending_write_.valid()) {
+      if (pending_write_.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready) {
+        LOG(INFO) << "Skipping snapshot, previous snapshot still being written";
+        return;
+      }
+      pending_write_.get();
+    }
+
+    auto reconstruction_copy =
+        std::make_shared<const Reconstruction>(reconstruction);
+    pending_write_ = thread_pool_->AddTask(
+        [snapshot_path = snapshot_path_,
+         reconstruction_copy = std::move(reconstruction_copy)]() {
+          WriteSnapshot(*reconstruction_copy, snapshot_path);
+        });
+  }
+
+  void Wait() {
+    if (pending_write_.valid()) {
+      pending_write_.wait();
+    }
+  }
+
+ private:
+  const std::string snapshot_path_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::future<void> pending_write_;
+};
+
 }  // namespace
 
 IncrementalMapper::Options IncrementalPipelineOptions::Mapper() const {
@@ -129,6 +182,10 @@ BundleAdjustmentOptions IncrementalPipelineOptions::LocalBundleAdjustment()
       BundleAdjustmentOptions::LossFunctionType::SOFT_L1;
   options.use_gpu = ba_use_gpu;
   options.gpu_index = ba_gpu_index;
+  options.reuse_problem = ba_reuse_problem;
+  options.use_batched_solver = ba_use_batched_solver;
+  options.use_mixed_precision = ba_use_mixed_precision;
+  options.solver_profile_path = ba_solver_profile_path;
   return options;
 }
 
@@ -161,6 +218,10 @@ BundleAdjustmentOptions IncrementalPipelineOptions::GlobalBundleAdjustment()
       BundleAdjustmentOptions::LossFunctionType::TRIVIAL;
   options.use_gpu = ba_use_gpu;
   options.gpu_index = ba_gpu_index;
+  options.reuse_problem = ba_reuse_problem;
+  options.use_batched_solver = ba_use_batched_solver;
+  options.use_mixed_precision = ba_use_mixed_precision;
+  options.solver_profile_path = ba_solver_profile_path;
   return options;
 }
 
@@ -226,6 +287,14 @@ void IncrementalPipeline::Run() {
 
   IncrementalMapper::Options mapper_options = options_->Mapper();
   IncrementalMapper mapper(database_cache_);
+  if (mapper_options.prune_redundant_frames) {
+    LOG(INFO) << "Pruning redundant frames";
+    const size_t num_redundant_frames =
+        mapper.PruneRedundantFrames(mapper_options);
+    LOG(INFO) << "=> Deferring " << num_redundant_frames << " / "
+              << database_cache_->NumFrames() << " frames";
+  }
+
   Reconstruct(mapper,
               mapper_options,
               /*continue_reconstruction=*/continue_reconstruction);
@@ -404,6 +473,8 @@ IncrementalPipeline::Status IncrementalPipeline::ReconstructSubModel(
   // Incremental mapping
   ////////////////////////////////////////////////////////////////////////////
 
+  SnapshotWriter snapshot_writer(options_->snapshot_path,
+                                 options_->snapshot_async);
   size_t snapshot_prev_num_reg_frames = reconstruction->NumRegFrames();
   size_t ba_prev_num_reg_frames = reconstruction->NumRegFrames();
   size_t ba_prev_num_points = reconstruction->NumPoints3D();
@@ -485,7 +556,7 @@ IncrementalPipeline::Status IncrementalPipeline::ReconstructSubModel(
           reconstruction->NumRegFrames() >=
               options_->snapshot_frames_freq + snapshot_prev_num_reg_frames) {
         snapshot_prev_num_reg_frames = reconstruction->NumRegFrames();
-        WriteSnapshot(*reconstruction, options_->snapshot_path);
+        snapshot_writer.Write(*reconstruction);
       }
 
       Callback(NEXT_IMAGE_REG_CALLBACK);
@@ -515,6 +586,16 @@ IncrementalPipeline::Status IncrementalPipeline::ReconstructSubModel(
       reconstruction->NumPoints3D() != ba_prev_num_points) {
     IterativeGlobalRefinement(*options_, mapper_options, mapper);
   }
+
+  // Register the deferred redundant frames against the converged 3D points.
+  if (!mapper.RedundantFrames().empty()) {
+    LOG(INFO) << "Registering redundant frames";
+    const size_t num_reg_redundant_frames =
+        mapper.RegisterRedundantFrames(mapper_options);
+    LOG(INFO) << "=> Registered " << num_reg_redundant_frames << " / "
+              << mapper.RedundantFrames().size() << " frames";
+  }
+
   return Status::SUCCESS;
 }
 
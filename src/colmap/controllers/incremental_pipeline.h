@@ -126,6 +126,22 @@ struct IncrementalPipelineOptions {
   int ba_global_max_refinements = 5;
   double ba_global_max_refinement_change = 0.0005;
 
+  // Whether to keep the bundle adjustment problem alive across iterative
+  // refinement rounds and only update the changed observations.
+  bool ba_reuse_problem = false;
+
+  // Whether to use the batched bundle adjuster with a dedicated Schur
+  // complement solver instead of one Ceres residual block per observation.
+  bool ba_use_batched_solver = false;
+
+  // Whether the batched bundle adjuster stores the Jacobians in single
+  // precision with double precision accumulation of the normal equations.
+  bool ba_use_mixed_precision = false;
+
+  // Optional path to a solver profile calibrated on this host with the
+  // bundle_adjuster_calibrator command.
+  std::string ba_solver_profile_path;
+
   // Whether to use Ceres' CUDA sparse linear algebra library, if available.
   bool ba_use_gpu = false;
   std::string ba_gpu_index = "-1";
@@ -146,6 +162,11 @@ struct IncrementalPipelineOptions {
   std::string snapshot_path = "";
   int snapshot_frames_freq = 0;
 
+  // Whether to write snapshots on a background thread. The mapper only pays
+  // for copying the reconstruction, and at most one snapshot is kept in memory
+  // at a time. Snapshots are skipped while the previous one is being written.
+  bool snapshot_async = false;
+
   // Optional list of image names to reconstruct. If no images are specified,
   // all images will be reconstructed by default.
   std::vector<std::string> image_names;
@@ -31,6 +31,7 @@
 
 #include "colmap/estimators/alignment.h"
 #include "colmap/scene/synthetic.h"
+#include "colmap/util/file.h"
 #include "colmap/util/testing.h"
 
 #include <gtest/gtest.h>
@@ -144,6 +145,116 @@ TEST(IncrementalPipeline, WithoutNoise) {
                             /*num_obs_tolerance=*/0);
 }
 
+TEST(IncrementalPipeline, WithAsyncSnapshots) {
+  const std::string test_dir = CreateTestDir();
+  const std::string database_path = test_dir + "/database.db";
+  const std::string snapshot_path = test_dir + "/snapshots";
+  CreateDirIfNotExists(snapshot_path);
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 7;
+  synthetic_dataset_options.num_points3D = 50;
+  synthetic_dataset_options.point2D_stddev = 0;
+  synthetic_dataset_options.camera_has_prior_focal_length = false;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  auto options = std::make_shared<IncrementalPipelineOptions>();
+  options->snapshot_path = snapshot_path;
+  options->snapshot_frames_freq = 1;
+  options->snapshot_async = true;
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  IncrementalPipeline mapper(
+      options, /*image_path=*/"", database_path, reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  ExpectReconstructionsNear(gt_reconstruction,
+                            *reconstruction_manager->Get(0),
+                            /*max_rotation_error_deg=*/1e-2,
+                            /*max_proj_center_error=*/1e-4,
+                            /*num_obs_tolerance=*/0);
+
+  // All snapshots must be fully written once the pipeline returns.
+  const std::vector<std::string> snapshot_dirs = GetDirList(snapshot_path);
+  EXPECT_GE(snapshot_dirs.size(), 1);
+  for (const std::string& snapshot_dir : snapshot_dirs) {
+    Reconstruction snapshot;
+    snapshot.Read(snapshot_dir);
+    EXPECT_GT(snapshot.NumRegFrames(), 0);
+    EXPECT_LE(snapshot.NumRegFrames(), gt_reconstruction.NumFrames());
+  }
+}
+
+TEST(IncrementalPipeline, WithoutNoiseAndRedundantFrames) {
+  const std::string database_path = CreateTestDir() + "/database.db";
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 7;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 0;
+  synthetic_dataset_options.camera_has_prior_focal_length = false;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  // Consider all strongly overlapping frames as redundant independent of their
+  // disparity, so that most frames are deferred and registered at the end.
+  auto options = std::make_shared<IncrementalPipelineOptions>();
+  options->mapper.prune_redundant_frames = true;
+  options->mapper.redundant_frame_max_disparity = 1.0;
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  IncrementalPipeline mapper(
+      options, /*image_path=*/"", database_path, reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  ExpectReconstructionsNear(gt_reconstruction,
+                            *reconstruction_manager->Get(0),
+                            /*max_rotation_error_deg=*/1e-2,
+                            /*max_proj_center_error=*/1e-4,
+                            /*num_obs_tolerance=*/0.5);
+}
+
+TEST(IncrementalPipeline, WithoutNoiseAndSubsampledTracks) {
+  const std::string database_path = CreateTestDir() + "/database.db";
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 7;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 0;
+  synthetic_dataset_options.camera_has_prior_focal_length = false;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  // Refine the poses in global bundle adjustment on a small subset of the
+  // tracks, such that most points are only refined with fixed poses.
+  auto options = std::make_shared<IncrementalPipelineOptions>();
+  options->mapper.ba_global_subsample_tracks = true;
+  options->mapper.ba_global_subsample_min_num_points3D = 0;
+  options->mapper.ba_global_subsample_grid_size = 4;
+  options->mapper.ba_global_max_points_per_cell = 1;
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  IncrementalPipeline mapper(
+      options, /*image_path=*/"", database_path, reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  ExpectReconstructionsNear(gt_reconstruction,
+                            *reconstruction_manager->Get(0),
+                            /*max_rotation_error_deg=*/1e-2,
+                            /*max_proj_center_error=*/1e-4,
+                            /*num_obs_tolerance=*/0);
+}
+
 TEST(IncrementalPipeline, WithoutNoiseAndWithNonTrivialFrames) {
   const std::string database_path = CreateTestDir() + "/database.db";
 
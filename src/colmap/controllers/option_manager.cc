@@ -521,6 +521,12 @@ void OptionManager::AddBundleAdjustmentOptions() {
                               &bundle_adjustment->refine_sensor_from_rig);
   AddAndRegisterDefaultOption("BundleAdjustment.use_gpu",
                               &bundle_adjustment->use_gpu);
+  AddAndRegisterDefaultOption("BundleAdjustment.use_batched_solver",
+                              &bundle_adjustment->use_batched_solver);
+  AddAndRegisterDefaultOption("BundleAdjustment.use_mixed_precision",
+                              &bundle_adjustment->use_mixed_precision);
+  AddAndRegisterDefaultOption("BundleAdjustment.solver_profile_path",
+                              &bundle_adjustment->solver_profile_path);
   AddAndRegisterDefaultOption("BundleAdjustment.gpu_index",
                               &bundle_adjustment->gpu_index);
   AddAndRegisterDefaultOption("BundleAdjustment.min_num_images_gpu_solver",
@@ -605,6 +611,14 @@ void OptionManager::AddMapperOptions() {
                               &mapper->ba_local_max_refinements);
   AddAndRegisterDefaultOption("Mapper.ba_local_max_refinement_change",
                               &mapper->ba_local_max_refinement_change);
+  AddAndRegisterDefaultOption("Mapper.ba_reuse_problem",
+                              &mapper->ba_reuse_problem);
+  AddAndRegisterDefaultOption("Mapper.ba_use_batched_solver",
+                              &mapper->ba_use_batched_solver);
+  AddAndRegisterDefaultOption("Mapper.ba_use_mixed_precision",
+                              &mapper->ba_use_mixed_precision);
+  AddAndRegisterDefaultOption("Mapper.ba_solver_profile_path",
+                              &mapper->ba_solver_profile_path);
   AddAndRegisterDefaultOption("Mapper.ba_use_gpu", &mapper->ba_use_gpu);
   AddAndRegisterDefaultOption("Mapper.ba_gpu_index", &mapper->ba_gpu_index);
   AddAndRegisterDefaultOption(
@@ -613,6 +627,7 @@ void OptionManager::AddMapperOptions() {
   AddAndRegisterDefaultOption("Mapper.snapshot_path", &mapper->snapshot_path);
   AddAndRegisterDefaultOption("Mapper.snapshot_frames_freq",
                               &mapper->snapshot_frames_freq);
+  AddAndRegisterDefaultOption("Mapper.snapshot_async", &mapper->snapshot_async);
   AddAndRegisterDefaultOption("Mapper.fix_existing_frames",
                               &mapper->fix_existing_frames);
 
@@ -641,6 +656,21 @@ void OptionManager::AddMapperOptions() {
                               &mapper->mapper.max_reg_trials);
   AddAndRegisterDefaultOption("Mapper.local_ba_min_tri_angle",
                               &mapper->mapper.local_ba_min_tri_angle);
+  AddAndRegisterDefaultOption("Mapper.prune_redundant_frames",
+                              &mapper->mapper.prune_redundant_frames);
+  AddAndRegisterDefaultOption("Mapper.redundant_frame_min_overlap",
+                              &mapper->mapper.redundant_frame_min_overlap);
+  AddAndRegisterDefaultOption("Mapper.redundant_frame_max_disparity",
+                              &mapper->mapper.redundant_frame_max_disparity);
+  AddAndRegisterDefaultOption("Mapper.ba_global_subsample_tracks",
+                              &mapper->mapper.ba_global_subsample_tracks);
+  AddAndRegisterDefaultOption(
+      "Mapper.ba_global_subsample_min_num_points3D",
+      &mapper->mapper.ba_global_subsample_min_num_points3D);
+  AddAndRegisterDefaultOption("Mapper.ba_global_subsample_grid_size",
+                              &mapper->mapper.ba_global_subsample_grid_size);
+  AddAndRegisterDefaultOption("Mapper.ba_global_max_points_per_cell",
+                              &mapper->mapper.ba_global_max_points_per_cell);
 
   AddDefaultOption("Mapper.image_list_path", &mapper_image_list_path_);
   AddDefaultOption("Mapper.constant_camera_list_path",
@@ -681,6 +711,10 @@ void OptionManager::AddPatchMatchStereoOptions() {
                               &patch_match_stereo->max_image_size);
   AddAndRegisterDefaultOption("PatchMatchStereo.gpu_index",
                               &patch_match_stereo->gpu_index);
+  AddAndRegisterDefaultOption("PatchMatchStereo.use_gpu",
+                              &patch_match_stereo->use_gpu);
+  AddAndRegisterDefaultOption("PatchMatchStereo.num_threads",
+                              &patch_match_stereo->num_threads);
   AddAndRegisterDefaultOption("PatchMatchStereo.depth_min",
                               &patch_match_stereo->depth_min);
   AddAndRegisterDefaultOption("PatchMatchStereo.depth_max",
@@ -728,6 +762,12 @@ void OptionManager::AddPatchMatchStereoOptions() {
                               &patch_match_stereo->allow_missing_files);
   AddAndRegisterDefaultOption("PatchMatchStereo.write_consistency_graph",
                               &patch_match_stereo->write_consistency_graph);
+  AddAndRegisterDefaultOption("PatchMatchStereo.output_format",
+                              &patch_match_stereo->output_format);
+  AddAndRegisterDefaultOption("PatchMatchStereo.output_half_precision",
+                              &patch_match_stereo->output_half_precision);
+  AddAndRegisterDefaultOption("PatchMatchStereo.output_compress",
+                              &patch_match_stereo->output_compress);
 }
 
 void OptionManager::AddStereoFusionOptions() {
@@ -760,6 +800,10 @@ void OptionManager::AddStereoFusionOptions() {
                               &stereo_fusion->cache_size);
   AddAndRegisterDefaultOption("StereoFusion.use_cache",
                               &stereo_fusion->use_cache);
+  AddAndRegisterDefaultOption("StereoFusion.tile_memory_budget",
+                              &stereo_fusion->tile_memory_budget);
+  AddAndRegisterDefaultOption("StereoFusion.tile_overlap",
+                              &stereo_fusion->tile_overlap);
 }
 
 void OptionManager::AddPoissonMeshingOptions() {
@@ -775,6 +819,10 @@ void OptionManager::AddPoissonMeshingOptions() {
   AddAndRegisterDefaultOption("PoissonMeshing.trim", &poisson_meshing->trim);
   AddAndRegisterDefaultOption("PoissonMeshing.num_threads",
                               &poisson_meshing->num_threads);
+  AddAndRegisterDefaultOption("PoissonMeshing.target_resolution",
+                              &poisson_meshing->target_resolution);
+  AddAndRegisterDefaultOption("PoissonMeshing.simplify_face_ratio",
+                              &poisson_meshing->simplify_face_ratio);
 }
 
 void OptionManager::AddDelaunayMeshingOptions() {
@@ -799,6 +847,12 @@ void OptionManager::AddDelaunayMeshingOptions() {
                               &delaunay_meshing->max_side_length_percentile);
   AddAndRegisterDefaultOption("DelaunayMeshing.num_threads",
                               &delaunay_meshing->num_threads);
+  AddAndRegisterDefaultOption("DelaunayMeshing.target_resolution",
+                              &delaunay_meshing->target_resolution);
+  AddAndRegisterDefaultOption("DelaunayMeshing.parallel_integration",
+                              &delaunay_meshing->parallel_integration);
+  AddAndRegisterDefaultOption("DelaunayMeshing.simplify_face_ratio",
+                              &delaunay_meshing->simplify_face_ratio);
 }
 
 void OptionManager::AddRenderOptions() {
@@ -0,0 +1,1508 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/batched_bundle_adjustment.h"
+
+#include "colmap/estimators/cost_functions.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/threading.h"
+#include "colmap/util/timer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+namespace colmap {
+namespace {
+
+// The pose parameters of a frame are the tangent of the rotation (left
+// perturbation) followed by the translation.
+constexpr int kPoseSize = 6;
+
+// Maximum number of parameters of a parameter block in the reduced camera
+// system, i.e., of a pose or of the camera parameters.
+constexpr int kMaxBlockSize = 16;
+
+// Number of observations and points processed per task when using multiple
+// threads.
+constexpr size_t kNumObservationsPerTask = 4096;
+constexpr size_t kNumPointsPerTask = 1024;
+
+using BlockJacobian =
+    Eigen::Matrix<double, 2, Eigen::Dynamic, Eigen::RowMajor, 2, kMaxBlockSize>;
+
+// Coupling J_block^T * J_point between a block of the reduced camera system
+// and a point, which is stored on the stack.
+using BlockPointMatrix = Eigen::
+    Matrix<double, Eigen::Dynamic, 3, Eigen::ColMajor, kMaxBlockSize, 3>;
+
+size_t NumTasks(const size_t num_items, const size_t num_items_per_task) {
+  return (num_items + num_items_per_task - 1) / num_items_per_task;
+}
+
+// Calls func(task_idx, begin, end) for consecutive ranges of [0, num_items)
+// with at most num_items_per_task items. The tasks are run in parallel if a
+// thread pool is given. Since the ranges do not depend on the number of
+// threads, reductions over the tasks are deterministic.
+template <typename Func>
+void RunTasks(ThreadPool* thread_pool,
+              const size_t num_items,
+              const size_t num_items_per_task,
+              const Func& func) {
+  const size_t num_tasks = NumTasks(num_items, num_items_per_task);
+  auto RunTask = [&](const size_t task_idx) {
+    const size_t begin = task_idx * num_items_per_task;
+    func(task_idx, begin, std::min(begin + num_items_per_task, num_items));
+  };
+  if (thread_pool == nullptr) {
+    for (size_t task_idx = 0; task_idx < num_tasks; ++task_idx) {
+      RunTask(task_idx);
+    }
+  } else {
+    for (size_t task_idx = 0; task_idx < num_tasks; ++task_idx) {
+      thread_pool->AddTask(RunTask, task_idx);
+    }
+    thread_pool->Wait();
+  }
+}
+
+bool IsAnalyticCameraModel(const CameraModelId model_id) {
+  switch (model_id) {
+#define CAMERA_MODEL_CASE(CameraModel) \
+  case CameraModel::model_id:          \
+    return AnalyticCameraModel<CameraModel>::value;
+
+    CAMERA_MODEL_SWITCH_CASES
+
+#undef CAMERA_MODEL_CASE
+  }
+  return false;
+}
+
+Eigen::Matrix3d CrossProductMatrix(const Eigen::Vector3d& v) {
+  Eigen::Matrix3d matrix;
+  matrix << 0, -v.z(), v.y(), v.z(), 0, -v.x(), -v.y(), v.x(), 0;
+  return matrix;
+}
+
+// The Jacobians of the observations are stored with the given scalar type,
+// while the normal equations are always accumulated in double precision.
+template <typename JacobianScalar>
+class BatchedBundleAdjuster : public BundleAdjuster {
+ public:
+  BatchedBundleAdjuster(BundleAdjustmentOptions options,
+                        BundleAdjustmentConfig config,
+                        Reconstruction& reconstruction)
+      : BundleAdjuster(std::move(options), std::move(config)),
+        loss_function_(options_.CreateLossFunction()) {
+    SetUpProblem(reconstruction);
+  }
+
+  ceres::Solver::Summary Solve() override {
+    ceres::Solver::Summary summary;
+    if (num_observations_ == 0) {
+      return summary;
+    }
+
+    Timer timer;
+    timer.Start();
+
+    const ceres::Solver::Options& solver_options = options_.solver_options;
+    const int num_threads =
+        2 * num_observations_ <
+                static_cast<size_t>(
+                    options_.min_num_residuals_for_cpu_multi_threading)
+            ? 1
+            : GetEffectiveNumThreads(solver_options.num_threads);
+    std::unique_ptr<ThreadPool> thread_pool;
+    if (num_threads > 1) {
+      thread_pool = std::make_unique<ThreadPool>(num_threads);
+    }
+
+    summary.num_residuals = 2 * num_observations_;
+    summary.num_residuals_reduced = summary.num_residuals;
+    summary.num_effective_parameters_reduced =
+        num_camera_system_params_ + 3 * num_variable_points_;
+    summary.num_threads_given = solver_options.num_threads;
+    summary.num_threads_used = num_threads;
+    summary.num_successful_steps = 0;
+    summary.num_unsuccessful_steps = 0;
+    summary.termination_type = ceres::NO_CONVERGENCE;
+
+    double cost = Evaluate(/*jacobians=*/true, thread_pool.get());
+    summary.initial_cost = cost;
+
+    // Levenberg-Marquardt with the trust region update strategy of Ceres,
+    // where the damping factor is the inverse trust region radius.
+    double lambda = 1 / solver_options.initial_trust_region_radius;
+    double lambda_factor = 2;
+    int num_consecutive_invalid_steps = 0;
+    for (int iteration = 0;; ++iteration) {
+      if (ComputeGradient(thread_pool.get()) <=
+          solver_options.gradient_tolerance) {
+        summary.termination_type = ceres::CONVERGENCE;
+        summary.message = "Gradient tolerance reached.";
+        break;
+      }
+      if (iteration >= solver_options.max_num_iterations) {
+        summary.message = "Maximum number of iterations reached.";
+        break;
+      }
+      if (lambda > 1 / solver_options.min_trust_region_radius) {
+        summary.termination_type = ceres::CONVERGENCE;
+        summary.message = "Minimum trust region radius reached.";
+        break;
+      }
+
+      if (!SolveReducedSystem(lambda, thread_pool.get())) {
+        ++summary.num_unsuccessful_steps;
+        if (++num_consecutive_invalid_steps >
+            solver_options.max_num_consecutive_invalid_steps) {
+          summary.termination_type = ceres::FAILURE;
+          summary.message = "Too many consecutive invalid steps.";
+          break;
+        }
+        lambda *= lambda_factor;
+        lambda_factor *= 2;
+        continue;
+      }
+      num_consecutive_invalid_steps = 0;
+
+      const double step_norm = std::sqrt(camera_step_.squaredNorm() +
+                                         point_step_.squaredNorm());
+      const double params_norm = ComputeParamsNorm();
+      if (step_norm <= solver_options.parameter_tolerance *
+                           (params_norm + solver_options.parameter_tolerance)) {
+        summary.termination_type = ceres::CONVERGENCE;
+        summary.message = "Parameter tolerance reached.";
+        break;
+      }
+
+      const double model_cost_change =
+          ComputeModelCostChange(thread_pool.get());
+      BackupParams();
+      ApplyStep();
+      const double new_cost = Evaluate(/*jacobians=*/false, thread_pool.get());
+      const double relative_decrease =
+          (cost - new_cost) / std::max(model_cost_change,
+                                       std::numeric_limits<double>::min());
+      if (model_cost_change > 0 && std::isfinite(new_cost) &&
+          relative_decrease > solver_options.min_relative_decrease) {
+        ++summary.num_successful_steps;
+        const bool function_tolerance_reached =
+            std::abs(cost - new_cost) <=
+            solver_options.function_tolerance * cost;
+        cost = new_cost;
+        lambda *= std::max(1.0 / 3.0,
+                           1 - std::pow(2 * relative_decrease - 1, 3));
+        lambda = std::max(lambda, 1 / solver_options.max_trust_region_radius);
+        lambda_factor = 2;
+        if (function_tolerance_reached) {
+          summary.termination_type = ceres::CONVERGENCE;
+          summary.message = "Function tolerance reached.";
+          break;
+        }
+        Evaluate(/*jacobians=*/true, thread_pool.get());
+      } else {
+        ++summary.num_unsuccessful_steps;
+        RestoreParams();
+        lambda *= lambda_factor;
+        lambda_factor *= 2;
+      }
+    }
+
+    summary.final_cost = cost;
+    summary.total_time_in_seconds = timer.ElapsedSeconds();
+
+    if (options_.print_summary || VLOG_IS_ON(1)) {
+      PrintSolverSummary(summary, "Batched bundle adjustment report");
+    }
+
+    return summary;
+  }
+
+  std::shared_ptr<ceres::Problem>& Problem() override { return problem_; }
+
+ private:
+  // A parameter block in the reduced camera system, i.e., a frame pose or the
+  // parameters of a camera. Only the active parameters of the block are part
+  // of the system, e.g., when refining a subset of the camera parameters.
+  struct ParameterBlock {
+    // Index of the first active parameter in the reduced camera system.
+    int offset = 0;
+    // Local indices of the active parameters.
+    std::vector<int> active;
+    // Index of the diagonal block in the reduced camera system.
+    size_t system_block_idx = 0;
+  };
+
+  struct FrameParams {
+    Rigid3d* rig_from_world = nullptr;
+    int block_idx = -1;
+  };
+
+  struct CameraParams {
+    Camera* camera = nullptr;
+    int block_idx = -1;
+  };
+
+  struct ImageParams {
+    image_t image_id = kInvalidImageId;
+    int camera_idx = -1;
+    // Index of the variable frame or -1 for images with constant poses, in
+    // which case the constant pose is stored in cam_from_world.
+    int frame_idx = -1;
+    Rigid3d sensor_from_rig;
+    Rigid3d cam_from_world;
+    // Cached for each evaluation of the residuals.
+    Eigen::Matrix3d cam_from_world_rotation;
+    Eigen::Matrix3d sensor_from_rig_rotation;
+    Eigen::Matrix3d rig_from_world_rotation;
+  };
+
+  struct PointParams {
+    Eigen::Vector3d* xyz = nullptr;
+    bool constant = false;
+    std::vector<size_t> observation_idxs;
+    // Range of the point's entries, i.e., of the distinct camera system
+    // blocks of its observations in increasing order (see entry_block_idxs_).
+    size_t entry_begin = 0;
+    size_t entry_end = 0;
+    // Offset of the system block indices of the upper triangle of entry pairs
+    // in point_system_block_idxs_.
+    size_t system_block_offset = 0;
+  };
+
+  // Contiguous range of observations with the same camera model.
+  struct ObservationBatch {
+    CameraModelId model_id = CameraModelId::kInvalid;
+    int num_params = 0;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  void SetUpProblem(Reconstruction& reconstruction) {
+    struct Observation {
+      int image_idx;
+      int point_idx;
+      Eigen::Vector2d xy;
+    };
+    std::vector<Observation> observations;
+
+    std::unordered_map<frame_t, int> frame_idxs;
+    std::unordered_map<camera_t, int> camera_idxs;
+    std::unordered_map<point3D_t, int> point_idxs;
+    std::set<camera_t> variable_camera_ids;
+
+    auto GetPointIdx = [&](const point3D_t point3D_id) {
+      const auto [it, inserted] =
+          point_idxs.emplace(point3D_id, static_cast<int>(points_.size()));
+      if (inserted) {
+        PointParams& point = points_.emplace_back();
+        point.xyz = &reconstruction.Point3D(point3D_id).xyz;
+      }
+      return it->second;
+    };
+
+    auto GetCameraIdx = [&](Camera& camera) {
+      const auto [it, inserted] = camera_idxs.emplace(
+          camera.camera_id, static_cast<int>(cameras_.size()));
+      if (inserted) {
+        cameras_.emplace_back().camera = &camera;
+      }
+      return it->second;
+    };
+
+    // Add the observations of the images in the config. Iterate in a
+    // deterministic order to make the gauge selection reproducible.
+    const std::set<image_t> image_ids(config_.Images().begin(),
+                                      config_.Images().end());
+    for (const image_t image_id : image_ids) {
+      Image& image = reconstruction.Image(image_id);
+      if (image.NumPoints3D() == 0) {
+        continue;
+      }
+
+      ImageParams& image_params = images_.emplace_back();
+      image_params.image_id = image_id;
+      image_params.camera_idx = GetCameraIdx(*image.CameraPtr());
+      variable_camera_ids.insert(image.CameraId());
+
+      Rigid3d& rig_from_world = image.FramePtr()->RigFromWorld();
+      rig_from_world.rotation.normalize();
+      if (!image.HasTrivialFrame()) {
+        image_params.sensor_from_rig =
+            image.FramePtr()->RigPtr()->SensorFromRig(
+                image.CameraPtr()->SensorId());
+      }
+      if (options_.refine_rig_from_world &&
+          !config_.HasConstantRigFromWorldPose(image.FrameId())) {
+        const auto [it, inserted] = frame_idxs.emplace(
+            image.FrameId(), static_cast<int>(frames_.size()));
+        if (inserted) {
+          frames_.emplace_back().rig_from_world = &rig_from_world;
+        }
+        image_params.frame_idx = it->second;
+      } else {
+        image_params.cam_from_world =
+            image_params.sensor_from_rig * rig_from_world;
+      }
+
+      const int image_idx = static_cast<int>(images_.size()) - 1;
+      for (const Point2D& point2D : image.Points2D()) {
+        if (point2D.HasPoint3D() &&
+            !config_.HasIgnoredPoint(point2D.point3D_id)) {
+          THROW_CHECK_GT(reconstruction.Point3D(point2D.point3D_id)
+                             .track.Length(),
+                         1);
+          observations.push_back(
+              {image_idx, GetPointIdx(point2D.point3D_id), point2D.xy});
+        }
+      }
+    }
+
+    // Add the remaining observations of the points in the config with
+    // constant poses.
+    std::unordered_map<image_t, int> constant_image_idxs;
+    auto AddPointObservations = [&](const point3D_t point3D_id) {
+      const int point_idx = GetPointIdx(point3D_id);
+      for (const auto& track_el :
+           reconstruction.Point3D(point3D_id).track.Elements()) {
+        if (config_.HasImage(track_el.image_id)) {
+          continue;
+        }
+        const auto [it, inserted] = constant_image_idxs.emplace(
+            track_el.image_id, static_cast<int>(images_.size()));
+        if (inserted) {
+          Image& image = reconstruction.Image(track_el.image_id);
+          ImageParams& image_params = images_.emplace_back();
+          image_params.image_id = track_el.image_id;
+          image_params.camera_idx = GetCameraIdx(*image.CameraPtr());
+          image_params.cam_from_world = image.CamFromWorld();
+        }
+        observations.push_back(
+            {it->second,
+             point_idx,
+             reconstruction.Image(track_el.image_id)
+                 .Point2D(track_el.point2D_idx)
+                 .xy});
+      }
+    };
+    for (const point3D_t point3D_id : config_.VariablePoints()) {
+      AddPointObservations(point3D_id);
+    }
+    for (const point3D_t point3D_id : config_.ConstantPoints()) {
+      AddPointObservations(point3D_id);
+    }
+
+    // Group the observations by camera model and, within a batch, by image
+    // for memory locality in the evaluation.
+    std::stable_sort(
+        observations.begin(),
+        observations.end(),
+        [this](const Observation& obs1, const Observation& obs2) {
+          const CameraModelId model_id1 =
+              cameras_[images_[obs1.image_idx].camera_idx].camera->model_id;
+          const CameraModelId model_id2 =
+              cameras_[images_[obs2.image_idx].camera_idx].camera->model_id;
+          return model_id1 < model_id2 ||
+                 (model_id1 == model_id2 && obs1.image_idx < obs2.image_idx);
+        });
+
+    num_observations_ = observations.size();
+    image_idxs_.resize(num_observations_);
+    point_idxs_.resize(num_observations_);
+    point2D_x_.resize(num_observations_);
+    point2D_y_.resize(num_observations_);
+    camera_jacobian_offsets_.resize(num_observations_);
+    size_t num_camera_jacobian_values = 0;
+    for (size_t i = 0; i < num_observations_; ++i) {
+      const Observation& obs = observations[i];
+      const Camera& camera =
+          *cameras_[images_[obs.image_idx].camera_idx].camera;
+      if (batches_.empty() || batches_.back().model_id != camera.model_id) {
+        ObservationBatch& batch = batches_.emplace_back();
+        batch.model_id = camera.model_id;
+        batch.num_params = static_cast<int>(camera.params.size());
+        batch.begin = i;
+      }
+      batches_.back().end = i + 1;
+      image_idxs_[i] = obs.image_idx;
+      point_idxs_[i] = obs.point_idx;
+      point2D_x_[i] = obs.xy.x();
+      point2D_y_[i] = obs.xy.y();
+      camera_jacobian_offsets_[i] = num_camera_jacobian_values;
+      num_camera_jacobian_values += 2 * camera.params.size();
+      points_[obs.point_idx].observation_idxs.push_back(i);
+    }
+
+    residuals_.resize(2 * num_observations_);
+    pose_jacobians_.resize(2 * kPoseSize * num_observations_);
+    point_jacobians_.resize(2 * 3 * num_observations_);
+    camera_jacobians_.resize(num_camera_jacobian_values);
+
+    // Points with observations outside of the problem are constant.
+    for (const auto& [point3D_id, point_idx] : point_idxs) {
+      PointParams& point = points_[point_idx];
+      point.constant =
+          config_.HasConstantPoint(point3D_id) ||
+          reconstruction.Point3D(point3D_id).track.Length() >
+              point.observation_idxs.size();
+    }
+
+    std::vector<std::vector<int>> frame_active(
+        frames_.size(), {0, 1, 2, 3, 4, 5});
+    switch (config_.FixedGauge()) {
+      case BundleAdjustmentGauge::UNSPECIFIED:
+        break;
+      case BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD:
+        FixGaugeWithTwoCamsFromWorld(reconstruction, frame_active);
+        break;
+      case BundleAdjustmentGauge::THREE_POINTS:
+        FixGaugeWithThreePoints();
+        break;
+      default:
+        LOG(FATAL) << "Unknown BundleAdjustmentGauge";
+    }
+
+    // Set up the parameter blocks of the reduced camera system.
+    num_camera_system_params_ = 0;
+    auto AddBlock = [this](std::vector<int> active) {
+      ParameterBlock& block = blocks_.emplace_back();
+      block.offset = num_camera_system_params_;
+      block.active = std::move(active);
+      num_camera_system_params_ += static_cast<int>(block.active.size());
+      return static_cast<int>(blocks_.size()) - 1;
+    };
+
+    for (size_t frame_idx = 0; frame_idx < frames_.size(); ++frame_idx) {
+      if (!frame_active[frame_idx].empty()) {
+        frames_[frame_idx].block_idx =
+            AddBlock(std::move(frame_active[frame_idx]));
+      }
+    }
+
+    for (CameraParams& camera_params : cameras_) {
+      const Camera& camera = *camera_params.camera;
+      // Do not optimize intrinsics if the corresponding images were not
+      // included explicitly in the config.
+      if (variable_camera_ids.count(camera.camera_id) == 0 ||
+          config_.HasConstantCamIntrinsics(camera.camera_id)) {
+        continue;
+      }
+      std::vector<bool> is_constant(camera.params.size(), false);
+      auto SetConstant = [&is_constant](const span<const size_t> idxs) {
+        for (const size_t idx : idxs) {
+          is_constant[idx] = true;
+        }
+      };
+      if (!options_.refine_focal_length) {
+        SetConstant(camera.FocalLengthIdxs());
+      }
+      if (!options_.refine_principal_point) {
+        SetConstant(camera.PrincipalPointIdxs());
+      }
+      if (!options_.refine_extra_params) {
+        SetConstant(camera.ExtraParamsIdxs());
+      }
+      std::vector<int> active;
+      for (size_t idx = 0; idx < camera.params.size(); ++idx) {
+        if (!is_constant[idx]) {
+          active.push_back(static_cast<int>(idx));
+        }
+      }
+      THROW_CHECK_LE(active.size(), kMaxBlockSize);
+      if (!active.empty()) {
+        camera_params.block_idx = AddBlock(std::move(active));
+      }
+    }
+
+    num_variable_points_ = 0;
+    for (const PointParams& point : points_) {
+      if (!point.constant) {
+        ++num_variable_points_;
+      }
+    }
+
+    // Determine the sparsity structure of the reduced camera system, where
+    // two blocks are coupled if they are observed jointly or share a point.
+    // The indices of the system blocks are precomputed, such that the system
+    // can be assembled without lookups. The upper triangle of the system is
+    // partitioned into block rows, which are assembled in parallel.
+    std::unordered_map<uint64_t, size_t> system_block_idxs;
+    auto SystemBlockIdx = [&](const int block_idx1, const int block_idx2) {
+      const uint64_t key = (static_cast<uint64_t>(block_idx1) << 32) |
+                           static_cast<uint64_t>(block_idx2);
+      const auto [it, inserted] =
+          system_block_idxs.emplace(key, system_blocks_.size());
+      if (inserted) {
+        system_blocks_.emplace_back(
+            Eigen::MatrixXd::Zero(blocks_[block_idx1].active.size(),
+                                  blocks_[block_idx2].active.size()));
+        system_block_pairs_.emplace_back(block_idx1, block_idx2);
+      }
+      return it->second;
+    };
+
+    for (size_t block_idx = 0; block_idx < blocks_.size(); ++block_idx) {
+      blocks_[block_idx].system_block_idx = SystemBlockIdx(
+          static_cast<int>(block_idx), static_cast<int>(block_idx));
+    }
+
+    // The frame blocks precede the camera blocks, such that the coupling of
+    // the blocks of an observation lies in the block row of its frame.
+    block_observation_offsets_.assign(blocks_.size() + 1, 0);
+    observation_system_block_idxs_.resize(num_observations_);
+    for (size_t i = 0; i < num_observations_; ++i) {
+      const auto [block_idx1, block_idx2] = ObservationBlockIdxs(i);
+      for (const int block_idx : {block_idx1, block_idx2}) {
+        if (block_idx >= 0) {
+          ++block_observation_offsets_[block_idx + 1];
+        }
+      }
+      if (block_idx1 >= 0 && block_idx2 >= 0) {
+        THROW_CHECK_LT(block_idx1, block_idx2);
+        observation_system_block_idxs_[i] =
+            SystemBlockIdx(block_idx1, block_idx2);
+      }
+    }
+    std::partial_sum(block_observation_offsets_.begin(),
+                     block_observation_offsets_.end(),
+                     block_observation_offsets_.begin());
+    block_observation_idxs_.resize(block_observation_offsets_.back());
+    std::vector<size_t> block_observation_ends(
+        block_observation_offsets_.begin(),
+        block_observation_offsets_.end() - 1);
+    for (size_t i = 0; i < num_observations_; ++i) {
+      const auto [block_idx1, block_idx2] = ObservationBlockIdxs(i);
+      for (const int block_idx : {block_idx1, block_idx2}) {
+        if (block_idx >= 0) {
+          block_observation_idxs_[block_observation_ends[block_idx]++] = i;
+        }
+      }
+    }
+
+    // Each variable point couples all pairs of its distinct blocks. The
+    // coupling J_block^T * J_point is accumulated per entry, i.e., per point
+    // and distinct block, to avoid redundant updates of the system blocks.
+    observation_entry_idxs_.resize(2 * num_observations_);
+    size_t num_entry_values = 0;
+    std::vector<int> point_block_idxs;
+    for (size_t point_idx = 0; point_idx < points_.size(); ++point_idx) {
+      PointParams& point = points_[point_idx];
+      if (point.constant) {
+        continue;
+      }
+
+      point_block_idxs.clear();
+      for (const size_t obs_idx : point.observation_idxs) {
+        const auto [block_idx1, block_idx2] = ObservationBlockIdxs(obs_idx);
+        for (const int block_idx : {block_idx1, block_idx2}) {
+          if (block_idx >= 0) {
+            point_block_idxs.push_back(block_idx);
+          }
+        }
+      }
+      std::sort(point_block_idxs.begin(), point_block_idxs.end());
+      point_block_idxs.erase(
+          std::unique(point_block_idxs.begin(), point_block_idxs.end()),
+          point_block_idxs.end());
+
+      point.entry_begin = entry_block_idxs_.size();
+      for (const int block_idx : point_block_idxs) {
+        entry_block_idxs_.push_back(block_idx);
+        entry_point_idxs_.push_back(point_idx);
+        entry_value_offsets_.push_back(num_entry_values);
+        num_entry_values += 3 * blocks_[block_idx].active.size();
+      }
+      point.entry_end = entry_block_idxs_.size();
+
+      point.system_block_offset = point_system_block_idxs_.size();
+      for (size_t k = 0; k < point_block_idxs.size(); ++k) {
+        for (size_t l = k; l < point_block_idxs.size(); ++l) {
+          point_system_block_idxs_.push_back(
+              SystemBlockIdx(point_block_idxs[k], point_block_idxs[l]));
+        }
+      }
+
+      for (const size_t obs_idx : point.observation_idxs) {
+        const auto [block_idx1, block_idx2] = ObservationBlockIdxs(obs_idx);
+        const int block_idxs[2] = {block_idx1, block_idx2};
+        for (int k = 0; k < 2; ++k) {
+          if (block_idxs[k] >= 0) {
+            observation_entry_idxs_[2 * obs_idx + k] =
+                point.entry_begin +
+                (std::lower_bound(point_block_idxs.begin(),
+                                  point_block_idxs.end(),
+                                  block_idxs[k]) -
+                 point_block_idxs.begin());
+          }
+        }
+      }
+    }
+    entry_values_.resize(num_entry_values);
+
+    block_entry_offsets_.assign(blocks_.size() + 1, 0);
+    for (const int block_idx : entry_block_idxs_) {
+      ++block_entry_offsets_[block_idx + 1];
+    }
+    std::partial_sum(block_entry_offsets_.begin(),
+                     block_entry_offsets_.end(),
+                     block_entry_offsets_.begin());
+    block_entry_idxs_.resize(entry_block_idxs_.size());
+    std::vector<size_t> block_entry_ends(block_entry_offsets_.begin(),
+                                         block_entry_offsets_.end() - 1);
+    for (size_t entry_idx = 0; entry_idx < entry_block_idxs_.size();
+         ++entry_idx) {
+      block_entry_idxs_[block_entry_ends[entry_block_idxs_[entry_idx]]++] =
+          entry_idx;
+    }
+
+    camera_rhs_.resize(num_camera_system_params_);
+    point_hessian_inverses_.resize(points_.size());
+    point_gradients_.resize(points_.size());
+  }
+
+  // Fixes the first frame and the translation of the second frame along the
+  // largest baseline dimension, as in the default bundle adjuster.
+  void FixGaugeWithTwoCamsFromWorld(
+      const Reconstruction& reconstruction,
+      std::vector<std::vector<int>>& frame_active) {
+    if (!options_.refine_rig_from_world) {
+      return;
+    }
+
+    auto IsRefSensor = [&reconstruction](const ImageParams& image_params) {
+      return reconstruction.Image(image_params.image_id).HasTrivialFrame();
+    };
+
+    // The images of the config are ordered first.
+    const ImageParams* image1 = nullptr;
+    for (const ImageParams& image_params : images_) {
+      if (!config_.HasImage(image_params.image_id)) {
+        break;
+      }
+      if (image_params.frame_idx < 0 && IsRefSensor(image_params)) {
+        if (image1 == nullptr) {
+          image1 = &image_params;
+        } else if (reconstruction.Image(image1->image_id).FrameId() !=
+                   reconstruction.Image(image_params.image_id).FrameId()) {
+          // No need to fix the gauge if two frames are already fixed.
+          return;
+        }
+      }
+    }
+
+    auto RigFromWorld = [this](const ImageParams& image_params) {
+      return image_params.frame_idx < 0
+                 ? image_params.cam_from_world
+                 : *frames_[image_params.frame_idx].rig_from_world;
+    };
+
+    const ImageParams* image2 = nullptr;
+    Eigen::Index frame2_from_world_fixed_dim = 0;
+    for (const ImageParams& image_params : images_) {
+      if (image_params.frame_idx < 0 || !IsRefSensor(image_params)) {
+        continue;
+      }
+      if (image1 == nullptr) {
+        image1 = &image_params;
+      } else if (image1->frame_idx != image_params.frame_idx) {
+        const Eigen::Vector3d baseline =
+            (RigFromWorld(*image1) * Inverse(RigFromWorld(image_params)))
+                .translation;
+        if (baseline.cwiseAbs().maxCoeff(&frame2_from_world_fixed_dim) >
+            1e-9) {
+          image2 = &image_params;
+          break;
+        }
+      }
+    }
+
+    if (image1 == nullptr || image2 == nullptr) {
+      LOG(WARNING) << "Failed to fix Gauge with two cameras. "
+                      "Falling back to fixing Gauge with three points.";
+      FixGaugeWithThreePoints();
+      return;
+    }
+
+    if (image1->frame_idx >= 0) {
+      frame_active[image1->frame_idx].clear();
+    }
+    std::vector<int>& frame2_active = frame_active[image2->frame_idx];
+    frame2_active.erase(std::find(frame2_active.begin(),
+                                  frame2_active.end(),
+                                  3 + frame2_from_world_fixed_dim));
+  }
+
+  // Fixes three non-collinear points, unless already fixed by the config.
+  void FixGaugeWithThreePoints() {
+    Eigen::Matrix3d fixed_points = Eigen::Matrix3d::Zero();
+    Eigen::Index num_fixed_points = 0;
+    auto MaybeAddFixedPoint = [&](const Eigen::Vector3d& xyz) {
+      fixed_points.col(num_fixed_points) = xyz;
+      if (fixed_points.colPivHouseholderQr().rank() > num_fixed_points) {
+        ++num_fixed_points;
+        return true;
+      }
+      fixed_points.col(num_fixed_points).setZero();
+      return false;
+    };
+
+    for (const PointParams& point : points_) {
+      if (point.constant && MaybeAddFixedPoint(*point.xyz) &&
+          num_fixed_points >= 3) {
+        return;
+      }
+    }
+
+    for (PointParams& point : points_) {
+      if (!point.constant && MaybeAddFixedPoint(*point.xyz)) {
+        point.constant = true;
+        if (num_fixed_points >= 3) {
+          return;
+        }
+      }
+    }
+
+    LOG(WARNING)
+        << "Failed to fix Gauge due to insufficient number of fixed points: "
+        << num_fixed_points;
+  }
+
+  std::pair<int, int> ObservationBlockIdxs(const size_t obs_idx) const {
+    const ImageParams& image_params = images_[image_idxs_[obs_idx]];
+    return {image_params.frame_idx < 0
+                ? -1
+                : frames_[image_params.frame_idx].block_idx,
+            cameras_[image_params.camera_idx].block_idx};
+  }
+
+  void UpdateImagePoses() {
+    for (ImageParams& image_params : images_) {
+      if (image_params.frame_idx >= 0) {
+        const Rigid3d& rig_from_world =
+            *frames_[image_params.frame_idx].rig_from_world;
+        image_params.cam_from_world =
+            image_params.sensor_from_rig * rig_from_world;
+        image_params.sensor_from_rig_rotation =
+            image_params.sensor_from_rig.rotation.toRotationMatrix();
+        image_params.rig_from_world_rotation =
+            rig_from_world.rotation.toRotationMatrix();
+      }
+      image_params.cam_from_world_rotation =
+          image_params.cam_from_world.rotation.toRotationMatrix();
+    }
+  }
+
+  // Evaluates the residuals and optionally the Jacobians of all observations
+  // and returns the total cost. The residuals and Jacobians are scaled by the
+  // square root of the derivative of the loss function, such that the normal
+  // equations correspond to an iteratively reweighted least squares step.
+  double Evaluate(const bool jacobians, ThreadPool* thread_pool) {
+    UpdateImagePoses();
+
+    std::vector<std::pair<const ObservationBatch*, size_t>> tasks;
+    for (const ObservationBatch& batch : batches_) {
+      for (size_t begin = batch.begin; begin < batch.end;
+           begin += kNumObservationsPerTask) {
+        tasks.emplace_back(&batch, begin);
+      }
+    }
+
+    std::vector<double> task_costs(tasks.size());
+    auto EvaluateTask = [&](const size_t task_idx) {
+      const auto& [batch, begin] = tasks[task_idx];
+      task_costs[task_idx] = EvaluateBatch(
+          *batch,
+          begin,
+          std::min(begin + kNumObservationsPerTask, batch->end),
+          jacobians);
+    };
+
+    if (thread_pool == nullptr) {
+      for (size_t task_idx = 0; task_idx < tasks.size(); ++task_idx) {
+        EvaluateTask(task_idx);
+      }
+    } else {
+      for (size_t task_idx = 0; task_idx < tasks.size(); ++task_idx) {
+        thread_pool->AddTask(EvaluateTask, task_idx);
+      }
+      thread_pool->Wait();
+    }
+
+    double cost = 0;
+    for (const double task_cost : task_costs) {
+      cost += task_cost;
+    }
+    return cost;
+  }
+
+  double EvaluateBatch(const ObservationBatch& batch,
+                       const size_t begin,
+                       const size_t end,
+                       const bool jacobians) {
+    switch (batch.model_id) {
+#define CAMERA_MODEL_CASE(CameraModel) \
+  case CameraModel::model_id:          \
+    return EvaluateObservations<CameraModel>(begin, end, jacobians);
+
+      CAMERA_MODEL_SWITCH_CASES
+
+#undef CAMERA_MODEL_CASE
+    }
+    return 0;
+  }
+
+  template <typename CameraModel>
+  double EvaluateObservations(const size_t begin,
+                              const size_t end,
+                              const bool jacobians) {
+    if constexpr (AnalyticCameraModel<CameraModel>::value) {
+      double cost = 0;
+      double rho[3];
+      Eigen::Vector2d xy;
+      Eigen::Matrix<double, 2, 3> J_point_in_cam;
+      CameraParamsJacobian<CameraModel> J_params;
+      for (size_t i = begin; i < end; ++i) {
+        const ImageParams& image_params = images_[image_idxs_[i]];
+        const Eigen::Vector3d& point3D = *points_[point_idxs_[i]].xyz;
+        const double* camera_params =
+            cameras_[image_params.camera_idx].camera->params.data();
+
+        // The residuals and Jacobians are only stored when evaluating the
+        // Jacobians, such that evaluating a rejected step does not overwrite
+        // the current linearization.
+        Eigen::Map<Eigen::Vector2d> residual(residuals_.data() + 2 * i);
+        Eigen::Map<
+            Eigen::Matrix<JacobianScalar, 2, kPoseSize, Eigen::RowMajor>>
+            J_pose(pose_jacobians_.data() + 2 * kPoseSize * i);
+        Eigen::Map<Eigen::Matrix<JacobianScalar, 2, 3, Eigen::RowMajor>>
+            J_point(point_jacobians_.data() + 2 * 3 * i);
+        Eigen::Map<Eigen::Matrix<JacobianScalar,
+                                 2,
+                                 CameraModel::num_params,
+                                 Eigen::RowMajor>>
+            J_camera(camera_jacobians_.data() + camera_jacobian_offsets_[i]);
+
+        const Eigen::Vector3d point3D_in_cam =
+            image_params.cam_from_world_rotation * point3D +
+            image_params.cam_from_world.translation;
+        if (!AnalyticImgFromCam<CameraModel>(
+                camera_params,
+                point3D_in_cam,
+                &xy,
+                jacobians ? &J_point_in_cam : nullptr,
+                jacobians ? &J_params : nullptr)) {
+          // Consistent with the cost functions, points behind the camera do
+          // not contribute to the problem.
+          if (jacobians) {
+            residual.setZero();
+            J_pose.setZero();
+            J_point.setZero();
+            J_camera.setZero();
+          }
+          continue;
+        }
+
+        const Eigen::Vector2d unweighted_residual(xy.x() - point2D_x_[i],
+                                                  xy.y() - point2D_y_[i]);
+        loss_function_->Evaluate(unweighted_residual.squaredNorm(), rho);
+        cost += 0.5 * rho[0];
+
+        if (jacobians) {
+          const double weight = std::sqrt(std::max(rho[1], 0.0));
+          residual = weight * unweighted_residual;
+          J_point_in_cam *= weight;
+          J_point = (J_point_in_cam * image_params.cam_from_world_rotation)
+                        .template cast<JacobianScalar>();
+          J_camera = (weight * J_params).template cast<JacobianScalar>();
+          if (image_params.frame_idx >= 0) {
+            const Eigen::Matrix<double, 2, 3> J_point_in_rig =
+                J_point_in_cam * image_params.sensor_from_rig_rotation;
+            J_pose.template leftCols<3>() =
+                (-J_point_in_rig *
+                 CrossProductMatrix(image_params.rig_from_world_rotation *
+                                    point3D))
+                    .template cast<JacobianScalar>();
+            J_pose.template rightCols<3>() =
+                J_point_in_rig.template cast<JacobianScalar>();
+          }
+        }
+      }
+      return cost;
+    } else {
+      LOG(FATAL_THROW) << "Camera model " << CameraModel::model_name
+                       << " not supported by the batched bundle adjuster";
+      return 0;
+    }
+  }
+
+  // Extracts the Jacobians of the active parameters of the camera system
+  // blocks of an observation.
+  void ObservationBlockJacobians(const size_t obs_idx,
+                                 int* block_idxs,
+                                 BlockJacobian* J_blocks) const {
+    const auto [frame_block_idx, camera_block_idx] =
+        ObservationBlockIdxs(obs_idx);
+    block_idxs[0] = frame_block_idx;
+    block_idxs[1] = camera_block_idx;
+    const JacobianScalar* J_local[2] = {
+        pose_jacobians_.data() + 2 * kPoseSize * obs_idx,
+        camera_jacobians_.data() + camera_jacobian_offsets_[obs_idx]};
+    const int local_size[2] = {
+        kPoseSize,
+        static_cast<int>(
+            cameras_[images_[image_idxs_[obs_idx]].camera_idx]
+                .camera->params.size())};
+    for (int k = 0; k < 2; ++k) {
+      if (block_idxs[k] < 0) {
+        continue;
+      }
+      const std::vector<int>& active = blocks_[block_idxs[k]].active;
+      J_blocks[k].resize(2, active.size());
+      for (size_t j = 0; j < active.size(); ++j) {
+        J_blocks[k](0, j) = J_local[k][active[j]];
+        J_blocks[k](1, j) = J_local[k][local_size[k] + active[j]];
+      }
+    }
+  }
+
+  // Computes the gradient of the cost and returns its maximum norm.
+  double ComputeGradient(ThreadPool* thread_pool) {
+    camera_gradient_.resize(num_camera_system_params_);
+    RunTasks(thread_pool,
+             blocks_.size(),
+             /*num_items_per_task=*/1,
+             [this](size_t /*task_idx*/, size_t block_idx, size_t /*end*/) {
+               auto gradient = camera_gradient_.segment(
+                   blocks_[block_idx].offset, blocks_[block_idx].active.size());
+               gradient.setZero();
+               int block_idxs[2];
+               BlockJacobian J_blocks[2];
+               for (size_t i = block_observation_offsets_[block_idx];
+                    i < block_observation_offsets_[block_idx + 1];
+                    ++i) {
+                 const size_t obs_idx = block_observation_idxs_[i];
+                 ObservationBlockJacobians(obs_idx, block_idxs, J_blocks);
+                 const int k =
+                     block_idxs[0] == static_cast<int>(block_idx) ? 0 : 1;
+                 gradient.noalias() += J_blocks[k].transpose() *
+                                       Eigen::Map<const Eigen::Vector2d>(
+                                           residuals_.data() + 2 * obs_idx);
+               }
+             });
+
+    std::vector<double> task_max_gradients(
+        NumTasks(points_.size(), kNumPointsPerTask), 0.0);
+    RunTasks(
+        thread_pool,
+        points_.size(),
+        kNumPointsPerTask,
+        [&](size_t task_idx, size_t begin, size_t end) {
+          for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+            const PointParams& point = points_[point_idx];
+            if (point.constant) {
+              continue;
+            }
+            Eigen::Vector3d& gradient = point_gradients_[point_idx];
+            gradient.setZero();
+            for (const size_t obs_idx : point.observation_idxs) {
+              gradient.noalias() += PointJacobian(obs_idx).transpose() *
+                                    Eigen::Map<const Eigen::Vector2d>(
+                                        residuals_.data() + 2 * obs_idx);
+            }
+            task_max_gradients[task_idx] = std::max(
+                task_max_gradients[task_idx], gradient.cwiseAbs().maxCoeff());
+          }
+        });
+
+    double max_gradient = camera_gradient_.size() > 0
+                              ? camera_gradient_.cwiseAbs().maxCoeff()
+                              : 0.0;
+    for (const double task_max_gradient : task_max_gradients) {
+      max_gradient = std::max(max_gradient, task_max_gradient);
+    }
+    return max_gradient;
+  }
+
+  Eigen::Matrix<double, 2, 3> PointJacobian(const size_t obs_idx) const {
+    return Eigen::Map<
+               const Eigen::Matrix<JacobianScalar, 2, 3, Eigen::RowMajor>>(
+               point_jacobians_.data() + 2 * 3 * obs_idx)
+        .template cast<double>();
+  }
+
+  // Returns the coupling J_block^T * J_point of the given entry.
+  Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3>> EntryMatrix(
+      const size_t entry_idx) {
+    return {entry_values_.data() + entry_value_offsets_[entry_idx],
+            static_cast<Eigen::Index>(
+                blocks_[entry_block_idxs_[entry_idx]].active.size()),
+            3};
+  }
+
+  // Builds and solves the Schur complement of the damped normal equations
+  // (J^T J + lambda D) x = -J^T r, where D is the clamped diagonal of J^T J.
+  // Returns false if the reduced camera system could not be solved.
+  bool SolveReducedSystem(const double lambda, ThreadPool* thread_pool) {
+    const ceres::Solver::Options& solver_options = options_.solver_options;
+    auto Damp = [&](auto& matrix) {
+      for (Eigen::Index j = 0; j < matrix.cols(); ++j) {
+        matrix(j, j) += lambda * std::clamp(matrix(j, j),
+                                            solver_options.min_lm_diagonal,
+                                            solver_options.max_lm_diagonal);
+      }
+    };
+
+    // Compute the inverse of the damped point Hessians and the couplings of
+    // the points with the camera system blocks.
+    std::vector<char> task_invertible(
+        NumTasks(points_.size(), kNumPointsPerTask), true);
+    RunTasks(
+        thread_pool,
+        points_.size(),
+        kNumPointsPerTask,
+        [&](size_t task_idx, size_t begin, size_t end) {
+          int block_idxs[2];
+          BlockJacobian J_blocks[2];
+          for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+            const PointParams& point = points_[point_idx];
+            if (point.constant) {
+              continue;
+            }
+
+            for (size_t entry_idx = point.entry_begin;
+                 entry_idx < point.entry_end;
+                 ++entry_idx) {
+              EntryMatrix(entry_idx).setZero();
+            }
+
+            Eigen::Matrix3d hessian = Eigen::Matrix3d::Zero();
+            for (const size_t obs_idx : point.observation_idxs) {
+              const Eigen::Matrix<double, 2, 3> J_point =
+                  PointJacobian(obs_idx);
+              hessian.noalias() += J_point.transpose() * J_point;
+              ObservationBlockJacobians(obs_idx, block_idxs, J_blocks);
+              for (int k = 0; k < 2; ++k) {
+                if (block_idxs[k] >= 0) {
+                  EntryMatrix(observation_entry_idxs_[2 * obs_idx + k])
+                      .noalias() +=
+                      J_blocks[k].transpose().lazyProduct(J_point);
+                }
+              }
+            }
+            Damp(hessian);
+
+            bool invertible = false;
+            hessian.computeInverseWithCheck(point_hessian_inverses_[point_idx],
+                                            invertible);
+            if (!invertible) {
+              task_invertible[task_idx] = false;
+              return;
+            }
+          }
+        });
+    if (std::find(task_invertible.begin(), task_invertible.end(), false) !=
+        task_invertible.end()) {
+      return false;
+    }
+
+    // Assemble the reduced camera system by block rows, which only update
+    // their own system blocks and can thus be assembled in parallel.
+    for (Eigen::MatrixXd& block : system_blocks_) {
+      block.setZero();
+    }
+    RunTasks(
+        thread_pool,
+        blocks_.size(),
+        /*num_items_per_task=*/1,
+        [&](size_t /*task_idx*/, size_t block_idx, size_t /*end*/) {
+          const ParameterBlock& block = blocks_[block_idx];
+
+          // Add the normal equations of the observations.
+          Eigen::MatrixXd& diagonal_block =
+              system_blocks_[block.system_block_idx];
+          int block_idxs[2];
+          BlockJacobian J_blocks[2];
+          for (size_t i = block_observation_offsets_[block_idx];
+               i < block_observation_offsets_[block_idx + 1];
+               ++i) {
+            const size_t obs_idx = block_observation_idxs_[i];
+            ObservationBlockJacobians(obs_idx, block_idxs, J_blocks);
+            const int k = block_idxs[0] == static_cast<int>(block_idx) ? 0 : 1;
+            diagonal_block.noalias() +=
+                J_blocks[k].transpose().lazyProduct(J_blocks[k]);
+            if (k == 0 && block_idxs[1] >= 0) {
+              system_blocks_[observation_system_block_idxs_[obs_idx]]
+                  .noalias() +=
+                  J_blocks[0].transpose().lazyProduct(J_blocks[1]);
+            }
+          }
+          Damp(diagonal_block);
+
+          // Eliminate the points from the normal equations.
+          auto rhs = camera_rhs_.segment(block.offset, block.active.size());
+          rhs = -camera_gradient_.segment(block.offset, block.active.size());
+          for (size_t i = block_entry_offsets_[block_idx];
+               i < block_entry_offsets_[block_idx + 1];
+               ++i) {
+            const size_t entry_idx = block_entry_idxs_[i];
+            const size_t point_idx = entry_point_idxs_[entry_idx];
+            const PointParams& point = points_[point_idx];
+            const BlockPointMatrix W_hessian_inverse =
+                EntryMatrix(entry_idx) * point_hessian_inverses_[point_idx];
+            rhs.noalias() += W_hessian_inverse * point_gradients_[point_idx];
+
+            // The entries of a point are ordered by their blocks, such that
+            // the couplings with the following entries lie in this block row.
+            const size_t num_entries = point.entry_end - point.entry_begin;
+            const size_t k = entry_idx - point.entry_begin;
+            const size_t* system_block_idxs =
+                point_system_block_idxs_.data() + point.system_block_offset +
+                k * num_entries - k * (k - 1) / 2;
+            for (size_t l = k; l < num_entries; ++l) {
+              system_blocks_[system_block_idxs[l - k]].noalias() -=
+                  W_hessian_inverse.lazyProduct(
+                      EntryMatrix(point.entry_begin + l).transpose());
+            }
+          }
+        });
+
+    // Solve the reduced camera system.
+    camera_step_.setZero(num_camera_system_params_);
+    if (num_camera_system_params_ > 0) {
+      std::vector<Eigen::Triplet<double>> triplets;
+      for (size_t i = 0; i < system_blocks_.size(); ++i) {
+        const auto [block_idx1, block_idx2] = system_block_pairs_[i];
+        const Eigen::MatrixXd& block = system_blocks_[i];
+        const int offset1 = blocks_[block_idx1].offset;
+        const int offset2 = blocks_[block_idx2].offset;
+        for (Eigen::Index c = 0; c < block.cols(); ++c) {
+          for (Eigen::Index r = 0; r < block.rows(); ++r) {
+            if (block_idx1 != block_idx2 || r <= c) {
+              triplets.emplace_back(offset1 + r, offset2 + c, block(r, c));
+            }
+          }
+        }
+      }
+      Eigen::SparseMatrix<double> reduced_system(num_camera_system_params_,
+                                                 num_camera_system_params_);
+      reduced_system.setFromTriplets(triplets.begin(), triplets.end());
+      const Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Upper>
+          solver(reduced_system);
+      if (solver.info() != Eigen::Success) {
+        return false;
+      }
+      camera_step_ = solver.solve(camera_rhs_);
+      if (!camera_step_.allFinite()) {
+        return false;
+      }
+    }
+
+    // Back-substitute the point updates.
+    point_step_.setZero(3 * points_.size());
+    RunTasks(thread_pool,
+             points_.size(),
+             kNumPointsPerTask,
+             [this](size_t /*task_idx*/, size_t begin, size_t end) {
+               for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+                 const PointParams& point = points_[point_idx];
+                 if (point.constant) {
+                   continue;
+                 }
+                 Eigen::Vector3d point_rhs = -point_gradients_[point_idx];
+                 for (const size_t obs_idx : point.observation_idxs) {
+                   point_rhs.noalias() -= PointJacobian(obs_idx).transpose() *
+                                          CameraStepResidual(obs_idx);
+                 }
+                 point_step_.segment<3>(3 * point_idx) =
+                     point_hessian_inverses_[point_idx] * point_rhs;
+               }
+             });
+
+    return point_step_.allFinite();
+  }
+
+  // Returns J_camera * camera_step for the given observation.
+  Eigen::Vector2d CameraStepResidual(const size_t obs_idx) const {
+    int block_idxs[2];
+    BlockJacobian J_blocks[2];
+    ObservationBlockJacobians(obs_idx, block_idxs, J_blocks);
+    Eigen::Vector2d step_residual = Eigen::Vector2d::Zero();
+    for (int k = 0; k < 2; ++k) {
+      if (block_idxs[k] >= 0) {
+        step_residual.noalias() +=
+            J_blocks[k] * camera_step_.segment(blocks_[block_idxs[k]].offset,
+                                               J_blocks[k].cols());
+      }
+    }
+    return step_residual;
+  }
+
+  // Returns the decrease of the linearized cost for the current step.
+  double ComputeModelCostChange(ThreadPool* thread_pool) const {
+    std::vector<double> task_step_costs(
+        NumTasks(num_observations_, kNumObservationsPerTask), 0.0);
+    RunTasks(thread_pool,
+             num_observations_,
+             kNumObservationsPerTask,
+             [&](size_t task_idx, size_t begin, size_t end) {
+               for (size_t i = begin; i < end; ++i) {
+                 Eigen::Vector2d step_residual = CameraStepResidual(i);
+                 if (!points_[point_idxs_[i]].constant) {
+                   step_residual.noalias() +=
+                       PointJacobian(i) *
+                       point_step_.segment<3>(
+                           3 * static_cast<size_t>(point_idxs_[i]));
+                 }
+                 task_step_costs[task_idx] += step_residual.squaredNorm();
+               }
+             });
+    double step_cost = 0;
+    for (const double task_step_cost : task_step_costs) {
+      step_cost += task_step_cost;
+    }
+    double gradient_dot_step = camera_gradient_.dot(camera_step_);
+    for (size_t point_idx = 0; point_idx < points_.size(); ++point_idx) {
+      if (!points_[point_idx].constant) {
+        gradient_dot_step += point_gradients_[point_idx].dot(
+            point_step_.segment<3>(3 * point_idx));
+      }
+    }
+    return -(gradient_dot_step + 0.5 * step_cost);
+  }
+
+  double ComputeParamsNorm() const {
+    double squared_norm = 0;
+    for (const FrameParams& frame : frames_) {
+      if (frame.block_idx >= 0) {
+        squared_norm += frame.rig_from_world->rotation.coeffs().squaredNorm() +
+                        frame.rig_from_world->translation.squaredNorm();
+      }
+    }
+    for (const CameraParams& camera : cameras_) {
+      if (camera.block_idx >= 0) {
+        for (const double param : camera.camera->params) {
+          squared_norm += param * param;
+        }
+      }
+    }
+    for (const PointParams& point : points_) {
+      if (!point.constant) {
+        squared_norm += point.xyz->squaredNorm();
+      }
+    }
+    return std::sqrt(squared_norm);
+  }
+
+  void ApplyStep() {
+    for (const FrameParams& frame : frames_) {
+      if (frame.block_idx < 0) {
+        continue;
+      }
+      const ParameterBlock& block = blocks_[frame.block_idx];
+      Eigen::Matrix<double, kPoseSize, 1> step =
+          Eigen::Matrix<double, kPoseSize, 1>::Zero();
+      for (size_t j = 0; j < block.active.size(); ++j) {
+        step(block.active[j]) = camera_step_(block.offset + j);
+      }
+      const Eigen::Vector3d rotation_step = step.head<3>();
+      const double angle = rotation_step.norm();
+      if (angle > 0) {
+        frame.rig_from_world->rotation =
+            Eigen::Quaterniond(
+                Eigen::AngleAxisd(angle, rotation_step / angle)) *
+            frame.rig_from_world->rotation;
+        frame.rig_from_world->rotation.normalize();
+      }
+      frame.rig_from_world->translation += step.tail<3>();
+    }
+    for (const CameraParams& camera : cameras_) {
+      if (camera.block_idx < 0) {
+        continue;
+      }
+      const ParameterBlock& block = blocks_[camera.block_idx];
+      for (size_t j = 0; j < block.active.size(); ++j) {
+        camera.camera->params[block.active[j]] +=
+            camera_step_(block.offset + j);
+      }
+    }
+    for (size_t point_idx = 0; point_idx < points_.size(); ++point_idx) {
+      if (!points_[point_idx].constant) {
+        *points_[point_idx].xyz += point_step_.segment<3>(3 * point_idx);
+      }
+    }
+  }
+
+  void BackupParams() {
+    frames_backup_.resize(frames_.size());
+    for (size_t i = 0; i < frames_.size(); ++i) {
+      frames_backup_[i] = *frames_[i].rig_from_world;
+    }
+    cameras_backup_.resize(cameras_.size());
+    for (size_t i = 0; i < cameras_.size(); ++i) {
+      cameras_backup_[i] = cameras_[i].camera->params;
+    }
+    points_backup_.resize(points_.size());
+    for (size_t i = 0; i < points_.size(); ++i) {
+      points_backup_[i] = *points_[i].xyz;
+    }
+  }
+
+  void RestoreParams() {
+    for (size_t i = 0; i < frames_.size(); ++i) {
+      *frames_[i].rig_from_world = frames_backup_[i];
+    }
+    for (size_t i = 0; i < cameras_.size(); ++i) {
+      cameras_[i].camera->params = cameras_backup_[i];
+    }
+    for (size_t i = 0; i < points_.size(); ++i) {
+      *points_[i].xyz = points_backup_[i];
+    }
+  }
+
+  std::unique_ptr<ceres::LossFunction> loss_function_;
+  std::shared_ptr<ceres::Problem> problem_;
+
+  std::vector<FrameParams> frames_;
+  std::vector<CameraParams> cameras_;
+  std::vector<ImageParams> images_;
+  std::vector<PointParams> points_;
+  size_t num_variable_points_ = 0;
+
+  // The observations in structure-of-arrays layout, ordered by batches.
+  size_t num_observations_ = 0;
+  std::vector<ObservationBatch> batches_;
+  std::vector<int> image_idxs_;
+  std::vector<int> point_idxs_;
+  std::vector<double> point2D_x_;
+  std::vector<double> point2D_y_;
+
+  // The weighted residuals and row-major Jacobians of all observations.
+  std::vector<double> residuals_;
+  std::vector<JacobianScalar> pose_jacobians_;
+  std::vector<JacobianScalar> point_jacobians_;
+  std::vector<JacobianScalar> camera_jacobians_;
+  std::vector<size_t> camera_jacobian_offsets_;
+
+  // The block-sparse reduced camera system.
+  std::vector<ParameterBlock> blocks_;
+  int num_camera_system_params_ = 0;
+  std::vector<Eigen::MatrixXd> system_blocks_;
+  std::vector<std::pair<int, int>> system_block_pairs_;
+  // The observations of each block in CSR layout and, for observations with
+  // a frame and a camera block, the index of their coupling system block.
+  std::vector<size_t> block_observation_offsets_;
+  std::vector<size_t> block_observation_idxs_;
+  std::vector<size_t> observation_system_block_idxs_;
+  // The entries of the variable points, i.e., their couplings with the
+  // distinct blocks of their observations, and the entry of each observation
+  // and its frame and camera block.
+  std::vector<int> entry_block_idxs_;
+  std::vector<size_t> entry_point_idxs_;
+  std::vector<size_t> entry_value_offsets_;
+  std::vector<double> entry_values_;
+  std::vector<size_t> observation_entry_idxs_;
+  std::vector<size_t> point_system_block_idxs_;
+  // The entries of each block in CSR layout.
+  std::vector<size_t> block_entry_offsets_;
+  std::vector<size_t> block_entry_idxs_;
+
+  Eigen::VectorXd camera_gradient_;
+  Eigen::VectorXd camera_rhs_;
+  Eigen::VectorXd camera_step_;
+  Eigen::VectorXd point_step_;
+  std::vector<Eigen::Vector3d> point_gradients_;
+  std::vector<Eigen::Matrix3d> point_hessian_inverses_;
+
+  std::vector<Rigid3d> frames_backup_;
+  std::vector<std::vector<double>> cameras_backup_;
+  std::vector<Eigen::Vector3d> points_backup_;
+};
+
+}  // namespace
+
+bool IsBatchedBundleAdjusterSupported(const BundleAdjustmentOptions& options,
+                                      const BundleAdjustmentConfig& config,
+                                      const Reconstruction& reconstruction) {
+  auto IsSupportedImage = [&](const Image& image) {
+    return IsAnalyticCameraModel(image.CameraPtr()->model_id);
+  };
+
+  for (const image_t image_id : config.Images()) {
+    const Image& image = reconstruction.Image(image_id);
+    if (!IsSupportedImage(image)) {
+      return false;
+    }
+    if (!image.HasTrivialFrame() && options.refine_sensor_from_rig &&
+        !config.HasConstantSensorFromRigPose(image.CameraPtr()->SensorId())) {
+      return false;
+    }
+  }
+
+  auto IsSupportedPoint = [&](const point3D_t point3D_id) {
+    for (const auto& track_el :
+         reconstruction.Point3D(point3D_id).track.Elements()) {
+      if (!IsSupportedImage(reconstruction.Image(track_el.image_id))) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  return std::all_of(config.VariablePoints().begin(),
+                     config.VariablePoints().end(),
+                     IsSupportedPoint) &&
+         std::all_of(config.ConstantPoints().begin(),
+                     config.ConstantPoints().end(),
+                     IsSupportedPoint);
+}
+
+std::unique_ptr<BundleAdjuster> CreateBatchedBundleAdjuster(
+    BundleAdjustmentOptions options,
+    BundleAdjustmentConfig config,
+    Reconstruction& reconstruction) {
+  THROW_CHECK(
+      IsBatchedBundleAdjusterSupported(options, config, reconstruction));
+  if (options.use_mixed_precision) {
+    return std::make_unique<BatchedBundleAdjuster<float>>(
+        std::move(options), std::move(config), reconstruction);
+  }
+  return std::make_unique<BatchedBundleAdjuster<double>>(
+      std::move(options), std::move(config), reconstruction);
+}
+
+}  // namespace colmap
@@ -0,0 +1,61 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/scene/reconstruction.h"
+
+#include <memory>
+
+namespace colmap {
+
+// Whether the batched bundle adjuster supports the given problem. This
+// requires camera models with analytic Jacobians (see AnalyticCameraModel) and
+// constant sensor_from_rig poses of all non-reference sensors.
+bool IsBatchedBundleAdjusterSupported(const BundleAdjustmentOptions& options,
+                                      const BundleAdjustmentConfig& config,
+                                      const Reconstruction& reconstruction);
+
+// Bundle adjuster that evaluates the reprojection residuals and Jacobians of
+// all observations in structure-of-arrays batches grouped by camera model,
+// instead of adding one Ceres residual block per observation. The normal
+// equations are solved by a dedicated Levenberg-Marquardt solver on the Schur
+// complement of the 3D points. The problem setup, i.e., which parameters are
+// refined and how the gauge is fixed, matches the default bundle adjuster.
+// The tolerances, trust region, and thread settings are taken from
+// BundleAdjustmentOptions::solver_options. With use_mixed_precision, the
+// Jacobians are stored in single precision. Since no Ceres problem is created,
+// Problem() returns null and EstimateBACovariance is not supported.
+std::unique_ptr<BundleAdjuster> CreateBatchedBundleAdjuster(
+    BundleAdjustmentOptions options,
+    BundleAdjustmentConfig config,
+    Reconstruction& reconstruction);
+
+}  // namespace colmap
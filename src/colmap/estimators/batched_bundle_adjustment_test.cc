@@ -0,0 +1,269 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/batched_bundle_adjustment.h"
+
+#include "colmap/geometry/rigid3_matchers.h"
+#include "colmap/scene/synthetic.h"
+#include "colmap/sensor/models.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+BundleAdjustmentOptions CreateOptions(const bool use_batched_solver) {
+  BundleAdjustmentOptions options;
+  options.use_batched_solver = use_batched_solver;
+  options.print_summary = false;
+  options.solver_options.gradient_tolerance = 1e-12;
+  options.solver_options.function_tolerance = 1e-14;
+  options.solver_options.max_num_iterations = 200;
+  return options;
+}
+
+// Solves the problem with the default and the batched bundle adjuster and
+// expects the same solution.
+void ExpectEqualSolutions(const Reconstruction& orig_reconstruction,
+                          const BundleAdjustmentConfig& config,
+                          BundleAdjustmentOptions options,
+                          const double eps) {
+  Reconstruction reconstruction = orig_reconstruction;
+  options.use_batched_solver = false;
+  const auto summary =
+      CreateDefaultBundleAdjuster(options, config, reconstruction)->Solve();
+  ASSERT_NE(summary.termination_type, ceres::FAILURE);
+
+  Reconstruction batched_reconstruction = orig_reconstruction;
+  options.use_batched_solver = true;
+  std::unique_ptr<BundleAdjuster> batched_bundle_adjuster =
+      CreateDefaultBundleAdjuster(options, config, batched_reconstruction);
+  EXPECT_EQ(batched_bundle_adjuster->Problem(), nullptr);
+  const auto batched_summary = batched_bundle_adjuster->Solve();
+  ASSERT_NE(batched_summary.termination_type, ceres::FAILURE);
+
+  EXPECT_EQ(batched_summary.num_residuals_reduced,
+            summary.num_residuals_reduced);
+  EXPECT_EQ(batched_summary.num_effective_parameters_reduced,
+            summary.num_effective_parameters_reduced);
+  EXPECT_NEAR(batched_summary.initial_cost, summary.initial_cost, 1e-6);
+  EXPECT_NEAR(batched_summary.final_cost,
+              summary.final_cost,
+              1e-6 * summary.final_cost);
+
+  for (const auto& [camera_id, camera] : reconstruction.Cameras()) {
+    const std::vector<double>& batched_params =
+        batched_reconstruction.Camera(camera_id).params;
+    for (size_t i = 0; i < camera.params.size(); ++i) {
+      EXPECT_NEAR(batched_params[i],
+                  camera.params[i],
+                  eps * std::max(1.0, std::abs(camera.params[i])));
+    }
+  }
+  for (const auto& [image_id, image] : reconstruction.Images()) {
+    EXPECT_THAT(batched_reconstruction.Image(image_id).CamFromWorld(),
+                Rigid3dNear(image.CamFromWorld(), eps, eps));
+  }
+  for (const auto& [point3D_id, point3D] : reconstruction.Points3D()) {
+    EXPECT_LT(
+        (batched_reconstruction.Point3D(point3D_id).xyz - point3D.xyz).norm(),
+        eps);
+  }
+}
+
+TEST(BatchedBundleAdjuster, TwoView) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 1;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(1);
+  config.AddImage(2);
+  config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  // The intrinsics are poorly constrained by two views, which leads to slow
+  // convergence along the ambiguous directions.
+  BundleAdjustmentOptions options = CreateOptions(/*use_batched_solver=*/true);
+  options.refine_focal_length = false;
+  options.refine_extra_params = false;
+  ExpectEqualSolutions(reconstruction, config, options, /*eps=*/1e-5);
+}
+
+TEST(BatchedBundleAdjuster, ManyViewThreePoints) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 5;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    config.AddImage(image_id);
+  }
+  config.FixGauge(BundleAdjustmentGauge::THREE_POINTS);
+
+  // Fix the gauge with the same points in both adjusters.
+  for (const auto& [point3D_id, _] : reconstruction.Points3D()) {
+    if (config.NumConstantPoints() < 3) {
+      config.AddConstantPoint(point3D_id);
+    }
+  }
+
+  BundleAdjustmentOptions options = CreateOptions(/*use_batched_solver=*/true);
+  ExpectEqualSolutions(reconstruction, config, options, /*eps=*/1e-5);
+
+  // Multi-threaded evaluation must give the same result.
+  options.min_num_residuals_for_cpu_multi_threading = 1;
+  options.solver_options.num_threads = 4;
+  ExpectEqualSolutions(reconstruction, config, options, /*eps=*/1e-5);
+}
+
+TEST(BatchedBundleAdjuster, RigWithConstantSensorFromRig) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 1;
+  synthetic_dataset_options.num_cameras_per_rig = 2;
+  synthetic_dataset_options.num_frames_per_rig = 3;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    config.AddImage(image_id);
+  }
+  config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  BundleAdjustmentOptions options = CreateOptions(/*use_batched_solver=*/true);
+  options.refine_sensor_from_rig = false;
+  ExpectEqualSolutions(reconstruction, config, options, /*eps=*/1e-5);
+}
+
+TEST(BatchedBundleAdjuster, PartiallyContainedTracksAndRobustLoss) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 3;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 1;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(1);
+  config.AddImage(2);
+  config.AddVariablePoint(1);
+  config.SetConstantRigFromWorldPose(reconstruction.Image(1).FrameId());
+  config.SetConstantCamIntrinsics(2);
+  config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  BundleAdjustmentOptions options = CreateOptions(/*use_batched_solver=*/true);
+  options.refine_principal_point = true;
+  options.loss_function_type =
+      BundleAdjustmentOptions::LossFunctionType::CAUCHY;
+  // The robust loss is minimized by reweighting, which converges more slowly
+  // than the corrected residuals in Ceres.
+  ExpectEqualSolutions(reconstruction, config, options, /*eps=*/1e-4);
+}
+
+TEST(BatchedBundleAdjuster, MixedPrecision) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 2;
+  synthetic_dataset_options.num_frames_per_rig = 5;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    config.AddImage(image_id);
+  }
+  config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  // Single precision Jacobians only perturb the steps, so that the solution
+  // converges to the same minimum up to the single precision accuracy.
+  BundleAdjustmentOptions options = CreateOptions(/*use_batched_solver=*/true);
+  options.refine_sensor_from_rig = false;
+  options.use_mixed_precision = true;
+  ExpectEqualSolutions(reconstruction, config, options, /*eps=*/1e-4);
+
+  options.loss_function_type =
+      BundleAdjustmentOptions::LossFunctionType::CAUCHY;
+  ExpectEqualSolutions(reconstruction, config, options, /*eps=*/1e-4);
+}
+
+TEST(BatchedBundleAdjuster, Supported) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 1;
+  synthetic_dataset_options.num_cameras_per_rig = 2;
+  synthetic_dataset_options.num_frames_per_rig = 2;
+  synthetic_dataset_options.num_points3D = 50;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    config.AddImage(image_id);
+  }
+
+  BundleAdjustmentOptions options = CreateOptions(/*use_batched_solver=*/true);
+  EXPECT_FALSE(
+      IsBatchedBundleAdjusterSupported(options, config, reconstruction));
+  EXPECT_NE(CreateDefaultBundleAdjuster(options, config, reconstruction)
+                ->Problem(),
+            nullptr);
+
+  options.refine_sensor_from_rig = false;
+  EXPECT_TRUE(
+      IsBatchedBundleAdjusterSupported(options, config, reconstruction));
+  EXPECT_EQ(CreateDefaultBundleAdjuster(options, config, reconstruction)
+                ->Problem(),
+            nullptr);
+
+  Camera& camera = reconstruction.Camera(1);
+  camera.model_id = FOVCameraModel::model_id;
+  camera.params = FOVCameraModel::InitializeParams(1280, 1024, 768);
+  EXPECT_FALSE(
+      IsBatchedBundleAdjusterSupported(options, config, reconstruction));
+  EXPECT_THROW(CreateBatchedBundleAdjuster(options, config, reconstruction),
+               std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace colmap
@@ -30,13 +30,18 @@
 #include "colmap/estimators/bundle_adjustment.h"
 
 #include "colmap/estimators/alignment.h"
+#include "colmap/estimators/batched_bundle_adjustment.h"
 #include "colmap/estimators/cost_functions.h"
 #include "colmap/estimators/manifold.h"
 #include "colmap/util/cuda.h"
+#include "colmap/util/file.h"
 #include "colmap/util/misc.h"
 #include "colmap/util/threading.h"
 
+#include <fstream>
 #include <iomanip>
+#include <mutex>
+#include <sstream>
 
 namespace colmap {
 
@@ -78,12 +83,25 @@ size_t BundleAdjustmentConfig::NumConstantPoints() const {
   return constant_point3D_ids_.size();
 }
 
+size_t BundleAdjustmentConfig::NumIgnoredPoints() const {
+  return ignored_point3D_ids_.size();
+}
+
 size_t BundleAdjustmentConfig::NumResiduals(
     const Reconstruction& reconstruction) const {
   // Count the number of observations for all added images.
   size_t num_observations = 0;
   for (const image_t image_id : image_ids_) {
-    num_observations += reconstruction.Image(image_id).NumPoints3D();
+    const Image& image = reconstruction.Image(image_id);
+    if (ignored_point3D_ids_.empty()) {
+      num_observations += image.NumPoints3D();
+      continue;
+    }
+    for (const Point2D& point2D : image.Points2D()) {
+      if (point2D.HasPoint3D() && !HasIgnoredPoint(point2D.point3D_id)) {
+        ++num_observations;
+      }
+    }
   }
 
   // Count the number of observations for all added 3D points that are not
@@ -185,6 +203,11 @@ const std::unordered_set<point3D_t>& BundleAdjustmentConfig::ConstantPoints()
   return constant_point3D_ids_;
 }
 
+const std::unordered_set<point3D_t>& BundleAdjustmentConfig::IgnoredPoints()
+    const {
+  return ignored_point3D_ids_;
+}
+
 const std::unordered_set<camera_t>
 BundleAdjustmentConfig::ConstantCamIntrinsics() const {
   return constant_cam_intrinsics_;
@@ -202,11 +225,13 @@ BundleAdjustmentConfig::ConstantRigFromWorldPoses() const {
 
 void BundleAdjustmentConfig::AddVariablePoint(const point3D_t point3D_id) {
   THROW_CHECK(!HasConstantPoint(point3D_id));
+  THROW_CHECK(!HasIgnoredPoint(point3D_id));
   variable_point3D_ids_.insert(point3D_id);
 }
 
 void BundleAdjustmentConfig::AddConstantPoint(const point3D_t point3D_id) {
   THROW_CHECK(!HasVariablePoint(point3D_id));
+  THROW_CHECK(!HasIgnoredPoint(point3D_id));
   constant_point3D_ids_.insert(point3D_id);
 }
 
@@ -232,18 +257,111 @@ void BundleAdjustmentConfig::RemoveConstantPoint(const point3D_t point3D_id) {
   constant_point3D_ids_.erase(point3D_id);
 }
 
+void BundleAdjustmentConfig::IgnorePoint(const point3D_t point3D_id) {
+  THROW_CHECK(!HasPoint(point3D_id));
+  ignored_point3D_ids_.insert(point3D_id);
+}
+
+bool BundleAdjustmentConfig::HasIgnoredPoint(const point3D_t point3D_id) const {
+  return ignored_point3D_ids_.find(point3D_id) != ignored_point3D_ids_.end();
+}
+
+void BundleAdjustmentConfig::RemoveIgnoredPoint(const point3D_t point3D_id) {
+  ignored_point3D_ids_.erase(point3D_id);
+}
+
 BundleAdjuster::BundleAdjuster(BundleAdjustmentOptions options,
                                BundleAdjustmentConfig config)
     : options_(std::move(options)), config_(std::move(config)) {
   THROW_CHECK(options_.Check());
 }
 
+bool BundleAdjuster::Update(BundleAdjustmentOptions /*options*/,
+                            BundleAdjustmentConfig /*config*/,
+                            Reconstruction& /*reconstruction*/) {
+  return false;
+}
+
 const BundleAdjustmentOptions& BundleAdjuster::Options() const {
   return options_;
 }
 
 const BundleAdjustmentConfig& BundleAdjuster::Config() const { return config_; }
 
+////////////////////////////////////////////////////////////////////////////////
+// BundleAdjustmentSolverProfile
+////////////////////////////////////////////////////////////////////////////////
+
+bool BundleAdjustmentSolverProfile::Check() const {
+  CHECK_OPTION_GE(max_num_images_direct_dense_cpu_solver, 0);
+  CHECK_OPTION_LT(max_num_images_direct_dense_cpu_solver,
+                  max_num_images_direct_sparse_cpu_solver);
+  CHECK_OPTION_GE(min_num_residuals_for_cpu_multi_threading, 0);
+  return true;
+}
+
+BundleAdjustmentSolverProfile ReadBundleAdjustmentSolverProfile(
+    const std::string& path) {
+  BundleAdjustmentSolverProfile profile;
+  for (const std::string& line : ReadTextFileLines(path)) {
+    if (line[0] == '#') {
+      continue;
+    }
+
+    std::stringstream line_stream(line);
+    std::string key;
+    int value = 0;
+    line_stream >> key >> value;
+    THROW_CHECK(!line_stream.fail())
+        << "Invalid line in solver profile " << path << ": " << line;
+
+    if (key == "max_num_images_direct_dense_cpu_solver") {
+      profile.max_num_images_direct_dense_cpu_solver = value;
+    } else if (key == "max_num_images_direct_sparse_cpu_solver") {
+      profile.max_num_images_direct_sparse_cpu_solver = value;
+    } else if (key == "min_num_residuals_for_cpu_multi_threading") {
+      profile.min_num_residuals_for_cpu_multi_threading = value;
+    } else {
+      LOG(FATAL_THROW) << "Unknown key in solver profile " << path << ": "
+                       << key;
+    }
+  }
+  THROW_CHECK(profile.Check()) << "Invalid solver profile " << path;
+  return profile;
+}
+
+void WriteBundleAdjustmentSolverProfile(
+    const std::string& path, const BundleAdjustmentSolverProfile& profile) {
+  std::ofstream file(path, std::ios::trunc);
+  THROW_CHECK_FILE_OPEN(file, path);
+  file << "# Bundle adjustment solver profile\n";
+  file << "max_num_images_direct_dense_cpu_solver "
+       << profile.max_num_images_direct_dense_cpu_solver << "\n";
+  file << "max_num_images_direct_sparse_cpu_solver "
+       << profile.max_num_images_direct_sparse_cpu_solver << "\n";
+  file << "min_num_residuals_for_cpu_multi_threading "
+       << profile.min_num_residuals_for_cpu_multi_threading << "\n";
+}
+
+namespace {
+
+// Solver profiles are consulted for every solve, so they are only read once
+// per process and path.
+BundleAdjustmentSolverProfile GetCachedBundleAdjustmentSolverProfile(
+    const std::string& path) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, BundleAdjustmentSolverProfile>
+      profiles;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = profiles.find(path);
+  if (it == profiles.end()) {
+    it = profiles.emplace(path, ReadBundleAdjustmentSolverProfile(path)).first;
+  }
+  return it->second;
+}
+
+}  // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 // BundleAdjustmentOptions
 ////////////////////////////////////////////////////////////////////////////////
@@ -283,6 +401,18 @@ ceres::Solver::Options BundleAdjustmentOptions::CreateSolverOptions(
       max_num_images_direct_dense_cpu_solver;
   int max_num_images_direct_sparse_solver =
       max_num_images_direct_sparse_cpu_solver;
+  int min_num_residuals_for_multi_threading =
+      min_num_residuals_for_cpu_multi_threading;
+  if (!solver_profile_path.empty()) {
+    const BundleAdjustmentSolverProfile profile =
+        GetCachedBundleAdjustmentSolverProfile(solver_profile_path);
+    max_num_images_direct_dense_solver =
+        profile.max_num_images_direct_dense_cpu_solver;
+    max_num_images_direct_sparse_solver =
+        profile.max_num_images_direct_sparse_cpu_solver;
+    min_num_residuals_for_multi_threading =
+        profile.min_num_residuals_for_cpu_multi_threading;
+  }
 
 #ifdef COLMAP_CUDA_ENABLED
   bool cuda_solver_enabled = false;
@@ -346,7 +476,7 @@ ceres::Solver::Options BundleAdjustmentOptions::CreateSolverOptions(
     custom_solver_options.preconditioner_type = ceres::SCHUR_JACOBI;
   }
 
-  if (problem.NumResiduals() < min_num_residuals_for_cpu_multi_threading) {
+  if (problem.NumResiduals() < min_num_residuals_for_multi_threading) {
     custom_solver_options.num_threads = 1;
 #if CERES_VERSION_MAJOR < 2
     custom_solver_options.num_linear_solver_threads = 1;
@@ -659,53 +789,15 @@ class DefaultBundleAdjuster : public BundleAdjuster {
                         BundleAdjustmentConfig config,
                         Reconstruction& reconstruction)
       : BundleAdjuster(std::move(options), std::move(config)),
-        loss_function_(std::unique_ptr<ceres::LossFunction>(
-            options_.CreateLossFunction())) {
+        loss_function_(options_.CreateLossFunction(), ceres::TAKE_OWNERSHIP) {
     ceres::Problem::Options problem_options;
     problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    // Updating the problem in place removes residual blocks one by one, which
+    // otherwise requires a scan over the entire problem for each removal.
+    problem_options.enable_fast_removal = options_.reuse_problem;
     problem_ = std::make_shared<ceres::Problem>(problem_options);
 
-    // Set up problem
-    // Warning: AddPointsToProblem assumes that AddImageToProblem is called
-    // first. Do not change order of instructions!
-    for (const image_t image_id : config_.Images()) {
-      AddImageToProblem(image_id, reconstruction);
-    }
-    for (const auto point3D_id : config_.VariablePoints()) {
-      AddPointToProblem(point3D_id, reconstruction);
-    }
-    for (const auto point3D_id : config_.ConstantPoints()) {
-      AddPointToProblem(point3D_id, reconstruction);
-    }
-
-    ParameterizeCameras(options_,
-                        config_,
-                        parameterized_camera_ids_,
-                        reconstruction,
-                        *problem_);
-    ParameterizeImages(
-        options_, config_, parameterized_image_ids_, reconstruction, *problem_);
-    ParameterizePoints(
-        config_, point3D_num_observations_, reconstruction, *problem_);
-
-    switch (config_.FixedGauge()) {
-      case BundleAdjustmentGauge::UNSPECIFIED:
-        break;
-      case BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD:
-        FixGaugeWithTwoCamsFromWorld(options_,
-                                     config_,
-                                     parameterized_image_ids_,
-                                     point3D_num_observations_,
-                                     reconstruction,
-                                     *problem_);
-        break;
-      case BundleAdjustmentGauge::THREE_POINTS:
-        FixGaugeWithThreePoints(
-            point3D_num_observations_, reconstruction, *problem_);
-        break;
-      default:
-        LOG(FATAL) << "Unknown BundleAdjustmentGauge";
-    }
+    SetUpProblem(reconstruction);
   }
 
   ceres::Solver::Summary Solve() override {
@@ -726,6 +818,32 @@ class DefaultBundleAdjuster : public BundleAdjuster {
     return summary;
   }
 
+  bool Update(BundleAdjustmentOptions options,
+              BundleAdjustmentConfig config,
+              Reconstruction& reconstruction) override {
+#if CERES_VERSION_MAJOR >= 3 || \
+    (CERES_VERSION_MAJOR == 2 && CERES_VERSION_MINOR >= 1)
+    if (!options_.reuse_problem || !options.reuse_problem) {
+      return false;
+    }
+
+    THROW_CHECK(options.Check());
+    options_ = std::move(options);
+    config_ = std::move(config);
+    loss_function_.Reset(options_.CreateLossFunction(), ceres::TAKE_OWNERSHIP);
+
+    RemoveDeletedPoints(reconstruction);
+    ResetParameterization();
+    SetUpProblem(reconstruction);
+
+    return true;
+#else
+    // Older Ceres versions cannot reset the parameterization of parameter
+    // blocks, so the problem must be set up from scratch.
+    return false;
+#endif
+  }
+
   std::shared_ptr<ceres::Problem>& Problem() override { return problem_; }
 
   void AddImageToProblem(const image_t image_id,
@@ -751,8 +869,11 @@ class DefaultBundleAdjuster : public BundleAdjuster {
 
     // Add residuals to bundle adjustment problem.
     size_t num_observations = 0;
-    for (const Point2D& point2D : image.Points2D()) {
-      if (!point2D.HasPoint3D()) {
+    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+         ++point2D_idx) {
+      const Point2D& point2D = image.Point2D(point2D_idx);
+      if (!point2D.HasPoint3D() ||
+          config_.HasIgnoredPoint(point2D.point3D_id)) {
         continue;
       }
 
@@ -763,21 +884,39 @@ class DefaultBundleAdjuster : public BundleAdjuster {
       THROW_CHECK_GT(point3D.track.Length(), 1);
 
       if (constant_cam_from_world) {
-        problem_->AddResidualBlock(
-            CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
-                camera.model_id, point2D.xy, cam_from_world),
-            loss_function_.get(),
+        AddResidualBlock(
+            image.ImageId(),
+            point2D_idx,
+            point2D.point3D_id,
             point3D.xyz.data(),
-            camera.params.data());
+            ResidualType::CONSTANT_POSE,
+            cam_from_world,
+            [&]() {
+              return problem_->AddResidualBlock(
+                  CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
+                      camera.model_id, point2D.xy, cam_from_world),
+                  &loss_function_,
+                  point3D.xyz.data(),
+                  camera.params.data());
+            });
       } else {
-        problem_->AddResidualBlock(
-            CreateCameraCostFunction<ReprojErrorCostFunctor>(camera.model_id,
-                                                             point2D.xy),
-            loss_function_.get(),
-            cam_from_world.rotation.coeffs().data(),
-            cam_from_world.translation.data(),
+        AddResidualBlock(
+            image.ImageId(),
+            point2D_idx,
+            point2D.point3D_id,
             point3D.xyz.data(),
-            camera.params.data());
+            ResidualType::VARIABLE_POSE,
+            cam_from_world,
+            [&]() {
+              return problem_->AddResidualBlock(
+                  CreateCameraCostFunction<ReprojErrorCostFunctor>(
+                      camera.model_id, point2D.xy),
+                  &loss_function_,
+                  cam_from_world.rotation.coeffs().data(),
+                  cam_from_world.translation.data(),
+                  point3D.xyz.data(),
+                  camera.params.data());
+            });
       }
     }
 
@@ -806,8 +945,11 @@ class DefaultBundleAdjuster : public BundleAdjuster {
 
     // Add residuals to bundle adjustment problem.
     size_t num_observations = 0;
-    for (const Point2D& point2D : image.Points2D()) {
-      if (!point2D.HasPoint3D()) {
+    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+         ++point2D_idx) {
+      const Point2D& point2D = image.Point2D(point2D_idx);
+      if (!point2D.HasPoint3D() ||
+          config_.HasIgnoredPoint(point2D.point3D_id)) {
         continue;
       }
 
@@ -820,32 +962,61 @@ class DefaultBundleAdjuster : public BundleAdjuster {
       // The !constant_sensor_from_rig && constant_rig_from_world is
       // rare enough that we do not have a specialized cost function for it.
       if (constant_sensor_from_rig && constant_rig_from_world) {
-        problem_->AddResidualBlock(
-            CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
-                camera.model_id, point2D.xy, cam_from_rig * rig_from_world),
-            loss_function_.get(),
+        const Rigid3d cam_from_world = cam_from_rig * rig_from_world;
+        AddResidualBlock(
+            image.ImageId(),
+            point2D_idx,
+            point2D.point3D_id,
             point3D.xyz.data(),
-            camera.params.data());
+            ResidualType::CONSTANT_POSE,
+            cam_from_world,
+            [&]() {
+              return problem_->AddResidualBlock(
+                  CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
+                      camera.model_id, point2D.xy, cam_from_world),
+                  &loss_function_,
+                  point3D.xyz.data(),
+                  camera.params.data());
+            });
       } else if (!constant_rig_from_world && constant_sensor_from_rig) {
-        problem_->AddResidualBlock(
-            CreateCameraCostFunction<RigReprojErrorConstantRigCostFunctor>(
-                camera.model_id, point2D.xy, cam_from_rig),
-            loss_function_.get(),
-            rig_from_world.rotation.coeffs().data(),
-            rig_from_world.translation.data(),
+        AddResidualBlock(
+            image.ImageId(),
+            point2D_idx,
+            point2D.point3D_id,
             point3D.xyz.data(),
-            camera.params.data());
+            ResidualType::CONSTANT_SENSOR_FROM_RIG,
+            cam_from_rig,
+            [&]() {
+              return problem_->AddResidualBlock(
+                  CreateCameraCostFunction<
+                      RigReprojErrorConstantRigCostFunctor>(
+                      camera.model_id, point2D.xy, cam_from_rig),
+                  &loss_function_,
+                  rig_from_world.rotation.coeffs().data(),
+                  rig_from_world.translation.data(),
+                  point3D.xyz.data(),
+                  camera.params.data());
+            });
       } else {
-        problem_->AddResidualBlock(
-            CreateCameraCostFunction<RigReprojErrorCostFunctor>(camera.model_id,
-                                                                point2D.xy),
-            loss_function_.get(),
-            cam_from_rig.rotation.coeffs().data(),
-            cam_from_rig.translation.data(),
-            rig_from_world.rotation.coeffs().data(),
-            rig_from_world.translation.data(),
+        AddResidualBlock(
+            image.ImageId(),
+            point2D_idx,
+            point2D.point3D_id,
             point3D.xyz.data(),
-            camera.params.data());
+            ResidualType::VARIABLE_RIG_POSE,
+            cam_from_rig,
+            [&]() {
+              return problem_->AddResidualBlock(
+                  CreateCameraCostFunction<RigReprojErrorCostFunctor>(
+                      camera.model_id, point2D.xy),
+                  &loss_function_,
+                  cam_from_rig.rotation.coeffs().data(),
+                  cam_from_rig.translation.data(),
+                  rig_from_world.rotation.coeffs().data(),
+                  rig_from_world.translation.data(),
+                  point3D.xyz.data(),
+                  camera.params.data());
+            });
       }
     }
 
@@ -880,28 +1051,31 @@ class DefaultBundleAdjuster : public BundleAdjuster {
       Camera& camera = *image.CameraPtr();
       const Point2D& point2D = image.Point2D(track_el.point2D_idx);
 
+      Rigid3d cam_from_world;
       if (image.HasTrivialFrame()) {
-        Rigid3d& cam_from_world = image.FramePtr()->RigFromWorld();
-
-        problem_->AddResidualBlock(
-            CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
-                camera.model_id, point2D.xy, cam_from_world),
-            loss_function_.get(),
-            point3D.xyz.data(),
-            camera.params.data());
+        cam_from_world = image.FramePtr()->RigFromWorld();
       } else {
-        Rigid3d& cam_from_rig = image.FramePtr()->RigPtr()->SensorFromRig(
-            image.CameraPtr()->SensorId());
-        Rigid3d& rig_from_world = image.FramePtr()->RigFromWorld();
-
-        problem_->AddResidualBlock(
-            CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
-                camera.model_id, point2D.xy, cam_from_rig * rig_from_world),
-            loss_function_.get(),
-            point3D.xyz.data(),
-            camera.params.data());
+        cam_from_world = image.FramePtr()->RigPtr()->SensorFromRig(
+                             image.CameraPtr()->SensorId()) *
+                         image.FramePtr()->RigFromWorld();
       }
 
+      AddResidualBlock(
+          track_el.image_id,
+          track_el.point2D_idx,
+          point3D_id,
+          point3D.xyz.data(),
+          ResidualType::CONSTANT_POSE,
+          cam_from_world,
+          [&]() {
+            return problem_->AddResidualBlock(
+                CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
+                    camera.model_id, point2D.xy, cam_from_world),
+                &loss_function_,
+                point3D.xyz.data(),
+                camera.params.data());
+          });
+
       // Do not optimize intrinsics if th corresponding images
       // were not included explicitly in the config.
       if (parameterized_camera_ids_.insert(image.CameraId()).second) {
@@ -911,12 +1085,185 @@ class DefaultBundleAdjuster : public BundleAdjuster {
   }
 
  private:
+  // The type of cost function used for an observation. Cost functions with
+  // constant poses store the pose internally, so their residual blocks can
+  // only be reused as long as the pose does not change.
+  enum class ResidualType {
+    VARIABLE_POSE,
+    CONSTANT_POSE,
+    VARIABLE_RIG_POSE,
+    CONSTANT_SENSOR_FROM_RIG,
+  };
+
+  struct ObservationResidual {
+    ceres::ResidualBlockId residual_block_id = nullptr;
+    point3D_t point3D_id = kInvalidPoint3DId;
+    ResidualType type = ResidualType::VARIABLE_POSE;
+    // The constant pose embedded in the cost function, if any.
+    Rigid3d const_pose;
+    // The problem setup in which the residual block was last used.
+    size_t setup_idx = 0;
+  };
+
+  static uint64_t ObservationKey(const image_t image_id,
+                                 const point2D_t point2D_idx) {
+    return (static_cast<uint64_t>(image_id) << 32) |
+           static_cast<uint64_t>(point2D_idx);
+  }
+
+  static bool HasConstPose(const ResidualType type) {
+    return type == ResidualType::CONSTANT_POSE ||
+           type == ResidualType::CONSTANT_SENSOR_FROM_RIG;
+  }
+
+  void SetUpProblem(Reconstruction& reconstruction) {
+    ++setup_idx_;
+    parameterized_camera_ids_.clear();
+    parameterized_image_ids_.clear();
+    point3D_num_observations_.clear();
+
+    // Warning: AddPointsToProblem assumes that AddImageToProblem is called
+    // first. Do not change order of instructions!
+    for (const image_t image_id : config_.Images()) {
+      AddImageToProblem(image_id, reconstruction);
+    }
+    for (const auto point3D_id : config_.VariablePoints()) {
+      AddPointToProblem(point3D_id, reconstruction);
+    }
+    for (const auto point3D_id : config_.ConstantPoints()) {
+      AddPointToProblem(point3D_id, reconstruction);
+    }
+
+    if (options_.reuse_problem) {
+      RemoveUnusedResidualBlocks();
+    }
+
+    ParameterizeCameras(options_,
+                        config_,
+                        parameterized_camera_ids_,
+                        reconstruction,
+                        *problem_);
+    ParameterizeImages(
+        options_, config_, parameterized_image_ids_, reconstruction, *problem_);
+    ParameterizePoints(
+        config_, point3D_num_observations_, reconstruction, *problem_);
+
+    switch (config_.FixedGauge()) {
+      case BundleAdjustmentGauge::UNSPECIFIED:
+        break;
+      case BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD:
+        FixGaugeWithTwoCamsFromWorld(options_,
+                                     config_,
+                                     parameterized_image_ids_,
+                                     point3D_num_observations_,
+                                     reconstruction,
+                                     *problem_);
+        break;
+      case BundleAdjustmentGauge::THREE_POINTS:
+        FixGaugeWithThreePoints(
+            point3D_num_observations_, reconstruction, *problem_);
+        break;
+      default:
+        LOG(FATAL) << "Unknown BundleAdjustmentGauge";
+    }
+  }
+
+  // Adds the residual block for an observation or, if the problem is reused,
+  // keeps the residual block from the previous setup if it is still valid.
+  template <typename AddResidualBlockFunc>
+  void AddResidualBlock(const image_t image_id,
+                        const point2D_t point2D_idx,
+                        const point3D_t point3D_id,
+                        double* point3D_xyz,
+                        const ResidualType type,
+                        const Rigid3d& const_pose,
+                        AddResidualBlockFunc add_residual_block) {
+    if (!options_.reuse_problem) {
+      add_residual_block();
+      return;
+    }
+
+    ObservationResidual& residual =
+        residuals_[ObservationKey(image_id, point2D_idx)];
+    if (residual.residual_block_id != nullptr) {
+      if (residual.point3D_id == point3D_id && residual.type == type &&
+          (!HasConstPose(type) || residual.const_pose == const_pose)) {
+        residual.setup_idx = setup_idx_;
+        return;
+      }
+      problem_->RemoveResidualBlock(residual.residual_block_id);
+    }
+
+    residual.residual_block_id = add_residual_block();
+    residual.point3D_id = point3D_id;
+    residual.type = type;
+    if (HasConstPose(type)) {
+      residual.const_pose = const_pose;
+    }
+    residual.setup_idx = setup_idx_;
+    point_params_.emplace(point3D_id, point3D_xyz);
+  }
+
+  // Removes the residual blocks of observations that are no longer part of the
+  // problem after an update.
+  void RemoveUnusedResidualBlocks() {
+    for (auto it = residuals_.begin(); it != residuals_.end();) {
+      if (it->second.setup_idx != setup_idx_) {
+        problem_->RemoveResidualBlock(it->second.residual_block_id);
+        it = residuals_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Removes the parameter blocks of deleted 3D points together with their
+  // residual blocks. This must happen before adding any new residual blocks,
+  // because new points may be allocated at the memory of deleted points.
+  void RemoveDeletedPoints(const Reconstruction& reconstruction) {
+    for (auto it = residuals_.begin(); it != residuals_.end();) {
+      if (!reconstruction.ExistsPoint3D(it->second.point3D_id)) {
+        it = residuals_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (auto it = point_params_.begin(); it != point_params_.end();) {
+      if (!reconstruction.ExistsPoint3D(it->first)) {
+        problem_->RemoveParameterBlock(it->second);
+        it = point_params_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Resets all parameter blocks to variable and without manifold, such that
+  // the parameterization can be set up for the updated configuration.
+  void ResetParameterization() {
+    std::vector<double*> parameter_blocks;
+    problem_->GetParameterBlocks(&parameter_blocks);
+    for (double* parameter_block : parameter_blocks) {
+      problem_->SetParameterBlockVariable(parameter_block);
+#if CERES_VERSION_MAJOR >= 3 || \
+    (CERES_VERSION_MAJOR == 2 && CERES_VERSION_MINOR >= 1)
+      problem_->SetManifold(parameter_block, nullptr);
+#endif
+    }
+  }
+
   std::shared_ptr<ceres::Problem> problem_;
-  std::unique_ptr<ceres::LossFunction> loss_function_;
+  ceres::LossFunctionWrapper loss_function_;
 
   std::set<camera_t> parameterized_camera_ids_;
   std::set<image_t> parameterized_image_ids_;
   std::unordered_map<point3D_t, size_t> point3D_num_observations_;
+
+  // Bookkeeping of residual and parameter blocks to update the problem in
+  // place. Only populated if the problem is reused.
+  size_t setup_idx_ = 0;
+  std::unordered_map<uint64_t, ObservationResidual> residuals_;
+  std::unordered_map<point3D_t, double*> point_params_;
 };
 
 class PosePriorBundleAdjuster : public BundleAdjuster {
@@ -1104,6 +1451,15 @@ std::unique_ptr<BundleAdjuster> CreateDefaultBundleAdjuster(
     BundleAdjustmentOptions options,
     BundleAdjustmentConfig config,
     Reconstruction& reconstruction) {
+  if (options.use_batched_solver) {
+    if (IsBatchedBundleAdjusterSupported(options, config, reconstruction)) {
+      return CreateBatchedBundleAdjuster(
+          std::move(options), std::move(config), reconstruction);
+    }
+    LOG_FIRST_N(WARNING, 1)
+        << "Batched bundle adjustment not supported for the given problem. "
+           "Falling back to the default bundle adjuster.";
+  }
   return std::make_unique<DefaultBundleAdjuster>(
       std::move(options), std::move(config), reconstruction);
 }
@@ -58,6 +58,7 @@ class BundleAdjustmentConfig {
   size_t NumPoints() const;
   size_t NumVariablePoints() const;
   size_t NumConstantPoints() const;
+  size_t NumIgnoredPoints() const;
 
   size_t NumConstantCamIntrinsics() const;
 
@@ -101,10 +102,18 @@ class BundleAdjustmentConfig {
   void RemoveVariablePoint(point3D_t point3D_id);
   void RemoveConstantPoint(point3D_t point3D_id);
 
+  // Ignore all observations of a point in the added images, e.g., to solve
+  // for the poses on a subset of the tracks. Ignored points can neither be
+  // variable nor constant.
+  void IgnorePoint(point3D_t point3D_id);
+  bool HasIgnoredPoint(point3D_t point3D_id) const;
+  void RemoveIgnoredPoint(point3D_t point3D_id);
+
   // Access configuration data.
   const std::unordered_set<image_t>& Images() const;
   const std::unordered_set<point3D_t>& VariablePoints() const;
   const std::unordered_set<point3D_t>& ConstantPoints() const;
+  const std::unordered_set<point3D_t>& IgnoredPoints() const;
   const std::unordered_set<camera_t> ConstantCamIntrinsics() const;
   const std::unordered_set<sensor_t>& ConstantSensorFromRigPoses() const;
   const std::unordered_set<frame_t>& ConstantRigFromWorldPoses() const;
@@ -115,10 +124,30 @@ class BundleAdjustmentConfig {
   std::unordered_set<image_t> image_ids_;
   std::unordered_set<point3D_t> variable_point3D_ids_;
   std::unordered_set<point3D_t> constant_point3D_ids_;
+  std::unordered_set<point3D_t> ignored_point3D_ids_;
   std::unordered_set<sensor_t> constant_sensor_from_rig_poses_;
   std::unordered_set<frame_t> constant_rig_from_world_poses_;
 };
 
+// Host-specific thresholds for the selection of the linear solver and the
+// threading in BundleAdjustmentOptions::CreateSolverOptions, e.g., as measured
+// by CalibrateBundleAdjustmentSolverProfile. The fields have the same meaning
+// as the corresponding CPU options in BundleAdjustmentOptions.
+struct BundleAdjustmentSolverProfile {
+  int max_num_images_direct_dense_cpu_solver = 50;
+  int max_num_images_direct_sparse_cpu_solver = 1000;
+  int min_num_residuals_for_cpu_multi_threading = 50000;
+
+  bool Check() const;
+};
+
+// Read/write the solver profile as a text file with one "key value" pair per
+// line. Lines starting with "#" are comments.
+BundleAdjustmentSolverProfile ReadBundleAdjustmentSolverProfile(
+    const std::string& path);
+void WriteBundleAdjustmentSolverProfile(
+    const std::string& path, const BundleAdjustmentSolverProfile& profile);
+
 struct BundleAdjustmentOptions {
   // Loss function types: Trivial (non-robust) and Cauchy (robust) loss.
   enum class LossFunctionType { TRIVIAL, SOFT_L1, CAUCHY };
@@ -165,6 +194,33 @@ struct BundleAdjustmentOptions {
   int max_num_images_direct_dense_gpu_solver = 200;
   int max_num_images_direct_sparse_gpu_solver = 4000;
 
+  // Optional path to a solver profile calibrated on this host, see
+  // BundleAdjustmentSolverProfile. If given, the profile overrides the CPU
+  // solver and multi-threading thresholds above. The profile is only read
+  // once per process and path.
+  std::string solver_profile_path;
+
+  // Whether the bundle adjuster keeps its problem alive across calls to
+  // BundleAdjuster::Update, e.g., between iterative refinement rounds. Only
+  // residual blocks of changed observations are then removed and added.
+  // This requires fast residual block removal in Ceres, at the cost of extra
+  // memory.
+  bool reuse_problem = false;
+
+  // Whether to use the batched bundle adjuster, which evaluates residuals in
+  // batches per camera model and solves the Schur complement with a dedicated
+  // Levenberg-Marquardt solver instead of one Ceres residual block per
+  // observation. Falls back to the default adjuster for unsupported problems,
+  // see IsBatchedBundleAdjusterSupported.
+  bool use_batched_solver = false;
+
+  // Whether the batched bundle adjuster stores the Jacobians of the
+  // reprojection residuals in single precision, while the residuals, the cost,
+  // and the normal equations are evaluated and accumulated in double
+  // precision. This halves the memory and bandwidth of the linearization at a
+  // small loss in the accuracy of the steps. Only used with the batched solver.
+  bool use_mixed_precision = false;
+
   // Ceres-Solver options.
   ceres::Solver::Options solver_options;
 
@@ -216,6 +272,14 @@ class BundleAdjuster {
   virtual ceres::Solver::Summary Solve() = 0;
   virtual std::shared_ptr<ceres::Problem>& Problem() = 0;
 
+  // Update the problem in place for changed options, configuration, or
+  // reconstruction, e.g., after filtering, merging, or completing tracks
+  // between refinement rounds. Returns false if the bundle adjuster does not
+  // support updates, in which case a new bundle adjuster must be created.
+  virtual bool Update(BundleAdjustmentOptions options,
+                      BundleAdjustmentConfig config,
+                      Reconstruction& reconstruction);
+
   const BundleAdjustmentOptions& Options() const;
   const BundleAdjustmentConfig& Config() const;
 
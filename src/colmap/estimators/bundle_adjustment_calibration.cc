@@ -0,0 +1,302 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/bundle_adjustment_calibration.h"
+
+#include "colmap/math/random.h"
+#include "colmap/scene/synthetic.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/misc.h"
+#include "colmap/util/threading.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace colmap {
+namespace {
+
+enum CalibrationSolver {
+  kDenseSchur = 0,
+  kSparseSchur = 1,
+  kIterativeSchur = 2,
+  kNumSolvers = 3,
+};
+
+struct CalibrationTiming {
+  int num_images = 0;
+  size_t num_residuals = 0;
+  // Solve times of the fastest configuration of each solver or infinity, if
+  // the solver was not timed.
+  std::array<double, kNumSolvers> solver_times;
+  bool multi_threading_faster = false;
+};
+
+// Synthesize a problem, in which every 3D point is observed by a window of
+// consecutive images with noisy observations, as in sequential captures.
+void SynthesizeCalibrationProblem(
+    const BundleAdjustmentSolverCalibrationOptions& options,
+    const int num_images,
+    Reconstruction* reconstruction) {
+  SyntheticDatasetOptions synthetic_options;
+  synthetic_options.num_rigs = 1;
+  synthetic_options.num_cameras_per_rig = 1;
+  synthetic_options.num_frames_per_rig = num_images;
+  synthetic_options.num_points3D = 0;
+  synthetic_options.num_points2D_without_point3D = 0;
+  SynthesizeDataset(synthetic_options, reconstruction);
+
+  std::vector<image_t> image_ids = reconstruction->RegImageIds();
+  std::sort(image_ids.begin(), image_ids.end());
+
+  const int track_length = std::min(options.track_length, num_images);
+  const int num_points3D =
+      num_images * options.num_observations_per_image / track_length;
+
+  std::vector<std::vector<Eigen::Vector2d>> points2D(num_images);
+  std::vector<std::pair<Eigen::Vector3d, Track>> points3D;
+  points3D.reserve(num_points3D);
+  for (int point3D_idx = 0; point3D_idx < num_points3D; ++point3D_idx) {
+    const Eigen::Vector3d xyz = Eigen::Vector3d::Random().normalized();
+    const int first_image_idx =
+        RandomUniformInteger<int>(0, num_images - track_length);
+    Track track;
+    for (int image_idx = first_image_idx;
+         image_idx < first_image_idx + track_length;
+         ++image_idx) {
+      const Image& image = reconstruction->Image(image_ids[image_idx]);
+      const std::optional<Eigen::Vector2d> proj_point2D =
+          image.ProjectPoint(xyz);
+      if (!proj_point2D.has_value()) {
+        continue;
+      }
+      track.AddElement(image_ids[image_idx], points2D[image_idx].size());
+      points2D[image_idx].push_back(
+          proj_point2D.value() +
+          Eigen::Vector2d(RandomGaussian<double>(0, options.point2D_stddev),
+                          RandomGaussian<double>(0, options.point2D_stddev)));
+    }
+    if (track.Length() >= 2) {
+      points3D.emplace_back(xyz, std::move(track));
+    }
+  }
+
+  for (int image_idx = 0; image_idx < num_images; ++image_idx) {
+    reconstruction->Image(image_ids[image_idx])
+        .SetPoints2D(points2D[image_idx]);
+  }
+  for (auto& [xyz, track] : points3D) {
+    reconstruction->AddPoint3D(xyz, std::move(track));
+  }
+}
+
+// Time a fixed number of iterations of the given solver on a copy of the
+// reconstruction, as selected by BundleAdjustmentOptions::CreateSolverOptions.
+double TimeCalibrationSolver(
+    const BundleAdjustmentSolverCalibrationOptions& options,
+    const Reconstruction& reconstruction,
+    const CalibrationSolver solver,
+    const bool multi_threaded) {
+  BundleAdjustmentOptions ba_options;
+  ba_options.print_summary = false;
+  ba_options.solver_options.max_num_iterations = options.num_iterations;
+  ba_options.solver_options.function_tolerance = 0;
+  ba_options.solver_options.gradient_tolerance = 0;
+  ba_options.solver_options.parameter_tolerance = 0;
+  ba_options.solver_options.num_threads = options.num_threads;
+
+  const int num_images = reconstruction.NumRegImages();
+  switch (solver) {
+    case kDenseSchur:
+      ba_options.max_num_images_direct_dense_cpu_solver = num_images;
+      ba_options.max_num_images_direct_sparse_cpu_solver = num_images + 1;
+      break;
+    case kSparseSchur:
+      ba_options.max_num_images_direct_dense_cpu_solver = 0;
+      ba_options.max_num_images_direct_sparse_cpu_solver = num_images;
+      break;
+    case kIterativeSchur:
+      ba_options.max_num_images_direct_dense_cpu_solver = 0;
+      ba_options.max_num_images_direct_sparse_cpu_solver = 1;
+      break;
+    default:
+      LOG(FATAL_THROW) << "Invalid solver";
+  }
+  ba_options.min_num_residuals_for_cpu_multi_threading =
+      multi_threaded ? 0 : std::numeric_limits<int>::max();
+
+  BundleAdjustmentConfig ba_config;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    ba_config.AddImage(image_id);
+  }
+  ba_config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  Reconstruction problem_reconstruction = reconstruction;
+  std::unique_ptr<BundleAdjuster> bundle_adjuster = CreateDefaultBundleAdjuster(
+      std::move(ba_options), std::move(ba_config), problem_reconstruction);
+  return bundle_adjuster->Solve().total_time_in_seconds;
+}
+
+}  // namespace
+
+bool BundleAdjustmentSolverCalibrationOptions::Check() const {
+  CHECK_OPTION(!num_images.empty());
+  CHECK_OPTION_GE(num_images.front(), 2);
+  for (size_t i = 1; i < num_images.size(); ++i) {
+    CHECK_OPTION_LT(num_images[i - 1], num_images[i]);
+  }
+  CHECK_OPTION_GT(num_observations_per_image, 0);
+  CHECK_OPTION_GE(track_length, 2);
+  CHECK_OPTION_GE(point2D_stddev, 0);
+  CHECK_OPTION_GT(num_iterations, 0);
+  CHECK_OPTION_GE(max_slowdown, 1);
+  return true;
+}
+
+BundleAdjustmentSolverProfile CalibrateBundleAdjustmentSolverProfile(
+    const BundleAdjustmentSolverCalibrationOptions& options) {
+  THROW_CHECK(options.Check());
+
+  const bool has_multi_threading =
+      GetEffectiveNumThreads(options.num_threads) > 1;
+
+  std::array<bool, kNumSolvers> enabled_solvers;
+  enabled_solvers.fill(true);
+  if (BundleAdjustmentOptions()
+          .solver_options.sparse_linear_algebra_library_type ==
+      ceres::NO_SPARSE) {
+    enabled_solvers[kSparseSchur] = false;
+  }
+
+  std::vector<CalibrationTiming> timings;
+  timings.reserve(options.num_images.size());
+  for (const int num_images : options.num_images) {
+    Reconstruction reconstruction;
+    SynthesizeCalibrationProblem(options, num_images, &reconstruction);
+
+    CalibrationTiming& timing = timings.emplace_back();
+    timing.num_images = num_images;
+    timing.num_residuals = 2 * reconstruction.ComputeNumObservations();
+    timing.solver_times.fill(std::numeric_limits<double>::infinity());
+
+    int best_solver = -1;
+    double best_single_threaded_time = 0;
+    double best_multi_threaded_time = 0;
+    for (int solver = 0; solver < kNumSolvers; ++solver) {
+      if (!enabled_solvers[solver]) {
+        continue;
+      }
+      const double single_threaded_time = TimeCalibrationSolver(
+          options,
+          reconstruction,
+          static_cast<CalibrationSolver>(solver),
+          /*multi_threaded=*/false);
+      const double multi_threaded_time =
+          has_multi_threading
+              ? TimeCalibrationSolver(options,
+                                      reconstruction,
+                                      static_cast<CalibrationSolver>(solver),
+                                      /*multi_threaded=*/true)
+              : std::numeric_limits<double>::infinity();
+      timing.solver_times[solver] =
+          std::min(single_threaded_time, multi_threaded_time);
+      if (best_solver == -1 ||
+          timing.solver_times[solver] < timing.solver_times[best_solver]) {
+        best_solver = solver;
+        best_single_threaded_time = single_threaded_time;
+        best_multi_threaded_time = multi_threaded_time;
+      }
+    }
+
+    THROW_CHECK_NE(best_solver, -1);
+    timing.multi_threading_faster =
+        best_multi_threaded_time < best_single_threaded_time;
+
+    // The direct solvers only get slower relative to the iterative solver with
+    // growing problems, so they are no longer timed once far behind.
+    for (const int solver : {kDenseSchur, kSparseSchur}) {
+      if (timing.solver_times[solver] >
+          options.max_slowdown * timing.solver_times[best_solver]) {
+        enabled_solvers[solver] = false;
+      }
+    }
+
+    LOG(INFO) << StringPrintf(
+        "Calibrated %d images, %d residuals: dense=%.3fs, sparse=%.3fs, "
+        "iterative=%.3fs, multi-threading faster=%d",
+        num_images,
+        static_cast<int>(timing.num_residuals),
+        timing.solver_times[kDenseSchur],
+        timing.solver_times[kSparseSchur],
+        timing.solver_times[kIterativeSchur],
+        timing.multi_threading_faster);
+  }
+
+  BundleAdjustmentSolverProfile profile;
+
+  size_t timing_idx = 0;
+  profile.max_num_images_direct_dense_cpu_solver = 0;
+  while (timing_idx < timings.size()) {
+    const auto& times = timings[timing_idx].solver_times;
+    if (times[kDenseSchur] > times[kSparseSchur] ||
+        times[kDenseSchur] > times[kIterativeSchur]) {
+      break;
+    }
+    profile.max_num_images_direct_dense_cpu_solver =
+        timings[timing_idx].num_images;
+    ++timing_idx;
+  }
+
+  profile.max_num_images_direct_sparse_cpu_solver =
+      profile.max_num_images_direct_dense_cpu_solver + 1;
+  while (timing_idx < timings.size()) {
+    const auto& times = timings[timing_idx].solver_times;
+    if (times[kSparseSchur] > times[kIterativeSchur]) {
+      break;
+    }
+    profile.max_num_images_direct_sparse_cpu_solver =
+        timings[timing_idx].num_images;
+    ++timing_idx;
+  }
+
+  profile.min_num_residuals_for_cpu_multi_threading =
+      std::numeric_limits<int>::max();
+  for (auto it = timings.rbegin();
+       it != timings.rend() && it->multi_threading_faster;
+       ++it) {
+    profile.min_num_residuals_for_cpu_multi_threading =
+        static_cast<int>(it->num_residuals);
+  }
+
+  THROW_CHECK(profile.Check());
+
+  return profile;
+}
+
+}  // namespace colmap
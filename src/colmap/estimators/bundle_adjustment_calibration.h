@@ -0,0 +1,72 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/estimators/bundle_adjustment.h"
+
+#include <vector>
+
+namespace colmap {
+
+struct BundleAdjustmentSolverCalibrationOptions {
+  // The numbers of images of the synthetic problems, in increasing order.
+  std::vector<int> num_images = {25, 50, 100, 200, 400, 800, 1600};
+
+  // The number of observations per image and the number of consecutive images
+  // observing each 3D point, which determine the sparsity of the problems.
+  int num_observations_per_image = 200;
+  int track_length = 6;
+
+  // The standard deviation of the noise on the observations in pixels.
+  double point2D_stddev = 1.0;
+
+  // The fixed number of Levenberg-Marquardt iterations timed per solve.
+  int num_iterations = 5;
+
+  // The number of threads of the multi-threaded solves.
+  int num_threads = -1;
+
+  // A solver is no longer timed for larger problems once it is slower than
+  // the fastest solver by this factor.
+  double max_slowdown = 4.0;
+
+  bool Check() const;
+};
+
+// Calibrate the solver selection of BundleAdjustmentOptions on this host. For
+// each problem size, synthesizes a sparse bundle adjustment problem and times
+// the dense Schur, sparse Schur, and iterative Schur solvers with and without
+// multi-threading. The image thresholds of the profile are the largest sizes
+// up to which the direct solvers were fastest and the residual threshold is
+// the smallest size beyond which multi-threading was always faster.
+BundleAdjustmentSolverProfile CalibrateBundleAdjustmentSolverProfile(
+    const BundleAdjustmentSolverCalibrationOptions& options);
+
+}  // namespace colmap
@@ -0,0 +1,65 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/bundle_adjustment_calibration.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+TEST(CalibrateBundleAdjustmentSolverProfile, Nominal) {
+  BundleAdjustmentSolverCalibrationOptions options;
+  options.num_images = {4, 8, 16};
+  options.num_observations_per_image = 20;
+  options.track_length = 3;
+  options.num_iterations = 2;
+  options.num_threads = 2;
+  const BundleAdjustmentSolverProfile profile =
+      CalibrateBundleAdjustmentSolverProfile(options);
+  EXPECT_TRUE(profile.Check());
+  EXPECT_GE(profile.max_num_images_direct_dense_cpu_solver, 0);
+  EXPECT_LE(profile.max_num_images_direct_dense_cpu_solver, 16);
+  EXPECT_GT(profile.max_num_images_direct_sparse_cpu_solver,
+            profile.max_num_images_direct_dense_cpu_solver);
+  EXPECT_LE(profile.max_num_images_direct_sparse_cpu_solver, 17);
+}
+
+TEST(CalibrateBundleAdjustmentSolverProfile, InvalidOptions) {
+  BundleAdjustmentSolverCalibrationOptions options;
+  options.num_images = {};
+  EXPECT_ANY_THROW(CalibrateBundleAdjustmentSolverProfile(options));
+  options.num_images = {8, 4};
+  EXPECT_ANY_THROW(CalibrateBundleAdjustmentSolverProfile(options));
+  options.num_images = {1};
+  EXPECT_ANY_THROW(CalibrateBundleAdjustmentSolverProfile(options));
+}
+
+}  // namespace
+}  // namespace colmap
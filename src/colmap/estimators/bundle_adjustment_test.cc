@@ -32,6 +32,9 @@
 #include "colmap/geometry/rigid3_matchers.h"
 #include "colmap/scene/synthetic.h"
 #include "colmap/sensor/models.h"
+#include "colmap/util/testing.h"
+
+#include <fstream>
 
 #include <gtest/gtest.h>
 
@@ -134,6 +137,110 @@ TEST(BundleAdjustmentConfig, NumResiduals) {
   EXPECT_EQ(config.NumResiduals(reconstruction), 800);
 }
 
+TEST(BundleAdjustmentConfig, IgnoredPoints) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 4;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 1;
+  synthetic_dataset_options.num_points3D = 100;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  const std::vector<image_t> image_ids = reconstruction.RegImageIds();
+  CHECK_EQ(image_ids.size(), 4);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(image_ids[0]);
+  config.AddImage(image_ids[1]);
+  config.IgnorePoint(1);
+  config.IgnorePoint(2);
+  EXPECT_EQ(config.NumIgnoredPoints(), 2);
+  EXPECT_TRUE(config.HasIgnoredPoint(1));
+  EXPECT_FALSE(config.HasPoint(1));
+  EXPECT_EQ(config.NumResiduals(reconstruction), 392);
+
+  EXPECT_ANY_THROW(config.AddVariablePoint(1));
+  EXPECT_ANY_THROW(config.AddConstantPoint(2));
+  config.AddVariablePoint(3);
+  EXPECT_ANY_THROW(config.IgnorePoint(3));
+  EXPECT_EQ(config.NumResiduals(reconstruction), 396);
+
+  config.RemoveIgnoredPoint(2);
+  EXPECT_FALSE(config.HasIgnoredPoint(2));
+  EXPECT_EQ(config.NumResiduals(reconstruction), 400);
+}
+
+TEST(BundleAdjustmentSolverProfile, ReadWrite) {
+  const std::string test_dir = CreateTestDir();
+  const std::string profile_path = test_dir + "/solver_profile.txt";
+
+  BundleAdjustmentSolverProfile profile;
+  profile.max_num_images_direct_dense_cpu_solver = 10;
+  profile.max_num_images_direct_sparse_cpu_solver = 20;
+  profile.min_num_residuals_for_cpu_multi_threading = 30;
+  WriteBundleAdjustmentSolverProfile(profile_path, profile);
+
+  const BundleAdjustmentSolverProfile read_profile =
+      ReadBundleAdjustmentSolverProfile(profile_path);
+  EXPECT_EQ(read_profile.max_num_images_direct_dense_cpu_solver, 10);
+  EXPECT_EQ(read_profile.max_num_images_direct_sparse_cpu_solver, 20);
+  EXPECT_EQ(read_profile.min_num_residuals_for_cpu_multi_threading, 30);
+
+  std::ofstream(profile_path, std::ios::app) << "unknown_key 1\n";
+  EXPECT_ANY_THROW(ReadBundleAdjustmentSolverProfile(profile_path));
+
+  profile.max_num_images_direct_sparse_cpu_solver = 10;
+  WriteBundleAdjustmentSolverProfile(profile_path, profile);
+  EXPECT_ANY_THROW(ReadBundleAdjustmentSolverProfile(profile_path));
+}
+
+TEST(BundleAdjustmentOptions, CreateSolverOptionsWithProfile) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 4;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 1;
+  synthetic_dataset_options.num_points3D = 100;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    config.AddImage(image_id);
+  }
+
+  BundleAdjustmentOptions options;
+  options.solver_options.num_threads = 2;
+  std::unique_ptr<BundleAdjuster> bundle_adjuster =
+      CreateDefaultBundleAdjuster(options, config, reconstruction);
+  const ceres::Problem& problem = *bundle_adjuster->Problem();
+
+  ceres::Solver::Options solver_options =
+      options.CreateSolverOptions(config, problem);
+  EXPECT_EQ(solver_options.linear_solver_type, ceres::DENSE_SCHUR);
+  EXPECT_EQ(solver_options.num_threads, 1);
+
+  const std::string test_dir = CreateTestDir();
+  BundleAdjustmentSolverProfile profile;
+  profile.max_num_images_direct_dense_cpu_solver = 2;
+  profile.max_num_images_direct_sparse_cpu_solver = 3;
+  profile.min_num_residuals_for_cpu_multi_threading = 0;
+  options.solver_profile_path = test_dir + "/iterative_solver_profile.txt";
+  WriteBundleAdjustmentSolverProfile(options.solver_profile_path, profile);
+
+  solver_options = options.CreateSolverOptions(config, problem);
+  EXPECT_EQ(solver_options.linear_solver_type, ceres::ITERATIVE_SCHUR);
+  EXPECT_EQ(solver_options.num_threads, 2);
+
+  profile.max_num_images_direct_sparse_cpu_solver = 4;
+  options.solver_profile_path = test_dir + "/sparse_solver_profile.txt";
+  WriteBundleAdjustmentSolverProfile(options.solver_profile_path, profile);
+
+  solver_options = options.CreateSolverOptions(config, problem);
+  if (solver_options.sparse_linear_algebra_library_type != ceres::NO_SPARSE) {
+    EXPECT_EQ(solver_options.linear_solver_type, ceres::SPARSE_SCHUR);
+  }
+}
+
 TEST(DefaultBundleAdjuster, TwoView) {
   Reconstruction reconstruction;
   SyntheticDatasetOptions synthetic_dataset_options;
@@ -624,6 +731,53 @@ TEST(DefaultBundleAdjuster, ConstantPoints) {
   }
 }
 
+TEST(DefaultBundleAdjuster, IgnoredPoints) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 2;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 1;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+  const auto orig_reconstruction = reconstruction;
+
+  const point3D_t ignored_point3D_id1 = 1;
+  const point3D_t ignored_point3D_id2 = 2;
+
+  BundleAdjustmentConfig config;
+  config.AddImage(1);
+  config.AddImage(2);
+  config.SetConstantRigFromWorldPose(1);
+  config.SetConstantRigFromWorldPose(2);
+  config.IgnorePoint(ignored_point3D_id1);
+  config.IgnorePoint(ignored_point3D_id2);
+
+  BundleAdjustmentOptions options;
+  std::unique_ptr<BundleAdjuster> bundle_adjuster =
+      CreateDefaultBundleAdjuster(options, config, reconstruction);
+  const auto summary = bundle_adjuster->Solve();
+  ASSERT_NE(summary.termination_type, ceres::FAILURE);
+
+  EXPECT_EQ(config.NumResiduals(reconstruction),
+            bundle_adjuster->Problem()->NumResiduals());
+
+  // 98 points, 2 images, 2 residuals per point per image
+  EXPECT_EQ(summary.num_residuals_reduced, 392);
+  // 98 x 3 point parameters
+  // + 2 x 2 camera parameters
+  EXPECT_EQ(summary.num_effective_parameters_reduced, 298);
+
+  for (const auto& [point3D_id, point3D] : reconstruction.Points3D()) {
+    if (point3D_id == ignored_point3D_id1 ||
+        point3D_id == ignored_point3D_id2) {
+      CheckConstantPoint(point3D, orig_reconstruction.Point3D(point3D_id));
+    } else {
+      CheckVariablePoint(point3D, orig_reconstruction.Point3D(point3D_id));
+    }
+  }
+}
+
 TEST(DefaultBundleAdjuster, VariableImage) {
   Reconstruction reconstruction;
   SyntheticDatasetOptions synthetic_dataset_options;
@@ -981,5 +1135,66 @@ TEST(DefaultBundleAdjuster, FixGaugeWithTwoCamsFromWorldFallback) {
   EXPECT_EQ(summary.num_effective_parameters_reduced, 307);
 }
 
+TEST(DefaultBundleAdjuster, UpdateReusedProblem) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 3;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 1;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentOptions options;
+  options.reuse_problem = true;
+  options.loss_function_type =
+      BundleAdjustmentOptions::LossFunctionType::SOFT_L1;
+
+  BundleAdjustmentConfig config;
+  config.AddImage(1);
+  config.AddImage(2);
+  config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+
+  std::unique_ptr<BundleAdjuster> bundle_adjuster =
+      CreateDefaultBundleAdjuster(options, config, reconstruction);
+  ASSERT_NE(bundle_adjuster->Solve().termination_type, ceres::FAILURE);
+  EXPECT_EQ(config.NumResiduals(reconstruction),
+            bundle_adjuster->Problem()->NumResiduals());
+
+  // Simulate changes between refinement rounds.
+  reconstruction.DeletePoint3D(1);
+  const Image& image1 = reconstruction.Image(1);
+  for (point2D_t point2D_idx = 0; point2D_idx < image1.NumPoints2D();
+       ++point2D_idx) {
+    if (image1.Point2D(point2D_idx).HasPoint3D()) {
+      reconstruction.DeleteObservation(1, point2D_idx);
+      break;
+    }
+  }
+  config.AddImage(3);
+  config.SetConstantCamIntrinsics(3);
+  options.loss_function_type =
+      BundleAdjustmentOptions::LossFunctionType::TRIVIAL;
+
+  ASSERT_TRUE(bundle_adjuster->Update(options, config, reconstruction));
+  const auto summary = bundle_adjuster->Solve();
+  ASSERT_NE(summary.termination_type, ceres::FAILURE);
+  EXPECT_EQ(config.NumResiduals(reconstruction),
+            bundle_adjuster->Problem()->NumResiduals());
+
+  // The updated problem must match a problem set up from scratch.
+  options.reuse_problem = false;
+  const auto expected_summary =
+      CreateDefaultBundleAdjuster(options, config, reconstruction)->Solve();
+  ASSERT_NE(expected_summary.termination_type, ceres::FAILURE);
+  EXPECT_EQ(summary.num_residuals_reduced,
+            expected_summary.num_residuals_reduced);
+  EXPECT_EQ(summary.num_effective_parameters_reduced,
+            expected_summary.num_effective_parameters_reduced);
+
+  // Updates are only supported when reusing the problem.
+  EXPECT_FALSE(bundle_adjuster->Update(options, config, reconstruction));
+}
+
 }  // namespace
 }  // namespace colmap
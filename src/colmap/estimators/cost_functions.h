@@ -33,6 +33,9 @@
 #include "colmap/sensor/models.h"
 #include "colmap/util/eigen_alignment.h"
 
+#include <limits>
+#include <type_traits>
+
 #include <Eigen/Core>
 #include <ceres/ceres.h>
 #include <ceres/conditioned_cost_function.h>
@@ -484,6 +487,64 @@ struct Point3DAlignmentCostFunctor
   const bool use_log_scale_;
 };
 
+// 3-DoF error between two absolute rotations based on a prior on their
+// relative rotation. Used for rotation averaging, where the residual is the
+// angle-axis of the error rotation: ΔR = log(j_R_w·i_R_w⁻¹·i_R_j).
+struct RelativeRotationErrorCostFunctor
+    : public AutoDiffCostFunctor<RelativeRotationErrorCostFunctor, 3, 4, 4> {
+ public:
+  explicit RelativeRotationErrorCostFunctor(
+      const Eigen::Quaterniond& j_from_i_prior)
+      : i_from_j_prior_(j_from_i_prior.inverse()) {}
+
+  template <typename T>
+  bool operator()(const T* const i_from_world_rotation,
+                  const T* const j_from_world_rotation,
+                  T* residuals_ptr) const {
+    const Eigen::Quaternion<T> param_from_prior_rotation =
+        EigenQuaternionMap<T>(j_from_world_rotation) *
+        EigenQuaternionMap<T>(i_from_world_rotation).inverse() *
+        i_from_j_prior_.cast<T>();
+    EigenQuaternionToAngleAxis(param_from_prior_rotation.coeffs().data(),
+                               residuals_ptr);
+    return true;
+  }
+
+ private:
+  const Eigen::Quaterniond i_from_j_prior_;
+};
+
+// 3-DoF error between the known direction from position i to position j and
+// the scaled difference of the two positions, as used in the BATA formulation
+// of translation averaging. The scale is a per-constraint unknown that should
+// be bounded from below to avoid the trivial solution.
+struct PairwiseDirectionErrorCostFunctor
+    : public AutoDiffCostFunctor<PairwiseDirectionErrorCostFunctor,
+                                 3,
+                                 3,
+                                 3,
+                                 1> {
+ public:
+  explicit PairwiseDirectionErrorCostFunctor(
+      const Eigen::Vector3d& direction_prior)
+      : direction_prior_(direction_prior) {}
+
+  template <typename T>
+  bool operator()(const T* const position_i,
+                  const T* const position_j,
+                  const T* const scale,
+                  T* residuals_ptr) const {
+    Eigen::Map<Eigen::Matrix<T, 3, 1>> residuals(residuals_ptr);
+    residuals = direction_prior_.cast<T>() -
+                scale[0] * (EigenVector3Map<T>(position_j) -
+                            EigenVector3Map<T>(position_i));
+    return true;
+  }
+
+ private:
+  const Eigen::Vector3d direction_prior_;
+};
+
 template <typename... Args>
 auto LastValueParameterPack(Args&&... args) {
   return std::get<sizeof...(Args) - 1>(std::forward_as_tuple(args...));
@@ -540,13 +601,586 @@ class CovarianceWeightedCostFunctor {
   const CostFunctor cost_;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Analytic reprojection error cost functions
+////////////////////////////////////////////////////////////////////////////////
+
+// Camera models with hand-derived Jacobians of the projection of normalized
+// image points (u, v) = (x / z, y / z) to image points. Specializations
+// implement:
+//
+//    static void ImgFromCam(const double* params, double u, double v,
+//                           Eigen::Vector2d* xy, Eigen::Matrix2d* J_uv,
+//                           CameraParamsJacobian<CameraModel>* J_params);
+//
+// where the Jacobians are only computed if the pointers are non-null.
+template <typename CameraModel>
+struct AnalyticCameraModel : std::false_type {};
+
+template <typename CameraModel>
+using CameraParamsJacobian =
+    Eigen::Matrix<double, 2, CameraModel::num_params, Eigen::RowMajor>;
+
+template <>
+struct AnalyticCameraModel<SimplePinholeCameraModel> : std::true_type {
+  static void ImgFromCam(const double* params,
+                         const double u,
+                         const double v,
+                         Eigen::Vector2d* xy,
+                         Eigen::Matrix2d* J_uv,
+                         CameraParamsJacobian<SimplePinholeCameraModel>*
+                             J_params) {
+    const double f = params[0];
+    *xy << f * u + params[1], f * v + params[2];
+    if (J_uv != nullptr) {
+      *J_uv << f, 0, 0, f;
+    }
+    if (J_params != nullptr) {
+      *J_params << u, 1, 0, v, 0, 1;
+    }
+  }
+};
+
+template <>
+struct AnalyticCameraModel<PinholeCameraModel> : std::true_type {
+  static void ImgFromCam(const double* params,
+                         const double u,
+                         const double v,
+                         Eigen::Vector2d* xy,
+                         Eigen::Matrix2d* J_uv,
+                         CameraParamsJacobian<PinholeCameraModel>* J_params) {
+    const double fx = params[0];
+    const double fy = params[1];
+    *xy << fx * u + params[2], fy * v + params[3];
+    if (J_uv != nullptr) {
+      *J_uv << fx, 0, 0, fy;
+    }
+    if (J_params != nullptr) {
+      *J_params << u, 0, 1, 0, 0, v, 0, 1;
+    }
+  }
+};
+
+template <>
+struct AnalyticCameraModel<SimpleRadialCameraModel> : std::true_type {
+  static void ImgFromCam(const double* params,
+                         const double u,
+                         const double v,
+                         Eigen::Vector2d* xy,
+                         Eigen::Matrix2d* J_uv,
+                         CameraParamsJacobian<SimpleRadialCameraModel>*
+                             J_params) {
+    const double f = params[0];
+    const double k = params[3];
+    const double r2 = u * u + v * v;
+    const double radial = 1 + k * r2;
+    const double distorted_u = u * radial;
+    const double distorted_v = v * radial;
+    *xy << f * distorted_u + params[1], f * distorted_v + params[2];
+    if (J_uv != nullptr) {
+      const double duv = 2 * k * u * v;
+      *J_uv << f * (radial + 2 * k * u * u), f * duv, f * duv,
+          f * (radial + 2 * k * v * v);
+    }
+    if (J_params != nullptr) {
+      *J_params << distorted_u, 1, 0, f * u * r2, distorted_v, 0, 1,
+          f * v * r2;
+    }
+  }
+};
+
+template <>
+struct AnalyticCameraModel<RadialCameraModel> : std::true_type {
+  static void ImgFromCam(const double* params,
+                         const double u,
+                         const double v,
+                         Eigen::Vector2d* xy,
+                         Eigen::Matrix2d* J_uv,
+                         CameraParamsJacobian<RadialCameraModel>* J_params) {
+    const double f = params[0];
+    const double k1 = params[3];
+    const double k2 = params[4];
+    const double r2 = u * u + v * v;
+    const double r4 = r2 * r2;
+    const double radial = 1 + k1 * r2 + k2 * r4;
+    const double distorted_u = u * radial;
+    const double distorted_v = v * radial;
+    *xy << f * distorted_u + params[1], f * distorted_v + params[2];
+    if (J_uv != nullptr) {
+      // Derivative of the radial term w.r.t. r2, times 2.
+      const double dradial = 2 * (k1 + 2 * k2 * r2);
+      const double duv = dradial * u * v;
+      *J_uv << f * (radial + dradial * u * u), f * duv, f * duv,
+          f * (radial + dradial * v * v);
+    }
+    if (J_params != nullptr) {
+      *J_params << distorted_u, 1, 0, f * u * r2, f * u * r4, distorted_v, 0,
+          1, f * v * r2, f * v * r4;
+    }
+  }
+};
+
+template <>
+struct AnalyticCameraModel<OpenCVCameraModel> : std::true_type {
+  static void ImgFromCam(const double* params,
+                         const double u,
+                         const double v,
+                         Eigen::Vector2d* xy,
+                         Eigen::Matrix2d* J_uv,
+                         CameraParamsJacobian<OpenCVCameraModel>* J_params) {
+    const double fx = params[0];
+    const double fy = params[1];
+    const double k1 = params[4];
+    const double k2 = params[5];
+    const double p1 = params[6];
+    const double p2 = params[7];
+    const double u2 = u * u;
+    const double uv = u * v;
+    const double v2 = v * v;
+    const double r2 = u2 + v2;
+    const double r4 = r2 * r2;
+    const double radial = 1 + k1 * r2 + k2 * r4;
+    const double distorted_u = u * radial + 2 * p1 * uv + p2 * (r2 + 2 * u2);
+    const double distorted_v = v * radial + 2 * p2 * uv + p1 * (r2 + 2 * v2);
+    *xy << fx * distorted_u + params[2], fy * distorted_v + params[3];
+    if (J_uv != nullptr) {
+      const double dradial = 2 * (k1 + 2 * k2 * r2);
+      const double duv = dradial * uv + 2 * p1 * u + 2 * p2 * v;
+      *J_uv << fx * (radial + dradial * u2 + 2 * p1 * v + 6 * p2 * u),
+          fx * duv, fy * duv,
+          fy * (radial + dradial * v2 + 2 * p2 * u + 6 * p1 * v);
+    }
+    if (J_params != nullptr) {
+      *J_params << distorted_u, 0, 1, 0, fx * u * r2, fx * u * r4,
+          fx * 2 * uv, fx * (r2 + 2 * u2), 0, distorted_v, 0, 1, fy * v * r2,
+          fy * v * r4, fy * (r2 + 2 * v2), fy * 2 * uv;
+    }
+  }
+};
+
+// Projects a point in the camera frame to the image and optionally computes
+// the Jacobians w.r.t. the point and the camera parameters. Returns false for
+// points behind the camera, consistent with `CameraModel::ImgFromCam`.
+template <typename CameraModel>
+inline bool AnalyticImgFromCam(const double* camera_params,
+                               const Eigen::Vector3d& point3D_in_cam,
+                               Eigen::Vector2d* xy,
+                               Eigen::Matrix<double, 2, 3>* J_point3D,
+                               CameraParamsJacobian<CameraModel>* J_params) {
+  if (point3D_in_cam.z() < std::numeric_limits<double>::epsilon()) {
+    return false;
+  }
+  const double inv_z = 1 / point3D_in_cam.z();
+  const double u = point3D_in_cam.x() * inv_z;
+  const double v = point3D_in_cam.y() * inv_z;
+  Eigen::Matrix2d J_uv;
+  AnalyticCameraModel<CameraModel>::ImgFromCam(
+      camera_params, u, v, xy, J_point3D == nullptr ? nullptr : &J_uv, J_params);
+  if (J_point3D != nullptr) {
+    J_point3D->col(0) = inv_z * J_uv.col(0);
+    J_point3D->col(1) = inv_z * J_uv.col(1);
+    J_point3D->col(2) = -inv_z * (u * J_uv.col(0) + v * J_uv.col(1));
+  }
+  return true;
+}
+
+// Jacobians of the rotation of a point by a quaternion (x, y, z, w), as
+// evaluated by Eigen, i.e., v + 2 * w * (u x v) + 2 * u x (u x v) with the
+// imaginary part u. The expressions are exact also for non-unit quaternions,
+// so that they match automatic differentiation of the same expression.
+inline Eigen::Matrix3d QuaternionRotatePointJacobianWrtPoint(
+    const double* quat_xyzw) {
+  const Eigen::Vector3d u(quat_xyzw[0], quat_xyzw[1], quat_xyzw[2]);
+  Eigen::Matrix3d u_cross;
+  u_cross << 0, -u.z(), u.y(), u.z(), 0, -u.x(), -u.y(), u.x(), 0;
+  return Eigen::Matrix3d::Identity() + 2 * quat_xyzw[3] * u_cross +
+         2 * u_cross * u_cross;
+}
+
+inline Eigen::Matrix<double, 3, 4> QuaternionRotatePointJacobianWrtQuaternion(
+    const double* quat_xyzw, const Eigen::Vector3d& point) {
+  const Eigen::Vector3d u(quat_xyzw[0], quat_xyzw[1], quat_xyzw[2]);
+  Eigen::Matrix3d point_cross;
+  point_cross << 0, -point.z(), point.y(), point.z(), 0, -point.x(),
+      -point.y(), point.x(), 0;
+  Eigen::Matrix<double, 3, 4> J;
+  J.leftCols<3>() =
+      -2 * quat_xyzw[3] * point_cross +
+      2 * (u.dot(point) * Eigen::Matrix3d::Identity() +
+           u * point.transpose() - 2 * point * u.transpose());
+  J.col(3) = 2 * u.cross(point);
+  return J;
+}
+
+template <int kNumParams>
+inline void SetJacobianZero(double* jacobian) {
+  if (jacobian != nullptr) {
+    Eigen::Map<Eigen::Matrix<double, 2, kNumParams, Eigen::RowMajor>>(
+        jacobian)
+        .setZero();
+  }
+}
+
+template <int kNumParams, typename Derived>
+inline void SetJacobian(double* jacobian,
+                        const Eigen::MatrixBase<Derived>& value) {
+  if (jacobian != nullptr) {
+    Eigen::Map<Eigen::Matrix<double, 2, kNumParams, Eigen::RowMajor>>
+        jacobian_mat(jacobian);
+    jacobian_mat = value;
+  }
+}
+
+// Analytic counterparts of the reprojection error cost functors, which are
+// substantially faster to evaluate than their automatically differentiated
+// versions. Specializations exist for the reprojection error cost functors
+// with camera models that have an `AnalyticCameraModel`, and they are
+// automatically used by `CreateCameraCostFunction`.
+template <typename CostFunctor>
+struct HasAnalyticCostFunction : std::false_type {};
+
+template <typename CostFunctor>
+class AnalyticCostFunction;
+
+template <typename CameraModel>
+struct HasAnalyticCostFunction<ReprojErrorCostFunctor<CameraModel>>
+    : AnalyticCameraModel<CameraModel> {};
+
+template <typename CameraModel>
+class AnalyticCostFunction<ReprojErrorCostFunctor<CameraModel>>
+    : public ceres::SizedCostFunction<2, 4, 3, 3, CameraModel::num_params> {
+ public:
+  explicit AnalyticCostFunction(const Eigen::Vector2d& point2D)
+      : point2D_(point2D) {}
+
+  bool Evaluate(double const* const* parameters,
+                double* residuals,
+                double** jacobians) const override {
+    const double* cam_from_world_rotation = parameters[0];
+    const Eigen::Vector3d point3D = EigenVector3Map<double>(parameters[2]);
+    const Eigen::Vector3d point3D_in_cam =
+        EigenQuaternionMap<double>(cam_from_world_rotation) * point3D +
+        EigenVector3Map<double>(parameters[1]);
+
+    Eigen::Map<Eigen::Vector2d> residuals_vec(residuals);
+    Eigen::Vector2d xy;
+    Eigen::Matrix<double, 2, 3> J_point3D_in_cam;
+    CameraParamsJacobian<CameraModel> J_params;
+    if (!AnalyticImgFromCam<CameraModel>(
+            parameters[3],
+            point3D_in_cam,
+            &xy,
+            jacobians == nullptr ? nullptr : &J_point3D_in_cam,
+            jacobians == nullptr ? nullptr : &J_params)) {
+      residuals_vec.setZero();
+      if (jacobians != nullptr) {
+        SetJacobianZero<4>(jacobians[0]);
+        SetJacobianZero<3>(jacobians[1]);
+        SetJacobianZero<3>(jacobians[2]);
+        SetJacobianZero<CameraModel::num_params>(jacobians[3]);
+      }
+      return true;
+    }
+
+    residuals_vec = xy - point2D_;
+
+    if (jacobians != nullptr) {
+      SetJacobian<4>(jacobians[0],
+                     J_point3D_in_cam *
+                         QuaternionRotatePointJacobianWrtQuaternion(
+                             cam_from_world_rotation, point3D));
+      SetJacobian<3>(jacobians[1], J_point3D_in_cam);
+      SetJacobian<3>(jacobians[2],
+                     J_point3D_in_cam * QuaternionRotatePointJacobianWrtPoint(
+                                            cam_from_world_rotation));
+      SetJacobian<CameraModel::num_params>(jacobians[3], J_params);
+    }
+    return true;
+  }
+
+ private:
+  const Eigen::Vector2d point2D_;
+};
+
+template <typename CameraModel>
+struct HasAnalyticCostFunction<ReprojErrorConstantPoseCostFunctor<CameraModel>>
+    : AnalyticCameraModel<CameraModel> {};
+
+template <typename CameraModel>
+class AnalyticCostFunction<ReprojErrorConstantPoseCostFunctor<CameraModel>>
+    : public ceres::SizedCostFunction<2, 3, CameraModel::num_params> {
+ public:
+  AnalyticCostFunction(const Eigen::Vector2d& point2D,
+                       const Rigid3d& cam_from_world)
+      : cam_from_world_(cam_from_world),
+        J_point3D_in_cam_wrt_point3D_(QuaternionRotatePointJacobianWrtPoint(
+            cam_from_world.rotation.coeffs().data())),
+        point2D_(point2D) {}
+
+  bool Evaluate(double const* const* parameters,
+                double* residuals,
+                double** jacobians) const override {
+    const Eigen::Vector3d point3D_in_cam =
+        cam_from_world_.rotation * EigenVector3Map<double>(parameters[0]) +
+        cam_from_world_.translation;
+
+    Eigen::Map<Eigen::Vector2d> residuals_vec(residuals);
+    Eigen::Vector2d xy;
+    Eigen::Matrix<double, 2, 3> J_point3D_in_cam;
+    CameraParamsJacobian<CameraModel> J_params;
+    if (!AnalyticImgFromCam<CameraModel>(
+            parameters[1],
+            point3D_in_cam,
+            &xy,
+            jacobians == nullptr ? nullptr : &J_point3D_in_cam,
+            jacobians == nullptr ? nullptr : &J_params)) {
+      residuals_vec.setZero();
+      if (jacobians != nullptr) {
+        SetJacobianZero<3>(jacobians[0]);
+        SetJacobianZero<CameraModel::num_params>(jacobians[1]);
+      }
+      return true;
+    }
+
+    residuals_vec = xy - point2D_;
+
+    if (jacobians != nullptr) {
+      SetJacobian<3>(jacobians[0],
+                     J_point3D_in_cam * J_point3D_in_cam_wrt_point3D_);
+      SetJacobian<CameraModel::num_params>(jacobians[1], J_params);
+    }
+    return true;
+  }
+
+ private:
+  const Rigid3d cam_from_world_;
+  const Eigen::Matrix3d J_point3D_in_cam_wrt_point3D_;
+  const Eigen::Vector2d point2D_;
+};
+
+template <typename CameraModel>
+struct HasAnalyticCostFunction<
+    ReprojErrorConstantPoint3DCostFunctor<CameraModel>>
+    : AnalyticCameraModel<CameraModel> {};
+
+template <typename CameraModel>
+class AnalyticCostFunction<ReprojErrorConstantPoint3DCostFunctor<CameraModel>>
+    : public ceres::SizedCostFunction<2, 4, 3, CameraModel::num_params> {
+ public:
+  AnalyticCostFunction(const Eigen::Vector2d& point2D,
+                       const Eigen::Vector3d& point3D)
+      : point3D_(point3D), point2D_(point2D) {}
+
+  bool Evaluate(double const* const* parameters,
+                double* residuals,
+                double** jacobians) const override {
+    const double* cam_from_world_rotation = parameters[0];
+    const Eigen::Vector3d point3D_in_cam =
+        EigenQuaternionMap<double>(cam_from_world_rotation) * point3D_ +
+        EigenVector3Map<double>(parameters[1]);
+
+    Eigen::Map<Eigen::Vector2d> residuals_vec(residuals);
+    Eigen::Vector2d xy;
+    Eigen::Matrix<double, 2, 3> J_point3D_in_cam;
+    CameraParamsJacobian<CameraModel> J_params;
+    if (!AnalyticImgFromCam<CameraModel>(
+            parameters[2],
+            point3D_in_cam,
+            &xy,
+            jacobians == nullptr ? nullptr : &J_point3D_in_cam,
+            jacobians == nullptr ? nullptr : &J_params)) {
+      residuals_vec.setZero();
+      if (jacobians != nullptr) {
+        SetJacobianZero<4>(jacobians[0]);
+        SetJacobianZero<3>(jacobians[1]);
+        SetJacobianZero<CameraModel::num_params>(jacobians[2]);
+      }
+      return true;
+    }
+
+    residuals_vec = xy - point2D_;
+
+    if (jacobians != nullptr) {
+      SetJacobian<4>(jacobians[0],
+                     J_point3D_in_cam *
+                         QuaternionRotatePointJacobianWrtQuaternion(
+                             cam_from_world_rotation, point3D_));
+      SetJacobian<3>(jacobians[1], J_point3D_in_cam);
+      SetJacobian<CameraModel::num_params>(jacobians[2], J_params);
+    }
+    return true;
+  }
+
+ private:
+  const Eigen::Vector3d point3D_;
+  const Eigen::Vector2d point2D_;
+};
+
+template <typename CameraModel>
+struct HasAnalyticCostFunction<RigReprojErrorCostFunctor<CameraModel>>
+    : AnalyticCameraModel<CameraModel> {};
+
+template <typename CameraModel>
+class AnalyticCostFunction<RigReprojErrorCostFunctor<CameraModel>>
+    : public ceres::
+          SizedCostFunction<2, 4, 3, 4, 3, 3, CameraModel::num_params> {
+ public:
+  explicit AnalyticCostFunction(const Eigen::Vector2d& point2D)
+      : point2D_(point2D) {}
+
+  bool Evaluate(double const* const* parameters,
+                double* residuals,
+                double** jacobians) const override {
+    const double* cam_from_rig_rotation = parameters[0];
+    const double* rig_from_world_rotation = parameters[2];
+    const Eigen::Vector3d point3D = EigenVector3Map<double>(parameters[4]);
+    const Eigen::Vector3d point3D_in_rig =
+        EigenQuaternionMap<double>(rig_from_world_rotation) * point3D +
+        EigenVector3Map<double>(parameters[3]);
+    const Eigen::Vector3d point3D_in_cam =
+        EigenQuaternionMap<double>(cam_from_rig_rotation) * point3D_in_rig +
+        EigenVector3Map<double>(parameters[1]);
+
+    Eigen::Map<Eigen::Vector2d> residuals_vec(residuals);
+    Eigen::Vector2d xy;
+    Eigen::Matrix<double, 2, 3> J_point3D_in_cam;
+    CameraParamsJacobian<CameraModel> J_params;
+    if (!AnalyticImgFromCam<CameraModel>(
+            parameters[5],
+            point3D_in_cam,
+            &xy,
+            jacobians == nullptr ? nullptr : &J_point3D_in_cam,
+            jacobians == nullptr ? nullptr : &J_params)) {
+      residuals_vec.setZero();
+      if (jacobians != nullptr) {
+        SetJacobianZero<4>(jacobians[0]);
+        SetJacobianZero<3>(jacobians[1]);
+        SetJacobianZero<4>(jacobians[2]);
+        SetJacobianZero<3>(jacobians[3]);
+        SetJacobianZero<3>(jacobians[4]);
+        SetJacobianZero<CameraModel::num_params>(jacobians[5]);
+      }
+      return true;
+    }
+
+    residuals_vec = xy - point2D_;
+
+    if (jacobians != nullptr) {
+      const Eigen::Matrix<double, 2, 3> J_point3D_in_rig =
+          J_point3D_in_cam *
+          QuaternionRotatePointJacobianWrtPoint(cam_from_rig_rotation);
+      SetJacobian<4>(jacobians[0],
+                     J_point3D_in_cam *
+                         QuaternionRotatePointJacobianWrtQuaternion(
+                             cam_from_rig_rotation, point3D_in_rig));
+      SetJacobian<3>(jacobians[1], J_point3D_in_cam);
+      SetJacobian<4>(jacobians[2],
+                     J_point3D_in_rig *
+                         QuaternionRotatePointJacobianWrtQuaternion(
+                             rig_from_world_rotation, point3D));
+      SetJacobian<3>(jacobians[3], J_point3D_in_rig);
+      SetJacobian<3>(jacobians[4],
+                     J_point3D_in_rig * QuaternionRotatePointJacobianWrtPoint(
+                                            rig_from_world_rotation));
+      SetJacobian<CameraModel::num_params>(jacobians[5], J_params);
+    }
+    return true;
+  }
+
+ private:
+  const Eigen::Vector2d point2D_;
+};
+
+template <typename CameraModel>
+struct HasAnalyticCostFunction<
+    RigReprojErrorConstantRigCostFunctor<CameraModel>>
+    : AnalyticCameraModel<CameraModel> {};
+
+template <typename CameraModel>
+class AnalyticCostFunction<RigReprojErrorConstantRigCostFunctor<CameraModel>>
+    : public ceres::SizedCostFunction<2, 4, 3, 3, CameraModel::num_params> {
+ public:
+  AnalyticCostFunction(const Eigen::Vector2d& point2D,
+                       const Rigid3d& cam_from_rig)
+      : cam_from_rig_(cam_from_rig),
+        J_point3D_in_cam_wrt_point3D_in_rig_(
+            QuaternionRotatePointJacobianWrtPoint(
+                cam_from_rig.rotation.coeffs().data())),
+        point2D_(point2D) {}
+
+  bool Evaluate(double const* const* parameters,
+                double* residuals,
+                double** jacobians) const override {
+    const double* rig_from_world_rotation = parameters[0];
+    const Eigen::Vector3d point3D = EigenVector3Map<double>(parameters[2]);
+    const Eigen::Vector3d point3D_in_rig =
+        EigenQuaternionMap<double>(rig_from_world_rotation) * point3D +
+        EigenVector3Map<double>(parameters[1]);
+    const Eigen::Vector3d point3D_in_cam = cam_from_rig_ * point3D_in_rig;
+
+    Eigen::Map<Eigen::Vector2d> residuals_vec(residuals);
+    Eigen::Vector2d xy;
+    Eigen::Matrix<double, 2, 3> J_point3D_in_cam;
+    CameraParamsJacobian<CameraModel> J_params;
+    if (!AnalyticImgFromCam<CameraModel>(
+            parameters[3],
+            point3D_in_cam,
+            &xy,
+            jacobians == nullptr ? nullptr : &J_point3D_in_cam,
+            jacobians == nullptr ? nullptr : &J_params)) {
+      residuals_vec.setZero();
+      if (jacobians != nullptr) {
+        SetJacobianZero<4>(jacobians[0]);
+        SetJacobianZero<3>(jacobians[1]);
+        SetJacobianZero<3>(jacobians[2]);
+        SetJacobianZero<CameraModel::num_params>(jacobians[3]);
+      }
+      return true;
+    }
+
+    residuals_vec = xy - point2D_;
+
+    if (jacobians != nullptr) {
+      const Eigen::Matrix<double, 2, 3> J_point3D_in_rig =
+          J_point3D_in_cam * J_point3D_in_cam_wrt_point3D_in_rig_;
+      SetJacobian<4>(jacobians[0],
+                     J_point3D_in_rig *
+                         QuaternionRotatePointJacobianWrtQuaternion(
+                             rig_from_world_rotation, point3D));
+      SetJacobian<3>(jacobians[1], J_point3D_in_rig);
+      SetJacobian<3>(jacobians[2],
+                     J_point3D_in_rig * QuaternionRotatePointJacobianWrtPoint(
+                                            rig_from_world_rotation));
+      SetJacobian<CameraModel::num_params>(jacobians[3], J_params);
+    }
+    return true;
+  }
+
+ private:
+  const Rigid3d cam_from_rig_;
+  const Eigen::Matrix3d J_point3D_in_cam_wrt_point3D_in_rig_;
+  const Eigen::Vector2d point2D_;
+};
+
+// Creates the analytic cost function for the given cost functor, if available,
+// and otherwise falls back to automatic differentiation.
+template <typename CostFunctor, typename... Args>
+ceres::CostFunction* CreateAnalyticOrAutoDiffCostFunction(Args&&... args) {
+  if constexpr (HasAnalyticCostFunction<CostFunctor>::value) {
+    return new AnalyticCostFunction<CostFunctor>(std::forward<Args>(args)...);
+  } else {
+    return CostFunctor::Create(std::forward<Args>(args)...);
+  }
+}
+
 template <template <typename> class CostFunctor, typename... Args>
 ceres::CostFunction* CreateCameraCostFunction(
     const CameraModelId camera_model_id, Args&&... args) {
   switch (camera_model_id) {
-#define CAMERA_MODEL_CASE(CameraModel)                                    \
-  case CameraModel::model_id:                                             \
-    return CostFunctor<CameraModel>::Create(std::forward<Args>(args)...); \
+#define CAMERA_MODEL_CASE(CameraModel)                                     \
+  case CameraModel::model_id:                                              \
+    return CreateAnalyticOrAutoDiffCostFunction<CostFunctor<CameraModel>>( \
+        std::forward<Args>(args)...);                                      \
     break;
 
     CAMERA_MODEL_SWITCH_CASES
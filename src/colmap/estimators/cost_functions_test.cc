@@ -427,6 +427,252 @@ TEST(Point3DAlignmentCostFunctor, Nominal) {
   EXPECT_NEAR(residuals_direct_scale[2], error[2], 1e-6);
 }
 
+TEST(RelativeRotationErrorCostFunctor, Nominal) {
+  const Eigen::Quaterniond j_from_i_prior(
+      Eigen::AngleAxisd(DegToRad(90.0), Eigen::Vector3d::UnitZ()));
+  std::unique_ptr<ceres::CostFunction> cost_function(
+      RelativeRotationErrorCostFunctor::Create(j_from_i_prior));
+
+  Eigen::Quaterniond i_from_world_rotation = Eigen::Quaterniond::UnitRandom();
+  Eigen::Quaterniond j_from_world_rotation =
+      j_from_i_prior * i_from_world_rotation;
+  double residuals[3];
+  const double* parameters[2] = {i_from_world_rotation.coeffs().data(),
+                                 j_from_world_rotation.coeffs().data()};
+  EXPECT_TRUE(cost_function->Evaluate(parameters, residuals, nullptr));
+  EXPECT_NEAR(residuals[0], 0, 1e-6);
+  EXPECT_NEAR(residuals[1], 0, 1e-6);
+  EXPECT_NEAR(residuals[2], 0, 1e-6);
+
+  j_from_world_rotation =
+      Eigen::AngleAxisd(DegToRad(10.0), Eigen::Vector3d::UnitX()) *
+      j_from_world_rotation;
+  EXPECT_TRUE(cost_function->Evaluate(parameters, residuals, nullptr));
+  EXPECT_NEAR(residuals[0], DegToRad(10.0), 1e-6);
+  EXPECT_NEAR(residuals[1], 0, 1e-6);
+  EXPECT_NEAR(residuals[2], 0, 1e-6);
+}
+
+TEST(PairwiseDirectionErrorCostFunctor, Nominal) {
+  std::unique_ptr<ceres::CostFunction> cost_function(
+      PairwiseDirectionErrorCostFunctor::Create(Eigen::Vector3d(1, 0, 0)));
+
+  double position_i[3] = {1, 2, 3};
+  double position_j[3] = {3, 2, 3};
+  double scale = 0.5;
+  double residuals[3];
+  const double* parameters[3] = {position_i, position_j, &scale};
+  EXPECT_TRUE(cost_function->Evaluate(parameters, residuals, nullptr));
+  EXPECT_EQ(residuals[0], 0);
+  EXPECT_EQ(residuals[1], 0);
+  EXPECT_EQ(residuals[2], 0);
+
+  position_j[1] = 4;
+  EXPECT_TRUE(cost_function->Evaluate(parameters, residuals, nullptr));
+  EXPECT_EQ(residuals[0], 0);
+  EXPECT_EQ(residuals[1], -1);
+  EXPECT_EQ(residuals[2], 0);
+}
+
+// Evaluates both cost functions at the given parameters and checks that their
+// residuals and Jacobians agree.
+void ExpectEqualCostFunctions(const ceres::CostFunction& cost_function1,
+                              const ceres::CostFunction& cost_function2,
+                              const std::vector<const double*>& parameters) {
+  ASSERT_EQ(cost_function1.num_residuals(), cost_function2.num_residuals());
+  ASSERT_EQ(cost_function1.parameter_block_sizes(),
+            cost_function2.parameter_block_sizes());
+  const int num_residuals = cost_function1.num_residuals();
+  const std::vector<int32_t>& block_sizes =
+      cost_function1.parameter_block_sizes();
+  ASSERT_EQ(block_sizes.size(), parameters.size());
+
+  std::vector<double> residuals1(num_residuals);
+  std::vector<double> residuals2(num_residuals);
+  std::vector<std::vector<double>> jacobians1(block_sizes.size());
+  std::vector<std::vector<double>> jacobians2(block_sizes.size());
+  std::vector<double*> jacobian_ptrs1(block_sizes.size());
+  std::vector<double*> jacobian_ptrs2(block_sizes.size());
+  for (size_t i = 0; i < block_sizes.size(); ++i) {
+    jacobians1[i].resize(num_residuals * block_sizes[i]);
+    jacobians2[i].resize(num_residuals * block_sizes[i]);
+    jacobian_ptrs1[i] = jacobians1[i].data();
+    jacobian_ptrs2[i] = jacobians2[i].data();
+  }
+
+  EXPECT_TRUE(cost_function1.Evaluate(
+      parameters.data(), residuals1.data(), jacobian_ptrs1.data()));
+  EXPECT_TRUE(cost_function2.Evaluate(
+      parameters.data(), residuals2.data(), jacobian_ptrs2.data()));
+
+  constexpr double kEps = 1e-8;
+  for (int i = 0; i < num_residuals; ++i) {
+    EXPECT_NEAR(residuals1[i], residuals2[i], kEps);
+  }
+  for (size_t i = 0; i < block_sizes.size(); ++i) {
+    for (size_t j = 0; j < jacobians1[i].size(); ++j) {
+      EXPECT_NEAR(jacobians1[i][j],
+                  jacobians2[i][j],
+                  kEps * std::max(1.0, std::abs(jacobians2[i][j])))
+          << "block=" << i << ", entry=" << j;
+    }
+  }
+
+  // Residuals must also be consistent without Jacobians.
+  EXPECT_TRUE(
+      cost_function1.Evaluate(parameters.data(), residuals1.data(), nullptr));
+  for (int i = 0; i < num_residuals; ++i) {
+    EXPECT_NEAR(residuals1[i], residuals2[i], kEps);
+  }
+}
+
+template <typename CameraModel>
+class AnalyticCostFunctionTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SetPRNGSeed(42);
+    camera_params_ = CameraModel::InitializeParams(
+        /*focal_length=*/100, /*width=*/640, /*height=*/480);
+    for (const size_t idx : CameraModel::extra_params_idxs) {
+      camera_params_[idx] = RandomUniformReal<double>(-0.05, 0.05);
+    }
+    // Use non-unit quaternions to also verify the expressions for the
+    // Jacobians outside of the manifold.
+    cam_from_world_rotation_ =
+        1.1 * Eigen::Quaterniond(Eigen::AngleAxisd(
+                                     0.2, Eigen::Vector3d(1, 2, 3).normalized()))
+                  .coeffs();
+    cam_from_world_translation_ = Eigen::Vector3d(0.1, -0.2, 0.3);
+    cam_from_rig_rotation_ =
+        Eigen::Quaterniond(
+            Eigen::AngleAxisd(0.1, Eigen::Vector3d(-1, 1, 2).normalized()))
+            .coeffs();
+    cam_from_rig_translation_ = Eigen::Vector3d(-0.2, 0.1, 0.05);
+    point3D_ = Eigen::Vector3d(0.3, -0.2, 4);
+    point2D_ = Eigen::Vector2d(330, 230);
+  }
+
+  std::vector<double> camera_params_;
+  Eigen::Vector4d cam_from_world_rotation_;
+  Eigen::Vector3d cam_from_world_translation_;
+  Eigen::Vector4d cam_from_rig_rotation_;
+  Eigen::Vector3d cam_from_rig_translation_;
+  Eigen::Vector3d point3D_;
+  Eigen::Vector2d point2D_;
+};
+
+using AnalyticCameraModels = ::testing::Types<SimplePinholeCameraModel,
+                                              PinholeCameraModel,
+                                              SimpleRadialCameraModel,
+                                              RadialCameraModel,
+                                              OpenCVCameraModel>;
+TYPED_TEST_SUITE(AnalyticCostFunctionTests, AnalyticCameraModels);
+
+TYPED_TEST(AnalyticCostFunctionTests, ReprojErrorCostFunctor) {
+  using CostFunctor = ReprojErrorCostFunctor<TypeParam>;
+  ASSERT_TRUE(HasAnalyticCostFunction<CostFunctor>::value);
+  std::unique_ptr<ceres::CostFunction> analytic_cost_function(
+      CreateCameraCostFunction<ReprojErrorCostFunctor>(TypeParam::model_id,
+                                                       this->point2D_));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      CostFunctor::Create(this->point2D_));
+  ExpectEqualCostFunctions(*analytic_cost_function,
+                           *autodiff_cost_function,
+                           {this->cam_from_world_rotation_.data(),
+                            this->cam_from_world_translation_.data(),
+                            this->point3D_.data(),
+                            this->camera_params_.data()});
+
+  // Points behind the camera have zero residuals and Jacobians.
+  this->point3D_.z() = -4;
+  ExpectEqualCostFunctions(*analytic_cost_function,
+                           *autodiff_cost_function,
+                           {this->cam_from_world_rotation_.data(),
+                            this->cam_from_world_translation_.data(),
+                            this->point3D_.data(),
+                            this->camera_params_.data()});
+}
+
+TYPED_TEST(AnalyticCostFunctionTests, ReprojErrorConstantPoseCostFunctor) {
+  using CostFunctor = ReprojErrorConstantPoseCostFunctor<TypeParam>;
+  ASSERT_TRUE(HasAnalyticCostFunction<CostFunctor>::value);
+  const Rigid3d cam_from_world(
+      Eigen::Quaterniond(this->cam_from_world_rotation_).normalized(),
+      this->cam_from_world_translation_);
+  std::unique_ptr<ceres::CostFunction> analytic_cost_function(
+      CreateCameraCostFunction<ReprojErrorConstantPoseCostFunctor>(
+          TypeParam::model_id, this->point2D_, cam_from_world));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      CostFunctor::Create(this->point2D_, cam_from_world));
+  ExpectEqualCostFunctions(
+      *analytic_cost_function,
+      *autodiff_cost_function,
+      {this->point3D_.data(), this->camera_params_.data()});
+}
+
+TYPED_TEST(AnalyticCostFunctionTests, ReprojErrorConstantPoint3DCostFunctor) {
+  using CostFunctor = ReprojErrorConstantPoint3DCostFunctor<TypeParam>;
+  ASSERT_TRUE(HasAnalyticCostFunction<CostFunctor>::value);
+  std::unique_ptr<ceres::CostFunction> analytic_cost_function(
+      CreateCameraCostFunction<ReprojErrorConstantPoint3DCostFunctor>(
+          TypeParam::model_id, this->point2D_, this->point3D_));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      CostFunctor::Create(this->point2D_, this->point3D_));
+  ExpectEqualCostFunctions(*analytic_cost_function,
+                           *autodiff_cost_function,
+                           {this->cam_from_world_rotation_.data(),
+                            this->cam_from_world_translation_.data(),
+                            this->camera_params_.data()});
+}
+
+TYPED_TEST(AnalyticCostFunctionTests, RigReprojErrorCostFunctor) {
+  using CostFunctor = RigReprojErrorCostFunctor<TypeParam>;
+  ASSERT_TRUE(HasAnalyticCostFunction<CostFunctor>::value);
+  std::unique_ptr<ceres::CostFunction> analytic_cost_function(
+      CreateCameraCostFunction<RigReprojErrorCostFunctor>(TypeParam::model_id,
+                                                          this->point2D_));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      CostFunctor::Create(this->point2D_));
+  ExpectEqualCostFunctions(*analytic_cost_function,
+                           *autodiff_cost_function,
+                           {this->cam_from_rig_rotation_.data(),
+                            this->cam_from_rig_translation_.data(),
+                            this->cam_from_world_rotation_.data(),
+                            this->cam_from_world_translation_.data(),
+                            this->point3D_.data(),
+                            this->camera_params_.data()});
+}
+
+TYPED_TEST(AnalyticCostFunctionTests, RigReprojErrorConstantRigCostFunctor) {
+  using CostFunctor = RigReprojErrorConstantRigCostFunctor<TypeParam>;
+  ASSERT_TRUE(HasAnalyticCostFunction<CostFunctor>::value);
+  const Rigid3d cam_from_rig(Eigen::Quaterniond(this->cam_from_rig_rotation_),
+                             this->cam_from_rig_translation_);
+  std::unique_ptr<ceres::CostFunction> analytic_cost_function(
+      CreateCameraCostFunction<RigReprojErrorConstantRigCostFunctor>(
+          TypeParam::model_id, this->point2D_, cam_from_rig));
+  std::unique_ptr<ceres::CostFunction> autodiff_cost_function(
+      CostFunctor::Create(this->point2D_, cam_from_rig));
+  ExpectEqualCostFunctions(*analytic_cost_function,
+                           *autodiff_cost_function,
+                           {this->cam_from_world_rotation_.data(),
+                            this->cam_from_world_translation_.data(),
+                            this->point3D_.data(),
+                            this->camera_params_.data()});
+}
+
+TEST(AnalyticCostFunction, FallbackToAutoDiff) {
+  EXPECT_FALSE(
+      HasAnalyticCostFunction<ReprojErrorCostFunctor<FOVCameraModel>>::value);
+  EXPECT_FALSE(HasAnalyticCostFunction<CovarianceWeightedCostFunctor<
+                   ReprojErrorCostFunctor<PinholeCameraModel>>>::value);
+  std::unique_ptr<ceres::CostFunction> cost_function(
+      CreateCameraCostFunction<ReprojErrorCostFunctor>(
+          CameraModelId::kFOV, Eigen::Vector2d::Zero()));
+  EXPECT_EQ(cost_function->num_residuals(), 2);
+  EXPECT_EQ(cost_function->parameter_block_sizes().size(), 4);
+}
+
 TEST(CovarianceWeightedCostFunctor, ReprojErrorCostFunctor) {
   using CostFunctor = ReprojErrorCostFunctor<SimplePinholeCameraModel>;
   double cam_from_world_rotation[4] = {0, 0, 0, 1};
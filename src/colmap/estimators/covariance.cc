@@ -30,7 +30,9 @@
 #include "colmap/estimators/covariance.h"
 
 #include "colmap/estimators/manifold.h"
+#include "colmap/util/threading.h"
 
+#include <algorithm>
 #include <unordered_set>
 
 #include <ceres/crs_matrix.h>
@@ -175,6 +177,21 @@ bool SchurEliminateOtherParams(double damping,
   return true;
 }
 
+bool IsFullRankLDLT(const Eigen::VectorXd& D_dense) {
+  const int rank = (D_dense.array().abs() > 1e-6).count();
+  if (rank < D_dense.size()) {
+    LOG(WARNING) << StringPrintf(
+        "Unable to compute covariance. The Schur complement on pose/other "
+        "parameters is rank deficient. Number of columns: %d, rank: %d. This "
+        "is likely due to the pose/other parameters being underconstrained "
+        "with Gauge ambiguity or other degeneracies.",
+        static_cast<int>(D_dense.size()),
+        rank);
+    return false;
+  }
+  return true;
+}
+
 bool ComputeLInverse(Eigen::SparseMatrix<double>& S, Eigen::MatrixXd& L_inv) {
   VLOG(2) << "Start sparse Cholesky decomposition (n = " << S.rows() << ")";
   Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt_S(S);
@@ -184,16 +201,7 @@ bool ComputeLInverse(Eigen::SparseMatrix<double>& S, Eigen::MatrixXd& L_inv) {
   }
 
   const Eigen::VectorXd D_dense = ldlt_S.vectorD();
-
-  const int rank = (D_dense.array().abs() > 1e-6).count();
-  if (rank < S.rows()) {
-    LOG(WARNING) << StringPrintf(
-        "Unable to compute covariance. The Schur complement on pose/other "
-        "parameters is rank deficient. Number of columns: %d, rank: %d. This "
-        "is likely due to the pose/other parameters being underconstrained "
-        "with Gauge ambiguity or other degeneracies.",
-        S.rows(),
-        rank);
+  if (!IsFullRankLDLT(D_dense)) {
     return false;
   }
   VLOG(2) << "Finish sparse Cholesky decomposition.";
@@ -210,6 +218,180 @@ bool ComputeLInverse(Eigen::SparseMatrix<double>& S, Eigen::MatrixXd& L_inv) {
   return true;
 }
 
+// Look up the entry (row, col) with row >= col of the lower triangular sparse
+// matrix. Returns null if the entry is not in the sparsity pattern.
+const double* FindLowerEntry(const Eigen::SparseMatrix<double>& A,
+                             int row,
+                             int col) {
+  const int* begin = A.innerIndexPtr() + A.outerIndexPtr()[col];
+  const int* end = A.innerIndexPtr() + A.outerIndexPtr()[col + 1];
+  const int* it = std::lower_bound(begin, end, row);
+  if (it == end || *it != row) {
+    return nullptr;
+  }
+  return A.valuePtr() + (it - A.innerIndexPtr());
+}
+
+// Computes the entries of the inverse of S on the sparsity pattern of its
+// sparse Cholesky factor P S P^T = L D L^T with the Takahashi recursion:
+//
+//   Z_ij = -sum_{k > j} Z_ik L_kj for i > j,
+//   Z_jj = 1 / D_j - sum_{k > j} Z_jk L_kj,
+//
+// where both sums only run over the non-zeros of column j of L. All entries
+// required by column j lie in columns of its ancestors in the elimination
+// tree, so the columns are processed from the root(s) of the tree downwards.
+// Columns at the same depth of the tree and the rows of large columns are
+// processed in parallel. The column callback is called from the calling
+// thread as soon as a column of the selected inverse is final.
+bool ComputeSelectedInverse(const Eigen::SparseMatrix<double>& S,
+                            int num_threads,
+                            const std::function<void(int)>& column_callback,
+                            Eigen::SparseMatrix<double>& S_inv,
+                            Eigen::VectorXi& perm) {
+  if (S.rows() == 0) {
+    S_inv.resize(0, 0);
+    perm.resize(0);
+    return true;
+  }
+
+  VLOG(2) << "Start sparse Cholesky decomposition (n = " << S.rows() << ")";
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt_S(S);
+  if (ldlt_S.info() != Eigen::Success) {
+    LOG(WARNING) << "Simplicial LDLT for selected inversion failed";
+    return false;
+  }
+
+  const Eigen::VectorXd D_dense = ldlt_S.vectorD();
+  if (!IsFullRankLDLT(D_dense)) {
+    return false;
+  }
+  VLOG(2) << "Finish sparse Cholesky decomposition.";
+
+  const int num_cols = S.rows();
+  perm = ldlt_S.permutationP().indices();
+
+  // The selected inverse shares the pattern of L including the diagonal.
+  Eigen::SparseMatrix<double> L_sparse = ldlt_S.matrixL();
+  Eigen::SparseMatrix<double> identity(num_cols, num_cols);
+  identity.setIdentity();
+  S_inv = Eigen::SparseMatrix<double>(
+              L_sparse.triangularView<Eigen::StrictlyLower>()) +
+          identity;
+  S_inv.makeCompressed();
+  const std::vector<double> L_values(S_inv.valuePtr(),
+                                     S_inv.valuePtr() + S_inv.nonZeros());
+  const int* col_starts = S_inv.outerIndexPtr();
+  const int* rows = S_inv.innerIndexPtr();
+  double* values = S_inv.valuePtr();
+
+  // Group the columns by their depth in the elimination tree, where the parent
+  // of a column is the first off-diagonal non-zero in the column of L.
+  std::vector<int> depths(num_cols, 0);
+  std::vector<std::vector<int>> cols_per_depth;
+  for (int col = num_cols - 1; col >= 0; --col) {
+    if (col_starts[col + 1] - col_starts[col] > 1) {
+      depths[col] = depths[rows[col_starts[col] + 1]] + 1;
+    }
+    if (depths[col] >= static_cast<int>(cols_per_depth.size())) {
+      cols_per_depth.resize(depths[col] + 1);
+    }
+    cols_per_depth[depths[col]].push_back(col);
+  }
+
+  // Computes the off-diagonal entries [begin, end) of the column, where the
+  // entries are indexed relative to the first off-diagonal entry.
+  const auto ComputeOffDiagonal = [&](const int col,
+                                      const int begin,
+                                      const int end) {
+    const int offset = col_starts[col] + 1;
+    const int num_entries = col_starts[col + 1] - offset;
+    for (int a = begin; a < end; ++a) {
+      const int row_a = rows[offset + a];
+      double value = 0;
+      for (int b = 0; b < num_entries; ++b) {
+        const int row_b = rows[offset + b];
+        const double* z = row_a >= row_b ? FindLowerEntry(S_inv, row_a, row_b)
+                                         : FindLowerEntry(S_inv, row_b, row_a);
+        value -= *THROW_CHECK_NOTNULL(z) * L_values[offset + b];
+      }
+      values[offset + a] = value;
+    }
+  };
+
+  const auto ComputeDiagonal = [&](const int col) {
+    double value = 1.0 / D_dense(col);
+    for (int idx = col_starts[col] + 1; idx < col_starts[col + 1]; ++idx) {
+      value -= values[idx] * L_values[idx];
+    }
+    values[col_starts[col]] = value;
+  };
+
+  // Minimum number of multiply-adds per task to amortize the scheduling.
+  constexpr int kMinTaskWork = 1 << 14;
+
+  ThreadPool thread_pool(GetEffectiveNumThreads(num_threads));
+  for (const std::vector<int>& cols : cols_per_depth) {
+    int64_t level_work = 0;
+    for (const int col : cols) {
+      const int64_t num_entries = col_starts[col + 1] - col_starts[col] - 1;
+      level_work += num_entries * num_entries;
+    }
+
+    if (thread_pool.NumThreads() == 1 || level_work < kMinTaskWork) {
+      for (const int col : cols) {
+        ComputeOffDiagonal(col, 0, col_starts[col + 1] - col_starts[col] - 1);
+      }
+    } else {
+      for (const int col : cols) {
+        const int num_entries = col_starts[col + 1] - col_starts[col] - 1;
+        const int chunk_size =
+            std::max(1, kMinTaskWork / std::max(1, num_entries));
+        for (int begin = 0; begin < num_entries; begin += chunk_size) {
+          thread_pool.AddTask(ComputeOffDiagonal,
+                              col,
+                              begin,
+                              std::min(begin + chunk_size, num_entries));
+        }
+      }
+      thread_pool.Wait();
+    }
+
+    for (const int col : cols) {
+      ComputeDiagonal(col);
+      if (column_callback) {
+        column_callback(col);
+      }
+    }
+  }
+
+  VLOG(2) << "Finish selected inversion.";
+  return true;
+}
+
+std::optional<Eigen::MatrixXd> ExtractCovFromSelectedInverse(
+    const Eigen::SparseMatrix<double>& S_inv,
+    const Eigen::VectorXi& perm,
+    int row_start,
+    int col_start,
+    int row_block_size,
+    int col_block_size) {
+  Eigen::MatrixXd cov(row_block_size, col_block_size);
+  for (int r = 0; r < row_block_size; ++r) {
+    for (int c = 0; c < col_block_size; ++c) {
+      const int row = perm(row_start + r);
+      const int col = perm(col_start + c);
+      const double* value = row >= col ? FindLowerEntry(S_inv, row, col)
+                                       : FindLowerEntry(S_inv, col, row);
+      if (value == nullptr) {
+        return std::nullopt;
+      }
+      cov(r, c) = *value;
+    }
+  }
+  return cov;
+}
+
 Eigen::MatrixXd ExtractCovFromLInverse(const Eigen::MatrixXd& L_inv,
                                        int row_start,
                                        int col_start,
@@ -219,6 +401,101 @@ Eigen::MatrixXd ExtractCovFromLInverse(const Eigen::MatrixXd& L_inv,
          L_inv.block(0, col_start, L_inv.cols(), col_block_size);
 }
 
+// Estimates the covariances of the pose and other parameters by selected
+// inversion of the Schur complement. If the covariances of the other
+// parameters are not requested, they are kept in the Schur complement with
+// damping instead of being eliminated, which yields the same pose covariances
+// without densifying the Schur complement.
+std::optional<BACovariance> EstimateSelectedCovariance(
+    const BACovarianceOptions& options,
+    bool estimate_other_covs,
+    int pose_num_params,
+    int other_num_params,
+    std::unordered_map<point3D_t, Eigen::MatrixXd> point_covs,
+    std::unordered_map<image_t, std::pair<int, int>> pose_L_start_size,
+    std::unordered_map<const double*, std::pair<int, int>> other_L_start_size,
+    Eigen::SparseMatrix<double>& S) {
+  if (!estimate_other_covs) {
+    for (int i = pose_num_params; i < pose_num_params + other_num_params;
+         ++i) {
+      S.coeffRef(i, i) += options.damping;
+    }
+    other_L_start_size.clear();
+  }
+
+  // Make sure that the requested diagonal blocks are in the sparsity pattern
+  // of the factor, even if some of their entries are structurally zero.
+  std::vector<Eigen::Triplet<double>> block_entries;
+  const auto AddBlockEntries = [&block_entries](const int start,
+                                                const int size) {
+    for (int i = 0; i < size; ++i) {
+      for (int j = 0; j < size; ++j) {
+        block_entries.emplace_back(start + i, start + j, 0.0);
+      }
+    }
+  };
+  for (const auto& [_, start_size] : pose_L_start_size) {
+    AddBlockEntries(start_size.first, start_size.second);
+  }
+  for (const auto& [_, start_size] : other_L_start_size) {
+    AddBlockEntries(start_size.first, start_size.second);
+  }
+  Eigen::SparseMatrix<double> block_pattern(S.rows(), S.cols());
+  block_pattern.setFromTriplets(block_entries.begin(), block_entries.end());
+  S += block_pattern;
+
+  Eigen::SparseMatrix<double> S_inv;
+  Eigen::VectorXi perm;
+
+  // Stream the pose covariances once all their columns are final. The
+  // permutation is only known after the factorization, so the mapping from
+  // columns to poses is built on the first call.
+  std::vector<std::pair<image_t, std::pair<int, int>>> poses;
+  std::vector<int> col_to_pose;
+  std::vector<int> num_remaining_pose_cols;
+  std::function<void(int)> column_callback;
+  if (options.pose_cov_callback) {
+    poses.assign(pose_L_start_size.begin(), pose_L_start_size.end());
+    column_callback = [&](const int col) {
+      if (col_to_pose.empty()) {
+        col_to_pose.resize(perm.size(), -1);
+        num_remaining_pose_cols.resize(poses.size());
+        for (size_t pose_idx = 0; pose_idx < poses.size(); ++pose_idx) {
+          const auto [start, size] = poses[pose_idx].second;
+          num_remaining_pose_cols[pose_idx] = size;
+          for (int i = 0; i < size; ++i) {
+            col_to_pose[perm(start + i)] = pose_idx;
+          }
+        }
+      }
+
+      const int pose_idx = col_to_pose[col];
+      if (pose_idx == -1 || --num_remaining_pose_cols[pose_idx] > 0) {
+        return;
+      }
+      const auto [start, size] = poses[pose_idx].second;
+      const std::optional<Eigen::MatrixXd> cov =
+          ExtractCovFromSelectedInverse(S_inv, perm, start, start, size, size);
+      if (cov.has_value()) {
+        options.pose_cov_callback(poses[pose_idx].first, *cov);
+      }
+    };
+  }
+
+  VLOG(2) << "Computing selected inverse";
+
+  if (!ComputeSelectedInverse(
+          S, options.num_threads, column_callback, S_inv, perm)) {
+    return std::nullopt;
+  }
+
+  return BACovariance(std::move(point_covs),
+                      std::move(pose_L_start_size),
+                      std::move(other_L_start_size),
+                      std::move(S_inv),
+                      std::move(perm));
+}
+
 }  // namespace
 
 BACovariance::BACovariance(
@@ -231,6 +508,34 @@ BACovariance::BACovariance(
       other_L_start_size_(std::move(other_L_start_size)),
       L_inv_(std::move(L_inv)) {}
 
+BACovariance::BACovariance(
+    std::unordered_map<point3D_t, Eigen::MatrixXd> point_covs,
+    std::unordered_map<image_t, std::pair<int, int>> pose_L_start_size,
+    std::unordered_map<const double*, std::pair<int, int>> other_L_start_size,
+    Eigen::SparseMatrix<double> selected_inv,
+    Eigen::VectorXi selected_inv_perm)
+    : point_covs_(std::move(point_covs)),
+      pose_L_start_size_(std::move(pose_L_start_size)),
+      other_L_start_size_(std::move(other_L_start_size)),
+      selected_inv_(std::move(selected_inv)),
+      selected_inv_perm_(std::move(selected_inv_perm)) {}
+
+std::optional<Eigen::MatrixXd> BACovariance::ExtractCov(int row_start,
+                                                        int col_start,
+                                                        int row_size,
+                                                        int col_size) const {
+  if (selected_inv_perm_.size() > 0) {
+    return ExtractCovFromSelectedInverse(selected_inv_,
+                                         selected_inv_perm_,
+                                         row_start,
+                                         col_start,
+                                         row_size,
+                                         col_size);
+  }
+  return ExtractCovFromLInverse(
+      L_inv_, row_start, col_start, row_size, col_size);
+}
+
 std::optional<Eigen::MatrixXd> BACovariance::GetPointCov(
     point3D_t point3D_id) const {
   const auto it = point_covs_.find(point3D_id);
@@ -247,7 +552,7 @@ std::optional<Eigen::MatrixXd> BACovariance::GetCamCovFromWorld(
     return std::nullopt;
   }
   const auto [start, size] = it->second;
-  return ExtractCovFromLInverse(L_inv_, start, start, size, size);
+  return ExtractCov(start, start, size, size);
 }
 
 std::optional<Eigen::MatrixXd> BACovariance::GetCamCrossCovFromWorld(
@@ -259,7 +564,7 @@ std::optional<Eigen::MatrixXd> BACovariance::GetCamCrossCovFromWorld(
   }
   const auto [start1, size1] = it1->second;
   const auto [start2, size2] = it2->second;
-  return ExtractCovFromLInverse(L_inv_, start1, start2, size1, size2);
+  return ExtractCov(start1, start2, size1, size2);
 }
 
 std::optional<Eigen::MatrixXd> BACovariance::GetCam2CovFromCam1(
@@ -282,7 +587,9 @@ std::optional<Eigen::MatrixXd> BACovariance::GetCam2CovFromCam1(
     return std::nullopt;
   }
   auto cov_12 = GetCamCrossCovFromWorld(image_id1, image_id2);
-  THROW_CHECK(cov_12.has_value());
+  if (!cov_12.has_value()) {
+    return std::nullopt;
+  }
   Eigen::Matrix<double, 12, 12> cov;
   cov.block<6, 6>(0, 0) = *cov_11;
   cov.block<6, 6>(6, 6) = *cov_22;
@@ -298,14 +605,18 @@ std::optional<Eigen::MatrixXd> BACovariance::GetOtherParamsCov(
     return std::nullopt;
   }
   const auto [start, size] = it->second;
-  return ExtractCovFromLInverse(L_inv_, start, start, size, size);
+  return ExtractCov(start, start, size, size);
 }
 
 std::optional<BACovariance> EstimateBACovariance(
     const BACovarianceOptions& options,
     const Reconstruction& reconstruction,
     BundleAdjuster& bundle_adjuster) {
-  ceres::Problem& problem = *THROW_CHECK_NOTNULL(bundle_adjuster.Problem());
+  THROW_CHECK(bundle_adjuster.Problem() != nullptr)
+      << "The bundle adjuster has no Ceres problem, e.g., when using the "
+         "batched solver. Use EstimateBACovarianceFromProblem with the problem "
+         "of a bundle adjuster without use_batched_solver instead.";
+  ceres::Problem& problem = *bundle_adjuster.Problem();
   return EstimateBACovarianceFromProblem(options, reconstruction, problem);
 }
 
@@ -389,6 +700,17 @@ std::optional<BACovariance> EstimateBACovarianceFromProblem(
                         /*L_inv=*/Eigen::MatrixXd());
   }
 
+  if (options.use_selected_inversion) {
+    return EstimateSelectedCovariance(options,
+                                      estimate_other_covs,
+                                      pose_num_params,
+                                      other_num_params,
+                                      std::move(point_covs),
+                                      std::move(pose_L_start_size),
+                                      std::move(other_L_start_size),
+                                      S);
+  }
+
   if (!estimate_other_covs) {
     if (!SchurEliminateOtherParams(
             options.damping, pose_num_params, other_num_params, S)) {
@@ -33,6 +33,7 @@
 #include "colmap/geometry/rigid3.h"
 #include "colmap/scene/reconstruction.h"
 
+#include <functional>
 #include <optional>
 #include <unordered_map>
 #include <vector>
@@ -54,6 +55,17 @@ struct BACovariance {
       std::unordered_map<const double*, std::pair<int, int>> other_L_start_size,
       Eigen::MatrixXd L_inv);
 
+  // Covariance from the selected inverse of the Schur complement, see
+  // BACovarianceOptions::use_selected_inversion. The selected inverse holds
+  // the lower triangle of the inverse in the permuted order of its Cholesky
+  // factor on the sparsity pattern of the factor.
+  BACovariance(
+      std::unordered_map<point3D_t, Eigen::MatrixXd> point_covs,
+      std::unordered_map<image_t, std::pair<int, int>> pose_L_start_size,
+      std::unordered_map<const double*, std::pair<int, int>> other_L_start_size,
+      Eigen::SparseMatrix<double> selected_inv,
+      Eigen::VectorXi selected_inv_perm);
+
   // Covariance for 3D points, conditioned on all other variables set constant.
   // If some dimensions are kept constant, the respective rows/columns are
   // omitted. Returns null if 3D point not a variable in the problem.
@@ -61,7 +73,9 @@ struct BACovariance {
 
   // Tangent space covariance in the order [rotation, translation]. If some
   // dimensions are kept constant, the respective rows/columns are omitted.
-  // Returns null if image is not a variable in the problem.
+  // Returns null if image is not a variable in the problem. With selected
+  // inversion, the cross-covariance is only available for images that are
+  // coupled in the sparse Cholesky factor, e.g., by common 3D points.
   std::optional<Eigen::MatrixXd> GetCamCovFromWorld(image_t image_id) const;
   std::optional<Eigen::MatrixXd> GetCamCrossCovFromWorld(
       image_t image_id1, image_t image_id2) const;
@@ -83,11 +97,18 @@ struct BACovariance {
   std::optional<Eigen::MatrixXd> GetOtherParamsCov(const double* params) const;
 
  private:
+  std::optional<Eigen::MatrixXd> ExtractCov(int row_start,
+                                            int col_start,
+                                            int row_size,
+                                            int col_size) const;
+
   const std::unordered_map<point3D_t, Eigen::MatrixXd> point_covs_;
   const std::unordered_map<image_t, std::pair<int, int>> pose_L_start_size_;
   const std::unordered_map<const double*, std::pair<int, int>>
       other_L_start_size_;
   const Eigen::MatrixXd L_inv_;
+  const Eigen::SparseMatrix<double> selected_inv_;
+  const Eigen::VectorXi selected_inv_perm_;
 };
 
 struct BACovarianceOptions {
@@ -105,6 +126,23 @@ struct BACovarianceOptions {
   // Enables to robustly deal with poorly conditioned parameters.
   double damping = 1e-8;
 
+  // Whether to compute the covariances of poses and other parameters by
+  // selected inversion of the sparse Cholesky factor of the Schur complement
+  // (Takahashi recursion) instead of inverting the factor densely. Only the
+  // entries of the inverse on the sparsity pattern of the factor are
+  // computed, which include all diagonal blocks. This scales to much larger
+  // problems in memory and time.
+  bool use_selected_inversion = false;
+
+  // The number of threads for the selected inversion.
+  int num_threads = -1;
+
+  // Optional callback to stream pose covariances, as returned by
+  // BACovariance::GetCamCovFromWorld, as soon as they are computed by the
+  // selected inversion, e.g., to write them to disk while the inversion is
+  // still running. Called from the calling thread.
+  std::function<void(image_t, const Eigen::MatrixXd&)> pose_cov_callback;
+
   // WARNING: This option will be removed in a future release, use at your own
   // risk. For custom bundle adjustment problems, this enables to specify a
   // custom set of pose parameter blocks to consider. Note that these pose
@@ -121,7 +159,8 @@ struct BACovarianceOptions {
 // Schur complement trick. This is the case for the standard configuration of
 // bundle adjustment problems, but be careful if you modify the underlying
 // problem with custom residuals.
-// Returns null if the estimation was not successful.
+// Returns null if the estimation was not successful. Throws if the bundle
+// adjuster has no Ceres problem, as for the batched solver.
 std::optional<BACovariance> EstimateBACovariance(
     const BACovarianceOptions& options,
     const Reconstruction& reconstruction,
@@ -343,7 +343,102 @@ INSTANTIATE_TEST_SUITE_P(
           options.params = BACovarianceOptions::Params::POSES_AND_POINTS;
           BACovarianceTestOptions test_options;
           return std::make_pair(options, test_options);
+        }(),
+        []() {
+          BACovarianceOptions options;
+          options.params = BACovarianceOptions::Params::ALL;
+          options.use_selected_inversion = true;
+          BACovarianceTestOptions test_options;
+          return std::make_pair(options, test_options);
+        }(),
+        []() {
+          BACovarianceOptions options;
+          options.params = BACovarianceOptions::Params::POSES;
+          options.use_selected_inversion = true;
+          BACovarianceTestOptions test_options;
+          return std::make_pair(options, test_options);
+        }(),
+        []() {
+          BACovarianceOptions options;
+          options.params = BACovarianceOptions::Params::ALL;
+          options.use_selected_inversion = true;
+          options.num_threads = 4;
+          BACovarianceTestOptions test_options;
+          test_options.fixed_cam_intrinsics = true;
+          return std::make_pair(options, test_options);
         }()));
 
+TEST(EstimateBACovariance, SelectedInversionStreamsPoseCovs) {
+  SetPRNGSeed(42);
+
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 1;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 7;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 0.01;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (const auto& [image_id, _] : reconstruction.Images()) {
+    config.AddImage(image_id);
+  }
+  int num_constant_points = 0;
+  for (const auto& [point3D_id, _] : reconstruction.Points3D()) {
+    if (++num_constant_points <= 3) {
+      config.AddConstantPoint(point3D_id);
+    }
+  }
+
+  std::unique_ptr<BundleAdjuster> bundle_adjuster = CreateDefaultBundleAdjuster(
+      BundleAdjustmentOptions(), std::move(config), reconstruction);
+  ASSERT_TRUE(bundle_adjuster->Solve().IsSolutionUsable());
+
+  BACovarianceOptions options;
+  options.params = BACovarianceOptions::Params::POSES;
+  options.use_selected_inversion = true;
+  std::unordered_map<image_t, Eigen::MatrixXd> streamed_covs;
+  options.pose_cov_callback = [&streamed_covs](image_t image_id,
+                                               const Eigen::MatrixXd& cov) {
+    EXPECT_TRUE(streamed_covs.emplace(image_id, cov).second);
+  };
+
+  const std::optional<BACovariance> ba_cov =
+      EstimateBACovariance(options, reconstruction, *bundle_adjuster);
+  ASSERT_TRUE(ba_cov.has_value());
+  EXPECT_EQ(streamed_covs.size(), reconstruction.NumImages());
+  for (const auto& [image_id, cov] : streamed_covs) {
+    const std::optional<Eigen::MatrixXd> expected_cov =
+        ba_cov->GetCamCovFromWorld(image_id);
+    ASSERT_TRUE(expected_cov.has_value());
+    ExpectNearEigenMatrixXd(*expected_cov, cov, /*tol=*/1e-12);
+  }
+}
+
+TEST(EstimateBACovariance, RejectsBundleAdjusterWithoutProblem) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 1;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = 3;
+  synthetic_dataset_options.num_points3D = 50;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (const auto& [image_id, _] : reconstruction.Images()) {
+    config.AddImage(image_id);
+  }
+
+  BundleAdjustmentOptions ba_options;
+  ba_options.use_batched_solver = true;
+  std::unique_ptr<BundleAdjuster> bundle_adjuster = CreateDefaultBundleAdjuster(
+      ba_options, std::move(config), reconstruction);
+  ASSERT_EQ(bundle_adjuster->Problem(), nullptr);
+  EXPECT_THROW(EstimateBACovariance(
+                   BACovarianceOptions(), reconstruction, *bundle_adjuster),
+               std::invalid_argument);
+}
+
 }  // namespace
 }  // namespace colmap
@@ -0,0 +1,191 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/global_positioning.h"
+
+#include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/estimators/cost_functions.h"
+#include "colmap/math/math.h"
+#include "colmap/math/random.h"
+#include "colmap/util/threading.h"
+
+#include <cmath>
+#include <limits>
+
+#include <ceres/ceres.h>
+
+namespace colmap {
+namespace {
+
+bool SolveGlobalPositions(const GlobalPositioningOptions& options,
+                          const std::vector<PositionDirection>& directions,
+                          const std::vector<char>& direction_mask,
+                          std::vector<Eigen::Vector3d>* positions) {
+  ceres::Problem::Options problem_options;
+  problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  ceres::Problem problem(problem_options);
+  ceres::HuberLoss loss_function(options.loss_function_scale);
+
+  std::vector<double> scales(directions.size(), 1.0);
+  double* fixed_position = nullptr;
+  for (size_t i = 0; i < directions.size(); ++i) {
+    if (!direction_mask[i]) {
+      continue;
+    }
+    const PositionDirection& direction = directions[i];
+    double* position1 = (*positions)[direction.position_idx1].data();
+    double* position2 = (*positions)[direction.position_idx2].data();
+    problem.AddResidualBlock(
+        PairwiseDirectionErrorCostFunctor::Create(direction.direction),
+        &loss_function,
+        position1,
+        position2,
+        &scales[i]);
+    problem.SetParameterLowerBound(&scales[i], 0, options.min_scale);
+    if (fixed_position == nullptr) {
+      fixed_position = position1;
+    }
+  }
+
+  if (fixed_position == nullptr) {
+    return false;
+  }
+
+  // Fix the translational gauge freedom.
+  problem.SetParameterBlockConstant(fixed_position);
+
+  ceres::Solver::Options solver_options;
+  solver_options.max_num_iterations = options.max_num_iterations;
+  if (solver_options.sparse_linear_algebra_library_type != ceres::NO_SPARSE) {
+    solver_options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+  } else {
+    solver_options.linear_solver_type = ceres::CGNR;
+    solver_options.preconditioner_type = ceres::JACOBI;
+  }
+  solver_options.num_threads = GetEffectiveNumThreads(options.num_threads);
+  solver_options.logging_type = ceres::LoggingType::SILENT;
+
+  ceres::Solver::Summary summary;
+  ceres::Solve(solver_options, &problem, &summary);
+
+  if (options.print_summary || VLOG_IS_ON(1)) {
+    PrintSolverSummary(summary, "Global positioning report");
+  }
+
+  return summary.IsSolutionUsable();
+}
+
+}  // namespace
+
+bool GlobalPositioningOptions::Check() const {
+  CHECK_OPTION_GT(loss_function_scale, 0.0);
+  CHECK_OPTION_GT(min_scale, 0.0);
+  CHECK_OPTION_GT(max_angular_error_deg, 0.0);
+  CHECK_OPTION_GE(max_num_iterations, 0);
+  CHECK_OPTION_GE(random_seed, -1);
+  return true;
+}
+
+bool EstimateGlobalPositions(const GlobalPositioningOptions& options,
+                             const std::vector<PositionDirection>& directions,
+                             const size_t num_positions,
+                             std::vector<Eigen::Vector3d>* positions,
+                             std::vector<char>* inlier_mask) {
+  THROW_CHECK(options.Check());
+  THROW_CHECK_NOTNULL(positions);
+
+  if (options.random_seed != -1) {
+    SetPRNGSeed(options.random_seed);
+  }
+
+  std::vector<char> constrained(num_positions, false);
+  std::vector<char> direction_mask(directions.size(), false);
+  for (size_t i = 0; i < directions.size(); ++i) {
+    const PositionDirection& direction = directions[i];
+    THROW_CHECK_LT(direction.position_idx1, num_positions);
+    THROW_CHECK_LT(direction.position_idx2, num_positions);
+    if (direction.position_idx1 == direction.position_idx2 ||
+        direction.direction.squaredNorm() == 0) {
+      continue;
+    }
+    direction_mask[i] = true;
+    constrained[direction.position_idx1] = true;
+    constrained[direction.position_idx2] = true;
+  }
+
+  positions->resize(num_positions);
+  for (size_t i = 0; i < num_positions; ++i) {
+    if (constrained[i]) {
+      for (int d = 0; d < 3; ++d) {
+        (*positions)[i](d) = RandomUniformReal<double>(-100, 100);
+      }
+    } else {
+      (*positions)[i].setConstant(std::numeric_limits<double>::quiet_NaN());
+    }
+  }
+
+  const double min_cos_angle =
+      std::cos(DegToRad(options.max_angular_error_deg));
+  const auto is_inlier = [&](const PositionDirection& direction) {
+    const Eigen::Vector3d baseline = (*positions)[direction.position_idx2] -
+                                     (*positions)[direction.position_idx1];
+    const double baseline_norm = baseline.norm();
+    return baseline_norm > 0 &&
+           baseline.dot(direction.direction) >=
+               min_cos_angle * baseline_norm * direction.direction.norm();
+  };
+
+  // Solve once on all directions, remove the outliers, and refine the
+  // positions on the remaining directions.
+  if (!SolveGlobalPositions(options, directions, direction_mask, positions)) {
+    return false;
+  }
+  size_t num_outliers = 0;
+  for (size_t i = 0; i < directions.size(); ++i) {
+    if (direction_mask[i] && !is_inlier(directions[i])) {
+      direction_mask[i] = false;
+      ++num_outliers;
+    }
+  }
+  if (num_outliers > 0 &&
+      !SolveGlobalPositions(options, directions, direction_mask, positions)) {
+    return false;
+  }
+
+  if (inlier_mask != nullptr) {
+    inlier_mask->resize(directions.size());
+    for (size_t i = 0; i < directions.size(); ++i) {
+      (*inlier_mask)[i] = direction_mask[i] && is_inlier(directions[i]);
+    }
+  }
+
+  return true;
+}
+
+}  // namespace colmap
@@ -0,0 +1,100 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/util/eigen_alignment.h"
+#include "colmap/util/logging.h"
+
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace colmap {
+
+struct GlobalPositioningOptions {
+  // Scaling factor determines at which residual robustification takes place.
+  double loss_function_scale = 0.1;
+
+  // Lower bound on the per-direction scale, which prevents the trivial
+  // solution of all positions collapsing to a single point.
+  double min_scale = 1e-5;
+
+  // Maximum angular error in degrees between a measured direction and the
+  // direction between the estimated positions for the measurement to be an
+  // inlier. Outliers are removed before a second round of optimization.
+  double max_angular_error_deg = 10.0;
+
+  // Maximum number of solver iterations per round.
+  int max_num_iterations = 200;
+
+  // Number of threads used by the solver.
+  int num_threads = -1;
+
+  // PRNG seed for the random initialization of the positions. If -1 (default),
+  // the seed is derived from the current time (non-deterministic).
+  int random_seed = -1;
+
+  // Whether to print final summary.
+  bool print_summary = false;
+
+  bool Check() const;
+};
+
+// Measured direction between two unknown positions, e.g., from the center of
+// one frame to the center of another frame or to an observed 3D point.
+struct PositionDirection {
+  size_t position_idx1 = 0;
+  size_t position_idx2 = 0;
+  // Unit direction from the first to the second position in world frame.
+  Eigen::Vector3d direction = Eigen::Vector3d::Zero();
+};
+
+// Estimate positions from relative directions using the bilinear angle-based
+// translation averaging formulation (BATA), in which each measured direction
+// constrains the scaled difference of the two positions. The positions are
+// randomly initialized, so the problem does not rely on any initial guess.
+// The result is defined up to a global similarity transformation.
+//
+// @param options              Global positioning options.
+// @param directions           Measured directions between positions.
+// @param num_positions        Number of unknown positions.
+// @param positions            Estimated positions. Positions that are not
+//                             constrained by any direction are set to NaN.
+// @param inlier_mask          Whether each direction is consistent with the
+//                             estimated positions.
+//
+// @return                     Whether the positions were estimated.
+bool EstimateGlobalPositions(const GlobalPositioningOptions& options,
+                             const std::vector<PositionDirection>& directions,
+                             size_t num_positions,
+                             std::vector<Eigen::Vector3d>* positions,
+                             std::vector<char>* inlier_mask = nullptr);
+
+}  // namespace colmap
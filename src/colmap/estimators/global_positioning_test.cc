@@ -0,0 +1,132 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/global_positioning.h"
+
+#include "colmap/math/math.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+std::vector<PositionDirection> GenerateDirections(
+    const std::vector<Eigen::Vector3d>& positions) {
+  std::vector<PositionDirection> directions;
+  for (size_t i = 0; i < positions.size(); ++i) {
+    for (size_t j = i + 1; j < positions.size(); ++j) {
+      PositionDirection& direction = directions.emplace_back();
+      direction.position_idx1 = i;
+      direction.position_idx2 = j;
+      direction.direction = (positions[j] - positions[i]).normalized();
+    }
+  }
+  return directions;
+}
+
+void ExpectConsistentPositions(
+    const std::vector<Eigen::Vector3d>& expected_positions,
+    const std::vector<Eigen::Vector3d>& positions) {
+  ASSERT_EQ(positions.size(), expected_positions.size());
+  for (size_t i = 0; i < expected_positions.size(); ++i) {
+    for (size_t j = i + 1; j < expected_positions.size(); ++j) {
+      const Eigen::Vector3d expected_direction =
+          (expected_positions[j] - expected_positions[i]).normalized();
+      const Eigen::Vector3d direction =
+          (positions[j] - positions[i]).normalized();
+      EXPECT_GT(expected_direction.dot(direction),
+                std::cos(DegToRad(0.1)));
+    }
+  }
+}
+
+TEST(EstimateGlobalPositions, Nominal) {
+  std::vector<Eigen::Vector3d> expected_positions;
+  for (int i = 0; i < 10; ++i) {
+    expected_positions.push_back(Eigen::Vector3d::Random());
+  }
+  const std::vector<PositionDirection> directions =
+      GenerateDirections(expected_positions);
+
+  GlobalPositioningOptions options;
+  options.random_seed = 42;
+  std::vector<Eigen::Vector3d> positions;
+  std::vector<char> inlier_mask;
+  EXPECT_TRUE(EstimateGlobalPositions(options,
+                                      directions,
+                                      expected_positions.size(),
+                                      &positions,
+                                      &inlier_mask));
+  ExpectConsistentPositions(expected_positions, positions);
+  EXPECT_EQ(inlier_mask, std::vector<char>(directions.size(), true));
+}
+
+TEST(EstimateGlobalPositions, WithOutliers) {
+  std::vector<Eigen::Vector3d> expected_positions;
+  for (int i = 0; i < 10; ++i) {
+    expected_positions.push_back(Eigen::Vector3d::Random());
+  }
+  std::vector<PositionDirection> directions =
+      GenerateDirections(expected_positions);
+  for (size_t i = 0; i < directions.size(); i += 9) {
+    directions[i].direction *= -1;
+  }
+
+  GlobalPositioningOptions options;
+  options.random_seed = 42;
+  std::vector<Eigen::Vector3d> positions;
+  std::vector<char> inlier_mask;
+  EXPECT_TRUE(EstimateGlobalPositions(options,
+                                      directions,
+                                      expected_positions.size(),
+                                      &positions,
+                                      &inlier_mask));
+  ExpectConsistentPositions(expected_positions, positions);
+  for (size_t i = 0; i < directions.size(); ++i) {
+    EXPECT_EQ(inlier_mask[i], i % 9 != 0);
+  }
+}
+
+TEST(EstimateGlobalPositions, UnconstrainedPositions) {
+  std::vector<PositionDirection> directions(1);
+  directions[0].position_idx1 = 0;
+  directions[0].position_idx2 = 2;
+  directions[0].direction = Eigen::Vector3d(0, 0, 1);
+
+  GlobalPositioningOptions options;
+  options.random_seed = 42;
+  std::vector<Eigen::Vector3d> positions;
+  EXPECT_TRUE(EstimateGlobalPositions(options, directions, 3, &positions));
+  ASSERT_EQ(positions.size(), 3);
+  EXPECT_TRUE(positions[1].array().isNaN().all());
+  EXPECT_GT((positions[2] - positions[0]).normalized().z(), 0.999);
+}
+
+}  // namespace
+}  // namespace colmap
@@ -0,0 +1,846 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
+
+#include "colmap/estimators/cost_functions.h"
+#include "colmap/scene/scene_clustering.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/misc.h"
+#include "colmap/util/threading.h"
+#include "colmap/util/timer.h"
+
+#include <algorithm>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+namespace colmap {
+namespace {
+
+// Weighted deviation of a parameter block from a prior. The size of the
+// parameter block is only known at runtime for camera parameters.
+class ParameterPriorCostFunction : public ceres::CostFunction {
+ public:
+  ParameterPriorCostFunction(Eigen::VectorXd prior,
+                             Eigen::VectorXd sqrt_weights)
+      : prior_(std::move(prior)), sqrt_weights_(std::move(sqrt_weights)) {
+    THROW_CHECK_EQ(prior_.size(), sqrt_weights_.size());
+    set_num_residuals(prior_.size());
+    mutable_parameter_block_sizes()->push_back(prior_.size());
+  }
+
+  bool Evaluate(double const* const* parameters,
+                double* residuals,
+                double** jacobians) const override {
+    const Eigen::Index size = prior_.size();
+    Eigen::Map<Eigen::VectorXd>(residuals, size) = sqrt_weights_.cwiseProduct(
+        Eigen::Map<const Eigen::VectorXd>(parameters[0], size) - prior_);
+    if (jacobians != nullptr && jacobians[0] != nullptr) {
+      Eigen::Map<Eigen::Matrix<double,
+                               Eigen::Dynamic,
+                               Eigen::Dynamic,
+                               Eigen::RowMajor>>(jacobians[0], size, size) =
+          sqrt_weights_.asDiagonal();
+    }
+    return true;
+  }
+
+ private:
+  const Eigen::VectorXd prior_;
+  const Eigen::VectorXd sqrt_weights_;
+};
+
+// Difference of two poses in the space of the AbsolutePosePriorCostFunctor
+// residual, i.e., the rotation error followed by the translation error of
+// a_from_b, such that a = PosePlus(PoseMinus(a, b), b).
+Eigen::Vector6d PoseMinus(const Rigid3d& a, const Rigid3d& b) {
+  const Eigen::Quaterniond a_from_b_rotation =
+      a.rotation * b.rotation.inverse();
+  const Eigen::AngleAxisd a_from_b_angle_axis(a_from_b_rotation);
+  Eigen::Vector6d delta;
+  delta.head<3>() = a_from_b_angle_axis.angle() * a_from_b_angle_axis.axis();
+  delta.tail<3>() = a.translation - a_from_b_rotation * b.translation;
+  return delta;
+}
+
+Rigid3d PosePlus(const Eigen::Vector6d& delta, const Rigid3d& b) {
+  const double angle = delta.head<3>().norm();
+  Eigen::Quaterniond rotation = Eigen::Quaterniond::Identity();
+  if (angle > 0) {
+    rotation = Eigen::AngleAxisd(angle, delta.head<3>() / angle);
+  }
+  Rigid3d a = Rigid3d(rotation, delta.tail<3>()) * b;
+  a.rotation.normalize();
+  return a;
+}
+
+// Consensus value of a parameter shared between multiple partitions and the
+// scaled dual variables of the partitions, in the order of partition_idxs.
+template <typename Value>
+struct Consensus {
+  Value value;
+  std::vector<size_t> partition_idxs;
+  std::vector<Eigen::VectorXd> duals;
+};
+
+// Penalty and residuals of the consensus of one type of parameters.
+struct ConsensusState {
+  double penalty = 0;
+  double primal_residual_sq = 0;
+  double dual_residual_sq = 0;
+  size_t num_residuals = 0;
+
+  void ResetResiduals() {
+    primal_residual_sq = 0;
+    dual_residual_sq = 0;
+    num_residuals = 0;
+  }
+};
+
+// Averages the local values of the partitions offset by their duals to obtain
+// the new consensus value and updates the duals with the primal residuals.
+// The dual residual is measured as the change of the consensus value, so
+// that it has the same units as the primal residual.
+template <typename Value, typename MinusFunc, typename PlusFunc>
+void UpdateConsensusValue(const std::vector<Value>& local_values,
+                          MinusFunc minus,
+                          PlusFunc plus,
+                          Consensus<Value>& consensus,
+                          ConsensusState& state) {
+  const size_t num_partitions = local_values.size();
+  THROW_CHECK_EQ(num_partitions, consensus.duals.size());
+
+  Eigen::VectorXd mean_delta =
+      Eigen::VectorXd::Zero(consensus.duals.front().size());
+  for (size_t i = 0; i < num_partitions; ++i) {
+    mean_delta += minus(local_values[i], consensus.value) + consensus.duals[i];
+  }
+  mean_delta /= num_partitions;
+
+  const Value prev_value = consensus.value;
+  consensus.value = plus(mean_delta, prev_value);
+
+  for (size_t i = 0; i < num_partitions; ++i) {
+    const Eigen::VectorXd primal_residual =
+        minus(local_values[i], consensus.value);
+    consensus.duals[i] += primal_residual;
+    state.primal_residual_sq += primal_residual.squaredNorm();
+    state.num_residuals += primal_residual.size();
+  }
+  state.dual_residual_sq +=
+      num_partitions * minus(consensus.value, prev_value).squaredNorm();
+}
+
+// Residual balancing: increase the penalty if the partitions disagree much
+// more than the consensus moves, and vice versa. The scaled duals are
+// inversely proportional to the penalty.
+template <typename ConsensusMap>
+void AdaptPenalty(ConsensusMap& consensuses, ConsensusState& state) {
+  constexpr double kResidualRatio = 10;
+  constexpr double kPenaltyFactor = 2;
+  double factor = 1;
+  if (state.primal_residual_sq >
+      kResidualRatio * kResidualRatio * state.dual_residual_sq) {
+    factor = kPenaltyFactor;
+  } else if (state.dual_residual_sq >
+             kResidualRatio * kResidualRatio * state.primal_residual_sq) {
+    factor = 1 / kPenaltyFactor;
+  }
+  if (factor == 1) {
+    return;
+  }
+  state.penalty *= factor;
+  for (auto& [_, consensus] : consensuses) {
+    for (Eigen::VectorXd& dual : consensus.duals) {
+      dual /= factor;
+    }
+  }
+}
+
+std::vector<std::vector<image_t>> PartitionImages(
+    const PartitionedBundleAdjustmentOptions& options,
+    const BundleAdjustmentConfig& config,
+    const Reconstruction& reconstruction) {
+  if (config.NumImages() <= static_cast<size_t>(options.leaf_max_num_images)) {
+    return {};
+  }
+
+  // Weight the covisibility graph by the number of shared 3D points.
+  std::unordered_map<image_pair_t, int> num_shared_points3D;
+  std::vector<image_t> track_image_ids;
+  for (const auto& [_, point3D] : reconstruction.Points3D()) {
+    track_image_ids.clear();
+    for (const auto& track_el : point3D.track.Elements()) {
+      if (config.HasImage(track_el.image_id)) {
+        track_image_ids.push_back(track_el.image_id);
+      }
+    }
+    std::sort(track_image_ids.begin(), track_image_ids.end());
+    track_image_ids.erase(
+        std::unique(track_image_ids.begin(), track_image_ids.end()),
+        track_image_ids.end());
+    for (size_t i = 0; i < track_image_ids.size(); ++i) {
+      for (size_t j = i + 1; j < track_image_ids.size(); ++j) {
+        ++num_shared_points3D[ImagePairToPairId(track_image_ids[i],
+                                                track_image_ids[j])];
+      }
+    }
+  }
+
+  if (num_shared_points3D.empty()) {
+    return {};
+  }
+
+  std::vector<std::pair<image_t, image_t>> image_pairs;
+  image_pairs.reserve(num_shared_points3D.size());
+  std::vector<int> weights;
+  weights.reserve(num_shared_points3D.size());
+  for (const auto& [pair_id, num_points3D] : num_shared_points3D) {
+    image_pairs.push_back(PairIdToImagePair(pair_id));
+    weights.push_back(num_points3D);
+  }
+
+  SceneClustering::Options clustering_options;
+  clustering_options.leaf_max_num_images = options.leaf_max_num_images;
+  clustering_options.image_overlap = options.image_overlap;
+  SceneClustering scene_clustering(clustering_options);
+  scene_clustering.Partition(image_pairs, weights);
+
+  std::vector<std::vector<image_t>> partition_image_ids;
+  std::unordered_set<image_t> partitioned_image_ids;
+  for (const auto* cluster : scene_clustering.GetLeafClusters()) {
+    partition_image_ids.push_back(cluster->image_ids);
+    partitioned_image_ids.insert(cluster->image_ids.begin(),
+                                 cluster->image_ids.end());
+  }
+
+  // Images without any shared 3D points do not couple to any other image and
+  // are added to the smallest partition.
+  for (const image_t image_id : config.Images()) {
+    if (partitioned_image_ids.count(image_id) == 0) {
+      std::min_element(partition_image_ids.begin(),
+                       partition_image_ids.end(),
+                       [](const auto& image_ids1, const auto& image_ids2) {
+                         return image_ids1.size() < image_ids2.size();
+                       })
+          ->push_back(image_id);
+    }
+  }
+
+  return partition_image_ids;
+}
+
+class PartitionedBundleAdjuster : public BundleAdjuster {
+ public:
+  PartitionedBundleAdjuster(
+      BundleAdjustmentOptions options,
+      PartitionedBundleAdjustmentOptions partitioned_options,
+      BundleAdjustmentConfig config,
+      std::vector<std::vector<image_t>> partition_image_ids,
+      Reconstruction& reconstruction)
+      : BundleAdjuster(std::move(options), std::move(config)),
+        partitioned_options_(std::move(partitioned_options)),
+        partition_image_ids_(std::move(partition_image_ids)),
+        reconstruction_(reconstruction) {
+    THROW_CHECK_GT(partition_image_ids_.size(), 1);
+    if (options_.refine_sensor_from_rig) {
+      for (const auto& [_, rig] : reconstruction_.Rigs()) {
+        if (rig.NumSensors() > 1) {
+          LOG(WARNING) << "Partitioned bundle adjustment keeps sensor from "
+                          "rig poses constant.";
+          break;
+        }
+      }
+    }
+  }
+
+  ceres::Solver::Summary Solve() override {
+    Timer timer;
+    timer.Start();
+
+    // Normalize the reconstruction such that positions and translations have
+    // comparable magnitudes for the consensus penalty.
+    const Sim3d normalized_from_metric = reconstruction_.Normalize();
+
+    SetUpPartitions();
+    SetUpConsensus();
+
+    const int num_workers =
+        std::min(GetEffectiveNumThreads(partitioned_options_.num_workers),
+                 static_cast<int>(partitions_.size()));
+    num_threads_per_worker_ = std::max(
+        1,
+        GetEffectiveNumThreads(options_.solver_options.num_threads) /
+            num_workers);
+    ThreadPool thread_pool(num_workers);
+
+    ceres::Solver::Summary summary;
+    summary.num_successful_steps = 0;
+    summary.num_unsuccessful_steps = 0;
+    summary.termination_type = ceres::NO_CONVERGENCE;
+    summary.num_threads_given = options_.solver_options.num_threads;
+    summary.num_threads_used = num_workers * num_threads_per_worker_;
+
+    for (int iteration = 1;
+         iteration <= partitioned_options_.max_num_iterations;
+         ++iteration) {
+      std::vector<std::future<ceres::Solver::Summary>> futures;
+      futures.reserve(partitions_.size());
+      for (size_t partition_idx = 0; partition_idx < partitions_.size();
+           ++partition_idx) {
+        futures.push_back(thread_pool.AddTask(
+            &PartitionedBundleAdjuster::SolvePartition, this, partition_idx));
+      }
+
+      double cost = 0;
+      int num_residuals = 0;
+      int num_parameters = 0;
+      bool terminated_by_user = false;
+      for (auto& future : futures) {
+        const ceres::Solver::Summary partition_summary = future.get();
+        cost += partition_summary.final_cost;
+        num_residuals += partition_summary.num_residuals_reduced;
+        num_parameters += partition_summary.num_effective_parameters_reduced;
+        if (partition_summary.termination_type == ceres::USER_SUCCESS) {
+          terminated_by_user = true;
+        }
+      }
+
+      if (iteration == 1) {
+        summary.initial_cost = cost;
+        summary.num_residuals_reduced = num_residuals;
+        summary.num_effective_parameters_reduced = num_parameters;
+      }
+      summary.final_cost = cost;
+      ++summary.num_successful_steps;
+
+      const double residual = UpdateConsensus();
+
+      if (options_.print_summary || VLOG_IS_ON(1)) {
+        LOG(INFO) << StringPrintf(
+            "Consensus iteration %d: cost=%e, residual=%e, penalties=(%e, "
+            "%e, %e)",
+            iteration,
+            cost,
+            residual,
+            point_state_.penalty,
+            frame_state_.penalty,
+            camera_state_.penalty);
+      }
+
+      if (terminated_by_user) {
+        summary.termination_type = ceres::USER_SUCCESS;
+        break;
+      } else if (residual <= partitioned_options_.tolerance) {
+        summary.termination_type = ceres::CONVERGENCE;
+        break;
+      }
+
+      if (partitioned_options_.adapt_penalty) {
+        AdaptPenalty(point_consensuses_, point_state_);
+        AdaptPenalty(frame_consensuses_, frame_state_);
+        AdaptPenalty(camera_consensuses_, camera_state_);
+      }
+    }
+
+    WriteBackPartitions();
+    reconstruction_.Transform(Inverse(normalized_from_metric));
+
+    summary.message = StringPrintf("Consensus of %d partitions.",
+                                   static_cast<int>(partitions_.size()));
+
+    partitions_.clear();
+    point_consensuses_.clear();
+    frame_consensuses_.clear();
+    camera_consensuses_.clear();
+    camera_scales_.clear();
+
+    summary.total_time_in_seconds = timer.ElapsedSeconds();
+
+    if (options_.print_summary || VLOG_IS_ON(1)) {
+      PrintSolverSummary(summary, "Partitioned bundle adjustment report");
+    }
+
+    return summary;
+  }
+
+  std::shared_ptr<ceres::Problem>& Problem() override { return problem_; }
+
+ private:
+  struct Partition {
+    Reconstruction reconstruction;
+    BundleAdjustmentConfig config;
+    // Cameras of the images in the partition.
+    std::unordered_set<camera_t> camera_ids;
+    // Shared parameters of the partition and the index of the partition's
+    // dual variable in the consensus.
+    std::vector<std::pair<point3D_t, size_t>> shared_points3D;
+    std::vector<std::pair<frame_t, size_t>> shared_frames;
+    std::vector<std::pair<camera_t, size_t>> shared_cameras;
+  };
+
+  // Extracts the frames of the partition's images and all their images and
+  // observations in the config into a separate reconstruction.
+  void SetUpPartitions() {
+    partitions_.resize(partition_image_ids_.size());
+    for (size_t partition_idx = 0; partition_idx < partitions_.size();
+         ++partition_idx) {
+      Partition& partition = partitions_[partition_idx];
+      Reconstruction& sub_reconstruction = partition.reconstruction;
+
+      std::unordered_set<frame_t> frame_ids;
+      for (const image_t image_id : partition_image_ids_[partition_idx]) {
+        frame_ids.insert(reconstruction_.Image(image_id).FrameId());
+      }
+
+      std::unordered_set<image_t> image_ids;
+      for (const image_t image_id : config_.Images()) {
+        if (frame_ids.count(reconstruction_.Image(image_id).FrameId()) > 0) {
+          image_ids.insert(image_id);
+        }
+      }
+
+      // Rigs require all their cameras to exist, even if some of them are
+      // not observed in the partition.
+      for (const frame_t frame_id : frame_ids) {
+        Frame frame = reconstruction_.Frame(frame_id);
+        if (!sub_reconstruction.ExistsRig(frame.RigId())) {
+          const Rig& rig = reconstruction_.Rig(frame.RigId());
+          std::vector<sensor_t> sensor_ids = {rig.RefSensorId()};
+          for (const auto& [sensor_id, _] : rig.Sensors()) {
+            sensor_ids.push_back(sensor_id);
+          }
+          for (const sensor_t& sensor_id : sensor_ids) {
+            if (sensor_id.type == SensorType::CAMERA &&
+                !sub_reconstruction.ExistsCamera(sensor_id.id)) {
+              sub_reconstruction.AddCamera(
+                  reconstruction_.Camera(sensor_id.id));
+            }
+          }
+          sub_reconstruction.AddRig(rig);
+        }
+        frame.ResetRigPtr();
+        sub_reconstruction.AddFrame(std::move(frame));
+      }
+
+      std::unordered_set<point3D_t> point3D_ids;
+      for (const image_t image_id : image_ids) {
+        Image image = reconstruction_.Image(image_id);
+        partition.camera_ids.insert(image.CameraId());
+        image.ResetCameraPtr();
+        image.ResetFramePtr();
+        for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+             ++point2D_idx) {
+          const Point2D& point2D = image.Point2D(point2D_idx);
+          if (point2D.HasPoint3D()) {
+            if (!config_.HasIgnoredPoint(point2D.point3D_id)) {
+              point3D_ids.insert(point2D.point3D_id);
+            }
+            image.ResetPoint3DForPoint2D(point2D_idx);
+          }
+        }
+        sub_reconstruction.AddImage(std::move(image));
+        partition.config.AddImage(image_id);
+      }
+
+      for (const point3D_t point3D_id : point3D_ids) {
+        const Point3D& point3D = reconstruction_.Point3D(point3D_id);
+        Point3D sub_point3D;
+        sub_point3D.xyz = point3D.xyz;
+        sub_point3D.color = point3D.color;
+        sub_point3D.error = point3D.error;
+        for (const auto& track_el : point3D.track.Elements()) {
+          if (image_ids.count(track_el.image_id) > 0) {
+            sub_point3D.track.AddElement(track_el);
+          }
+        }
+        // Points observed only once in the partition do not constrain the
+        // partition's problem and are refined in the other partitions.
+        if (sub_point3D.track.Length() < 2) {
+          continue;
+        }
+        for (const auto& track_el : sub_point3D.track.Elements()) {
+          sub_reconstruction.Image(track_el.image_id)
+              .SetPoint3DForPoint2D(track_el.point2D_idx, point3D_id);
+        }
+        sub_reconstruction.AddPoint3D(point3D_id, std::move(sub_point3D));
+        if (config_.HasConstantPoint(point3D_id)) {
+          partition.config.AddConstantPoint(point3D_id);
+        }
+      }
+
+      for (const camera_t camera_id : config_.ConstantCamIntrinsics()) {
+        if (sub_reconstruction.ExistsCamera(camera_id)) {
+          partition.config.SetConstantCamIntrinsics(camera_id);
+        }
+      }
+      for (const frame_t frame_id : config_.ConstantRigFromWorldPoses()) {
+        if (sub_reconstruction.ExistsFrame(frame_id)) {
+          partition.config.SetConstantRigFromWorldPose(frame_id);
+        }
+      }
+
+      // The gauge is fixed in the first partition and propagates to the other
+      // partitions through the consensus.
+      if (partition_idx == 0) {
+        partition.config.FixGauge(config_.FixedGauge());
+      }
+    }
+  }
+
+  // Finds the parameters that are shared between partitions and variable.
+  void SetUpConsensus() {
+    std::unordered_map<point3D_t, std::vector<size_t>> point3D_partition_idxs;
+    std::unordered_map<frame_t, std::vector<size_t>> frame_partition_idxs;
+    std::unordered_map<camera_t, std::vector<size_t>> camera_partition_idxs;
+    for (size_t partition_idx = 0; partition_idx < partitions_.size();
+         ++partition_idx) {
+      const Reconstruction& sub_reconstruction =
+          partitions_[partition_idx].reconstruction;
+      for (const auto& [point3D_id, _] : sub_reconstruction.Points3D()) {
+        if (!config_.HasConstantPoint(point3D_id)) {
+          point3D_partition_idxs[point3D_id].push_back(partition_idx);
+        }
+      }
+      if (options_.refine_rig_from_world) {
+        for (const auto& [frame_id, _] : sub_reconstruction.Frames()) {
+          if (!config_.HasConstantRigFromWorldPose(frame_id)) {
+            frame_partition_idxs[frame_id].push_back(partition_idx);
+          }
+        }
+      }
+      if (options_.refine_focal_length || options_.refine_principal_point ||
+          options_.refine_extra_params) {
+        for (const camera_t camera_id : partitions_[partition_idx].camera_ids) {
+          if (!config_.HasConstantCamIntrinsics(camera_id)) {
+            camera_partition_idxs[camera_id].push_back(partition_idx);
+          }
+        }
+      }
+    }
+
+    for (auto& [point3D_id, partition_idxs] : point3D_partition_idxs) {
+      if (partition_idxs.size() < 2) {
+        continue;
+      }
+      auto& consensus = point_consensuses_[point3D_id];
+      consensus.value = reconstruction_.Point3D(point3D_id).xyz;
+      consensus.duals.resize(partition_idxs.size(), Eigen::VectorXd::Zero(3));
+      for (size_t i = 0; i < partition_idxs.size(); ++i) {
+        partitions_[partition_idxs[i]].shared_points3D.emplace_back(point3D_id,
+                                                                    i);
+      }
+      consensus.partition_idxs = std::move(partition_idxs);
+    }
+
+    for (auto& [frame_id, partition_idxs] : frame_partition_idxs) {
+      if (partition_idxs.size() < 2) {
+        continue;
+      }
+      auto& consensus = frame_consensuses_[frame_id];
+      consensus.value = reconstruction_.Frame(frame_id).RigFromWorld();
+      consensus.duals.resize(partition_idxs.size(), Eigen::VectorXd::Zero(6));
+      for (size_t i = 0; i < partition_idxs.size(); ++i) {
+        partitions_[partition_idxs[i]].shared_frames.emplace_back(frame_id, i);
+      }
+      consensus.partition_idxs = std::move(partition_idxs);
+    }
+
+    for (auto& [camera_id, partition_idxs] : camera_partition_idxs) {
+      if (partition_idxs.size() < 2) {
+        continue;
+      }
+      const std::vector<double>& params =
+          reconstruction_.Camera(camera_id).params;
+      auto& consensus = camera_consensuses_[camera_id];
+      consensus.value = Eigen::Map<const Eigen::VectorXd>(
+          params.data(), static_cast<Eigen::Index>(params.size()));
+      // Measure camera parameters relative to their magnitude, e.g., such
+      // that focal lengths and distortion coefficients are comparable.
+      camera_scales_[camera_id] = consensus.value.cwiseAbs().cwiseMax(1.0);
+      consensus.duals.resize(partition_idxs.size(),
+                             Eigen::VectorXd::Zero(params.size()));
+      for (size_t i = 0; i < partition_idxs.size(); ++i) {
+        partitions_[partition_idxs[i]].shared_cameras.emplace_back(camera_id,
+                                                                   i);
+      }
+      consensus.partition_idxs = std::move(partition_idxs);
+    }
+
+    for (ConsensusState* state :
+         {&point_state_, &frame_state_, &camera_state_}) {
+      state->penalty = partitioned_options_.initial_penalty;
+    }
+
+    VLOG(2) << "Partitions: " << partitions_.size()
+            << ", shared points: " << point_consensuses_.size()
+            << ", shared frames: " << frame_consensuses_.size()
+            << ", shared cameras: " << camera_consensuses_.size();
+  }
+
+  ceres::Solver::Summary SolvePartition(const size_t partition_idx) {
+    Partition& partition = partitions_[partition_idx];
+    Reconstruction& sub_reconstruction = partition.reconstruction;
+
+    BundleAdjustmentOptions partition_options = options_;
+    partition_options.print_summary = false;
+    partition_options.refine_sensor_from_rig = false;
+    partition_options.reuse_problem = false;
+    partition_options.use_batched_solver = false;
+    partition_options.solver_options.num_threads = num_threads_per_worker_;
+
+    std::unique_ptr<BundleAdjuster> bundle_adjuster =
+        CreateDefaultBundleAdjuster(std::move(partition_options),
+                                    partition.config,
+                                    sub_reconstruction);
+    ceres::Problem& problem = *bundle_adjuster->Problem();
+
+    // Penalize the deviation of shared parameters from their consensus values
+    // offset by the partition's duals.
+    const double point_sqrt_penalty = std::sqrt(point_state_.penalty);
+    for (const auto& [point3D_id, dual_idx] : partition.shared_points3D) {
+      const auto& consensus = point_consensuses_.at(point3D_id);
+      double* xyz = sub_reconstruction.Point3D(point3D_id).xyz.data();
+      if (problem.HasParameterBlock(xyz) &&
+          !problem.IsParameterBlockConstant(xyz)) {
+        problem.AddResidualBlock(
+            new ParameterPriorCostFunction(
+                consensus.value - consensus.duals[dual_idx],
+                Eigen::VectorXd::Constant(3, point_sqrt_penalty)),
+            nullptr,
+            xyz);
+      }
+    }
+
+    const Eigen::Matrix6d frame_cov =
+        Eigen::Matrix6d::Identity() / frame_state_.penalty;
+    for (const auto& [frame_id, dual_idx] : partition.shared_frames) {
+      const auto& consensus = frame_consensuses_.at(frame_id);
+      Rigid3d& rig_from_world =
+          sub_reconstruction.Frame(frame_id).RigFromWorld();
+      if (problem.HasParameterBlock(rig_from_world.translation.data())) {
+        problem.AddResidualBlock(
+            CovarianceWeightedCostFunctor<AbsolutePosePriorCostFunctor>::
+                Create(frame_cov,
+                       PosePlus(-consensus.duals[dual_idx], consensus.value)),
+            nullptr,
+            rig_from_world.rotation.coeffs().data(),
+            rig_from_world.translation.data());
+      }
+    }
+
+    const double camera_sqrt_penalty = std::sqrt(camera_state_.penalty);
+    for (const auto& [camera_id, dual_idx] : partition.shared_cameras) {
+      const auto& consensus = camera_consensuses_.at(camera_id);
+      const Eigen::VectorXd& scale = camera_scales_.at(camera_id);
+      double* params = sub_reconstruction.Camera(camera_id).params.data();
+      if (problem.HasParameterBlock(params) &&
+          !problem.IsParameterBlockConstant(params)) {
+        problem.AddResidualBlock(
+            new ParameterPriorCostFunction(
+                consensus.value - consensus.duals[dual_idx].cwiseProduct(scale),
+                camera_sqrt_penalty * scale.cwiseInverse()),
+            nullptr,
+            params);
+      }
+    }
+
+    return bundle_adjuster->Solve();
+  }
+
+  // Updates the consensus values and duals from the solutions of the
+  // partitions and returns the larger of the root mean square primal and
+  // dual residuals.
+  double UpdateConsensus() {
+    for (ConsensusState* state :
+         {&point_state_, &frame_state_, &camera_state_}) {
+      state->ResetResiduals();
+    }
+
+    std::vector<Eigen::Vector3d> local_xyzs;
+    for (auto& [point3D_id, consensus] : point_consensuses_) {
+      local_xyzs.clear();
+      for (const size_t partition_idx : consensus.partition_idxs) {
+        local_xyzs.push_back(
+            partitions_[partition_idx].reconstruction.Point3D(point3D_id).xyz);
+      }
+      UpdateConsensusValue(
+          local_xyzs,
+          [](const Eigen::Vector3d& a, const Eigen::Vector3d& b) {
+            return Eigen::VectorXd(a - b);
+          },
+          [](const Eigen::VectorXd& delta, const Eigen::Vector3d& b) {
+            return Eigen::Vector3d(b + delta);
+          },
+          consensus,
+          point_state_);
+    }
+
+    std::vector<Rigid3d> local_rig_from_worlds;
+    for (auto& [frame_id, consensus] : frame_consensuses_) {
+      local_rig_from_worlds.clear();
+      for (const size_t partition_idx : consensus.partition_idxs) {
+        local_rig_from_worlds.push_back(
+            partitions_[partition_idx].reconstruction.Frame(frame_id)
+                .RigFromWorld());
+      }
+      UpdateConsensusValue(
+          local_rig_from_worlds,
+          [](const Rigid3d& a, const Rigid3d& b) {
+            return Eigen::VectorXd(PoseMinus(a, b));
+          },
+          [](const Eigen::VectorXd& delta, const Rigid3d& b) {
+            return PosePlus(delta, b);
+          },
+          consensus,
+          frame_state_);
+    }
+
+    std::vector<Eigen::VectorXd> local_params;
+    for (auto& [camera_id, consensus] : camera_consensuses_) {
+      const Eigen::VectorXd& scale = camera_scales_.at(camera_id);
+      local_params.clear();
+      for (const size_t partition_idx : consensus.partition_idxs) {
+        const std::vector<double>& params =
+            partitions_[partition_idx].reconstruction.Camera(camera_id).params;
+        local_params.push_back(Eigen::Map<const Eigen::VectorXd>(
+            params.data(), static_cast<Eigen::Index>(params.size())));
+      }
+      UpdateConsensusValue(
+          local_params,
+          [&scale](const Eigen::VectorXd& a, const Eigen::VectorXd& b) {
+            return Eigen::VectorXd((a - b).cwiseQuotient(scale));
+          },
+          [&scale](const Eigen::VectorXd& delta, const Eigen::VectorXd& b) {
+            return Eigen::VectorXd(b + delta.cwiseProduct(scale));
+          },
+          consensus,
+          camera_state_);
+    }
+
+    double primal_residual_sq = 0;
+    double dual_residual_sq = 0;
+    size_t num_residuals = 0;
+    for (const ConsensusState* state :
+         {&point_state_, &frame_state_, &camera_state_}) {
+      primal_residual_sq += state->primal_residual_sq;
+      dual_residual_sq += state->dual_residual_sq;
+      num_residuals += state->num_residuals;
+    }
+    if (num_residuals == 0) {
+      return 0;
+    }
+    return std::sqrt(std::max(primal_residual_sq, dual_residual_sq) /
+                     num_residuals);
+  }
+
+  // Copies the solution of the partitions to the reconstruction, using the
+  // consensus values for the shared parameters.
+  void WriteBackPartitions() {
+    for (const Partition& partition : partitions_) {
+      const Reconstruction& sub_reconstruction = partition.reconstruction;
+      for (const auto& [point3D_id, point3D] : sub_reconstruction.Points3D()) {
+        reconstruction_.Point3D(point3D_id).xyz = point3D.xyz;
+      }
+      for (const auto& [frame_id, frame] : sub_reconstruction.Frames()) {
+        reconstruction_.Frame(frame_id).SetRigFromWorld(frame.RigFromWorld());
+      }
+      for (const camera_t camera_id : partition.camera_ids) {
+        reconstruction_.Camera(camera_id).params =
+            sub_reconstruction.Camera(camera_id).params;
+      }
+    }
+
+    for (const auto& [point3D_id, consensus] : point_consensuses_) {
+      reconstruction_.Point3D(point3D_id).xyz = consensus.value;
+    }
+    for (const auto& [frame_id, consensus] : frame_consensuses_) {
+      reconstruction_.Frame(frame_id).SetRigFromWorld(consensus.value);
+    }
+    for (const auto& [camera_id, consensus] : camera_consensuses_) {
+      std::vector<double>& params = reconstruction_.Camera(camera_id).params;
+      Eigen::Map<Eigen::VectorXd>(
+          params.data(), static_cast<Eigen::Index>(params.size())) =
+          consensus.value;
+    }
+  }
+
+  const PartitionedBundleAdjustmentOptions partitioned_options_;
+  const std::vector<std::vector<image_t>> partition_image_ids_;
+  Reconstruction& reconstruction_;
+  std::shared_ptr<ceres::Problem> problem_;
+
+  int num_threads_per_worker_ = 1;
+  std::vector<Partition> partitions_;
+  std::unordered_map<point3D_t, Consensus<Eigen::Vector3d>> point_consensuses_;
+  std::unordered_map<frame_t, Consensus<Rigid3d>> frame_consensuses_;
+  std::unordered_map<camera_t, Consensus<Eigen::VectorXd>> camera_consensuses_;
+  std::unordered_map<camera_t, Eigen::VectorXd> camera_scales_;
+  ConsensusState point_state_;
+  ConsensusState frame_state_;
+  ConsensusState camera_state_;
+};
+
+}  // namespace
+
+bool PartitionedBundleAdjustmentOptions::Check() const {
+  CHECK_OPTION_GT(leaf_max_num_images, 0);
+  CHECK_OPTION_GE(image_overlap, 0);
+  CHECK_OPTION_GT(max_num_iterations, 0);
+  CHECK_OPTION_GT(initial_penalty, 0);
+  CHECK_OPTION_GE(tolerance, 0);
+  return true;
+}
+
+std::unique_ptr<BundleAdjuster> CreatePartitionedBundleAdjuster(
+    BundleAdjustmentOptions options,
+    PartitionedBundleAdjustmentOptions partitioned_options,
+    BundleAdjustmentConfig config,
+    Reconstruction& reconstruction) {
+  THROW_CHECK(options.Check());
+  THROW_CHECK(partitioned_options.Check());
+  std::vector<std::vector<image_t>> partition_image_ids =
+      PartitionImages(partitioned_options, config, reconstruction);
+  if (partition_image_ids.size() <= 1) {
+    return CreateDefaultBundleAdjuster(
+        std::move(options), std::move(config), reconstruction);
+  }
+  return std::make_unique<PartitionedBundleAdjuster>(
+      std::move(options),
+      std::move(partitioned_options),
+      std::move(config),
+      std::move(partition_image_ids),
+      reconstruction);
+}
+
+}  // namespace colmap
@@ -0,0 +1,83 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/scene/reconstruction.h"
+
+#include <memory>
+
+namespace colmap {
+
+struct PartitionedBundleAdjustmentOptions {
+  // The maximum number of images per partition and the number of overlapping
+  // images between partitions, see SceneClustering::Options.
+  int leaf_max_num_images = 500;
+  int image_overlap = 50;
+
+  // The number of partitions solved in parallel. The threads of the Ceres
+  // solver are split evenly between the workers.
+  int num_workers = -1;
+
+  // The maximum number of consensus iterations, each solving all partitions.
+  int max_num_iterations = 25;
+
+  // The initial weight of the consensus penalty on the deviation of shared
+  // parameters from their consensus values. Positions and translations are
+  // measured in the normalized reconstruction, rotations in radians, and
+  // camera parameters relative to their magnitude.
+  double initial_penalty = 1e3;
+
+  // Whether to adapt the penalty by balancing the primal and dual residuals.
+  bool adapt_penalty = true;
+
+  // Convergence tolerance on the root mean square of the primal and dual
+  // residuals, in the same units as the penalty.
+  double tolerance = 1e-4;
+
+  bool Check() const;
+};
+
+// Bundle adjuster for very large reconstructions. The images of the config are
+// split into overlapping partitions with SceneClustering on the covisibility
+// graph, and the partitions are solved concurrently as independent problems.
+// Agreement between the partitions on shared 3D points, rig from world poses,
+// and camera intrinsics is enforced by consensus ADMM. Each partition is
+// solved on its own copy of its part of the reconstruction, so that workers
+// never share parameters. Observations of images outside of the config are
+// ignored and sensor from rig poses are kept constant. Falls back to the
+// default bundle adjuster if the scene yields a single partition.
+std::unique_ptr<BundleAdjuster> CreatePartitionedBundleAdjuster(
+    BundleAdjustmentOptions options,
+    PartitionedBundleAdjustmentOptions partitioned_options,
+    BundleAdjustmentConfig config,
+    Reconstruction& reconstruction);
+
+}  // namespace colmap
@@ -0,0 +1,227 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
+
+#include "colmap/geometry/rigid3_matchers.h"
+#include "colmap/math/random.h"
+#include "colmap/scene/synthetic.h"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+void SynthesizePerturbedDataset(const int num_frames,
+                                Reconstruction* reconstruction) {
+  SetPRNGSeed(0);
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 1;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = num_frames;
+  synthetic_dataset_options.num_points3D = 150;
+  synthetic_dataset_options.point2D_stddev = 0.5;
+  SynthesizeDataset(synthetic_dataset_options, reconstruction);
+
+  for (const point3D_t point3D_id : reconstruction->Point3DIds()) {
+    Point3D& point3D = reconstruction->Point3D(point3D_id);
+    for (int i = 0; i < 3; ++i) {
+      point3D.xyz(i) += RandomGaussian(0.0, 0.02);
+    }
+  }
+  for (const frame_t frame_id : reconstruction->RegFrameIds()) {
+    Rigid3d& rig_from_world = reconstruction->Frame(frame_id).RigFromWorld();
+    for (int i = 0; i < 3; ++i) {
+      rig_from_world.translation(i) += RandomGaussian(0.0, 0.02);
+    }
+  }
+}
+
+BundleAdjustmentConfig CreateConfig(const Reconstruction& reconstruction) {
+  BundleAdjustmentConfig config;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    config.AddImage(image_id);
+  }
+  config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
+  return config;
+}
+
+TEST(PartitionedBundleAdjuster, Nominal) {
+  Reconstruction orig_reconstruction;
+  SynthesizePerturbedDataset(/*num_frames=*/24, &orig_reconstruction);
+  const BundleAdjustmentConfig config = CreateConfig(orig_reconstruction);
+
+  BundleAdjustmentOptions options;
+  options.print_summary = false;
+
+  Reconstruction reference_reconstruction = orig_reconstruction;
+  CreateDefaultBundleAdjuster(options, config, reference_reconstruction)
+      ->Solve();
+  reference_reconstruction.UpdatePoint3DErrors();
+
+  PartitionedBundleAdjustmentOptions partitioned_options;
+  partitioned_options.leaf_max_num_images = 8;
+  partitioned_options.image_overlap = 2;
+  partitioned_options.num_workers = 2;
+
+  Reconstruction reconstruction = orig_reconstruction;
+  std::unique_ptr<BundleAdjuster> bundle_adjuster =
+      CreatePartitionedBundleAdjuster(
+          options, partitioned_options, config, reconstruction);
+  EXPECT_EQ(bundle_adjuster->Problem(), nullptr);
+  const ceres::Solver::Summary summary = bundle_adjuster->Solve();
+  EXPECT_NE(summary.termination_type, ceres::FAILURE);
+  EXPECT_GT(summary.num_successful_steps, 0);
+  EXPECT_GT(summary.num_residuals_reduced, config.NumResiduals(reconstruction));
+
+  EXPECT_EQ(reconstruction.NumRegFrames(), orig_reconstruction.NumRegFrames());
+  EXPECT_EQ(reconstruction.NumPoints3D(), orig_reconstruction.NumPoints3D());
+
+  orig_reconstruction.UpdatePoint3DErrors();
+  reconstruction.UpdatePoint3DErrors();
+  const double reference_error =
+      reference_reconstruction.ComputeMeanReprojectionError();
+  const double error = reconstruction.ComputeMeanReprojectionError();
+  EXPECT_LT(error, 0.5 * orig_reconstruction.ComputeMeanReprojectionError());
+  EXPECT_LT(error, 1.05 * reference_error);
+}
+
+TEST(PartitionedBundleAdjuster, ConstantParameters) {
+  Reconstruction orig_reconstruction;
+  SynthesizePerturbedDataset(/*num_frames=*/16, &orig_reconstruction);
+  BundleAdjustmentConfig config = CreateConfig(orig_reconstruction);
+  const camera_t camera_id = orig_reconstruction.Cameras().begin()->first;
+  config.SetConstantCamIntrinsics(camera_id);
+  const frame_t frame_id = orig_reconstruction.RegFrameIds().front();
+  config.SetConstantRigFromWorldPose(frame_id);
+
+  BundleAdjustmentOptions options;
+  options.print_summary = false;
+
+  PartitionedBundleAdjustmentOptions partitioned_options;
+  partitioned_options.leaf_max_num_images = 6;
+  partitioned_options.image_overlap = 2;
+  partitioned_options.max_num_iterations = 5;
+
+  Reconstruction reconstruction = orig_reconstruction;
+  CreatePartitionedBundleAdjuster(
+      options, partitioned_options, config, reconstruction)
+      ->Solve();
+
+  EXPECT_EQ(reconstruction.Camera(camera_id).params,
+            orig_reconstruction.Camera(camera_id).params);
+  EXPECT_THAT(reconstruction.Frame(frame_id).RigFromWorld(),
+              Rigid3dNear(orig_reconstruction.Frame(frame_id).RigFromWorld(),
+                          /*rtol=*/1e-9,
+                          /*ttol=*/1e-9));
+}
+
+TEST(PartitionedBundleAdjuster, PartialVisibility) {
+  Reconstruction orig_reconstruction;
+  SynthesizePerturbedDataset(/*num_frames=*/24, &orig_reconstruction);
+
+  // Restrict each point to a window of three consecutive images, such that
+  // points at the partition boundaries are observed only once in some
+  // partitions.
+  const std::vector<image_t> image_ids = orig_reconstruction.RegImageIds();
+  std::vector<point3D_t> point3D_ids;
+  for (const auto& [point3D_id, _] : orig_reconstruction.Points3D()) {
+    point3D_ids.push_back(point3D_id);
+  }
+  std::sort(point3D_ids.begin(), point3D_ids.end());
+  for (size_t i = 0; i < point3D_ids.size(); ++i) {
+    const size_t window_begin = i % (image_ids.size() - 2);
+    const Track track = orig_reconstruction.Point3D(point3D_ids[i]).track;
+    for (const TrackElement& track_el : track.Elements()) {
+      const size_t image_idx =
+          std::find(image_ids.begin(), image_ids.end(), track_el.image_id) -
+          image_ids.begin();
+      if (image_idx < window_begin || image_idx >= window_begin + 3) {
+        orig_reconstruction.DeleteObservation(track_el.image_id,
+                                              track_el.point2D_idx);
+      }
+    }
+  }
+  const BundleAdjustmentConfig config = CreateConfig(orig_reconstruction);
+
+  BundleAdjustmentOptions options;
+  options.print_summary = false;
+
+  PartitionedBundleAdjustmentOptions partitioned_options;
+  partitioned_options.leaf_max_num_images = 8;
+  partitioned_options.image_overlap = 1;
+
+  Reconstruction reconstruction = orig_reconstruction;
+  const ceres::Solver::Summary summary =
+      CreatePartitionedBundleAdjuster(
+          options, partitioned_options, config, reconstruction)
+          ->Solve();
+  EXPECT_NE(summary.termination_type, ceres::FAILURE);
+
+  EXPECT_EQ(reconstruction.NumPoints3D(), orig_reconstruction.NumPoints3D());
+  for (const auto& [point3D_id, point3D] : reconstruction.Points3D()) {
+    EXPECT_EQ(point3D.track.Length(), 3);
+  }
+  orig_reconstruction.UpdatePoint3DErrors();
+  reconstruction.UpdatePoint3DErrors();
+  EXPECT_LT(reconstruction.ComputeMeanReprojectionError(),
+            orig_reconstruction.ComputeMeanReprojectionError());
+}
+
+TEST(PartitionedBundleAdjuster, SinglePartition) {
+  Reconstruction reconstruction;
+  SynthesizePerturbedDataset(/*num_frames=*/4, &reconstruction);
+  const BundleAdjustmentConfig config = CreateConfig(reconstruction);
+
+  BundleAdjustmentOptions options;
+  options.print_summary = false;
+  PartitionedBundleAdjustmentOptions partitioned_options;
+  partitioned_options.leaf_max_num_images = 4;
+
+  // Falls back to the default bundle adjuster.
+  std::unique_ptr<BundleAdjuster> bundle_adjuster =
+      CreatePartitionedBundleAdjuster(
+          options, partitioned_options, config, reconstruction);
+  EXPECT_NE(bundle_adjuster->Problem(), nullptr);
+}
+
+TEST(PartitionedBundleAdjustmentOptions, Check) {
+  PartitionedBundleAdjustmentOptions options;
+  EXPECT_TRUE(options.Check());
+  options.leaf_max_num_images = 0;
+  EXPECT_FALSE(options.Check());
+  options.leaf_max_num_images = 100;
+  options.initial_penalty = 0;
+  EXPECT_FALSE(options.Check());
+}
+
+}  // namespace
+}  // namespace colmap
@@ -77,14 +77,16 @@ bool EstimateAbsolutePose(const AbsolutePoseEstimationOptions& options,
       return true;
     }
   } else {
+    std::vector<Eigen::Vector2d> cam_points(points2D.size());
+    camera->CamFromImgBatch(
+        span<const Eigen::Vector2d>(points2D.data(), points2D.size()),
+        span<Eigen::Vector2d>(cam_points.data(), cam_points.size()));
     std::vector<P3PEstimator::X_t> points2D_with_rays(points2D.size());
     for (size_t i = 0; i < points2D.size(); ++i) {
       points2D_with_rays[i].image_point = points2D[i];
-      if (const std::optional<Eigen::Vector2d> cam_point =
-              camera->CamFromImg(points2D[i]);
-          cam_point) {
+      if (cam_points[i].allFinite()) {
         points2D_with_rays[i].camera_ray =
-            cam_point->homogeneous().normalized();
+            cam_points[i].homogeneous().normalized();
       } else {
         points2D_with_rays[i].camera_ray.setZero();
       }
@@ -0,0 +1,271 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/rotation_averaging.h"
+
+#include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/estimators/cost_functions.h"
+#include "colmap/estimators/manifold.h"
+#include "colmap/math/math.h"
+#include "colmap/util/threading.h"
+
+#include <queue>
+#include <unordered_set>
+
+#include <ceres/ceres.h>
+
+namespace colmap {
+namespace {
+
+struct ViewGraphEdge {
+  size_t rotation_idx;
+  frame_t neighbor_frame_id;
+};
+
+using ViewGraph = std::unordered_map<frame_t, std::vector<ViewGraphEdge>>;
+
+ViewGraph BuildViewGraph(
+    const std::vector<RelativeRotation>& relative_rotations) {
+  ViewGraph view_graph;
+  for (size_t i = 0; i < relative_rotations.size(); ++i) {
+    const RelativeRotation& relative_rotation = relative_rotations[i];
+    if (relative_rotation.frame_id1 == relative_rotation.frame_id2) {
+      continue;
+    }
+    view_graph[relative_rotation.frame_id1].push_back(
+        {i, relative_rotation.frame_id2});
+    view_graph[relative_rotation.frame_id2].push_back(
+        {i, relative_rotation.frame_id1});
+  }
+  return view_graph;
+}
+
+std::unordered_set<frame_t> FindLargestConnectedComponent(
+    const ViewGraph& view_graph) {
+  std::unordered_set<frame_t> visited;
+  std::unordered_set<frame_t> largest_component;
+  for (const auto& [root_frame_id, _] : view_graph) {
+    if (visited.count(root_frame_id) > 0) {
+      continue;
+    }
+    std::unordered_set<frame_t> component;
+    std::queue<frame_t> queue;
+    queue.push(root_frame_id);
+    visited.insert(root_frame_id);
+    while (!queue.empty()) {
+      const frame_t frame_id = queue.front();
+      queue.pop();
+      component.insert(frame_id);
+      for (const ViewGraphEdge& edge : view_graph.at(frame_id)) {
+        if (visited.insert(edge.neighbor_frame_id).second) {
+          queue.push(edge.neighbor_frame_id);
+        }
+      }
+    }
+    if (component.size() > largest_component.size()) {
+      largest_component = std::move(component);
+    }
+  }
+  return largest_component;
+}
+
+// Chains the relative rotations along the maximum spanning tree (Prim's
+// algorithm) starting from the given root frame.
+void InitializeFromMaximumSpanningTree(
+    const std::vector<RelativeRotation>& relative_rotations,
+    const ViewGraph& view_graph,
+    const frame_t root_frame_id,
+    std::unordered_map<frame_t, Eigen::Quaterniond>*
+        frame_from_world_rotations) {
+  // Priority queue of (weight, rotation index, frame to be reached).
+  using Candidate = std::tuple<double, size_t, frame_t>;
+  std::priority_queue<Candidate> candidates;
+
+  const auto add_candidates = [&](const frame_t frame_id) {
+    for (const ViewGraphEdge& edge : view_graph.at(frame_id)) {
+      if (frame_from_world_rotations->count(edge.neighbor_frame_id) == 0) {
+        candidates.emplace(relative_rotations[edge.rotation_idx].weight,
+                           edge.rotation_idx,
+                           edge.neighbor_frame_id);
+      }
+    }
+  };
+
+  frame_from_world_rotations->emplace(root_frame_id,
+                                      Eigen::Quaterniond::Identity());
+  add_candidates(root_frame_id);
+
+  while (!candidates.empty()) {
+    const auto [weight, rotation_idx, frame_id] = candidates.top();
+    candidates.pop();
+    if (frame_from_world_rotations->count(frame_id) > 0) {
+      continue;
+    }
+    const RelativeRotation& relative_rotation =
+        relative_rotations[rotation_idx];
+    if (frame_id == relative_rotation.frame_id2) {
+      frame_from_world_rotations->emplace(
+          frame_id,
+          (relative_rotation.frame2_from_frame1 *
+           frame_from_world_rotations->at(relative_rotation.frame_id1))
+              .normalized());
+    } else {
+      frame_from_world_rotations->emplace(
+          frame_id,
+          (relative_rotation.frame2_from_frame1.inverse() *
+           frame_from_world_rotations->at(relative_rotation.frame_id2))
+              .normalized());
+    }
+    add_candidates(frame_id);
+  }
+}
+
+}  // namespace
+
+bool RotationAveragingOptions::Check() const {
+  CHECK_OPTION_GT(loss_function_scale_deg, 0.0);
+  CHECK_OPTION_GT(max_rotation_error_deg, 0.0);
+  CHECK_OPTION_GE(max_num_iterations, 0);
+  return true;
+}
+
+bool EstimateGlobalRotations(
+    const RotationAveragingOptions& options,
+    const std::vector<RelativeRotation>& relative_rotations,
+    std::unordered_map<frame_t, Eigen::Quaterniond>*
+        frame_from_world_rotations,
+    std::vector<char>* inlier_mask) {
+  THROW_CHECK(options.Check());
+  THROW_CHECK_NOTNULL(frame_from_world_rotations);
+
+  frame_from_world_rotations->clear();
+  if (inlier_mask != nullptr) {
+    inlier_mask->assign(relative_rotations.size(), false);
+  }
+
+  const ViewGraph view_graph = BuildViewGraph(relative_rotations);
+  const std::unordered_set<frame_t> component =
+      FindLargestConnectedComponent(view_graph);
+  if (component.size() < 2) {
+    return false;
+  }
+
+  // Start the spanning tree at the frame with the largest total weight, which
+  // is typically well-connected and thus a good choice for fixing the gauge.
+  frame_t root_frame_id = kInvalidFrameId;
+  double max_total_weight = -1;
+  for (const frame_t frame_id : component) {
+    double total_weight = 0;
+    for (const ViewGraphEdge& edge : view_graph.at(frame_id)) {
+      total_weight += relative_rotations[edge.rotation_idx].weight;
+    }
+    if (total_weight > max_total_weight ||
+        (total_weight == max_total_weight && frame_id < root_frame_id)) {
+      max_total_weight = total_weight;
+      root_frame_id = frame_id;
+    }
+  }
+
+  InitializeFromMaximumSpanningTree(relative_rotations,
+                                    view_graph,
+                                    root_frame_id,
+                                    frame_from_world_rotations);
+
+  // Robustly refine all rotations jointly.
+
+  ceres::Problem::Options problem_options;
+  problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  ceres::Problem problem(problem_options);
+  ceres::CauchyLoss loss_function(DegToRad(options.loss_function_scale_deg));
+
+  for (const RelativeRotation& relative_rotation : relative_rotations) {
+    auto it1 = frame_from_world_rotations->find(relative_rotation.frame_id1);
+    auto it2 = frame_from_world_rotations->find(relative_rotation.frame_id2);
+    if (it1 == frame_from_world_rotations->end() ||
+        it2 == frame_from_world_rotations->end() || it1 == it2) {
+      continue;
+    }
+    problem.AddResidualBlock(RelativeRotationErrorCostFunctor::Create(
+                                 relative_rotation.frame2_from_frame1),
+                             &loss_function,
+                             it1->second.coeffs().data(),
+                             it2->second.coeffs().data());
+  }
+
+  for (auto& [frame_id, frame_from_world_rotation] :
+       *frame_from_world_rotations) {
+    SetQuaternionManifold(&problem, frame_from_world_rotation.coeffs().data());
+  }
+  problem.SetParameterBlockConstant(
+      frame_from_world_rotations->at(root_frame_id).coeffs().data());
+
+  ceres::Solver::Options solver_options;
+  solver_options.max_num_iterations = options.max_num_iterations;
+  if (solver_options.sparse_linear_algebra_library_type != ceres::NO_SPARSE) {
+    solver_options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+  } else {
+    solver_options.linear_solver_type = ceres::CGNR;
+    solver_options.preconditioner_type = ceres::JACOBI;
+  }
+  solver_options.num_threads = GetEffectiveNumThreads(options.num_threads);
+  solver_options.logging_type = ceres::LoggingType::SILENT;
+
+  ceres::Solver::Summary summary;
+  ceres::Solve(solver_options, &problem, &summary);
+
+  if (options.print_summary || VLOG_IS_ON(1)) {
+    PrintSolverSummary(summary, "Rotation averaging report");
+  }
+
+  if (!summary.IsSolutionUsable()) {
+    frame_from_world_rotations->clear();
+    return false;
+  }
+
+  if (inlier_mask != nullptr) {
+    const double max_rotation_error = DegToRad(options.max_rotation_error_deg);
+    for (size_t i = 0; i < relative_rotations.size(); ++i) {
+      const RelativeRotation& relative_rotation = relative_rotations[i];
+      auto it1 = frame_from_world_rotations->find(relative_rotation.frame_id1);
+      auto it2 = frame_from_world_rotations->find(relative_rotation.frame_id2);
+      if (it1 == frame_from_world_rotations->end() ||
+          it2 == frame_from_world_rotations->end()) {
+        continue;
+      }
+      const double rotation_error = relative_rotation.frame2_from_frame1
+                                        .angularDistance(it2->second *
+                                                         it1->second.inverse());
+      (*inlier_mask)[i] = rotation_error <= max_rotation_error;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace colmap
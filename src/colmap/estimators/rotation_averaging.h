@@ -0,0 +1,98 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/util/eigen_alignment.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/types.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+namespace colmap {
+
+struct RotationAveragingOptions {
+  // Scaling factor in degrees that determines at which residual
+  // robustification takes place.
+  double loss_function_scale_deg = 5.0;
+
+  // Maximum angular error in degrees between a relative rotation and the
+  // averaged absolute rotations for the relative rotation to be an inlier.
+  double max_rotation_error_deg = 10.0;
+
+  // Maximum number of solver iterations for the robust refinement.
+  int max_num_iterations = 100;
+
+  // Number of threads used by the solver.
+  int num_threads = -1;
+
+  // Whether to print final summary.
+  bool print_summary = false;
+
+  bool Check() const;
+};
+
+// Measured rotation between two frames, e.g., from two-view geometry.
+struct RelativeRotation {
+  frame_t frame_id1 = kInvalidFrameId;
+  frame_t frame_id2 = kInvalidFrameId;
+  Eigen::Quaterniond frame2_from_frame1 = Eigen::Quaterniond::Identity();
+  // Confidence of the measurement, e.g., the number of inlier matches. Only
+  // used to select the spanning tree for initialization.
+  double weight = 1.0;
+};
+
+// Estimate the absolute rotations of frames from noisy relative rotations.
+//
+// The rotations are initialized by chaining the relative rotations along the
+// maximum spanning tree of the weighted view graph and then jointly refined
+// using a robust cost over all relative rotations. Only the largest connected
+// component of the view graph is estimated and the gauge is fixed by the root
+// of the spanning tree, which is assigned the identity rotation.
+//
+// @param options                  Rotation averaging options.
+// @param relative_rotations       Relative rotations between frames.
+// @param frame_from_world_rotations  Estimated absolute frame rotations.
+// @param inlier_mask              Whether each relative rotation is consistent
+//                                 with the estimated rotations. Relative
+//                                 rotations outside the estimated component
+//                                 are marked as outliers.
+//
+// @return                         Whether rotations were estimated.
+bool EstimateGlobalRotations(
+    const RotationAveragingOptions& options,
+    const std::vector<RelativeRotation>& relative_rotations,
+    std::unordered_map<frame_t, Eigen::Quaterniond>*
+        frame_from_world_rotations,
+    std::vector<char>* inlier_mask = nullptr);
+
+}  // namespace colmap
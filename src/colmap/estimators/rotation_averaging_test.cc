@@ -0,0 +1,160 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/rotation_averaging.h"
+
+#include "colmap/math/math.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+std::vector<RelativeRotation> GenerateRelativeRotations(
+    const std::vector<Eigen::Quaterniond>& frame_from_world_rotations) {
+  std::vector<RelativeRotation> relative_rotations;
+  for (size_t i = 0; i < frame_from_world_rotations.size(); ++i) {
+    for (size_t j = i + 1; j < frame_from_world_rotations.size(); ++j) {
+      RelativeRotation& relative_rotation = relative_rotations.emplace_back();
+      relative_rotation.frame_id1 = i;
+      relative_rotation.frame_id2 = j;
+      relative_rotation.frame2_from_frame1 =
+          frame_from_world_rotations[j] *
+          frame_from_world_rotations[i].inverse();
+      relative_rotation.weight = 100;
+    }
+  }
+  return relative_rotations;
+}
+
+void ExpectConsistentRotations(
+    const std::vector<Eigen::Quaterniond>& expected_frame_from_world_rotations,
+    const std::unordered_map<frame_t, Eigen::Quaterniond>&
+        frame_from_world_rotations,
+    const double max_error) {
+  ASSERT_EQ(frame_from_world_rotations.size(),
+            expected_frame_from_world_rotations.size());
+  for (size_t i = 0; i < expected_frame_from_world_rotations.size(); ++i) {
+    for (size_t j = i + 1; j < expected_frame_from_world_rotations.size();
+         ++j) {
+      const Eigen::Quaterniond expected_j_from_i =
+          expected_frame_from_world_rotations[j] *
+          expected_frame_from_world_rotations[i].inverse();
+      const Eigen::Quaterniond j_from_i = frame_from_world_rotations.at(j) *
+                                          frame_from_world_rotations.at(i)
+                                              .inverse();
+      EXPECT_LT(expected_j_from_i.angularDistance(j_from_i), max_error);
+    }
+  }
+}
+
+TEST(EstimateGlobalRotations, Nominal) {
+  std::vector<Eigen::Quaterniond> expected_frame_from_world_rotations;
+  for (int i = 0; i < 10; ++i) {
+    expected_frame_from_world_rotations.push_back(
+        Eigen::Quaterniond::UnitRandom());
+  }
+  const std::vector<RelativeRotation> relative_rotations =
+      GenerateRelativeRotations(expected_frame_from_world_rotations);
+
+  std::unordered_map<frame_t, Eigen::Quaterniond> frame_from_world_rotations;
+  std::vector<char> inlier_mask;
+  EXPECT_TRUE(EstimateGlobalRotations(RotationAveragingOptions(),
+                                      relative_rotations,
+                                      &frame_from_world_rotations,
+                                      &inlier_mask));
+  ExpectConsistentRotations(expected_frame_from_world_rotations,
+                            frame_from_world_rotations,
+                            /*max_error=*/1e-6);
+  EXPECT_EQ(inlier_mask, std::vector<char>(relative_rotations.size(), true));
+}
+
+TEST(EstimateGlobalRotations, WithOutliers) {
+  std::vector<Eigen::Quaterniond> expected_frame_from_world_rotations;
+  for (int i = 0; i < 10; ++i) {
+    expected_frame_from_world_rotations.push_back(
+        Eigen::Quaterniond::UnitRandom());
+  }
+  std::vector<RelativeRotation> relative_rotations =
+      GenerateRelativeRotations(expected_frame_from_world_rotations);
+  // Corrupt a few measurements with low weight, such that they are not part
+  // of the spanning tree initialization.
+  for (size_t i = 0; i < relative_rotations.size(); i += 7) {
+    relative_rotations[i].frame2_from_frame1 =
+        Eigen::AngleAxisd(DegToRad(45.0), Eigen::Vector3d::UnitZ()) *
+        relative_rotations[i].frame2_from_frame1;
+    relative_rotations[i].weight = 1;
+  }
+
+  std::unordered_map<frame_t, Eigen::Quaterniond> frame_from_world_rotations;
+  std::vector<char> inlier_mask;
+  EXPECT_TRUE(EstimateGlobalRotations(RotationAveragingOptions(),
+                                      relative_rotations,
+                                      &frame_from_world_rotations,
+                                      &inlier_mask));
+  // The robust loss limits but does not fully remove the outlier influence.
+  ExpectConsistentRotations(expected_frame_from_world_rotations,
+                            frame_from_world_rotations,
+                            /*max_error=*/DegToRad(0.5));
+  for (size_t i = 0; i < relative_rotations.size(); ++i) {
+    EXPECT_EQ(inlier_mask[i], i % 7 != 0);
+  }
+}
+
+TEST(EstimateGlobalRotations, LargestConnectedComponent) {
+  std::vector<RelativeRotation> relative_rotations(3);
+  relative_rotations[0].frame_id1 = 1;
+  relative_rotations[0].frame_id2 = 2;
+  relative_rotations[1].frame_id1 = 2;
+  relative_rotations[1].frame_id2 = 3;
+  relative_rotations[2].frame_id1 = 4;
+  relative_rotations[2].frame_id2 = 5;
+
+  std::unordered_map<frame_t, Eigen::Quaterniond> frame_from_world_rotations;
+  std::vector<char> inlier_mask;
+  EXPECT_TRUE(EstimateGlobalRotations(RotationAveragingOptions(),
+                                      relative_rotations,
+                                      &frame_from_world_rotations,
+                                      &inlier_mask));
+  EXPECT_EQ(frame_from_world_rotations.size(), 3);
+  EXPECT_EQ(frame_from_world_rotations.count(1), 1);
+  EXPECT_EQ(frame_from_world_rotations.count(2), 1);
+  EXPECT_EQ(frame_from_world_rotations.count(3), 1);
+  EXPECT_EQ(inlier_mask, std::vector<char>({true, true, false}));
+}
+
+TEST(EstimateGlobalRotations, Empty) {
+  std::unordered_map<frame_t, Eigen::Quaterniond> frame_from_world_rotations;
+  EXPECT_FALSE(EstimateGlobalRotations(
+      RotationAveragingOptions(), {}, &frame_from_world_rotations));
+  EXPECT_TRUE(frame_from_world_rotations.empty());
+}
+
+}  // namespace
+}  // namespace colmap
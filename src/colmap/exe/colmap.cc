@@ -87,6 +87,8 @@ int main(int argc, char** argv) {
   commands.emplace_back("automatic_reconstructor",
                         &colmap::RunAutomaticReconstructor);
   commands.emplace_back("bundle_adjuster", &colmap::RunBundleAdjuster);
+  commands.emplace_back("bundle_adjuster_calibrator",
+                        &colmap::RunBundleAdjusterCalibrator);
   commands.emplace_back("color_extractor", &colmap::RunColorExtractor);
   commands.emplace_back("database_cleaner", &colmap::RunDatabaseCleaner);
   commands.emplace_back("database_creator", &colmap::RunDatabaseCreator);
@@ -96,6 +98,7 @@ int main(int argc, char** argv) {
   commands.emplace_back("feature_extractor", &colmap::RunFeatureExtractor);
   commands.emplace_back("feature_importer", &colmap::RunFeatureImporter);
   commands.emplace_back("geometric_verifier", &colmap::RunGeometricVerifier);
+  commands.emplace_back("global_mapper", &colmap::RunGlobalMapper);
   commands.emplace_back("hierarchical_mapper", &colmap::RunHierarchicalMapper);
   commands.emplace_back("image_deleter", &colmap::RunImageDeleter);
   commands.emplace_back("image_filterer", &colmap::RunImageFilterer);
@@ -106,6 +109,7 @@ int main(int argc, char** argv) {
                         &colmap::RunImageUndistorterStandalone);
   commands.emplace_back("mapper", &colmap::RunMapper);
   commands.emplace_back("matches_importer", &colmap::RunMatchesImporter);
+  commands.emplace_back("mesh_simplifier", &colmap::RunMeshSimplifier);
   commands.emplace_back("model_aligner", &colmap::RunModelAligner);
   commands.emplace_back("model_analyzer", &colmap::RunModelAnalyzer);
   commands.emplace_back("model_comparer", &colmap::RunModelComparer);
@@ -118,6 +122,8 @@ int main(int argc, char** argv) {
   commands.emplace_back("model_transformer", &colmap::RunModelTransformer);
   commands.emplace_back("patch_match_stereo", &colmap::RunPatchMatchStereo);
   commands.emplace_back("point_filtering", &colmap::RunPointFiltering);
+  commands.emplace_back("point_octree_builder",
+                        &colmap::RunPointOctreeBuilder);
   commands.emplace_back("point_triangulator", &colmap::RunPointTriangulator);
   commands.emplace_back("pose_prior_mapper", &colmap::RunPosePriorMapper);
   commands.emplace_back("poisson_mesher", &colmap::RunPoissonMesher);
@@ -127,6 +133,8 @@ int main(int argc, char** argv) {
   commands.emplace_back("sequential_matcher", &colmap::RunSequentialMatcher);
   commands.emplace_back("spatial_matcher", &colmap::RunSpatialMatcher);
   commands.emplace_back("stereo_fusion", &colmap::RunStereoFuser);
+  commands.emplace_back("stereo_map_converter",
+                        &colmap::RunStereoMapConverter);
   commands.emplace_back("transitive_matcher", &colmap::RunTransitiveMatcher);
   commands.emplace_back("vocab_tree_builder", &colmap::RunVocabTreeBuilder);
   commands.emplace_back("vocab_tree_matcher", &colmap::RunVocabTreeMatcher);
@@ -434,15 +434,22 @@ int RunModelAligner(int argc, char** argv) {
 int RunModelAnalyzer(int argc, char** argv) {
   std::string path;
   bool verbose = false;
+  bool recompute_errors = false;
 
   OptionManager options;
   options.AddRequiredOption("path", &path);
   options.AddDefaultOption("verbose", &verbose);
+  options.AddDefaultOption("recompute_errors", &recompute_errors);
   options.Parse(argc, argv);
 
   Reconstruction reconstruction;
   reconstruction.Read(path);
 
+  // The stored errors may be stale, e.g., after manually editing the model.
+  if (recompute_errors) {
+    reconstruction.UpdatePoint3DErrors();
+  }
+
   LOG(INFO) << StringPrintf("Rigs: %d", reconstruction.NumRigs());
   LOG(INFO) << StringPrintf("Cameras: %d", reconstruction.NumCameras());
   LOG(INFO) << StringPrintf("Frames: %d", reconstruction.NumFrames());
@@ -31,10 +31,14 @@
 
 #include "colmap/controllers/option_manager.h"
 #include "colmap/mvs/fusion.h"
+#include "colmap/mvs/mat_file.h"
+#include "colmap/mvs/mesh_simplification.h"
 #include "colmap/mvs/meshing.h"
 #include "colmap/mvs/patch_match.h"
+#include "colmap/mvs/point_octree.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/util/file.h"
+#include "colmap/util/threading.h"
 
 namespace colmap {
 
@@ -75,12 +79,38 @@ int RunDelaunayMesher(int argc, char** argv) {
 #endif  // COLMAP_CGAL_ENABLED
 }
 
+int RunMeshSimplifier(int argc, char** argv) {
+  std::string input_path;
+  std::string output_path;
+  mvs::MeshSimplificationOptions simplification_options;
+
+  OptionManager options;
+  options.AddRequiredOption("input_path", &input_path);
+  options.AddRequiredOption("output_path", &output_path);
+  options.AddDefaultOption("target_face_ratio",
+                           &simplification_options.target_face_ratio);
+  options.AddDefaultOption("target_num_faces",
+                           &simplification_options.target_num_faces);
+  options.AddDefaultOption("max_error", &simplification_options.max_error);
+  options.AddDefaultOption("boundary_weight",
+                           &simplification_options.boundary_weight);
+  options.AddDefaultOption("num_threads", &simplification_options.num_threads);
+  options.Parse(argc, argv);
+
+  if (!simplification_options.Check()) {
+    return EXIT_FAILURE;
+  }
+
+  bool has_rgb = false;
+  const PlyMesh mesh = ReadPlyMesh(input_path, &has_rgb);
+  const PlyMesh simplified_mesh =
+      mvs::SimplifyMesh(mesh, simplification_options);
+  WriteBinaryPlyMesh(output_path, simplified_mesh, /*write_rgb=*/has_rgb);
+
+  return EXIT_SUCCESS;
+}
+
 int RunPatchMatchStereo(int argc, char** argv) {
-#if !defined(COLMAP_CUDA_ENABLED)
-  LOG(ERROR) << "Dense stereo reconstruction requires CUDA, which is not "
-                "available on your system.";
-  return EXIT_FAILURE;
-#else   // COLMAP_CUDA_ENABLED
   std::string workspace_path;
   std::string workspace_format = "COLMAP";
   std::string pmvs_option_name = "option-all";
@@ -114,7 +144,6 @@ int RunPatchMatchStereo(int argc, char** argv) {
   controller.Run();
 
   return EXIT_SUCCESS;
-#endif  // COLMAP_CUDA_ENABLED
 }
 
 int RunPoissonMesher(int argc, char** argv) {
@@ -188,6 +217,20 @@ int RunStereoFuser(int argc, char** argv) {
                           pmvs_option_name,
                           input_type);
 
+  StringToLower(&output_type);
+
+  // Tiled fusion streams the fused points directly to the output file.
+  if (options.stereo_fusion->tile_memory_budget > 0) {
+    if (output_type != "ply") {
+      LOG(ERROR) << "Tiled fusion only supports `output_type` PLY.";
+      return EXIT_FAILURE;
+    }
+    LOG(INFO) << "Writing output: " << output_path;
+    fuser.SetOutputPath(output_path);
+    fuser.Run();
+    return EXIT_SUCCESS;
+  }
+
   fuser.Run();
 
   Reconstruction reconstruction;
@@ -203,7 +246,6 @@ int RunStereoFuser(int argc, char** argv) {
   LOG(INFO) << "Writing output: " << output_path;
 
   // write output
-  StringToLower(&output_type);
   if (output_type == "bin") {
     reconstruction.WriteBinary(output_path);
   } else if (output_type == "txt") {
@@ -220,4 +262,97 @@ int RunStereoFuser(int argc, char** argv) {
   return EXIT_SUCCESS;
 }
 
+int RunStereoMapConverter(int argc, char** argv) {
+  std::string input_path;
+  std::string output_path;
+  std::string output_type = "BIN";
+  mvs::MatFileOptions mat_file_options;
+
+  OptionManager options;
+  options.AddRequiredOption("input_path", &input_path);
+  options.AddRequiredOption("output_path", &output_path);
+  options.AddDefaultOption("output_type", &output_type, "{BIN, LEGACY}");
+  options.AddDefaultOption("half_precision", &mat_file_options.half_precision);
+  options.AddDefaultOption("compress", &mat_file_options.compress);
+  options.AddDefaultOption("tile_size", &mat_file_options.tile_size);
+  options.Parse(argc, argv);
+
+  StringToLower(&output_type);
+  if (output_type != "bin" && output_type != "legacy") {
+    LOG(ERROR) << "Invalid `output_type` - supported values are "
+                  "'BIN' or 'LEGACY'.";
+    return EXIT_FAILURE;
+  }
+
+  if (!mat_file_options.Check()) {
+    return EXIT_FAILURE;
+  }
+
+  // Convert a single map or all maps in a depth_maps or normal_maps folder.
+  std::vector<std::pair<std::string, std::string>> paths;
+  if (ExistsDir(input_path)) {
+    CreateDirIfNotExists(output_path);
+    for (const auto& path : GetFileList(input_path)) {
+      if (HasFileExtension(path, ".bin")) {
+        paths.emplace_back(path, JoinPaths(output_path, GetPathBaseName(path)));
+      }
+    }
+  } else {
+    paths.emplace_back(input_path, output_path);
+  }
+
+  auto ConvertMap = [&](const std::string& input_map_path,
+                        const std::string& output_map_path) {
+    mvs::Mat<float> mat;
+    mat.Read(input_map_path);
+    if (output_type == "bin") {
+      mvs::WriteMatFile(output_map_path, mat, mat_file_options);
+    } else {
+      mat.Write(output_map_path);
+    }
+  };
+
+  ThreadPool thread_pool;
+  std::vector<std::future<void>> futures;
+  futures.reserve(paths.size());
+  for (const auto& path : paths) {
+    futures.push_back(thread_pool.AddTask(ConvertMap, path.first, path.second));
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+
+  LOG(INFO) << StringPrintf("Converted %d maps", paths.size());
+
+  return EXIT_SUCCESS;
+}
+
+int RunPointOctreeBuilder(int argc, char** argv) {
+  std::string input_path;
+  std::string output_path;
+  mvs::PointOctreeOptions octree_options;
+
+  OptionManager options;
+  options.AddRequiredOption(
+      "input_path",
+      &input_path,
+      "Path to the fused PLY points. If <input_path>.vis exists, the merged "
+      "visibility is stored in the octree.");
+  options.AddRequiredOption("output_path", &output_path);
+  options.AddDefaultOption("max_num_leaf_points",
+                           &octree_options.max_num_leaf_points);
+  options.AddDefaultOption("node_resolution", &octree_options.node_resolution);
+  options.AddDefaultOption("max_depth", &octree_options.max_depth);
+  options.AddDefaultOption("chunk_size", &octree_options.chunk_size);
+  options.Parse(argc, argv);
+
+  if (!octree_options.Check()) {
+    return EXIT_FAILURE;
+  }
+
+  mvs::BuildPointOctree(input_path, output_path, octree_options);
+
+  return EXIT_SUCCESS;
+}
+
 }  // namespace colmap
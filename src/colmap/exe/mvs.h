@@ -30,8 +30,11 @@
 namespace colmap {
 
 int RunDelaunayMesher(int argc, char** argv);
+int RunMeshSimplifier(int argc, char** argv);
 int RunPatchMatchStereo(int argc, char** argv);
+int RunPointOctreeBuilder(int argc, char** argv);
 int RunPoissonMesher(int argc, char** argv);
 int RunStereoFuser(int argc, char** argv);
+int RunStereoMapConverter(int argc, char** argv);
 
 }  // namespace colmap
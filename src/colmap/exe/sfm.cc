@@ -31,8 +31,11 @@
 
 #include "colmap/controllers/automatic_reconstruction.h"
 #include "colmap/controllers/bundle_adjustment.h"
+#include "colmap/controllers/global_pipeline.h"
 #include "colmap/controllers/hierarchical_pipeline.h"
 #include "colmap/controllers/option_manager.h"
+#include "colmap/estimators/bundle_adjustment_calibration.h"
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
 #include "colmap/estimators/similarity_transform.h"
 #include "colmap/exe/gui.h"
 #include "colmap/scene/reconstruction.h"
@@ -154,10 +157,23 @@ int RunAutomaticReconstructor(int argc, char** argv) {
 int RunBundleAdjuster(int argc, char** argv) {
   std::string input_path;
   std::string output_path;
+  bool partitioned = false;
+  PartitionedBundleAdjustmentOptions partitioned_options;
 
   OptionManager options;
   options.AddRequiredOption("input_path", &input_path);
   options.AddRequiredOption("output_path", &output_path);
+  options.AddDefaultOption("partitioned", &partitioned);
+  options.AddDefaultOption("partition_max_num_images",
+                           &partitioned_options.leaf_max_num_images);
+  options.AddDefaultOption("partition_image_overlap",
+                           &partitioned_options.image_overlap);
+  options.AddDefaultOption("partition_num_workers",
+                           &partitioned_options.num_workers);
+  options.AddDefaultOption("partition_max_num_iterations",
+                           &partitioned_options.max_num_iterations);
+  options.AddDefaultOption("partition_tolerance",
+                           &partitioned_options.tolerance);
   options.AddBundleAdjustmentOptions();
   options.Parse(argc, argv);
 
@@ -174,7 +190,10 @@ int RunBundleAdjuster(int argc, char** argv) {
   auto reconstruction = std::make_shared<Reconstruction>();
   reconstruction->Read(input_path);
 
-  BundleAdjustmentController ba_controller(options, reconstruction);
+  BundleAdjustmentController ba_controller(
+      options,
+      reconstruction,
+      partitioned ? std::make_optional(partitioned_options) : std::nullopt);
   ba_controller.Run();
 
   reconstruction->Write(output_path);
@@ -182,6 +201,42 @@ int RunBundleAdjuster(int argc, char** argv) {
   return EXIT_SUCCESS;
 }
 
+int RunBundleAdjusterCalibrator(int argc, char** argv) {
+  std::string output_path;
+  BundleAdjustmentSolverCalibrationOptions calibration_options;
+  std::string num_images = VectorToCSV(calibration_options.num_images);
+
+  OptionManager options;
+  options.AddRequiredOption("output_path", &output_path);
+  options.AddDefaultOption("num_images", &num_images);
+  options.AddDefaultOption("num_observations_per_image",
+                           &calibration_options.num_observations_per_image);
+  options.AddDefaultOption("track_length", &calibration_options.track_length);
+  options.AddDefaultOption("point2D_stddev",
+                           &calibration_options.point2D_stddev);
+  options.AddDefaultOption("num_iterations",
+                           &calibration_options.num_iterations);
+  options.AddDefaultOption("num_threads", &calibration_options.num_threads);
+  options.AddDefaultOption("max_slowdown", &calibration_options.max_slowdown);
+  options.Parse(argc, argv);
+
+  calibration_options.num_images = CSVToVector<int>(num_images);
+
+  const BundleAdjustmentSolverProfile profile =
+      CalibrateBundleAdjustmentSolverProfile(calibration_options);
+
+  LOG(INFO) << "Maximum number of images for dense solver: "
+            << profile.max_num_images_direct_dense_cpu_solver;
+  LOG(INFO) << "Maximum number of images for sparse solver: "
+            << profile.max_num_images_direct_sparse_cpu_solver;
+  LOG(INFO) << "Minimum number of residuals for multi-threading: "
+            << profile.min_num_residuals_for_cpu_multi_threading;
+
+  WriteBundleAdjustmentSolverProfile(output_path, profile);
+
+  return EXIT_SUCCESS;
+}
+
 int RunColorExtractor(int argc, char** argv) {
   std::string input_path;
   std::string output_path;
@@ -304,6 +359,51 @@ int RunMapper(int argc, char** argv) {
   return EXIT_SUCCESS;
 }
 
+int RunGlobalMapper(int argc, char** argv) {
+  GlobalPipeline::Options mapper_options;
+  std::string output_path;
+
+  OptionManager options;
+  options.AddRequiredOption("database_path", &mapper_options.database_path);
+  options.AddRequiredOption("image_path", &mapper_options.image_path);
+  options.AddRequiredOption("output_path", &output_path);
+  options.AddDefaultOption(
+      "min_num_inliers", &mapper_options.global_mapper_options.min_num_inliers);
+  options.AddDefaultOption(
+      "max_num_tracks", &mapper_options.global_mapper_options.max_num_tracks);
+  options.AddDefaultOption(
+      "min_track_length",
+      &mapper_options.global_mapper_options.min_track_length);
+  options.AddDefaultOption("max_rotation_error_deg",
+                           &mapper_options.global_mapper_options
+                                .rotation_averaging.max_rotation_error_deg);
+  options.AddDefaultOption("max_angular_error_deg",
+                           &mapper_options.global_mapper_options
+                                .global_positioning.max_angular_error_deg);
+  options.AddMapperOptions();
+  options.Parse(argc, argv);
+
+  if (!ExistsDir(output_path)) {
+    LOG(ERROR) << "`output_path` is not a directory.";
+    return EXIT_FAILURE;
+  }
+
+  mapper_options.incremental_options = *options.mapper;
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  GlobalPipeline global_mapper(mapper_options, reconstruction_manager);
+  global_mapper.Run();
+
+  if (reconstruction_manager->Size() == 0) {
+    LOG(ERROR) << "failed to create sparse model";
+    return EXIT_FAILURE;
+  }
+
+  reconstruction_manager->Write(output_path);
+  options.Write(JoinPaths(output_path, "project.ini"));
+
+  return EXIT_SUCCESS;
+}
+
 int RunHierarchicalMapper(int argc, char** argv) {
   HierarchicalPipeline::Options mapper_options;
   std::string output_path;
@@ -313,6 +413,7 @@ int RunHierarchicalMapper(int argc, char** argv) {
   options.AddRequiredOption("image_path", &mapper_options.image_path);
   options.AddRequiredOption("output_path", &output_path);
   options.AddDefaultOption("num_workers", &mapper_options.num_workers);
+  options.AddDefaultOption("final_global_ba", &mapper_options.final_global_ba);
   options.AddDefaultOption("image_overlap",
                            &mapper_options.clustering_options.image_overlap);
   options.AddDefaultOption(
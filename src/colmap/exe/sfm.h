@@ -45,7 +45,9 @@ void RunPointTriangulatorImpl(
 
 int RunAutomaticReconstructor(int argc, char** argv);
 int RunBundleAdjuster(int argc, char** argv);
+int RunBundleAdjusterCalibrator(int argc, char** argv);
 int RunColorExtractor(int argc, char** argv);
+int RunGlobalMapper(int argc, char** argv);
 int RunMapper(int argc, char** argv);
 int RunHierarchicalMapper(int argc, char** argv);
 int RunPosePriorMapper(int argc, char** argv);
@@ -32,6 +32,7 @@
 #include "colmap/geometry/pose.h"
 #include "colmap/image/warp.h"
 #include "colmap/scene/reconstruction_io.h"
+#include "colmap/sensor/inverse_distortion_grid.h"
 #include "colmap/sensor/models.h"
 #include "colmap/util/misc.h"
 #include "colmap/util/threading.h"
@@ -969,38 +970,54 @@ void UndistortImage(const UndistortCameraOptions& options,
 
 void UndistortReconstruction(const UndistortCameraOptions& options,
                              Reconstruction* reconstruction) {
-  const std::unordered_map<camera_t, Camera> distorted_cameras =
+  std::unordered_map<camera_t, size_t> num_points2D_per_camera;
+  for (const auto& [_, image] : reconstruction->Images()) {
+    num_points2D_per_camera[image.CameraId()] += image.NumPoints2D();
+  }
+
+  std::unordered_map<camera_t, Camera> distorted_cameras =
       reconstruction->Cameras();
-  for (const auto& camera : distorted_cameras) {
-    if (camera.second.IsUndistorted()) {
+  for (auto& [camera_id, camera] : distorted_cameras) {
+    if (camera.IsUndistorted()) {
       continue;
     }
-    reconstruction->Camera(camera.first) =
-        UndistortCamera(options, camera.second);
+    reconstruction->Camera(camera_id) = UndistortCamera(options, camera);
+    // Lifting many points through the cached inverse distortion is faster
+    // than solving for each of them, once the grid nodes are amortized.
+    const InverseDistortionGridOptions grid_options;
+    const double num_grid_nodes = camera.width * camera.height /
+                                  (grid_options.node_spacing *
+                                   grid_options.node_spacing);
+    if (num_points2D_per_camera[camera_id] > num_grid_nodes) {
+      camera.BuildInverseDistortionGrid(grid_options);
+    }
   }
 
   for (const auto& distorted_image : reconstruction->Images()) {
     Image& image = reconstruction->Image(distorted_image.first);
     const Camera& distorted_camera = distorted_cameras.at(image.CameraId());
     const Camera& undistorted_camera = *image.CameraPtr();
-    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+    const size_t num_points2D = image.NumPoints2D();
+    std::vector<Eigen::Vector2d> points2D(num_points2D);
+    for (point2D_t point2D_idx = 0; point2D_idx < num_points2D;
          ++point2D_idx) {
-      auto& point2D = image.Point2D(point2D_idx);
-      const std::optional<Eigen::Vector2d> cam_point =
-          distorted_camera.CamFromImg(point2D.xy);
-      if (!cam_point) {
-        point2D.xy =
-            Eigen::Vector2d::Constant(std::numeric_limits<double>::quiet_NaN());
-      } else {
-        const std::optional<Eigen::Vector2d> undistorted_point =
-            undistorted_camera.ImgFromCam(cam_point->homogeneous());
-        if (undistorted_point) {
-          point2D.xy = *undistorted_point;
-        } else {
-          point2D.xy = Eigen::Vector2d::Constant(
-              std::numeric_limits<double>::quiet_NaN());
-        }
-      }
+      points2D[point2D_idx] = image.Point2D(point2D_idx).xy;
+    }
+    // Failed transformations yield NaN, which propagates to the output.
+    std::vector<Eigen::Vector2d> cam_points(num_points2D);
+    distorted_camera.CamFromImgBatch(
+        span<const Eigen::Vector2d>(points2D.data(), num_points2D),
+        span<Eigen::Vector2d>(cam_points.data(), num_points2D));
+    std::vector<Eigen::Vector3d> cam_points_h(num_points2D);
+    for (size_t i = 0; i < num_points2D; ++i) {
+      cam_points_h[i] = cam_points[i].homogeneous();
+    }
+    undistorted_camera.ImgFromCamBatch(
+        span<const Eigen::Vector3d>(cam_points_h.data(), num_points2D),
+        span<Eigen::Vector2d>(points2D.data(), num_points2D));
+    for (point2D_t point2D_idx = 0; point2D_idx < num_points2D;
+         ++point2D_idx) {
+      image.Point2D(point2D_idx).xy = points2D[point2D_idx];
     }
   }
 }
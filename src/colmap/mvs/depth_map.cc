@@ -48,11 +48,8 @@ DepthMap::DepthMap(const size_t width,
 DepthMap::DepthMap(const Mat<float>& mat,
                    const float depth_min,
                    const float depth_max)
-    : Mat<float>(mat.GetWidth(), mat.GetHeight(), mat.GetDepth()),
-      depth_min_(depth_min),
-      depth_max_(depth_max) {
+    : Mat<float>(mat), depth_min_(depth_min), depth_max_(depth_max) {
   THROW_CHECK_EQ(mat.GetDepth(), 1);
-  data_ = mat.GetData();
 }
 
 void DepthMap::Rescale(const float factor) {
@@ -63,9 +60,11 @@ void DepthMap::Rescale(const float factor) {
   const size_t new_width = std::round(width_ * factor);
   const size_t new_height = std::round(height_ * factor);
   std::vector<float> new_data(new_width * new_height);
+  const Mat<float>& mat = *this;
   DownsampleImage(
-      data_.data(), height_, width_, new_height, new_width, new_data.data());
+      mat.GetPtr(), height_, width_, new_height, new_width, new_data.data());
 
+  mapped_data_.reset();
   data_ = new_data;
   width_ = new_width;
   height_ = new_height;
@@ -91,8 +90,10 @@ Bitmap DepthMap::ToBitmap(const float min_percentile,
   bitmap.Allocate(width_, height_, true);
 
   std::vector<float> valid_depths;
-  valid_depths.reserve(data_.size());
-  for (const float depth : data_) {
+  const float* depths = GetPtr();
+  valid_depths.reserve(width_ * height_);
+  for (size_t i = 0; i < width_ * height_; ++i) {
+    const float depth = depths[i];
     if (depth > 0) {
       valid_depths.push_back(depth);
     }
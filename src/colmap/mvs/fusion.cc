@@ -37,6 +37,9 @@
 #include "colmap/util/threading.h"
 #include "colmap/util/timer.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <Eigen/Geometry>
 
 namespace colmap {
@@ -69,6 +72,308 @@ int FindNextImage(const std::vector<std::vector<int>>& overlapping_images,
   return -1;
 }
 
+FusedPixelMask::FusedPixelMask(const size_t width, const size_t height)
+    : width_(width),
+      height_(height),
+      data_(std::make_unique<std::atomic<char>[]>(width * height)) {
+  for (size_t i = 0; i < width_ * height_; ++i) {
+    data_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+FusionTileScheduler::FusionTileScheduler(
+    const int num_workers,
+    const int tile_height,
+    const int tile_width,
+    std::vector<int> image_order,
+    std::vector<std::pair<int, int>> image_sizes)
+    : tile_height_(tile_height),
+      tile_width_(tile_width),
+      image_order_(std::move(image_order)),
+      image_sizes_(std::move(image_sizes)),
+      next_image_pos_(0),
+      num_remaining_tiles_(image_sizes_.size()) {
+  THROW_CHECK_GT(num_workers, 0);
+  THROW_CHECK_GT(tile_height_, 0);
+  THROW_CHECK_GT(tile_width_, 0);
+  queues_.reserve(num_workers);
+  for (int worker_id = 0; worker_id < num_workers; ++worker_id) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+  for (auto& num_tiles : num_remaining_tiles_) {
+    num_tiles.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool FusionTileScheduler::Next(const int worker_id, FusionTile* tile) {
+  THROW_CHECK_NOTNULL(tile);
+  const int num_workers = NumWorkers();
+  while (true) {
+    // Process own tiles from the front in row-major order.
+    {
+      WorkerQueue& queue = *queues_.at(worker_id);
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tiles.empty()) {
+        *tile = queue.tiles.front();
+        queue.tiles.pop_front();
+        return true;
+      }
+    }
+
+    // Steal from the back of other queues, which keeps the stolen tiles
+    // spatially far apart from the tiles currently processed by the owner.
+    // Nearby reference pixels likely fuse into the same point, so this reduces
+    // contention on the fused pixel masks.
+    for (int i = 1; i < num_workers; ++i) {
+      WorkerQueue& queue = *queues_[(worker_id + i) % num_workers];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tiles.empty()) {
+        *tile = queue.tiles.back();
+        queue.tiles.pop_back();
+        return true;
+      }
+    }
+
+    if (!OpenNextImage(worker_id)) {
+      return false;
+    }
+  }
+}
+
+bool FusionTileScheduler::Finish(const FusionTile& tile) {
+  return num_remaining_tiles_.at(tile.image_idx)
+             .fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+int FusionTileScheduler::NumWorkers() const { return queues_.size(); }
+
+bool FusionTileScheduler::OpenNextImage(const int worker_id) {
+  while (true) {
+    const size_t pos = next_image_pos_.fetch_add(1);
+    if (pos >= image_order_.size()) {
+      return false;
+    }
+
+    const int image_idx = image_order_[pos];
+    const int width = image_sizes_.at(image_idx).first;
+    const int height = image_sizes_.at(image_idx).second;
+    const int num_tile_rows = (height + tile_height_ - 1) / tile_height_;
+    const int num_tile_cols = (width + tile_width_ - 1) / tile_width_;
+    if (num_tile_rows == 0 || num_tile_cols == 0) {
+      continue;
+    }
+
+    // Set the counter before publishing the tiles, since other workers may
+    // steal and finish them immediately.
+    num_remaining_tiles_[image_idx].store(num_tile_rows * num_tile_cols,
+                                          std::memory_order_release);
+
+    WorkerQueue& queue = *queues_.at(worker_id);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    for (int tile_row = 0; tile_row < num_tile_rows; ++tile_row) {
+      for (int tile_col = 0; tile_col < num_tile_cols; ++tile_col) {
+        FusionTile tile;
+        tile.image_idx = image_idx;
+        tile.row_begin = tile_row * tile_height_;
+        tile.row_end = std::min(height, tile.row_begin + tile_height_);
+        tile.col_begin = tile_col * tile_width_;
+        tile.col_end = std::min(width, tile.col_begin + tile_width_);
+        queue.tiles.push_back(tile);
+      }
+    }
+    return true;
+  }
+}
+
+std::vector<FusionCell> PartitionFusionCells(
+    const Model& model,
+    const std::vector<size_t>& image_num_bytes,
+    const std::pair<Eigen::Vector3f, Eigen::Vector3f>& bounding_box,
+    const size_t max_num_bytes,
+    const double overlap) {
+  THROW_CHECK_EQ(model.images.size(), image_num_bytes.size());
+  THROW_CHECK_GE(overlap, 0);
+
+  auto GetPoint = [&model](const int point_idx) {
+    const auto& point = model.points[point_idx];
+    return Eigen::Vector3f(point.x, point.y, point.z);
+  };
+
+  auto IsInsideBox =
+      [](const Eigen::Vector3f& xyz,
+         const std::pair<Eigen::Vector3f, Eigen::Vector3f>& box) {
+        return (xyz.array() >= box.first.array()).all() &&
+               (xyz.array() <= box.second.array()).all();
+      };
+
+  auto IsInsideCell =
+      [](const Eigen::Vector3f& xyz,
+         const std::pair<Eigen::Vector3f, Eigen::Vector3f>& box) {
+        return (xyz.array() >= box.first.array()).all() &&
+               (xyz.array() < box.second.array()).all();
+      };
+
+  struct Node {
+    std::pair<Eigen::Vector3f, Eigen::Vector3f> box;
+    // Sparse points inside the fusion box of the parent node, which contains
+    // the fusion boxes of both children.
+    std::vector<int> point_idxs;
+  };
+
+  // The bounding box is inclusive, whereas the cells are half-open.
+  Node root;
+  root.box.first = bounding_box.first;
+  root.box.second = bounding_box.second.unaryExpr([](const float value) {
+    return std::nextafter(value, std::numeric_limits<float>::infinity());
+  });
+  for (size_t point_idx = 0; point_idx < model.points.size(); ++point_idx) {
+    if (IsInsideBox(GetPoint(point_idx), bounding_box)) {
+      root.point_idxs.push_back(point_idx);
+    }
+  }
+
+  std::vector<FusionCell> cells;
+  std::vector<char> cell_images(model.images.size(), false);
+
+  std::vector<Node> nodes;
+  nodes.push_back(std::move(root));
+  while (!nodes.empty()) {
+    const Node node = std::move(nodes.back());
+    nodes.pop_back();
+
+    Eigen::Vector3f points_min =
+        Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+    Eigen::Vector3f points_max =
+        Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest());
+    std::vector<float> cell_coords[3];
+    for (const int point_idx : node.point_idxs) {
+      const Eigen::Vector3f xyz = GetPoint(point_idx);
+      if (IsInsideCell(xyz, node.box)) {
+        points_min = points_min.cwiseMin(xyz);
+        points_max = points_max.cwiseMax(xyz);
+        for (int axis = 0; axis < 3; ++axis) {
+          cell_coords[axis].push_back(xyz(axis));
+        }
+      }
+    }
+
+    const size_t num_cell_points = cell_coords[0].size();
+    if (num_cell_points == 0) {
+      continue;
+    }
+
+    FusionCell cell;
+    cell.box = node.box;
+    const Eigen::Vector3f margin = overlap * (points_max - points_min);
+    cell.fusion_box.first =
+        (node.box.first - margin).cwiseMax(bounding_box.first);
+    cell.fusion_box.second =
+        (node.box.second + margin).cwiseMin(bounding_box.second);
+
+    std::vector<int> fusion_point_idxs;
+    for (const int point_idx : node.point_idxs) {
+      if (!IsInsideBox(GetPoint(point_idx), cell.fusion_box)) {
+        continue;
+      }
+      fusion_point_idxs.push_back(point_idx);
+      for (const int image_idx : model.points[point_idx].track) {
+        if (image_num_bytes.at(image_idx) > 0 && !cell_images[image_idx]) {
+          cell_images[image_idx] = true;
+          cell.image_idxs.push_back(image_idx);
+          cell.num_bytes += image_num_bytes[image_idx];
+        }
+      }
+    }
+
+    for (const int image_idx : cell.image_idxs) {
+      cell_images[image_idx] = false;
+    }
+
+    if (cell.image_idxs.empty()) {
+      continue;
+    }
+
+    if (cell.num_bytes > max_num_bytes && num_cell_points > 1) {
+      int split_axis;
+      (points_max - points_min).maxCoeff(&split_axis);
+      auto& coords = cell_coords[split_axis];
+      const auto median = coords.begin() + coords.size() / 2;
+      std::nth_element(coords.begin(), median, coords.end());
+      // Split halfway between the median and the next smaller coordinate, so
+      // that the split plane does not pass through a sparse point.
+      const float lower = *std::max_element(coords.begin(), median);
+      const float split = lower < *median ? 0.5f * (lower + *median) : *median;
+      // Only split, if both children contain sparse points.
+      if (split > points_min(split_axis)) {
+        Node left;
+        left.box = node.box;
+        left.box.second(split_axis) = split;
+        left.point_idxs = fusion_point_idxs;
+        Node right;
+        right.box = node.box;
+        right.box.first(split_axis) = split;
+        right.point_idxs = std::move(fusion_point_idxs);
+        // Depth-first order, such that consecutive cells share many images.
+        nodes.push_back(std::move(right));
+        nodes.push_back(std::move(left));
+        continue;
+      }
+    }
+
+    if (cell.num_bytes > max_num_bytes) {
+      LOG(WARNING) << StringPrintf(
+          "Cell with %d images exceeds the memory budget (%.3fGB)",
+          cell.image_idxs.size(),
+          cell.num_bytes / (1024.0 * 1024.0 * 1024.0));
+    }
+
+    std::sort(cell.image_idxs.begin(), cell.image_idxs.end());
+    cells.push_back(std::move(cell));
+  }
+
+  return cells;
+}
+
+FusedPointsWriter::FusedPointsWriter(const std::string& path)
+    : ply_writer_(path) {
+  const std::string vis_path = path + ".vis";
+  vis_file_.open(vis_path, std::ios::out | std::ios::binary);
+  THROW_CHECK_FILE_OPEN(vis_file_, vis_path);
+  WriteBinaryLittleEndian<uint64_t>(&vis_file_, 0);
+}
+
+FusedPointsWriter::~FusedPointsWriter() { Close(); }
+
+void FusedPointsWriter::Write(
+    const std::vector<PlyPoint>& points,
+    const std::vector<std::vector<int>>& points_visibility) {
+  THROW_CHECK(vis_file_.is_open());
+  THROW_CHECK_EQ(points.size(), points_visibility.size());
+
+  ply_writer_.Write(points);
+
+  for (const auto& visibility : points_visibility) {
+    WriteBinaryLittleEndian<uint32_t>(&vis_file_, visibility.size());
+    for (const auto& image_idx : visibility) {
+      WriteBinaryLittleEndian<uint32_t>(&vis_file_, image_idx);
+    }
+  }
+}
+
+void FusedPointsWriter::Close() {
+  if (!vis_file_.is_open()) {
+    return;
+  }
+
+  ply_writer_.Close();
+
+  vis_file_.seekp(0);
+  WriteBinaryLittleEndian<uint64_t>(&vis_file_, ply_writer_.NumPoints());
+  vis_file_.close();
+}
+
+size_t FusedPointsWriter::NumPoints() const { return ply_writer_.NumPoints(); }
+
 }  // namespace internal
 
 void StereoFusionOptions::Print() const {
@@ -89,6 +394,8 @@ void StereoFusionOptions::Print() const {
   const auto& bbox_max = bounding_box.second.transpose().eval();
   PrintOption(bbox_min);
   PrintOption(bbox_max);
+  PrintOption(tile_memory_budget);
+  PrintOption(tile_overlap);
 #undef PrintOption
 }
 
@@ -101,6 +408,7 @@ bool StereoFusionOptions::Check() const {
   CHECK_OPTION_GE(max_normal_error, 0);
   CHECK_OPTION_GT(check_num_images, 0);
   CHECK_OPTION_GT(cache_size, 0);
+  CHECK_OPTION_GE(tile_overlap, 0);
   return true;
 }
 
@@ -116,7 +424,10 @@ StereoFusion::StereoFusion(const StereoFusionOptions& options,
       input_type_(input_type),
       max_squared_reproj_error_(options_.max_reproj_error *
                                 options_.max_reproj_error),
-      min_cos_normal_error_(std::cos(DegToRad(options_.max_normal_error))) {
+      min_cos_normal_error_(std::cos(DegToRad(options_.max_normal_error))),
+      bounding_box_(options_.bounding_box),
+      num_fused_images_(0),
+      num_fused_points_(0) {
   THROW_CHECK(options_.Check());
 }
 
@@ -129,6 +440,10 @@ const std::vector<std::vector<int>>& StereoFusion::GetFusedPointsVisibility()
   return fused_points_visibility_;
 }
 
+void StereoFusion::SetOutputPath(const std::string& path) {
+  output_path_ = path;
+}
+
 void StereoFusion::Run() {
   Timer run_timer;
   run_timer.Start();
@@ -138,6 +453,12 @@ void StereoFusion::Run() {
 
   options_.Print();
 
+  const bool tiled = options_.tile_memory_budget > 0;
+  if (tiled && output_path_.empty()) {
+    LOG(ERROR) << "Tiled fusion requires an output path.";
+    return;
+  }
+
   LOG(INFO) << "Reading workspace...";
 
   Workspace::Options workspace_options;
@@ -153,6 +474,11 @@ void StereoFusion::Run() {
   workspace_options.max_image_size = options_.max_image_size;
   workspace_options.image_as_rgb = true;
   workspace_options.cache_size = options_.cache_size;
+  // In tiled mode, the cache must not hold more than the data of one cell.
+  if (tiled) {
+    workspace_options.cache_size =
+        std::min(options_.cache_size, options_.tile_memory_budget);
+  }
   workspace_options.workspace_path = workspace_path_;
   workspace_options.workspace_format = workspace_format_;
   workspace_options.input_type = input_type_;
@@ -164,7 +490,10 @@ void StereoFusion::Run() {
     workspace_ = std::make_unique<CachedWorkspace>(workspace_options);
   } else {
     workspace_ = std::make_unique<Workspace>(workspace_options);
-    workspace_->Load(image_names);
+    // In tiled mode, the data is loaded cell by cell.
+    if (!tiled) {
+      workspace_->Load(image_names);
+    }
     num_threads = GetEffectiveNumThreads(options_.num_threads);
   }
 
@@ -179,17 +508,19 @@ void StereoFusion::Run() {
 
   const double kMinTriangulationAngle = 0;
   if (model.GetMaxOverlappingImagesFromPMVS().empty()) {
-    overlapping_images_ = model.GetMaxOverlappingImages(
-        options_.check_num_images, kMinTriangulationAngle);
+    overlapping_images_ =
+        model.GetMaxOverlappingImages(options_.check_num_images,
+                                      kMinTriangulationAngle,
+                                      workspace_->GetImageOverlapsPath());
   } else {
     overlapping_images_ = model.GetMaxOverlappingImagesFromPMVS();
   }
 
   task_fused_points_.resize(num_threads);
   task_fused_points_visibility_.resize(num_threads);
+  worker_image_handles_.resize(num_threads);
 
   used_images_.resize(model.images.size(), false);
-  fused_images_.resize(model.images.size(), false);
   fused_pixel_masks_.resize(model.images.size());
   depth_map_sizes_.resize(model.images.size());
   bitmap_scales_.resize(model.images.size());
@@ -197,6 +528,7 @@ void StereoFusion::Run() {
   inv_P_.resize(model.images.size());
   inv_R_.resize(model.images.size());
 
+  std::vector<char> valid_images(model.images.size(), false);
   for (const auto& image_name : image_names) {
     const int image_idx = model.GetImageIdx(image_name);
 
@@ -209,137 +541,275 @@ void StereoFusion::Run() {
       continue;
     }
 
-    const auto& image = model.images.at(image_idx);
-    const auto& depth_map = workspace_->GetDepthMap(image_idx);
+    valid_images.at(image_idx) = true;
+  }
 
-    used_images_.at(image_idx) = true;
+  if (tiled) {
+    RunTiled(valid_images, num_threads);
+  } else {
+    bounding_box_ = options_.bounding_box;
+    used_images_ = valid_images;
+    for (size_t image_idx = 0; image_idx < used_images_.size(); ++image_idx) {
+      if (used_images_[image_idx]) {
+        InitImage(image_idx);
+      }
+    }
 
-    InitFusedPixelMask(image_idx, depth_map.GetWidth(), depth_map.GetHeight());
+    FuseImages(num_threads);
 
-    depth_map_sizes_.at(image_idx) =
-        std::make_pair(depth_map.GetWidth(), depth_map.GetHeight());
+    size_t total_fused_points = 0;
+    for (const auto& task_fused_points : task_fused_points_) {
+      total_fused_points += task_fused_points.size();
+    }
 
-    bitmap_scales_.at(image_idx) = std::make_pair(
-        static_cast<float>(depth_map.GetWidth()) / image.GetWidth(),
-        static_cast<float>(depth_map.GetHeight()) / image.GetHeight());
+    fused_points_.reserve(total_fused_points);
+    fused_points_visibility_.reserve(total_fused_points);
+    for (size_t thread_id = 0; thread_id < task_fused_points_.size();
+         ++thread_id) {
+      fused_points_.insert(fused_points_.end(),
+                           task_fused_points_[thread_id].begin(),
+                           task_fused_points_[thread_id].end());
+      task_fused_points_[thread_id].clear();
+
+      fused_points_visibility_.insert(
+          fused_points_visibility_.end(),
+          task_fused_points_visibility_[thread_id].begin(),
+          task_fused_points_visibility_[thread_id].end());
+      task_fused_points_visibility_[thread_id].clear();
+    }
+    num_fused_points_ = fused_points_.size();
 
-    Eigen::Matrix<float, 3, 3, Eigen::RowMajor> K =
-        Eigen::Map<const Eigen::Matrix<float, 3, 3, Eigen::RowMajor>>(
-            image.GetK());
-    K(0, 0) *= bitmap_scales_.at(image_idx).first;
-    K(0, 2) *= bitmap_scales_.at(image_idx).first;
-    K(1, 1) *= bitmap_scales_.at(image_idx).second;
-    K(1, 2) *= bitmap_scales_.at(image_idx).second;
+    if (!output_path_.empty()) {
+      internal::FusedPointsWriter writer(output_path_);
+      writer.Write(fused_points_, fused_points_visibility_);
+      writer.Close();
+    }
+  }
 
-    ComposeProjectionMatrix(
-        K.data(), image.GetR(), image.GetT(), P_.at(image_idx).data());
-    ComposeInverseProjectionMatrix(
-        K.data(), image.GetR(), image.GetT(), inv_P_.at(image_idx).data());
-    inv_R_.at(image_idx) =
-        Eigen::Map<const Eigen::Matrix<float, 3, 3, Eigen::RowMajor>>(
-            image.GetR())
-            .transpose();
+  if (num_fused_points_ == 0) {
+    LOG(WARNING)
+        << "Could not fuse any points. This is likely caused by "
+           "incorrect settings - filtering must be enabled for the last "
+           "call to patch match stereo.";
   }
 
-  LOG(INFO) << StringPrintf("Starting fusion with %d threads", num_threads);
-  ThreadPool thread_pool(num_threads);
+  LOG(INFO) << "Number of fused points: " << num_fused_points_;
+  run_timer.PrintMinutes();
+}
 
-  // Using a row stride of 10 to avoid starting parallel processing in rows that
-  // are too close to each other which may lead to duplicated work, since nearby
-  // pixels are likely to get fused into the same point.
-  const int kRowStride = 10;
-  auto ProcessImageRows = [&, this](const int row_start,
-                                    const int height,
-                                    const int width,
-                                    const int image_idx,
-                                    const Mat<char>& fused_pixel_mask) {
-    const int row_end = std::min(height, row_start + kRowStride);
-    for (int row = row_start; row < row_end; ++row) {
-      for (int col = 0; col < width; ++col) {
-        if (fused_pixel_mask.Get(row, col) > 0) {
-          continue;
-        }
-        const int thread_id = thread_pool.GetThreadIndex();
-        Fuse(thread_id, image_idx, row, col);
-      }
+void StereoFusion::InitImage(const int image_idx) {
+  const auto& image = workspace_->GetModel().images.at(image_idx);
+  const auto depth_map = workspace_->GetDepthMap(image_idx);
+
+  InitFusedPixelMask(image_idx, depth_map->GetWidth(), depth_map->GetHeight());
+
+  depth_map_sizes_.at(image_idx) =
+      std::make_pair(depth_map->GetWidth(), depth_map->GetHeight());
+
+  bitmap_scales_.at(image_idx) = std::make_pair(
+      static_cast<float>(depth_map->GetWidth()) / image.GetWidth(),
+      static_cast<float>(depth_map->GetHeight()) / image.GetHeight());
+
+  Eigen::Matrix<float, 3, 3, Eigen::RowMajor> K =
+      Eigen::Map<const Eigen::Matrix<float, 3, 3, Eigen::RowMajor>>(
+          image.GetK());
+  K(0, 0) *= bitmap_scales_.at(image_idx).first;
+  K(0, 2) *= bitmap_scales_.at(image_idx).first;
+  K(1, 1) *= bitmap_scales_.at(image_idx).second;
+  K(1, 2) *= bitmap_scales_.at(image_idx).second;
+
+  ComposeProjectionMatrix(
+      K.data(), image.GetR(), image.GetT(), P_.at(image_idx).data());
+  ComposeInverseProjectionMatrix(
+      K.data(), image.GetR(), image.GetT(), inv_P_.at(image_idx).data());
+  inv_R_.at(image_idx) =
+      Eigen::Map<const Eigen::Matrix<float, 3, 3, Eigen::RowMajor>>(
+          image.GetR())
+          .transpose();
+}
+
+void StereoFusion::RunTiled(const std::vector<char>& valid_images,
+                            const int num_threads) {
+  const auto& model = workspace_->GetModel();
+
+  // Bitmap, depth map, normal map, and fused pixel mask.
+  const size_t kNumBytesPerPixel = 3 + sizeof(float) + 3 * sizeof(float) + 1;
+  std::vector<size_t> image_num_bytes(model.images.size(), 0);
+  for (size_t image_idx = 0; image_idx < model.images.size(); ++image_idx) {
+    if (valid_images[image_idx]) {
+      const auto& image = model.images[image_idx];
+      image_num_bytes[image_idx] = static_cast<size_t>(image.GetWidth()) *
+                                   image.GetHeight() * kNumBytesPerPixel;
     }
-  };
+  }
 
-  size_t num_fused_images = 0;
-  size_t total_fused_points = 0;
-  for (int image_idx = 0; image_idx >= 0;
-       image_idx = internal::FindNextImage(
-           overlapping_images_, used_images_, fused_images_, image_idx)) {
+  const size_t max_num_bytes = static_cast<size_t>(
+      1024.0 * 1024.0 * 1024.0 * options_.tile_memory_budget);
+  const std::vector<internal::FusionCell> cells =
+      internal::PartitionFusionCells(model,
+                                     image_num_bytes,
+                                     options_.bounding_box,
+                                     max_num_bytes,
+                                     options_.tile_overlap);
+
+  LOG(INFO) << StringPrintf("Fusing %d cells", cells.size());
+
+  internal::FusedPointsWriter writer(output_path_);
+
+  std::vector<char> loaded_images(model.images.size(), false);
+  for (size_t cell_idx = 0; cell_idx < cells.size(); ++cell_idx) {
     if (CheckIfStopped()) {
       break;
     }
 
-    Timer timer;
-    timer.Start();
+    const auto& cell = cells[cell_idx];
+
+    LOG(INFO) << StringPrintf("Fusing cell [%d/%d] with %d images (%.3fGB)",
+                              cell_idx + 1,
+                              cells.size(),
+                              cell.image_idxs.size(),
+                              cell.num_bytes / (1024.0 * 1024.0 * 1024.0));
+
+    // Release the data of images outside the current cell before loading the
+    // data of the new images, so that the peak memory is bounded by the cell.
+    std::vector<char> cell_images(model.images.size(), false);
+    for (const int image_idx : cell.image_idxs) {
+      cell_images[image_idx] = true;
+    }
+
+    std::vector<std::string> unload_image_names;
+    for (size_t image_idx = 0; image_idx < loaded_images.size(); ++image_idx) {
+      if (loaded_images[image_idx] && !cell_images[image_idx]) {
+        unload_image_names.push_back(model.GetImageName(image_idx));
+        loaded_images[image_idx] = false;
+        fused_pixel_masks_[image_idx] = internal::FusedPixelMask();
+      }
+    }
+    workspace_->Unload(unload_image_names);
 
-    LOG(INFO) << StringPrintf("Fusing image [%d/%d] with index %d",
-                              num_fused_images + 1,
-                              model.images.size(),
-                              image_idx)
-              << std::flush;
+    std::vector<std::string> load_image_names;
+    for (const int image_idx : cell.image_idxs) {
+      if (!loaded_images[image_idx]) {
+        load_image_names.push_back(model.GetImageName(image_idx));
+        loaded_images[image_idx] = true;
+      }
+    }
+    workspace_->Load(load_image_names);
 
-    const int width = depth_map_sizes_.at(image_idx).first;
-    const int height = depth_map_sizes_.at(image_idx).second;
-    const auto& fused_pixel_mask = fused_pixel_masks_.at(image_idx);
+    // The fused pixel masks are reset for every cell, since pixels in the
+    // overlap may be fused into points that belong to the neighboring cell.
+    used_images_ = cell_images;
+    for (const int image_idx : cell.image_idxs) {
+      InitImage(image_idx);
+    }
 
-    for (int row_start = 0; row_start < height; row_start += kRowStride) {
-      thread_pool.AddTask(ProcessImageRows,
-                          row_start,
-                          height,
-                          width,
-                          image_idx,
-                          fused_pixel_mask);
+    bounding_box_ = cell.fusion_box;
+    FuseImages(num_threads);
+
+    // Only write the points inside the cell. Points in the overlap are
+    // written by the neighboring cells. Since a fused point's position
+    // depends on the pixels fused in each cell, a point at a seam may
+    // occasionally be written by both or neither of the cells.
+    std::vector<PlyPoint> cell_fused_points;
+    std::vector<std::vector<int>> cell_fused_points_visibility;
+    for (size_t thread_id = 0; thread_id < task_fused_points_.size();
+         ++thread_id) {
+      auto& task_fused_points = task_fused_points_[thread_id];
+      auto& task_fused_points_visibility =
+          task_fused_points_visibility_[thread_id];
+      for (size_t i = 0; i < task_fused_points.size(); ++i) {
+        const Eigen::Vector3f xyz(task_fused_points[i].x,
+                                  task_fused_points[i].y,
+                                  task_fused_points[i].z);
+        if ((xyz.array() >= cell.box.first.array()).all() &&
+            (xyz.array() < cell.box.second.array()).all()) {
+          cell_fused_points.push_back(task_fused_points[i]);
+          cell_fused_points_visibility.push_back(
+              std::move(task_fused_points_visibility[i]));
+        }
+      }
+      task_fused_points.clear();
+      task_fused_points_visibility.clear();
     }
-    thread_pool.Wait();
 
-    num_fused_images += 1;
-    fused_images_.at(image_idx) = true;
+    writer.Write(cell_fused_points, cell_fused_points_visibility);
+  }
 
-    total_fused_points = 0;
-    for (const auto& task_fused_points : task_fused_points_) {
-      total_fused_points += task_fused_points.size();
+  std::vector<std::string> unload_image_names;
+  for (size_t image_idx = 0; image_idx < loaded_images.size(); ++image_idx) {
+    if (loaded_images[image_idx]) {
+      unload_image_names.push_back(model.GetImageName(image_idx));
+      fused_pixel_masks_[image_idx] = internal::FusedPixelMask();
     }
-    LOG(INFO) << StringPrintf(
-        " in %.3fs (%d points)", timer.ElapsedSeconds(), total_fused_points);
   }
+  workspace_->Unload(unload_image_names);
 
-  fused_points_.reserve(total_fused_points);
-  fused_points_visibility_.reserve(total_fused_points);
-  for (size_t thread_id = 0; thread_id < task_fused_points_.size();
-       ++thread_id) {
-    fused_points_.insert(fused_points_.end(),
-                         task_fused_points_[thread_id].begin(),
-                         task_fused_points_[thread_id].end());
-    task_fused_points_[thread_id].clear();
+  writer.Close();
+  num_fused_points_ = writer.NumPoints();
+}
+
+void StereoFusion::FuseImages(const int num_threads) {
+  const auto& model = workspace_->GetModel();
 
-    fused_points_visibility_.insert(
-        fused_points_visibility_.end(),
-        task_fused_points_visibility_[thread_id].begin(),
-        task_fused_points_visibility_[thread_id].end());
-    task_fused_points_visibility_[thread_id].clear();
+  // The fusion order only depends on the sparse model, so it can be determined
+  // upfront, which allows to process multiple images concurrently.
+  std::vector<int> image_order;
+  std::vector<char> ordered_images(model.images.size(), false);
+  for (int image_idx = 0; image_idx >= 0;
+       image_idx = internal::FindNextImage(
+           overlapping_images_, used_images_, ordered_images, image_idx)) {
+    if (used_images_.at(image_idx)) {
+      image_order.push_back(image_idx);
+      ordered_images.at(image_idx) = true;
+    }
   }
 
-  if (fused_points_.empty()) {
-    LOG(WARNING)
-        << "Could not fuse any points. This is likely caused by "
-           "incorrect settings - filtering must be enabled for the last "
-           "call to patch match stereo.";
+  next_image_idxs_.assign(model.images.size(), -1);
+  for (size_t i = 1; i < image_order.size(); ++i) {
+    next_image_idxs_[image_order[i - 1]] = image_order[i];
   }
 
-  LOG(INFO) << "Number of fused points: " << fused_points_.size();
-  run_timer.PrintMinutes();
+  LOG(INFO) << StringPrintf("Starting fusion with %d threads", num_threads);
+
+  Timer fusion_timer;
+  fusion_timer.Start();
+
+  fused_images_ = std::vector<std::atomic<bool>>(model.images.size());
+  num_fused_images_ = 0;
+  num_fused_points_ = 0;
+
+  // Using tiles with a height of 10 rows to avoid starting parallel processing
+  // in rows that are too close to each other which may lead to duplicated
+  // work, since nearby pixels are likely to get fused into the same point.
+  const int kTileHeight = 10;
+  const int kTileWidth = 256;
+  internal::FusionTileScheduler scheduler(
+      num_threads, kTileHeight, kTileWidth, image_order, depth_map_sizes_);
+
+  if (!image_order.empty()) {
+    PrefetchImages(image_order.front());
+  }
+
+  ThreadPool thread_pool(num_threads);
+  for (int worker_id = 0; worker_id < num_threads; ++worker_id) {
+    thread_pool.AddTask(&StereoFusion::FuseTiles, this, worker_id, &scheduler);
+  }
+  thread_pool.Wait();
+
+  const double fusion_elapsed_seconds = fusion_timer.ElapsedSeconds();
+  LOG(INFO) << StringPrintf(
+      "Fused %d points from %d images in %.3fs (%.1f points/s)",
+      num_fused_points_.load(),
+      num_fused_images_.load(),
+      fusion_elapsed_seconds,
+      num_fused_points_ / std::max(fusion_elapsed_seconds, 1e-6));
 }
 
 void StereoFusion::InitFusedPixelMask(int image_idx,
                                       size_t width,
                                       size_t height) {
   Bitmap mask;
-  Mat<char>& fused_pixel_mask = fused_pixel_masks_.at(image_idx);
+  internal::FusedPixelMask& fused_pixel_mask = fused_pixel_masks_.at(image_idx);
   const std::string mask_image_name =
       workspace_->GetModel().GetImageName(image_idx);
   std::string mask_path =
@@ -347,7 +817,7 @@ void StereoFusion::InitFusedPixelMask(int image_idx,
   if (!ExistsFile(mask_path) && HasFileExtension(mask_image_name, ".png")) {
     mask_path = JoinPaths(options_.mask_path, mask_image_name);
   }
-  fused_pixel_mask = Mat<char>(width, height, 1);
+  fused_pixel_mask = internal::FusedPixelMask(width, height);
   if (!options_.mask_path.empty() && ExistsFile(mask_path) &&
       mask.Read(mask_path, false)) {
     BitmapColor<uint8_t> color;
@@ -357,14 +827,79 @@ void StereoFusion::InitFusedPixelMask(int image_idx,
     for (size_t row = 0; row < height; ++row) {
       for (size_t col = 0; col < width; ++col) {
         mask.GetPixel(col, row, &color);
-        fused_pixel_mask.Set(row, col, color.r == 0 ? 1 : 0);
+        if (color.r == 0) {
+          fused_pixel_mask.Set(row, col);
+        }
       }
     }
-  } else {
-    fused_pixel_mask.Fill(0);
   }
 }
 
+void StereoFusion::FuseTiles(const int worker_id,
+                             internal::FusionTileScheduler* scheduler) {
+  const auto& model = workspace_->GetModel();
+  const auto& worker_fused_points = task_fused_points_.at(worker_id);
+  auto& image_handles = worker_image_handles_.at(worker_id);
+
+  int prev_image_idx = -1;
+  internal::FusionTile tile;
+  while (scheduler->Next(worker_id, &tile)) {
+    if (CheckIfStopped()) {
+      break;
+    }
+
+    if (tile.image_idx != prev_image_idx) {
+      image_handles.clear();
+      prev_image_idx = tile.image_idx;
+    }
+
+    // Once a reference image is opened, its neighbors are loaded on demand, so
+    // start loading the data of the next reference image in the background.
+    if (tile.row_begin == 0 && tile.col_begin == 0) {
+      PrefetchImages(next_image_idxs_.at(tile.image_idx));
+    }
+
+    const size_t num_prev_fused_points = worker_fused_points.size();
+
+    const auto& fused_pixel_mask = fused_pixel_masks_.at(tile.image_idx);
+    for (int row = tile.row_begin; row < tile.row_end; ++row) {
+      for (int col = tile.col_begin; col < tile.col_end; ++col) {
+        if (fused_pixel_mask.IsSet(row, col)) {
+          continue;
+        }
+        Fuse(worker_id, tile.image_idx, row, col);
+      }
+    }
+
+    const size_t num_fused_points =
+        num_fused_points_ += worker_fused_points.size() - num_prev_fused_points;
+
+    if (scheduler->Finish(tile)) {
+      fused_images_.at(tile.image_idx) = true;
+      LOG(INFO) << StringPrintf("Fused image [%d/%d] with index %d (%d points)",
+                                ++num_fused_images_,
+                                model.images.size(),
+                                tile.image_idx,
+                                num_fused_points);
+    }
+  }
+
+  image_handles.clear();
+}
+
+void StereoFusion::PrefetchImages(const int ref_image_idx) {
+  if (ref_image_idx < 0) {
+    return;
+  }
+  std::vector<int> image_idxs = {ref_image_idx};
+  for (const int image_idx : overlapping_images_.at(ref_image_idx)) {
+    if (used_images_.at(image_idx)) {
+      image_idxs.push_back(image_idx);
+    }
+  }
+  workspace_->Prefetch(image_idxs);
+}
+
 void StereoFusion::Fuse(const int thread_id,
                         const int image_idx,
                         const int row,
@@ -399,12 +934,15 @@ void StereoFusion::Fuse(const int thread_id,
 
     // Check if pixel already fused.
     auto& fused_pixel_mask = fused_pixel_masks_.at(image_idx);
-    if (fused_pixel_mask.Get(row, col) > 0) {
+    if (fused_pixel_mask.IsSet(row, col)) {
       continue;
     }
 
-    const auto& depth_map = workspace_->GetDepthMap(image_idx);
-    const float depth = depth_map.Get(row, col);
+    ImageHandles& image_handles = worker_image_handles_[thread_id][image_idx];
+    if (!image_handles.depth_map) {
+      image_handles.depth_map = workspace_->GetDepthMap(image_idx);
+    }
+    const float depth = image_handles.depth_map->Get(row, col);
 
     // Pixels with negative depth are filtered.
     if (depth <= 0.0f) {
@@ -434,7 +972,10 @@ void StereoFusion::Fuse(const int thread_id,
     }
 
     // Determine normal direction in global reference frame.
-    const auto& normal_map = workspace_->GetNormalMap(image_idx);
+    if (!image_handles.normal_map) {
+      image_handles.normal_map = workspace_->GetNormalMap(image_idx);
+    }
+    const NormalMap& normal_map = *image_handles.normal_map;
     const Eigen::Vector3f normal =
         inv_R_.at(image_idx) * Eigen::Vector3f(normal_map.Get(row, col, 0),
                                                normal_map.Get(row, col, 1),
@@ -456,19 +997,22 @@ void StereoFusion::Fuse(const int thread_id,
     // Read the color of the pixel.
     BitmapColor<uint8_t> color;
     const auto& bitmap_scale = bitmap_scales_.at(image_idx);
-    workspace_->GetBitmap(image_idx).InterpolateNearestNeighbor(
+    if (!image_handles.bitmap) {
+      image_handles.bitmap = workspace_->GetBitmap(image_idx);
+    }
+    image_handles.bitmap->InterpolateNearestNeighbor(
         col / bitmap_scale.first, row / bitmap_scale.second, &color);
 
-    // Set the current pixel as visited.
-    fused_pixel_mask.Set(row, col, 1);
+    // Set the current pixel as visited. Another thread may have claimed the
+    // pixel concurrently, in which case it must not be fused again.
+    if (!fused_pixel_mask.TrySet(row, col)) {
+      continue;
+    }
 
     // Pixels out of bounds are filtered
-    if (xyz(0) < options_.bounding_box.first(0) ||
-        xyz(1) < options_.bounding_box.first(1) ||
-        xyz(2) < options_.bounding_box.first(2) ||
-        xyz(0) > options_.bounding_box.second(0) ||
-        xyz(1) > options_.bounding_box.second(1) ||
-        xyz(2) > options_.bounding_box.second(2)) {
+    if (xyz(0) < bounding_box_.first(0) || xyz(1) < bounding_box_.first(1) ||
+        xyz(2) < bounding_box_.first(2) || xyz(0) > bounding_box_.second(0) ||
+        xyz(1) > bounding_box_.second(1) || xyz(2) > bounding_box_.second(2)) {
       continue;
     }
 
@@ -571,5 +1115,22 @@ void WritePointsVisibility(
   }
 }
 
+std::vector<std::vector<int>> ReadPointsVisibility(const std::string& path) {
+  std::fstream file(path, std::ios::in | std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, path);
+
+  const size_t num_points = ReadBinaryLittleEndian<uint64_t>(&file);
+  std::vector<std::vector<int>> points_visibility(num_points);
+  for (auto& visibility : points_visibility) {
+    visibility.resize(ReadBinaryLittleEndian<uint32_t>(&file));
+    for (auto& image_idx : visibility) {
+      image_idx = ReadBinaryLittleEndian<uint32_t>(&file);
+    }
+  }
+  THROW_CHECK(file) << "Truncated file " << path;
+
+  return points_visibility;
+}
+
 }  // namespace mvs
 }  // namespace colmap
@@ -41,7 +41,13 @@
 #include "colmap/util/eigen_alignment.h"
 #include "colmap/util/ply.h"
 
+#include <atomic>
 #include <cfloat>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -95,6 +101,22 @@ struct StereoFusionOptions {
       std::make_pair(Eigen::Vector3f(-FLT_MAX, -FLT_MAX, -FLT_MAX),
                      Eigen::Vector3f(FLT_MAX, FLT_MAX, FLT_MAX));
 
+  // Memory budget in gigabytes for out-of-core tiled fusion. If positive, the
+  // bounding box is recursively split into cells based on the sparse model,
+  // until the input data of the images overlapping each cell fits into the
+  // budget. The cells are then fused one after another, and the fused points
+  // are streamed to disk (see StereoFusion::SetOutputPath). With use_cache,
+  // the cache size is limited to the budget.
+  double tile_memory_budget = -1;
+
+  // Overlap of neighboring cells relative to the extent of their sparse
+  // points. Pixels are fused within the enlarged cell, but only points inside
+  // the original cell are written, such that points at seams are fused with
+  // full support. The position of a fused point can slightly differ between
+  // neighboring cells, so points very close to a seam may rarely be written
+  // twice or not at all.
+  double tile_overlap = 0.1;
+
   // Check the options for validity.
   bool Check() const;
 
@@ -102,6 +124,127 @@ struct StereoFusionOptions {
   void Print() const;
 };
 
+namespace internal {
+
+// Mask of pre-masked and already fused pixels of an image, which can be
+// concurrently updated by multiple threads. Fusion threads claim pixels via
+// TrySet, so that every pixel contributes to at most one fused point.
+class FusedPixelMask {
+ public:
+  FusedPixelMask() = default;
+  FusedPixelMask(size_t width, size_t height);
+
+  inline size_t GetWidth() const { return width_; }
+  inline size_t GetHeight() const { return height_; }
+
+  inline bool IsSet(size_t row, size_t col) const;
+  inline void Set(size_t row, size_t col);
+  // Set the pixel and return whether it was not set before, i.e., whether the
+  // calling thread successfully claimed the pixel.
+  inline bool TrySet(size_t row, size_t col);
+
+ private:
+  size_t width_ = 0;
+  size_t height_ = 0;
+  std::unique_ptr<std::atomic<char>[]> data_;
+};
+
+// Spatial cell of the tiled fusion.
+struct FusionCell {
+  // Fused points inside the half-open box [min, max) belong to this cell.
+  std::pair<Eigen::Vector3f, Eigen::Vector3f> box;
+  // Cell box enlarged by the overlap, inside which pixels are fused.
+  std::pair<Eigen::Vector3f, Eigen::Vector3f> fusion_box;
+  // Images observing sparse points inside the fusion box.
+  std::vector<int> image_idxs;
+  // Accumulated memory of the images.
+  size_t num_bytes = 0;
+};
+
+// Recursively split the bounding box at the median of the sparse points along
+// the longest axis, until the accumulated memory of the images in each cell is
+// below the given maximum or the cell cannot be split further. Images with
+// zero memory are ignored, e.g., if their input does not exist.
+std::vector<FusionCell> PartitionFusionCells(
+    const Model& model,
+    const std::vector<size_t>& image_num_bytes,
+    const std::pair<Eigen::Vector3f, Eigen::Vector3f>& bounding_box,
+    size_t max_num_bytes,
+    double overlap);
+
+// Incrementally writes fused points to a binary PLY file and their visibility
+// to <path>.vis in the format of WritePointsVisibility. The number of points in
+// the headers is only known and written when the writer is closed.
+class FusedPointsWriter {
+ public:
+  explicit FusedPointsWriter(const std::string& path);
+  ~FusedPointsWriter();
+
+  void Write(const std::vector<PlyPoint>& points,
+             const std::vector<std::vector<int>>& points_visibility);
+
+  void Close();
+
+  size_t NumPoints() const;
+
+ private:
+  PlyPointsWriter ply_writer_;
+  std::fstream vis_file_;
+};
+
+// Rectangular region of pixels [row_begin, row_end) x [col_begin, col_end)
+// of a reference image, which is the unit of work in the fusion.
+struct FusionTile {
+  int image_idx = -1;
+  int row_begin = 0;
+  int row_end = 0;
+  int col_begin = 0;
+  int col_end = 0;
+};
+
+// Work-stealing scheduler of fusion tiles. Reference images are opened in the
+// given order by the first worker that runs out of work, which then owns the
+// tiles of this image in a local queue. Idle workers steal tiles from the back
+// of other workers' queues before opening a new image, such that multiple
+// images are only in flight at the tail end of an image and no worker waits
+// for a whole image to be finished.
+class FusionTileScheduler {
+ public:
+  FusionTileScheduler(int num_workers,
+                      int tile_height,
+                      int tile_width,
+                      std::vector<int> image_order,
+                      std::vector<std::pair<int, int>> image_sizes);
+
+  // Get the next tile for the given worker. Returns false if all tiles were
+  // handed out.
+  bool Next(int worker_id, FusionTile* tile);
+
+  // Mark the tile as processed. Returns true if this was the last remaining
+  // tile of its image.
+  bool Finish(const FusionTile& tile);
+
+  int NumWorkers() const;
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<FusionTile> tiles;
+  };
+
+  bool OpenNextImage(int worker_id);
+
+  const int tile_height_;
+  const int tile_width_;
+  const std::vector<int> image_order_;
+  const std::vector<std::pair<int, int>> image_sizes_;
+  std::atomic<size_t> next_image_pos_;
+  std::vector<std::atomic<int>> num_remaining_tiles_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+};
+
+}  // namespace internal
+
 class StereoFusion : public BaseController {
  public:
   StereoFusion(const StereoFusionOptions& options,
@@ -113,10 +256,20 @@ class StereoFusion : public BaseController {
   const std::vector<PlyPoint>& GetFusedPoints() const;
   const std::vector<std::vector<int>>& GetFusedPointsVisibility() const;
 
+  // Additionally write the fused points to a binary PLY file and their
+  // visibility to <path>.vis. For tiled fusion, the points are streamed to
+  // these files cell by cell and not returned by GetFusedPoints.
+  void SetOutputPath(const std::string& path);
+
   void Run();
 
  private:
+  void InitImage(int image_idx);
   void InitFusedPixelMask(int image_idx, size_t width, size_t height);
+  void RunTiled(const std::vector<char>& valid_images, int num_threads);
+  void FuseImages(int num_threads);
+  void FuseTiles(int worker_id, internal::FusionTileScheduler* scheduler);
+  void PrefetchImages(int ref_image_idx);
   void Fuse(int thread_id, int image_idx, int row, int col);
 
   const StereoFusionOptions options_;
@@ -126,20 +279,38 @@ class StereoFusion : public BaseController {
   const std::string input_type_;
   const float max_squared_reproj_error_;
   const float min_cos_normal_error_;
+  std::string output_path_;
+  std::pair<Eigen::Vector3f, Eigen::Vector3f> bounding_box_;
 
   std::unique_ptr<Workspace> workspace_;
   std::vector<char> used_images_;
-  std::vector<char> fused_images_;
+  // Images whose pixels have all been processed as reference pixels.
+  std::vector<std::atomic<bool>> fused_images_;
   std::vector<std::vector<int>> overlapping_images_;
+  // The reference image that is fused after the given image, or -1.
+  std::vector<int> next_image_idxs_;
   // Contains image masks of pre-masked and already fused pixels.
   // Initialized from image masks if provided in StereoFusionOptions.
-  std::vector<Mat<char>> fused_pixel_masks_;
+  std::vector<internal::FusedPixelMask> fused_pixel_masks_;
   std::vector<std::pair<int, int>> depth_map_sizes_;
   std::vector<std::pair<float, float>> bitmap_scales_;
   std::vector<Eigen::Matrix<float, 3, 4, Eigen::RowMajor>> P_;
   std::vector<Eigen::Matrix<float, 3, 4, Eigen::RowMajor>> inv_P_;
   std::vector<Eigen::Matrix<float, 3, 3, Eigen::RowMajor>> inv_R_;
 
+  // Handles to the data of an image, which are resolved on first access and
+  // then kept by a worker, such that the workspace is not queried per pixel.
+  struct ImageHandles {
+    std::shared_ptr<const Bitmap> bitmap;
+    std::shared_ptr<const DepthMap> depth_map;
+    std::shared_ptr<const NormalMap> normal_map;
+  };
+
+  // The image handles of each worker. A worker releases its handles when it
+  // moves on to the tiles of another reference image, so that the handles do
+  // not keep images alive that were evicted from the workspace cache.
+  std::vector<std::unordered_map<int, ImageHandles>> worker_image_handles_;
+
   struct FusionData {
     int image_idx = kInvalidImageId;
     int row = 0;
@@ -161,6 +332,9 @@ class StereoFusion : public BaseController {
 
   std::vector<std::vector<PlyPoint>> task_fused_points_;
   std::vector<std::vector<std::vector<int>>> task_fused_points_visibility_;
+
+  std::atomic<size_t> num_fused_images_;
+  std::atomic<size_t> num_fused_points_;
 };
 
 // Write the visiblity information into a binary file of the following format:
@@ -179,5 +353,29 @@ void WritePointsVisibility(
     const std::string& path,
     const std::vector<std::vector<int>>& points_visibility);
 
+// Read the visibility information written by WritePointsVisibility.
+std::vector<std::vector<int>> ReadPointsVisibility(const std::string& path);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+namespace internal {
+
+bool FusedPixelMask::IsSet(const size_t row, const size_t col) const {
+  return data_[row * width_ + col].load(std::memory_order_relaxed) != 0;
+}
+
+void FusedPixelMask::Set(const size_t row, const size_t col) {
+  data_[row * width_ + col].store(1, std::memory_order_relaxed);
+}
+
+bool FusedPixelMask::TrySet(const size_t row, const size_t col) {
+  return data_[row * width_ + col].exchange(1, std::memory_order_relaxed) ==
+         0;
+}
+
+}  // namespace internal
+
 }  // namespace mvs
 }  // namespace colmap
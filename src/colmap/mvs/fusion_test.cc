@@ -0,0 +1,318 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/fusion.h"
+
+#include "colmap/util/endian.h"
+#include "colmap/util/file.h"
+#include "colmap/util/testing.h"
+#include "colmap/util/threading.h"
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace mvs {
+namespace internal {
+namespace {
+
+TEST(FusedPixelMask, SetAndTrySet) {
+  FusedPixelMask mask(3, 2);
+  EXPECT_EQ(mask.GetWidth(), 3);
+  EXPECT_EQ(mask.GetHeight(), 2);
+  for (size_t row = 0; row < 2; ++row) {
+    for (size_t col = 0; col < 3; ++col) {
+      EXPECT_FALSE(mask.IsSet(row, col));
+    }
+  }
+  mask.Set(1, 2);
+  EXPECT_TRUE(mask.IsSet(1, 2));
+  EXPECT_FALSE(mask.TrySet(1, 2));
+  EXPECT_TRUE(mask.TrySet(0, 1));
+  EXPECT_TRUE(mask.IsSet(0, 1));
+  EXPECT_FALSE(mask.TrySet(0, 1));
+  EXPECT_FALSE(mask.IsSet(0, 0));
+}
+
+TEST(FusedPixelMask, ConcurrentTrySet) {
+  const int kNumThreads = 4;
+  FusedPixelMask mask(64, 32);
+  std::vector<int> num_claimed(kNumThreads, 0);
+  ThreadPool thread_pool(kNumThreads);
+  for (int thread_idx = 0; thread_idx < kNumThreads; ++thread_idx) {
+    thread_pool.AddTask([&mask, &num_claimed, thread_idx]() {
+      for (size_t row = 0; row < mask.GetHeight(); ++row) {
+        for (size_t col = 0; col < mask.GetWidth(); ++col) {
+          if (mask.TrySet(row, col)) {
+            ++num_claimed[thread_idx];
+          }
+        }
+      }
+    });
+  }
+  thread_pool.Wait();
+
+  int total_num_claimed = 0;
+  for (const int num : num_claimed) {
+    total_num_claimed += num;
+  }
+  EXPECT_EQ(total_num_claimed, 64 * 32);
+}
+
+void CheckTileCoverage(const int num_workers, const int num_threads) {
+  const std::vector<std::pair<int, int>> image_sizes = {
+      {25, 13}, {0, 0}, {7, 31}, {40, 9}};
+  const std::vector<int> image_order = {2, 0, 3};
+  FusionTileScheduler scheduler(num_workers,
+                                /*tile_height=*/4,
+                                /*tile_width=*/8,
+                                image_order,
+                                image_sizes);
+  EXPECT_EQ(scheduler.NumWorkers(), num_workers);
+
+  std::vector<std::vector<int>> num_visits(image_sizes.size());
+  std::vector<int> num_completions(image_sizes.size(), 0);
+  for (size_t image_idx = 0; image_idx < image_sizes.size(); ++image_idx) {
+    num_visits[image_idx].resize(
+        image_sizes[image_idx].first * image_sizes[image_idx].second, 0);
+  }
+
+  std::mutex mutex;
+  ThreadPool thread_pool(num_threads);
+  for (int worker_id = 0; worker_id < num_workers; ++worker_id) {
+    thread_pool.AddTask([&, worker_id]() {
+      FusionTile tile;
+      while (scheduler.Next(worker_id, &tile)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const int width = image_sizes.at(tile.image_idx).first;
+        EXPECT_LT(tile.row_begin, tile.row_end);
+        EXPECT_LT(tile.col_begin, tile.col_end);
+        EXPECT_LE(tile.row_end - tile.row_begin, 4);
+        EXPECT_LE(tile.col_end - tile.col_begin, 8);
+        for (int row = tile.row_begin; row < tile.row_end; ++row) {
+          for (int col = tile.col_begin; col < tile.col_end; ++col) {
+            ++num_visits[tile.image_idx][row * width + col];
+          }
+        }
+        if (scheduler.Finish(tile)) {
+          ++num_completions[tile.image_idx];
+        }
+      }
+    });
+  }
+  thread_pool.Wait();
+
+  for (const int image_idx : image_order) {
+    EXPECT_EQ(num_completions[image_idx], 1);
+    for (const int num : num_visits[image_idx]) {
+      EXPECT_EQ(num, 1);
+    }
+  }
+  EXPECT_EQ(num_completions[1], 0);
+}
+
+TEST(FusionTileScheduler, SingleWorker) { CheckTileCoverage(1, 1); }
+
+TEST(FusionTileScheduler, MultipleWorkers) { CheckTileCoverage(4, 4); }
+
+TEST(FusionTileScheduler, WorkStealing) {
+  // A worker that opens an image owns all of its tiles, but the remaining
+  // workers steal from the back of its queue.
+  const std::vector<std::pair<int, int>> image_sizes = {{4, 8}};
+  FusionTileScheduler scheduler(
+      2, /*tile_height=*/2, /*tile_width=*/4, {0}, image_sizes);
+
+  FusionTile tile;
+  ASSERT_TRUE(scheduler.Next(0, &tile));
+  EXPECT_EQ(tile.image_idx, 0);
+  EXPECT_EQ(tile.row_begin, 0);
+  EXPECT_EQ(tile.row_end, 2);
+  EXPECT_FALSE(scheduler.Finish(tile));
+
+  ASSERT_TRUE(scheduler.Next(1, &tile));
+  EXPECT_EQ(tile.row_begin, 6);
+  EXPECT_EQ(tile.row_end, 8);
+  EXPECT_FALSE(scheduler.Finish(tile));
+
+  ASSERT_TRUE(scheduler.Next(0, &tile));
+  EXPECT_EQ(tile.row_begin, 2);
+  EXPECT_FALSE(scheduler.Finish(tile));
+
+  ASSERT_TRUE(scheduler.Next(1, &tile));
+  EXPECT_EQ(tile.row_begin, 4);
+  EXPECT_TRUE(scheduler.Finish(tile));
+
+  EXPECT_FALSE(scheduler.Next(0, &tile));
+  EXPECT_FALSE(scheduler.Next(1, &tile));
+}
+
+Model CreateTwoClusterModel() {
+  Model model;
+  model.images.resize(5);
+  // First cluster around x=0 observed by images 0 and 1, second cluster around
+  // x=10 observed by images 2 and 3, and image 4 without any observations.
+  for (int i = 0; i < 10; ++i) {
+    Model::Point point;
+    point.x = 0.1f * i;
+    point.y = 0.05f * i;
+    point.z = 1;
+    point.track = {0, 1};
+    model.points.push_back(point);
+    point.x += 10;
+    point.track = {2, 3};
+    model.points.push_back(point);
+  }
+  return model;
+}
+
+TEST(PartitionFusionCells, SingleCell) {
+  const Model model = CreateTwoClusterModel();
+  const std::vector<size_t> image_num_bytes = {100, 100, 100, 0, 100};
+  const std::pair<Eigen::Vector3f, Eigen::Vector3f> bounding_box(
+      Eigen::Vector3f::Constant(-FLT_MAX), Eigen::Vector3f::Constant(FLT_MAX));
+  const std::vector<FusionCell> cells = PartitionFusionCells(
+      model, image_num_bytes, bounding_box, /*max_num_bytes=*/1000, 0.1);
+  ASSERT_EQ(cells.size(), 1);
+  EXPECT_EQ(cells[0].image_idxs, std::vector<int>({0, 1, 2}));
+  EXPECT_EQ(cells[0].num_bytes, 300);
+  EXPECT_EQ(cells[0].box.first, bounding_box.first);
+  EXPECT_EQ(cells[0].fusion_box.first, bounding_box.first);
+  EXPECT_EQ(cells[0].fusion_box.second, bounding_box.second);
+  // The maximum of the bounding box is inclusive.
+  EXPECT_TRUE((cells[0].box.second.array() > FLT_MAX).all());
+}
+
+TEST(PartitionFusionCells, SplitClusters) {
+  const Model model = CreateTwoClusterModel();
+  const std::vector<size_t> image_num_bytes(5, 100);
+  const std::pair<Eigen::Vector3f, Eigen::Vector3f> bounding_box(
+      Eigen::Vector3f(-5, -5, -5), Eigen::Vector3f(15, 5, 5));
+  const std::vector<FusionCell> cells = PartitionFusionCells(
+      model, image_num_bytes, bounding_box, /*max_num_bytes=*/200, 0.1);
+  ASSERT_EQ(cells.size(), 2);
+  EXPECT_EQ(cells[0].image_idxs, std::vector<int>({0, 1}));
+  EXPECT_EQ(cells[0].num_bytes, 200);
+  EXPECT_EQ(cells[1].image_idxs, std::vector<int>({2, 3}));
+  EXPECT_EQ(cells[1].num_bytes, 200);
+
+  // The cells partition the bounding box along the x-axis.
+  EXPECT_EQ(cells[0].box.first, bounding_box.first);
+  EXPECT_EQ(cells[0].box.second(0), cells[1].box.first(0));
+  EXPECT_GT(cells[1].box.first(0), 0.9f);
+  EXPECT_LT(cells[1].box.first(0), 10.0f);
+  EXPECT_EQ(cells[1].box.second(1), cells[0].box.second(1));
+
+  // The fusion boxes overlap and are clamped to the bounding box.
+  for (const auto& cell : cells) {
+    EXPECT_TRUE(
+        (cell.fusion_box.first.array() <= cell.box.first.array()).all());
+    EXPECT_TRUE(
+        (cell.fusion_box.first.array() >= bounding_box.first.array()).all());
+    EXPECT_TRUE(
+        (cell.fusion_box.second.array() <= bounding_box.second.array()).all());
+  }
+  EXPECT_LT(cells[1].fusion_box.first(0), cells[0].box.second(0));
+  EXPECT_GT(cells[0].fusion_box.second(0), cells[1].box.first(0));
+}
+
+TEST(PartitionFusionCells, ExceedBudget) {
+  const Model model = CreateTwoClusterModel();
+  const std::vector<size_t> image_num_bytes(5, 100);
+  const std::pair<Eigen::Vector3f, Eigen::Vector3f> bounding_box(
+      Eigen::Vector3f::Constant(-FLT_MAX), Eigen::Vector3f::Constant(FLT_MAX));
+  const std::vector<FusionCell> cells = PartitionFusionCells(
+      model, image_num_bytes, bounding_box, /*max_num_bytes=*/50, 0);
+  // Each cell is observed by two images, which exceeds the budget, but the
+  // cells are split until they only contain a single point.
+  EXPECT_EQ(cells.size(), model.points.size());
+  for (const auto& cell : cells) {
+    EXPECT_EQ(cell.image_idxs.size(), 2);
+  }
+}
+
+TEST(FusedPointsWriter, Nominal) {
+  const std::string test_dir = CreateTestDir();
+  const std::string path = JoinPaths(test_dir, "fused.ply");
+
+  std::vector<PlyPoint> points(3);
+  std::vector<std::vector<int>> points_visibility = {{0, 1}, {2}, {1, 3, 4}};
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i].x = i;
+    points[i].y = 2 * i;
+    points[i].z = 3 * i;
+    points[i].nz = 1;
+    points[i].r = i;
+    points[i].g = 10 * i;
+    points[i].b = 20 * i;
+  }
+
+  FusedPointsWriter writer(path);
+  writer.Write({points[0], points[1]},
+               {points_visibility[0], points_visibility[1]});
+  writer.Write({}, {});
+  writer.Write({points[2]}, {points_visibility[2]});
+  EXPECT_EQ(writer.NumPoints(), 3);
+  writer.Close();
+
+  const std::vector<PlyPoint> read_points = ReadPly(path);
+  ASSERT_EQ(read_points.size(), points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(read_points[i].x, points[i].x);
+    EXPECT_EQ(read_points[i].y, points[i].y);
+    EXPECT_EQ(read_points[i].z, points[i].z);
+    EXPECT_EQ(read_points[i].nz, points[i].nz);
+    EXPECT_EQ(read_points[i].r, points[i].r);
+    EXPECT_EQ(read_points[i].g, points[i].g);
+    EXPECT_EQ(read_points[i].b, points[i].b);
+  }
+
+  std::ifstream vis_file(path + ".vis", std::ios::binary);
+  ASSERT_TRUE(vis_file.is_open());
+  EXPECT_EQ(ReadBinaryLittleEndian<uint64_t>(&vis_file), 3);
+  for (const auto& visibility : points_visibility) {
+    ASSERT_EQ(ReadBinaryLittleEndian<uint32_t>(&vis_file), visibility.size());
+    for (const int image_idx : visibility) {
+      EXPECT_EQ(ReadBinaryLittleEndian<uint32_t>(&vis_file), image_idx);
+    }
+  }
+}
+
+TEST(PointsVisibility, ReadWrite) {
+  const std::string path = JoinPaths(CreateTestDir(), "fused.ply.vis");
+  const std::vector<std::vector<int>> points_visibility = {
+      {0, 1}, {}, {1, 3, 4}};
+  WritePointsVisibility(path, points_visibility);
+  EXPECT_EQ(ReadPointsVisibility(path), points_visibility);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace mvs
+}  // namespace colmap
@@ -29,6 +29,7 @@
 
 #include "colmap/mvs/mat.h"
 
+#include "colmap/mvs/mat_file.h"
 #include "colmap/util/endian.h"
 #include "colmap/util/file.h"
 
@@ -41,9 +42,15 @@ namespace mvs {
 
 template <>
 void Mat<float>::Read(const std::string& path) {
+  if (IsMatFile(path)) {
+    *this = MappedMatFile(path).Read();
+    return;
+  }
+
   std::ifstream file(path, std::ios::binary);
   THROW_CHECK_FILE_OPEN(file, path);
 
+  mapped_data_.reset();
   char unused_char;
   file >> width_ >> unused_char >> height_ >> unused_char >> depth_ >>
       unused_char;
@@ -56,12 +63,32 @@ void Mat<float>::Read(const std::string& path) {
   file.close();
 }
 
+template <>
+void Mat<float>::ReadMapped(const std::string& path) {
+  if (IsMatFile(path)) {
+    auto mapped_mat_file = std::make_shared<MappedMatFile>(path);
+    const float* data = mapped_mat_file->GetData();
+    if (data != nullptr) {
+      width_ = mapped_mat_file->GetWidth();
+      height_ = mapped_mat_file->GetHeight();
+      depth_ = mapped_mat_file->GetDepth();
+      data_.clear();
+      data_.shrink_to_fit();
+      // Shares the ownership of the mapped file.
+      mapped_data_ = std::shared_ptr<const float>(mapped_mat_file, data);
+      return;
+    }
+  }
+  Read(path);
+}
+
 template <>
 void Mat<float>::Write(const std::string& path) const {
   std::ofstream file(path, std::ios::binary);
   THROW_CHECK_FILE_OPEN(file, path);
   file << width_ << "&" << height_ << "&" << depth_ << "&";
-  WriteBinaryLittleEndian<float>(&file, {data_.data(), data_.size()});
+  WriteBinaryLittleEndian<float>(&file,
+                                 {GetPtr(), width_ * height_ * depth_});
   file.close();
 }
 
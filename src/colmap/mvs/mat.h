@@ -30,6 +30,7 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -53,21 +54,34 @@ class Mat {
   T* GetPtr();
   const T* GetPtr() const;
 
-  const std::vector<T>& GetData() const;
+  std::vector<T> GetData() const;
 
   void Set(size_t row, size_t col, T value);
   void Set(size_t row, size_t col, size_t slice, T value);
 
   void Fill(T value);
 
+  // Read the matrix in the legacy or the binary format of WriteMatFile.
   void Read(const std::string& path);
+  // Same as Read, but uncompressed single precision matrices in the binary
+  // format are not copied into memory and are directly accessed through a
+  // read-only memory mapping of the file instead. The data is copied on the
+  // first modification of the matrix.
+  void ReadMapped(const std::string& path);
+  // Write the matrix in the legacy format.
   void Write(const std::string& path) const;
 
  protected:
+  // Copy memory-mapped data into data_, such that it can be modified.
+  void MakeOwned();
+
   size_t width_ = 0;
   size_t height_ = 0;
   size_t depth_ = 0;
   std::vector<T> data_;
+  // Memory-mapped data, which is used instead of data_ if set. Copies of the
+  // matrix share the mapping, which is unmapped with the last copy.
+  std::shared_ptr<const T> mapped_data_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -100,12 +114,16 @@ size_t Mat<T>::GetDepth() const {
 
 template <typename T>
 size_t Mat<T>::GetNumBytes() const {
-  return data_.size() * sizeof(T);
+  return width_ * height_ * depth_ * sizeof(T);
 }
 
 template <typename T>
 T Mat<T>::Get(const size_t row, const size_t col, const size_t slice) const {
-  return data_.at(slice * width_ * height_ + row * width_ + col);
+  const size_t idx = slice * width_ * height_ + row * width_ + col;
+  if (mapped_data_) {
+    return mapped_data_.get()[idx];
+  }
+  return data_.at(idx);
 }
 
 template <typename T>
@@ -117,16 +135,24 @@ void Mat<T>::GetSlice(const size_t row, const size_t col, T* values) const {
 
 template <typename T>
 T* Mat<T>::GetPtr() {
+  MakeOwned();
   return data_.data();
 }
 
 template <typename T>
 const T* Mat<T>::GetPtr() const {
+  if (mapped_data_) {
+    return mapped_data_.get();
+  }
   return data_.data();
 }
 
 template <typename T>
-const std::vector<T>& Mat<T>::GetData() const {
+std::vector<T> Mat<T>::GetData() const {
+  if (mapped_data_) {
+    return std::vector<T>(mapped_data_.get(),
+                          mapped_data_.get() + width_ * height_ * depth_);
+  }
   return data_;
 }
 
@@ -140,12 +166,23 @@ void Mat<T>::Set(const size_t row,
                  const size_t col,
                  const size_t slice,
                  const T value) {
+  MakeOwned();
   data_.at(slice * width_ * height_ + row * width_ + col) = value;
 }
 
 template <typename T>
 void Mat<T>::Fill(const T value) {
-  std::fill(data_.begin(), data_.end(), value);
+  mapped_data_.reset();
+  data_.assign(width_ * height_ * depth_, value);
+}
+
+template <typename T>
+void Mat<T>::MakeOwned() {
+  if (mapped_data_) {
+    data_.assign(mapped_data_.get(),
+                 mapped_data_.get() + width_ * height_ * depth_);
+    mapped_data_.reset();
+  }
 }
 
 }  // namespace mvs
@@ -0,0 +1,418 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/mat_file.h"
+
+#include "colmap/util/endian.h"
+#include "colmap/util/logging.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+constexpr char kMatFileMagic[8] = {'C', 'O', 'L', 'M', 'A', 'P', 'M', 'T'};
+constexpr uint32_t kMatFileVersion = 1;
+constexpr uint64_t kMatFileHeaderSize = 64;
+constexpr int kMaxRunLength = 128;
+
+size_t GetElementSize(const MatFileDataType data_type) {
+  switch (data_type) {
+    case MatFileDataType::FLOAT32:
+      return sizeof(float);
+    case MatFileDataType::FLOAT16:
+      return sizeof(uint16_t);
+    default:
+      LOG(FATAL_THROW) << "Invalid data type: "
+                       << static_cast<uint32_t>(data_type);
+  }
+  return 0;
+}
+
+template <typename T>
+T ReadValue(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return LittleEndianToNative(value);
+}
+
+template <typename T>
+void AppendValue(const T value, std::vector<char>* data) {
+  const T little_endian_value = NativeToLittleEndian(value);
+  const char* bytes = reinterpret_cast<const char*>(&little_endian_value);
+  data->insert(data->end(), bytes, bytes + sizeof(T));
+}
+
+void AppendElement(const float value,
+                   const MatFileDataType data_type,
+                   std::vector<char>* data) {
+  if (data_type == MatFileDataType::FLOAT16) {
+    const Eigen::half half_value(value);
+    uint16_t bits;
+    std::memcpy(&bits, &half_value, sizeof(bits));
+    AppendValue<uint16_t>(bits, data);
+  } else {
+    AppendValue<float>(value, data);
+  }
+}
+
+float ReadElement(const char* data, const MatFileDataType data_type) {
+  if (data_type == MatFileDataType::FLOAT16) {
+    const uint16_t bits = ReadValue<uint16_t>(data);
+    Eigen::half half_value;
+    std::memcpy(&half_value, &bits, sizeof(bits));
+    return static_cast<float>(half_value);
+  } else {
+    return ReadValue<float>(data);
+  }
+}
+
+// Run-length encode the elements of the given size.
+void EncodeRuns(const std::vector<char>& elements,
+                const size_t element_size,
+                std::vector<char>* data) {
+  const size_t num_elements = elements.size() / element_size;
+  auto IsEqual = [&](const size_t idx1, const size_t idx2) {
+    return std::memcmp(&elements[idx1 * element_size],
+                       &elements[idx2 * element_size],
+                       element_size) == 0;
+  };
+  auto AppendElements = [&](const size_t begin, const size_t end) {
+    data->insert(data->end(),
+                 elements.begin() + begin * element_size,
+                 elements.begin() + end * element_size);
+  };
+
+  size_t idx = 0;
+  while (idx < num_elements) {
+    size_t run_length = 1;
+    while (idx + run_length < num_elements && run_length < kMaxRunLength &&
+           IsEqual(idx, idx + run_length)) {
+      ++run_length;
+    }
+
+    if (run_length > 1) {
+      data->push_back(static_cast<char>(1 - static_cast<int>(run_length)));
+      AppendElements(idx, idx + 1);
+      idx += run_length;
+      continue;
+    }
+
+    // Extend the literal run until the next repeated run starts.
+    size_t end = idx + 1;
+    while (end < num_elements && end - idx < kMaxRunLength &&
+           !(end + 1 < num_elements && IsEqual(end, end + 1))) {
+      ++end;
+    }
+    data->push_back(static_cast<char>(end - idx - 1));
+    AppendElements(idx, end);
+    idx = end;
+  }
+}
+
+// Decode run-length encoded elements and call the given function for each of
+// the num_elements decoded elements.
+template <typename Func>
+void DecodeRuns(const char* begin,
+                const char* end,
+                const size_t element_size,
+                const size_t num_elements,
+                Func&& func) {
+  size_t idx = 0;
+  const char* data = begin;
+  while (idx < num_elements) {
+    THROW_CHECK_LT(data, end) << "Truncated tile";
+    const int control = static_cast<int8_t>(*data);
+    ++data;
+    if (control >= 0) {
+      const size_t num_literals = control + 1;
+      THROW_CHECK_LE(idx + num_literals, num_elements);
+      THROW_CHECK_LE(data + num_literals * element_size, end);
+      for (size_t i = 0; i < num_literals; ++i) {
+        func(idx++, data);
+        data += element_size;
+      }
+    } else {
+      const size_t run_length = 1 - control;
+      THROW_CHECK_LE(idx + run_length, num_elements);
+      THROW_CHECK_LE(data + element_size, end);
+      for (size_t i = 0; i < run_length; ++i) {
+        func(idx++, data);
+      }
+      data += element_size;
+    }
+  }
+}
+
+}  // namespace
+
+bool MatFileOptions::Check() const {
+  CHECK_OPTION_GT(tile_size, 0);
+  return true;
+}
+
+bool IsMatFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, path);
+  char magic[sizeof(kMatFileMagic)];
+  file.read(magic, sizeof(magic));
+  return file.gcount() == sizeof(magic) &&
+         std::memcmp(magic, kMatFileMagic, sizeof(magic)) == 0;
+}
+
+void WriteMatFile(const std::string& path,
+                  const Mat<float>& mat,
+                  const MatFileOptions& options) {
+  THROW_CHECK(options.Check());
+  // Empty matrices are rejected, as they cannot be mapped when reading.
+  THROW_CHECK_GT(mat.GetWidth(), 0) << path;
+  THROW_CHECK_GT(mat.GetHeight(), 0) << path;
+  THROW_CHECK_GT(mat.GetDepth(), 0) << path;
+
+  MatFileHeader header;
+  header.version = kMatFileVersion;
+  header.data_type = options.half_precision ? MatFileDataType::FLOAT16
+                                            : MatFileDataType::FLOAT32;
+  header.compression =
+      options.compress ? MatFileCompression::RLE : MatFileCompression::NONE;
+  header.tile_size = options.compress ? options.tile_size : 0;
+  header.width = mat.GetWidth();
+  header.height = mat.GetHeight();
+  header.depth = mat.GetDepth();
+  header.data_offset = kMatFileHeaderSize;
+
+  std::vector<char> data;
+  data.reserve(kMatFileHeaderSize);
+  data.insert(data.end(), kMatFileMagic, kMatFileMagic + sizeof(kMatFileMagic));
+  AppendValue<uint32_t>(header.version, &data);
+  AppendValue<uint32_t>(static_cast<uint32_t>(header.data_type), &data);
+  AppendValue<uint32_t>(static_cast<uint32_t>(header.compression), &data);
+  AppendValue<uint32_t>(header.tile_size, &data);
+  AppendValue<uint64_t>(header.width, &data);
+  AppendValue<uint64_t>(header.height, &data);
+  AppendValue<uint64_t>(header.depth, &data);
+  AppendValue<uint64_t>(header.data_offset, &data);
+  data.resize(kMatFileHeaderSize, 0);
+
+  const float* values = mat.GetPtr();
+  const size_t element_size = GetElementSize(header.data_type);
+
+  std::ofstream file(path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, path);
+
+  if (header.compression == MatFileCompression::NONE) {
+    const size_t num_values = header.width * header.height * header.depth;
+    data.reserve(kMatFileHeaderSize + num_values * element_size);
+    for (size_t i = 0; i < num_values; ++i) {
+      AppendElement(values[i], header.data_type, &data);
+    }
+    file.write(data.data(), data.size());
+    return;
+  }
+
+  const size_t tile_size = header.tile_size;
+  const size_t num_tile_rows = (header.height + tile_size - 1) / tile_size;
+  const size_t num_tile_cols = (header.width + tile_size - 1) / tile_size;
+  const size_t num_tiles = header.depth * num_tile_rows * num_tile_cols;
+
+  std::vector<uint64_t> tile_offsets;
+  tile_offsets.reserve(num_tiles + 1);
+  std::vector<char> tiles_data;
+  std::vector<char> tile_elements;
+  const uint64_t tiles_offset =
+      header.data_offset + (num_tiles + 1) * sizeof(uint64_t);
+  for (size_t slice = 0; slice < header.depth; ++slice) {
+    for (size_t tile_row = 0; tile_row < num_tile_rows; ++tile_row) {
+      for (size_t tile_col = 0; tile_col < num_tile_cols; ++tile_col) {
+        tile_offsets.push_back(tiles_offset + tiles_data.size());
+        const size_t row_begin = tile_row * tile_size;
+        const size_t row_end =
+            std::min<size_t>(header.height, row_begin + tile_size);
+        const size_t col_begin = tile_col * tile_size;
+        const size_t col_end =
+            std::min<size_t>(header.width, col_begin + tile_size);
+        tile_elements.clear();
+        for (size_t row = row_begin; row < row_end; ++row) {
+          for (size_t col = col_begin; col < col_end; ++col) {
+            AppendElement(
+                values[(slice * header.height + row) * header.width + col],
+                header.data_type,
+                &tile_elements);
+          }
+        }
+        EncodeRuns(tile_elements, element_size, &tiles_data);
+      }
+    }
+  }
+  tile_offsets.push_back(tiles_offset + tiles_data.size());
+
+  for (const uint64_t tile_offset : tile_offsets) {
+    AppendValue<uint64_t>(tile_offset, &data);
+  }
+  file.write(data.data(), data.size());
+  file.write(tiles_data.data(), tiles_data.size());
+}
+
+MappedMatFile::MappedMatFile(const std::string& path) : file_(path) {
+  const char* data = file_.Data();
+  THROW_CHECK_GE(file_.NumBytes(), kMatFileHeaderSize)
+      << "Invalid file " << path;
+  THROW_CHECK_EQ(std::memcmp(data, kMatFileMagic, sizeof(kMatFileMagic)), 0)
+      << "Invalid file " << path;
+  data += sizeof(kMatFileMagic);
+
+  header_.version = ReadValue<uint32_t>(data);
+  THROW_CHECK_LE(header_.version, kMatFileVersion)
+      << "Unsupported version of " << path;
+  header_.data_type =
+      static_cast<MatFileDataType>(ReadValue<uint32_t>(data + 4));
+  header_.compression =
+      static_cast<MatFileCompression>(ReadValue<uint32_t>(data + 8));
+  header_.tile_size = ReadValue<uint32_t>(data + 12);
+  header_.width = ReadValue<uint64_t>(data + 16);
+  header_.height = ReadValue<uint64_t>(data + 24);
+  header_.depth = ReadValue<uint64_t>(data + 32);
+  header_.data_offset = ReadValue<uint64_t>(data + 40);
+
+  THROW_CHECK_GT(header_.width, 0) << path;
+  THROW_CHECK_GT(header_.height, 0) << path;
+  THROW_CHECK_GT(header_.depth, 0) << path;
+  THROW_CHECK_GE(header_.data_offset, kMatFileHeaderSize) << path;
+
+  const size_t element_size = GetElementSize(header_.data_type);
+  const size_t num_values = header_.width * header_.height * header_.depth;
+  switch (header_.compression) {
+    case MatFileCompression::NONE:
+      THROW_CHECK_GE(file_.NumBytes(),
+                     header_.data_offset + num_values * element_size)
+          << "Truncated file " << path;
+      break;
+    case MatFileCompression::RLE:
+      THROW_CHECK_GT(header_.tile_size, 0) << path;
+      break;
+    default:
+      LOG(FATAL_THROW) << "Invalid compression of " << path;
+  }
+}
+
+const float* MappedMatFile::GetData() const {
+  if (header_.data_type != MatFileDataType::FLOAT32 ||
+      header_.compression != MatFileCompression::NONE || !IsLittleEndian()) {
+    return nullptr;
+  }
+  return reinterpret_cast<const float*>(file_.Data() + header_.data_offset);
+}
+
+float MappedMatFile::Get(const size_t row,
+                         const size_t col,
+                         const size_t slice) const {
+  THROW_CHECK(header_.compression == MatFileCompression::NONE);
+  THROW_CHECK_LT(row, header_.height);
+  THROW_CHECK_LT(col, header_.width);
+  THROW_CHECK_LT(slice, header_.depth);
+  const size_t idx = (slice * header_.height + row) * header_.width + col;
+  return ReadElement(
+      file_.Data() + header_.data_offset +
+          idx * GetElementSize(header_.data_type),
+      header_.data_type);
+}
+
+Mat<float> MappedMatFile::Read() const {
+  Mat<float> mat(header_.width, header_.height, header_.depth);
+  float* values = mat.GetPtr();
+  const size_t num_values = header_.width * header_.height * header_.depth;
+  const size_t element_size = GetElementSize(header_.data_type);
+
+  if (header_.compression == MatFileCompression::NONE) {
+    const float* data = GetData();
+    if (data != nullptr) {
+      std::memcpy(values, data, num_values * sizeof(float));
+    } else {
+      const char* elements = file_.Data() + header_.data_offset;
+      for (size_t i = 0; i < num_values; ++i) {
+        values[i] = ReadElement(elements + i * element_size, header_.data_type);
+      }
+    }
+    return mat;
+  }
+
+  const size_t tile_size = header_.tile_size;
+  const size_t num_tile_rows = (header_.height + tile_size - 1) / tile_size;
+  const size_t num_tile_cols = (header_.width + tile_size - 1) / tile_size;
+  const size_t num_tiles = header_.depth * num_tile_rows * num_tile_cols;
+  THROW_CHECK_GE(file_.NumBytes(),
+                 header_.data_offset + (num_tiles + 1) * sizeof(uint64_t))
+      << "Truncated file";
+  const char* tile_offsets = file_.Data() + header_.data_offset;
+  const char* file_end = file_.Data() + file_.NumBytes();
+
+  size_t tile_idx = 0;
+  for (size_t slice = 0; slice < header_.depth; ++slice) {
+    for (size_t tile_row = 0; tile_row < num_tile_rows; ++tile_row) {
+      for (size_t tile_col = 0; tile_col < num_tile_cols; ++tile_col) {
+        const uint64_t tile_begin =
+            ReadValue<uint64_t>(tile_offsets + tile_idx * sizeof(uint64_t));
+        const uint64_t tile_end = ReadValue<uint64_t>(
+            tile_offsets + (tile_idx + 1) * sizeof(uint64_t));
+        THROW_CHECK_LE(tile_begin, tile_end);
+        THROW_CHECK_LE(tile_end, file_.NumBytes());
+        ++tile_idx;
+
+        const size_t row_begin = tile_row * tile_size;
+        const size_t row_end = std::min<size_t>(header_.height,
+                                                row_begin + tile_size);
+        const size_t col_begin = tile_col * tile_size;
+        const size_t col_end = std::min<size_t>(header_.width,
+                                                col_begin + tile_size);
+        const size_t tile_width = col_end - col_begin;
+        float* slice_values = values + slice * header_.width * header_.height;
+        DecodeRuns(file_.Data() + tile_begin,
+                   std::min(file_.Data() + tile_end, file_end),
+                   element_size,
+                   (row_end - row_begin) * tile_width,
+                   [&](const size_t idx, const char* element) {
+                     const size_t row = row_begin + idx / tile_width;
+                     const size_t col = col_begin + idx % tile_width;
+                     slice_values[row * header_.width + col] =
+                         ReadElement(element, header_.data_type);
+                   });
+      }
+    }
+  }
+
+  return mat;
+}
+
+}  // namespace mvs
+}  // namespace colmap
@@ -0,0 +1,134 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/mvs/mat.h"
+#include "colmap/util/file.h"
+
+#include <cstdint>
+#include <string>
+
+namespace colmap {
+namespace mvs {
+
+// Versioned binary file format for depth and normal maps. In contrast to the
+// legacy format of Mat::Write with its variable-length text header, the header
+// has a fixed size and the data is aligned, such that uncompressed maps can be
+// accessed directly through a memory mapping of the file:
+//
+//    <magic : char[8] = "COLMAPMT">
+//    <version : uint32>
+//    <data_type : uint32>
+//    <compression : uint32>
+//    <tile_size : uint32>
+//    <width : uint64>
+//    <height : uint64>
+//    <depth : uint64>
+//    <data_offset : uint64>
+//    <reserved : uint8[8]>
+//
+// All values are stored in little endian. Uncompressed data starts at
+// data_offset in the same slice-major order as in Mat. Compressed data is split
+// into tiles of tile_size x tile_size pixels for each slice, ordered by slice,
+// tile row, and tile column. At data_offset, a table of num_tiles + 1 uint64
+// file offsets of the tiles is followed by the run-length encoded tiles. Each
+// run starts with a control byte c, followed by either c + 1 literal values
+// for c >= 0 or by a single value repeated 1 - c times for c < 0.
+enum class MatFileDataType : uint32_t {
+  FLOAT32 = 0,
+  FLOAT16 = 1,
+};
+
+enum class MatFileCompression : uint32_t {
+  NONE = 0,
+  RLE = 1,
+};
+
+struct MatFileHeader {
+  uint32_t version = 0;
+  MatFileDataType data_type = MatFileDataType::FLOAT32;
+  MatFileCompression compression = MatFileCompression::NONE;
+  uint32_t tile_size = 0;
+  uint64_t width = 0;
+  uint64_t height = 0;
+  uint64_t depth = 0;
+  uint64_t data_offset = 0;
+};
+
+struct MatFileOptions {
+  // Whether to store the values as 16-bit half precision floats, which halves
+  // the file size at a relative precision of about 1e-3.
+  bool half_precision = false;
+
+  // Whether to compress the map, which is effective for the large invalid
+  // regions of filtered depth and normal maps.
+  bool compress = false;
+
+  // The size of compressed tiles in pixels.
+  int tile_size = 64;
+
+  bool Check() const;
+};
+
+// Check whether the file at the given path is in the binary format.
+bool IsMatFile(const std::string& path);
+
+// Write the matrix in the binary format. The matrix must not be empty.
+void WriteMatFile(const std::string& path,
+                  const Mat<float>& mat,
+                  const MatFileOptions& options = MatFileOptions());
+
+// Memory-mapped read access to a matrix in the binary format.
+class MappedMatFile {
+ public:
+  explicit MappedMatFile(const std::string& path);
+
+  inline const MatFileHeader& GetHeader() const { return header_; }
+  inline size_t GetWidth() const { return header_.width; }
+  inline size_t GetHeight() const { return header_.height; }
+  inline size_t GetDepth() const { return header_.depth; }
+
+  // Direct pointer into the mapped file for uncompressed single precision data
+  // on little endian hosts, otherwise null.
+  const float* GetData() const;
+
+  // Read a single value of an uncompressed matrix.
+  float Get(size_t row, size_t col, size_t slice = 0) const;
+
+  // Decode the whole matrix.
+  Mat<float> Read() const;
+
+ private:
+  MappedFile file_;
+  MatFileHeader header_;
+};
+
+}  // namespace mvs
+}  // namespace colmap
@@ -0,0 +1,210 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/mat_file.h"
+
+#include "colmap/util/file.h"
+#include "colmap/util/testing.h"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+Mat<float> CreateTestMat(const size_t width,
+                         const size_t height,
+                         const size_t depth) {
+  Mat<float> mat(width, height, depth);
+  for (size_t slice = 0; slice < depth; ++slice) {
+    for (size_t row = 0; row < height; ++row) {
+      for (size_t col = 0; col < width; ++col) {
+        // Invalid region with zeros and constant runs, as in filtered maps.
+        if (col < width / 3) {
+          mat.Set(row, col, slice, 0);
+        } else if (row < height / 2) {
+          mat.Set(row, col, slice, 1.5f + slice);
+        } else {
+          mat.Set(row, col, slice, 0.1f * row + 0.01f * col - slice);
+        }
+      }
+    }
+  }
+  return mat;
+}
+
+void ExpectMatNear(const Mat<float>& mat1,
+                   const Mat<float>& mat2,
+                   const float max_rel_error) {
+  ASSERT_EQ(mat1.GetWidth(), mat2.GetWidth());
+  ASSERT_EQ(mat1.GetHeight(), mat2.GetHeight());
+  ASSERT_EQ(mat1.GetDepth(), mat2.GetDepth());
+  for (size_t slice = 0; slice < mat1.GetDepth(); ++slice) {
+    for (size_t row = 0; row < mat1.GetHeight(); ++row) {
+      for (size_t col = 0; col < mat1.GetWidth(); ++col) {
+        const float value1 = mat1.Get(row, col, slice);
+        const float value2 = mat2.Get(row, col, slice);
+        EXPECT_LE(std::abs(value1 - value2),
+                  max_rel_error * std::abs(value1));
+      }
+    }
+  }
+}
+
+TEST(MatFile, ReadWriteUncompressed) {
+  const std::string test_dir = CreateTestDir();
+  const std::string path = test_dir + "/mat.bin";
+  const Mat<float> mat = CreateTestMat(7, 5, 3);
+
+  WriteMatFile(path, mat);
+  EXPECT_TRUE(IsMatFile(path));
+
+  const MappedMatFile mapped_mat(path);
+  EXPECT_EQ(mapped_mat.GetHeader().version, 1);
+  EXPECT_EQ(mapped_mat.GetHeader().data_type, MatFileDataType::FLOAT32);
+  EXPECT_EQ(mapped_mat.GetHeader().compression, MatFileCompression::NONE);
+  EXPECT_EQ(mapped_mat.GetWidth(), 7);
+  EXPECT_EQ(mapped_mat.GetHeight(), 5);
+  EXPECT_EQ(mapped_mat.GetDepth(), 3);
+  EXPECT_EQ(mapped_mat.Get(4, 6, 2), mat.Get(4, 6, 2));
+  ASSERT_NE(mapped_mat.GetData(), nullptr);
+  EXPECT_EQ(mapped_mat.GetData()[5], mat.GetPtr()[5]);
+  ExpectMatNear(mapped_mat.Read(), mat, 0);
+
+  Mat<float> read_mat;
+  read_mat.Read(path);
+  ExpectMatNear(read_mat, mat, 0);
+}
+
+TEST(MatFile, WriteEmpty) {
+  const std::string test_dir = CreateTestDir();
+  const std::string path = test_dir + "/mat.bin";
+  EXPECT_ANY_THROW(WriteMatFile(path, Mat<float>()));
+  EXPECT_ANY_THROW(WriteMatFile(path, Mat<float>(7, 0, 3)));
+  EXPECT_ANY_THROW(WriteMatFile(path, Mat<float>(7, 5, 0)));
+  EXPECT_FALSE(ExistsFile(path));
+}
+
+TEST(MatFile, ReadWriteHalfPrecision) {
+  const std::string test_dir = CreateTestDir();
+  const std::string path = test_dir + "/mat.bin";
+  const Mat<float> mat = CreateTestMat(7, 5, 3);
+
+  MatFileOptions options;
+  options.half_precision = true;
+  WriteMatFile(path, mat, options);
+  EXPECT_EQ(GetFileSize(path), 64 + 7 * 5 * 3 * 2);
+
+  const MappedMatFile mapped_mat(path);
+  EXPECT_EQ(mapped_mat.GetHeader().data_type, MatFileDataType::FLOAT16);
+  EXPECT_EQ(mapped_mat.GetData(), nullptr);
+  EXPECT_NEAR(mapped_mat.Get(4, 6, 2), mat.Get(4, 6, 2), 1e-3);
+  ExpectMatNear(mapped_mat.Read(), mat, 1e-3);
+}
+
+TEST(MatFile, ReadWriteCompressed) {
+  const std::string test_dir = CreateTestDir();
+  const std::string path = test_dir + "/mat.bin";
+  const Mat<float> mat = CreateTestMat(300, 200, 3);
+
+  for (const bool half_precision : {false, true}) {
+    for (const int tile_size : {1, 7, 64, 512}) {
+      MatFileOptions options;
+      options.half_precision = half_precision;
+      options.compress = true;
+      options.tile_size = tile_size;
+      WriteMatFile(path, mat, options);
+
+      const MappedMatFile mapped_mat(path);
+      EXPECT_EQ(mapped_mat.GetHeader().compression, MatFileCompression::RLE);
+      EXPECT_EQ(mapped_mat.GetHeader().tile_size, tile_size);
+      EXPECT_EQ(mapped_mat.GetData(), nullptr);
+      EXPECT_ANY_THROW(mapped_mat.Get(0, 0, 0));
+      ExpectMatNear(mapped_mat.Read(), mat, half_precision ? 1e-3 : 0);
+
+      if (tile_size >= 64) {
+        EXPECT_LT(GetFileSize(path), mat.GetNumBytes() / 2);
+      }
+    }
+  }
+}
+
+TEST(MatFile, ReadLegacy) {
+  const std::string test_dir = CreateTestDir();
+  const std::string path = test_dir + "/mat.bin";
+  const Mat<float> mat = CreateTestMat(7, 5, 3);
+  mat.Write(path);
+  EXPECT_FALSE(IsMatFile(path));
+  EXPECT_ANY_THROW(MappedMatFile mapped_mat(path));
+
+  Mat<float> read_mat;
+  read_mat.Read(path);
+  ExpectMatNear(read_mat, mat, 0);
+}
+
+TEST(MatFile, ReadMapped) {
+  const std::string test_dir = CreateTestDir();
+  const std::string path = test_dir + "/mat.bin";
+  const Mat<float> mat = CreateTestMat(7, 5, 3);
+  WriteMatFile(path, mat);
+
+  Mat<float> mapped_mat;
+  mapped_mat.ReadMapped(path);
+  ExpectMatNear(mapped_mat, mat, 0);
+  EXPECT_EQ(mapped_mat.GetNumBytes(), mat.GetNumBytes());
+  EXPECT_EQ(mapped_mat.GetData(), mat.GetData());
+
+  // Copies share the mapping and modifications copy the data.
+  const Mat<float>& const_mapped_mat = mapped_mat;
+  const Mat<float> mapped_mat_copy = mapped_mat;
+  EXPECT_EQ(mapped_mat_copy.GetPtr(), const_mapped_mat.GetPtr());
+  mapped_mat.Set(4, 6, 2, -1);
+  EXPECT_EQ(mapped_mat.Get(4, 6, 2), -1);
+  EXPECT_NE(mapped_mat_copy.GetPtr(), const_mapped_mat.GetPtr());
+  ExpectMatNear(mapped_mat_copy, mat, 0);
+  Mat<float> read_mat;
+  read_mat.Read(path);
+  ExpectMatNear(read_mat, mat, 0);
+
+  // Compressed and legacy maps cannot be mapped and are read into memory.
+  MatFileOptions options;
+  options.compress = true;
+  WriteMatFile(path, mat, options);
+  mapped_mat.ReadMapped(path);
+  ExpectMatNear(mapped_mat, mat, 0);
+  mat.Write(path);
+  mapped_mat.ReadMapped(path);
+  ExpectMatNear(mapped_mat, mat, 0);
+}
+
+}  // namespace
+}  // namespace mvs
+}  // namespace colmap
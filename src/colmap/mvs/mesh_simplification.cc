@@ -0,0 +1,647 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/mesh_simplification.h"
+
+#include "colmap/util/logging.h"
+#include "colmap/util/misc.h"
+#include "colmap/util/threading.h"
+#include "colmap/util/timer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+// Symmetric 4x4 matrix of the quadric error of a point with respect to a set
+// of planes, stored by its upper triangle.
+class Quadric {
+ public:
+  Quadric() { coeffs_.fill(0); }
+
+  // Quadric of the squared distance to the plane n^T x + d = 0 with unit n.
+  static Quadric FromPlane(const Eigen::Vector3d& normal,
+                           const double d,
+                           const double weight) {
+    Quadric quadric;
+    const double a = normal.x();
+    const double b = normal.y();
+    const double c = normal.z();
+    quadric.coeffs_ = {a * a, a * b, a * c, a * d, b * b,
+                       b * c, b * d, c * c, c * d, d * d};
+    for (double& coeff : quadric.coeffs_) {
+      coeff *= weight;
+    }
+    return quadric;
+  }
+
+  Quadric& operator+=(const Quadric& other) {
+    for (size_t i = 0; i < coeffs_.size(); ++i) {
+      coeffs_[i] += other.coeffs_[i];
+    }
+    return *this;
+  }
+
+  Quadric operator+(const Quadric& other) const {
+    Quadric quadric = *this;
+    quadric += other;
+    return quadric;
+  }
+
+  double Evaluate(const Eigen::Vector3d& x) const {
+    const double error =
+        coeffs_[0] * x.x() * x.x() + 2 * coeffs_[1] * x.x() * x.y() +
+        2 * coeffs_[2] * x.x() * x.z() + 2 * coeffs_[3] * x.x() +
+        coeffs_[4] * x.y() * x.y() + 2 * coeffs_[5] * x.y() * x.z() +
+        2 * coeffs_[6] * x.y() + coeffs_[7] * x.z() * x.z() +
+        2 * coeffs_[8] * x.z() + coeffs_[9];
+    return std::max(error, 0.0);
+  }
+
+  // Compute the point with minimal error, if it is well-defined.
+  bool Minimize(Eigen::Vector3d* x) const {
+    Eigen::Matrix3d A;
+    A << coeffs_[0], coeffs_[1], coeffs_[2], coeffs_[1], coeffs_[4],
+        coeffs_[5], coeffs_[2], coeffs_[5], coeffs_[7];
+    const Eigen::FullPivLU<Eigen::Matrix3d> lu(A);
+    if (!lu.isInvertible()) {
+      return false;
+    }
+    *x = lu.solve(-Eigen::Vector3d(coeffs_[3], coeffs_[6], coeffs_[8]));
+    return x->allFinite();
+  }
+
+ private:
+  std::array<double, 10> coeffs_;
+};
+
+struct EdgeCollapse {
+  double error = 0;
+  size_t vertex_idx1 = 0;
+  size_t vertex_idx2 = 0;
+  uint32_t version1 = 0;
+  uint32_t version2 = 0;
+  Eigen::Vector3d position;
+
+  bool operator>(const EdgeCollapse& other) const {
+    return error > other.error;
+  }
+};
+
+// Mesh with vertex quadrics and vertex-face adjacency that supports edge
+// collapses. Faces and vertices are only marked as deleted, such that
+// collapses in disjoint regions of the mesh can be performed concurrently, as
+// long as no vertex is modified that is shared with another region.
+class QuadricMesh {
+ public:
+  QuadricMesh(const PlyMesh& mesh, double boundary_weight);
+
+  size_t NumFaces() const { return faces_.size(); }
+  size_t NumActiveFaces() const;
+  Eigen::Vector3d FaceCentroid(size_t face_idx) const;
+
+  // Collapse edges between unlocked vertices of the given faces until the
+  // number of active faces among them is at most the target number of faces
+  // or all remaining collapses exceed the maximum error.
+  void Simplify(const std::vector<size_t>& face_idxs,
+                const std::vector<char>& locked_vertices,
+                size_t target_num_faces,
+                double max_error);
+
+  PlyMesh Compact() const;
+
+ private:
+  EdgeCollapse ComputeEdgeCollapse(size_t vertex_idx1,
+                                   size_t vertex_idx2) const;
+  bool IsValidEdgeCollapse(const EdgeCollapse& collapse) const;
+  // Collapse the second into the first vertex and return the number of
+  // deleted faces.
+  size_t CollapseEdge(const EdgeCollapse& collapse);
+  // Sorted unique vertices that share an active face with the given vertex.
+  std::vector<size_t> VertexNeighbors(size_t vertex_idx) const;
+
+  std::vector<Eigen::Vector3d> positions_;
+  std::vector<Eigen::Vector3d> colors_;
+  std::vector<Quadric> quadrics_;
+  std::vector<uint32_t> vertex_versions_;
+  std::vector<char> deleted_vertices_;
+  std::vector<std::vector<size_t>> vertex_faces_;
+  std::vector<std::array<size_t, 3>> faces_;
+  std::vector<char> deleted_faces_;
+};
+
+QuadricMesh::QuadricMesh(const PlyMesh& mesh, const double boundary_weight) {
+  const size_t num_vertices = mesh.vertices.size();
+  positions_.reserve(num_vertices);
+  colors_.reserve(num_vertices);
+  for (const auto& vertex : mesh.vertices) {
+    positions_.emplace_back(vertex.x, vertex.y, vertex.z);
+    colors_.emplace_back(vertex.r, vertex.g, vertex.b);
+  }
+  quadrics_.resize(num_vertices);
+  vertex_versions_.resize(num_vertices, 0);
+  deleted_vertices_.resize(num_vertices, false);
+  vertex_faces_.resize(num_vertices);
+
+  faces_.reserve(mesh.faces.size());
+  deleted_faces_.resize(mesh.faces.size(), false);
+  std::vector<Eigen::Vector3d> face_normals;
+  face_normals.reserve(mesh.faces.size());
+  for (const auto& face : mesh.faces) {
+    THROW_CHECK_LT(face.vertex_idx1, num_vertices);
+    THROW_CHECK_LT(face.vertex_idx2, num_vertices);
+    THROW_CHECK_LT(face.vertex_idx3, num_vertices);
+    const size_t face_idx = faces_.size();
+    faces_.push_back({{face.vertex_idx1, face.vertex_idx2, face.vertex_idx3}});
+    for (const size_t vertex_idx : faces_.back()) {
+      vertex_faces_[vertex_idx].push_back(face_idx);
+    }
+
+    const Eigen::Vector3d& x1 = positions_[face.vertex_idx1];
+    const Eigen::Vector3d normal = (positions_[face.vertex_idx2] - x1)
+                                       .cross(positions_[face.vertex_idx3] - x1)
+                                       .normalized();
+    face_normals.push_back(normal);
+    if (!normal.allFinite()) {
+      continue;
+    }
+    const Quadric quadric = Quadric::FromPlane(normal, -normal.dot(x1), 1);
+    for (const size_t vertex_idx : faces_.back()) {
+      quadrics_[vertex_idx] += quadric;
+    }
+  }
+
+  // Find the boundary edges, which are only part of a single face, and add the
+  // quadrics of the planes through the edges perpendicular to their faces.
+  std::vector<std::array<size_t, 3>> edges;
+  edges.reserve(3 * faces_.size());
+  for (size_t face_idx = 0; face_idx < faces_.size(); ++face_idx) {
+    const auto& face = faces_[face_idx];
+    for (int i = 0; i < 3; ++i) {
+      const size_t vertex_idx1 = face[i];
+      const size_t vertex_idx2 = face[(i + 1) % 3];
+      edges.push_back({{std::min(vertex_idx1, vertex_idx2),
+                        std::max(vertex_idx1, vertex_idx2),
+                        face_idx}});
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size(); ++i) {
+    const bool same_as_prev = i > 0 && edges[i][0] == edges[i - 1][0] &&
+                              edges[i][1] == edges[i - 1][1];
+    const bool same_as_next = i + 1 < edges.size() &&
+                              edges[i][0] == edges[i + 1][0] &&
+                              edges[i][1] == edges[i + 1][1];
+    if (same_as_prev || same_as_next) {
+      continue;
+    }
+    const Eigen::Vector3d& face_normal = face_normals[edges[i][2]];
+    const Eigen::Vector3d& x1 = positions_[edges[i][0]];
+    const Eigen::Vector3d edge = positions_[edges[i][1]] - x1;
+    const Eigen::Vector3d normal = edge.cross(face_normal).normalized();
+    if (!normal.allFinite()) {
+      continue;
+    }
+    const Quadric quadric = Quadric::FromPlane(
+        normal, -normal.dot(x1), boundary_weight * edge.squaredNorm());
+    quadrics_[edges[i][0]] += quadric;
+    quadrics_[edges[i][1]] += quadric;
+  }
+}
+
+size_t QuadricMesh::NumActiveFaces() const {
+  return std::count(deleted_faces_.begin(), deleted_faces_.end(), false);
+}
+
+Eigen::Vector3d QuadricMesh::FaceCentroid(const size_t face_idx) const {
+  const auto& face = faces_[face_idx];
+  return (positions_[face[0]] + positions_[face[1]] + positions_[face[2]]) /
+         3.0;
+}
+
+void QuadricMesh::Simplify(const std::vector<size_t>& face_idxs,
+                           const std::vector<char>& locked_vertices,
+                           const size_t target_num_faces,
+                           const double max_error) {
+  auto IsCollapsible = [&](const size_t vertex_idx) {
+    return locked_vertices.empty() || !locked_vertices[vertex_idx];
+  };
+
+  size_t num_faces = 0;
+  std::vector<std::pair<size_t, size_t>> edges;
+  edges.reserve(3 * face_idxs.size());
+  for (const size_t face_idx : face_idxs) {
+    if (deleted_faces_[face_idx]) {
+      continue;
+    }
+    num_faces += 1;
+    const auto& face = faces_[face_idx];
+    for (int i = 0; i < 3; ++i) {
+      const size_t vertex_idx1 = face[i];
+      const size_t vertex_idx2 = face[(i + 1) % 3];
+      if (IsCollapsible(vertex_idx1) && IsCollapsible(vertex_idx2)) {
+        edges.emplace_back(std::min(vertex_idx1, vertex_idx2),
+                           std::max(vertex_idx1, vertex_idx2));
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+  std::vector<EdgeCollapse> collapses;
+  collapses.reserve(edges.size());
+  for (const auto& edge : edges) {
+    collapses.push_back(ComputeEdgeCollapse(edge.first, edge.second));
+  }
+  std::vector<std::pair<size_t, size_t>>().swap(edges);
+
+  std::priority_queue<EdgeCollapse,
+                      std::vector<EdgeCollapse>,
+                      std::greater<EdgeCollapse>>
+      queue(std::greater<EdgeCollapse>(), std::move(collapses));
+
+  while (num_faces > target_num_faces && !queue.empty()) {
+    const EdgeCollapse collapse = queue.top();
+    queue.pop();
+
+    // Skip outdated collapses of modified vertices.
+    if (deleted_vertices_[collapse.vertex_idx1] ||
+        deleted_vertices_[collapse.vertex_idx2] ||
+        vertex_versions_[collapse.vertex_idx1] != collapse.version1 ||
+        vertex_versions_[collapse.vertex_idx2] != collapse.version2) {
+      continue;
+    }
+
+    if (max_error >= 0 && collapse.error > max_error) {
+      break;
+    }
+
+    if (!IsValidEdgeCollapse(collapse)) {
+      continue;
+    }
+
+    num_faces -= CollapseEdge(collapse);
+
+    for (const size_t vertex_idx : VertexNeighbors(collapse.vertex_idx1)) {
+      if (vertex_idx != collapse.vertex_idx1 && IsCollapsible(vertex_idx)) {
+        queue.push(ComputeEdgeCollapse(collapse.vertex_idx1, vertex_idx));
+      }
+    }
+  }
+}
+
+PlyMesh QuadricMesh::Compact() const {
+  PlyMesh mesh;
+  std::vector<size_t> vertex_idx_map(positions_.size(), -1);
+  for (size_t face_idx = 0; face_idx < faces_.size(); ++face_idx) {
+    if (deleted_faces_[face_idx]) {
+      continue;
+    }
+    std::array<size_t, 3> face;
+    for (int i = 0; i < 3; ++i) {
+      const size_t vertex_idx = faces_[face_idx][i];
+      if (vertex_idx_map[vertex_idx] == static_cast<size_t>(-1)) {
+        vertex_idx_map[vertex_idx] = mesh.vertices.size();
+        const Eigen::Vector3d& position = positions_[vertex_idx];
+        const Eigen::Vector3d color =
+            colors_[vertex_idx].array().round().max(0).min(255);
+        PlyMeshVertex vertex(position.x(), position.y(), position.z());
+        vertex.r = static_cast<uint8_t>(color.x());
+        vertex.g = static_cast<uint8_t>(color.y());
+        vertex.b = static_cast<uint8_t>(color.z());
+        mesh.vertices.push_back(vertex);
+      }
+      face[i] = vertex_idx_map[vertex_idx];
+    }
+    mesh.faces.emplace_back(face[0], face[1], face[2]);
+  }
+  return mesh;
+}
+
+EdgeCollapse QuadricMesh::ComputeEdgeCollapse(const size_t vertex_idx1,
+                                              const size_t vertex_idx2) const {
+  EdgeCollapse collapse;
+  collapse.vertex_idx1 = vertex_idx1;
+  collapse.vertex_idx2 = vertex_idx2;
+  collapse.version1 = vertex_versions_[vertex_idx1];
+  collapse.version2 = vertex_versions_[vertex_idx2];
+
+  const Quadric quadric = quadrics_[vertex_idx1] + quadrics_[vertex_idx2];
+  const Eigen::Vector3d& x1 = positions_[vertex_idx1];
+  const Eigen::Vector3d& x2 = positions_[vertex_idx2];
+
+  // Fall back to the best of the end and mid points, if the optimal position
+  // is not well-defined, e.g., for planar regions.
+  collapse.error = std::numeric_limits<double>::max();
+  Eigen::Vector3d optimal_position;
+  if (quadric.Minimize(&optimal_position)) {
+    collapse.position = optimal_position;
+    collapse.error = quadric.Evaluate(optimal_position);
+  }
+  const std::array<Eigen::Vector3d, 3> candidate_positions = {
+      {x1, x2, 0.5 * (x1 + x2)}};
+  for (const Eigen::Vector3d& position : candidate_positions) {
+    const double error = quadric.Evaluate(position);
+    if (error < collapse.error) {
+      collapse.position = position;
+      collapse.error = error;
+    }
+  }
+
+  return collapse;
+}
+
+bool QuadricMesh::IsValidEdgeCollapse(const EdgeCollapse& collapse) const {
+  const size_t vertex_idx1 = collapse.vertex_idx1;
+  const size_t vertex_idx2 = collapse.vertex_idx2;
+
+  // The link condition ensures that the collapse preserves the topology, i.e.,
+  // the vertices of the edge share no other neighbors than the third vertices
+  // of their shared faces.
+  const std::vector<size_t> neighbors1 = VertexNeighbors(vertex_idx1);
+  const std::vector<size_t> neighbors2 = VertexNeighbors(vertex_idx2);
+  std::vector<size_t> shared_neighbors;
+  std::set_intersection(neighbors1.begin(),
+                        neighbors1.end(),
+                        neighbors2.begin(),
+                        neighbors2.end(),
+                        std::back_inserter(shared_neighbors));
+  size_t num_shared_faces = 0;
+  for (const size_t face_idx : vertex_faces_[vertex_idx1]) {
+    const auto& face = faces_[face_idx];
+    if (!deleted_faces_[face_idx] &&
+        std::find(face.begin(), face.end(), vertex_idx2) != face.end()) {
+      num_shared_faces += 1;
+    }
+  }
+  // The shared neighbors include the edge vertices themselves.
+  if (shared_neighbors.size() != num_shared_faces + 2) {
+    return false;
+  }
+
+  // Reject collapses that flip or degenerate the remaining faces.
+  for (const size_t vertex_idx : {vertex_idx1, vertex_idx2}) {
+    for (const size_t face_idx : vertex_faces_[vertex_idx]) {
+      const auto& face = faces_[face_idx];
+      if (deleted_faces_[face_idx] ||
+          (std::find(face.begin(), face.end(), vertex_idx1) != face.end() &&
+           std::find(face.begin(), face.end(), vertex_idx2) != face.end())) {
+        continue;
+      }
+      std::array<Eigen::Vector3d, 3> positions;
+      for (int i = 0; i < 3; ++i) {
+        positions[i] = positions_[face[i]];
+      }
+      const Eigen::Vector3d normal =
+          (positions[1] - positions[0]).cross(positions[2] - positions[0]);
+      for (int i = 0; i < 3; ++i) {
+        if (face[i] == vertex_idx) {
+          positions[i] = collapse.position;
+        }
+      }
+      const Eigen::Vector3d new_normal =
+          (positions[1] - positions[0]).cross(positions[2] - positions[0]);
+      if (new_normal.dot(normal) <= 0) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+size_t QuadricMesh::CollapseEdge(const EdgeCollapse& collapse) {
+  const size_t vertex_idx1 = collapse.vertex_idx1;
+  const size_t vertex_idx2 = collapse.vertex_idx2;
+
+  // Interpolate the color at the projection of the new position onto the edge.
+  const Eigen::Vector3d edge =
+      positions_[vertex_idx2] - positions_[vertex_idx1];
+  const double edge_squared_norm = edge.squaredNorm();
+  const double t =
+      edge_squared_norm > 0
+          ? std::clamp(edge.dot(collapse.position - positions_[vertex_idx1]) /
+                           edge_squared_norm,
+                       0.0,
+                       1.0)
+          : 0.5;
+  colors_[vertex_idx1] =
+      (1 - t) * colors_[vertex_idx1] + t * colors_[vertex_idx2];
+  positions_[vertex_idx1] = collapse.position;
+  quadrics_[vertex_idx1] += quadrics_[vertex_idx2];
+  vertex_versions_[vertex_idx1] += 1;
+  vertex_versions_[vertex_idx2] += 1;
+  deleted_vertices_[vertex_idx2] = true;
+
+  size_t num_deleted_faces = 0;
+  for (const size_t face_idx : vertex_faces_[vertex_idx2]) {
+    if (deleted_faces_[face_idx]) {
+      continue;
+    }
+    auto& face = faces_[face_idx];
+    if (std::find(face.begin(), face.end(), vertex_idx1) != face.end()) {
+      deleted_faces_[face_idx] = true;
+      num_deleted_faces += 1;
+    } else {
+      std::replace(face.begin(), face.end(), vertex_idx2, vertex_idx1);
+      vertex_faces_[vertex_idx1].push_back(face_idx);
+    }
+  }
+  std::vector<size_t>().swap(vertex_faces_[vertex_idx2]);
+
+  auto& faces1 = vertex_faces_[vertex_idx1];
+  faces1.erase(std::remove_if(faces1.begin(),
+                              faces1.end(),
+                              [&](const size_t face_idx) {
+                                return deleted_faces_[face_idx];
+                              }),
+               faces1.end());
+
+  return num_deleted_faces;
+}
+
+std::vector<size_t> QuadricMesh::VertexNeighbors(
+    const size_t vertex_idx) const {
+  std::vector<size_t> neighbors;
+  for (const size_t face_idx : vertex_faces_[vertex_idx]) {
+    if (!deleted_faces_[face_idx]) {
+      const auto& face = faces_[face_idx];
+      neighbors.insert(neighbors.end(), face.begin(), face.end());
+    }
+  }
+  std::sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                  neighbors.end());
+  return neighbors;
+}
+
+// Recursively split the faces at the median of their centroids along the
+// longest axis of their bounding box into the given number of levels.
+void SplitFaces(const QuadricMesh& mesh,
+                std::vector<size_t> face_idxs,
+                const int num_levels,
+                std::vector<std::vector<size_t>>* blocks) {
+  if (num_levels == 0 || face_idxs.size() < 2) {
+    blocks->push_back(std::move(face_idxs));
+    return;
+  }
+
+  Eigen::AlignedBox3d bbox;
+  for (const size_t face_idx : face_idxs) {
+    bbox.extend(mesh.FaceCentroid(face_idx));
+  }
+  int axis = 0;
+  bbox.sizes().maxCoeff(&axis);
+
+  const auto median = face_idxs.begin() + face_idxs.size() / 2;
+  std::nth_element(
+      face_idxs.begin(),
+      median,
+      face_idxs.end(),
+      [&](const size_t face_idx1, const size_t face_idx2) {
+        return mesh.FaceCentroid(face_idx1)(axis) <
+               mesh.FaceCentroid(face_idx2)(axis);
+      });
+
+  SplitFaces(mesh,
+             std::vector<size_t>(face_idxs.begin(), median),
+             num_levels - 1,
+             blocks);
+  SplitFaces(mesh,
+             std::vector<size_t>(median, face_idxs.end()),
+             num_levels - 1,
+             blocks);
+}
+
+}  // namespace
+
+bool MeshSimplificationOptions::Check() const {
+  CHECK_OPTION_GT(target_face_ratio, 0);
+  CHECK_OPTION_LE(target_face_ratio, 1);
+  CHECK_OPTION_GE(boundary_weight, 0);
+  CHECK_OPTION_GE(num_threads, -1);
+  CHECK_OPTION_NE(num_threads, 0);
+  return true;
+}
+
+PlyMesh SimplifyMesh(const PlyMesh& mesh,
+                     const MeshSimplificationOptions& options) {
+  THROW_CHECK(options.Check());
+
+  Timer timer;
+  timer.Start();
+
+  QuadricMesh quadric_mesh(mesh, options.boundary_weight);
+
+  const size_t num_faces = quadric_mesh.NumFaces();
+  const size_t target_num_faces =
+      options.target_num_faces > 0
+          ? static_cast<size_t>(options.target_num_faces)
+          : static_cast<size_t>(
+                std::round(options.target_face_ratio * num_faces));
+  if (target_num_faces >= num_faces) {
+    return quadric_mesh.Compact();
+  }
+
+  std::vector<size_t> face_idxs(num_faces);
+  std::iota(face_idxs.begin(), face_idxs.end(), 0);
+
+  const int num_threads = GetEffectiveNumThreads(options.num_threads);
+  if (num_threads > 1) {
+    // Simplify spatially coherent blocks of faces in parallel, where vertices
+    // shared by multiple blocks are locked.
+    std::vector<std::vector<size_t>> blocks;
+    SplitFaces(quadric_mesh,
+               face_idxs,
+               static_cast<int>(std::ceil(std::log2(num_threads))),
+               &blocks);
+
+    std::vector<int> vertex_block_idxs(mesh.vertices.size(), -1);
+    std::vector<char> locked_vertices(mesh.vertices.size(), false);
+    for (size_t block_idx = 0; block_idx < blocks.size(); ++block_idx) {
+      for (const size_t face_idx : blocks[block_idx]) {
+        const auto& face = mesh.faces[face_idx];
+        for (const size_t vertex_idx :
+             {face.vertex_idx1, face.vertex_idx2, face.vertex_idx3}) {
+          int& vertex_block_idx = vertex_block_idxs[vertex_idx];
+          if (vertex_block_idx == -1) {
+            vertex_block_idx = block_idx;
+          } else if (vertex_block_idx != static_cast<int>(block_idx)) {
+            locked_vertices[vertex_idx] = true;
+          }
+        }
+      }
+    }
+
+    const double target_ratio =
+        static_cast<double>(target_num_faces) / num_faces;
+    ThreadPool thread_pool(num_threads);
+    for (const auto& block : blocks) {
+      thread_pool.AddTask([&]() {
+        quadric_mesh.Simplify(
+            block,
+            locked_vertices,
+            static_cast<size_t>(std::round(target_ratio * block.size())),
+            options.max_error);
+      });
+    }
+    thread_pool.Wait();
+  }
+
+  // Simplify the seams between the blocks and reach the exact target.
+  quadric_mesh.Simplify(face_idxs,
+                        /*locked_vertices=*/{},
+                        target_num_faces,
+                        options.max_error);
+
+  PlyMesh simplified_mesh = quadric_mesh.Compact();
+
+  LOG(INFO) << StringPrintf(
+      "Simplified mesh from %d to %d faces with %d threads in %.3fs",
+      num_faces,
+      simplified_mesh.faces.size(),
+      num_threads,
+      timer.ElapsedSeconds());
+
+  return simplified_mesh;
+}
+
+}  // namespace mvs
+}  // namespace colmap
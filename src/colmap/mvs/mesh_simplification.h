@@ -0,0 +1,77 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/util/ply.h"
+
+namespace colmap {
+namespace mvs {
+
+struct MeshSimplificationOptions {
+  // Target ratio of the number of faces of the simplified mesh to the number
+  // of faces of the input mesh.
+  double target_face_ratio = 0.1;
+
+  // Target number of faces of the simplified mesh. If positive, it overrides
+  // the target face ratio.
+  int target_num_faces = -1;
+
+  // Maximum quadric error of a vertex after an edge collapse, i.e., the sum of
+  // squared distances to the planes of the original faces around the vertex.
+  // The simplification stops before reaching the target number of faces once
+  // all remaining collapses exceed this error. No limit if negative.
+  double max_error = -1.0;
+
+  // Weight of the quadrics of planes perpendicular to boundary edges, which
+  // penalize the displacement of mesh boundaries.
+  double boundary_weight = 1000.0;
+
+  // The number of threads. The mesh is split into spatially coherent blocks
+  // of faces, which are simplified in parallel while keeping the vertices
+  // shared between blocks fixed, followed by a pass over the entire mesh.
+  int num_threads = -1;
+
+  bool Check() const;
+};
+
+// Simplify a triangle mesh by iteratively collapsing the edge with the least
+// quadric error, as described in:
+//
+//    M. Garland and P. Heckbert. "Surface simplification using quadric error
+//    metrics". SIGGRAPH, 1997.
+//
+// Collapses that would make the mesh non-manifold or flip faces are skipped.
+// Vertex colors are interpolated along the collapsed edges and unreferenced
+// vertices are removed from the output mesh.
+PlyMesh SimplifyMesh(const PlyMesh& mesh,
+                     const MeshSimplificationOptions& options);
+
+}  // namespace mvs
+}  // namespace colmap
@@ -0,0 +1,177 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/mesh_simplification.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+// Planar grid in the unit square with the given number of cells per axis,
+// where each cell is split into two triangles and the vertex colors vary
+// linearly along the x-axis.
+PlyMesh CreateGridMesh(const int num_cells_per_axis) {
+  PlyMesh mesh;
+  const int num_vertices_per_axis = num_cells_per_axis + 1;
+  for (int y = 0; y < num_vertices_per_axis; ++y) {
+    for (int x = 0; x < num_vertices_per_axis; ++x) {
+      PlyMeshVertex vertex(static_cast<float>(x) / num_cells_per_axis,
+                           static_cast<float>(y) / num_cells_per_axis,
+                           0);
+      vertex.r = static_cast<uint8_t>(200 * x / num_cells_per_axis);
+      vertex.g = 100;
+      vertex.b = 50;
+      mesh.vertices.push_back(vertex);
+    }
+  }
+  for (int y = 0; y < num_cells_per_axis; ++y) {
+    for (int x = 0; x < num_cells_per_axis; ++x) {
+      const size_t idx00 = y * num_vertices_per_axis + x;
+      const size_t idx01 = idx00 + 1;
+      const size_t idx10 = idx00 + num_vertices_per_axis;
+      const size_t idx11 = idx10 + 1;
+      mesh.faces.emplace_back(idx00, idx01, idx11);
+      mesh.faces.emplace_back(idx00, idx11, idx10);
+    }
+  }
+  return mesh;
+}
+
+bool IsOnUnitSquareBoundary(const PlyMeshVertex& vertex) {
+  constexpr float kEps = 1e-5f;
+  return std::abs(vertex.x) < kEps || std::abs(vertex.x - 1) < kEps ||
+         std::abs(vertex.y) < kEps || std::abs(vertex.y - 1) < kEps;
+}
+
+void ExpectValidMesh(const PlyMesh& mesh) {
+  for (const auto& face : mesh.faces) {
+    EXPECT_LT(face.vertex_idx1, mesh.vertices.size());
+    EXPECT_LT(face.vertex_idx2, mesh.vertices.size());
+    EXPECT_LT(face.vertex_idx3, mesh.vertices.size());
+    EXPECT_NE(face.vertex_idx1, face.vertex_idx2);
+    EXPECT_NE(face.vertex_idx1, face.vertex_idx3);
+    EXPECT_NE(face.vertex_idx2, face.vertex_idx3);
+  }
+}
+
+class ParameterizedMeshSimplificationTests
+    : public ::testing::TestWithParam<int> {};
+
+TEST_P(ParameterizedMeshSimplificationTests, Plane) {
+  const PlyMesh mesh = CreateGridMesh(16);
+
+  MeshSimplificationOptions options;
+  options.target_face_ratio = 0.1;
+  options.num_threads = GetParam();
+  const PlyMesh simplified_mesh = SimplifyMesh(mesh, options);
+
+  ExpectValidMesh(simplified_mesh);
+  EXPECT_LE(simplified_mesh.faces.size(), 52);
+  EXPECT_LT(simplified_mesh.vertices.size(), mesh.vertices.size());
+
+  // The corners of the plane must be preserved and all other vertices must
+  // remain on the plane and the boundary must not shrink.
+  int num_corners = 0;
+  int num_boundary_vertices = 0;
+  for (const auto& vertex : simplified_mesh.vertices) {
+    EXPECT_NEAR(vertex.z, 0, 1e-5);
+    EXPECT_GE(vertex.x, -1e-5);
+    EXPECT_LE(vertex.x, 1 + 1e-5);
+    EXPECT_GE(vertex.y, -1e-5);
+    EXPECT_LE(vertex.y, 1 + 1e-5);
+    if ((std::abs(vertex.x) < 1e-5 || std::abs(vertex.x - 1) < 1e-5) &&
+        (std::abs(vertex.y) < 1e-5 || std::abs(vertex.y - 1) < 1e-5)) {
+      num_corners += 1;
+    }
+    if (IsOnUnitSquareBoundary(vertex)) {
+      num_boundary_vertices += 1;
+    }
+  }
+  EXPECT_EQ(num_corners, 4);
+  EXPECT_GE(num_boundary_vertices, 4);
+
+  // The colors are interpolated along the collapsed edges, which approximately
+  // preserves their linear variation along the x-axis.
+  for (const auto& vertex : simplified_mesh.vertices) {
+    EXPECT_NEAR(vertex.r, 200 * vertex.x, 10);
+    EXPECT_EQ(vertex.g, 100);
+    EXPECT_EQ(vertex.b, 50);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(MeshSimplificationTests,
+                         ParameterizedMeshSimplificationTests,
+                         ::testing::Values(1, 4));
+
+TEST(SimplifyMesh, TargetNumFaces) {
+  const PlyMesh mesh = CreateGridMesh(8);
+  MeshSimplificationOptions options;
+  options.target_num_faces = 32;
+  options.num_threads = 1;
+  const PlyMesh simplified_mesh = SimplifyMesh(mesh, options);
+  ExpectValidMesh(simplified_mesh);
+  EXPECT_LE(simplified_mesh.faces.size(), 32);
+  EXPECT_GE(simplified_mesh.faces.size(), 30);
+}
+
+TEST(SimplifyMesh, MaxError) {
+  // Fold the grid along the x = 0.5 line, such that the collapses across the
+  // fold have a large error.
+  PlyMesh mesh = CreateGridMesh(8);
+  for (auto& vertex : mesh.vertices) {
+    vertex.z = std::abs(vertex.x - 0.5f);
+  }
+
+  MeshSimplificationOptions options;
+  options.target_num_faces = 1;
+  options.max_error = 1e-6;
+  options.num_threads = 1;
+  const PlyMesh simplified_mesh = SimplifyMesh(mesh, options);
+  ExpectValidMesh(simplified_mesh);
+  EXPECT_GT(simplified_mesh.faces.size(), 1);
+  EXPECT_LT(simplified_mesh.faces.size(), mesh.faces.size());
+  for (const auto& vertex : simplified_mesh.vertices) {
+    EXPECT_NEAR(vertex.z, std::abs(vertex.x - 0.5f), 1e-3);
+  }
+}
+
+TEST(SimplifyMesh, NoSimplification) {
+  const PlyMesh mesh = CreateGridMesh(2);
+  MeshSimplificationOptions options;
+  options.target_face_ratio = 1;
+  const PlyMesh simplified_mesh = SimplifyMesh(mesh, options);
+  EXPECT_EQ(simplified_mesh.faces.size(), mesh.faces.size());
+  EXPECT_EQ(simplified_mesh.vertices.size(), mesh.vertices.size());
+}
+
+}  // namespace
+}  // namespace mvs
+}  // namespace colmap
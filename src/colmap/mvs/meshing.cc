@@ -29,6 +29,7 @@
 
 #include "colmap/mvs/meshing.h"
 
+#include <filesystem>
 #include <fstream>
 #include <unordered_map>
 #include <vector>
@@ -36,10 +37,15 @@
 #if defined(COLMAP_CGAL_ENABLED)
 #include <CGAL/Delaunay_triangulation_3.h>
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Spatial_sort_traits_adapter_3.h>
+#include <CGAL/property_map.h>
+#include <CGAL/spatial_sort.h>
 #endif  // COLMAP_CGAL_ENABLED
 
 #include "colmap/math/graph_cut.h"
-#include "colmap/math/random.h"
+#include "colmap/mvs/fusion.h"
+#include "colmap/mvs/mesh_simplification.h"
+#include "colmap/mvs/point_octree.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/util/endian.h"
 #include "colmap/util/file.h"
@@ -93,6 +99,64 @@ struct hash<const Delaunay::Cell_handle> {
 
 namespace colmap {
 namespace mvs {
+namespace {
+
+// Read the points of the PLY file at the given path at the given resolution.
+// If an octree written by point_octree_builder exists at <path>.octree and it
+// was built from the current file, the points of its level of detail for the
+// resolution are queried. Otherwise, all points are read and voxel-downsampled.
+// The visibility is only read if it is requested, either from the octree or
+// from <path>.vis.
+void ReadPointsAtResolution(const std::string& path,
+                            const double resolution,
+                            std::vector<PlyPoint>* points,
+                            std::vector<std::vector<int>>* points_visibility) {
+  const std::string octree_path = path + ".octree";
+  if (ExistsFile(octree_path)) {
+    const PointOctree octree(octree_path);
+    if (!octree.IsBuiltFrom(path)) {
+      LOG(WARNING) << "Ignoring stale octree, which was not built from the "
+                      "current input points: "
+                   << octree_path;
+    } else if (points_visibility != nullptr && !octree.HasVisibility()) {
+      LOG(WARNING) << "Ignoring octree without visibility: " << octree_path;
+    } else {
+      octree.Query(octree.BoundingBox(), resolution, points, points_visibility);
+      LOG(INFO) << StringPrintf("Queried %d points from octree",
+                                points->size());
+      return;
+    }
+  }
+
+  std::vector<std::vector<int>> input_points_visibility;
+  if (points_visibility != nullptr) {
+    input_points_visibility = ReadPointsVisibility(path + ".vis");
+  }
+  const std::vector<PlyPoint> input_points = ReadPly(path);
+  std::vector<std::vector<int>> downsampled_points_visibility;
+  VoxelDownsamplePoints(resolution,
+                        input_points,
+                        input_points_visibility,
+                        points,
+                        points_visibility != nullptr
+                            ? points_visibility
+                            : &downsampled_points_visibility);
+  LOG(INFO) << StringPrintf(
+      "Downsampled %d to %d points", input_points.size(), points->size());
+}
+
+// Removes the file at the given path, if any, when going out of scope.
+struct TemporaryFile {
+  ~TemporaryFile() {
+    if (!path.empty()) {
+      std::error_code error_code;
+      std::filesystem::remove(path, error_code);
+    }
+  }
+  std::string path;
+};
+
+}  // namespace
 
 bool PoissonMeshingOptions::Check() const {
   CHECK_OPTION_GE(point_weight, 0);
@@ -101,6 +165,9 @@ bool PoissonMeshingOptions::Check() const {
   CHECK_OPTION_GE(trim, 0);
   CHECK_OPTION_GE(num_threads, -1);
   CHECK_OPTION_NE(num_threads, 0);
+  CHECK_OPTION_GE(target_resolution, 0);
+  CHECK_OPTION_GT(simplify_face_ratio, 0);
+  CHECK_OPTION_LE(simplify_face_ratio, 1);
   return true;
 }
 
@@ -116,6 +183,9 @@ bool DelaunayMeshingOptions::Check() const {
   CHECK_OPTION_LE(max_side_length_percentile, 100);
   CHECK_OPTION_GE(num_threads, -1);
   CHECK_OPTION_NE(num_threads, 0);
+  CHECK_OPTION_GE(target_resolution, 0);
+  CHECK_OPTION_GT(simplify_face_ratio, 0);
+  CHECK_OPTION_LE(simplify_face_ratio, 1);
   return true;
 }
 
@@ -128,12 +198,28 @@ bool PoissonMeshing(const PoissonMeshingOptions& options,
   THROW_CHECK_HAS_FILE_EXTENSION(output_path, ".ply");
   THROW_CHECK_PATH_OPEN(output_path);
 
+  // Reconstruct from the downsampled points in a temporary file, which is
+  // removed on all exit paths.
+  std::string points_path = input_path;
+  TemporaryFile downsampled_points_file;
+  if (options.target_resolution > 0) {
+    std::vector<PlyPoint> downsampled_points;
+    ReadPointsAtResolution(input_path,
+                           options.target_resolution,
+                           &downsampled_points,
+                           /*points_visibility=*/nullptr);
+    downsampled_points_file.path =
+        output_path.substr(0, output_path.size() - 4) + ".downsampled.ply";
+    WriteBinaryPlyPoints(downsampled_points_file.path, downsampled_points);
+    points_path = downsampled_points_file.path;
+  }
+
   std::vector<std::string> args;
 
   args.push_back("./binary");
 
   args.push_back("--in");
-  args.push_back(input_path);
+  args.push_back(points_path);
 
   args.push_back("--out");
   args.push_back(output_path);
@@ -169,31 +255,44 @@ bool PoissonMeshing(const PoissonMeshingOptions& options,
     return false;
   }
 
-  if (options.trim == 0) {
-    return true;
-  }
+  if (options.trim > 0) {
+    args.clear();
+    args_cstr.clear();
 
-  args.clear();
-  args_cstr.clear();
+    args.push_back("./binary");
 
-  args.push_back("./binary");
+    args.push_back("--in");
+    args.push_back(output_path);
 
-  args.push_back("--in");
-  args.push_back(output_path);
+    args.push_back("--out");
+    args.push_back(output_path);
 
-  args.push_back("--out");
-  args.push_back(output_path);
+    args.push_back("--trim");
+    args.push_back(std::to_string(options.trim));
 
-  args.push_back("--trim");
-  args.push_back(std::to_string(options.trim));
+    args_cstr.reserve(args.size());
+    for (const auto& arg : args) {
+      args_cstr.push_back(arg.c_str());
+    }
 
-  args_cstr.reserve(args.size());
-  for (const auto& arg : args) {
-    args_cstr.push_back(arg.c_str());
+    if (SurfaceTrimmer(args_cstr.size(),
+                       const_cast<char**>(args_cstr.data())) != EXIT_SUCCESS) {
+      return false;
+    }
+  }
+
+  if (options.simplify_face_ratio < 1) {
+    MeshSimplificationOptions simplification_options;
+    simplification_options.target_face_ratio = options.simplify_face_ratio;
+    simplification_options.num_threads = options.num_threads;
+    bool has_rgb = false;
+    const PlyMesh mesh = ReadPlyMesh(output_path, &has_rgb);
+    WriteBinaryPlyMesh(output_path,
+                       SimplifyMesh(mesh, simplification_options),
+                       /*write_rgb=*/has_rgb);
   }
 
-  return SurfaceTrimmer(args_cstr.size(),
-                        const_cast<char**>(args_cstr.data())) == EXIT_SUCCESS;
+  return true;
 }
 
 #if defined(COLMAP_CGAL_ENABLED)
@@ -224,18 +323,79 @@ class DelaunayMeshingInput {
   std::vector<Image> images;
   std::vector<Point> points;
 
-  void ReadSparseReconstruction(const std::string& path) {
+  void ReadSparseReconstruction(const std::string& path,
+                                const double target_resolution) {
     Reconstruction reconstruction;
     reconstruction.Read(path);
-    CopyFromSparseReconstruction(reconstruction);
+    CopyFromSparseReconstruction(reconstruction, target_resolution);
   }
 
-  void CopyFromSparseReconstruction(const Reconstruction& reconstruction) {
+  void CopyFromSparseReconstruction(const Reconstruction& reconstruction,
+                                    const double target_resolution) {
+    cameras = reconstruction.Cameras();
+
     images.reserve(reconstruction.NumRegImages());
-    points.reserve(reconstruction.NumPoints3D());
+    std::unordered_map<image_t, int> image_id_to_idx;
+    image_id_to_idx.reserve(reconstruction.NumRegImages());
+    for (const auto image_id : reconstruction.RegImageIds()) {
+      const auto& image = reconstruction.Image(image_id);
+      DelaunayMeshingInput::Image input_image;
+      input_image.camera_id = image.CameraId();
+      input_image.proj_matrix = image.CamFromWorld().ToMatrix().cast<float>();
+      input_image.proj_center = image.ProjectionCenter().cast<float>();
+      image_id_to_idx.emplace(image_id, images.size());
+      images.push_back(input_image);
+    }
 
-    cameras = reconstruction.Cameras();
+    if (target_resolution > 0) {
+      std::vector<PlyPoint> ply_points;
+      std::vector<std::vector<int>> points_visibility;
+      ply_points.reserve(reconstruction.NumPoints3D());
+      points_visibility.reserve(reconstruction.NumPoints3D());
+      for (const auto& point3D : reconstruction.Points3D()) {
+        PlyPoint ply_point;
+        ply_point.x = static_cast<float>(point3D.second.xyz.x());
+        ply_point.y = static_cast<float>(point3D.second.xyz.y());
+        ply_point.z = static_cast<float>(point3D.second.xyz.z());
+        ply_points.push_back(ply_point);
+        std::vector<int>& visibility = points_visibility.emplace_back();
+        for (const auto& track_el : point3D.second.track.Elements()) {
+          const auto it = image_id_to_idx.find(track_el.image_id);
+          if (it != image_id_to_idx.end()) {
+            visibility.push_back(it->second);
+          }
+        }
+      }
+
+      std::vector<PlyPoint> downsampled_points;
+      std::vector<std::vector<int>> downsampled_points_visibility;
+      VoxelDownsamplePoints(target_resolution,
+                            ply_points,
+                            points_visibility,
+                            &downsampled_points,
+                            &downsampled_points_visibility);
+      LOG(INFO) << StringPrintf("Downsampled %d to %d points",
+                                ply_points.size(),
+                                downsampled_points.size());
+
+      points.reserve(downsampled_points.size());
+      for (size_t point_idx = 0; point_idx < downsampled_points.size();
+           ++point_idx) {
+        const PlyPoint& ply_point = downsampled_points[point_idx];
+        const auto& visibility = downsampled_points_visibility[point_idx];
+        DelaunayMeshingInput::Point input_point;
+        input_point.position =
+            Eigen::Vector3f(ply_point.x, ply_point.y, ply_point.z);
+        input_point.num_visible_images = visibility.size();
+        for (const int image_idx : visibility) {
+          images[image_idx].point_idxs.push_back(point_idx);
+        }
+        points.push_back(input_point);
+      }
+      return;
+    }
 
+    points.reserve(reconstruction.NumPoints3D());
     std::unordered_map<point3D_t, size_t> point_id_to_idx;
     point_id_to_idx.reserve(reconstruction.NumPoints3D());
     for (const auto& point3D : reconstruction.Points3D()) {
@@ -248,10 +408,7 @@ class DelaunayMeshingInput {
 
     for (const auto image_id : reconstruction.RegImageIds()) {
       const auto& image = reconstruction.Image(image_id);
-      DelaunayMeshingInput::Image input_image;
-      input_image.camera_id = image.CameraId();
-      input_image.proj_matrix = image.CamFromWorld().ToMatrix().cast<float>();
-      input_image.proj_center = image.ProjectionCenter().cast<float>();
+      auto& input_image = images[image_id_to_idx.at(image_id)];
       input_image.point_idxs.reserve(image.NumPoints3D());
       for (const auto& point2D : image.Points2D()) {
         if (point2D.HasPoint3D()) {
@@ -259,11 +416,11 @@ class DelaunayMeshingInput {
               point_id_to_idx.at(point2D.point3D_id));
         }
       }
-      images.push_back(input_image);
     }
   }
 
-  void ReadDenseReconstruction(const std::string& path) {
+  void ReadDenseReconstruction(const std::string& path,
+                               const double target_resolution) {
     {
       Reconstruction reconstruction;
       reconstruction.Read(JoinPaths(path, "sparse"));
@@ -281,28 +438,46 @@ class DelaunayMeshingInput {
       }
     }
 
-    const auto& ply_points = ReadPly(JoinPaths(path, "fused.ply"));
-
-    const std::string vis_path = JoinPaths(path, "fused.ply.vis");
-    std::fstream vis_file(vis_path, std::ios::in | std::ios::binary);
-    THROW_CHECK_FILE_OPEN(vis_file, vis_path);
-
-    const size_t vis_num_points = ReadBinaryLittleEndian<uint64_t>(&vis_file);
-    THROW_CHECK_EQ(vis_num_points, ply_points.size());
-
-    points.reserve(ply_points.size());
-    for (const auto& ply_point : ply_points) {
-      const int point_idx = points.size();
-      DelaunayMeshingInput::Point input_point;
-      input_point.position =
-          Eigen::Vector3f(ply_point.x, ply_point.y, ply_point.z);
-      input_point.num_visible_images =
-          ReadBinaryLittleEndian<uint32_t>(&vis_file);
-      for (uint32_t i = 0; i < input_point.num_visible_images; ++i) {
-        const int image_idx = ReadBinaryLittleEndian<uint32_t>(&vis_file);
-        images.at(image_idx).point_idxs.push_back(point_idx);
+    const std::string ply_path = JoinPaths(path, "fused.ply");
+
+    auto AddPoints =
+        [this](const std::vector<PlyPoint>& ply_points,
+               const std::vector<std::vector<int>>& points_visibility) {
+          for (const auto& ply_point : ply_points) {
+            const size_t point_idx = points.size();
+            const auto& visibility = points_visibility[point_idx];
+            DelaunayMeshingInput::Point input_point;
+            input_point.position =
+                Eigen::Vector3f(ply_point.x, ply_point.y, ply_point.z);
+            input_point.num_visible_images = visibility.size();
+            for (const int image_idx : visibility) {
+              images.at(image_idx).point_idxs.push_back(point_idx);
+            }
+            points.push_back(input_point);
+          }
+        };
+
+    if (target_resolution > 0) {
+      std::vector<PlyPoint> downsampled_points;
+      std::vector<std::vector<int>> downsampled_points_visibility;
+      ReadPointsAtResolution(ply_path,
+                             target_resolution,
+                             &downsampled_points,
+                             &downsampled_points_visibility);
+      points.reserve(downsampled_points.size());
+      AddPoints(downsampled_points, downsampled_points_visibility);
+    } else {
+      const std::vector<std::vector<int>> points_visibility =
+          ReadPointsVisibility(ply_path + ".vis");
+      // Read the points in chunks to avoid holding all PLY points in memory.
+      PlyPointsReader reader(ply_path);
+      THROW_CHECK_EQ(points_visibility.size(), reader.NumPoints());
+      points.reserve(reader.NumPoints());
+      const size_t kChunkSize = 1 << 20;
+      std::vector<PlyPoint> ply_points;
+      while (reader.Read(kChunkSize, &ply_points)) {
+        AddPoints(ply_points, points_visibility);
       }
-      points.push_back(input_point);
     }
   }
 
@@ -331,33 +506,48 @@ class DelaunayMeshingInput {
       }
     }
 
-    std::vector<size_t> point_idxs(points.size());
-    std::iota(point_idxs.begin(), point_idxs.end(), 0);
-    Shuffle(point_idxs.size(), &point_idxs);
+    // Insert the points in a spatially coherent but randomized order (BRIO),
+    // so that each point can be located quickly starting from the cell of the
+    // previously inserted point, while the sub-sampling is not biased towards
+    // the spatial sort order.
+    typedef std::pair<K::Point_3, size_t> PointWithIdx;
+    std::vector<PointWithIdx> sorted_points;
+    sorted_points.reserve(points.size());
+    for (size_t point_idx = 0; point_idx < points.size(); ++point_idx) {
+      sorted_points.emplace_back(EigenToCGAL(points[point_idx].position),
+                                 point_idx);
+    }
+    CGAL::spatial_sort(
+        sorted_points.begin(),
+        sorted_points.end(),
+        CGAL::Spatial_sort_traits_adapter_3<
+            K,
+            CGAL::First_of_pair_property_map<PointWithIdx>>());
 
     Delaunay triangulation;
+    Delaunay::Cell_handle hint_cell;
 
     const float max_squared_proj_dist = max_proj_dist * max_proj_dist;
     const float min_depth_ratio = 1.0f - max_depth_dist;
     const float max_depth_ratio = 1.0f + max_depth_dist;
 
-    for (const auto point_idx : point_idxs) {
+    for (const auto& [point_position, point_idx] : sorted_points) {
       const auto& point = points[point_idx];
       const auto& visible_image_idxs = points_visible_image_idxs[point_idx];
 
-      const K::Point_3 point_position = EigenToCGAL(point.position);
-
       // Insert point into triangulation until there is one cell.
       if (triangulation.number_of_vertices() < 4) {
-        triangulation.insert(point_position);
+        hint_cell = triangulation.insert(point_position)->cell();
         continue;
       }
 
-      const Delaunay::Cell_handle cell = triangulation.locate(point_position);
+      const Delaunay::Cell_handle cell =
+          triangulation.locate(point_position, hint_cell);
+      hint_cell = cell;
 
       // If the point is outside the current hull, then extend the hull.
       if (triangulation.is_infinite(cell)) {
-        triangulation.insert(point_position);
+        hint_cell = triangulation.insert(point_position, cell)->cell();
         continue;
       }
 
@@ -414,7 +604,7 @@ class DelaunayMeshingInput {
       }
 
       if (insert_point) {
-        triangulation.insert(point_position);
+        hint_cell = triangulation.insert(point_position, cell)->cell();
       }
     }
 
@@ -703,10 +893,15 @@ PlyMesh DelaunayMeshing(const DelaunayMeshingOptions& options,
                         const DelaunayMeshingInput& input_data) {
   THROW_CHECK(options.Check());
 
+  Timer timer;
+
   // Create a delaunay triangulation of all input points.
   LOG(INFO) << "Triangulating points...";
+  timer.Start();
   const auto triangulation = input_data.CreateSubSampledDelaunayTriangulation(
       options.max_proj_dist, options.max_depth_dist);
+  LOG(INFO) << StringPrintf("Triangulated points in %.3fs",
+                            timer.ElapsedSeconds());
 
   // Helper class to efficiently trace rays through the triangulation.
   LOG(INFO) << "Initializing ray tracer...";
@@ -734,13 +929,11 @@ PlyMesh DelaunayMeshing(const DelaunayMeshingOptions& options,
   // Spawn threads for parallelized integration of images.
   const int num_threads = GetEffectiveNumThreads(options.num_threads);
   ThreadPool thread_pool(num_threads);
-  JobQueue<CellGraphData> result_queue(num_threads);
 
   // Function that accumulates edge weights in the s-t graph for a single image.
-  auto IntegreateImage = [&](const size_t image_idx) {
-    // Accumulated weights for the current image only.
-    CellGraphData image_cell_graph_data;
-
+  // The weights of a cell are accumulated into the data returned by the given
+  // function, which is only called from the calling thread.
+  auto IntegrateImage = [&](const size_t image_idx, auto&& GetCellData) {
     // Image that is integrated into s-t graph.
     const auto& image = input_data.images[image_idx];
     const K::Point_3 image_position = EigenToCGAL(image.proj_center);
@@ -773,13 +966,12 @@ PlyMesh DelaunayMeshing(const DelaunayMeshingOptions& options,
 
       // Accumulate source weights for cell containing image.
       if (!intersections.empty()) {
-        image_cell_graph_data[intersections.front().facet.first]
-            .source_weight += alpha;
+        GetCellData(intersections.front().facet.first).source_weight += alpha;
       }
 
       // Accumulate edge weights from image to point.
       for (const auto& intersection : intersections) {
-        image_cell_graph_data[intersection.facet.first]
+        GetCellData(intersection.facet.first)
             .edge_weights[intersection.facet.second] +=
             alpha * edge_weight_computer.ComputeDistanceProb(
                         intersection.target_distance_squared);
@@ -815,64 +1007,151 @@ PlyMesh DelaunayMeshing(const DelaunayMeshingOptions& options,
         }
 
         if (behind_neighbor_idx >= 0) {
-          image_cell_graph_data[behind_point_cell]
-              .edge_weights[behind_neighbor_idx] +=
+          GetCellData(behind_point_cell).edge_weights[behind_neighbor_idx] +=
               alpha *
               edge_weight_computer.ComputeDistanceProb(behind_distance_squared);
 
           const auto& inside_cell =
               behind_point_cell->neighbor(behind_neighbor_idx);
-          image_cell_graph_data[inside_cell].sink_weight += alpha;
+          GetCellData(inside_cell).sink_weight += alpha;
         }
       }
     }
+  };
 
-    THROW_CHECK(result_queue.Push(std::move(image_cell_graph_data)));
+  // Accumulates the weights of the source cell data into the target.
+  auto AccumulateCellData = [](const DelaunayCellData& source,
+                               DelaunayCellData* target) {
+    target->sink_weight += source.sink_weight;
+    target->source_weight += source.source_weight;
+    for (size_t j = 0; j < target->edge_weights.size(); ++j) {
+      target->edge_weights[j] += source.edge_weights[j];
+    }
   };
 
-  // Add first batch of images to the thread job queue.
-  size_t image_idx = 0;
-  const size_t init_num_tasks =
-      std::min(input_data.images.size(), 2 * thread_pool.NumThreads());
-  for (; image_idx < init_num_tasks; ++image_idx) {
-    thread_pool.AddTask(IntegreateImage, image_idx);
-  }
+  timer.Restart();
+
+  if (options.parallel_integration) {
+    LOG(INFO) << StringPrintf("Integrating %d images with %d threads...",
+                              input_data.images.size(),
+                              num_threads);
 
-  // Pop the integrated images from the thread job queue and integrate their
-  // accumulated weights into the global graph.
-  for (size_t i = 0; i < input_data.images.size(); ++i) {
-    Timer timer;
-    timer.Start();
-
-    LOG(INFO) << StringPrintf("Integrating image [%d/%d]",
-                              i + 1,
-                              input_data.images.size())
-              << std::flush;
-
-    // Push the next image to the queue.
-    if (image_idx < input_data.images.size()) {
-      thread_pool.AddTask(IntegreateImage, image_idx);
-      image_idx += 1;
+    // Lookup of the global cell data by its index for the reduction.
+    std::vector<DelaunayCellData*> cell_data_by_idx(cell_graph_data.size());
+    for (auto& cell_data : cell_graph_data) {
+      cell_data_by_idx[cell_data.second.index] = &cell_data.second;
+    }
+
+    // Each thread accumulates the weights of all its images into its own
+    // buffer indexed by the cell index, which is allocated on first use.
+    std::vector<std::vector<DelaunayCellData>> thread_cell_data(
+        thread_pool.NumThreads());
+    auto IntegrateImageIntoThreadBuffer = [&](const size_t image_idx) {
+      auto& cell_data = thread_cell_data.at(thread_pool.GetThreadIndex());
+      if (cell_data.empty()) {
+        cell_data.resize(cell_graph_data.size());
+      }
+      IntegrateImage(image_idx,
+                     [&](const Delaunay::Cell_handle& cell)
+                         -> DelaunayCellData& {
+                       return cell_data[cell_graph_data.at(cell).index];
+                     });
+    };
+
+    for (size_t image_idx = 0; image_idx < input_data.images.size();
+         ++image_idx) {
+      thread_pool.AddTask(IntegrateImageIntoThreadBuffer, image_idx);
     }
+    thread_pool.Wait();
 
-    // Pop the next results from the queue.
-    auto result = result_queue.Pop();
-    THROW_CHECK(result.IsValid());
-
-    // Accumulate the weights of the image into the global graph.
-    const auto& image_cell_graph_data = result.Data();
-    for (const auto& image_cell_data : image_cell_graph_data) {
-      auto& cell_data = cell_graph_data.at(image_cell_data.first);
-      cell_data.sink_weight += image_cell_data.second.sink_weight;
-      cell_data.source_weight += image_cell_data.second.source_weight;
-      for (size_t j = 0; j < cell_data.edge_weights.size(); ++j) {
-        cell_data.edge_weights[j] += image_cell_data.second.edge_weights[j];
+    LOG(INFO) << StringPrintf("Integrated images in %.3fs",
+                              timer.ElapsedSeconds());
+    timer.Restart();
+
+    // Reduce the per-thread buffers in parallel over disjoint cell ranges.
+    auto ReduceCellData = [&](const size_t begin_idx, const size_t end_idx) {
+      for (const auto& cell_data : thread_cell_data) {
+        if (cell_data.empty()) {
+          continue;
+        }
+        for (size_t cell_idx = begin_idx; cell_idx < end_idx; ++cell_idx) {
+          AccumulateCellData(cell_data[cell_idx], cell_data_by_idx[cell_idx]);
+        }
       }
+    };
+
+    const size_t num_cells = cell_data_by_idx.size();
+    const size_t num_cells_per_task =
+        (num_cells + thread_pool.NumThreads() - 1) / thread_pool.NumThreads();
+    for (size_t begin_idx = 0; begin_idx < num_cells;
+         begin_idx += num_cells_per_task) {
+      thread_pool.AddTask(ReduceCellData,
+                          begin_idx,
+                          std::min(begin_idx + num_cells_per_task, num_cells));
     }
+    thread_pool.Wait();
+
+    LOG(INFO) << StringPrintf("Reduced visibility weights in %.3fs",
+                              timer.ElapsedSeconds());
+  } else {
+    JobQueue<CellGraphData> result_queue(num_threads);
+
+    auto IntegrateImageIntoQueue = [&](const size_t image_idx) {
+      // Accumulated weights for the current image only.
+      CellGraphData image_cell_graph_data;
+      IntegrateImage(image_idx,
+                     [&](const Delaunay::Cell_handle& cell)
+                         -> DelaunayCellData& {
+                       return image_cell_graph_data[cell];
+                     });
+      THROW_CHECK(result_queue.Push(std::move(image_cell_graph_data)));
+    };
+
+    // Add first batch of images to the thread job queue.
+    size_t image_idx = 0;
+    const size_t init_num_tasks =
+        std::min(input_data.images.size(), 2 * thread_pool.NumThreads());
+    for (; image_idx < init_num_tasks; ++image_idx) {
+      thread_pool.AddTask(IntegrateImageIntoQueue, image_idx);
+    }
+
+    // Pop the integrated images from the thread job queue and integrate their
+    // accumulated weights into the global graph.
+    for (size_t i = 0; i < input_data.images.size(); ++i) {
+      Timer image_timer;
+      image_timer.Start();
+
+      LOG(INFO) << StringPrintf("Integrating image [%d/%d]",
+                                i + 1,
+                                input_data.images.size())
+                << std::flush;
+
+      // Push the next image to the queue.
+      if (image_idx < input_data.images.size()) {
+        thread_pool.AddTask(IntegrateImageIntoQueue, image_idx);
+        image_idx += 1;
+      }
 
-    LOG(INFO) << StringPrintf(" in %.3fs", timer.ElapsedSeconds());
+      // Pop the next results from the queue.
+      auto result = result_queue.Pop();
+      THROW_CHECK(result.IsValid());
+
+      // Accumulate the weights of the image into the global graph.
+      const auto& image_cell_graph_data = result.Data();
+      for (const auto& image_cell_data : image_cell_graph_data) {
+        AccumulateCellData(image_cell_data.second,
+                           &cell_graph_data.at(image_cell_data.first));
+      }
+
+      LOG(INFO) << StringPrintf(" in %.3fs", image_timer.ElapsedSeconds());
+    }
+
+    LOG(INFO) << StringPrintf("Integrated images in %.3fs",
+                              timer.ElapsedSeconds());
   }
 
+  timer.Restart();
+
   // Setup the min-cut (max-flow) graph optimization.
 
   LOG(INFO) << "Setting up optimization...";
@@ -928,6 +1207,9 @@ PlyMesh DelaunayMeshing(const DelaunayMeshingOptions& options,
   LOG(INFO) << "Running graph-cut optimization...";
   graph_cut.Compute();
 
+  LOG(INFO) << StringPrintf("Optimized graph-cut in %.3fs",
+                            timer.ElapsedSeconds());
+
   LOG(INFO) << "Extracting surface as min-cut...";
 
   std::unordered_set<Delaunay::Vertex_handle> surface_vertices;
@@ -1016,6 +1298,14 @@ PlyMesh DelaunayMeshing(const DelaunayMeshingOptions& options,
   return mesh;
 }
 
+PlyMesh SimplifyDelaunayMesh(const DelaunayMeshingOptions& options,
+                             const PlyMesh& mesh) {
+  MeshSimplificationOptions simplification_options;
+  simplification_options.target_face_ratio = options.simplify_face_ratio;
+  simplification_options.num_threads = options.num_threads;
+  return SimplifyMesh(mesh, simplification_options);
+}
+
 void SparseDelaunayMeshing(const DelaunayMeshingOptions& options,
                            const std::string& input_path,
                            const std::string& output_path) {
@@ -1023,9 +1313,12 @@ void SparseDelaunayMeshing(const DelaunayMeshingOptions& options,
   timer.Start();
 
   DelaunayMeshingInput input_data;
-  input_data.ReadSparseReconstruction(input_path);
+  input_data.ReadSparseReconstruction(input_path, options.target_resolution);
 
-  const auto mesh = DelaunayMeshing(options, input_data);
+  PlyMesh mesh = DelaunayMeshing(options, input_data);
+  if (options.simplify_face_ratio < 1) {
+    mesh = SimplifyDelaunayMesh(options, mesh);
+  }
 
   LOG(INFO) << "Writing surface mesh...";
   WriteBinaryPlyMesh(output_path, mesh);
@@ -1040,9 +1333,12 @@ void DenseDelaunayMeshing(const DelaunayMeshingOptions& options,
   timer.Start();
 
   DelaunayMeshingInput input_data;
-  input_data.ReadDenseReconstruction(input_path);
+  input_data.ReadDenseReconstruction(input_path, options.target_resolution);
 
-  const auto mesh = DelaunayMeshing(options, input_data);
+  PlyMesh mesh = DelaunayMeshing(options, input_data);
+  if (options.simplify_face_ratio < 1) {
+    mesh = SimplifyDelaunayMesh(options, mesh);
+  }
 
   LOG(INFO) << "Writing surface mesh...";
   WriteBinaryPlyMesh(output_path, mesh);
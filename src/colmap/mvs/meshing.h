@@ -61,6 +61,18 @@ struct PoissonMeshingOptions {
   // The number of threads used for the Poisson reconstruction.
   int num_threads = -1;
 
+  // If positive, the input points are reduced to this resolution in scene units
+  // before reconstruction, which reduces the run time and memory for large
+  // point clouds. If an octree built by point_octree_builder from the current
+  // input exists at <input_path>.octree, its level of detail for the
+  // resolution is used. Otherwise, the input points are averaged on a voxel
+  // grid.
+  double target_resolution = 0.0;
+
+  // If smaller than 1, the trimmed mesh is simplified by quadric edge
+  // collapses to this ratio of its number of faces.
+  double simplify_face_ratio = 1.0;
+
   bool Check() const;
 };
 
@@ -96,6 +108,25 @@ struct DelaunayMeshingOptions {
   // The number of threads to use for reconstruction. Default is all threads.
   int num_threads = -1;
 
+  // If positive, the input points are reduced to this resolution in scene units
+  // before triangulation, where the visibility of merged points is combined.
+  // For dense meshing, the level of detail for the resolution of the octree
+  // at fused.ply.octree is used, if it was built by point_octree_builder with
+  // visibility from the current fused.ply. Otherwise, the input points are
+  // averaged on a voxel grid.
+  double target_resolution = 0.0;
+
+  // Whether to accumulate the visibility weights of all viewing rays in
+  // per-thread buffers over all Delaunay cells, which are reduced in parallel
+  // after ray casting. This avoids the serial merging of per-image weights but
+  // requires additional memory proportional to the number of threads times
+  // the number of cells.
+  bool parallel_integration = false;
+
+  // If smaller than 1, the extracted surface mesh is simplified by quadric
+  // edge collapses to this ratio of its number of faces before it is written.
+  double simplify_face_ratio = 1.0;
+
   bool Check() const;
 };
 
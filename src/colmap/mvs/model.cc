@@ -34,10 +34,191 @@
 #include "colmap/scene/projection.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/sensor/models.h"
+#include "colmap/util/endian.h"
 #include "colmap/util/file.h"
+#include "colmap/util/threading.h"
+#include "colmap/util/timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <tuple>
 
 namespace colmap {
 namespace mvs {
+namespace {
+
+constexpr char kImageOverlapsMagic[8] = {
+    'C', 'O', 'L', 'M', 'A', 'P', 'I', 'O'};
+constexpr uint32_t kImageOverlapsVersion = 1;
+constexpr uint64_t kImageOverlapsHeaderSize =
+    sizeof(kImageOverlapsMagic) + sizeof(uint32_t) + sizeof(uint64_t) +
+    sizeof(float) + 2 * sizeof(uint64_t);
+
+// Accumulate the 64-bit FNV-1a hash of the given bytes.
+void HashBytes(const void* data, const size_t num_bytes, uint64_t* hash) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < num_bytes; ++i) {
+    *hash ^= bytes[i];
+    *hash *= 1099511628211ull;
+  }
+}
+
+// Interpolated percentile of sorted values, equivalent to Percentile.
+float SortedPercentile(const float* values,
+                       const size_t num_values,
+                       const float percentile) {
+  const double idx = percentile / 100. * (num_values - 1);
+  const size_t left_idx = static_cast<size_t>(std::floor(idx));
+  const size_t right_idx = static_cast<size_t>(std::ceil(idx));
+  if (left_idx == right_idx) {
+    return values[right_idx];
+  }
+  return (right_idx - idx) * values[left_idx] +
+         (idx - left_idx) * values[right_idx];
+}
+
+// Run the function on consecutive chunks of the range [0, num_elems) using
+// one chunk per thread, where the chunk index is passed to the function.
+template <typename Func>
+void ParallelForChunks(ThreadPool* thread_pool,
+                       const size_t num_elems,
+                       const Func& func) {
+  const size_t num_chunks = thread_pool->NumThreads();
+  for (size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+    const size_t begin = chunk_idx * num_elems / num_chunks;
+    const size_t end = (chunk_idx + 1) * num_elems / num_chunks;
+    thread_pool->AddTask([&func, chunk_idx, begin, end]() {
+      func(chunk_idx, begin, end);
+    });
+  }
+  thread_pool->Wait();
+}
+
+}  // namespace
+
+std::vector<int> ImageOverlaps::GetMaxOverlappingImages(
+    const int image_idx,
+    const size_t num_images,
+    const double min_triangulation_angle) const {
+  THROW_CHECK_GE(image_idx, 0);
+  THROW_CHECK_LT(static_cast<size_t>(image_idx), NumImages());
+
+  std::vector<std::pair<int, int>> ordered_images;
+  ordered_images.reserve(offsets[image_idx + 1] - offsets[image_idx]);
+  for (size_t i = offsets[image_idx]; i < offsets[image_idx + 1]; ++i) {
+    if (triangulation_angles[i] >= min_triangulation_angle) {
+      ordered_images.emplace_back(image_idxs[i], num_shared_points[i]);
+    }
+  }
+
+  // Sort by decreasing number of shared points and break ties by image index
+  // for deterministic results.
+  const size_t eff_num_images = std::min(ordered_images.size(), num_images);
+  std::partial_sort(
+      ordered_images.begin(),
+      ordered_images.begin() + eff_num_images,
+      ordered_images.end(),
+      [](const std::pair<int, int>& image1, const std::pair<int, int>& image2) {
+        return image1.second > image2.second ||
+               (image1.second == image2.second && image1.first < image2.first);
+      });
+
+  std::vector<int> overlapping_images;
+  overlapping_images.reserve(eff_num_images);
+  for (size_t i = 0; i < eff_num_images; ++i) {
+    overlapping_images.push_back(ordered_images[i].first);
+  }
+  return overlapping_images;
+}
+
+bool ImageOverlaps::Read(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  char magic[sizeof(kImageOverlapsMagic)];
+  file.read(magic, sizeof(magic));
+  if (file.gcount() != sizeof(magic) ||
+      std::memcmp(magic, kImageOverlapsMagic, sizeof(magic)) != 0) {
+    return false;
+  }
+
+  const uint32_t version = ReadBinaryLittleEndian<uint32_t>(&file);
+  const uint64_t read_model_hash = ReadBinaryLittleEndian<uint64_t>(&file);
+  const float read_percentile = ReadBinaryLittleEndian<float>(&file);
+  const uint64_t num_images = ReadBinaryLittleEndian<uint64_t>(&file);
+  const uint64_t num_overlaps = ReadBinaryLittleEndian<uint64_t>(&file);
+  if (!file.good() || version != kImageOverlapsVersion) {
+    return false;
+  }
+
+  // Validate the counts against the file size before allocating any memory.
+  const uint64_t file_num_bytes = GetFileSize(path);
+  if (file_num_bytes < kImageOverlapsHeaderSize) {
+    return false;
+  }
+  const uint64_t num_data_bytes = file_num_bytes - kImageOverlapsHeaderSize;
+  constexpr uint64_t kNumBytesPerOverlap = 2 * sizeof(int) + sizeof(float);
+  if (num_images >= num_data_bytes / sizeof(uint64_t) ||
+      num_overlaps > num_data_bytes / kNumBytesPerOverlap ||
+      num_data_bytes != (num_images + 1) * sizeof(uint64_t) +
+                            num_overlaps * kNumBytesPerOverlap) {
+    return false;
+  }
+
+  std::vector<uint64_t> offsets_uint64(num_images + 1);
+  ReadBinaryLittleEndian<uint64_t>(&file, &offsets_uint64);
+  std::vector<int> read_image_idxs(num_overlaps);
+  ReadBinaryLittleEndian<int>(&file, &read_image_idxs);
+  std::vector<int> read_num_shared_points(num_overlaps);
+  ReadBinaryLittleEndian<int>(&file, &read_num_shared_points);
+  std::vector<float> read_triangulation_angles(num_overlaps);
+  ReadBinaryLittleEndian<float>(&file, &read_triangulation_angles);
+  if (!file.good() || offsets_uint64.front() != 0 ||
+      offsets_uint64.back() != num_overlaps ||
+      !std::is_sorted(offsets_uint64.begin(), offsets_uint64.end())) {
+    return false;
+  }
+  for (const int image_idx : read_image_idxs) {
+    if (image_idx < 0 || static_cast<uint64_t>(image_idx) >= num_images) {
+      return false;
+    }
+  }
+
+  model_hash = read_model_hash;
+  triangulation_angle_percentile = read_percentile;
+  offsets.assign(offsets_uint64.begin(), offsets_uint64.end());
+  image_idxs = std::move(read_image_idxs);
+  num_shared_points = std::move(read_num_shared_points);
+  triangulation_angles = std::move(read_triangulation_angles);
+  return true;
+}
+
+bool ImageOverlaps::Write(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  file.write(kImageOverlapsMagic, sizeof(kImageOverlapsMagic));
+  WriteBinaryLittleEndian<uint32_t>(&file, kImageOverlapsVersion);
+  WriteBinaryLittleEndian<uint64_t>(&file, model_hash);
+  WriteBinaryLittleEndian<float>(&file, triangulation_angle_percentile);
+  WriteBinaryLittleEndian<uint64_t>(&file, NumImages());
+  WriteBinaryLittleEndian<uint64_t>(&file, NumOverlaps());
+  for (const size_t offset : offsets) {
+    WriteBinaryLittleEndian<uint64_t>(&file, offset);
+  }
+  WriteBinaryLittleEndian<int>(&file, {image_idxs.data(), image_idxs.size()});
+  WriteBinaryLittleEndian<int>(
+      &file, {num_shared_points.data(), num_shared_points.size()});
+  WriteBinaryLittleEndian<float>(
+      &file, {triangulation_angles.data(), triangulation_angles.size()});
+  file.close();
+  return file.good();
+}
 
 void Model::Read(const std::string& path, const std::string& format) {
   auto format_lower_case = format;
@@ -114,53 +295,22 @@ std::string Model::GetImageName(const int image_idx) const {
 }
 
 std::vector<std::vector<int>> Model::GetMaxOverlappingImages(
-    const size_t num_images, const double min_triangulation_angle) const {
-  std::vector<std::vector<int>> overlapping_images(images.size());
-
-  const float min_triangulation_angle_rad = DegToRad(min_triangulation_angle);
-
-  const auto shared_num_points = ComputeSharedPoints();
-
+    const size_t num_images,
+    const double min_triangulation_angle,
+    const std::string& cache_path) const {
   const float kTriangulationAnglePercentile = 75;
-  const auto triangulation_angles =
-      ComputeTriangulationAngles(kTriangulationAnglePercentile);
+  const ImageOverlaps image_overlaps =
+      cache_path.empty()
+          ? ComputeImageOverlaps(kTriangulationAnglePercentile)
+          : ReadOrComputeImageOverlaps(cache_path,
+                                       kTriangulationAnglePercentile);
 
-  for (size_t image_idx = 0; image_idx < images.size(); ++image_idx) {
-    const auto& shared_images = shared_num_points.at(image_idx);
-    const auto& overlapping_triangulation_angles =
-        triangulation_angles.at(image_idx);
-
-    std::vector<std::pair<int, int>> ordered_images;
-    ordered_images.reserve(shared_images.size());
-    for (const auto& image : shared_images) {
-      if (overlapping_triangulation_angles.at(image.first) >=
-          min_triangulation_angle_rad) {
-        ordered_images.emplace_back(image.first, image.second);
-      }
-    }
+  const double min_triangulation_angle_rad = DegToRad(min_triangulation_angle);
 
-    const size_t eff_num_images = std::min(ordered_images.size(), num_images);
-    if (eff_num_images < shared_images.size()) {
-      std::partial_sort(ordered_images.begin(),
-                        ordered_images.begin() + eff_num_images,
-                        ordered_images.end(),
-                        [](const std::pair<int, int> image1,
-                           const std::pair<int, int> image2) {
-                          return image1.second > image2.second;
-                        });
-    } else {
-      std::sort(ordered_images.begin(),
-                ordered_images.end(),
-                [](const std::pair<int, int> image1,
-                   const std::pair<int, int> image2) {
-                  return image1.second > image2.second;
-                });
-    }
-
-    overlapping_images[image_idx].reserve(eff_num_images);
-    for (size_t i = 0; i < eff_num_images; ++i) {
-      overlapping_images[image_idx].push_back(ordered_images[i].first);
-    }
+  std::vector<std::vector<int>> overlapping_images(images.size());
+  for (size_t image_idx = 0; image_idx < images.size(); ++image_idx) {
+    overlapping_images[image_idx] = image_overlaps.GetMaxOverlappingImages(
+        image_idx, num_images, min_triangulation_angle_rad);
   }
 
   return overlapping_images;
@@ -213,62 +363,295 @@ std::vector<std::pair<float, float>> Model::ComputeDepthRanges() const {
   return depth_ranges;
 }
 
-std::vector<std::map<int, int>> Model::ComputeSharedPoints() const {
-  std::vector<std::map<int, int>> shared_points(images.size());
-  for (const auto& point : points) {
-    for (size_t i = 0; i < point.track.size(); ++i) {
-      const int image_idx1 = point.track[i];
-      for (size_t j = 0; j < i; ++j) {
-        const int image_idx2 = point.track[j];
-        if (image_idx1 != image_idx2) {
-          shared_points.at(image_idx1)[image_idx2] += 1;
-          shared_points.at(image_idx2)[image_idx1] += 1;
-        }
-      }
-    }
-  }
-  return shared_points;
-}
+ImageOverlaps Model::ComputeImageOverlaps(const float percentile,
+                                          const int num_threads) const {
+  THROW_CHECK_GE(percentile, 0);
+  THROW_CHECK_LE(percentile, 100);
 
-std::vector<std::map<int, float>> Model::ComputeTriangulationAngles(
-    const float percentile) const {
-  std::vector<Eigen::Vector3d> proj_centers(images.size());
-  for (size_t image_idx = 0; image_idx < images.size(); ++image_idx) {
+  Timer timer;
+  timer.Start();
+
+  const size_t num_images = images.size();
+
+  std::vector<Eigen::Vector3d> proj_centers(num_images);
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
     const auto& image = images[image_idx];
     Eigen::Vector3f C;
     ComputeProjectionCenter(image.GetR(), image.GetT(), C.data());
     proj_centers[image_idx] = C.cast<double>();
   }
 
-  std::vector<std::map<int, std::vector<float>>> all_triangulation_angles(
-      images.size());
-  for (const auto& point : points) {
-    for (size_t i = 0; i < point.track.size(); ++i) {
-      const int image_idx1 = point.track[i];
-      for (size_t j = 0; j < i; ++j) {
-        const int image_idx2 = point.track[j];
-        if (image_idx1 != image_idx2) {
-          const float angle = CalculateTriangulationAngle(
-              proj_centers.at(image_idx1),
-              proj_centers.at(image_idx2),
-              Eigen::Vector3d(point.x, point.y, point.z));
-          all_triangulation_angles.at(image_idx1)[image_idx2].push_back(angle);
-          all_triangulation_angles.at(image_idx2)[image_idx1].push_back(angle);
+  ThreadPool thread_pool(GetEffectiveNumThreads(num_threads));
+  const size_t num_chunks = thread_pool.NumThreads();
+
+  // Each pair of images in a track is observed once by the image with the
+  // smaller index. First, count the observations per chunk of points and
+  // image, so that every chunk can write its observations into a disjoint
+  // range of a contiguous array without synchronization.
+  std::vector<std::vector<size_t>> chunk_offsets(
+      num_chunks, std::vector<size_t>(num_images, 0));
+  ParallelForChunks(
+      &thread_pool,
+      points.size(),
+      [&](const size_t chunk_idx, const size_t begin, const size_t end) {
+        auto& num_observations = chunk_offsets[chunk_idx];
+        for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+          const auto& track = points[point_idx].track;
+          for (size_t i = 0; i < track.size(); ++i) {
+            for (size_t j = 0; j < i; ++j) {
+              if (track[i] != track[j]) {
+                num_observations[std::min(track[i], track[j])] += 1;
+              }
+            }
+          }
         }
-      }
+      });
+
+  std::vector<size_t> observation_offsets(num_images + 1, 0);
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
+    size_t offset = observation_offsets[image_idx];
+    for (size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+      const size_t num_observations = chunk_offsets[chunk_idx][image_idx];
+      chunk_offsets[chunk_idx][image_idx] = offset;
+      offset += num_observations;
     }
+    observation_offsets[image_idx + 1] = offset;
   }
 
-  std::vector<std::map<int, float>> triangulation_angles(images.size());
-  for (size_t image_idx = 0; image_idx < all_triangulation_angles.size();
-       ++image_idx) {
-    auto& overlapping_images = all_triangulation_angles[image_idx];
-    for (auto& image : overlapping_images) {
-      triangulation_angles[image_idx].emplace(
-          image.first, Percentile(image.second, percentile));
+  struct PairObservation {
+    int image_idx2;
+    float triangulation_angle;
+  };
+
+  std::vector<PairObservation> observations(observation_offsets.back());
+  ParallelForChunks(
+      &thread_pool,
+      points.size(),
+      [&](const size_t chunk_idx, const size_t begin, const size_t end) {
+        auto& next_observation_idxs = chunk_offsets[chunk_idx];
+        for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+          const auto& point = points[point_idx];
+          const Eigen::Vector3d xyz(point.x, point.y, point.z);
+          for (size_t i = 0; i < point.track.size(); ++i) {
+            for (size_t j = 0; j < i; ++j) {
+              const int image_idx1 = std::min(point.track[i], point.track[j]);
+              const int image_idx2 = std::max(point.track[i], point.track[j]);
+              if (image_idx1 != image_idx2) {
+                auto& observation =
+                    observations[next_observation_idxs[image_idx1]++];
+                observation.image_idx2 = image_idx2;
+                observation.triangulation_angle = CalculateTriangulationAngle(
+                    proj_centers[image_idx1], proj_centers[image_idx2], xyz);
+              }
+            }
+          }
+        }
+      });
+  std::vector<std::vector<size_t>>().swap(chunk_offsets);
+
+  // Sort the observations of every image by the other image and their angle
+  // and count the unique pairs of images.
+  std::vector<size_t> num_pairs(num_images, 0);
+  ParallelForChunks(
+      &thread_pool,
+      num_images,
+      [&](const size_t /*chunk_idx*/, const size_t begin, const size_t end) {
+        for (size_t image_idx = begin; image_idx < end; ++image_idx) {
+          PairObservation* image_observations =
+              observations.data() + observation_offsets[image_idx];
+          const size_t num_image_observations =
+              observation_offsets[image_idx + 1] -
+              observation_offsets[image_idx];
+          std::sort(image_observations,
+                    image_observations + num_image_observations,
+                    [](const PairObservation& observation1,
+                       const PairObservation& observation2) {
+                      return std::tie(observation1.image_idx2,
+                                      observation1.triangulation_angle) <
+                             std::tie(observation2.image_idx2,
+                                      observation2.triangulation_angle);
+                    });
+          for (size_t i = 0; i < num_image_observations; ++i) {
+            if (i == 0 || image_observations[i].image_idx2 !=
+                              image_observations[i - 1].image_idx2) {
+              ++num_pairs[image_idx];
+            }
+          }
+        }
+      });
+
+  std::vector<size_t> pair_offsets(num_images + 1, 0);
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
+    pair_offsets[image_idx + 1] =
+        pair_offsets[image_idx] + num_pairs[image_idx];
+  }
+
+  // Reduce the sorted observations in-place to the unique pairs of images.
+  std::vector<int> pair_num_shared_points(pair_offsets.back());
+  ParallelForChunks(
+      &thread_pool,
+      num_images,
+      [&](const size_t /*chunk_idx*/, const size_t begin, const size_t end) {
+        std::vector<float> angles;
+        for (size_t image_idx = begin; image_idx < end; ++image_idx) {
+          PairObservation* image_observations =
+              observations.data() + observation_offsets[image_idx];
+          const size_t num_image_observations =
+              observation_offsets[image_idx + 1] -
+              observation_offsets[image_idx];
+          size_t pair_idx = 0;
+          for (size_t i = 0; i < num_image_observations;) {
+            size_t j = i;
+            angles.clear();
+            while (j < num_image_observations &&
+                   image_observations[j].image_idx2 ==
+                       image_observations[i].image_idx2) {
+              angles.push_back(image_observations[j].triangulation_angle);
+              ++j;
+            }
+            image_observations[pair_idx].image_idx2 =
+                image_observations[i].image_idx2;
+            image_observations[pair_idx].triangulation_angle =
+                SortedPercentile(angles.data(), angles.size(), percentile);
+            pair_num_shared_points[pair_offsets[image_idx] + pair_idx] = j - i;
+            ++pair_idx;
+            i = j;
+          }
+        }
+      });
+
+  // Symmetrize the pairs into the overlaps of both images. Processing the
+  // images in increasing order inserts the overlapping images with smaller
+  // indices before those with larger indices, such that they remain sorted.
+  ImageOverlaps image_overlaps;
+  image_overlaps.triangulation_angle_percentile = percentile;
+  image_overlaps.model_hash = ComputeHash();
+  image_overlaps.offsets.resize(num_images + 1, 0);
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
+    image_overlaps.offsets[image_idx + 1] += num_pairs[image_idx];
+    for (size_t i = 0; i < num_pairs[image_idx]; ++i) {
+      const int image_idx2 =
+          observations[observation_offsets[image_idx] + i].image_idx2;
+      image_overlaps.offsets[image_idx2 + 1] += 1;
+    }
+  }
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
+    image_overlaps.offsets[image_idx + 1] += image_overlaps.offsets[image_idx];
+  }
+
+  const size_t num_overlaps = image_overlaps.offsets.back();
+  image_overlaps.image_idxs.resize(num_overlaps);
+  image_overlaps.num_shared_points.resize(num_overlaps);
+  image_overlaps.triangulation_angles.resize(num_overlaps);
+  std::vector<size_t> next_overlap_idxs(image_overlaps.offsets.begin(),
+                                        image_overlaps.offsets.end() - 1);
+  auto AddOverlap = [&](const int image_idx1,
+                        const int image_idx2,
+                        const int num_shared_points,
+                        const float triangulation_angle) {
+    const size_t overlap_idx = next_overlap_idxs[image_idx1]++;
+    image_overlaps.image_idxs[overlap_idx] = image_idx2;
+    image_overlaps.num_shared_points[overlap_idx] = num_shared_points;
+    image_overlaps.triangulation_angles[overlap_idx] = triangulation_angle;
+  };
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
+    for (size_t i = 0; i < num_pairs[image_idx]; ++i) {
+      const auto& pair = observations[observation_offsets[image_idx] + i];
+      const int num_shared_points =
+          pair_num_shared_points[pair_offsets[image_idx] + i];
+      AddOverlap(image_idx,
+                 pair.image_idx2,
+                 num_shared_points,
+                 pair.triangulation_angle);
+      AddOverlap(pair.image_idx2,
+                 image_idx,
+                 num_shared_points,
+                 pair.triangulation_angle);
     }
   }
 
+  VLOG(2) << StringPrintf("Computed %d image overlaps in %.3fs",
+                          num_overlaps,
+                          timer.ElapsedSeconds());
+
+  return image_overlaps;
+}
+
+ImageOverlaps Model::ReadOrComputeImageOverlaps(const std::string& cache_path,
+                                                const float percentile,
+                                                const int num_threads) const {
+  const uint64_t model_hash = ComputeHash();
+  if (ExistsFile(cache_path)) {
+    ImageOverlaps image_overlaps;
+    if (image_overlaps.Read(cache_path) &&
+        image_overlaps.model_hash == model_hash &&
+        image_overlaps.triangulation_angle_percentile == percentile &&
+        image_overlaps.NumImages() == images.size()) {
+      LOG(INFO) << "Read image overlaps from " << cache_path;
+      return image_overlaps;
+    }
+    LOG(INFO) << "Recomputing invalid or stale image overlaps in "
+              << cache_path;
+  }
+
+  const ImageOverlaps image_overlaps =
+      ComputeImageOverlaps(percentile, num_threads);
+  if (!image_overlaps.Write(cache_path)) {
+    LOG(WARNING) << "Failed to write image overlaps to " << cache_path;
+  }
+  return image_overlaps;
+}
+
+uint64_t Model::ComputeHash() const {
+  uint64_t hash = 14695981039346656037ull;
+  const uint64_t num_images = images.size();
+  HashBytes(&num_images, sizeof(num_images), &hash);
+  for (const auto& image : images) {
+    HashBytes(image.GetR(), 9 * sizeof(float), &hash);
+    HashBytes(image.GetT(), 3 * sizeof(float), &hash);
+  }
+  const uint64_t num_points = points.size();
+  HashBytes(&num_points, sizeof(num_points), &hash);
+  for (const auto& point : points) {
+    const float xyz[3] = {point.x, point.y, point.z};
+    HashBytes(xyz, sizeof(xyz), &hash);
+    const uint64_t track_length = point.track.size();
+    HashBytes(&track_length, sizeof(track_length), &hash);
+    HashBytes(point.track.data(), point.track.size() * sizeof(int), &hash);
+  }
+  return hash;
+}
+
+std::vector<std::map<int, int>> Model::ComputeSharedPoints() const {
+  const ImageOverlaps image_overlaps = ComputeImageOverlaps();
+  std::vector<std::map<int, int>> shared_points(images.size());
+  for (size_t image_idx = 0; image_idx < images.size(); ++image_idx) {
+    for (size_t i = image_overlaps.offsets[image_idx];
+         i < image_overlaps.offsets[image_idx + 1];
+         ++i) {
+      shared_points[image_idx].emplace_hint(
+          shared_points[image_idx].end(),
+          image_overlaps.image_idxs[i],
+          image_overlaps.num_shared_points[i]);
+    }
+  }
+  return shared_points;
+}
+
+std::vector<std::map<int, float>> Model::ComputeTriangulationAngles(
+    const float percentile) const {
+  const ImageOverlaps image_overlaps = ComputeImageOverlaps(percentile);
+  std::vector<std::map<int, float>> triangulation_angles(images.size());
+  for (size_t image_idx = 0; image_idx < images.size(); ++image_idx) {
+    for (size_t i = image_overlaps.offsets[image_idx];
+         i < image_overlaps.offsets[image_idx + 1];
+         ++i) {
+      triangulation_angles[image_idx].emplace_hint(
+          triangulation_angles[image_idx].end(),
+          image_overlaps.image_idxs[i],
+          image_overlaps.triangulation_angles[i]);
+    }
+  }
   return triangulation_angles;
 }
 
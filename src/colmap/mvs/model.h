@@ -44,6 +44,52 @@
 namespace colmap {
 namespace mvs {
 
+// Number of shared points and robust triangulation angle for all pairs of
+// overlapping images in compressed sparse row format. The overlapping images
+// of the i-th image are stored in the range [offsets[i], offsets[i + 1]) of
+// the per-overlap arrays and are sorted by their image index.
+// Sparse image overlaps, where the overlapping images of image i are stored in
+// the range [offsets[i], offsets[i + 1]) of the other arrays. The binary cache
+// file has the layout:
+//
+//    <magic : char[8] = "COLMAPIO">
+//    <version : uint32>
+//    <model_hash : uint64>
+//    <triangulation_angle_percentile : float32>
+//    <num_images : uint64>
+//    <num_overlaps : uint64>
+//    <offsets : uint64[num_images + 1]>
+//    <image_idxs : int32[num_overlaps]>
+//    <num_shared_points : int32[num_overlaps]>
+//    <triangulation_angles : float32[num_overlaps]>
+//
+// All values are stored in little endian.
+struct ImageOverlaps {
+  std::vector<size_t> offsets;
+  std::vector<int> image_idxs;
+  std::vector<int> num_shared_points;
+  std::vector<float> triangulation_angles;
+
+  // The percentile of the triangulation angles of the shared points and the
+  // hash of the model, for which the overlaps were computed.
+  float triangulation_angle_percentile = 0;
+  uint64_t model_hash = 0;
+
+  inline size_t NumImages() const;
+  inline size_t NumOverlaps() const;
+
+  // Determine the maximally overlapping images of the given image, sorted by
+  // the number of shared points, subject to a minimum triangulation angle.
+  std::vector<int> GetMaxOverlappingImages(
+      int image_idx, size_t num_images, double min_triangulation_angle) const;
+
+  // Returns false if the file does not exist, has an unsupported version, or
+  // is truncated or otherwise inconsistent.
+  bool Read(const std::string& path);
+  // Returns false if the file could not be written.
+  bool Write(const std::string& path) const;
+};
+
 // Simple sparse model class.
 struct Model {
   struct Point {
@@ -67,8 +113,12 @@ struct Model {
   // For each image, determine the maximally overlapping images, sorted based on
   // the number of shared points subject to a minimum robust average
   // triangulation angle of the points.
+  // If the cache path is not empty, the image overlaps are read from or
+  // written to the cache, see ReadOrComputeImageOverlaps.
   std::vector<std::vector<int>> GetMaxOverlappingImages(
-      size_t num_images, double min_triangulation_angle) const;
+      size_t num_images,
+      double min_triangulation_angle,
+      const std::string& cache_path = "") const;
 
   // Get the overlapping images defined in the vis.dat file.
   const std::vector<std::vector<int>>& GetMaxOverlappingImagesFromPMVS() const;
@@ -76,6 +126,24 @@ struct Model {
   // Compute the robust minimum and maximum depths from the sparse point cloud.
   std::vector<std::pair<float, float>> ComputeDepthRanges() const;
 
+  // Compute the number of shared points and the percentile of the
+  // triangulation angles of the shared points between all overlapping images.
+  // The pairwise observations are accumulated in parallel into a sorted sparse
+  // structure, which avoids per-image maps for large models.
+  ImageOverlaps ComputeImageOverlaps(float percentile = 50,
+                                     int num_threads = -1) const;
+
+  // Read the image overlaps from the cache file, if it is valid and was
+  // computed for the same model and percentile, and otherwise compute the
+  // overlaps and try to write them to the cache file. Failing to write the
+  // cache, e.g., in a read-only workspace, only logs a warning.
+  ImageOverlaps ReadOrComputeImageOverlaps(const std::string& cache_path,
+                                           float percentile = 50,
+                                           int num_threads = -1) const;
+
+  // Hash of the image poses and the point positions and tracks.
+  uint64_t ComputeHash() const;
+
   // Compute the number of shared points between all overlapping images.
   std::vector<std::map<int, int>> ComputeSharedPoints() const;
 
@@ -101,5 +169,15 @@ struct Model {
   std::vector<std::vector<int>> pmvs_vis_dat_;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+size_t ImageOverlaps::NumImages() const {
+  return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+size_t ImageOverlaps::NumOverlaps() const { return image_idxs.size(); }
+
 }  // namespace mvs
 }  // namespace colmap
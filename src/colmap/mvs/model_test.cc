@@ -0,0 +1,228 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/model.h"
+
+#include "colmap/geometry/triangulation.h"
+#include "colmap/math/math.h"
+#include "colmap/util/endian.h"
+#include "colmap/util/file.h"
+#include "colmap/util/testing.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+// Cameras on a circle around the origin observing random points, where every
+// point is observed by a random subset of the images.
+Model CreateModel(const int num_images, const int num_points) {
+  Model model;
+  const float K[9] = {100, 0, 50, 0, 100, 50, 0, 0, 1};
+  for (int image_idx = 0; image_idx < num_images; ++image_idx) {
+    const double angle = 2 * M_PI * image_idx / num_images;
+    const Eigen::Matrix<float, 3, 3, Eigen::RowMajor> R =
+        Eigen::AngleAxisf(angle, Eigen::Vector3f::UnitY()).toRotationMatrix();
+    const Eigen::Vector3f T(0, 0, 10);
+    model.images.emplace_back("", 100, 100, K, R.data(), T.data());
+  }
+
+  std::srand(0);
+  for (int point_idx = 0; point_idx < num_points; ++point_idx) {
+    Model::Point point;
+    const Eigen::Vector3f xyz = Eigen::Vector3f::Random();
+    point.x = xyz.x();
+    point.y = xyz.y();
+    point.z = xyz.z();
+    for (int image_idx = 0; image_idx < num_images; ++image_idx) {
+      if (std::rand() % 3 == 0) {
+        point.track.push_back(image_idx);
+      }
+    }
+    model.points.push_back(point);
+  }
+
+  return model;
+}
+
+TEST(Model, ComputeImageOverlaps) {
+  const Model model = CreateModel(8, 200);
+
+  std::vector<Eigen::Vector3d> proj_centers;
+  for (const auto& image : model.images) {
+    Eigen::Vector3f C;
+    ComputeProjectionCenter(image.GetR(), image.GetT(), C.data());
+    proj_centers.push_back(C.cast<double>());
+  }
+
+  std::vector<std::map<int, int>> expected_num_shared_points(8);
+  std::vector<std::map<int, std::vector<float>>> expected_angles(8);
+  for (const auto& point : model.points) {
+    for (const int image_idx1 : point.track) {
+      for (const int image_idx2 : point.track) {
+        if (image_idx1 != image_idx2) {
+          expected_num_shared_points[image_idx1][image_idx2] += 1;
+          expected_angles[image_idx1][image_idx2].push_back(
+              CalculateTriangulationAngle(
+                  proj_centers[image_idx1],
+                  proj_centers[image_idx2],
+                  Eigen::Vector3d(point.x, point.y, point.z)));
+        }
+      }
+    }
+  }
+
+  for (const int num_threads : {1, 3}) {
+    const ImageOverlaps image_overlaps =
+        model.ComputeImageOverlaps(/*percentile=*/75, num_threads);
+    ASSERT_EQ(image_overlaps.NumImages(), 8);
+    EXPECT_EQ(image_overlaps.model_hash, model.ComputeHash());
+    for (int image_idx = 0; image_idx < 8; ++image_idx) {
+      const size_t begin = image_overlaps.offsets[image_idx];
+      const size_t end = image_overlaps.offsets[image_idx + 1];
+      ASSERT_EQ(end - begin, expected_num_shared_points[image_idx].size());
+      auto expected_it = expected_num_shared_points[image_idx].begin();
+      for (size_t i = begin; i < end; ++i, ++expected_it) {
+        EXPECT_EQ(image_overlaps.image_idxs[i], expected_it->first);
+        EXPECT_EQ(image_overlaps.num_shared_points[i], expected_it->second);
+        EXPECT_NEAR(
+            image_overlaps.triangulation_angles[i],
+            Percentile(expected_angles[image_idx][expected_it->first], 75),
+            1e-6);
+      }
+    }
+  }
+}
+
+TEST(Model, ComputeImageOverlapsWithoutPoints) {
+  const Model model = CreateModel(3, 0);
+  const ImageOverlaps image_overlaps = model.ComputeImageOverlaps();
+  EXPECT_EQ(image_overlaps.NumImages(), 3);
+  EXPECT_EQ(image_overlaps.NumOverlaps(), 0);
+}
+
+TEST(ImageOverlaps, GetMaxOverlappingImages) {
+  ImageOverlaps image_overlaps;
+  image_overlaps.offsets = {0, 3, 3};
+  image_overlaps.image_idxs = {1, 2, 3};
+  image_overlaps.num_shared_points = {10, 20, 10};
+  image_overlaps.triangulation_angles = {0.1, 0.2, 0.3};
+  EXPECT_EQ(image_overlaps.GetMaxOverlappingImages(0, 5, 0),
+            std::vector<int>({2, 1, 3}));
+  EXPECT_EQ(image_overlaps.GetMaxOverlappingImages(0, 2, 0),
+            std::vector<int>({2, 1}));
+  EXPECT_EQ(image_overlaps.GetMaxOverlappingImages(0, 5, 0.15),
+            std::vector<int>({2, 3}));
+  EXPECT_TRUE(image_overlaps.GetMaxOverlappingImages(1, 5, 0).empty());
+}
+
+TEST(Model, ReadOrComputeImageOverlaps) {
+  Model model = CreateModel(5, 50);
+  const std::string cache_path = CreateTestDir() + "/image_overlaps.bin";
+
+  const ImageOverlaps image_overlaps =
+      model.ReadOrComputeImageOverlaps(cache_path, 75);
+  EXPECT_TRUE(ExistsFile(cache_path));
+
+  ImageOverlaps read_image_overlaps;
+  EXPECT_TRUE(read_image_overlaps.Read(cache_path));
+  EXPECT_EQ(read_image_overlaps.model_hash, image_overlaps.model_hash);
+  EXPECT_EQ(read_image_overlaps.triangulation_angle_percentile, 75);
+  EXPECT_EQ(read_image_overlaps.offsets, image_overlaps.offsets);
+  EXPECT_EQ(read_image_overlaps.image_idxs, image_overlaps.image_idxs);
+  EXPECT_EQ(read_image_overlaps.num_shared_points,
+            image_overlaps.num_shared_points);
+  EXPECT_EQ(read_image_overlaps.triangulation_angles,
+            image_overlaps.triangulation_angles);
+
+  // The cache is recomputed for a different percentile or model.
+  EXPECT_EQ(model.ReadOrComputeImageOverlaps(cache_path, 50)
+                .triangulation_angle_percentile,
+            50);
+  model.points.pop_back();
+  const ImageOverlaps changed_image_overlaps =
+      model.ReadOrComputeImageOverlaps(cache_path, 50);
+  EXPECT_EQ(changed_image_overlaps.model_hash, model.ComputeHash());
+  EXPECT_NE(changed_image_overlaps.model_hash, image_overlaps.model_hash);
+}
+
+TEST(Model, ReadOrComputeImageOverlapsInvalidCache) {
+  const Model model = CreateModel(5, 50);
+  const std::string cache_path = CreateTestDir() + "/image_overlaps.bin";
+  const ImageOverlaps image_overlaps = model.ComputeImageOverlaps();
+  ASSERT_TRUE(image_overlaps.Write(cache_path));
+  const size_t num_bytes = GetFileSize(cache_path);
+
+  auto ExpectRecomputed = [&]() {
+    ImageOverlaps read_image_overlaps;
+    EXPECT_FALSE(read_image_overlaps.Read(cache_path));
+    const ImageOverlaps recomputed_image_overlaps =
+        model.ReadOrComputeImageOverlaps(cache_path);
+    EXPECT_EQ(recomputed_image_overlaps.offsets, image_overlaps.offsets);
+    EXPECT_EQ(recomputed_image_overlaps.image_idxs, image_overlaps.image_idxs);
+    EXPECT_TRUE(read_image_overlaps.Read(cache_path));
+  };
+
+  // Truncated file.
+  std::filesystem::resize_file(cache_path, num_bytes - 1);
+  ExpectRecomputed();
+
+  // Invalid number of overlaps.
+  {
+    std::fstream file(cache_path,
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(32);
+    WriteBinaryLittleEndian<uint64_t>(&file, 1ull << 60);
+  }
+  ExpectRecomputed();
+
+  // Unsupported version.
+  {
+    std::fstream file(cache_path,
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(8);
+    WriteBinaryLittleEndian<uint32_t>(&file, 1000);
+  }
+  ExpectRecomputed();
+
+  // The overlaps are still computed if the cache cannot be written.
+  const std::string unwritable_cache_path =
+      CreateTestDir() + "/missing/image_overlaps.bin";
+  EXPECT_EQ(model.ReadOrComputeImageOverlaps(unwritable_cache_path).offsets,
+            image_overlaps.offsets);
+  EXPECT_FALSE(ExistsFile(unwritable_cache_path));
+}
+
+}  // namespace
+}  // namespace mvs
+}  // namespace colmap
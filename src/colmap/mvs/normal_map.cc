@@ -40,9 +40,8 @@ NormalMap::NormalMap(const size_t width, const size_t height)
     : Mat<float>(width, height, 3) {}
 
 NormalMap::NormalMap(const Mat<float>& mat)
-    : Mat<float>(mat.GetWidth(), mat.GetHeight(), mat.GetDepth()) {
+    : Mat<float>(mat) {
   THROW_CHECK_EQ(mat.GetDepth(), 3);
-  data_ = mat.GetData();
 }
 
 void NormalMap::Rescale(const float factor) {
@@ -55,10 +54,11 @@ void NormalMap::Rescale(const float factor) {
   std::vector<float> new_data(new_width * new_height * 3);
 
   // Resample the normal map.
+  const Mat<float>& mat = *this;
   for (size_t d = 0; d < 3; ++d) {
     const size_t offset = d * width_ * height_;
     const size_t new_offset = d * new_width * new_height;
-    DownsampleImage(data_.data() + offset,
+    DownsampleImage(mat.GetPtr() + offset,
                     height_,
                     width_,
                     new_height,
@@ -66,6 +66,7 @@ void NormalMap::Rescale(const float factor) {
                     new_data.data() + new_offset);
   }
 
+  mapped_data_.reset();
   data_ = new_data;
   width_ = new_width;
   height_ = new_height;
@@ -31,11 +31,16 @@
 
 #include "colmap/math/math.h"
 #include "colmap/mvs/consistency_graph.h"
-#include "colmap/mvs/patch_match_cuda.h"
+#include "colmap/mvs/mat_file.h"
+#include "colmap/mvs/patch_match_cpu.h"
 #include "colmap/mvs/workspace.h"
 #include "colmap/util/file.h"
 #include "colmap/util/misc.h"
 
+#if defined(COLMAP_CUDA_ENABLED)
+#include "colmap/mvs/patch_match_cuda.h"
+#endif
+
 #include <numeric>
 #include <unordered_set>
 
@@ -128,27 +133,57 @@ void PatchMatch::Run() {
 
   Check();
 
-  patch_match_cuda_ = std::make_unique<PatchMatchCuda>(options_, problem_);
-  patch_match_cuda_->Run();
+#if defined(COLMAP_CUDA_ENABLED)
+  if (options_.use_gpu) {
+    patch_match_cuda_ = std::make_unique<PatchMatchCuda>(options_, problem_);
+    patch_match_cuda_->Run();
+    return;
+  }
+#endif
+
+  patch_match_cpu_ = std::make_unique<PatchMatchCpu>(options_, problem_);
+  patch_match_cpu_->Run();
 }
 
 DepthMap PatchMatch::GetDepthMap() const {
-  return patch_match_cuda_->GetDepthMap();
+#if defined(COLMAP_CUDA_ENABLED)
+  if (patch_match_cuda_) {
+    return patch_match_cuda_->GetDepthMap();
+  }
+#endif
+  return patch_match_cpu_->GetDepthMap();
 }
 
 NormalMap PatchMatch::GetNormalMap() const {
-  return patch_match_cuda_->GetNormalMap();
+#if defined(COLMAP_CUDA_ENABLED)
+  if (patch_match_cuda_) {
+    return patch_match_cuda_->GetNormalMap();
+  }
+#endif
+  return patch_match_cpu_->GetNormalMap();
 }
 
 Mat<float> PatchMatch::GetSelProbMap() const {
-  return patch_match_cuda_->GetSelProbMap();
+#if defined(COLMAP_CUDA_ENABLED)
+  if (patch_match_cuda_) {
+    return patch_match_cuda_->GetSelProbMap();
+  }
+#endif
+  return patch_match_cpu_->GetSelProbMap();
 }
 
 ConsistencyGraph PatchMatch::GetConsistencyGraph() const {
   const auto& ref_image = problem_.images->at(problem_.ref_image_idx);
+#if defined(COLMAP_CUDA_ENABLED)
+  if (patch_match_cuda_) {
+    return ConsistencyGraph(ref_image.GetWidth(),
+                            ref_image.GetHeight(),
+                            patch_match_cuda_->GetConsistentImageIdxs());
+  }
+#endif
   return ConsistencyGraph(ref_image.GetWidth(),
                           ref_image.GetHeight(),
-                          patch_match_cuda_->GetConsistentImageIdxs());
+                          patch_match_cpu_->GetConsistentImageIdxs());
 }
 
 PatchMatchController::PatchMatchController(const PatchMatchOptions& options,
@@ -245,8 +280,7 @@ void PatchMatchController::ReadProblems() {
                            : config_path_;
   std::vector<std::string> config = ReadTextFileLines(config_path);
 
-  std::vector<std::map<int, int>> shared_num_points;
-  std::vector<std::map<int, float>> triangulation_angles;
+  ImageOverlaps image_overlaps;
 
   const float min_triangulation_angle_rad =
       DegToRad(options_.min_triangulation_angle);
@@ -305,47 +339,21 @@ void PatchMatchController::ReadProblems() {
       // image and the top ranked images are selected. Note that images are only
       // selected if some points have a sufficient triangulation angle.
 
-      if (shared_num_points.empty()) {
-        shared_num_points = model.ComputeSharedPoints();
-      }
-      if (triangulation_angles.empty()) {
+      if (image_overlaps.offsets.empty()) {
         const float kTriangulationAnglePercentile = 75;
-        triangulation_angles =
-            model.ComputeTriangulationAngles(kTriangulationAnglePercentile);
+        image_overlaps = model.ReadOrComputeImageOverlaps(
+            workspace_->GetImageOverlapsPath(),
+            kTriangulationAnglePercentile,
+            options_.num_threads);
       }
 
       const size_t max_num_src_images =
           std::stoll(problem_config.src_image_names[1]);
 
-      const auto& overlapping_images =
-          shared_num_points.at(problem.ref_image_idx);
-      const auto& overlapping_triangulation_angles =
-          triangulation_angles.at(problem.ref_image_idx);
-
-      std::vector<std::pair<int, int>> src_images;
-      src_images.reserve(overlapping_images.size());
-      for (const auto& image : overlapping_images) {
-        if (overlapping_triangulation_angles.at(image.first) >=
-            min_triangulation_angle_rad) {
-          src_images.emplace_back(image.first, image.second);
-        }
-      }
-
-      const size_t eff_max_num_src_images =
-          std::min(src_images.size(), max_num_src_images);
-
-      std::partial_sort(src_images.begin(),
-                        src_images.begin() + eff_max_num_src_images,
-                        src_images.end(),
-                        [](const std::pair<int, int>& image1,
-                           const std::pair<int, int>& image2) {
-                          return image1.second > image2.second;
-                        });
-
-      problem.src_image_idxs.reserve(eff_max_num_src_images);
-      for (size_t i = 0; i < eff_max_num_src_images; ++i) {
-        problem.src_image_idxs.push_back(src_images[i].first);
-      }
+      problem.src_image_idxs = image_overlaps.GetMaxOverlappingImages(
+          problem.ref_image_idx,
+          max_num_src_images,
+          min_triangulation_angle_rad);
     } else {
       problem.src_image_idxs.reserve(problem_config.src_image_names.size());
       for (const auto& src_image_name : problem_config.src_image_names) {
@@ -368,13 +376,23 @@ void PatchMatchController::ReadProblems() {
 }
 
 void PatchMatchController::ReadGpuIndices() {
-  gpu_indices_ = CSVToVector<int>(options_.gpu_index);
-  if (gpu_indices_.size() == 1 && gpu_indices_[0] == -1) {
-    const int num_cuda_devices = GetNumCudaDevices();
-    THROW_CHECK_GT(num_cuda_devices, 0);
-    gpu_indices_.resize(num_cuda_devices);
-    std::iota(gpu_indices_.begin(), gpu_indices_.end(), 0);
+#if defined(COLMAP_CUDA_ENABLED)
+  if (options_.use_gpu) {
+    gpu_indices_ = CSVToVector<int>(options_.gpu_index);
+    if (gpu_indices_.size() == 1 && gpu_indices_[0] == -1) {
+      const int num_cuda_devices = GetNumCudaDevices();
+      THROW_CHECK_GT(num_cuda_devices, 0);
+      gpu_indices_.resize(num_cuda_devices);
+      std::iota(gpu_indices_.begin(), gpu_indices_.end(), 0);
+    }
+    return;
   }
+#endif
+
+  // The CPU implementation parallelizes each problem internally, so the
+  // problems are processed one after another.
+  LOG(INFO) << "Running patch match stereo on the CPU";
+  gpu_indices_ = {-1};
 }
 
 void PatchMatchController::ProcessProblem(const PatchMatchOptions& options,
@@ -486,10 +504,10 @@ void PatchMatchController::ProcessProblem(const PatchMatchOptions& options,
       if (image_idx != problem.ref_image_idx) {
         src_image_idxs.push_back(image_idx);
       }
-      images.at(image_idx).SetBitmap(workspace_->GetBitmap(image_idx));
+      images.at(image_idx).SetBitmap(*workspace_->GetBitmap(image_idx));
       if (options.geom_consistency) {
-        depth_maps.at(image_idx) = workspace_->GetDepthMap(image_idx);
-        normal_maps.at(image_idx) = workspace_->GetNormalMap(image_idx);
+        depth_maps.at(image_idx) = *workspace_->GetDepthMap(image_idx);
+        normal_maps.at(image_idx) = *workspace_->GetNormalMap(image_idx);
       }
     }
     problem.src_image_idxs = src_image_idxs;
@@ -506,8 +524,18 @@ void PatchMatchController::ProcessProblem(const PatchMatchOptions& options,
                             output_type.c_str(),
                             image_name.c_str());
 
-  patch_match.GetDepthMap().Write(depth_map_path);
-  patch_match.GetNormalMap().Write(normal_map_path);
+  std::string output_format_lower_case = options.output_format;
+  StringToLower(&output_format_lower_case);
+  if (output_format_lower_case == "bin") {
+    MatFileOptions mat_file_options;
+    mat_file_options.half_precision = options.output_half_precision;
+    mat_file_options.compress = options.output_compress;
+    WriteMatFile(depth_map_path, patch_match.GetDepthMap(), mat_file_options);
+    WriteMatFile(normal_map_path, patch_match.GetNormalMap(), mat_file_options);
+  } else {
+    patch_match.GetDepthMap().Write(depth_map_path);
+    patch_match.GetNormalMap().Write(normal_map_path);
+  }
   if (options.write_consistency_graph) {
     patch_match.GetConsistencyGraph().Write(consistency_graph_path);
   }
@@ -48,12 +48,15 @@ namespace colmap {
 namespace mvs {
 
 class ConsistencyGraph;
+class PatchMatchCpu;
 class PatchMatchCuda;
 class Workspace;
 
-// This is a wrapper class around the actual PatchMatchCuda implementation. This
-// class is necessary to hide Cuda code from any boost or Eigen code, since
-// NVCC/MSVC cannot compile complex C++ code.
+// This is a wrapper class around the actual PatchMatchCuda and PatchMatchCpu
+// implementations. This class is necessary to hide Cuda code from any boost or
+// Eigen code, since NVCC/MSVC cannot compile complex C++ code. The Cuda
+// implementation is used if `PatchMatchOptions::use_gpu` is set and COLMAP was
+// compiled with Cuda, otherwise the multi-threaded CPU implementation.
 class PatchMatch {
  public:
   struct Problem {
@@ -94,7 +97,10 @@ class PatchMatch {
  private:
   const PatchMatchOptions options_;
   const Problem problem_;
+#if defined(COLMAP_CUDA_ENABLED)
   std::unique_ptr<PatchMatchCuda> patch_match_cuda_;
+#endif
+  std::unique_ptr<PatchMatchCpu> patch_match_cpu_;
 };
 
 // This thread processes all problems in a workspace. A workspace has the
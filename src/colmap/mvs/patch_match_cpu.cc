@@ -0,0 +1,1444 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/patch_match_cpu.h"
+
+#include "colmap/math/math.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/misc.h"
+#include "colmap/util/timer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include <Eigen/Core>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+// Number of parameters per source image in the poses array, see
+// PatchMatchCpu::InitTransforms for the layout.
+constexpr int kNumTformParams = 4 + 9 + 3 + 3 + 12 + 12;
+
+// Probability for boundary pixels.
+constexpr float kUniformProb = 0.5f;
+
+// Maximum photo consistency cost as 1 - min(NCC).
+constexpr float kMaxCost = 2.0f;
+
+inline void Mat33DotVec3(const float mat[9],
+                         const float vec[3],
+                         float result[3]) {
+  result[0] = mat[0] * vec[0] + mat[1] * vec[1] + mat[2] * vec[2];
+  result[1] = mat[3] * vec[0] + mat[4] * vec[1] + mat[5] * vec[2];
+  result[2] = mat[6] * vec[0] + mat[7] * vec[1] + mat[8] * vec[2];
+}
+
+inline void Mat33DotVec3Homogeneous(const float mat[9],
+                                    const float vec[2],
+                                    float result[2]) {
+  const float inv_z = 1.0f / (mat[6] * vec[0] + mat[7] * vec[1] + mat[8]);
+  result[0] = inv_z * (mat[0] * vec[0] + mat[1] * vec[1] + mat[2]);
+  result[1] = inv_z * (mat[3] * vec[0] + mat[4] * vec[1] + mat[5]);
+}
+
+inline float DotProduct3(const float vec1[3], const float vec2[3]) {
+  return vec1[0] * vec2[0] + vec1[1] * vec2[1] + vec1[2] * vec2[2];
+}
+
+// Uniform random number in [0, 1).
+inline float RandomUniform(std::mt19937* rng) {
+  return std::uniform_real_distribution<float>(0.0f, 1.0f)(*rng);
+}
+
+inline float GenerateRandomDepth(const float depth_min,
+                                 const float depth_max,
+                                 std::mt19937* rng) {
+  return RandomUniform(rng) * (depth_max - depth_min) + depth_min;
+}
+
+inline void GenerateRandomNormal(const int row,
+                                 const int col,
+                                 const float ref_inv_K[4],
+                                 std::mt19937* rng,
+                                 float normal[3]) {
+  // Unbiased sampling of normal, according to George Marsaglia, "Choosing a
+  // Point from the Surface of a Sphere", 1972.
+  float v1 = 0.0f;
+  float v2 = 0.0f;
+  float s = 2.0f;
+  while (s >= 1.0f) {
+    v1 = 2.0f * RandomUniform(rng) - 1.0f;
+    v2 = 2.0f * RandomUniform(rng) - 1.0f;
+    s = v1 * v1 + v2 * v2;
+  }
+
+  const float s_norm = std::sqrt(1.0f - s);
+  normal[0] = 2.0f * v1 * s_norm;
+  normal[1] = 2.0f * v2 * s_norm;
+  normal[2] = 1.0f - 2.0f * s;
+
+  // Make sure normal is looking away from camera.
+  const float view_ray[3] = {ref_inv_K[0] * col + ref_inv_K[1],
+                             ref_inv_K[2] * row + ref_inv_K[3],
+                             1.0f};
+  if (DotProduct3(normal, view_ray) > 0) {
+    normal[0] = -normal[0];
+    normal[1] = -normal[1];
+    normal[2] = -normal[2];
+  }
+}
+
+inline float PerturbDepth(const float perturbation,
+                          const float depth,
+                          std::mt19937* rng) {
+  const float depth_min = (1.0f - perturbation) * depth;
+  const float depth_max = (1.0f + perturbation) * depth;
+  return GenerateRandomDepth(depth_min, depth_max, rng);
+}
+
+void PerturbNormal(const int row,
+                   const int col,
+                   const float perturbation,
+                   const float normal[3],
+                   const float ref_inv_K[4],
+                   std::mt19937* rng,
+                   float perturbed_normal[3],
+                   const int num_trials = 0) {
+  // Perturbation rotation angles.
+  const float a1 = (RandomUniform(rng) - 0.5f) * perturbation;
+  const float a2 = (RandomUniform(rng) - 0.5f) * perturbation;
+  const float a3 = (RandomUniform(rng) - 0.5f) * perturbation;
+
+  const float sin_a1 = std::sin(a1);
+  const float sin_a2 = std::sin(a2);
+  const float sin_a3 = std::sin(a3);
+  const float cos_a1 = std::cos(a1);
+  const float cos_a2 = std::cos(a2);
+  const float cos_a3 = std::cos(a3);
+
+  // R = Rx * Ry * Rz
+  float R[9];
+  R[0] = cos_a2 * cos_a3;
+  R[1] = -cos_a2 * sin_a3;
+  R[2] = sin_a2;
+  R[3] = cos_a1 * sin_a3 + cos_a3 * sin_a1 * sin_a2;
+  R[4] = cos_a1 * cos_a3 - sin_a1 * sin_a2 * sin_a3;
+  R[5] = -cos_a2 * sin_a1;
+  R[6] = sin_a1 * sin_a3 - cos_a1 * cos_a3 * sin_a2;
+  R[7] = cos_a3 * sin_a1 + cos_a1 * sin_a2 * sin_a3;
+  R[8] = cos_a1 * cos_a2;
+
+  // Perturb the normal vector.
+  Mat33DotVec3(R, normal, perturbed_normal);
+
+  // Make sure the perturbed normal is still looking in the same direction as
+  // the viewing direction, otherwise try again but with smaller perturbation.
+  const float view_ray[3] = {ref_inv_K[0] * col + ref_inv_K[1],
+                             ref_inv_K[2] * row + ref_inv_K[3],
+                             1.0f};
+  if (DotProduct3(perturbed_normal, view_ray) >= 0.0f) {
+    const int kMaxNumTrials = 3;
+    if (num_trials < kMaxNumTrials) {
+      PerturbNormal(row,
+                    col,
+                    0.5f * perturbation,
+                    normal,
+                    ref_inv_K,
+                    rng,
+                    perturbed_normal,
+                    num_trials + 1);
+    } else {
+      perturbed_normal[0] = normal[0];
+      perturbed_normal[1] = normal[1];
+      perturbed_normal[2] = normal[2];
+    }
+    return;
+  }
+
+  // Make sure normal has unit norm.
+  const float inv_norm =
+      1.0f / std::sqrt(DotProduct3(perturbed_normal, perturbed_normal));
+  perturbed_normal[0] *= inv_norm;
+  perturbed_normal[1] *= inv_norm;
+  perturbed_normal[2] *= inv_norm;
+}
+
+inline void ComputePointAtDepth(const float ref_inv_K[4],
+                                const float row,
+                                const float col,
+                                const float depth,
+                                float point[3]) {
+  point[0] = depth * (ref_inv_K[0] * col + ref_inv_K[1]);
+  point[1] = depth * (ref_inv_K[2] * row + ref_inv_K[3]);
+  point[2] = depth;
+}
+
+// Transfer depth on plane from viewing ray at row1 to row2. The returned
+// depth is the intersection of the viewing ray through row2 with the plane
+// at row1 defined by the given depth and normal.
+inline float PropagateDepth(const float ref_inv_K[4],
+                            const float depth1,
+                            const float normal1[3],
+                            const float row1,
+                            const float row2) {
+  // Point along first viewing ray.
+  const float x1 = depth1 * (ref_inv_K[2] * row1 + ref_inv_K[3]);
+  const float y1 = depth1;
+  // Point on plane defined by point along first viewing ray and plane normal1.
+  const float x2 = x1 + normal1[2];
+  const float y2 = y1 - normal1[1];
+
+  // Point on second viewing ray, which originates from (0, 0).
+  const float x4 = ref_inv_K[2] * row2 + ref_inv_K[3];
+
+  // Intersection of the lines ((x1, y1), (x2, y2)) and ((0, 0), (x4, 1)).
+  const float denom = x2 - x1 + x4 * (y1 - y2);
+  constexpr float kEps = 1e-5f;
+  if (std::abs(denom) < kEps) {
+    return depth1;
+  }
+  const float nom = y1 * x2 - x1 * y2;
+  return nom / denom;
+}
+
+// First, compute triangulation angle between reference and source image for 3D
+// point. Second, compute incident angle between viewing direction of source
+// image and normal direction of 3D point. Both angles are cosine distances.
+inline void ComputeViewingAngles(const float* pose,
+                                 const float point[3],
+                                 const float normal[3],
+                                 float* cos_triangulation_angle,
+                                 float* cos_incident_angle) {
+  // Projection center of source image.
+  const float* C = pose + 16;
+
+  // Ray from point to camera.
+  const float SX[3] = {C[0] - point[0], C[1] - point[1], C[2] - point[2]};
+
+  // Length of ray from reference image to point.
+  const float RX_inv_norm = 1.0f / std::sqrt(DotProduct3(point, point));
+
+  // Length of ray from source image to point.
+  const float SX_inv_norm = 1.0f / std::sqrt(DotProduct3(SX, SX));
+
+  *cos_incident_angle = DotProduct3(SX, normal) * SX_inv_norm;
+  *cos_triangulation_angle = DotProduct3(SX, point) * RX_inv_norm * SX_inv_norm;
+}
+
+inline void ComposeHomography(const float* pose,
+                              const float ref_inv_K[4],
+                              const int row,
+                              const int col,
+                              const float depth,
+                              const float normal[3],
+                              float H[9]) {
+  // Calibration, relative rotation, and relative translation of source image.
+  const float* K = pose;
+  const float* R = pose + 4;
+  const float* T = pose + 13;
+
+  // Distance to the plane.
+  const float dist =
+      depth * (normal[0] * (ref_inv_K[0] * col + ref_inv_K[1]) +
+               normal[1] * (ref_inv_K[2] * row + ref_inv_K[3]) + normal[2]);
+  const float inv_dist = 1.0f / dist;
+
+  const float inv_dist_N0 = inv_dist * normal[0];
+  const float inv_dist_N1 = inv_dist * normal[1];
+  const float inv_dist_N2 = inv_dist * normal[2];
+
+  // Homography as H = K * (R - T * n' / d) * Kref^-1.
+  H[0] = ref_inv_K[0] * (K[0] * (R[0] + inv_dist_N0 * T[0]) +
+                         K[1] * (R[6] + inv_dist_N0 * T[2]));
+  H[1] = ref_inv_K[2] * (K[0] * (R[1] + inv_dist_N1 * T[0]) +
+                         K[1] * (R[7] + inv_dist_N1 * T[2]));
+  H[2] = K[0] * (R[2] + inv_dist_N2 * T[0]) +
+         K[1] * (R[8] + inv_dist_N2 * T[2]) +
+         ref_inv_K[1] * (K[0] * (R[0] + inv_dist_N0 * T[0]) +
+                         K[1] * (R[6] + inv_dist_N0 * T[2])) +
+         ref_inv_K[3] * (K[0] * (R[1] + inv_dist_N1 * T[0]) +
+                         K[1] * (R[7] + inv_dist_N1 * T[2]));
+  H[3] = ref_inv_K[0] * (K[2] * (R[3] + inv_dist_N0 * T[1]) +
+                         K[3] * (R[6] + inv_dist_N0 * T[2]));
+  H[4] = ref_inv_K[2] * (K[2] * (R[4] + inv_dist_N1 * T[1]) +
+                         K[3] * (R[7] + inv_dist_N1 * T[2]));
+  H[5] = K[2] * (R[5] + inv_dist_N2 * T[1]) +
+         K[3] * (R[8] + inv_dist_N2 * T[2]) +
+         ref_inv_K[1] * (K[2] * (R[3] + inv_dist_N0 * T[1]) +
+                         K[3] * (R[6] + inv_dist_N0 * T[2])) +
+         ref_inv_K[3] * (K[2] * (R[4] + inv_dist_N1 * T[1]) +
+                         K[3] * (R[7] + inv_dist_N1 * T[2]));
+  H[6] = ref_inv_K[0] * (R[6] + inv_dist_N0 * T[2]);
+  H[7] = ref_inv_K[2] * (R[7] + inv_dist_N1 * T[2]);
+  H[8] = R[8] + ref_inv_K[1] * (R[6] + inv_dist_N0 * T[2]) +
+         ref_inv_K[3] * (R[7] + inv_dist_N1 * T[2]) + inv_dist_N2 * T[2];
+}
+
+// Bilinearly interpolate the image at the given position, where pixel centers
+// are at integer coordinates and pixels outside the image are zero. This is
+// equivalent to the linearly filtered Cuda texture with border addressing.
+inline float InterpolateBilinear(const float* image,
+                                 const int width,
+                                 const int height,
+                                 const float x,
+                                 const float y) {
+  // Note that the negated comparisons also reject NaN coordinates.
+  if (!(x > -1.0f && y > -1.0f && x < width && y < height)) {
+    return 0.0f;
+  }
+
+  const float x_floor = std::floor(x);
+  const float y_floor = std::floor(y);
+  const int x0 = static_cast<int>(x_floor);
+  const int y0 = static_cast<int>(y_floor);
+  const float dx = x - x_floor;
+  const float dy = y - y_floor;
+
+  float v00 = 0.0f;
+  float v01 = 0.0f;
+  float v10 = 0.0f;
+  float v11 = 0.0f;
+  if (x0 >= 0 && y0 >= 0 && x0 + 1 < width && y0 + 1 < height) {
+    const float* ptr = image + y0 * width + x0;
+    v00 = ptr[0];
+    v01 = ptr[1];
+    v10 = ptr[width];
+    v11 = ptr[width + 1];
+  } else {
+    const auto get = [&](const int r, const int c) {
+      return (r >= 0 && c >= 0 && r < height && c < width)
+                 ? image[r * width + c]
+                 : 0.0f;
+    };
+    v00 = get(y0, x0);
+    v01 = get(y0, x0 + 1);
+    v10 = get(y0 + 1, x0);
+    v11 = get(y0 + 1, x0 + 1);
+  }
+
+  return (1.0f - dy) * ((1.0f - dx) * v00 + dx * v01) +
+         dy * ((1.0f - dx) * v10 + dx * v11);
+}
+
+// Find index of minimum in given values.
+template <int kNumCosts>
+inline int FindMinCost(const float costs[kNumCosts]) {
+  float min_cost = costs[0];
+  int min_cost_idx = 0;
+  for (int idx = 1; idx < kNumCosts; ++idx) {
+    if (costs[idx] <= min_cost) {
+      min_cost = costs[idx];
+      min_cost_idx = idx;
+    }
+  }
+  return min_cost_idx;
+}
+
+inline void TransformPDFToCDF(float* probs, const int num_probs) {
+  float prob_sum = 0.0f;
+  for (int i = 0; i < num_probs; ++i) {
+    prob_sum += probs[i];
+  }
+  const float inv_prob_sum = 1.0f / prob_sum;
+
+  float cum_prob = 0.0f;
+  for (int i = 0; i < num_probs; ++i) {
+    const float prob = probs[i] * inv_prob_sum;
+    cum_prob += prob;
+    probs[i] = cum_prob;
+  }
+}
+
+class LikelihoodComputer {
+ public:
+  LikelihoodComputer(const float ncc_sigma,
+                     const float min_triangulation_angle,
+                     const float incident_angle_sigma)
+      : cos_min_triangulation_angle_(std::cos(min_triangulation_angle)),
+        inv_incident_angle_sigma_square_(
+            -0.5f / (incident_angle_sigma * incident_angle_sigma)),
+        inv_ncc_sigma_square_(-0.5f / (ncc_sigma * ncc_sigma)),
+        ncc_norm_factor_(ComputeNCCCostNormFactor(ncc_sigma)) {}
+
+  // Compute forward message from current cost and forward message of
+  // previous / neighboring pixel.
+  float ComputeForwardMessage(const float cost, const float prev) const {
+    return ComputeMessage<true>(cost, prev);
+  }
+
+  // Compute backward message from current cost and backward message of
+  // previous / neighboring pixel.
+  float ComputeBackwardMessage(const float cost, const float prev) const {
+    return ComputeMessage<false>(cost, prev);
+  }
+
+  // Compute the selection probability from the forward and backward message.
+  inline float ComputeSelProb(const float alpha,
+                              const float beta,
+                              const float prev,
+                              const float prev_weight) const {
+    const float zn0 = (1.0f - alpha) * (1.0f - beta);
+    const float zn1 = alpha * beta;
+    const float curr = zn1 / (zn0 + zn1);
+    return prev_weight * prev + (1.0f - prev_weight) * curr;
+  }
+
+  // Compute NCC probability. Note that cost = 1 - NCC.
+  inline float ComputeNCCProb(const float cost) const {
+    return std::exp(cost * cost * inv_ncc_sigma_square_) * ncc_norm_factor_;
+  }
+
+  // Compute the triangulation angle probability.
+  inline float ComputeTriProb(const float cos_triangulation_angle) const {
+    const float abs_cos_triangulation_angle =
+        std::abs(cos_triangulation_angle);
+    if (abs_cos_triangulation_angle > cos_min_triangulation_angle_) {
+      const float scaled = 1.0f - (1.0f - abs_cos_triangulation_angle) /
+                                      (1.0f - cos_min_triangulation_angle_);
+      const float likelihood = 1.0f - scaled * scaled;
+      return std::min(1.0f, std::max(0.0f, likelihood));
+    } else {
+      return 1.0f;
+    }
+  }
+
+  // Compute the incident angle probability.
+  inline float ComputeIncProb(const float cos_incident_angle) const {
+    const float x = 1.0f - std::max(0.0f, cos_incident_angle);
+    return std::exp(x * x * inv_incident_angle_sigma_square_);
+  }
+
+  // Compute the warping/resolution prior probability.
+  inline float ComputeResolutionProb(const int window_radius,
+                                     const float H[9],
+                                     const float row,
+                                     const float col) const {
+    // Warp corners of patch in reference image to source image.
+    float src1[2];
+    const float ref1[2] = {col - window_radius, row - window_radius};
+    Mat33DotVec3Homogeneous(H, ref1, src1);
+    float src2[2];
+    const float ref2[2] = {col - window_radius, row + window_radius};
+    Mat33DotVec3Homogeneous(H, ref2, src2);
+    float src3[2];
+    const float ref3[2] = {col + window_radius, row + window_radius};
+    Mat33DotVec3Homogeneous(H, ref3, src3);
+    float src4[2];
+    const float ref4[2] = {col + window_radius, row - window_radius};
+    Mat33DotVec3Homogeneous(H, ref4, src4);
+
+    // Compute area of patches in reference and source image.
+    const float window_size = 2 * window_radius + 1;
+    const float ref_area = window_size * window_size;
+    const float src_area = std::abs(
+        0.5f * (src1[0] * src2[1] - src2[0] * src1[1] - src1[0] * src4[1] +
+                src2[0] * src3[1] - src3[0] * src2[1] + src4[0] * src1[1] +
+                src3[0] * src4[1] - src4[0] * src3[1]));
+
+    if (ref_area > src_area) {
+      return src_area / ref_area;
+    } else {
+      return ref_area / src_area;
+    }
+  }
+
+ private:
+  // The normalization for the likelihood function, i.e. the normalization for
+  // the prior on the matching cost.
+  static inline float ComputeNCCCostNormFactor(const float ncc_sigma) {
+    // A = sqrt(2pi)*sigma/2*erf(sqrt(2)/sigma)
+    // erf(x) = 2/sqrt(pi) * integral from 0 to x of exp(-t^2) dt
+    return 2.0f / (std::sqrt(2.0f * static_cast<float>(M_PI)) * ncc_sigma *
+                   std::erf(2.0f / (ncc_sigma * 1.414213562f)));
+  }
+
+  // Compute the forward or backward message.
+  template <bool kForward>
+  inline float ComputeMessage(const float cost, const float prev) const {
+    constexpr float kNoChangeProb = 0.99999f;
+    const float kChangeProb = 1.0f - kNoChangeProb;
+    const float emission = ComputeNCCProb(cost);
+
+    float zn0;  // Message for selection probability = 0.
+    float zn1;  // Message for selection probability = 1.
+    if (kForward) {
+      zn0 = (prev * kChangeProb + (1.0f - prev) * kNoChangeProb) * kUniformProb;
+      zn1 = (prev * kNoChangeProb + (1.0f - prev) * kChangeProb) * emission;
+    } else {
+      zn0 = prev * emission * kChangeProb +
+            (1.0f - prev) * kUniformProb * kNoChangeProb;
+      zn1 = prev * emission * kNoChangeProb +
+            (1.0f - prev) * kUniformProb * kChangeProb;
+    }
+
+    return zn1 / (zn0 + zn1);
+  }
+
+  const float cos_min_triangulation_angle_;
+  const float inv_incident_angle_sigma_square_;
+  const float inv_ncc_sigma_square_;
+  const float ncc_norm_factor_;
+};
+
+// Rotate the matrix by 90 degrees in counter-clockwise direction.
+template <typename T>
+Mat<T> RotateMat(const Mat<T>& mat) {
+  const size_t width = mat.GetWidth();
+  const size_t height = mat.GetHeight();
+  const size_t depth = mat.GetDepth();
+  Mat<T> rotated(height, width, depth);
+  const T* input = mat.GetPtr();
+  T* output = rotated.GetPtr();
+  for (size_t slice = 0; slice < depth; ++slice) {
+    for (size_t row = 0; row < height; ++row) {
+      for (size_t col = 0; col < width; ++col) {
+        output[(width - 1 - col) * height + row] = input[row * width + col];
+      }
+    }
+    input += width * height;
+    output += width * height;
+  }
+  return rotated;
+}
+
+}  // namespace
+
+struct PatchMatchCpu::SweepOptions {
+  float perturbation = 1.0f;
+  float depth_min = 0.0f;
+  float depth_max = 1.0f;
+  int num_samples = 15;
+  float sigma_spatial = 3.0f;
+  float sigma_color = 0.3f;
+  float ncc_sigma = 0.6f;
+  float min_triangulation_angle = 0.5f;
+  float incident_angle_sigma = 0.9f;
+  float prev_sel_prob_weight = 0.0f;
+  float geom_consistency_regularizer = 0.1f;
+  float geom_consistency_max_cost = 5.0f;
+  float filter_min_ncc = 0.1f;
+  float filter_min_triangulation_angle = 3.0f;
+  int filter_min_num_consistent = 2;
+  float filter_geom_consistency_max_cost = 1.0f;
+  bool geom_consistency_term = false;
+  bool filter_photo_consistency = false;
+  bool filter_geom_consistency = false;
+};
+
+// Scratch memory of a single column sweep. The arrays over the patch window
+// are laid out contiguously, so that the weighted sums of the NCC are
+// evaluated with vectorized Eigen expressions.
+struct PatchMatchCpu::ColumnWorkspace {
+  explicit ColumnWorkspace(const size_t num_window_pixels,
+                           const size_t num_src_images)
+      : ref_colors(num_window_pixels),
+        ref_weights(num_window_pixels),
+        src_cols(num_window_pixels),
+        src_rows(num_window_pixels),
+        src_inv_z(num_window_pixels),
+        src_colors(num_window_pixels),
+        forward_message(num_src_images),
+        sampling_probs(num_src_images) {}
+
+  // Reference patch colors with normalized bilateral weights and their
+  // weighted mean and variance.
+  Eigen::ArrayXf ref_colors;
+  Eigen::ArrayXf ref_weights;
+  float ref_color_mean = 0.0f;
+  float ref_color_var = 0.0f;
+
+  // Warped patch coordinates and colors in the source image.
+  Eigen::ArrayXf src_cols;
+  Eigen::ArrayXf src_rows;
+  Eigen::ArrayXf src_inv_z;
+  Eigen::ArrayXf src_colors;
+
+  std::vector<float> forward_message;
+  std::vector<float> sampling_probs;
+
+  std::mt19937 rng;
+};
+
+PatchMatchCpu::PatchMatchCpu(const PatchMatchOptions& options,
+                             const PatchMatch::Problem& problem)
+    : options_(options),
+      problem_(problem),
+      ref_width_(0),
+      ref_height_(0),
+      rotation_in_half_pi_(0),
+      num_sweeps_(0) {
+  thread_pool_ = std::make_unique<ThreadPool>(
+      GetEffectiveNumThreads(options_.num_threads));
+  InitRefImage();
+  InitSourceImages();
+  InitTransforms();
+  InitWorkspaceMemory();
+}
+
+void PatchMatchCpu::Run() {
+  Timer total_timer;
+  total_timer.Start();
+
+  Timer init_timer;
+  init_timer.Start();
+  ParallelForColumns([this](const int col, ColumnWorkspace* workspace) {
+    ComputeInitialCost(col, workspace);
+  });
+  LOG(INFO) << StringPrintf("Initialization: %.4fs",
+                            init_timer.ElapsedSeconds());
+
+  const float total_num_steps = options_.num_iterations * 4;
+
+  SweepOptions sweep_options;
+  sweep_options.depth_min = options_.depth_min;
+  sweep_options.depth_max = options_.depth_max;
+  sweep_options.sigma_spatial = options_.sigma_spatial;
+  sweep_options.sigma_color = options_.sigma_color;
+  sweep_options.num_samples = options_.num_samples;
+  sweep_options.ncc_sigma = options_.ncc_sigma;
+  sweep_options.min_triangulation_angle =
+      DegToRad(options_.min_triangulation_angle);
+  sweep_options.incident_angle_sigma = options_.incident_angle_sigma;
+  sweep_options.geom_consistency_regularizer =
+      options_.geom_consistency_regularizer;
+  sweep_options.geom_consistency_max_cost = options_.geom_consistency_max_cost;
+  sweep_options.filter_min_ncc = options_.filter_min_ncc;
+  sweep_options.filter_min_triangulation_angle =
+      DegToRad(options_.filter_min_triangulation_angle);
+  sweep_options.filter_min_num_consistent = options_.filter_min_num_consistent;
+  sweep_options.filter_geom_consistency_max_cost =
+      options_.filter_geom_consistency_max_cost;
+  sweep_options.geom_consistency_term = options_.geom_consistency;
+
+  for (int iter = 0; iter < options_.num_iterations; ++iter) {
+    Timer iter_timer;
+    iter_timer.Start();
+
+    for (int sweep = 0; sweep < 4; ++sweep) {
+      Timer sweep_timer;
+      sweep_timer.Start();
+
+      // Expenentially reduce amount of perturbation during the optimization.
+      sweep_options.perturbation = 1.0f / std::pow(2.0f, iter + sweep / 4.0f);
+
+      // Linearly increase the influence of previous selection probabilities.
+      sweep_options.prev_sel_prob_weight =
+          static_cast<float>(iter * 4 + sweep) / total_num_steps;
+
+      // Only filter in the very last sweep.
+      const bool last_sweep = iter == options_.num_iterations - 1 && sweep == 3;
+      if (last_sweep && options_.filter) {
+        consistency_mask_ = Mat<uint8_t>(cost_map_.GetWidth(),
+                                         cost_map_.GetHeight(),
+                                         cost_map_.GetDepth());
+        sweep_options.filter_photo_consistency = true;
+        sweep_options.filter_geom_consistency = options_.geom_consistency;
+      }
+
+      ParallelForColumns(
+          [this, &sweep_options](const int col, ColumnWorkspace* workspace) {
+            SweepFromTopToBottom(sweep_options, col, workspace);
+          });
+
+      num_sweeps_ += 1;
+
+      Rotate();
+
+      LOG(INFO) << StringPrintf(
+          " Sweep %d: %.4fs", sweep + 1, sweep_timer.ElapsedSeconds());
+    }
+
+    LOG(INFO) << StringPrintf(
+        "Iteration %d: %.4fs", iter + 1, iter_timer.ElapsedSeconds());
+  }
+
+  LOG(INFO) << StringPrintf("Total: %.4fs", total_timer.ElapsedSeconds());
+}
+
+DepthMap PatchMatchCpu::GetDepthMap() const {
+  return DepthMap(depth_map_, options_.depth_min, options_.depth_max);
+}
+
+NormalMap PatchMatchCpu::GetNormalMap() const { return NormalMap(normal_map_); }
+
+Mat<float> PatchMatchCpu::GetSelProbMap() const { return prev_sel_prob_map_; }
+
+std::vector<int> PatchMatchCpu::GetConsistentImageIdxs() const {
+  const Mat<uint8_t>& mask = consistency_mask_;
+  std::vector<int> consistent_image_idxs;
+  std::vector<int> pixel_consistent_image_idxs;
+  pixel_consistent_image_idxs.reserve(mask.GetDepth());
+  for (size_t r = 0; r < mask.GetHeight(); ++r) {
+    for (size_t c = 0; c < mask.GetWidth(); ++c) {
+      pixel_consistent_image_idxs.clear();
+      for (size_t d = 0; d < mask.GetDepth(); ++d) {
+        if (mask.Get(r, c, d)) {
+          pixel_consistent_image_idxs.push_back(problem_.src_image_idxs[d]);
+        }
+      }
+      if (pixel_consistent_image_idxs.size() > 0) {
+        consistent_image_idxs.push_back(c);
+        consistent_image_idxs.push_back(r);
+        consistent_image_idxs.push_back(pixel_consistent_image_idxs.size());
+        consistent_image_idxs.insert(consistent_image_idxs.end(),
+                                     pixel_consistent_image_idxs.begin(),
+                                     pixel_consistent_image_idxs.end());
+      }
+    }
+  }
+  return consistent_image_idxs;
+}
+
+void PatchMatchCpu::InitRefImage() {
+  const Image& ref_image = problem_.images->at(problem_.ref_image_idx);
+
+  ref_width_ = ref_image.GetWidth();
+  ref_height_ = ref_image.GetHeight();
+
+  const std::vector<uint8_t> ref_image_array =
+      ref_image.GetBitmap().ConvertToRowMajorArray();
+  ref_image_ = Mat<float>(ref_width_, ref_height_, 1);
+  std::transform(ref_image_array.begin(),
+                 ref_image_array.end(),
+                 ref_image_.GetPtr(),
+                 [](const uint8_t value) { return value / 255.0f; });
+
+  // The spatial part of the bilateral weights only depends on the offset
+  // within the window and is thus precomputed once.
+  const float spatial_normalization =
+      1.0f / (2.0f * options_.sigma_spatial * options_.sigma_spatial);
+  for (int row = -options_.window_radius; row <= options_.window_radius;
+       row += options_.window_step) {
+    for (int col = -options_.window_radius; col <= options_.window_radius;
+         col += options_.window_step) {
+      window_rows_.push_back(row);
+      window_cols_.push_back(col);
+      window_spatial_exponents_.push_back(-(row * row + col * col) *
+                                          spatial_normalization);
+    }
+  }
+}
+
+void PatchMatchCpu::InitSourceImages() {
+  src_images_.reserve(problem_.src_image_idxs.size());
+  for (const auto image_idx : problem_.src_image_idxs) {
+    const Image& image = problem_.images->at(image_idx);
+    const std::vector<uint8_t> image_array =
+        image.GetBitmap().ConvertToRowMajorArray();
+    Mat<float> src_image(image.GetWidth(), image.GetHeight(), 1);
+    std::transform(image_array.begin(),
+                   image_array.end(),
+                   src_image.GetPtr(),
+                   [](const uint8_t value) { return value / 255.0f; });
+    src_images_.push_back(std::move(src_image));
+  }
+
+  if (options_.geom_consistency) {
+    src_depth_maps_.reserve(problem_.src_image_idxs.size());
+    for (const auto image_idx : problem_.src_image_idxs) {
+      src_depth_maps_.push_back(&problem_.depth_maps->at(image_idx));
+    }
+  }
+}
+
+void PatchMatchCpu::InitTransforms() {
+  const Image& ref_image = problem_.images->at(problem_.ref_image_idx);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Generate rotated versions (counter-clockwise) of calibration matrix.
+  //////////////////////////////////////////////////////////////////////////////
+
+  for (size_t i = 0; i < 4; ++i) {
+    ref_K_[i][0] = ref_image.GetK()[0];
+    ref_K_[i][1] = ref_image.GetK()[2];
+    ref_K_[i][2] = ref_image.GetK()[4];
+    ref_K_[i][3] = ref_image.GetK()[5];
+  }
+
+  // Rotated by 90 degrees.
+  std::swap(ref_K_[1][0], ref_K_[1][2]);
+  std::swap(ref_K_[1][1], ref_K_[1][3]);
+  ref_K_[1][3] = ref_width_ - 1 - ref_K_[1][3];
+
+  // Rotated by 180 degrees.
+  ref_K_[2][1] = ref_width_ - 1 - ref_K_[2][1];
+  ref_K_[2][3] = ref_height_ - 1 - ref_K_[2][3];
+
+  // Rotated by 270 degrees.
+  std::swap(ref_K_[3][0], ref_K_[3][2]);
+  std::swap(ref_K_[3][1], ref_K_[3][3]);
+  ref_K_[3][1] = ref_height_ - 1 - ref_K_[3][1];
+
+  // Extract 1/fx, -cx/fx, fy, -cy/fy.
+  for (size_t i = 0; i < 4; ++i) {
+    ref_inv_K_[i][0] = 1.0f / ref_K_[i][0];
+    ref_inv_K_[i][1] = -ref_K_[i][1] / ref_K_[i][0];
+    ref_inv_K_[i][2] = 1.0f / ref_K_[i][2];
+    ref_inv_K_[i][3] = -ref_K_[i][3] / ref_K_[i][2];
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Generate rotated versions of camera poses.
+  //////////////////////////////////////////////////////////////////////////////
+
+  float rotated_R[9];
+  memcpy(rotated_R, ref_image.GetR(), 9 * sizeof(float));
+
+  float rotated_T[3];
+  memcpy(rotated_T, ref_image.GetT(), 3 * sizeof(float));
+
+  // Matrix for 90deg rotation around Z-axis in counter-clockwise direction.
+  const float R_z90[9] = {0, 1, 0, -1, 0, 0, 0, 0, 1};
+
+  for (size_t i = 0; i < 4; ++i) {
+    std::vector<float>& poses = poses_[i];
+    poses.resize(kNumTformParams * problem_.src_image_idxs.size());
+    float* pose = poses.data();
+    for (const auto image_idx : problem_.src_image_idxs) {
+      const Image& image = problem_.images->at(image_idx);
+
+      // Layout: K(0, 0), K(0, 2), K(1, 1), K(1, 2), R(:), T(:), C(:), P(:),
+      // inv(P)(:) as the relative transformation from the rotated reference
+      // image to the source image.
+      pose[0] = image.GetK()[0];
+      pose[1] = image.GetK()[2];
+      pose[2] = image.GetK()[4];
+      pose[3] = image.GetK()[5];
+      float* rel_R = pose + 4;
+      float* rel_T = pose + 13;
+      ComputeRelativePose(
+          rotated_R, rotated_T, image.GetR(), image.GetT(), rel_R, rel_T);
+      ComputeProjectionCenter(rel_R, rel_T, pose + 16);
+      ComposeProjectionMatrix(image.GetK(), rel_R, rel_T, pose + 19);
+      ComposeInverseProjectionMatrix(image.GetK(), rel_R, rel_T, pose + 31);
+      pose += kNumTformParams;
+    }
+
+    RotatePose(R_z90, rotated_R, rotated_T);
+  }
+}
+
+void PatchMatchCpu::InitWorkspaceMemory() {
+  const size_t num_src_images = problem_.src_image_idxs.size();
+
+  if (options_.geom_consistency) {
+    depth_map_ = problem_.depth_maps->at(problem_.ref_image_idx);
+    normal_map_ = problem_.normal_maps->at(problem_.ref_image_idx);
+  } else {
+    std::mt19937 rng(problem_.ref_image_idx);
+    const size_t num_pixels = ref_width_ * ref_height_;
+    depth_map_ = Mat<float>(ref_width_, ref_height_, 1);
+    float* depth_data = depth_map_.GetPtr();
+    for (size_t i = 0; i < num_pixels; ++i) {
+      depth_data[i] =
+          GenerateRandomDepth(options_.depth_min, options_.depth_max, &rng);
+    }
+    normal_map_ = Mat<float>(ref_width_, ref_height_, 3);
+    float* normal_data = normal_map_.GetPtr();
+    for (size_t row = 0; row < ref_height_; ++row) {
+      for (size_t col = 0; col < ref_width_; ++col) {
+        float normal[3];
+        GenerateRandomNormal(row, col, ref_inv_K_[0], &rng, normal);
+        for (int d = 0; d < 3; ++d) {
+          normal_data[d * num_pixels + row * ref_width_ + col] = normal[d];
+        }
+      }
+    }
+  }
+
+  sel_prob_map_ = Mat<float>(ref_width_, ref_height_, num_src_images);
+  prev_sel_prob_map_ = Mat<float>(ref_width_, ref_height_, num_src_images);
+  prev_sel_prob_map_.Fill(0.5f);
+
+  cost_map_ = Mat<float>(ref_width_, ref_height_, num_src_images);
+
+  consistency_mask_ = Mat<uint8_t>(0, 0, 0);
+}
+
+template <typename Func>
+void PatchMatchCpu::ParallelForColumns(Func&& func) {
+  const int width = cost_map_.GetWidth();
+  const int num_tasks =
+      std::min(width, 4 * static_cast<int>(thread_pool_->NumThreads()));
+  const int num_cols_per_task = (width + num_tasks - 1) / num_tasks;
+  for (int start_col = 0; start_col < width; start_col += num_cols_per_task) {
+    const int end_col = std::min(width, start_col + num_cols_per_task);
+    thread_pool_->AddTask([this, &func, start_col, end_col]() {
+      ColumnWorkspace workspace(window_rows_.size(),
+                                problem_.src_image_idxs.size());
+      for (int col = start_col; col < end_col; ++col) {
+        std::seed_seq seed{problem_.ref_image_idx, num_sweeps_, col};
+        workspace.rng.seed(seed);
+        func(col, &workspace);
+      }
+    });
+  }
+  thread_pool_->Wait();
+}
+
+void PatchMatchCpu::ReadRefPatch(const int row,
+                                 const int col,
+                                 ColumnWorkspace* workspace) const {
+  const int width = ref_image_.GetWidth();
+  const int height = ref_image_.GetHeight();
+  const float* ref_image = ref_image_.GetPtr();
+  const auto get_color = [&](const int r, const int c) {
+    return (r >= 0 && c >= 0 && r < height && c < width)
+               ? ref_image[r * width + c]
+               : 0.0f;
+  };
+
+  const int num_window_pixels = window_rows_.size();
+  for (int i = 0; i < num_window_pixels; ++i) {
+    workspace->ref_colors[i] =
+        get_color(row + static_cast<int>(window_rows_[i]),
+                  col + static_cast<int>(window_cols_[i]));
+  }
+
+  const float center_color = get_color(row, col);
+  const float color_normalization =
+      1.0f / (2.0f * options_.sigma_color * options_.sigma_color);
+  const Eigen::Map<const Eigen::ArrayXf> spatial_exponents(
+      window_spatial_exponents_.data(), num_window_pixels);
+  workspace->ref_weights =
+      (spatial_exponents -
+       (workspace->ref_colors - center_color).square() * color_normalization)
+          .exp();
+  workspace->ref_weights /= workspace->ref_weights.sum();
+
+  workspace->ref_color_mean =
+      (workspace->ref_weights * workspace->ref_colors).sum();
+  workspace->ref_color_var =
+      (workspace->ref_weights * workspace->ref_colors.square()).sum() -
+      workspace->ref_color_mean * workspace->ref_color_mean;
+}
+
+float PatchMatchCpu::ComputePhotoConsistencyCost(
+    const int src_image_idx,
+    const int row,
+    const int col,
+    const float depth,
+    const float normal[3],
+    ColumnWorkspace* workspace) const {
+  // Based on Jensen's Inequality for convex functions, the variance
+  // should always be larger than 0. Do not make this threshold smaller.
+  constexpr float kMinVar = 1e-5f;
+  if (workspace->ref_color_var < kMinVar) {
+    return kMaxCost;
+  }
+
+  float H[9];
+  ComposeHomography(
+      poses_[rotation_in_half_pi_].data() + src_image_idx * kNumTformParams,
+      ref_inv_K_[rotation_in_half_pi_],
+      row,
+      col,
+      depth,
+      normal,
+      H);
+
+  // Warp the patch into the source image.
+  const int num_window_pixels = window_rows_.size();
+  const Eigen::Map<const Eigen::ArrayXf> window_rows(window_rows_.data(),
+                                                     num_window_pixels);
+  const Eigen::Map<const Eigen::ArrayXf> window_cols(window_cols_.data(),
+                                                     num_window_pixels);
+  const auto ref_rows = window_rows + static_cast<float>(row);
+  const auto ref_cols = window_cols + static_cast<float>(col);
+  workspace->src_inv_z = (H[6] * ref_cols + H[7] * ref_rows + H[8]).inverse();
+  workspace->src_cols =
+      (H[0] * ref_cols + H[1] * ref_rows + H[2]) * workspace->src_inv_z;
+  workspace->src_rows =
+      (H[3] * ref_cols + H[4] * ref_rows + H[5]) * workspace->src_inv_z;
+
+  const Mat<float>& src_image = src_images_[src_image_idx];
+  const int src_width = src_image.GetWidth();
+  const int src_height = src_image.GetHeight();
+  for (int i = 0; i < num_window_pixels; ++i) {
+    workspace->src_colors[i] = InterpolateBilinear(src_image.GetPtr(),
+                                                   src_width,
+                                                   src_height,
+                                                   workspace->src_cols[i],
+                                                   workspace->src_rows[i]);
+  }
+
+  // Bilaterally weighted statistics with normalized weights.
+  const auto& weights = workspace->ref_weights;
+  const auto& src_colors = workspace->src_colors;
+  const float src_color_mean = (weights * src_colors).sum();
+  const float src_color_var = (weights * src_colors.square()).sum() -
+                              src_color_mean * src_color_mean;
+  if (src_color_var < kMinVar) {
+    return kMaxCost;
+  }
+
+  const float src_ref_color_covar =
+      (weights * src_colors * workspace->ref_colors).sum() -
+      workspace->ref_color_mean * src_color_mean;
+  const float src_ref_color_var =
+      std::sqrt(workspace->ref_color_var * src_color_var);
+  return std::max(
+      0.0f, std::min(kMaxCost, 1.0f - src_ref_color_covar / src_ref_color_var));
+}
+
+float PatchMatchCpu::ComputeGeomConsistencyCost(const int src_image_idx,
+                                                const float row,
+                                                const float col,
+                                                const float depth,
+                                                const float max_cost) const {
+  // Extract projection matrices for source image.
+  const float* pose =
+      poses_[rotation_in_half_pi_].data() + src_image_idx * kNumTformParams;
+  const float* P = pose + 19;
+  const float* inv_P = pose + 31;
+  const float* ref_K = ref_K_[rotation_in_half_pi_];
+
+  // Project point in reference image to world.
+  float forward_point[3];
+  ComputePointAtDepth(
+      ref_inv_K_[rotation_in_half_pi_], row, col, depth, forward_point);
+
+  // Project world point to source image.
+  const float inv_forward_z =
+      1.0f / (P[8] * forward_point[0] + P[9] * forward_point[1] +
+              P[10] * forward_point[2] + P[11]);
+  float src_col =
+      inv_forward_z * (P[0] * forward_point[0] + P[1] * forward_point[1] +
+                       P[2] * forward_point[2] + P[3]);
+  float src_row =
+      inv_forward_z * (P[4] * forward_point[0] + P[5] * forward_point[1] +
+                       P[6] * forward_point[2] + P[7]);
+
+  // Extract depth in source image.
+  const DepthMap& src_depth_map = *src_depth_maps_[src_image_idx];
+  const float src_depth_col = std::floor(src_col + 0.5f);
+  const float src_depth_row = std::floor(src_row + 0.5f);
+  if (!(src_depth_col >= 0 && src_depth_row >= 0 &&
+        src_depth_col < src_depth_map.GetWidth() &&
+        src_depth_row < src_depth_map.GetHeight())) {
+    return max_cost;
+  }
+  const float src_depth =
+      src_depth_map.GetPtr()[static_cast<size_t>(src_depth_row) *
+                                 src_depth_map.GetWidth() +
+                             static_cast<size_t>(src_depth_col)];
+
+  // Projection outside of source image.
+  if (src_depth == 0.0f) {
+    return max_cost;
+  }
+
+  // Project point in source image to world.
+  src_col *= src_depth;
+  src_row *= src_depth;
+  const float backward_point_x =
+      inv_P[0] * src_col + inv_P[1] * src_row + inv_P[2] * src_depth + inv_P[3];
+  const float backward_point_y =
+      inv_P[4] * src_col + inv_P[5] * src_row + inv_P[6] * src_depth + inv_P[7];
+  const float backward_point_z = inv_P[8] * src_col + inv_P[9] * src_row +
+                                 inv_P[10] * src_depth + inv_P[11];
+  const float inv_backward_point_z = 1.0f / backward_point_z;
+
+  // Project world point back to reference image.
+  const float backward_col =
+      inv_backward_point_z *
+      (ref_K[0] * backward_point_x + ref_K[1] * backward_point_z);
+  const float backward_row =
+      inv_backward_point_z *
+      (ref_K[2] * backward_point_y + ref_K[3] * backward_point_z);
+
+  // Return truncated reprojection error between original observation and
+  // the forward-backward projected observation.
+  const float diff_col = col - backward_col;
+  const float diff_row = row - backward_row;
+  return std::min(max_cost,
+                  std::sqrt(diff_col * diff_col + diff_row * diff_row));
+}
+
+void PatchMatchCpu::ComputeInitialCost(const int col,
+                                       ColumnWorkspace* workspace) {
+  const size_t width = cost_map_.GetWidth();
+  const size_t height = cost_map_.GetHeight();
+  const size_t num_pixels = width * height;
+  const int num_src_images = cost_map_.GetDepth();
+  const float* depth_map = depth_map_.GetPtr();
+  const float* normal_map = normal_map_.GetPtr();
+  float* cost_map = cost_map_.GetPtr();
+
+  for (size_t row = 0; row < height; ++row) {
+    const size_t pixel_idx = row * width + col;
+    const float normal[3] = {normal_map[pixel_idx],
+                             normal_map[num_pixels + pixel_idx],
+                             normal_map[2 * num_pixels + pixel_idx]};
+    ReadRefPatch(row, col, workspace);
+    for (int image_idx = 0; image_idx < num_src_images; ++image_idx) {
+      cost_map[image_idx * num_pixels + pixel_idx] =
+          ComputePhotoConsistencyCost(
+              image_idx, row, col, depth_map[pixel_idx], normal, workspace);
+    }
+  }
+}
+
+void PatchMatchCpu::SweepFromTopToBottom(const SweepOptions& options,
+                                         const int col,
+                                         ColumnWorkspace* workspace) {
+  const int width = cost_map_.GetWidth();
+  const int height = cost_map_.GetHeight();
+  const size_t num_pixels = static_cast<size_t>(width) * height;
+  const int num_src_images = cost_map_.GetDepth();
+  const float* ref_inv_K = ref_inv_K_[rotation_in_half_pi_];
+  const float* poses = poses_[rotation_in_half_pi_].data();
+
+  float* cost_map = cost_map_.GetPtr();
+  float* depth_map = depth_map_.GetPtr();
+  float* normal_map = normal_map_.GetPtr();
+  float* sel_prob_map = sel_prob_map_.GetPtr();
+  const float* prev_sel_prob_map = prev_sel_prob_map_.GetPtr();
+  uint8_t* consistency_mask = consistency_mask_.GetPtr();
+
+  float* forward_message = workspace->forward_message.data();
+  float* sampling_probs = workspace->sampling_probs.data();
+  std::mt19937* rng = &workspace->rng;
+
+  LikelihoodComputer likelihood_computer(options.ncc_sigma,
+                                         options.min_triangulation_angle,
+                                         options.incident_angle_sigma);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Compute backward message for all rows. Note that the backward messages are
+  // temporarily stored in the sel_prob_map and replaced row by row as the
+  // updated forward messages are computed further below.
+  //////////////////////////////////////////////////////////////////////////////
+
+  for (int image_idx = 0; image_idx < num_src_images; ++image_idx) {
+    // Compute backward message.
+    float beta = kUniformProb;
+    for (int row = height - 1; row >= 0; --row) {
+      const size_t idx = image_idx * num_pixels + row * width + col;
+      beta = likelihood_computer.ComputeBackwardMessage(cost_map[idx], beta);
+      sel_prob_map[idx] = beta;
+    }
+
+    // Initialize forward message.
+    forward_message[image_idx] = kUniformProb;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Estimate parameters for remaining rows and compute selection probabilities.
+  //////////////////////////////////////////////////////////////////////////////
+
+  struct ParamState {
+    float depth = 0.0f;
+    float normal[3] = {0};
+  };
+
+  // Parameters of previous pixel in column.
+  ParamState prev_param_state;
+  // Parameters of current pixel in column.
+  ParamState curr_param_state;
+  // Randomly sampled parameters.
+  ParamState rand_param_state;
+
+  // Parameters for first row in column.
+  prev_param_state.depth = depth_map[col];
+  for (int i = 0; i < 3; ++i) {
+    prev_param_state.normal[i] = normal_map[i * num_pixels + col];
+  }
+
+  for (int row = 0; row < height; ++row) {
+    const size_t pixel_idx = static_cast<size_t>(row) * width + col;
+
+    ReadRefPatch(row, col, workspace);
+
+    // Propagate the depth at which the current ray intersects with the plane
+    // of the normal of the previous ray. This helps to better estimate
+    // the depth of very oblique structures, i.e. pixels whose normal direction
+    // is significantly different from their viewing direction.
+    prev_param_state.depth = PropagateDepth(ref_inv_K,
+                                            prev_param_state.depth,
+                                            prev_param_state.normal,
+                                            row - 1,
+                                            row);
+
+    // Read parameters for current pixel from previous sweep.
+    curr_param_state.depth = depth_map[pixel_idx];
+    for (int i = 0; i < 3; ++i) {
+      curr_param_state.normal[i] = normal_map[i * num_pixels + pixel_idx];
+    }
+
+    // Generate random parameters.
+    rand_param_state.depth =
+        PerturbDepth(options.perturbation, curr_param_state.depth, rng);
+    PerturbNormal(row,
+                  col,
+                  options.perturbation * M_PI,
+                  curr_param_state.normal,
+                  ref_inv_K,
+                  rng,
+                  rand_param_state.normal);
+
+    // Read in the backward message, compute selection probabilities and
+    // modulate selection probabilities with priors.
+
+    float point[3];
+    ComputePointAtDepth(ref_inv_K, row, col, curr_param_state.depth, point);
+
+    for (int image_idx = 0; image_idx < num_src_images; ++image_idx) {
+      const size_t idx = image_idx * num_pixels + pixel_idx;
+      const float cost = cost_map[idx];
+      const float alpha = likelihood_computer.ComputeForwardMessage(
+          cost, forward_message[image_idx]);
+      const float beta = sel_prob_map[idx];
+      const float prev_prob = prev_sel_prob_map[idx];
+      const float sel_prob = likelihood_computer.ComputeSelProb(
+          alpha, beta, prev_prob, options.prev_sel_prob_weight);
+
+      const float* pose = poses + image_idx * kNumTformParams;
+
+      float cos_triangulation_angle;
+      float cos_incident_angle;
+      ComputeViewingAngles(pose,
+                           point,
+                           curr_param_state.normal,
+                           &cos_triangulation_angle,
+                           &cos_incident_angle);
+      const float tri_prob =
+          likelihood_computer.ComputeTriProb(cos_triangulation_angle);
+      const float inc_prob =
+          likelihood_computer.ComputeIncProb(cos_incident_angle);
+
+      float H[9];
+      ComposeHomography(pose,
+                        ref_inv_K,
+                        row,
+                        col,
+                        curr_param_state.depth,
+                        curr_param_state.normal,
+                        H);
+      const float res_prob = likelihood_computer.ComputeResolutionProb(
+          options_.window_radius, H, row, col);
+
+      sampling_probs[image_idx] = sel_prob * tri_prob * inc_prob * res_prob;
+    }
+
+    TransformPDFToCDF(sampling_probs, num_src_images);
+
+    // Compute matching cost using Monte Carlo sampling of source images. Images
+    // with higher selection probability are more likely to be sampled. Hence,
+    // if only very few source images see the reference image pixel, the same
+    // source image is likely to be sampled many times. Instead of taking
+    // the best K probabilities, this sampling scheme has the advantage of
+    // being adaptive to any distribution of selection probabilities.
+
+    constexpr int kNumCosts = 5;
+    float costs[kNumCosts] = {0};
+    const float depths[kNumCosts] = {curr_param_state.depth,
+                                     prev_param_state.depth,
+                                     rand_param_state.depth,
+                                     curr_param_state.depth,
+                                     rand_param_state.depth};
+    const float* normals[kNumCosts] = {curr_param_state.normal,
+                                       prev_param_state.normal,
+                                       rand_param_state.normal,
+                                       rand_param_state.normal,
+                                       curr_param_state.normal};
+
+    for (int sample = 0; sample < options.num_samples; ++sample) {
+      const float rand_prob = RandomUniform(rng) - FLT_EPSILON;
+
+      int src_image_idx = -1;
+      for (int image_idx = 0; image_idx < num_src_images; ++image_idx) {
+        if (sampling_probs[image_idx] > rand_prob) {
+          src_image_idx = image_idx;
+          break;
+        }
+      }
+
+      if (src_image_idx == -1) {
+        continue;
+      }
+
+      costs[0] += cost_map[src_image_idx * num_pixels + pixel_idx];
+      if (options.geom_consistency_term) {
+        costs[0] +=
+            options.geom_consistency_regularizer *
+            ComputeGeomConsistencyCost(src_image_idx,
+                                       row,
+                                       col,
+                                       depths[0],
+                                       options.geom_consistency_max_cost);
+      }
+
+      for (int i = 1; i < kNumCosts; ++i) {
+        costs[i] += ComputePhotoConsistencyCost(
+            src_image_idx, row, col, depths[i], normals[i], workspace);
+        if (options.geom_consistency_term) {
+          costs[i] +=
+              options.geom_consistency_regularizer *
+              ComputeGeomConsistencyCost(src_image_idx,
+                                         row,
+                                         col,
+                                         depths[i],
+                                         options.geom_consistency_max_cost);
+        }
+      }
+    }
+
+    // Find the parameters of the minimum cost.
+    const int min_cost_idx = FindMinCost<kNumCosts>(costs);
+    const float best_depth = depths[min_cost_idx];
+    float best_normal[3];
+    std::copy(normals[min_cost_idx], normals[min_cost_idx] + 3, best_normal);
+
+    // Save best new parameters.
+    depth_map[pixel_idx] = best_depth;
+    for (int i = 0; i < 3; ++i) {
+      normal_map[i * num_pixels + pixel_idx] = best_normal[i];
+    }
+
+    // Use the new cost to recompute the updated forward message and
+    // the selection probability.
+    for (int image_idx = 0; image_idx < num_src_images; ++image_idx) {
+      const size_t idx = image_idx * num_pixels + pixel_idx;
+
+      // Determine the cost for best depth.
+      if (min_cost_idx != 0) {
+        cost_map[idx] = ComputePhotoConsistencyCost(
+            image_idx, row, col, best_depth, best_normal, workspace);
+      }
+
+      const float alpha = likelihood_computer.ComputeForwardMessage(
+          cost_map[idx], forward_message[image_idx]);
+      const float beta = sel_prob_map[idx];
+      const float prev_prob = prev_sel_prob_map[idx];
+      const float prob = likelihood_computer.ComputeSelProb(
+          alpha, beta, prev_prob, options.prev_sel_prob_weight);
+      forward_message[image_idx] = alpha;
+      sel_prob_map[idx] = prob;
+    }
+
+    if (options.filter_photo_consistency || options.filter_geom_consistency) {
+      int num_consistent = 0;
+
+      float best_point[3];
+      ComputePointAtDepth(ref_inv_K, row, col, best_depth, best_point);
+
+      const float min_ncc_prob =
+          likelihood_computer.ComputeNCCProb(1.0f - options.filter_min_ncc);
+      const float cos_min_triangulation_angle =
+          std::cos(options.filter_min_triangulation_angle);
+
+      for (int image_idx = 0; image_idx < num_src_images; ++image_idx) {
+        const size_t idx = image_idx * num_pixels + pixel_idx;
+
+        float cos_triangulation_angle;
+        float cos_incident_angle;
+        ComputeViewingAngles(poses + image_idx * kNumTformParams,
+                             best_point,
+                             best_normal,
+                             &cos_triangulation_angle,
+                             &cos_incident_angle);
+        if (cos_triangulation_angle > cos_min_triangulation_angle ||
+            cos_incident_angle <= 0.0f) {
+          continue;
+        }
+
+        const bool photo_consistent = !options.filter_photo_consistency ||
+                                      sel_prob_map[idx] >= min_ncc_prob;
+        const bool geom_consistent =
+            !options.filter_geom_consistency ||
+            ComputeGeomConsistencyCost(image_idx,
+                                       row,
+                                       col,
+                                       best_depth,
+                                       options.geom_consistency_max_cost) <=
+                options.filter_geom_consistency_max_cost;
+        if (photo_consistent && geom_consistent) {
+          consistency_mask[idx] = 1;
+          num_consistent += 1;
+        }
+      }
+
+      if (num_consistent < options.filter_min_num_consistent) {
+        depth_map[pixel_idx] = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+          normal_map[i * num_pixels + pixel_idx] = 0.0f;
+        }
+        for (int image_idx = 0; image_idx < num_src_images; ++image_idx) {
+          consistency_mask[image_idx * num_pixels + pixel_idx] = 0;
+        }
+      }
+    }
+
+    // Update previous depth for next row.
+    prev_param_state.depth = best_depth;
+    for (int i = 0; i < 3; ++i) {
+      prev_param_state.normal[i] = best_normal[i];
+    }
+  }
+}
+
+void PatchMatchCpu::Rotate() {
+  rotation_in_half_pi_ = (rotation_in_half_pi_ + 1) % 4;
+
+  // Rotate normals by 90deg around z-axis in counter-clockwise direction.
+  {
+    const size_t num_pixels = normal_map_.GetWidth() * normal_map_.GetHeight();
+    float* normal_x = normal_map_.GetPtr();
+    float* normal_y = normal_x + num_pixels;
+    for (size_t i = 0; i < num_pixels; ++i) {
+      const float rotated_normal_x = normal_y[i];
+      normal_y[i] = -normal_x[i];
+      normal_x[i] = rotated_normal_x;
+    }
+  }
+
+  ref_image_ = RotateMat(ref_image_);
+  depth_map_ = RotateMat(depth_map_);
+  normal_map_ = RotateMat(normal_map_);
+  cost_map_ = RotateMat(cost_map_);
+
+  // Rotate selection probability map.
+  prev_sel_prob_map_ = RotateMat(sel_prob_map_);
+  sel_prob_map_ = Mat<float>(prev_sel_prob_map_.GetWidth(),
+                             prev_sel_prob_map_.GetHeight(),
+                             prev_sel_prob_map_.GetDepth());
+
+  // Rotate selected image map.
+  if (consistency_mask_.GetDepth() > 0) {
+    consistency_mask_ = RotateMat(consistency_mask_);
+  }
+}
+
+}  // namespace mvs
+}  // namespace colmap
@@ -0,0 +1,152 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/mvs/depth_map.h"
+#include "colmap/mvs/image.h"
+#include "colmap/mvs/mat.h"
+#include "colmap/mvs/normal_map.h"
+#include "colmap/mvs/patch_match.h"
+#include "colmap/util/threading.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace colmap {
+namespace mvs {
+
+// Multi-threaded CPU implementation of the patch match stereo algorithm with
+// the same semantics as PatchMatchCuda, i.e., bilaterally weighted NCC,
+// probabilistic view selection, geometric consistency, and filtering. As in the
+// Cuda implementation, every sweep processes the columns of the (rotated)
+// reference image independently from top to bottom, so that the columns are
+// distributed over the threads of a thread pool.
+class PatchMatchCpu {
+ public:
+  PatchMatchCpu(const PatchMatchOptions& options,
+                const PatchMatch::Problem& problem);
+
+  void Run();
+
+  DepthMap GetDepthMap() const;
+  NormalMap GetNormalMap() const;
+  Mat<float> GetSelProbMap() const;
+  std::vector<int> GetConsistentImageIdxs() const;
+
+ private:
+  struct SweepOptions;
+  struct ColumnWorkspace;
+
+  void InitRefImage();
+  void InitSourceImages();
+  void InitTransforms();
+  void InitWorkspaceMemory();
+
+  // Run the given function for all columns of the current reference image.
+  template <typename Func>
+  void ParallelForColumns(Func&& func);
+
+  void ComputeInitialCost(int col, ColumnWorkspace* workspace);
+  void SweepFromTopToBottom(const SweepOptions& options,
+                            int col,
+                            ColumnWorkspace* workspace);
+
+  // Compute the bilaterally weighted reference patch around the given pixel.
+  void ReadRefPatch(int row, int col, ColumnWorkspace* workspace) const;
+
+  // Compute the photo-consistency cost as 1 - NCC between the reference patch
+  // in the workspace and the patch warped into the given source image.
+  float ComputePhotoConsistencyCost(int src_image_idx,
+                                    int row,
+                                    int col,
+                                    float depth,
+                                    const float normal[3],
+                                    ColumnWorkspace* workspace) const;
+
+  float ComputeGeomConsistencyCost(int src_image_idx,
+                                   float row,
+                                   float col,
+                                   float depth,
+                                   float max_cost) const;
+
+  // Rotate reference image by 90 degrees in counter-clockwise direction.
+  void Rotate();
+
+  const PatchMatchOptions options_;
+  const PatchMatch::Problem problem_;
+
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  // Original (not rotated) dimension of reference image.
+  size_t ref_width_;
+  size_t ref_height_;
+
+  // Rotation of reference image in pi/2. This is equivalent to the number of
+  // calls to `rotate` mod 4.
+  int rotation_in_half_pi_;
+
+  // Window offsets and their spatial bilateral weight exponents.
+  std::vector<float> window_rows_;
+  std::vector<float> window_cols_;
+  std::vector<float> window_spatial_exponents_;
+
+  // Source images with intensities normalized to [0, 1] and their depth maps
+  // for the geometric consistency term. Both are in the source image frame
+  // and are thus independent of the rotation of the reference image.
+  std::vector<Mat<float>> src_images_;
+  std::vector<const DepthMap*> src_depth_maps_;
+
+  // Relative poses from rotated versions of reference image to source images
+  // with the same layout as the poses texture in PatchMatchCuda.
+  std::vector<float> poses_[4];
+
+  // Calibration matrix for rotated versions of reference image
+  // as {K[0, 0], K[0, 2], K[1, 1], K[1, 2]}, indexed by rotation_in_half_pi_.
+  float ref_K_[4][4];
+  float ref_inv_K_[4][4];
+
+  // Data for the (rotated) reference image.
+  Mat<float> ref_image_;
+  Mat<float> depth_map_;
+  Mat<float> normal_map_;
+  Mat<float> sel_prob_map_;
+  Mat<float> prev_sel_prob_map_;
+  Mat<float> cost_map_;
+  Mat<uint8_t> consistency_mask_;
+
+  // Number of completed sweeps used to seed the per-column random generators,
+  // which makes the result independent of the number of threads.
+  int num_sweeps_;
+};
+
+}  // namespace mvs
+}  // namespace colmap
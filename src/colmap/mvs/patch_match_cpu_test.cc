@@ -0,0 +1,196 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/patch_match_cpu.h"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr float kFocalLength = 50;
+constexpr float kPlaneDepth = 5;
+
+float PlaneTexture(const float x, const float y) {
+  return 0.5f + 0.2f * std::sin(7.1f * x + 2.3f * y) +
+         0.15f * std::sin(3.7f * y - 5.3f * x) +
+         0.1f * std::cos(11.3f * x * y + 1.7f * y);
+}
+
+// Renders a fronto-parallel textured plane at depth kPlaneDepth as seen by a
+// camera with identity rotation at the given position.
+Image CreateImage(const float center_x, const float center_y) {
+  const float K[9] = {kFocalLength,
+                      0,
+                      kWidth / 2.0f,
+                      0,
+                      kFocalLength,
+                      kHeight / 2.0f,
+                      0,
+                      0,
+                      1};
+  const float R[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  const float T[3] = {-center_x, -center_y, 0};
+  Image image("", kWidth, kHeight, K, R, T);
+
+  Bitmap bitmap;
+  bitmap.Allocate(kWidth, kHeight, /*as_rgb=*/false);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      const float plane_x =
+          center_x + kPlaneDepth * (x - K[2]) / kFocalLength;
+      const float plane_y =
+          center_y + kPlaneDepth * (y - K[5]) / kFocalLength;
+      const float value = std::min(
+          1.0f, std::max(0.0f, PlaneTexture(plane_x, plane_y)));
+      bitmap.SetPixel(
+          x, y, BitmapColor<uint8_t>(static_cast<uint8_t>(255 * value)));
+    }
+  }
+  image.SetBitmap(bitmap);
+  return image;
+}
+
+class PatchMatchCpuTests : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    images_ = {CreateImage(0, 0),
+               CreateImage(-0.5, 0),
+               CreateImage(0.5, 0),
+               CreateImage(0, 0.5)};
+    for (size_t i = 0; i < images_.size(); ++i) {
+      DepthMap depth_map(kWidth, kHeight, 1, 10);
+      depth_map.Fill(kPlaneDepth);
+      depth_maps_.push_back(depth_map);
+      NormalMap normal_map(kWidth, kHeight);
+      for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x < kWidth; ++x) {
+          normal_map.Set(y, x, 2, -1);
+        }
+      }
+      normal_maps_.push_back(normal_map);
+    }
+
+    problem_.ref_image_idx = 0;
+    problem_.src_image_idxs = {1, 2, 3};
+    problem_.images = &images_;
+    problem_.depth_maps = &depth_maps_;
+    problem_.normal_maps = &normal_maps_;
+
+    options_.use_gpu = false;
+    options_.depth_min = 1;
+    options_.depth_max = 10;
+    options_.window_radius = 3;
+    options_.sigma_spatial = 3;
+    options_.num_iterations = 3;
+    options_.geom_consistency = false;
+    options_.filter = true;
+  }
+
+  // Fraction of pixels with valid depth close to the ground-truth plane.
+  static double FractionOfAccurateDepths(const DepthMap& depth_map) {
+    int num_accurate = 0;
+    for (size_t y = 0; y < depth_map.GetHeight(); ++y) {
+      for (size_t x = 0; x < depth_map.GetWidth(); ++x) {
+        if (std::abs(depth_map.Get(y, x) - kPlaneDepth) < 0.05f) {
+          ++num_accurate;
+        }
+      }
+    }
+    return static_cast<double>(num_accurate) /
+           (depth_map.GetWidth() * depth_map.GetHeight());
+  }
+
+  std::vector<Image> images_;
+  std::vector<DepthMap> depth_maps_;
+  std::vector<NormalMap> normal_maps_;
+  PatchMatch::Problem problem_;
+  PatchMatchOptions options_;
+};
+
+TEST_F(PatchMatchCpuTests, Photometric) {
+  PatchMatchCpu patch_match(options_, problem_);
+  patch_match.Run();
+
+  const DepthMap depth_map = patch_match.GetDepthMap();
+  EXPECT_EQ(depth_map.GetWidth(), kWidth);
+  EXPECT_EQ(depth_map.GetHeight(), kHeight);
+  EXPECT_GT(FractionOfAccurateDepths(depth_map), 0.7);
+
+  const NormalMap normal_map = patch_match.GetNormalMap();
+  EXPECT_EQ(normal_map.GetWidth(), kWidth);
+  EXPECT_EQ(normal_map.GetHeight(), kHeight);
+  EXPECT_LT(normal_map.Get(kHeight / 2, kWidth / 2, 2), -0.9);
+
+  const Mat<float> sel_prob_map = patch_match.GetSelProbMap();
+  EXPECT_EQ(sel_prob_map.GetWidth(), kWidth);
+  EXPECT_EQ(sel_prob_map.GetHeight(), kHeight);
+  EXPECT_EQ(sel_prob_map.GetDepth(), problem_.src_image_idxs.size());
+
+  // The consistency graph is a sequence of (col, row, num_images, images...).
+  const std::vector<int> consistent_image_idxs =
+      patch_match.GetConsistentImageIdxs();
+  ASSERT_FALSE(consistent_image_idxs.empty());
+  EXPECT_LT(consistent_image_idxs[0], kWidth);
+  EXPECT_LT(consistent_image_idxs[1], kHeight);
+  EXPECT_GE(consistent_image_idxs[2], options_.filter_min_num_consistent);
+}
+
+TEST_F(PatchMatchCpuTests, GeometricConsistency) {
+  options_.geom_consistency = true;
+  PatchMatchCpu patch_match(options_, problem_);
+  patch_match.Run();
+  EXPECT_GT(FractionOfAccurateDepths(patch_match.GetDepthMap()), 0.7);
+  EXPECT_FALSE(patch_match.GetConsistentImageIdxs().empty());
+}
+
+TEST_F(PatchMatchCpuTests, IndependentOfNumThreads) {
+  options_.num_iterations = 1;
+  options_.num_threads = 1;
+  PatchMatchCpu patch_match1(options_, problem_);
+  patch_match1.Run();
+  options_.num_threads = 3;
+  PatchMatchCpu patch_match2(options_, problem_);
+  patch_match2.Run();
+  EXPECT_EQ(patch_match1.GetDepthMap().GetData(),
+            patch_match2.GetDepthMap().GetData());
+  EXPECT_EQ(patch_match1.GetNormalMap().GetData(),
+            patch_match2.GetNormalMap().GetData());
+  EXPECT_EQ(patch_match1.GetConsistentImageIdxs(),
+            patch_match2.GetConsistentImageIdxs());
+}
+
+}  // namespace
+}  // namespace mvs
+}  // namespace colmap
@@ -37,7 +37,7 @@ namespace mvs {
 
 // Maximum possible window radius for the photometric consistency cost. This
 // value is equal to THREADS_PER_BLOCK in patch_match_cuda.cu and the limit
-// arises from the shared memory implementation.
+// arises from the shared memory implementation of the Cuda implementation.
 const static size_t kMaxPatchMatchWindowRadius = 32;
 
 #define PrintOption(option) LOG(INFO) << #option ": " << option
@@ -46,6 +46,8 @@ void PatchMatchOptions::Print() const {
   PrintHeading2("PatchMatchOptions");
   PrintOption(max_image_size);
   PrintOption(gpu_index);
+  PrintOption(use_gpu);
+  PrintOption(num_threads);
   PrintOption(depth_min);
   PrintOption(depth_max);
   PrintOption(window_radius);
@@ -66,6 +68,9 @@ void PatchMatchOptions::Print() const {
   PrintOption(filter_min_num_consistent);
   PrintOption(filter_geom_consistency_max_cost);
   PrintOption(write_consistency_graph);
+  PrintOption(output_format);
+  PrintOption(output_half_precision);
+  PrintOption(output_compress);
   PrintOption(allow_missing_files);
 }
 
@@ -94,6 +99,10 @@ bool PatchMatchOptions::Check() const {
   CHECK_OPTION_GE(filter_min_num_consistent, 0);
   CHECK_OPTION_GE(filter_geom_consistency_max_cost, 0.0f);
   CHECK_OPTION_GT(cache_size, 0);
+  std::string output_format_lower_case = output_format;
+  StringToLower(&output_format_lower_case);
+  CHECK_OPTION(output_format_lower_case == "legacy" ||
+               output_format_lower_case == "bin");
   return true;
 }
 
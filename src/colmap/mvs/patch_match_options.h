@@ -42,6 +42,13 @@ struct PatchMatchOptions {
   // you should separate multiple GPU indices by comma, e.g., "0,1,2,3".
   std::string gpu_index = "-1";
 
+  // Whether to use the Cuda implementation. If false or if COLMAP was compiled
+  // without Cuda, the multi-threaded CPU implementation is used instead.
+  bool use_gpu = true;
+
+  // Number of threads used by the CPU implementation.
+  int num_threads = -1;
+
   // Depth range in which to randomly sample depth hypotheses.
   double depth_min = -1.0f;
   double depth_max = -1.0f;
@@ -118,6 +125,18 @@ struct PatchMatchOptions {
   // Whether to write the consistency graph.
   bool write_consistency_graph = false;
 
+  // Format of the output depth and normal maps, either "LEGACY" for the text
+  // header format of Mat::Write or "BIN" for the binary format of
+  // WriteMatFile. Uncompressed single precision maps in the binary format are
+  // memory-mapped instead of copied into memory when they are read.
+  std::string output_format = "LEGACY";
+
+  // Whether to store the values of binary maps as half precision floats.
+  bool output_half_precision = false;
+
+  // Whether to compress binary maps.
+  bool output_compress = false;
+
   void Print() const;
   bool Check() const;
 };
@@ -0,0 +1,704 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/point_octree.h"
+
+#include "colmap/util/endian.h"
+#include "colmap/util/logging.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+constexpr char kPointOctreeMagic[8] = {'C', 'O', 'L', 'M', 'A', 'P', 'O', 'T'};
+constexpr uint32_t kPointOctreeVersion = 3;
+constexpr uint64_t kPointOctreeHeaderSize = 96;
+constexpr uint64_t kNodeSize = 2 * sizeof(uint64_t) + 8 * sizeof(int32_t);
+constexpr uint64_t kPointSize = 6 * sizeof(float) + 4 * sizeof(uint8_t);
+
+template <typename T>
+T ReadValue(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return LittleEndianToNative(value);
+}
+
+struct VoxelKey {
+  int64_t x = 0;
+  int64_t y = 0;
+  int64_t z = 0;
+  bool operator==(const VoxelKey& other) const {
+    return x == other.x && y == other.y && z == other.z;
+  }
+};
+
+struct VoxelKeyHash {
+  size_t operator()(const VoxelKey& key) const {
+    size_t hash = std::hash<int64_t>{}(key.x);
+    for (const int64_t value : {key.y, key.z}) {
+      hash ^= std::hash<int64_t>{}(value) + 0x9e3779b9 + (hash << 6) +
+              (hash >> 2);
+    }
+    return hash;
+  }
+};
+
+struct VoxelAccumulator {
+  Eigen::Vector3d xyz = Eigen::Vector3d::Zero();
+  Eigen::Vector3d normal = Eigen::Vector3d::Zero();
+  Eigen::Vector3d rgb = Eigen::Vector3d::Zero();
+  size_t num_points = 0;
+  std::vector<int> visibility;
+};
+
+// Average points within the voxels of the grid with the given origin and voxel
+// size, which only requires memory proportional to the number of occupied
+// voxels and not to the number of points.
+class VoxelDownsampler {
+ public:
+  VoxelDownsampler(const Eigen::Vector3d& origin, const double voxel_size)
+      : origin_(origin), voxel_size_(voxel_size) {}
+
+  // Add a point and, if not null, its visibility.
+  void Add(const PlyPoint& point, const std::vector<int>* visibility) {
+    const Eigen::Vector3d voxel_coord =
+        ((Eigen::Vector3d(point.x, point.y, point.z) - origin_) / voxel_size_)
+            .array()
+            .floor();
+    VoxelKey key;
+    key.x = static_cast<int64_t>(voxel_coord.x());
+    key.y = static_cast<int64_t>(voxel_coord.y());
+    key.z = static_cast<int64_t>(voxel_coord.z());
+    const auto it = voxel_idxs_.emplace(key, voxels_.size()).first;
+    if (it->second == voxels_.size()) {
+      voxels_.emplace_back();
+    }
+
+    VoxelAccumulator& voxel = voxels_[it->second];
+    voxel.xyz += Eigen::Vector3d(point.x, point.y, point.z);
+    voxel.normal += Eigen::Vector3d(point.nx, point.ny, point.nz);
+    voxel.rgb += Eigen::Vector3d(point.r, point.g, point.b);
+    voxel.num_points += 1;
+    if (visibility != nullptr) {
+      voxel.visibility.insert(
+          voxel.visibility.end(), visibility->begin(), visibility->end());
+    }
+  }
+
+  // Append the averaged points in the order of the first point in each voxel
+  // and, if not null, their merged visibility.
+  void Finish(std::vector<PlyPoint>* points,
+              std::vector<std::vector<int>>* points_visibility) {
+    points->reserve(points->size() + voxels_.size());
+    for (auto& voxel : voxels_) {
+      const Eigen::Vector3d xyz = voxel.xyz / voxel.num_points;
+      const double normal_norm = voxel.normal.norm();
+      if (normal_norm > 0) {
+        voxel.normal /= normal_norm;
+      }
+      const Eigen::Vector3d rgb =
+          (voxel.rgb / voxel.num_points).array().round();
+
+      PlyPoint point;
+      point.x = static_cast<float>(xyz.x());
+      point.y = static_cast<float>(xyz.y());
+      point.z = static_cast<float>(xyz.z());
+      point.nx = static_cast<float>(voxel.normal.x());
+      point.ny = static_cast<float>(voxel.normal.y());
+      point.nz = static_cast<float>(voxel.normal.z());
+      point.r = static_cast<uint8_t>(rgb.x());
+      point.g = static_cast<uint8_t>(rgb.y());
+      point.b = static_cast<uint8_t>(rgb.z());
+      points->push_back(point);
+
+      if (points_visibility != nullptr) {
+        std::sort(voxel.visibility.begin(), voxel.visibility.end());
+        voxel.visibility.erase(
+            std::unique(voxel.visibility.begin(), voxel.visibility.end()),
+            voxel.visibility.end());
+        points_visibility->push_back(std::move(voxel.visibility));
+      }
+    }
+    voxel_idxs_.clear();
+    voxels_.clear();
+  }
+
+ private:
+  const Eigen::Vector3d origin_;
+  const double voxel_size_;
+  std::unordered_map<VoxelKey, size_t, VoxelKeyHash> voxel_idxs_;
+  std::vector<VoxelAccumulator> voxels_;
+};
+
+// Binary file, which is removed when going out of scope.
+struct TemporaryFile {
+  explicit TemporaryFile(const std::string& path) : path(path) {
+    file.open(path, std::ios::out | std::ios::binary);
+    THROW_CHECK_FILE_OPEN(file, path);
+  }
+  ~TemporaryFile() {
+    file.close();
+    std::error_code error_code;
+    std::filesystem::remove(path, error_code);
+  }
+  const std::string path;
+  std::fstream file;
+};
+
+// Append the contents of the temporary file to the stream.
+void AppendTemporaryFile(TemporaryFile* temporary_file, std::ostream* stream) {
+  temporary_file->file.close();
+  THROW_CHECK(!temporary_file->file.fail())
+      << "Failed to write " << temporary_file->path;
+  std::ifstream file(temporary_file->path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, temporary_file->path);
+  std::vector<char> buffer(1 << 20);
+  while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+    stream->write(buffer.data(), file.gcount());
+  }
+}
+
+// Points and their visibility in a temporary file in native byte order, which
+// are written once and then read sequentially.
+class TemporaryPointsFile {
+ public:
+  explicit TemporaryPointsFile(const std::string& path) : file_(path) {}
+
+  size_t NumPoints() const { return num_points_; }
+
+  void Write(const PlyPoint& point, const std::vector<int>& visibility) {
+    const uint32_t num_image_idxs = visibility.size();
+    file_.file.write(reinterpret_cast<const char*>(&point), sizeof(PlyPoint));
+    file_.file.write(reinterpret_cast<const char*>(&num_image_idxs),
+                     sizeof(uint32_t));
+    file_.file.write(reinterpret_cast<const char*>(visibility.data()),
+                     num_image_idxs * sizeof(int));
+    num_points_ += 1;
+  }
+
+  // Finish writing and start reading from the first point.
+  void StartReading() {
+    file_.file.close();
+    THROW_CHECK(!file_.file.fail()) << "Failed to write " << file_.path;
+    file_.file.open(file_.path, std::ios::in | std::ios::binary);
+    THROW_CHECK_FILE_OPEN(file_.file, file_.path);
+  }
+
+  // Read the next point. Returns false if all points were read.
+  bool Read(PlyPoint* point, std::vector<int>* visibility) {
+    if (!file_.file.read(reinterpret_cast<char*>(point), sizeof(PlyPoint))) {
+      return false;
+    }
+    uint32_t num_image_idxs = 0;
+    file_.file.read(reinterpret_cast<char*>(&num_image_idxs),
+                    sizeof(uint32_t));
+    visibility->resize(num_image_idxs);
+    file_.file.read(reinterpret_cast<char*>(visibility->data()),
+                    num_image_idxs * sizeof(int));
+    THROW_CHECK(file_.file.good()) << "Truncated file " << file_.path;
+    return true;
+  }
+
+ private:
+  TemporaryFile file_;
+  size_t num_points_ = 0;
+};
+
+struct OctreeNode {
+  uint64_t point_begin = 0;
+  uint64_t point_end = 0;
+  std::array<int32_t, 8> child_idxs = {{-1, -1, -1, -1, -1, -1, -1, -1}};
+};
+
+// The state of the input file, from which an octree is built.
+struct PointOctreeSource {
+  uint64_t num_points = 0;
+  uint64_t num_bytes = 0;
+  int64_t write_time = 0;
+};
+
+PointOctreeSource GetPointOctreeSource(const std::string& input_path,
+                                       const uint64_t num_points) {
+  PointOctreeSource source;
+  source.num_points = num_points;
+  source.num_bytes = GetFileSize(input_path);
+  source.write_time = std::filesystem::last_write_time(input_path)
+                          .time_since_epoch()
+                          .count();
+  return source;
+}
+
+// Builds the nodes in depth-first order from the temporary files of their
+// points. The points of the nodes are encoded as in the octree file and
+// written to temporary files, which are appended to the header and the nodes,
+// once the number of nodes is known.
+class PointOctreeBuilder {
+ public:
+  PointOctreeBuilder(const PointOctreeOptions& options,
+                     const std::string& path,
+                     const bool has_visibility)
+      : options_(options),
+        path_(path),
+        has_visibility_(has_visibility),
+        points_file_(path + ".points.tmp") {
+    if (has_visibility_) {
+      visibility_offsets_file_ =
+          std::make_unique<TemporaryFile>(path + ".visibility_offsets.tmp");
+      visibility_image_idxs_file_ =
+          std::make_unique<TemporaryFile>(path + ".visibility.tmp");
+    }
+  }
+
+  std::unique_ptr<TemporaryPointsFile> CreatePointsFile() {
+    return std::make_unique<TemporaryPointsFile>(
+        StringPrintf("%s.%d.tmp", path_.c_str(), num_points_files_++));
+  }
+
+  // Build the node for the given cube from the points in the given file and
+  // return the index of the node. The file is removed, once its points are
+  // split into the files of the children.
+  int BuildNode(std::unique_ptr<TemporaryPointsFile> points_file,
+                const Eigen::Vector3d& origin,
+                const double size,
+                const int depth) {
+    const int node_idx = nodes_.size();
+    nodes_.emplace_back();
+    nodes_[node_idx].point_begin = num_points_;
+
+    PlyPoint point;
+    std::vector<int> visibility;
+    points_file->StartReading();
+
+    if (points_file->NumPoints() <=
+            static_cast<size_t>(options_.max_num_leaf_points) ||
+        depth >= options_.max_depth) {
+      while (points_file->Read(&point, &visibility)) {
+        AppendPoint(point, visibility);
+      }
+      nodes_[node_idx].point_end = num_points_;
+      return node_idx;
+    }
+
+    // Average the points and split them into the children in a single pass.
+    const double child_size = 0.5 * size;
+    std::array<std::unique_ptr<TemporaryPointsFile>, 8> child_points_files;
+    {
+      VoxelDownsampler downsampler(origin, size / options_.node_resolution);
+      const Eigen::Vector3d center =
+          origin + Eigen::Vector3d::Constant(child_size);
+      while (points_file->Read(&point, &visibility)) {
+        downsampler.Add(point, has_visibility_ ? &visibility : nullptr);
+        const int child = (point.x >= center.x() ? 1 : 0) |
+                          (point.y >= center.y() ? 2 : 0) |
+                          (point.z >= center.z() ? 4 : 0);
+        if (!child_points_files[child]) {
+          child_points_files[child] = CreatePointsFile();
+        }
+        child_points_files[child]->Write(point, visibility);
+      }
+      points_file.reset();
+
+      std::vector<PlyPoint> node_points;
+      std::vector<std::vector<int>> node_points_visibility;
+      downsampler.Finish(&node_points, &node_points_visibility);
+      for (size_t i = 0; i < node_points.size(); ++i) {
+        AppendPoint(node_points[i],
+                    has_visibility_ ? node_points_visibility[i] : visibility);
+      }
+      nodes_[node_idx].point_end = num_points_;
+    }
+
+    for (int child = 0; child < 8; ++child) {
+      if (!child_points_files[child]) {
+        continue;
+      }
+      const Eigen::Vector3d child_origin =
+          origin + child_size * Eigen::Vector3d((child & 1) ? 1 : 0,
+                                                (child & 2) ? 1 : 0,
+                                                (child & 4) ? 1 : 0);
+      const int child_idx = BuildNode(std::move(child_points_files[child]),
+                                      child_origin,
+                                      child_size,
+                                      depth + 1);
+      nodes_[node_idx].child_idxs[child] = child_idx;
+    }
+
+    return node_idx;
+  }
+
+  // Write the octree with the built nodes to the output file.
+  void Write(const Eigen::Vector3d& origin,
+             const double size,
+             const PointOctreeSource& source) {
+    std::fstream file(path_, std::ios::out | std::ios::binary);
+    THROW_CHECK_FILE_OPEN(file, path_);
+
+    file.write(kPointOctreeMagic, sizeof(kPointOctreeMagic));
+    WriteBinaryLittleEndian<uint32_t>(&file, kPointOctreeVersion);
+    WriteBinaryLittleEndian<uint32_t>(&file, options_.node_resolution);
+    WriteBinaryLittleEndian<uint64_t>(&file, nodes_.size());
+    WriteBinaryLittleEndian<uint64_t>(&file, num_points_);
+    WriteBinaryLittleEndian<double>(&file, origin.x());
+    WriteBinaryLittleEndian<double>(&file, origin.y());
+    WriteBinaryLittleEndian<double>(&file, origin.z());
+    WriteBinaryLittleEndian<double>(&file, size);
+    WriteBinaryLittleEndian<uint32_t>(&file, has_visibility_);
+    const char reserved[4] = {0};
+    file.write(reserved, sizeof(reserved));
+    WriteBinaryLittleEndian<uint64_t>(&file, source.num_points);
+    WriteBinaryLittleEndian<uint64_t>(&file, source.num_bytes);
+    WriteBinaryLittleEndian<int64_t>(&file, source.write_time);
+
+    for (const auto& node : nodes_) {
+      WriteBinaryLittleEndian<uint64_t>(&file, node.point_begin);
+      WriteBinaryLittleEndian<uint64_t>(&file, node.point_end);
+      for (const int32_t child_idx : node.child_idxs) {
+        WriteBinaryLittleEndian<int32_t>(&file, child_idx);
+      }
+    }
+
+    AppendTemporaryFile(&points_file_, &file);
+    if (has_visibility_) {
+      WriteBinaryLittleEndian<uint64_t>(&file, 0);
+      AppendTemporaryFile(visibility_offsets_file_.get(), &file);
+      AppendTemporaryFile(visibility_image_idxs_file_.get(), &file);
+    }
+
+    THROW_CHECK(file.good()) << "Failed to write " << path_;
+
+    LOG(INFO) << StringPrintf("Wrote octree with %d nodes and %d points",
+                              nodes_.size(),
+                              num_points_);
+  }
+
+ private:
+  void AppendPoint(const PlyPoint& point, const std::vector<int>& visibility) {
+    std::fstream* file = &points_file_.file;
+    WriteBinaryLittleEndian<float>(file, point.x);
+    WriteBinaryLittleEndian<float>(file, point.y);
+    WriteBinaryLittleEndian<float>(file, point.z);
+    WriteBinaryLittleEndian<float>(file, point.nx);
+    WriteBinaryLittleEndian<float>(file, point.ny);
+    WriteBinaryLittleEndian<float>(file, point.nz);
+    WriteBinaryLittleEndian<uint8_t>(file, point.r);
+    WriteBinaryLittleEndian<uint8_t>(file, point.g);
+    WriteBinaryLittleEndian<uint8_t>(file, point.b);
+    WriteBinaryLittleEndian<uint8_t>(file, 0);
+    num_points_ += 1;
+
+    if (has_visibility_) {
+      for (const int image_idx : visibility) {
+        WriteBinaryLittleEndian<uint32_t>(&visibility_image_idxs_file_->file,
+                                          image_idx);
+      }
+      num_image_idxs_ += visibility.size();
+      WriteBinaryLittleEndian<uint64_t>(&visibility_offsets_file_->file,
+                                        num_image_idxs_);
+    }
+  }
+
+  const PointOctreeOptions options_;
+  const std::string path_;
+  const bool has_visibility_;
+  int num_points_files_ = 0;
+  std::vector<OctreeNode> nodes_;
+  uint64_t num_points_ = 0;
+  uint64_t num_image_idxs_ = 0;
+  TemporaryFile points_file_;
+  std::unique_ptr<TemporaryFile> visibility_offsets_file_;
+  std::unique_ptr<TemporaryFile> visibility_image_idxs_file_;
+};
+
+}  // namespace
+
+void VoxelDownsamplePoints(
+    const double voxel_size,
+    const std::vector<PlyPoint>& points,
+    const std::vector<std::vector<int>>& points_visibility,
+    std::vector<PlyPoint>* downsampled_points,
+    std::vector<std::vector<int>>* downsampled_points_visibility) {
+  THROW_CHECK_GT(voxel_size, 0);
+  if (!points_visibility.empty()) {
+    THROW_CHECK_EQ(points_visibility.size(), points.size());
+  }
+  THROW_CHECK_NOTNULL(downsampled_points);
+  THROW_CHECK_NOTNULL(downsampled_points_visibility);
+
+  downsampled_points->clear();
+  downsampled_points_visibility->clear();
+  VoxelDownsampler downsampler(Eigen::Vector3d::Zero(), voxel_size);
+  for (size_t i = 0; i < points.size(); ++i) {
+    downsampler.Add(
+        points[i], points_visibility.empty() ? nullptr : &points_visibility[i]);
+  }
+  downsampler.Finish(downsampled_points,
+                     points_visibility.empty() ? nullptr
+                                               : downsampled_points_visibility);
+}
+
+bool PointOctreeOptions::Check() const {
+  CHECK_OPTION_GT(max_num_leaf_points, 0);
+  CHECK_OPTION_GT(node_resolution, 0);
+  CHECK_OPTION_GE(max_depth, 0);
+  CHECK_OPTION_GT(chunk_size, 0);
+  return true;
+}
+
+void BuildPointOctree(const std::string& input_path,
+                      const std::string& path,
+                      const PointOctreeOptions& options) {
+  THROW_CHECK(options.Check());
+
+  PlyPointsReader reader(input_path);
+
+  const std::string vis_path = input_path + ".vis";
+  const bool has_visibility = ExistsFile(vis_path);
+  std::ifstream vis_file;
+  if (has_visibility) {
+    vis_file.open(vis_path, std::ios::binary);
+    THROW_CHECK_FILE_OPEN(vis_file, vis_path);
+    THROW_CHECK_EQ(ReadBinaryLittleEndian<uint64_t>(&vis_file),
+                   reader.NumPoints())
+        << "Inconsistent visibility " << vis_path;
+  }
+
+  PointOctreeBuilder builder(options, path, has_visibility);
+
+  // Stream the input points into the file of the root node and determine its
+  // cube, which is slightly enlarged, such that all points lie strictly inside
+  // the cube.
+  std::unique_ptr<TemporaryPointsFile> points_file = builder.CreatePointsFile();
+  Eigen::AlignedBox3d bbox;
+  std::vector<PlyPoint> points;
+  std::vector<int> visibility;
+  while (reader.Read(options.chunk_size, &points)) {
+    for (const auto& point : points) {
+      if (has_visibility) {
+        visibility.resize(ReadBinaryLittleEndian<uint32_t>(&vis_file));
+        for (auto& image_idx : visibility) {
+          image_idx = ReadBinaryLittleEndian<uint32_t>(&vis_file);
+        }
+      }
+      bbox.extend(Eigen::Vector3d(point.x, point.y, point.z));
+      points_file->Write(point, visibility);
+    }
+  }
+  if (has_visibility) {
+    THROW_CHECK(vis_file.good()) << "Truncated file " << vis_path;
+  }
+
+  Eigen::Vector3d origin = Eigen::Vector3d::Zero();
+  double size = 1;
+  if (reader.NumPoints() > 0) {
+    origin = bbox.min();
+    size = std::max(bbox.sizes().maxCoeff(), 1e-6) * (1 + 1e-4);
+    builder.BuildNode(std::move(points_file), origin, size, /*depth=*/0);
+  }
+
+  builder.Write(
+      origin, size, GetPointOctreeSource(input_path, reader.NumPoints()));
+}
+
+PointOctree::PointOctree(const std::string& path) : file_(path) {
+  const char* data = file_.Data();
+  THROW_CHECK_GE(file_.NumBytes(), kPointOctreeHeaderSize)
+      << "Invalid file " << path;
+  THROW_CHECK_EQ(
+      std::memcmp(data, kPointOctreeMagic, sizeof(kPointOctreeMagic)), 0)
+      << "Invalid file " << path;
+  data += sizeof(kPointOctreeMagic);
+
+  const uint32_t version = ReadValue<uint32_t>(data);
+  THROW_CHECK_EQ(version, kPointOctreeVersion)
+      << "Unsupported version of " << path;
+  node_resolution_ = ReadValue<uint32_t>(data + 4);
+  num_nodes_ = ReadValue<uint64_t>(data + 8);
+  num_points_ = ReadValue<uint64_t>(data + 16);
+  origin_ = Eigen::Vector3d(ReadValue<double>(data + 24),
+                            ReadValue<double>(data + 32),
+                            ReadValue<double>(data + 40));
+  size_ = ReadValue<double>(data + 48);
+  has_visibility_ = ReadValue<uint32_t>(data + 56) != 0;
+  source_num_points_ = ReadValue<uint64_t>(data + 64);
+  source_num_bytes_ = ReadValue<uint64_t>(data + 72);
+  source_write_time_ = ReadValue<int64_t>(data + 80);
+  THROW_CHECK_GT(node_resolution_, 0) << path;
+
+  nodes_offset_ = kPointOctreeHeaderSize;
+  points_offset_ = nodes_offset_ + num_nodes_ * kNodeSize;
+  visibility_offsets_offset_ = points_offset_ + num_points_ * kPointSize;
+  visibility_image_idxs_offset_ =
+      visibility_offsets_offset_ + (num_points_ + 1) * sizeof(uint64_t);
+  if (has_visibility_) {
+    THROW_CHECK_GE(file_.NumBytes(), visibility_image_idxs_offset_)
+        << "Truncated file " << path;
+    const uint64_t num_image_idxs = ReadValue<uint64_t>(
+        file_.Data() + visibility_offsets_offset_ +
+        num_points_ * sizeof(uint64_t));
+    THROW_CHECK_GE(
+        file_.NumBytes(),
+        visibility_image_idxs_offset_ + num_image_idxs * sizeof(uint32_t))
+        << "Truncated file " << path;
+  } else {
+    THROW_CHECK_GE(file_.NumBytes(), visibility_offsets_offset_)
+        << "Truncated file " << path;
+  }
+}
+
+Eigen::AlignedBox3d PointOctree::BoundingBox() const {
+  return Eigen::AlignedBox3d(origin_,
+                             origin_ + Eigen::Vector3d::Constant(size_));
+}
+
+bool PointOctree::IsBuiltFrom(const std::string& input_path) const {
+  if (!ExistsFile(input_path)) {
+    return false;
+  }
+  const PointOctreeSource source =
+      GetPointOctreeSource(input_path, source_num_points_);
+  return source.num_bytes == source_num_bytes_ &&
+         source.write_time == source_write_time_ &&
+         PlyPointsReader(input_path).NumPoints() == source_num_points_;
+}
+
+void PointOctree::Query(
+    const Eigen::AlignedBox3d& box,
+    const double resolution,
+    std::vector<PlyPoint>* points,
+    std::vector<std::vector<int>>* points_visibility) const {
+  THROW_CHECK_NOTNULL(points);
+  points->clear();
+  const bool read_visibility = points_visibility != nullptr && has_visibility_;
+  if (points_visibility != nullptr) {
+    points_visibility->clear();
+  }
+  if (num_nodes_ == 0) {
+    return;
+  }
+
+  const char* data = file_.Data();
+
+  auto AppendPoints = [&](const uint64_t point_begin,
+                          const uint64_t point_end) {
+    for (uint64_t point_idx = point_begin; point_idx < point_end;
+         ++point_idx) {
+      const char* point_data = data + points_offset_ + point_idx * kPointSize;
+      PlyPoint point;
+      point.x = ReadValue<float>(point_data);
+      point.y = ReadValue<float>(point_data + 4);
+      point.z = ReadValue<float>(point_data + 8);
+      if (!box.contains(Eigen::Vector3d(point.x, point.y, point.z))) {
+        continue;
+      }
+      point.nx = ReadValue<float>(point_data + 12);
+      point.ny = ReadValue<float>(point_data + 16);
+      point.nz = ReadValue<float>(point_data + 20);
+      point.r = ReadValue<uint8_t>(point_data + 24);
+      point.g = ReadValue<uint8_t>(point_data + 25);
+      point.b = ReadValue<uint8_t>(point_data + 26);
+      points->push_back(point);
+
+      if (read_visibility) {
+        const char* offset_data = data + visibility_offsets_offset_ +
+                                  point_idx * sizeof(uint64_t);
+        const uint64_t image_idx_begin = ReadValue<uint64_t>(offset_data);
+        const uint64_t image_idx_end =
+            ReadValue<uint64_t>(offset_data + sizeof(uint64_t));
+        std::vector<int> visibility;
+        visibility.reserve(image_idx_end - image_idx_begin);
+        for (uint64_t i = image_idx_begin; i < image_idx_end; ++i) {
+          visibility.push_back(ReadValue<uint32_t>(
+              data + visibility_image_idxs_offset_ + i * sizeof(uint32_t)));
+        }
+        points_visibility->push_back(std::move(visibility));
+      }
+    }
+  };
+
+  struct NodeCube {
+    int32_t node_idx;
+    Eigen::Vector3d origin;
+    double size;
+  };
+
+  std::vector<NodeCube> stack = {{0, origin_, size_}};
+  while (!stack.empty()) {
+    const NodeCube cube = stack.back();
+    stack.pop_back();
+
+    const Eigen::AlignedBox3d node_box(
+        cube.origin, cube.origin + Eigen::Vector3d::Constant(cube.size));
+    if (!node_box.intersects(box)) {
+      continue;
+    }
+
+    THROW_CHECK_LT(static_cast<uint64_t>(cube.node_idx), num_nodes_);
+    const char* node_data = data + nodes_offset_ + cube.node_idx * kNodeSize;
+    const uint64_t point_begin = ReadValue<uint64_t>(node_data);
+    const uint64_t point_end = ReadValue<uint64_t>(node_data + 8);
+    THROW_CHECK_LE(point_begin, point_end);
+    THROW_CHECK_LE(point_end, num_points_);
+
+    std::array<int32_t, 8> child_idxs;
+    bool is_leaf = true;
+    for (int child = 0; child < 8; ++child) {
+      child_idxs[child] =
+          ReadValue<int32_t>(node_data + 16 + child * sizeof(int32_t));
+      is_leaf = is_leaf && child_idxs[child] < 0;
+    }
+
+    if (is_leaf || cube.size / node_resolution_ <= resolution) {
+      AppendPoints(point_begin, point_end);
+      continue;
+    }
+
+    const double child_size = 0.5 * cube.size;
+    for (int child = 7; child >= 0; --child) {
+      if (child_idxs[child] >= 0) {
+        const Eigen::Vector3d child_origin =
+            cube.origin + child_size * Eigen::Vector3d((child & 1) ? 1 : 0,
+                                                       (child & 2) ? 1 : 0,
+                                                       (child & 4) ? 1 : 0);
+        stack.push_back({child_idxs[child], child_origin, child_size});
+      }
+    }
+  }
+}
+
+}  // namespace mvs
+}  // namespace colmap
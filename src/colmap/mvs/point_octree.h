@@ -0,0 +1,161 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/util/file.h"
+#include "colmap/util/ply.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+namespace colmap {
+namespace mvs {
+
+// Average the points within each cell of a regular voxel grid with the given
+// voxel size. Positions and colors are averaged, normals are averaged and
+// re-normalized, and the visibility of a merged point is the union of the
+// visibilities of its input points. The visibility is only computed if it is
+// given for the input points, i.e., if points_visibility is not empty.
+void VoxelDownsamplePoints(
+    double voxel_size,
+    const std::vector<PlyPoint>& points,
+    const std::vector<std::vector<int>>& points_visibility,
+    std::vector<PlyPoint>* downsampled_points,
+    std::vector<std::vector<int>>* downsampled_points_visibility);
+
+struct PointOctreeOptions {
+  // Nodes with at most this number of points are not further subdivided and
+  // store the input points.
+  int max_num_leaf_points = 50000;
+
+  // Number of voxels along each axis of an inner node, whose voxel-averaged
+  // points form the level of detail of the node.
+  int node_resolution = 64;
+
+  // Maximum depth of the octree, at which nodes become leaves irrespective of
+  // their number of points.
+  int max_depth = 16;
+
+  // Number of input points that are read at once.
+  int chunk_size = 1 << 20;
+
+  bool Check() const;
+};
+
+// Build an octree with level of detail over the points of the given PLY file
+// and write it to a binary file of the following format, which is accessed
+// through a memory mapping by PointOctree:
+//
+//    <magic : char[8] = "COLMAPOT">
+//    <version : uint32>
+//    <node_resolution : uint32>
+//    <num_nodes : uint64>
+//    <num_points : uint64>
+//    <origin : double[3]>
+//    <size : double>
+//    <has_visibility : uint32>
+//    <reserved : uint8[4]>
+//    <source_num_points : uint64>
+//    <source_num_bytes : uint64>
+//    <source_write_time : int64>
+//    <nodes : num_nodes x (<point_begin : uint64><point_end : uint64>
+//                          <child_idxs : int32[8]>)>
+//    <points : num_points x (<xyz : float[3]><normal : float[3]>
+//                            <rgb : uint8[3]><reserved : uint8>)>
+//    <visibility_offsets : (num_points + 1) x uint64>  (if has_visibility)
+//    <visibility_image_idxs : visibility_offsets[num_points] x uint32>
+//
+// All values are stored in little endian. The root node is the first node and
+// covers the cube of the given size at the given origin. Every inner node
+// stores the points averaged over a grid of node_resolution^3 voxels in its
+// cube, while leaf nodes (without children) store the input points. The
+// number of points, the size, and the modification time of the input file
+// identify the input, from which the octree was built.
+//
+// The octree is built out-of-core, so that point clouds larger than the
+// available memory can be processed. The input points are streamed into
+// temporary files next to the output path, which are recursively split into
+// the temporary files of the child nodes. The memory is bounded by the chunk
+// size and the node resolution. If <input_path>.vis exists, as written by
+// StereoFusion, the merged visibility is stored in the octree.
+void BuildPointOctree(const std::string& input_path,
+                      const std::string& path,
+                      const PointOctreeOptions& options = PointOctreeOptions());
+
+// Memory-mapped read access to an octree written by BuildPointOctree.
+class PointOctree {
+ public:
+  explicit PointOctree(const std::string& path);
+
+  inline size_t NumNodes() const { return num_nodes_; }
+  inline size_t NumPoints() const { return num_points_; }
+  inline bool HasVisibility() const { return has_visibility_; }
+
+  // The cube covered by the root node.
+  Eigen::AlignedBox3d BoundingBox() const;
+
+  // Whether the octree was built from the current state of the given input
+  // file, i.e., whether its number of points, size, and modification time
+  // are unchanged. Otherwise, the octree is stale and must be rebuilt.
+  bool IsBuiltFrom(const std::string& input_path) const;
+
+  // Collect the points within the given box at the given resolution, i.e.,
+  // with a spacing of at most the resolution in scene units. In each branch of
+  // the octree, the points of the shallowest node with a voxel size of at most
+  // the resolution are returned, or the input points, if the resolution is
+  // finer than the deepest level of detail. The visibility is only returned if
+  // it is requested and stored in the octree.
+  void Query(const Eigen::AlignedBox3d& box,
+             double resolution,
+             std::vector<PlyPoint>* points,
+             std::vector<std::vector<int>>* points_visibility = nullptr) const;
+
+ private:
+  MappedFile file_;
+  uint32_t node_resolution_ = 0;
+  uint64_t num_nodes_ = 0;
+  uint64_t num_points_ = 0;
+  Eigen::Vector3d origin_;
+  double size_ = 0;
+  bool has_visibility_ = false;
+  uint64_t source_num_points_ = 0;
+  uint64_t source_num_bytes_ = 0;
+  int64_t source_write_time_ = 0;
+  uint64_t nodes_offset_ = 0;
+  uint64_t points_offset_ = 0;
+  uint64_t visibility_offsets_offset_ = 0;
+  uint64_t visibility_image_idxs_offset_ = 0;
+};
+
+}  // namespace mvs
+}  // namespace colmap
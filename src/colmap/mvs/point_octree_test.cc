@@ -0,0 +1,264 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/mvs/point_octree.h"
+
+#include "colmap/mvs/fusion.h"
+#include "colmap/util/file.h"
+#include "colmap/util/testing.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+PlyPoint CreatePoint(const float x,
+                     const float y,
+                     const float z,
+                     const uint8_t gray = 0) {
+  PlyPoint point;
+  point.x = x;
+  point.y = y;
+  point.z = z;
+  point.nz = 1;
+  point.r = gray;
+  point.g = gray;
+  point.b = gray;
+  return point;
+}
+
+// Regular grid of points with the given spacing in the unit cube.
+void CreateGridPoints(const int num_points_per_axis,
+                      std::vector<PlyPoint>* points,
+                      std::vector<std::vector<int>>* points_visibility) {
+  const float spacing = 1.0f / num_points_per_axis;
+  for (int x = 0; x < num_points_per_axis; ++x) {
+    for (int y = 0; y < num_points_per_axis; ++y) {
+      for (int z = 0; z < num_points_per_axis; ++z) {
+        points->push_back(CreatePoint(
+            (x + 0.5f) * spacing, (y + 0.5f) * spacing, (z + 0.5f) * spacing));
+        points_visibility->push_back({x % 3, 3 + y % 2});
+      }
+    }
+  }
+}
+
+// Write the points and, if not empty, their visibility as fused by
+// StereoFusion and return the path of the PLY file.
+std::string WriteTestPoints(
+    const std::string& test_dir,
+    const std::vector<PlyPoint>& points,
+    const std::vector<std::vector<int>>& points_visibility) {
+  const std::string path = JoinPaths(test_dir, "fused.ply");
+  WriteBinaryPlyPoints(path, points);
+  if (!points_visibility.empty()) {
+    WritePointsVisibility(path + ".vis", points_visibility);
+  }
+  return path;
+}
+
+TEST(VoxelDownsamplePoints, Nominal) {
+  const std::vector<PlyPoint> points = {CreatePoint(0.1f, 0.1f, 0.1f, 10),
+                                        CreatePoint(0.3f, 0.3f, 0.3f, 20),
+                                        CreatePoint(1.5f, 0.5f, 0.5f, 30)};
+  const std::vector<std::vector<int>> points_visibility = {
+      {0, 1}, {1, 2}, {3}};
+
+  std::vector<PlyPoint> downsampled_points;
+  std::vector<std::vector<int>> downsampled_points_visibility;
+  VoxelDownsamplePoints(1.0,
+                        points,
+                        points_visibility,
+                        &downsampled_points,
+                        &downsampled_points_visibility);
+
+  ASSERT_EQ(downsampled_points.size(), 2);
+  EXPECT_FLOAT_EQ(downsampled_points[0].x, 0.2f);
+  EXPECT_FLOAT_EQ(downsampled_points[0].y, 0.2f);
+  EXPECT_FLOAT_EQ(downsampled_points[0].z, 0.2f);
+  EXPECT_FLOAT_EQ(downsampled_points[0].nz, 1.0f);
+  EXPECT_EQ(downsampled_points[0].r, 15);
+  EXPECT_FLOAT_EQ(downsampled_points[1].x, 1.5f);
+  EXPECT_EQ(downsampled_points[1].r, 30);
+  EXPECT_EQ(downsampled_points_visibility,
+            std::vector<std::vector<int>>({{0, 1, 2}, {3}}));
+}
+
+TEST(VoxelDownsamplePoints, WithoutVisibility) {
+  const std::vector<PlyPoint> points = {CreatePoint(-0.1f, 0, 0),
+                                        CreatePoint(0.1f, 0, 0)};
+  std::vector<PlyPoint> downsampled_points;
+  std::vector<std::vector<int>> downsampled_points_visibility;
+  VoxelDownsamplePoints(
+      1.0, points, {}, &downsampled_points, &downsampled_points_visibility);
+  EXPECT_EQ(downsampled_points.size(), 2);
+  EXPECT_TRUE(downsampled_points_visibility.empty());
+}
+
+TEST(PointOctree, QueryResolution) {
+  std::vector<PlyPoint> points;
+  std::vector<std::vector<int>> points_visibility;
+  CreateGridPoints(16, &points, &points_visibility);
+
+  PointOctreeOptions options;
+  options.max_num_leaf_points = 64;
+  options.node_resolution = 2;
+  options.chunk_size = 1000;
+  const std::string test_dir = CreateTestDir();
+  const std::string input_path =
+      WriteTestPoints(test_dir, points, points_visibility);
+  const std::string path = input_path + ".octree";
+  BuildPointOctree(input_path, path, options);
+
+  // The temporary files are removed.
+  EXPECT_EQ(GetFileList(test_dir).size(), 3);
+
+  const PointOctree octree(path);
+  EXPECT_GT(octree.NumNodes(), 1);
+  EXPECT_GT(octree.NumPoints(), points.size());
+  EXPECT_TRUE(octree.HasVisibility());
+  EXPECT_TRUE(octree.BoundingBox().contains(Eigen::Vector3d(0.5, 0.5, 0.5)));
+
+  const Eigen::AlignedBox3d full_box(Eigen::Vector3d::Constant(-1),
+                                     Eigen::Vector3d::Constant(2));
+
+  // The input points at the finest resolution.
+  std::vector<PlyPoint> query_points;
+  std::vector<std::vector<int>> query_points_visibility;
+  octree.Query(full_box, 0, &query_points, &query_points_visibility);
+  EXPECT_EQ(query_points.size(), points.size());
+  EXPECT_EQ(query_points_visibility.size(), points.size());
+  for (const auto& visibility : query_points_visibility) {
+    EXPECT_EQ(visibility.size(), 2);
+  }
+
+  // The root level of detail with 2^3 voxels.
+  octree.Query(full_box, 1, &query_points, &query_points_visibility);
+  EXPECT_EQ(query_points.size(), 8);
+  for (const auto& visibility : query_points_visibility) {
+    EXPECT_EQ(visibility, std::vector<int>({0, 1, 2, 3, 4}));
+  }
+
+  // The level of detail of the first level with 8 x 2^3 voxels.
+  octree.Query(full_box, 0.3, &query_points, &query_points_visibility);
+  EXPECT_EQ(query_points.size(), 64);
+  EXPECT_EQ(query_points_visibility.size(), 64);
+}
+
+TEST(PointOctree, QueryBox) {
+  std::vector<PlyPoint> points;
+  std::vector<std::vector<int>> points_visibility;
+  CreateGridPoints(8, &points, &points_visibility);
+
+  PointOctreeOptions options;
+  options.max_num_leaf_points = 16;
+  const std::string input_path = WriteTestPoints(CreateTestDir(), points, {});
+  const std::string path = input_path + ".octree";
+  BuildPointOctree(input_path, path, options);
+
+  const PointOctree octree(path);
+  EXPECT_FALSE(octree.HasVisibility());
+
+  const Eigen::AlignedBox3d box(Eigen::Vector3d::Zero(),
+                                Eigen::Vector3d::Constant(0.5));
+  std::vector<PlyPoint> query_points;
+  std::vector<std::vector<int>> query_points_visibility;
+  octree.Query(box, 0, &query_points, &query_points_visibility);
+  EXPECT_EQ(query_points.size(), 4 * 4 * 4);
+  EXPECT_TRUE(query_points_visibility.empty());
+  for (const auto& point : query_points) {
+    EXPECT_TRUE(box.contains(Eigen::Vector3d(point.x, point.y, point.z)));
+  }
+}
+
+TEST(PointOctree, LargeCoordinates) {
+  const Eigen::Vector3d offset(123456.75, -654321.5, 1000.25);
+  std::vector<PlyPoint> points;
+  std::vector<std::vector<int>> points_visibility;
+  CreateGridPoints(4, &points, &points_visibility);
+  Eigen::AlignedBox3d bbox;
+  for (auto& point : points) {
+    point.x += offset.x();
+    point.y += offset.y();
+    point.z += offset.z();
+    bbox.extend(Eigen::Vector3d(point.x, point.y, point.z));
+  }
+
+  const std::string input_path =
+      WriteTestPoints(CreateTestDir(), points, points_visibility);
+  const std::string path = input_path + ".octree";
+  BuildPointOctree(input_path, path);
+
+  // The root cube is stored in double precision.
+  const PointOctree octree(path);
+  EXPECT_EQ(octree.BoundingBox().min(), bbox.min());
+  EXPECT_EQ(octree.BoundingBox().max(),
+            bbox.min() + Eigen::Vector3d::Constant(
+                             bbox.sizes().maxCoeff() * (1 + 1e-4)));
+
+  std::vector<PlyPoint> query_points;
+  octree.Query(octree.BoundingBox(), 0, &query_points);
+  EXPECT_EQ(query_points.size(), points.size());
+}
+
+TEST(PointOctree, Empty) {
+  const std::string input_path = WriteTestPoints(CreateTestDir(), {}, {});
+  const std::string path = input_path + ".octree";
+  BuildPointOctree(input_path, path);
+  const PointOctree octree(path);
+  EXPECT_EQ(octree.NumNodes(), 0);
+  EXPECT_EQ(octree.NumPoints(), 0);
+  std::vector<PlyPoint> query_points;
+  octree.Query(octree.BoundingBox(), 0, &query_points);
+  EXPECT_TRUE(query_points.empty());
+}
+
+TEST(PointOctree, IsBuiltFrom) {
+  std::vector<PlyPoint> points;
+  std::vector<std::vector<int>> points_visibility;
+  CreateGridPoints(4, &points, &points_visibility);
+
+  const std::string test_dir = CreateTestDir();
+  const std::string input_path = WriteTestPoints(test_dir, points, {});
+  const std::string path = input_path + ".octree";
+  BuildPointOctree(input_path, path);
+  EXPECT_TRUE(PointOctree(path).IsBuiltFrom(input_path));
+  EXPECT_FALSE(
+      PointOctree(path).IsBuiltFrom(JoinPaths(test_dir, "missing.ply")));
+
+  // The input points changed after building the octree.
+  points.pop_back();
+  WriteTestPoints(test_dir, points, {});
+  EXPECT_FALSE(PointOctree(path).IsBuiltFrom(input_path));
+}
+
+}  // namespace
+}  // namespace mvs
+}  // namespace colmap
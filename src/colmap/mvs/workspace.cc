@@ -69,22 +69,22 @@ void Workspace::Load(const std::vector<std::string>& image_names) {
     const size_t height = model_.images.at(image_idx).GetHeight();
 
     // Read and rescale bitmap
-    bitmaps_[image_idx] = std::make_unique<Bitmap>();
+    bitmaps_[image_idx] = std::make_shared<Bitmap>();
     bitmaps_[image_idx]->Read(GetBitmapPath(image_idx), options_.image_as_rgb);
     if (options_.max_image_size > 0) {
       bitmaps_[image_idx]->Rescale((int)width, (int)height);
     }
 
     // Read and rescale depth map
-    depth_maps_[image_idx] = std::make_unique<DepthMap>();
-    depth_maps_[image_idx]->Read(GetDepthMapPath(image_idx));
+    depth_maps_[image_idx] = std::make_shared<DepthMap>();
+    depth_maps_[image_idx]->ReadMapped(GetDepthMapPath(image_idx));
     if (options_.max_image_size > 0) {
       depth_maps_[image_idx]->Downsize(width, height);
     }
 
     // Read and rescale normal map
-    normal_maps_[image_idx] = std::make_unique<NormalMap>();
-    normal_maps_[image_idx]->Read(GetNormalMapPath(image_idx));
+    normal_maps_[image_idx] = std::make_shared<NormalMap>();
+    normal_maps_[image_idx]->ReadMapped(GetNormalMapPath(image_idx));
     if (options_.max_image_size > 0) {
       normal_maps_[image_idx]->Downsize(width, height);
     }
@@ -99,6 +99,9 @@ void Workspace::Load(const std::vector<std::string>& image_names) {
                             num_threads);
   for (size_t i = 0; i < image_names.size(); ++i) {
     const int image_idx = model_.GetImageIdx(image_names[i]);
+    if (bitmaps_[image_idx]) {
+      continue;
+    }
     if (HasBitmap(image_idx) && HasDepthMap(image_idx)) {
       thread_pool.AddTask(LoadWorkspaceData, image_idx);
     } else {
@@ -111,16 +114,27 @@ void Workspace::Load(const std::vector<std::string>& image_names) {
   timer.PrintMinutes();
 }
 
-const Bitmap& Workspace::GetBitmap(const int image_idx) {
-  return *bitmaps_[image_idx];
+void Workspace::Unload(const std::vector<std::string>& image_names) {
+  for (const auto& image_name : image_names) {
+    const int image_idx = model_.GetImageIdx(image_name);
+    if (static_cast<size_t>(image_idx) < bitmaps_.size()) {
+      bitmaps_[image_idx].reset();
+      depth_maps_[image_idx].reset();
+      normal_maps_[image_idx].reset();
+    }
+  }
+}
+
+std::shared_ptr<const Bitmap> Workspace::GetBitmap(const int image_idx) {
+  return bitmaps_[image_idx];
 }
 
-const DepthMap& Workspace::GetDepthMap(const int image_idx) {
-  return *depth_maps_[image_idx];
+std::shared_ptr<const DepthMap> Workspace::GetDepthMap(const int image_idx) {
+  return depth_maps_[image_idx];
 }
 
-const NormalMap& Workspace::GetNormalMap(const int image_idx) {
-  return *normal_maps_[image_idx];
+std::shared_ptr<const NormalMap> Workspace::GetNormalMap(const int image_idx) {
+  return normal_maps_[image_idx];
 }
 
 std::string Workspace::GetBitmapPath(const int image_idx) const {
@@ -135,6 +149,11 @@ std::string Workspace::GetNormalMapPath(const int image_idx) const {
   return normal_map_path_ + GetFileName(image_idx);
 }
 
+std::string Workspace::GetImageOverlapsPath() const {
+  return JoinPaths(
+      options_.workspace_path, options_.stereo_folder, "image_overlaps.bin");
+}
+
 bool Workspace::HasBitmap(const int image_idx) const {
   return ExistsFile(GetBitmapPath(image_idx));
 }
@@ -148,7 +167,7 @@ bool Workspace::HasNormalMap(const int image_idx) const {
 }
 
 CachedWorkspace::CachedImage::CachedImage(CachedImage&& other) noexcept {
-  num_bytes = other.num_bytes;
+  num_bytes = other.num_bytes.load();
   bitmap = std::move(other.bitmap);
   depth_map = std::move(other.depth_map);
   normal_map = std::move(other.normal_map);
@@ -157,7 +176,7 @@ CachedWorkspace::CachedImage::CachedImage(CachedImage&& other) noexcept {
 CachedWorkspace::CachedImage& CachedWorkspace::CachedImage::operator=(
     CachedImage&& other) noexcept {
   if (this != &other) {
-    num_bytes = other.num_bytes;
+    num_bytes = other.num_bytes.load();
     bitmap = std::move(other.bitmap);
     depth_map = std::move(other.depth_map);
     normal_map = std::move(other.normal_map);
@@ -168,56 +187,186 @@ CachedWorkspace::CachedImage& CachedWorkspace::CachedImage::operator=(
 CachedWorkspace::CachedWorkspace(const Options& options)
     : Workspace(options),
       cache_((size_t)(1024.0 * 1024.0 * 1024.0 * options.cache_size),
-             [](const int) { return std::make_shared<CachedImage>(); }) {}
+             [this](const int image_idx) {
+               // Called with the cache mutex held. Requested images that were
+               // prefetched are moved into the cache.
+               const auto it = prefetched_images_.find(image_idx);
+               if (it == prefetched_images_.end()) {
+                 return std::make_shared<CachedImage>();
+               }
+               std::shared_ptr<CachedImage> cached_image = it->second;
+               ErasePrefetchedImage(image_idx);
+               return cached_image;
+             }) {}
+
+void CachedWorkspace::ClearCache() {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  cache_.Clear();
+  prefetched_images_.clear();
+  prefetch_num_bytes_ = 0;
+}
 
-const Bitmap& CachedWorkspace::GetBitmap(const int image_idx) {
-  auto cached_image = cache_.Get(image_idx);
-  std::lock_guard<std::mutex> lock(cached_image->mutex);
-  if (!cached_image->bitmap) {
-    cached_image->bitmap = std::make_unique<Bitmap>();
-    cached_image->bitmap->Read(GetBitmapPath(image_idx), options_.image_as_rgb);
-    if (options_.max_image_size > 0) {
-      cached_image->bitmap->Rescale(model_.images.at(image_idx).GetWidth(),
-                                    model_.images.at(image_idx).GetHeight());
-    }
-    cached_image->num_bytes += cached_image->bitmap->NumBytes();
-    cache_.UpdateNumBytes(image_idx);
+void CachedWorkspace::Unload(const std::vector<std::string>& image_names) {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  for (const auto& image_name : image_names) {
+    const int image_idx = model_.GetImageIdx(image_name);
+    cache_.Evict(image_idx);
+    ErasePrefetchedImage(image_idx);
   }
-  return *cached_image->bitmap;
 }
 
-const DepthMap& CachedWorkspace::GetDepthMap(const int image_idx) {
-  auto cached_image = cache_.Get(image_idx);
-  std::lock_guard<std::mutex> lock(cached_image->mutex);
-  if (!cached_image->depth_map) {
-    cached_image->depth_map = std::make_unique<DepthMap>();
-    cached_image->depth_map->Read(GetDepthMapPath(image_idx));
-    if (options_.max_image_size > 0) {
-      cached_image->depth_map->Downsize(
-          model_.images.at(image_idx).GetWidth(),
-          model_.images.at(image_idx).GetHeight());
+void CachedWorkspace::Prefetch(const std::vector<int>& image_idxs) {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  if (!prefetch_thread_pool_) {
+    prefetch_thread_pool_ = std::make_unique<ThreadPool>(
+        GetEffectiveNumThreads(options_.num_threads));
+  }
+  for (const int image_idx : image_idxs) {
+    if (cache_.Exists(image_idx) || prefetched_images_.count(image_idx)) {
+      continue;
     }
-    cached_image->num_bytes += cached_image->depth_map->GetNumBytes();
+    const size_t num_bytes = EstimateNumBytes(image_idx);
+    if (cache_.NumBytes() + prefetch_num_bytes_ + num_bytes >
+        cache_.MaxNumBytes()) {
+      break;
+    }
+    auto cached_image = std::make_shared<CachedImage>();
+    prefetched_images_.emplace(image_idx, cached_image);
+    prefetch_num_bytes_ += num_bytes;
+    prefetch_thread_pool_->AddTask(&CachedWorkspace::PrefetchImage,
+                                   this,
+                                   image_idx,
+                                   std::move(cached_image));
+  }
+}
+
+void CachedWorkspace::WaitForPrefetch() {
+  if (prefetch_thread_pool_) {
+    prefetch_thread_pool_->Wait();
+  }
+}
+
+size_t CachedWorkspace::NumCachedBytes() {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  return cache_.NumBytes();
+}
+
+size_t CachedWorkspace::EstimateNumBytes(const int image_idx) const {
+  const auto& image = model_.images.at(image_idx);
+  const size_t num_pixels =
+      static_cast<size_t>(image.GetWidth()) * image.GetHeight();
+  const size_t num_bitmap_channels = options_.image_as_rgb ? 3 : 1;
+  return num_pixels * (num_bitmap_channels + 4 * sizeof(float));
+}
+
+std::shared_ptr<CachedWorkspace::CachedImage> CachedWorkspace::GetCachedImage(
+    const int image_idx) {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  return cache_.Get(image_idx);
+}
+
+void CachedWorkspace::UpdateCachedImage(const int image_idx) {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  // The image might have been evicted concurrently by another thread or it
+  // might be a prefetched image that was not requested yet.
+  if (cache_.Exists(image_idx)) {
     cache_.UpdateNumBytes(image_idx);
   }
-  return *cached_image->depth_map;
 }
 
-const NormalMap& CachedWorkspace::GetNormalMap(const int image_idx) {
-  auto cached_image = cache_.Get(image_idx);
+void CachedWorkspace::ErasePrefetchedImage(const int image_idx) {
+  if (prefetched_images_.erase(image_idx) > 0) {
+    prefetch_num_bytes_ -= EstimateNumBytes(image_idx);
+  }
+}
+
+void CachedWorkspace::LoadBitmap(const int image_idx,
+                                 CachedImage* cached_image) {
+  if (cached_image->bitmap) {
+    return;
+  }
+  auto bitmap = std::make_unique<Bitmap>();
+  bitmap->Read(GetBitmapPath(image_idx), options_.image_as_rgb);
+  if (options_.max_image_size > 0) {
+    bitmap->Rescale(model_.images.at(image_idx).GetWidth(),
+                    model_.images.at(image_idx).GetHeight());
+  }
+  cached_image->num_bytes += bitmap->NumBytes();
+  cached_image->bitmap = std::move(bitmap);
+  UpdateCachedImage(image_idx);
+}
+
+void CachedWorkspace::LoadDepthMap(const int image_idx,
+                                   CachedImage* cached_image) {
+  if (cached_image->depth_map) {
+    return;
+  }
+  auto depth_map = std::make_unique<DepthMap>();
+  depth_map->ReadMapped(GetDepthMapPath(image_idx));
+  if (options_.max_image_size > 0) {
+    depth_map->Downsize(model_.images.at(image_idx).GetWidth(),
+                        model_.images.at(image_idx).GetHeight());
+  }
+  cached_image->num_bytes += depth_map->GetNumBytes();
+  cached_image->depth_map = std::move(depth_map);
+  UpdateCachedImage(image_idx);
+}
+
+void CachedWorkspace::LoadNormalMap(const int image_idx,
+                                    CachedImage* cached_image) {
+  if (cached_image->normal_map) {
+    return;
+  }
+  auto normal_map = std::make_unique<NormalMap>();
+  normal_map->ReadMapped(GetNormalMapPath(image_idx));
+  if (options_.max_image_size > 0) {
+    normal_map->Downsize(model_.images.at(image_idx).GetWidth(),
+                         model_.images.at(image_idx).GetHeight());
+  }
+  cached_image->num_bytes += normal_map->GetNumBytes();
+  cached_image->normal_map = std::move(normal_map);
+  UpdateCachedImage(image_idx);
+}
+
+void CachedWorkspace::PrefetchImage(
+    const int image_idx, const std::shared_ptr<CachedImage> cached_image) {
   std::lock_guard<std::mutex> lock(cached_image->mutex);
-  if (!cached_image->normal_map) {
-    cached_image->normal_map = std::make_unique<NormalMap>();
-    cached_image->normal_map->Read(GetNormalMapPath(image_idx));
-    if (options_.max_image_size > 0) {
-      cached_image->normal_map->Downsize(
-          model_.images.at(image_idx).GetWidth(),
-          model_.images.at(image_idx).GetHeight());
-    }
-    cached_image->num_bytes += cached_image->normal_map->GetNumBytes();
-    cache_.UpdateNumBytes(image_idx);
+  try {
+    LoadDepthMap(image_idx, cached_image.get());
+    LoadNormalMap(image_idx, cached_image.get());
+    LoadBitmap(image_idx, cached_image.get());
+  } catch (const std::exception& e) {
+    // Errors are reported when the data is requested synchronously.
+    VLOG(2) << "Failed to prefetch image " << image_idx << ": " << e.what();
   }
-  return *cached_image->normal_map;
+}
+
+std::shared_ptr<const Bitmap> CachedWorkspace::GetBitmap(const int image_idx) {
+  auto cached_image = GetCachedImage(image_idx);
+  std::lock_guard<std::mutex> lock(cached_image->mutex);
+  LoadBitmap(image_idx, cached_image.get());
+  // The handle shares ownership of the cached image, such that the bitmap
+  // outlives an eviction from the cache.
+  return std::shared_ptr<const Bitmap>(cached_image,
+                                       cached_image->bitmap.get());
+}
+
+std::shared_ptr<const DepthMap> CachedWorkspace::GetDepthMap(
+    const int image_idx) {
+  auto cached_image = GetCachedImage(image_idx);
+  std::lock_guard<std::mutex> lock(cached_image->mutex);
+  LoadDepthMap(image_idx, cached_image.get());
+  return std::shared_ptr<const DepthMap>(cached_image,
+                                         cached_image->depth_map.get());
+}
+
+std::shared_ptr<const NormalMap> CachedWorkspace::GetNormalMap(
+    const int image_idx) {
+  auto cached_image = GetCachedImage(image_idx);
+  std::lock_guard<std::mutex> lock(cached_image->mutex);
+  LoadNormalMap(image_idx, cached_image.get());
+  return std::shared_ptr<const NormalMap>(cached_image,
+                                          cached_image->normal_map.get());
 }
 
 void ImportPMVSWorkspace(const Workspace& workspace,
@@ -35,8 +35,12 @@
 #include "colmap/mvs/normal_map.h"
 #include "colmap/sensor/bitmap.h"
 #include "colmap/util/cache.h"
+#include "colmap/util/threading.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace colmap {
 namespace mvs {
@@ -66,22 +70,37 @@ class Workspace {
   explicit Workspace(const Options& options);
   virtual ~Workspace() = default;
 
-  // Do nothing when we use a cache. Data is loaded as needed.
+  // Do nothing when we use a cache. Data is loaded as needed. Images that
+  // were already loaded before are not loaded again.
   virtual void Load(const std::vector<std::string>& image_names);
 
+  // Release the data of the given images. When we use a cache, the images are
+  // evicted from the cache.
+  virtual void Unload(const std::vector<std::string>& image_names);
+
+  // Start loading the data of the given images in the background, so that
+  // subsequent calls to the getters do not block on disk I/O. Do nothing when
+  // we do not use a cache, since all data is loaded upfront.
+  virtual void Prefetch(const std::vector<int>& image_idxs) {}
+
   inline const Options& GetOptions() const { return options_; }
 
   inline const Model& GetModel() const { return model_; }
 
-  virtual const Bitmap& GetBitmap(int image_idx);
-  virtual const DepthMap& GetDepthMap(int image_idx);
-  virtual const NormalMap& GetNormalMap(int image_idx);
+  // Get the data of an image. The returned handles keep the data alive, even
+  // if the image is concurrently unloaded or evicted from the cache.
+  virtual std::shared_ptr<const Bitmap> GetBitmap(int image_idx);
+  virtual std::shared_ptr<const DepthMap> GetDepthMap(int image_idx);
+  virtual std::shared_ptr<const NormalMap> GetNormalMap(int image_idx);
 
   // Get paths to bitmap, depth map, normal map and consistency graph.
   std::string GetBitmapPath(int image_idx) const;
   std::string GetDepthMapPath(int image_idx) const;
   std::string GetNormalMapPath(int image_idx) const;
 
+  // Get the path to the cached overlaps between the images of the model.
+  std::string GetImageOverlapsPath() const;
+
   // Return whether bitmap, depth map, normal map, and consistency graph exist.
   bool HasBitmap(int image_idx) const;
   bool HasDepthMap(int image_idx) const;
@@ -96,9 +115,9 @@ class Workspace {
  private:
   std::string depth_map_path_;
   std::string normal_map_path_;
-  std::vector<std::unique_ptr<Bitmap>> bitmaps_;
-  std::vector<std::unique_ptr<DepthMap>> depth_maps_;
-  std::vector<std::unique_ptr<NormalMap>> normal_maps_;
+  std::vector<std::shared_ptr<Bitmap>> bitmaps_;
+  std::vector<std::shared_ptr<DepthMap>> depth_maps_;
+  std::vector<std::shared_ptr<NormalMap>> normal_maps_;
 };
 
 class CachedWorkspace : public Workspace {
@@ -106,12 +125,26 @@ class CachedWorkspace : public Workspace {
   explicit CachedWorkspace(const Options& options);
 
   void Load(const std::vector<std::string>& image_names) override {}
+  void Unload(const std::vector<std::string>& image_names) override;
+
+  void ClearCache();
+
+  // Images are only prefetched into the free capacity of the cache. Prefetched
+  // images are kept outside of the cache until they are first requested, so
+  // prefetching never evicts cached data. Images that are already cached or
+  // prefetched are skipped.
+  void Prefetch(const std::vector<int>& image_idxs) override;
+
+  // Block until all pending prefetches have finished.
+  void WaitForPrefetch();
 
-  inline void ClearCache() { cache_.Clear(); }
+  std::shared_ptr<const Bitmap> GetBitmap(int image_idx) override;
+  std::shared_ptr<const DepthMap> GetDepthMap(int image_idx) override;
+  std::shared_ptr<const NormalMap> GetNormalMap(int image_idx) override;
 
-  const Bitmap& GetBitmap(int image_idx) override;
-  const DepthMap& GetDepthMap(int image_idx) override;
-  const NormalMap& GetNormalMap(int image_idx) override;
+  // Number of bytes of the cached images, excluding prefetched images that
+  // were not requested yet.
+  size_t NumCachedBytes();
 
  private:
   class CachedImage {
@@ -120,7 +153,7 @@ class CachedWorkspace : public Workspace {
     CachedImage(CachedImage&& other) noexcept;
     CachedImage& operator=(CachedImage&& other) noexcept;
     inline size_t NumBytes() const { return num_bytes; }
-    size_t num_bytes = 0;
+    std::atomic<size_t> num_bytes{0};
     std::mutex mutex;
     std::unique_ptr<Bitmap> bitmap;
     std::unique_ptr<DepthMap> depth_map;
@@ -130,7 +163,26 @@ class CachedWorkspace : public Workspace {
     NON_COPYABLE(CachedImage)
   };
 
+  // Estimated number of bytes of the bitmap, depth map, and normal map.
+  size_t EstimateNumBytes(int image_idx) const;
+  std::shared_ptr<CachedImage> GetCachedImage(int image_idx);
+  void UpdateCachedImage(int image_idx);
+  void LoadBitmap(int image_idx, CachedImage* cached_image);
+  void LoadDepthMap(int image_idx, CachedImage* cached_image);
+  void LoadNormalMap(int image_idx, CachedImage* cached_image);
+  void PrefetchImage(int image_idx, std::shared_ptr<CachedImage> cached_image);
+  void ErasePrefetchedImage(int image_idx);
+
+  // Guards the cache and the prefetched images, which are concurrently
+  // accessed by the prefetch threads.
+  std::mutex cache_mutex_;
   MemoryConstrainedLRUCache<int, CachedImage> cache_;
+  // Prefetched images that were not requested yet and their estimated total
+  // number of bytes. Requested images are moved into the cache.
+  std::unordered_map<int, std::shared_ptr<CachedImage>> prefetched_images_;
+  size_t prefetch_num_bytes_ = 0;
+  // Destroyed before the cache, so running prefetches finish first.
+  std::unique_ptr<ThreadPool> prefetch_thread_pool_;
 };
 
 // Import a PMVS workspace into the COLMAP workspace format. Only images in the
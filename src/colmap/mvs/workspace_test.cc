@@ -0,0 +1,206 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "colmap/mvs/workspace.h"
+
+#include "colmap/mvs/mat_file.h"
+#include "colmap/scene/reconstruction.h"
+#include "colmap/scene/synthetic.h"
+#include "colmap/util/file.h"
+#include "colmap/util/testing.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace mvs {
+namespace {
+
+constexpr int kWidth = 40;
+constexpr int kHeight = 30;
+
+// Estimated number of bytes of the data of one image, see
+// CachedWorkspace::EstimateNumBytes.
+constexpr size_t kNumBytesPerImage = kWidth * kHeight * (3 + 4 * sizeof(float));
+
+// Create a workspace, where the depth of all pixels of an image is its index.
+// The depth maps are stored in the memory-mappable binary format and the
+// normal maps in the legacy format.
+Workspace::Options CreateWorkspace(const int num_images) {
+  const std::string workspace_path = CreateTestDir();
+
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_rigs = 1;
+  synthetic_dataset_options.num_cameras_per_rig = 1;
+  synthetic_dataset_options.num_frames_per_rig = num_images;
+  synthetic_dataset_options.camera_width = kWidth;
+  synthetic_dataset_options.camera_height = kHeight;
+  synthetic_dataset_options.camera_params = {50, 20, 15, 0};
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+  for (const auto& [image_id, image] : reconstruction.Images()) {
+    reconstruction.Image(image_id).SetName(image.Name() + ".png");
+  }
+  const std::string sparse_path = JoinPaths(workspace_path, "sparse");
+  CreateDirIfNotExists(sparse_path);
+  reconstruction.Write(sparse_path);
+
+  Workspace::Options options;
+  options.workspace_path = workspace_path;
+  options.workspace_format = "COLMAP";
+  options.input_type = "geometric";
+
+  CreateDirIfNotExists(JoinPaths(workspace_path, "images"));
+  CreateDirIfNotExists(JoinPaths(workspace_path, options.stereo_folder));
+  const Workspace workspace(options);
+  CreateDirIfNotExists(EnsureTrailingSlash(
+      GetParentDir(workspace.GetDepthMapPath(/*image_idx=*/0))));
+  CreateDirIfNotExists(EnsureTrailingSlash(
+      GetParentDir(workspace.GetNormalMapPath(/*image_idx=*/0))));
+  for (int image_idx = 0; image_idx < num_images; ++image_idx) {
+    Bitmap bitmap;
+    bitmap.Allocate(kWidth, kHeight, /*as_rgb=*/true);
+    bitmap.Fill(BitmapColor<uint8_t>(image_idx));
+    EXPECT_TRUE(bitmap.Write(workspace.GetBitmapPath(image_idx)));
+    DepthMap depth_map(kWidth, kHeight, 0, num_images);
+    depth_map.Fill(image_idx);
+    WriteMatFile(workspace.GetDepthMapPath(image_idx), depth_map);
+    NormalMap normal_map(kWidth, kHeight);
+    normal_map.Fill(1);
+    normal_map.Write(workspace.GetNormalMapPath(image_idx));
+  }
+
+  return options;
+}
+
+TEST(CachedWorkspace, Get) {
+  constexpr int kNumImages = 3;
+  Workspace::Options options = CreateWorkspace(kNumImages);
+  CachedWorkspace workspace(options);
+  for (int image_idx = 0; image_idx < kNumImages; ++image_idx) {
+    const auto bitmap = workspace.GetBitmap(image_idx);
+    EXPECT_EQ(bitmap->Width(), kWidth);
+    EXPECT_EQ(bitmap->Height(), kHeight);
+    BitmapColor<uint8_t> color;
+    EXPECT_TRUE(bitmap->GetPixel(0, 0, &color));
+    EXPECT_EQ(color, BitmapColor<uint8_t>(image_idx));
+    EXPECT_EQ(workspace.GetDepthMap(image_idx)->Get(0, 0), image_idx);
+    EXPECT_EQ(workspace.GetNormalMap(image_idx)->Get(0, 0, 2), 1);
+  }
+  EXPECT_EQ(workspace.NumCachedBytes(), kNumImages * kNumBytesPerImage);
+
+  workspace.Unload({workspace.GetModel().GetImageName(0)});
+  EXPECT_EQ(workspace.NumCachedBytes(), (kNumImages - 1) * kNumBytesPerImage);
+  workspace.ClearCache();
+  EXPECT_EQ(workspace.NumCachedBytes(), 0);
+}
+
+TEST(CachedWorkspace, HandlesOutliveEviction) {
+  constexpr int kNumImages = 3;
+  Workspace::Options options = CreateWorkspace(kNumImages);
+  // The cache only fits the data of a single image.
+  options.cache_size = 1.5 * kNumBytesPerImage / (1024.0 * 1024.0 * 1024.0);
+  CachedWorkspace workspace(options);
+  const auto depth_map = workspace.GetDepthMap(0);
+  const auto normal_map = workspace.GetNormalMap(0);
+  const auto bitmap = workspace.GetBitmap(0);
+  for (int image_idx = 1; image_idx < kNumImages; ++image_idx) {
+    workspace.GetDepthMap(image_idx);
+    workspace.GetNormalMap(image_idx);
+    workspace.GetBitmap(image_idx);
+    EXPECT_LE(workspace.NumCachedBytes(), kNumBytesPerImage);
+  }
+  EXPECT_EQ(depth_map->Get(kHeight - 1, kWidth - 1), 0);
+  EXPECT_EQ(normal_map->Get(kHeight - 1, kWidth - 1, 2), 1);
+  EXPECT_EQ(bitmap->Width(), kWidth);
+}
+
+TEST(CachedWorkspace, PrefetchTightBudget) {
+  constexpr int kNumImages = 4;
+  Workspace::Options options = CreateWorkspace(kNumImages);
+  // The cache only fits the data of two images.
+  options.cache_size = 2.5 * kNumBytesPerImage / (1024.0 * 1024.0 * 1024.0);
+  CachedWorkspace workspace(options);
+
+  const auto depth_map = workspace.GetDepthMap(0);
+  workspace.GetNormalMap(0);
+  workspace.GetBitmap(0);
+  EXPECT_EQ(workspace.NumCachedBytes(), kNumBytesPerImage);
+
+  // Only the first image fits into the free capacity and prefetched images
+  // are not added to the cache before they are requested.
+  workspace.Prefetch({0, 1, 2, 3});
+  workspace.WaitForPrefetch();
+  EXPECT_EQ(workspace.NumCachedBytes(), kNumBytesPerImage);
+
+  EXPECT_EQ(workspace.GetDepthMap(1)->Get(0, 0), 1);
+  EXPECT_EQ(workspace.NumCachedBytes(), 2 * kNumBytesPerImage);
+  for (int image_idx = 2; image_idx < kNumImages; ++image_idx) {
+    EXPECT_EQ(workspace.GetDepthMap(image_idx)->Get(0, 0), image_idx);
+    EXPECT_EQ(workspace.GetNormalMap(image_idx)->Get(0, 0, 2), 1);
+    workspace.GetBitmap(image_idx);
+    EXPECT_LE(workspace.NumCachedBytes(), 2 * kNumBytesPerImage);
+  }
+  EXPECT_EQ(depth_map->Get(0, 0), 0);
+}
+
+TEST(CachedWorkspace, ConcurrentPrefetchAndGet) {
+  constexpr int kNumImages = 6;
+  Workspace::Options options = CreateWorkspace(kNumImages);
+  options.num_threads = 2;
+  options.cache_size = 2.5 * kNumBytesPerImage / (1024.0 * 1024.0 * 1024.0);
+  CachedWorkspace workspace(options);
+
+  std::vector<std::thread> threads;
+  for (int thread_idx = 0; thread_idx < 3; ++thread_idx) {
+    threads.emplace_back([&workspace, thread_idx]() {
+      for (int i = 0; i < 50; ++i) {
+        const int image_idx = (thread_idx + i) % kNumImages;
+        workspace.Prefetch(
+            {(image_idx + 1) % kNumImages, (image_idx + 2) % kNumImages});
+        const auto depth_map = workspace.GetDepthMap(image_idx);
+        const auto normal_map = workspace.GetNormalMap(image_idx);
+        const auto bitmap = workspace.GetBitmap(image_idx);
+        EXPECT_EQ(depth_map->Get(kHeight - 1, kWidth - 1), image_idx);
+        EXPECT_EQ(normal_map->Get(kHeight - 1, kWidth - 1, 2), 1);
+        EXPECT_EQ(bitmap->Width(), kWidth);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  workspace.WaitForPrefetch();
+}
+
+}  // namespace
+}  // namespace mvs
+}  // namespace colmap
@@ -29,10 +29,13 @@
 
 #include "colmap/scene/camera.h"
 
+#include "colmap/sensor/inverse_distortion_grid.h"
 #include "colmap/sensor/models.h"
 #include "colmap/util/logging.h"
 #include "colmap/util/misc.h"
 
+#include <limits>
+
 namespace colmap {
 
 Camera Camera::CreateFromModelId(camera_t camera_id,
@@ -60,6 +63,21 @@ Camera Camera::CreateFromModelName(camera_t camera_id,
       camera_id, CameraModelNameToId(model_name), focal_length, width, height);
 }
 
+void Camera::BuildInverseDistortionGrid() {
+  BuildInverseDistortionGrid(InverseDistortionGridOptions());
+}
+
+void Camera::BuildInverseDistortionGrid(
+    const InverseDistortionGridOptions& options) {
+  inverse_distortion_grid = std::make_shared<const InverseDistortionGrid>(
+      model_id, params, width, height, options);
+}
+
+bool Camera::HasInverseDistortionGrid() const {
+  return inverse_distortion_grid != nullptr &&
+         inverse_distortion_grid->Matches(model_id, params);
+}
+
 Eigen::Matrix3d Camera::CalibrationMatrix() const {
   Eigen::Matrix3d K = Eigen::Matrix3d::Identity();
 
@@ -150,6 +168,43 @@ void Camera::Rescale(const size_t new_width, const size_t new_height) {
   }
 }
 
+std::optional<Eigen::Vector2d> Camera::CamFromImgWithInverseDistortionGrid(
+    const Eigen::Vector2d& image_point) const {
+  if (HasInverseDistortionGrid()) {
+    Eigen::Vector2d cam_point;
+    if (inverse_distortion_grid->CamFromImg(
+            image_point.x(), image_point.y(), &cam_point.x(), &cam_point.y())) {
+      return cam_point;
+    }
+  }
+  return CameraModelCamFromImg(model_id, params, image_point);
+}
+
+void Camera::CamFromImgBatchWithInverseDistortionGrid(
+    span<const Eigen::Vector2d> image_points,
+    span<Eigen::Vector2d> cam_points) const {
+  if (!HasInverseDistortionGrid()) {
+    CameraModelCamFromImgBatch(model_id, params, image_points, cam_points);
+    return;
+  }
+  THROW_CHECK_EQ(image_points.size(), cam_points.size());
+  for (size_t i = 0; i < image_points.size(); ++i) {
+    const Eigen::Vector2d& image_point = image_points[i];
+    Eigen::Vector2d& cam_point = cam_points[i];
+    if (inverse_distortion_grid->CamFromImg(
+            image_point.x(), image_point.y(), &cam_point.x(), &cam_point.y())) {
+      continue;
+    }
+    if (const std::optional<Eigen::Vector2d> exact_cam_point =
+            CameraModelCamFromImg(model_id, params, image_point);
+        exact_cam_point) {
+      cam_point = *exact_cam_point;
+    } else {
+      cam_point.setConstant(std::numeric_limits<double>::quiet_NaN());
+    }
+  }
+}
+
 std::ostream& operator<<(std::ostream& stream, const Camera& camera) {
   const bool valid_model = ExistsCameraModelWithId(camera.model_id);
   const std::string camera_id_str = camera.camera_id != kInvalidCameraId
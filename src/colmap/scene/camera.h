@@ -34,12 +34,16 @@
 #include "colmap/util/logging.h"
 #include "colmap/util/types.h"
 
+#include <memory>
 #include <vector>
 
 #include <Eigen/Geometry>
 
 namespace colmap {
 
+class InverseDistortionGrid;
+struct InverseDistortionGridOptions;
+
 // Camera class that holds the intrinsic parameters. Cameras may be shared
 // between multiple images, e.g., if the same "physical" camera took multiple
 // pictures with the exact same lens and intrinsics (focal length, etc.).
@@ -63,6 +67,11 @@ struct Camera {
   // e.g. manually provided or extracted from EXIF
   bool has_prior_focal_length = false;
 
+  // Optional cached inverse distortion used by CamFromImg. It is only used as
+  // long as it matches the model and parameters of the camera, so that it
+  // never returns stale results after the parameters changed.
+  std::shared_ptr<const InverseDistortionGrid> inverse_distortion_grid;
+
   // Initialize parameters for given camera model and focal length, and set
   // the principal point to be the image center.
   static Camera CreateFromModelId(camera_t camera_id,
@@ -126,6 +135,14 @@ struct Camera {
                              double max_focal_length_ratio,
                              double max_extra_param) const;
 
+  // Build the inverse distortion grid for the current parameters, which
+  // accelerates CamFromImg for models with an iterative inverse.
+  void BuildInverseDistortionGrid();
+  void BuildInverseDistortionGrid(const InverseDistortionGridOptions& options);
+
+  // Whether the inverse distortion grid matches the current parameters.
+  bool HasInverseDistortionGrid() const;
+
   // Project point in image plane to camera ray (not unit normalized).
   inline std::optional<Eigen::Vector2d> CamFromImg(
       const Eigen::Vector2d& image_point) const;
@@ -137,6 +154,14 @@ struct Camera {
   inline std::optional<Eigen::Vector2d> ImgFromCam(
       const Eigen::Vector3d& cam_point) const;
 
+  // Batched versions of `CamFromImg` and `ImgFromCam`, which dispatch the
+  // camera model once for all points. Points for which the transformation
+  // fails are set to NaN.
+  inline void CamFromImgBatch(span<const Eigen::Vector2d> image_points,
+                              span<Eigen::Vector2d> cam_points) const;
+  inline void ImgFromCamBatch(span<const Eigen::Vector3d> cam_points,
+                              span<Eigen::Vector2d> image_points) const;
+
   // Rescale camera dimensions and accordingly the focal length and
   // and the principal point.
   void Rescale(double scale);
@@ -144,6 +169,15 @@ struct Camera {
 
   inline bool operator==(const Camera& other) const;
   inline bool operator!=(const Camera& other) const;
+
+ private:
+  // Transformations using the inverse distortion grid, if it matches the
+  // current parameters, and otherwise the iterative solve of the model.
+  std::optional<Eigen::Vector2d> CamFromImgWithInverseDistortionGrid(
+      const Eigen::Vector2d& image_point) const;
+  void CamFromImgBatchWithInverseDistortionGrid(
+      span<const Eigen::Vector2d> image_points,
+      span<Eigen::Vector2d> cam_points) const;
 };
 
 std::ostream& operator<<(std::ostream& stream, const Camera& camera);
@@ -253,6 +287,9 @@ bool Camera::HasBogusParams(const double min_focal_length_ratio,
 
 std::optional<Eigen::Vector2d> Camera::CamFromImg(
     const Eigen::Vector2d& image_point) const {
+  if (inverse_distortion_grid != nullptr) {
+    return CamFromImgWithInverseDistortionGrid(image_point);
+  }
   return CameraModelCamFromImg(model_id, params, image_point);
 }
 
@@ -265,6 +302,20 @@ std::optional<Eigen::Vector2d> Camera::ImgFromCam(
   return CameraModelImgFromCam(model_id, params, cam_point);
 }
 
+void Camera::CamFromImgBatch(span<const Eigen::Vector2d> image_points,
+                             span<Eigen::Vector2d> cam_points) const {
+  if (inverse_distortion_grid != nullptr) {
+    CamFromImgBatchWithInverseDistortionGrid(image_points, cam_points);
+    return;
+  }
+  CameraModelCamFromImgBatch(model_id, params, image_points, cam_points);
+}
+
+void Camera::ImgFromCamBatch(span<const Eigen::Vector3d> cam_points,
+                             span<Eigen::Vector2d> image_points) const {
+  CameraModelImgFromCamBatch(model_id, params, cam_points, image_points);
+}
+
 bool Camera::operator==(const Camera& other) const {
   return camera_id == other.camera_id && model_id == other.model_id &&
          width == other.width && height == other.height &&
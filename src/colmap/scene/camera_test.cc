@@ -31,6 +31,8 @@
 
 #include "colmap/sensor/models.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 namespace colmap {
@@ -281,6 +283,42 @@ TEST(Camera, CamFromImg) {
             Eigen::Vector2d(0, 0));
 }
 
+TEST(Camera, CamFromImgWithInverseDistortionGrid) {
+  Camera camera = Camera::CreateFromModelName(1, "OPENCV", 500, 640, 480);
+  camera.params[4] = 0.05;
+  camera.params[5] = -0.02;
+  Camera camera_with_grid = camera;
+  EXPECT_FALSE(camera_with_grid.HasInverseDistortionGrid());
+  camera_with_grid.BuildInverseDistortionGrid();
+  EXPECT_TRUE(camera_with_grid.HasInverseDistortionGrid());
+
+  const std::vector<Eigen::Vector2d> image_points = {
+      Eigen::Vector2d(100.3, 200.7),
+      Eigen::Vector2d(0.5, 0.5),
+      Eigen::Vector2d(-100, 1000)};
+  std::vector<Eigen::Vector2d> cam_points(image_points.size());
+  camera_with_grid.CamFromImgBatch(
+      span<const Eigen::Vector2d>(image_points.data(), image_points.size()),
+      span<Eigen::Vector2d>(cam_points.data(), cam_points.size()));
+  for (size_t i = 0; i < image_points.size(); ++i) {
+    const Eigen::Vector2d expected_cam_point =
+        camera.CamFromImg(image_points[i]).value();
+    EXPECT_LT(
+        (camera_with_grid.CamFromImg(image_points[i]).value() -
+         expected_cam_point)
+            .norm(),
+        1e-6);
+    EXPECT_LT((cam_points[i] - expected_cam_point).norm(), 1e-6);
+  }
+
+  // Stale grids are ignored.
+  camera_with_grid.params[4] = 0.1;
+  EXPECT_FALSE(camera_with_grid.HasInverseDistortionGrid());
+  camera.params[4] = 0.1;
+  EXPECT_EQ(camera_with_grid.CamFromImg(image_points[0]).value(),
+            camera.CamFromImg(image_points[0]).value());
+}
+
 TEST(Camera, CamFromImgThreshold) {
   Camera camera;
   EXPECT_THROW(camera.CamFromImgThreshold(0), std::domain_error);
@@ -304,6 +342,35 @@ TEST(Camera, ImgFromCam) {
             Eigen::Vector2d(0.0, 0.0));
 }
 
+TEST(Camera, CamFromImgBatch) {
+  const Camera camera =
+      Camera::CreateFromModelName(1, "SIMPLE_PINHOLE", 1.0, 1, 1);
+  const std::vector<Eigen::Vector2d> image_points = {Eigen::Vector2d(0, 0),
+                                                     Eigen::Vector2d(0.5, 0.5)};
+  std::vector<Eigen::Vector2d> cam_points(image_points.size());
+  camera.CamFromImgBatch(
+      span<const Eigen::Vector2d>(image_points.data(), image_points.size()),
+      span<Eigen::Vector2d>(cam_points.data(), cam_points.size()));
+  EXPECT_EQ(cam_points[0], Eigen::Vector2d(-0.5, -0.5));
+  EXPECT_EQ(cam_points[1], Eigen::Vector2d(0, 0));
+}
+
+TEST(Camera, ImgFromCamBatch) {
+  const Camera camera =
+      Camera::CreateFromModelName(1, "SIMPLE_PINHOLE", 1.0, 1, 1);
+  const std::vector<Eigen::Vector3d> cam_points = {
+      Eigen::Vector3d(0, 0, 1),
+      Eigen::Vector3d(-0.5, -0.5, 1),
+      Eigen::Vector3d(0, 0, -1)};
+  std::vector<Eigen::Vector2d> image_points(cam_points.size());
+  camera.ImgFromCamBatch(
+      span<const Eigen::Vector3d>(cam_points.data(), cam_points.size()),
+      span<Eigen::Vector2d>(image_points.data(), image_points.size()));
+  EXPECT_EQ(image_points[0], Eigen::Vector2d(0.5, 0.5));
+  EXPECT_EQ(image_points[1], Eigen::Vector2d(0, 0));
+  EXPECT_TRUE(image_points[2].array().isNaN().all());
+}
+
 TEST(Camera, Rescale) {
   Camera camera = Camera::CreateFromModelName(1, "SIMPLE_PINHOLE", 1.0, 1, 1);
   camera.Rescale(2.0);
@@ -29,6 +29,11 @@
 
 #include "colmap/scene/projection.h"
 
+#include "colmap/util/logging.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <limits>
 
 namespace colmap {
@@ -60,6 +65,82 @@ double CalculateSquaredReprojectionError(
   return (*proj_point2D - point2D).squaredNorm();
 }
 
+namespace {
+
+template <typename CameraModel>
+void CalculateSquaredReprojectionErrorsImpl(
+    span<const Eigen::Vector2d> points2D,
+    span<const Eigen::Vector3d> points3D,
+    const Eigen::Matrix3x4d& cam_from_world,
+    const double* params,
+    span<double> squared_errors) {
+  constexpr size_t kChunkSize = 256;
+  std::array<Eigen::Vector3d, kChunkSize> cam_points;
+  std::array<Eigen::Vector2d, kChunkSize> proj_points2D;
+
+  const Eigen::Matrix3x4d& P = cam_from_world;
+  const size_t num_points = points2D.size();
+  for (size_t begin = 0; begin < num_points; begin += kChunkSize) {
+    const size_t chunk_size = std::min(kChunkSize, num_points - begin);
+    const Eigen::Vector3d* xyz = points3D.begin() + begin;
+    const Eigen::Vector2d* obs = points2D.begin() + begin;
+
+    for (size_t i = 0; i < chunk_size; ++i) {
+      const double X = xyz[i].x();
+      const double Y = xyz[i].y();
+      const double Z = xyz[i].z();
+      cam_points[i].x() = P(0, 0) * X + P(0, 1) * Y + P(0, 2) * Z + P(0, 3);
+      cam_points[i].y() = P(1, 0) * X + P(1, 1) * Y + P(1, 2) * Z + P(1, 3);
+      cam_points[i].z() = P(2, 0) * X + P(2, 1) * Y + P(2, 2) * Z + P(2, 3);
+    }
+
+    CameraModel::ImgFromCamBatch(
+        params,
+        span<const Eigen::Vector3d>(cam_points.data(), chunk_size),
+        span<Eigen::Vector2d>(proj_points2D.data(), chunk_size));
+
+    double* errors = squared_errors.begin() + begin;
+    for (size_t i = 0; i < chunk_size; ++i) {
+      const double dx = proj_points2D[i].x() - obs[i].x();
+      const double dy = proj_points2D[i].y() - obs[i].y();
+      errors[i] = std::isnan(proj_points2D[i].x())
+                      ? std::numeric_limits<double>::max()
+                      : dx * dx + dy * dy;
+    }
+  }
+}
+
+}  // namespace
+
+void CalculateSquaredReprojectionErrors(span<const Eigen::Vector2d> points2D,
+                                        span<const Eigen::Vector3d> points3D,
+                                        const Rigid3d& cam_from_world,
+                                        const Camera& camera,
+                                        span<double> squared_errors) {
+  THROW_CHECK_EQ(points2D.size(), points3D.size());
+  THROW_CHECK_EQ(points2D.size(), squared_errors.size());
+  if (points2D.size() == 0) {
+    return;
+  }
+
+  const Eigen::Matrix3x4d cam_from_world_matrix = cam_from_world.ToMatrix();
+  switch (camera.model_id) {
+#define CAMERA_MODEL_CASE(CameraModel)                   \
+  case CameraModel::model_id:                            \
+    CalculateSquaredReprojectionErrorsImpl<CameraModel>( \
+        points2D,                                        \
+        points3D,                                        \
+        cam_from_world_matrix,                           \
+        camera.params.data(),                            \
+        squared_errors);                                 \
+    break;
+
+    CAMERA_MODEL_SWITCH_CASES
+
+#undef CAMERA_MODEL_CASE
+  }
+}
+
 double CalculateAngularReprojectionError(const Eigen::Vector2d& point2D,
                                          const Eigen::Vector3d& point3D,
                                          const Rigid3d& cam_from_world,
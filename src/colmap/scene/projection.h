@@ -32,6 +32,7 @@
 #include "colmap/geometry/rigid3.h"
 #include "colmap/scene/camera.h"
 #include "colmap/util/eigen_alignment.h"
+#include "colmap/util/types.h"
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -53,6 +54,17 @@ double CalculateSquaredReprojectionError(
     const Eigen::Matrix3x4d& cam_from_world,
     const Camera& camera);
 
+// Calculate the squared reprojection errors of many observations in the same
+// image. The camera model is dispatched once per batch and the observations
+// are projected in fixed-size structure-of-arrays chunks, which lets the
+// compiler vectorize the transformation and the model-specific projection.
+// Points behind the camera yield DBL_MAX, as in the scalar version.
+void CalculateSquaredReprojectionErrors(span<const Eigen::Vector2d> points2D,
+                                        span<const Eigen::Vector3d> points3D,
+                                        const Rigid3d& cam_from_world,
+                                        const Camera& camera,
+                                        span<double> squared_errors);
+
 // Calculate the angular reprojection error.
 //
 // The angular error is the angle between the observed viewing ray and the
@@ -32,6 +32,9 @@
 #include "colmap/sensor/models.h"
 #include "colmap/util/eigen_alignment.h"
 
+#include <limits>
+#include <vector>
+
 #include <Eigen/Core>
 #include <gtest/gtest.h>
 
@@ -69,6 +72,57 @@ TEST(CalculateSquaredReprojectionError, Nominal) {
               1e-6);
 }
 
+class ParameterizedCalculateSquaredReprojectionErrorsTests
+    : public ::testing::TestWithParam<CameraModelId> {};
+
+TEST_P(ParameterizedCalculateSquaredReprojectionErrorsTests, MatchesScalar) {
+  const Rigid3d cam_from_world(Eigen::Quaterniond::UnitRandom(),
+                               Eigen::Vector3d::Random());
+  const Camera camera =
+      Camera::CreateFromModelId(1, GetParam(), 100, 200, 100);
+
+  // More than one chunk and some points behind the camera.
+  const size_t kNumPoints = 1000;
+  std::vector<Eigen::Vector2d> points2D(kNumPoints);
+  std::vector<Eigen::Vector3d> points3D(kNumPoints);
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    points3D[i] = Eigen::Vector3d::Random() * 5;
+    points2D[i] = 100 * Eigen::Vector2d::Random().cwiseAbs();
+  }
+
+  std::vector<double> squared_errors(kNumPoints);
+  CalculateSquaredReprojectionErrors(
+      span<const Eigen::Vector2d>(points2D.data(), points2D.size()),
+      span<const Eigen::Vector3d>(points3D.data(), points3D.size()),
+      cam_from_world,
+      camera,
+      span<double>(squared_errors.data(), squared_errors.size()));
+
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    const double expected_squared_error = CalculateSquaredReprojectionError(
+        points2D[i], points3D[i], cam_from_world, camera);
+    if (expected_squared_error == std::numeric_limits<double>::max()) {
+      EXPECT_EQ(squared_errors[i], expected_squared_error);
+    } else {
+      EXPECT_NEAR(squared_errors[i],
+                  expected_squared_error,
+                  1e-6 * (1 + expected_squared_error));
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    CalculateSquaredReprojectionErrors,
+    ParameterizedCalculateSquaredReprojectionErrorsTests,
+    ::testing::Values(SimplePinholeCameraModel::model_id,
+                      PinholeCameraModel::model_id,
+                      SimpleRadialCameraModel::model_id,
+                      OpenCVCameraModel::model_id,
+                      OpenCVFisheyeCameraModel::model_id,
+                      FullOpenCVCameraModel::model_id,
+                      FOVCameraModel::model_id,
+                      ThinPrismFisheyeCameraModel::model_id));
+
 TEST(CalculateAngularReprojectionError, Nominal) {
   const Rigid3d cam_from_world(Eigen::Quaterniond::Identity(),
                                Eigen::Vector3d::Zero());
@@ -38,6 +38,7 @@
 #include "colmap/sensor/bitmap.h"
 #include "colmap/util/file.h"
 #include "colmap/util/ply.h"
+#include "colmap/util/threading.h"
 
 namespace colmap {
 
@@ -691,21 +692,186 @@ double Reconstruction::ComputeMeanReprojectionError() const {
   }
 }
 
+std::vector<double> Reconstruction::ComputeSquaredReprojectionErrors(
+    const std::vector<point3D_t>& point3D_ids, const int num_threads) const {
+  size_t num_observations = 0;
+  std::unordered_set<image_t> image_ids;
+  for (const point3D_t point3D_id : point3D_ids) {
+    const struct Point3D& point3D = Point3D(point3D_id);
+    num_observations += point3D.track.Length();
+    for (const auto& track_el : point3D.track.Elements()) {
+      image_ids.insert(track_el.image_id);
+    }
+  }
+
+  // The errors are written directly into the output, so that no copy of the
+  // observations is made.
+  std::vector<double> squared_errors(num_observations);
+  if (num_observations == 0) {
+    return squared_errors;
+  }
+
+  // Spawning threads only pays off for larger problems.
+  constexpr size_t kMinNumObservationsForThreading = 50000;
+  const int num_eff_threads =
+      num_observations >= kMinNumObservationsForThreading
+          ? GetEffectiveNumThreads(num_threads)
+          : 1;
+
+  // Evaluating the observations image by image visits all 2D points of the
+  // involved images. This only pays off if most of them observe one of the
+  // given points, e.g., when updating the errors of all points.
+  size_t num_image_observations = 0;
+  for (const image_t image_id : image_ids) {
+    num_image_observations += Image(image_id).NumPoints3D();
+  }
+
+  if (num_image_observations > 2 * num_observations) {
+    // Evaluate the observations point by point, each thread processing a
+    // contiguous range of points with a known output offset.
+    const size_t num_ranges =
+        std::min(static_cast<size_t>(num_eff_threads), point3D_ids.size());
+    std::vector<size_t> range_begins(num_ranges + 1);
+    std::vector<size_t> range_offsets(num_ranges + 1);
+    size_t offset = 0;
+    for (size_t range_idx = 0, point_idx = 0; range_idx <= num_ranges;
+         ++range_idx) {
+      const size_t range_begin = range_idx * point3D_ids.size() / num_ranges;
+      for (; point_idx < range_begin; ++point_idx) {
+        offset += Point3D(point3D_ids[point_idx]).track.Length();
+      }
+      range_begins[range_idx] = range_begin;
+      range_offsets[range_idx] = offset;
+    }
+
+    auto ComputePointErrors = [&](const size_t range_idx) {
+      size_t error_idx = range_offsets[range_idx];
+      for (size_t point_idx = range_begins[range_idx];
+           point_idx < range_begins[range_idx + 1];
+           ++point_idx) {
+        const struct Point3D& point3D = Point3D(point3D_ids[point_idx]);
+        for (const auto& track_el : point3D.track.Elements()) {
+          const class Image& image = Image(track_el.image_id);
+          squared_errors[error_idx++] = CalculateSquaredReprojectionError(
+              image.Point2D(track_el.point2D_idx).xy,
+              point3D.xyz,
+              image.CamFromWorld(),
+              *image.CameraPtr());
+        }
+      }
+    };
+
+    if (num_ranges > 1) {
+      ThreadPool thread_pool(num_ranges);
+      for (size_t range_idx = 0; range_idx < num_ranges; ++range_idx) {
+        thread_pool.AddTask(ComputePointErrors, range_idx);
+      }
+      thread_pool.Wait();
+    } else {
+      ComputePointErrors(0);
+    }
+
+    return squared_errors;
+  }
+
+  // Otherwise, evaluate the observations image by image with a single camera
+  // model dispatch per image, in fixed-size chunks of each image's points.
+  std::unordered_map<point3D_t, size_t> point3D_id_to_offset;
+  point3D_id_to_offset.reserve(point3D_ids.size());
+  size_t offset = 0;
+  for (const point3D_t point3D_id : point3D_ids) {
+    point3D_id_to_offset.emplace(point3D_id, offset);
+    offset += Point3D(point3D_id).track.Length();
+  }
+
+  auto ComputeImageErrors = [&](const image_t image_id) {
+    constexpr size_t kChunkSize = 256;
+    std::vector<Eigen::Vector2d> points2D(kChunkSize);
+    std::vector<Eigen::Vector3d> points3D(kChunkSize);
+    std::vector<size_t> error_idxs(kChunkSize);
+    std::vector<double> chunk_squared_errors(kChunkSize);
+    size_t chunk_size = 0;
+
+    const class Image& image = Image(image_id);
+    const struct Camera& camera = *image.CameraPtr();
+
+    auto ComputeChunkErrors = [&]() {
+      CalculateSquaredReprojectionErrors(
+          span<const Eigen::Vector2d>(points2D.data(), chunk_size),
+          span<const Eigen::Vector3d>(points3D.data(), chunk_size),
+          image.CamFromWorld(),
+          camera,
+          span<double>(chunk_squared_errors.data(), chunk_size));
+      for (size_t i = 0; i < chunk_size; ++i) {
+        squared_errors[error_idxs[i]] = chunk_squared_errors[i];
+      }
+      chunk_size = 0;
+    };
+
+    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+         ++point2D_idx) {
+      const struct Point2D& point2D = image.Point2D(point2D_idx);
+      if (!point2D.HasPoint3D()) {
+        continue;
+      }
+      const auto offset_it = point3D_id_to_offset.find(point2D.point3D_id);
+      if (offset_it == point3D_id_to_offset.end()) {
+        continue;
+      }
+      const struct Point3D& point3D = Point3D(point2D.point3D_id);
+      size_t track_idx = 0;
+      while (point3D.track.Element(track_idx).image_id != image_id ||
+             point3D.track.Element(track_idx).point2D_idx != point2D_idx) {
+        ++track_idx;
+      }
+      points2D[chunk_size] = point2D.xy;
+      points3D[chunk_size] = point3D.xyz;
+      error_idxs[chunk_size] = offset_it->second + track_idx;
+      if (++chunk_size == kChunkSize) {
+        ComputeChunkErrors();
+      }
+    }
+
+    if (chunk_size > 0) {
+      ComputeChunkErrors();
+    }
+  };
+
+  if (num_eff_threads > 1 && image_ids.size() > 1) {
+    ThreadPool thread_pool(
+        std::min(num_eff_threads, static_cast<int>(image_ids.size())));
+    for (const image_t image_id : image_ids) {
+      thread_pool.AddTask(ComputeImageErrors, image_id);
+    }
+    thread_pool.Wait();
+  } else {
+    for (const image_t image_id : image_ids) {
+      ComputeImageErrors(image_id);
+    }
+  }
+
+  return squared_errors;
+}
+
 void Reconstruction::UpdatePoint3DErrors() {
-  for (auto& point3D : points3D_) {
-    if (point3D.second.track.Length() == 0) {
-      point3D.second.error = 0;
+  std::vector<point3D_t> point3D_ids;
+  point3D_ids.reserve(points3D_.size());
+  for (const auto& point3D : points3D_) {
+    point3D_ids.push_back(point3D.first);
+  }
+  const std::vector<double> squared_errors =
+      ComputeSquaredReprojectionErrors(point3D_ids);
+  size_t error_idx = 0;
+  for (const point3D_t point3D_id : point3D_ids) {
+    struct Point3D& point3D = Point3D(point3D_id);
+    point3D.error = 0;
+    if (point3D.track.Length() == 0) {
       continue;
     }
-    point3D.second.error = 0;
-    for (const auto& track_el : point3D.second.track.Elements()) {
-      const auto& image = Image(track_el.image_id);
-      const auto& point2D = image.Point2D(track_el.point2D_idx);
-      const auto& camera = *image.CameraPtr();
-      point3D.second.error += std::sqrt(CalculateSquaredReprojectionError(
-          point2D.xy, point3D.second.xyz, image.CamFromWorld(), camera));
+    for (size_t i = 0; i < point3D.track.Length(); ++i) {
+      point3D.error += std::sqrt(squared_errors[error_idx++]);
     }
-    point3D.second.error /= point3D.second.track.Length();
+    point3D.error /= point3D.track.Length();
   }
 }
 
@@ -804,14 +970,18 @@ std::vector<PlyPoint> Reconstruction::ConvertToPLY() const {
 void Reconstruction::ImportPLY(const std::string& path) {
   points3D_.clear();
 
-  const auto ply_points = ReadPly(path);
+  PlyPointsReader reader(path);
 
-  points3D_.reserve(ply_points.size());
+  points3D_.reserve(reader.NumPoints());
 
-  for (const auto& ply_point : ply_points) {
-    AddPoint3D(Eigen::Vector3d(ply_point.x, ply_point.y, ply_point.z),
-               Track(),
-               Eigen::Vector3ub(ply_point.r, ply_point.g, ply_point.b));
+  const size_t kChunkSize = 1 << 20;
+  std::vector<PlyPoint> ply_points;
+  while (reader.Read(kChunkSize, &ply_points)) {
+    for (const auto& ply_point : ply_points) {
+      AddPoint3D(Eigen::Vector3d(ply_point.x, ply_point.y, ply_point.z),
+                 Track(),
+                 Eigen::Vector3ub(ply_point.r, ply_point.g, ply_point.b));
+    }
   }
 }
 
@@ -220,6 +220,15 @@ class Reconstruction {
   double ComputeMeanObservationsPerRegImage() const;
   double ComputeMeanReprojectionError() const;
 
+  // Compute the squared reprojection errors of all observations of the given
+  // unique 3D points. The errors are returned concatenated in the order of the
+  // given points and their track elements. If most observations of the
+  // involved images are requested, they are evaluated image by image with the
+  // batched projection kernel, otherwise point by point. Both run in parallel
+  // for large inputs. Observations behind the camera yield DBL_MAX.
+  std::vector<double> ComputeSquaredReprojectionErrors(
+      const std::vector<point3D_t>& point3D_ids, int num_threads = -1) const;
+
   // Updates mean reprojection errors for all 3D points.
   void UpdatePoint3DErrors();
 
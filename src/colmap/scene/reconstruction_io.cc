@@ -33,6 +33,7 @@
 #include "colmap/util/ply.h"
 #include "colmap/util/types.h"
 
+#include <algorithm>
 #include <fstream>
 
 namespace colmap {
@@ -405,11 +406,31 @@ bool ExportBundler(const Reconstruction& reconstruction,
 }
 
 void ExportPLY(const Reconstruction& reconstruction, const std::string& path) {
-  const auto ply_points = reconstruction.ConvertToPLY();
-
+  const bool kBinary = true;
   const bool kWriteNormal = false;
   const bool kWriteRGB = true;
-  WriteBinaryPlyPoints(path, ply_points, kWriteNormal, kWriteRGB);
+  PlyPointsWriter writer(path, kBinary, kWriteNormal, kWriteRGB);
+
+  // Write the points in chunks to avoid a copy of the entire point cloud.
+  const size_t kChunkSize = 1 << 20;
+  std::vector<PlyPoint> ply_points;
+  ply_points.reserve(std::min(kChunkSize, reconstruction.NumPoints3D()));
+  for (const auto& point3D : reconstruction.Points3D()) {
+    PlyPoint ply_point;
+    ply_point.x = point3D.second.xyz(0);
+    ply_point.y = point3D.second.xyz(1);
+    ply_point.z = point3D.second.xyz(2);
+    ply_point.r = point3D.second.color(0);
+    ply_point.g = point3D.second.color(1);
+    ply_point.b = point3D.second.color(2);
+    ply_points.push_back(ply_point);
+    if (ply_points.size() == kChunkSize) {
+      writer.Write(ply_points);
+      ply_points.clear();
+    }
+  }
+  writer.Write(ply_points);
+  writer.Close();
 }
 
 void ExportVRML(const Reconstruction& reconstruction,
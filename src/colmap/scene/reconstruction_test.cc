@@ -31,6 +31,7 @@
 
 #include "colmap/geometry/pose.h"
 #include "colmap/geometry/sim3.h"
+#include "colmap/scene/projection.h"
 #include "colmap/scene/reconstruction_io.h"
 #include "colmap/scene/synthetic.h"
 #include "colmap/sensor/models.h"
@@ -760,6 +761,49 @@ TEST(Reconstruction, UpdatePoint3DErrors) {
   EXPECT_EQ(reconstruction.Point3D(point3D_id).error, 1);
 }
 
+TEST(Reconstruction, ComputeSquaredReprojectionErrors) {
+  Reconstruction reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_frames_per_rig = 10;
+  synthetic_dataset_options.num_points3D = 100;
+  synthetic_dataset_options.point2D_stddev = 1;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  auto ExpectErrors = [&reconstruction](
+                          const std::vector<point3D_t>& point3D_ids) {
+    const std::vector<double> squared_errors =
+        reconstruction.ComputeSquaredReprojectionErrors(point3D_ids);
+    size_t error_idx = 0;
+    for (const point3D_t point3D_id : point3D_ids) {
+      const Point3D& point3D = reconstruction.Point3D(point3D_id);
+      for (const auto& track_el : point3D.track.Elements()) {
+        const Image& image = reconstruction.Image(track_el.image_id);
+        ASSERT_LT(error_idx, squared_errors.size());
+        EXPECT_NEAR(squared_errors[error_idx++],
+                    CalculateSquaredReprojectionError(
+                        image.Point2D(track_el.point2D_idx).xy,
+                        point3D.xyz,
+                        image.CamFromWorld(),
+                        *image.CameraPtr()),
+                    1e-9);
+      }
+    }
+    EXPECT_EQ(error_idx, squared_errors.size());
+  };
+
+  // Evaluated image by image.
+  std::vector<point3D_t> point3D_ids;
+  for (const auto& [point3D_id, _] : reconstruction.Points3D()) {
+    point3D_ids.push_back(point3D_id);
+  }
+  ExpectErrors(point3D_ids);
+
+  // Evaluated point by point.
+  point3D_ids.resize(5);
+  ExpectErrors(point3D_ids);
+  ExpectErrors({});
+}
+
 TEST(Reconstruction, DeleteAllPoints2DAndPoints3D) {
   Reconstruction reconstruction;
   SyntheticDatasetOptions synthetic_dataset_options;
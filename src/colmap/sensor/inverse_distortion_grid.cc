@@ -0,0 +1,154 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "colmap/sensor/inverse_distortion_grid.h"
+
+#include "colmap/util/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include <Eigen/Geometry>
+
+namespace colmap {
+
+bool InverseDistortionGridOptions::Check() const {
+  CHECK_OPTION_GT(node_spacing, 0);
+  CHECK_OPTION_GT(max_error, 0);
+  CHECK_OPTION_GE(num_verification_intervals, 2);
+  return true;
+}
+
+InverseDistortionGrid::InverseDistortionGrid(
+    const CameraModelId model_id,
+    std::vector<double> params,
+    const size_t width,
+    const size_t height,
+    const InverseDistortionGridOptions& options)
+    : model_id_(model_id),
+      params_(std::move(params)),
+      node_spacing_(options.node_spacing),
+      inv_node_spacing_(1.0 / options.node_spacing),
+      num_cols_(std::max<size_t>(
+          1, static_cast<size_t>(std::ceil(width / options.node_spacing)))),
+      num_rows_(std::max<size_t>(
+          1, static_cast<size_t>(std::ceil(height / options.node_spacing)))),
+      max_squared_error_(options.max_error * options.max_error),
+      max_error_(0) {
+  THROW_CHECK(options.Check());
+  THROW_CHECK(CameraModelVerifyParams(model_id_, params_));
+
+  // Compute the exact inverse at the nodes, where node (i, j) is located at
+  // pixel ((i - 1) * node_spacing, (j - 1) * node_spacing).
+  const size_t num_node_cols = num_cols_ + 3;
+  const size_t num_node_rows = num_rows_ + 3;
+  nodes_.resize(num_node_cols * num_node_rows);
+  std::vector<unsigned char> valid_nodes(nodes_.size(), 0);
+  for (size_t row = 0; row < num_node_rows; ++row) {
+    for (size_t col = 0; col < num_node_cols; ++col) {
+      const Eigen::Vector2d node_xy(
+          (static_cast<double>(col) - 1.0) * node_spacing_,
+          (static_cast<double>(row) - 1.0) * node_spacing_);
+      const size_t idx = row * num_node_cols + col;
+      const std::optional<Eigen::Vector2d> node_uv =
+          CameraModelCamFromImg(model_id_, params_, node_xy);
+      if (node_uv && node_uv->allFinite()) {
+        nodes_[idx] = *node_uv;
+        valid_nodes[idx] = 1;
+      } else {
+        nodes_[idx].setZero();
+      }
+    }
+  }
+
+  // Verify the interpolation on a lattice of samples in each cell, including
+  // its edges, by reprojecting the interpolated points into the image. The
+  // interpolation is exact at the nodes, which are therefore skipped.
+  const int num_intervals = options.num_verification_intervals;
+  std::vector<std::pair<double, double>> sample_offsets;
+  for (int j = 0; j <= num_intervals; ++j) {
+    for (int i = 0; i <= num_intervals; ++i) {
+      if ((i == 0 || i == num_intervals) && (j == 0 || j == num_intervals)) {
+        continue;
+      }
+      sample_offsets.emplace_back(static_cast<double>(i) / num_intervals,
+                                  static_cast<double>(j) / num_intervals);
+    }
+  }
+  valid_cells_.assign(num_cols_ * num_rows_, 1);
+  double max_squared_valid_error = 0;
+  for (size_t row = 0; row < num_rows_; ++row) {
+    for (size_t col = 0; col < num_cols_; ++col) {
+      unsigned char& valid_cell = valid_cells_[row * num_cols_ + col];
+      for (size_t j = 0; j < 4 && valid_cell; ++j) {
+        for (size_t i = 0; i < 4 && valid_cell; ++i) {
+          valid_cell = valid_nodes[(row + j) * num_node_cols + col + i];
+        }
+      }
+      if (!valid_cell) {
+        continue;
+      }
+
+      double max_squared_cell_error = 0;
+      for (const auto& [dx, dy] : sample_offsets) {
+        const Eigen::Vector2d xy((col + dx) * node_spacing_,
+                                 (row + dy) * node_spacing_);
+        Eigen::Vector2d uv;
+        InterpolateCell(col, row, dx, dy, &uv.x(), &uv.y());
+        const std::optional<Eigen::Vector2d> proj_xy =
+            CameraModelImgFromCam(model_id_, params_, uv.homogeneous());
+        if (!proj_xy) {
+          max_squared_cell_error = std::numeric_limits<double>::infinity();
+          break;
+        }
+        max_squared_cell_error =
+            std::max(max_squared_cell_error, (*proj_xy - xy).squaredNorm());
+      }
+
+      if (max_squared_cell_error > max_squared_error_) {
+        valid_cell = 0;
+      } else {
+        max_squared_valid_error =
+            std::max(max_squared_valid_error, max_squared_cell_error);
+      }
+    }
+  }
+
+  max_error_ = std::sqrt(max_squared_valid_error);
+}
+
+size_t InverseDistortionGrid::NumValidCells() const {
+  return std::count(valid_cells_.begin(), valid_cells_.end(), 1);
+}
+
+}  // namespace colmap
@@ -0,0 +1,199 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include "colmap/sensor/models.h"
+
+#include <optional>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace colmap {
+
+struct InverseDistortionGridOptions {
+  // Spacing of the grid nodes in pixels.
+  double node_spacing = 8.0;
+
+  // Maximum reprojection error in pixels of the interpolated points. Every
+  // interpolated point is reprojected into the image and points exceeding
+  // this error fall back to the iterative solve, so that the error is bounded
+  // for all points.
+  double max_error = 1e-4;
+
+  // Number of verification intervals along each cell edge, i.e., the error is
+  // verified on a lattice of (n + 1) x (n + 1) samples per cell except for
+  // its corners, where the interpolation is exact. Cells exceeding the
+  // maximum error at these samples are disabled when building the grid, which
+  // avoids interpolating and reprojecting points that likely fail the check.
+  // Must be at least 2.
+  int num_verification_intervals = 4;
+
+  bool Check() const;
+};
+
+// Cached inverse of the camera distortion on a regular grid over the image.
+//
+// Camera models with distortion lift image points to the camera frame with an
+// iterative solve, while the inverse is a smooth function of the pixel
+// location. The grid stores the exact inverse at its nodes and evaluates it
+// anywhere else with bicubic (Catmull-Rom) interpolation. Each interpolated
+// point is verified by reprojecting it into the image with the closed-form
+// projection of the model, which is much cheaper than the iterative solve.
+// Points exceeding the maximum error are rejected, so that the caller falls
+// back to the iterative solve for them, for points outside the image, and for
+// points in disabled cells. Cells are disabled when building the grid, if
+// they touch nodes, for which the inverse does not exist, or if they exceed
+// the maximum error on a regular lattice of samples.
+class InverseDistortionGrid {
+ public:
+  InverseDistortionGrid(CameraModelId model_id,
+                        std::vector<double> params,
+                        size_t width,
+                        size_t height,
+                        const InverseDistortionGridOptions& options =
+                            InverseDistortionGridOptions());
+
+  // Whether the grid was built for the given camera model and parameters.
+  inline bool Matches(CameraModelId model_id,
+                      const std::vector<double>& params) const;
+
+  // Transform image to camera coordinates by interpolating the grid. Returns
+  // false if the point lies outside the grid or in a disabled cell, or if the
+  // reprojection error of the interpolated point exceeds the maximum error.
+  inline bool CamFromImg(double x, double y, double* u, double* v) const;
+
+  // Number of grid cells and the number of enabled cells.
+  inline size_t NumCells() const;
+  size_t NumValidCells() const;
+
+  // Maximum reprojection error in pixels over the verification samples of all
+  // enabled cells. The error of all points returned by CamFromImg is bounded
+  // by the maximum error of the options instead.
+  inline double MaxError() const;
+
+ private:
+  inline const Eigen::Vector2d& Node(size_t col, size_t row) const;
+
+  // Interpolate the grid at the relative location (tx, ty) in [0, 1]^2 of the
+  // given cell.
+  inline void InterpolateCell(
+      size_t col, size_t row, double tx, double ty, double* u, double* v) const;
+
+  CameraModelId model_id_;
+  std::vector<double> params_;
+  double node_spacing_;
+  double inv_node_spacing_;
+  size_t num_cols_;
+  size_t num_rows_;
+  // Nodes of the grid with one extra ring of nodes around the cells, as
+  // required by the bicubic interpolation.
+  std::vector<Eigen::Vector2d> nodes_;
+  std::vector<unsigned char> valid_cells_;
+  double max_squared_error_;
+  double max_error_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+bool InverseDistortionGrid::Matches(const CameraModelId model_id,
+                                    const std::vector<double>& params) const {
+  return model_id == model_id_ && params == params_;
+}
+
+bool InverseDistortionGrid::CamFromImg(const double x,
+                                       const double y,
+                                       double* u,
+                                       double* v) const {
+  const double fx = x * inv_node_spacing_;
+  const double fy = y * inv_node_spacing_;
+  // Also rejects NaN coordinates.
+  if (!(fx >= 0 && fy >= 0 && fx < num_cols_ && fy < num_rows_)) {
+    return false;
+  }
+
+  const size_t col = static_cast<size_t>(fx);
+  const size_t row = static_cast<size_t>(fy);
+  if (!valid_cells_[row * num_cols_ + col]) {
+    return false;
+  }
+
+  InterpolateCell(col, row, fx - col, fy - row, u, v);
+
+  const std::optional<Eigen::Vector2d> proj_xy =
+      CameraModelImgFromCam(model_id_, params_, Eigen::Vector3d(*u, *v, 1));
+  return proj_xy &&
+         (*proj_xy - Eigen::Vector2d(x, y)).squaredNorm() <= max_squared_error_;
+}
+
+size_t InverseDistortionGrid::NumCells() const { return valid_cells_.size(); }
+
+double InverseDistortionGrid::MaxError() const { return max_error_; }
+
+const Eigen::Vector2d& InverseDistortionGrid::Node(const size_t col,
+                                                   const size_t row) const {
+  return nodes_[row * (num_cols_ + 3) + col];
+}
+
+void InverseDistortionGrid::InterpolateCell(const size_t col,
+                                            const size_t row,
+                                            const double tx,
+                                            const double ty,
+                                            double* u,
+                                            double* v) const {
+  // Catmull-Rom weights of the four nodes around the point in each direction.
+  const auto CubicWeights = [](const double t, double w[4]) {
+    w[0] = ((-0.5 * t + 1.0) * t - 0.5) * t;
+    w[1] = (1.5 * t - 2.5) * t * t + 1.0;
+    w[2] = ((-1.5 * t + 2.0) * t + 0.5) * t;
+    w[3] = (0.5 * t - 0.5) * t * t;
+  };
+  double wx[4];
+  double wy[4];
+  CubicWeights(tx, wx);
+  CubicWeights(ty, wy);
+
+  Eigen::Vector2d uv = Eigen::Vector2d::Zero();
+  for (int j = 0; j < 4; ++j) {
+    Eigen::Vector2d uv_row = Eigen::Vector2d::Zero();
+    for (int i = 0; i < 4; ++i) {
+      uv_row += wx[i] * Node(col + i, row + j);
+    }
+    uv += wy[j] * uv_row;
+  }
+
+  *u = uv.x();
+  *v = uv.y();
+}
+
+}  // namespace colmap
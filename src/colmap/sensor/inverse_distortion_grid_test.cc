@@ -0,0 +1,172 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "colmap/sensor/inverse_distortion_grid.h"
+
+#include "colmap/sensor/models.h"
+
+#include <limits>
+#include <optional>
+#include <random>
+
+#include <Eigen/Geometry>
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+void TestInverseDistortionGrid(const CameraModelId model_id,
+                               const std::vector<double>& params,
+                               const size_t width,
+                               const size_t height,
+                               const InverseDistortionGridOptions& options =
+                                   InverseDistortionGridOptions()) {
+  const InverseDistortionGrid grid(model_id, params, width, height, options);
+  EXPECT_TRUE(grid.Matches(model_id, params));
+  EXPECT_GT(grid.NumCells(), 0);
+  EXPECT_GT(grid.NumValidCells(), 0);
+  EXPECT_LE(grid.NumValidCells(), grid.NumCells());
+  EXPECT_LE(grid.MaxError(), options.max_error);
+
+  size_t num_interpolated = 0;
+  for (double y = 0.25; y < height; y += 7.3) {
+    for (double x = 0.25; x < width; x += 7.3) {
+      Eigen::Vector2d uv;
+      if (!grid.CamFromImg(x, y, &uv.x(), &uv.y())) {
+        continue;
+      }
+      ++num_interpolated;
+      const std::optional<Eigen::Vector2d> proj_xy =
+          CameraModelImgFromCam(model_id, params, uv.homogeneous());
+      ASSERT_TRUE(proj_xy.has_value());
+      EXPECT_LE((*proj_xy - Eigen::Vector2d(x, y)).norm(), options.max_error);
+    }
+  }
+  EXPECT_GT(num_interpolated, 0);
+}
+
+TEST(InverseDistortionGrid, OpenCV) {
+  TestInverseDistortionGrid(
+      CameraModelId::kOpenCV,
+      {500, 510, 320, 240, 0.05, -0.02, 0.001, -0.002},
+      640,
+      480);
+}
+
+TEST(InverseDistortionGrid, OpenCVFisheye) {
+  // The inverse of the fisheye model is less smooth and needs a finer grid.
+  InverseDistortionGridOptions options;
+  options.node_spacing = 4;
+  TestInverseDistortionGrid(CameraModelId::kOpenCVFisheye,
+                            {300, 300, 320, 240, 0.05, 0.01, -0.01, 0.001},
+                            640,
+                            480,
+                            options);
+}
+
+TEST(InverseDistortionGrid, FullOpenCV) {
+  TestInverseDistortionGrid(
+      CameraModelId::kFullOpenCV,
+      {500, 510, 320, 240, 0.05, -0.02, 0.001, -0.002, 0.001, 0, 0, 0},
+      640,
+      480);
+}
+
+TEST(InverseDistortionGrid, Matches) {
+  std::vector<double> params = {500, 320, 240, 0.1};
+  const InverseDistortionGrid grid(
+      CameraModelId::kSimpleRadial, params, 640, 480);
+  EXPECT_TRUE(grid.Matches(CameraModelId::kSimpleRadial, params));
+  EXPECT_FALSE(grid.Matches(CameraModelId::kRadial, params));
+  params[3] = 0.2;
+  EXPECT_FALSE(grid.Matches(CameraModelId::kSimpleRadial, params));
+}
+
+TEST(InverseDistortionGrid, OutOfRange) {
+  const InverseDistortionGrid grid(
+      CameraModelId::kSimpleRadial, {500, 320, 240, 0.1}, 640, 480);
+  double u;
+  double v;
+  EXPECT_TRUE(grid.CamFromImg(320, 240, &u, &v));
+  EXPECT_FALSE(grid.CamFromImg(-1, 240, &u, &v));
+  EXPECT_FALSE(grid.CamFromImg(320, -1, &u, &v));
+  EXPECT_FALSE(grid.CamFromImg(645, 240, &u, &v));
+  EXPECT_FALSE(grid.CamFromImg(320, 485, &u, &v));
+  EXPECT_FALSE(grid.CamFromImg(std::numeric_limits<double>::quiet_NaN(),
+                               240,
+                               &u,
+                               &v));
+}
+
+TEST(InverseDistortionGrid, DisablesCellsExceedingMaxError) {
+  InverseDistortionGridOptions options;
+  options.node_spacing = 64;
+  options.max_error = 1e-12;
+  const InverseDistortionGrid grid(
+      CameraModelId::kSimpleRadial, {500, 320, 240, 0.3}, 640, 480, options);
+  EXPECT_LT(grid.NumValidCells(), grid.NumCells());
+  EXPECT_LE(grid.MaxError(), options.max_error);
+}
+
+TEST(InverseDistortionGrid, BoundsErrorAtRandomPoints) {
+  // A coarse grid and a strong distortion, such that the error between the
+  // verification samples exceeds the maximum error for some points.
+  InverseDistortionGridOptions options;
+  options.node_spacing = 32;
+  options.max_error = 1e-3;
+  options.num_verification_intervals = 2;
+  const CameraModelId model_id = CameraModelId::kOpenCV;
+  const std::vector<double> params = {
+      500, 510, 320, 240, 0.2, -0.1, 0.005, -0.005};
+  const InverseDistortionGrid grid(model_id, params, 640, 480, options);
+  ASSERT_GT(grid.NumValidCells(), 0);
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> x_distribution(0, 640);
+  std::uniform_real_distribution<double> y_distribution(0, 480);
+  size_t num_interpolated = 0;
+  for (int i = 0; i < 10000; ++i) {
+    const Eigen::Vector2d xy(x_distribution(generator),
+                             y_distribution(generator));
+    Eigen::Vector2d uv;
+    if (!grid.CamFromImg(xy.x(), xy.y(), &uv.x(), &uv.y())) {
+      continue;
+    }
+    ++num_interpolated;
+    const std::optional<Eigen::Vector2d> proj_xy =
+        CameraModelImgFromCam(model_id, params, uv.homogeneous());
+    ASSERT_TRUE(proj_xy.has_value());
+    EXPECT_LE((*proj_xy - xy).norm(), options.max_error);
+  }
+  EXPECT_GT(num_interpolated, 0);
+}
+
+}  // namespace
+}  // namespace colmap
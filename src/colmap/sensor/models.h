@@ -32,8 +32,10 @@
 #include "colmap/math/math.h"
 #include "colmap/util/eigen_alignment.h"
 #include "colmap/util/enum_utils.h"
+#include "colmap/util/logging.h"
 #include "colmap/util/types.h"
 
+#include <algorithm>
 #include <array>
 #include <cfloat>
 #include <optional>
@@ -216,6 +218,17 @@ struct BaseCameraModel {
   static inline bool IterativeUndistortion(const double* params,
                                            double* u,
                                            double* v);
+
+  // Batched versions of `ImgFromCam` and `CamFromImg`. The loops are
+  // specialized for the compile-time known model, so that the compiler can
+  // inline and vectorize them. Points for which the transformation fails are
+  // set to NaN.
+  static inline void ImgFromCamBatch(const double* params,
+                                     span<const Eigen::Vector3d> cam_points,
+                                     span<Eigen::Vector2d> image_points);
+  static inline void CamFromImgBatch(const double* params,
+                                     span<const Eigen::Vector2d> image_points,
+                                     span<Eigen::Vector2d> cam_points);
 };
 
 // Base model for Fisheye camera models
@@ -554,6 +567,23 @@ inline std::optional<Eigen::Vector2d> CameraModelCamFromImg(
     const std::vector<double>& params,
     const Eigen::Vector2d& xy);
 
+// Batched versions of `CameraModelImgFromCam` and `CameraModelCamFromImg`,
+// which dispatch the camera model once for all points. Points for which the
+// transformation fails are set to NaN.
+//
+// @param model_id      Unique identifier of camera model.
+// @param params        Array of camera parameters.
+// @param cam_points    Coordinates in camera system as (u, v, w).
+// @param image_points  Image coordinates in pixels.
+inline void CameraModelImgFromCamBatch(CameraModelId model_id,
+                                       const std::vector<double>& params,
+                                       span<const Eigen::Vector3d> cam_points,
+                                       span<Eigen::Vector2d> image_points);
+inline void CameraModelCamFromImgBatch(CameraModelId model_id,
+                                       const std::vector<double>& params,
+                                       span<const Eigen::Vector2d> image_points,
+                                       span<Eigen::Vector2d> cam_points);
+
 // Convert pixel threshold in image plane to camera space by dividing
 // the threshold through the mean focal length.
 //
@@ -711,6 +741,41 @@ bool BaseCameraModel<CameraModel>::IterativeUndistortion(const double* params,
   return false;
 }
 
+template <typename CameraModel>
+void BaseCameraModel<CameraModel>::ImgFromCamBatch(
+    const double* params,
+    span<const Eigen::Vector3d> cam_points,
+    span<Eigen::Vector2d> image_points) {
+  THROW_CHECK_EQ(cam_points.size(), image_points.size());
+  const size_t num_points = cam_points.size();
+  for (size_t i = 0; i < num_points; ++i) {
+    const Eigen::Vector3d& uvw = cam_points[i];
+    double x;
+    double y;
+    const bool valid =
+        CameraModel::ImgFromCam(params, uvw.x(), uvw.y(), uvw.z(), &x, &y);
+    image_points[i].x() = valid ? x : std::numeric_limits<double>::quiet_NaN();
+    image_points[i].y() = valid ? y : std::numeric_limits<double>::quiet_NaN();
+  }
+}
+
+template <typename CameraModel>
+void BaseCameraModel<CameraModel>::CamFromImgBatch(
+    const double* params,
+    span<const Eigen::Vector2d> image_points,
+    span<Eigen::Vector2d> cam_points) {
+  THROW_CHECK_EQ(image_points.size(), cam_points.size());
+  const size_t num_points = image_points.size();
+  for (size_t i = 0; i < num_points; ++i) {
+    const Eigen::Vector2d& xy = image_points[i];
+    double u;
+    double v;
+    const bool valid = CameraModel::CamFromImg(params, xy.x(), xy.y(), &u, &v);
+    cam_points[i].x() = valid ? u : std::numeric_limits<double>::quiet_NaN();
+    cam_points[i].y() = valid ? v : std::numeric_limits<double>::quiet_NaN();
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // SimplePinholeCameraModel
 
@@ -1863,6 +1928,38 @@ std::optional<Eigen::Vector2d> CameraModelImgFromCam(
   return std::nullopt;
 }
 
+void CameraModelImgFromCamBatch(const CameraModelId model_id,
+                                const std::vector<double>& params,
+                                span<const Eigen::Vector3d> cam_points,
+                                span<Eigen::Vector2d> image_points) {
+  switch (model_id) {
+#define CAMERA_MODEL_CASE(CameraModel)                                      \
+  case CameraModel::model_id:                                               \
+    CameraModel::ImgFromCamBatch(params.data(), cam_points, image_points); \
+    break;
+
+    CAMERA_MODEL_SWITCH_CASES
+
+#undef CAMERA_MODEL_CASE
+  }
+}
+
+void CameraModelCamFromImgBatch(const CameraModelId model_id,
+                                const std::vector<double>& params,
+                                span<const Eigen::Vector2d> image_points,
+                                span<Eigen::Vector2d> cam_points) {
+  switch (model_id) {
+#define CAMERA_MODEL_CASE(CameraModel)                                      \
+  case CameraModel::model_id:                                               \
+    CameraModel::CamFromImgBatch(params.data(), image_points, cam_points); \
+    break;
+
+    CAMERA_MODEL_SWITCH_CASES
+
+#undef CAMERA_MODEL_CASE
+  }
+}
+
 std::optional<Eigen::Vector2d> CameraModelCamFromImg(
     const CameraModelId model_id,
     const std::vector<double>& params,
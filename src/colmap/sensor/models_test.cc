@@ -29,6 +29,9 @@
 
 #include "colmap/sensor/models.h"
 
+#include "colmap/util/eigen_matchers.h"
+
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 namespace colmap {
@@ -103,6 +106,52 @@ void TestCamFromImgToImg(const std::vector<double>& params,
   }
 }
 
+template <typename CameraModel>
+void TestBatchMatchesScalar(const std::vector<double>& params) {
+  std::vector<Eigen::Vector3d> cam_points;
+  // NOLINTNEXTLINE(clang-analyzer-security.FloatLoopCounter)
+  for (double u = -0.5; u <= 0.5; u += 0.05) {
+    // NOLINTNEXTLINE(clang-analyzer-security.FloatLoopCounter)
+    for (double v = -0.5; v <= 0.5; v += 0.05) {
+      for (const double w : {-1.0, 0.0, 0.5, 1.0, 2.0}) {
+        cam_points.emplace_back(u, v, w);
+      }
+    }
+  }
+
+  std::vector<Eigen::Vector2d> image_points(cam_points.size());
+  CameraModelImgFromCamBatch(
+      CameraModel::model_id,
+      params,
+      span<const Eigen::Vector3d>(cam_points.data(), cam_points.size()),
+      span<Eigen::Vector2d>(image_points.data(), image_points.size()));
+  for (size_t i = 0; i < cam_points.size(); ++i) {
+    const std::optional<Eigen::Vector2d> image_point =
+        CameraModelImgFromCam(CameraModel::model_id, params, cam_points[i]);
+    if (image_point) {
+      EXPECT_THAT(image_points[i], EigenMatrixNear(*image_point, 1e-9));
+    } else {
+      EXPECT_TRUE(image_points[i].array().isNaN().all());
+    }
+  }
+
+  std::vector<Eigen::Vector2d> cam_points2D(image_points.size());
+  CameraModelCamFromImgBatch(
+      CameraModel::model_id,
+      params,
+      span<const Eigen::Vector2d>(image_points.data(), image_points.size()),
+      span<Eigen::Vector2d>(cam_points2D.data(), cam_points2D.size()));
+  for (size_t i = 0; i < image_points.size(); ++i) {
+    const std::optional<Eigen::Vector2d> cam_point2D =
+        CameraModelCamFromImg(CameraModel::model_id, params, image_points[i]);
+    if (cam_point2D && cam_point2D->allFinite()) {
+      EXPECT_THAT(cam_points2D[i], EigenMatrixNear(*cam_point2D, 1e-9));
+    } else {
+      EXPECT_TRUE(cam_points2D[i].array().isNaN().all());
+    }
+  }
+}
+
 template <typename CameraModel>
 void TestModel(const std::vector<double>& params) {
   EXPECT_TRUE(CameraModelVerifyParams(CameraModel::model_id, params));
@@ -186,6 +235,8 @@ void TestModel(const std::vector<double>& params) {
   const auto pp_idxs = CameraModel::principal_point_idxs;
   TestCamFromImgToImg<CameraModel>(
       params, params[pp_idxs.at(0)], params[pp_idxs.at(1)]);
+
+  TestBatchMatchesScalar<CameraModel>(params);
 }
 
 TEST(SimplePinhole, Nominal) {
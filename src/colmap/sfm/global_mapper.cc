@@ -0,0 +1,416 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/sfm/global_mapper.h"
+
+#include "colmap/estimators/two_view_geometry.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/string.h"
+#include "colmap/util/threading.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace colmap {
+namespace {
+
+bool IsValidTwoViewGeometry(const TwoViewGeometry& two_view_geometry) {
+  switch (two_view_geometry.config) {
+    case TwoViewGeometry::CALIBRATED:
+    case TwoViewGeometry::UNCALIBRATED:
+    case TwoViewGeometry::PLANAR:
+    case TwoViewGeometry::PANORAMIC:
+    case TwoViewGeometry::PLANAR_OR_PANORAMIC:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool HasRelativePose(const TwoViewGeometry& two_view_geometry) {
+  return two_view_geometry.cam2_from_cam1.translation.squaredNorm() > 0 ||
+         two_view_geometry.cam2_from_cam1.rotation.coeffs() !=
+             Eigen::Quaterniond::Identity().coeffs();
+}
+
+// Whether the relative pose constrains the translation direction, which is
+// not the case for pure rotations or ambiguous planar/panoramic geometry.
+bool HasRelativeTranslation(const TwoViewGeometry& two_view_geometry) {
+  return (two_view_geometry.config == TwoViewGeometry::CALIBRATED ||
+          two_view_geometry.config == TwoViewGeometry::UNCALIBRATED ||
+          two_view_geometry.config == TwoViewGeometry::PLANAR) &&
+         two_view_geometry.cam2_from_cam1.translation.squaredNorm() > 0;
+}
+
+std::optional<Rigid3d> MaybeCamFromRig(const Image& image) {
+  const Rig& rig = *image.FramePtr()->RigPtr();
+  const sensor_t sensor_id = image.DataId().sensor_id;
+  if (rig.IsRefSensor(sensor_id)) {
+    return Rigid3d();
+  }
+  return rig.MaybeSensorFromRig(sensor_id);
+}
+
+std::vector<Eigen::Vector2d> ExtractPoints2D(const Image& image) {
+  std::vector<Eigen::Vector2d> points2D;
+  points2D.reserve(image.NumPoints2D());
+  for (const Point2D& point2D : image.Points2D()) {
+    points2D.push_back(point2D.xy);
+  }
+  return points2D;
+}
+
+// Groups image observations connected by inlier matches into tracks.
+class TrackBuilder {
+ public:
+  void AddMatch(const image_t image_id1,
+                const point2D_t point2D_idx1,
+                const image_t image_id2,
+                const point2D_t point2D_idx2) {
+    const size_t idx1 = FindOrAdd(image_id1, point2D_idx1);
+    const size_t idx2 = FindOrAdd(image_id2, point2D_idx2);
+    const size_t root1 = FindRoot(idx1);
+    const size_t root2 = FindRoot(idx2);
+    if (root1 != root2) {
+      parents_[std::max(root1, root2)] = std::min(root1, root2);
+    }
+  }
+
+  // Returns tracks with at least the given length that observe every image at
+  // most once, sorted by decreasing length.
+  std::vector<std::vector<std::pair<image_t, point2D_t>>> ExtractTracks(
+      const size_t min_track_length) {
+    std::unordered_map<size_t, std::vector<size_t>> tracks_by_root;
+    for (size_t idx = 0; idx < observations_.size(); ++idx) {
+      tracks_by_root[FindRoot(idx)].push_back(idx);
+    }
+
+    std::vector<std::vector<std::pair<image_t, point2D_t>>> tracks;
+    for (const auto& [root, track_idxs] : tracks_by_root) {
+      if (track_idxs.size() < min_track_length) {
+        continue;
+      }
+      std::vector<std::pair<image_t, point2D_t>> track;
+      track.reserve(track_idxs.size());
+      std::unordered_set<image_t> image_ids;
+      for (const size_t idx : track_idxs) {
+        const uint64_t observation = observations_[idx];
+        const image_t image_id = static_cast<image_t>(observation >> 32);
+        if (!image_ids.insert(image_id).second) {
+          break;
+        }
+        track.emplace_back(image_id,
+                           static_cast<point2D_t>(observation & 0xFFFFFFFF));
+      }
+      if (track.size() == track_idxs.size()) {
+        tracks.push_back(std::move(track));
+      }
+    }
+
+    std::sort(tracks.begin(),
+              tracks.end(),
+              [](const auto& track1, const auto& track2) {
+                if (track1.size() != track2.size()) {
+                  return track1.size() > track2.size();
+                }
+                return track1.front() < track2.front();
+              });
+    return tracks;
+  }
+
+ private:
+  size_t FindOrAdd(const image_t image_id, const point2D_t point2D_idx) {
+    const uint64_t observation =
+        (static_cast<uint64_t>(image_id) << 32) | point2D_idx;
+    const auto [it, inserted] =
+        observation_idxs_.emplace(observation, observations_.size());
+    if (inserted) {
+      observations_.push_back(observation);
+      parents_.push_back(it->second);
+    }
+    return it->second;
+  }
+
+  size_t FindRoot(size_t idx) {
+    while (parents_[idx] != idx) {
+      parents_[idx] = parents_[parents_[idx]];
+      idx = parents_[idx];
+    }
+    return idx;
+  }
+
+  std::unordered_map<uint64_t, size_t> observation_idxs_;
+  std::vector<uint64_t> observations_;
+  std::vector<size_t> parents_;
+};
+
+}  // namespace
+
+bool GlobalMapperOptions::Check() const {
+  CHECK_OPTION_GE(min_num_inliers, 0);
+  CHECK_OPTION_GE(max_num_tracks, 0);
+  CHECK_OPTION_GE(min_track_length, 2);
+  CHECK_OPTION_GE(random_seed, -1);
+  CHECK_OPTION(rotation_averaging.Check());
+  CHECK_OPTION(global_positioning.Check());
+  return true;
+}
+
+GlobalMapper::GlobalMapper(std::shared_ptr<const DatabaseCache> database_cache)
+    : database_cache_(std::move(database_cache)) {}
+
+size_t GlobalMapper::EstimatePoses(
+    const GlobalMapperOptions& options,
+    std::vector<std::pair<image_pair_t, TwoViewGeometry>> two_view_geometries,
+    Reconstruction& reconstruction) const {
+  THROW_CHECK(options.Check());
+
+  reconstruction.Load(*database_cache_);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Select the image pairs of the view graph
+  //////////////////////////////////////////////////////////////////////////////
+
+  const auto is_view_graph_pair =
+      [&](const std::pair<image_pair_t, TwoViewGeometry>& pair) {
+        const auto [image_id1, image_id2] = PairIdToImagePair(pair.first);
+        if (!reconstruction.ExistsImage(image_id1) ||
+            !reconstruction.ExistsImage(image_id2)) {
+          return false;
+        }
+        const Image& image1 = reconstruction.Image(image_id1);
+        const Image& image2 = reconstruction.Image(image_id2);
+        return image1.FrameId() != image2.FrameId() &&
+               MaybeCamFromRig(image1).has_value() &&
+               MaybeCamFromRig(image2).has_value() &&
+               IsValidTwoViewGeometry(pair.second) &&
+               pair.second.inlier_matches.size() >=
+                   static_cast<size_t>(options.min_num_inliers);
+      };
+  two_view_geometries.erase(
+      std::remove_if(
+          two_view_geometries.begin(),
+          two_view_geometries.end(),
+          [&](const auto& pair) { return !is_view_graph_pair(pair); }),
+      two_view_geometries.end());
+
+  // Decompose the epipolar geometry of pairs without relative pose.
+  {
+    ThreadPool thread_pool(GetEffectiveNumThreads(options.num_threads));
+    for (size_t i = 0; i < two_view_geometries.size(); ++i) {
+      if (HasRelativePose(two_view_geometries[i].second)) {
+        continue;
+      }
+      thread_pool.AddTask([&reconstruction, &two_view_geometries, i]() {
+        auto& [pair_id, two_view_geometry] = two_view_geometries[i];
+        const auto [image_id1, image_id2] = PairIdToImagePair(pair_id);
+        const Image& image1 = reconstruction.Image(image_id1);
+        const Image& image2 = reconstruction.Image(image_id2);
+        if (!EstimateTwoViewGeometryPose(*image1.CameraPtr(),
+                                         ExtractPoints2D(image1),
+                                         *image2.CameraPtr(),
+                                         ExtractPoints2D(image2),
+                                         &two_view_geometry)) {
+          two_view_geometry.config = TwoViewGeometry::DEGENERATE;
+        }
+      });
+    }
+    thread_pool.Wait();
+  }
+  two_view_geometries.erase(
+      std::remove_if(two_view_geometries.begin(),
+                     two_view_geometries.end(),
+                     [](const auto& pair) {
+                       return !IsValidTwoViewGeometry(pair.second);
+                     }),
+      two_view_geometries.end());
+
+  LOG(INFO) << "=> View graph image pairs: " << two_view_geometries.size();
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Rotation averaging
+  //////////////////////////////////////////////////////////////////////////////
+
+  std::vector<RelativeRotation> relative_rotations;
+  relative_rotations.reserve(two_view_geometries.size());
+  for (const auto& [pair_id, two_view_geometry] : two_view_geometries) {
+    const auto [image_id1, image_id2] = PairIdToImagePair(pair_id);
+    const Image& image1 = reconstruction.Image(image_id1);
+    const Image& image2 = reconstruction.Image(image_id2);
+    RelativeRotation& relative_rotation = relative_rotations.emplace_back();
+    relative_rotation.frame_id1 = image1.FrameId();
+    relative_rotation.frame_id2 = image2.FrameId();
+    relative_rotation.frame2_from_frame1 =
+        MaybeCamFromRig(image2)->rotation.inverse() *
+        two_view_geometry.cam2_from_cam1.rotation *
+        MaybeCamFromRig(image1)->rotation;
+    relative_rotation.weight = two_view_geometry.inlier_matches.size();
+  }
+
+  RotationAveragingOptions rotation_averaging_options =
+      options.rotation_averaging;
+  rotation_averaging_options.num_threads = options.num_threads;
+
+  std::unordered_map<frame_t, Eigen::Quaterniond> frame_from_world_rotations;
+  std::vector<char> rotation_inlier_mask;
+  if (!EstimateGlobalRotations(rotation_averaging_options,
+                               relative_rotations,
+                               &frame_from_world_rotations,
+                               &rotation_inlier_mask)) {
+    LOG(WARNING) << "Rotation averaging failed";
+    return 0;
+  }
+
+  LOG(INFO) << StringPrintf(
+      "=> Rotation averaging: %zu frames, %zu / %zu inlier pairs",
+      frame_from_world_rotations.size(),
+      static_cast<size_t>(std::count(
+          rotation_inlier_mask.begin(), rotation_inlier_mask.end(), true)),
+      relative_rotations.size());
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Global positioning
+  //////////////////////////////////////////////////////////////////////////////
+
+  std::vector<frame_t> frame_ids;
+  frame_ids.reserve(frame_from_world_rotations.size());
+  for (const auto& [frame_id, _] : frame_from_world_rotations) {
+    frame_ids.push_back(frame_id);
+  }
+  std::sort(frame_ids.begin(), frame_ids.end());
+  std::unordered_map<frame_t, size_t> frame_id_to_idx;
+  for (size_t i = 0; i < frame_ids.size(); ++i) {
+    frame_id_to_idx.emplace(frame_ids[i], i);
+  }
+
+  const auto cam_from_world_rotation = [&](const Image& image) {
+    return MaybeCamFromRig(image)->rotation *
+           frame_from_world_rotations.at(image.FrameId());
+  };
+
+  std::vector<PositionDirection> directions;
+  TrackBuilder track_builder;
+  for (size_t i = 0; i < two_view_geometries.size(); ++i) {
+    if (!rotation_inlier_mask[i]) {
+      continue;
+    }
+    const auto& [pair_id, two_view_geometry] = two_view_geometries[i];
+    const auto [image_id1, image_id2] = PairIdToImagePair(pair_id);
+    const Image& image1 = reconstruction.Image(image_id1);
+    const Image& image2 = reconstruction.Image(image_id2);
+
+    if (HasRelativeTranslation(two_view_geometry)) {
+      // With cam2_from_cam1.translation = R2 * (c1 - c2), the direction from
+      // the first to the second camera center is -R2^T * t.
+      PositionDirection& direction = directions.emplace_back();
+      direction.position_idx1 = frame_id_to_idx.at(image1.FrameId());
+      direction.position_idx2 = frame_id_to_idx.at(image2.FrameId());
+      direction.direction = -(cam_from_world_rotation(image2).inverse() *
+                              two_view_geometry.cam2_from_cam1.translation)
+                                 .normalized();
+    }
+
+    if (options.max_num_tracks > 0) {
+      for (const FeatureMatch& match : two_view_geometry.inlier_matches) {
+        track_builder.AddMatch(
+            image_id1, match.point2D_idx1, image_id2, match.point2D_idx2);
+      }
+    }
+  }
+
+  const size_t num_pair_directions = directions.size();
+
+  size_t num_tracks = 0;
+  if (options.max_num_tracks > 0) {
+    const std::vector<std::vector<std::pair<image_t, point2D_t>>> tracks =
+        track_builder.ExtractTracks(options.min_track_length);
+    num_tracks =
+        std::min(tracks.size(), static_cast<size_t>(options.max_num_tracks));
+    for (size_t track_idx = 0; track_idx < num_tracks; ++track_idx) {
+      for (const auto& [image_id, point2D_idx] : tracks[track_idx]) {
+        const Image& image = reconstruction.Image(image_id);
+        const std::optional<Eigen::Vector2d> cam_point =
+            image.CameraPtr()->CamFromImg(image.Point2D(point2D_idx).xy);
+        if (!cam_point) {
+          continue;
+        }
+        PositionDirection& direction = directions.emplace_back();
+        direction.position_idx1 = frame_id_to_idx.at(image.FrameId());
+        direction.position_idx2 = frame_ids.size() + track_idx;
+        direction.direction = cam_from_world_rotation(image).inverse() *
+                              cam_point->homogeneous().normalized();
+      }
+    }
+  }
+
+  LOG(INFO) << StringPrintf(
+      "=> Global positioning: %zu pair directions, %zu tracks",
+      num_pair_directions,
+      num_tracks);
+
+  GlobalPositioningOptions global_positioning_options =
+      options.global_positioning;
+  global_positioning_options.num_threads = options.num_threads;
+  if (options.random_seed != -1) {
+    global_positioning_options.random_seed = options.random_seed;
+  }
+
+  std::vector<Eigen::Vector3d> positions;
+  if (!EstimateGlobalPositions(global_positioning_options,
+                               directions,
+                               frame_ids.size() + num_tracks,
+                               &positions)) {
+    LOG(WARNING) << "Global positioning failed";
+    return 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Register frames
+  //////////////////////////////////////////////////////////////////////////////
+
+  size_t num_reg_frames = 0;
+  for (size_t i = 0; i < frame_ids.size(); ++i) {
+    const Eigen::Vector3d& position_in_world = positions[i];
+    if (!position_in_world.allFinite()) {
+      continue;
+    }
+    const Eigen::Quaterniond& rig_from_world_rotation =
+        frame_from_world_rotations.at(frame_ids[i]);
+    Frame& frame = reconstruction.Frame(frame_ids[i]);
+    frame.SetRigFromWorld(
+        Rigid3d(rig_from_world_rotation,
+                -(rig_from_world_rotation * position_in_world)));
+    reconstruction.RegisterFrame(frame_ids[i]);
+    ++num_reg_frames;
+  }
+
+  return num_reg_frames;
+}
+
+}  // namespace colmap
@@ -0,0 +1,110 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/estimators/global_positioning.h"
+#include "colmap/estimators/rotation_averaging.h"
+#include "colmap/scene/database_cache.h"
+#include "colmap/scene/reconstruction.h"
+#include "colmap/scene/two_view_geometry.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace colmap {
+
+struct GlobalMapperOptions {
+  // Minimum number of inlier matches for an image pair to be part of the view
+  // graph used for rotation averaging and global positioning.
+  int min_num_inliers = 15;
+
+  // Maximum number of tracks used to constrain the frame positions in
+  // addition to the relative translation directions. The longest tracks are
+  // selected. If zero, only relative translation directions are used.
+  int max_num_tracks = 20000;
+
+  // Minimum number of images observing a track for it to be used in global
+  // positioning.
+  int min_track_length = 3;
+
+  // The number of threads to use during pose estimation.
+  int num_threads = -1;
+
+  // PRNG seed for all stochastic methods during pose estimation.
+  int random_seed = -1;
+
+  RotationAveragingOptions rotation_averaging;
+  GlobalPositioningOptions global_positioning;
+
+  bool Check() const;
+};
+
+// Class that estimates the poses of all frames at once from their two-view
+// geometries, as opposed to registering them one by one as in the
+// `IncrementalMapper`. Rotations are estimated by rotation averaging over the
+// view graph, followed by jointly estimating frame positions and a subset of
+// the track points from relative translation directions and observation rays.
+// The resulting poses are typically refined by triangulating all tracks and
+// running a global bundle adjustment. Example usage:
+//
+//  GlobalMapper mapper(database_cache);
+//  mapper.EstimatePoses(options, database.ReadTwoViewGeometries(),
+//                       reconstruction);
+//  IncrementalMapper refiner(database_cache);
+//  refiner.BeginReconstruction(reconstruction);
+//  for (const image_t image_id : reconstruction->RegImageIds()) {
+//    refiner.TriangulateImage(tri_options, image_id);
+//  }
+//  refiner.IterativeGlobalRefinement(...);
+//  refiner.EndReconstruction(/*discard=*/false);
+//
+// Frame positions are estimated for the rig origin, i.e., the offsets of
+// non-reference sensors within a rig are neglected in global positioning and
+// only recovered in the subsequent bundle adjustment.
+class GlobalMapper {
+ public:
+  explicit GlobalMapper(std::shared_ptr<const DatabaseCache> database_cache);
+
+  // Estimate the poses of the frames in the largest connected component of
+  // the view graph and register them in the reconstruction. Two-view
+  // geometries of calibrated and uncalibrated image pairs without relative
+  // pose are completed by decomposing their epipolar geometry. Returns the
+  // number of registered frames.
+  size_t EstimatePoses(
+      const GlobalMapperOptions& options,
+      std::vector<std::pair<image_pair_t, TwoViewGeometry>> two_view_geometries,
+      Reconstruction& reconstruction) const;
+
+ private:
+  const std::shared_ptr<const DatabaseCache> database_cache_;
+};
+
+}  // namespace colmap
@@ -42,6 +42,26 @@
 #include <fstream>
 
 namespace colmap {
+namespace {
+
+// Updates the bundle adjuster of a previous refinement round in place, if
+// supported, and otherwise replaces it with a new bundle adjuster.
+void UpdateOrCreateBundleAdjuster(
+    const BundleAdjustmentOptions& ba_options,
+    BundleAdjustmentConfig ba_config,
+    Reconstruction& reconstruction,
+    std::unique_ptr<BundleAdjuster>& bundle_adjuster) {
+  if (bundle_adjuster != nullptr &&
+      bundle_adjuster->Update(ba_options, ba_config, reconstruction)) {
+    return;
+  }
+  // Release the previous problem before setting up the new one.
+  bundle_adjuster.reset();
+  bundle_adjuster = CreateDefaultBundleAdjuster(
+      ba_options, std::move(ba_config), reconstruction);
+}
+
+}  // namespace
 
 bool IncrementalMapper::Options::Check() const {
   CHECK_OPTION_GT(init_min_num_inliers, 0);
@@ -62,8 +82,14 @@ bool IncrementalMapper::Options::Check() const {
   CHECK_OPTION_GE(filter_max_reproj_error, 0.0);
   CHECK_OPTION_GE(filter_min_tri_angle, 0.0);
   CHECK_OPTION_GE(max_reg_trials, 1);
+  CHECK_OPTION_GE(ba_global_subsample_min_num_points3D, 0);
+  CHECK_OPTION_GT(ba_global_subsample_grid_size, 0);
+  CHECK_OPTION_GT(ba_global_max_points_per_cell, 0);
   CHECK_OPTION_GE(num_threads, -1);
   CHECK_OPTION_GE(random_seed, -1);
+  CHECK_OPTION_GE(redundant_frame_min_overlap, 0.0);
+  CHECK_OPTION_LE(redundant_frame_min_overlap, 1.0);
+  CHECK_OPTION_GE(redundant_frame_max_disparity, 0.0);
   return true;
 }
 
@@ -130,8 +156,56 @@ bool IncrementalMapper::FindInitialImagePair(const Options& options,
 }
 
 std::vector<image_t> IncrementalMapper::FindNextImages(const Options& options) {
-  return IncrementalMapperImpl::FindNextImages(
+  std::vector<image_t> next_image_ids = IncrementalMapperImpl::FindNextImages(
       options, *obs_manager_, filtered_frames_, reg_stats_.num_reg_trials);
+  if (!redundant_frames_.empty()) {
+    next_image_ids.erase(
+        std::remove_if(next_image_ids.begin(),
+                       next_image_ids.end(),
+                       [this](const image_t image_id) {
+                         return redundant_frames_.count(
+                                    reconstruction_->Image(image_id)
+                                        .FrameId()) > 0;
+                       }),
+        next_image_ids.end());
+  }
+  return next_image_ids;
+}
+
+size_t IncrementalMapper::PruneRedundantFrames(const Options& options) {
+  redundant_frames_ =
+      IncrementalMapperImpl::FindRedundantFrames(options, *database_cache_);
+  return redundant_frames_.size();
+}
+
+size_t IncrementalMapper::RegisterRedundantFrames(const Options& options) {
+  THROW_CHECK_NOTNULL(reconstruction_);
+  if (reconstruction_->NumRegFrames() == 0) {
+    return 0;
+  }
+
+  std::vector<frame_t> frame_ids(redundant_frames_.begin(),
+                                 redundant_frames_.end());
+  std::sort(frame_ids.begin(), frame_ids.end());
+
+  size_t num_reg_frames = 0;
+  for (const frame_t frame_id : frame_ids) {
+    if (!reconstruction_->ExistsFrame(frame_id)) {
+      continue;
+    }
+    const Frame& frame = reconstruction_->Frame(frame_id);
+    if (frame.HasPose()) {
+      continue;
+    }
+    for (const data_t& data_id : frame.ImageIds()) {
+      if (RegisterNextImage(options, data_id.id)) {
+        num_reg_frames += 1;
+        break;
+      }
+    }
+  }
+
+  return num_reg_frames;
 }
 
 void IncrementalMapper::RegisterInitialImagePair(
@@ -646,6 +720,19 @@ IncrementalMapper::AdjustLocalBundle(
     const IncrementalTriangulator::Options& tri_options,
     const image_t image_id,
     const std::unordered_set<point3D_t>& point3D_ids) {
+  std::unique_ptr<BundleAdjuster> bundle_adjuster;
+  return AdjustLocalBundleImpl(
+      options, ba_options, tri_options, image_id, point3D_ids, bundle_adjuster);
+}
+
+IncrementalMapper::LocalBundleAdjustmentReport
+IncrementalMapper::AdjustLocalBundleImpl(
+    const Options& options,
+    const BundleAdjustmentOptions& ba_options,
+    const IncrementalTriangulator::Options& tri_options,
+    const image_t image_id,
+    const std::unordered_set<point3D_t>& point3D_ids,
+    std::unique_ptr<BundleAdjuster>& bundle_adjuster) {
   THROW_CHECK_NOTNULL(reconstruction_);
   THROW_CHECK_NOTNULL(obs_manager_);
   THROW_CHECK(options.Check());
@@ -737,9 +824,8 @@ IncrementalMapper::AdjustLocalBundle(
 
     // Adjust the local bundle.
     image_ids = ba_config.Images();
-    std::unique_ptr<BundleAdjuster> bundle_adjuster =
-        CreateDefaultBundleAdjuster(
-            ba_options, std::move(ba_config), *reconstruction_);
+    UpdateOrCreateBundleAdjuster(
+        ba_options, std::move(ba_config), *reconstruction_, bundle_adjuster);
     const ceres::Solver::Summary summary = bundle_adjuster->Solve();
 
     report.num_adjusted_observations = summary.num_residuals / 2;
@@ -773,6 +859,14 @@ IncrementalMapper::AdjustLocalBundle(
 
 bool IncrementalMapper::AdjustGlobalBundle(
     const Options& options, const BundleAdjustmentOptions& ba_options) {
+  std::unique_ptr<BundleAdjuster> bundle_adjuster;
+  return AdjustGlobalBundleImpl(options, ba_options, bundle_adjuster);
+}
+
+bool IncrementalMapper::AdjustGlobalBundleImpl(
+    const Options& options,
+    const BundleAdjustmentOptions& ba_options,
+    std::unique_ptr<BundleAdjuster>& bundle_adjuster) {
   THROW_CHECK_NOTNULL(reconstruction_);
   THROW_CHECK_NOTNULL(obs_manager_);
 
@@ -816,20 +910,43 @@ bool IncrementalMapper::AdjustGlobalBundle(
     ba_config.SetConstantCamIntrinsics(camera_id);
   }
 
+  // Refine the poses and intrinsics on a uniformly distributed subset of the
+  // tracks for large reconstructions.
+  std::unordered_set<point3D_t> selected_point3D_ids;
+  const bool subsample_tracks =
+      options.ba_global_subsample_tracks &&
+      reconstruction_->NumPoints3D() >
+          static_cast<size_t>(options.ba_global_subsample_min_num_points3D);
+  if (subsample_tracks) {
+    selected_point3D_ids = IncrementalMapperImpl::SelectGlobalBundlePoints(
+        options, ba_config.Images(), *reconstruction_);
+    for (const auto& [point3D_id, _] : reconstruction_->Points3D()) {
+      if (selected_point3D_ids.count(point3D_id) == 0) {
+        ba_config.IgnorePoint(point3D_id);
+      }
+    }
+    VLOG(1) << "=> Subsampled tracks: " << selected_point3D_ids.size()
+            << " / " << reconstruction_->NumPoints3D();
+  }
+
   // Only use prior pose if at least 3 images have been registered.
   const bool use_prior_position =
       options.use_prior_position && ba_config.NumImages() > 2;
 
-  std::unique_ptr<BundleAdjuster> bundle_adjuster;
   if (!use_prior_position) {
     // Fixing the gauge with two cameras leads to a more stable optimization
     // with fewer steps as compared to fixing three points.
     // TODO(jsch): Investigate whether it is safe to not fix the gauge at all,
     // as initial experiments show that it is even faster.
     ba_config.FixGauge(BundleAdjustmentGauge::TWO_CAMS_FROM_WORLD);
-    bundle_adjuster = CreateDefaultBundleAdjuster(
-        std::move(custom_ba_options), ba_config, *reconstruction_);
+    UpdateOrCreateBundleAdjuster(custom_ba_options,
+                                 std::move(ba_config),
+                                 *reconstruction_,
+                                 bundle_adjuster);
   } else {
+    // The pose prior bundle adjuster re-aligns the reconstruction to the
+    // priors, so it is always set up from scratch.
+    bundle_adjuster.reset();
     PosePriorBundleAdjustmentOptions prior_options;
     prior_options.use_robust_loss_on_prior_position =
         options.use_robust_loss_on_prior_position;
@@ -843,7 +960,37 @@ bool IncrementalMapper::AdjustGlobalBundle(
                                       *reconstruction_);
   }
 
-  return bundle_adjuster->Solve().termination_type != ceres::FAILURE;
+  if (bundle_adjuster->Solve().termination_type == ceres::FAILURE) {
+    return false;
+  }
+
+  if (!subsample_tracks) {
+    return true;
+  }
+
+  // Refine the remaining points with fixed poses and intrinsics, which
+  // decomposes into independent problems per point.
+  BundleAdjustmentConfig structure_ba_config;
+  for (const image_t image_id : bundle_adjuster->Config().Images()) {
+    structure_ba_config.AddImage(image_id);
+  }
+  for (const point3D_t point3D_id : selected_point3D_ids) {
+    structure_ba_config.IgnorePoint(point3D_id);
+  }
+
+  BundleAdjustmentOptions structure_ba_options = bundle_adjuster->Options();
+  structure_ba_options.refine_focal_length = false;
+  structure_ba_options.refine_principal_point = false;
+  structure_ba_options.refine_extra_params = false;
+  structure_ba_options.refine_sensor_from_rig = false;
+  structure_ba_options.refine_rig_from_world = false;
+  structure_ba_options.reuse_problem = false;
+  structure_ba_options.use_batched_solver = false;
+  return CreateDefaultBundleAdjuster(std::move(structure_ba_options),
+                                     std::move(structure_ba_config),
+                                     *reconstruction_)
+             ->Solve()
+             .termination_type != ceres::FAILURE;
 }
 
 void IncrementalMapper::IterativeLocalRefinement(
@@ -854,12 +1001,15 @@ void IncrementalMapper::IterativeLocalRefinement(
     const IncrementalTriangulator::Options& tri_options,
     const image_t image_id) {
   BundleAdjustmentOptions custom_ba_options = ba_options;
+  // Only used across rounds, if the problem is reused.
+  std::unique_ptr<BundleAdjuster> bundle_adjuster;
   for (int i = 0; i < max_num_refinements; ++i) {
-    const auto report = AdjustLocalBundle(options,
-                                          custom_ba_options,
-                                          tri_options,
-                                          image_id,
-                                          GetModifiedPoints3D());
+    const auto report = AdjustLocalBundleImpl(options,
+                                              custom_ba_options,
+                                              tri_options,
+                                              image_id,
+                                              GetModifiedPoints3D(),
+                                              bundle_adjuster);
     VLOG(1) << "=> Merged observations: " << report.num_merged_observations;
     VLOG(1) << "=> Completed observations: "
             << report.num_completed_observations;
@@ -891,9 +1041,11 @@ void IncrementalMapper::IterativeGlobalRefinement(
     const bool normalize_reconstruction) {
   CompleteAndMergeTracks(tri_options);
   VLOG(1) << "=> Retriangulated observations: " << Retriangulate(tri_options);
+  // Only used across rounds, if the problem is reused.
+  std::unique_ptr<BundleAdjuster> bundle_adjuster;
   for (int i = 0; i < max_num_refinements; ++i) {
     const size_t num_observations = reconstruction_->ComputeNumObservations();
-    AdjustGlobalBundle(options, ba_options);
+    AdjustGlobalBundleImpl(options, ba_options, bundle_adjuster);
     if (normalize_reconstruction && !options.use_prior_position) {
       // Normalize scene for numerical stability and
       // to avoid large scale changes in the viewer.
@@ -976,6 +1128,10 @@ const std::unordered_set<image_t>& IncrementalMapper::ExistingFrameIds() const {
   return existing_frame_ids_;
 }
 
+const std::unordered_set<frame_t>& IncrementalMapper::RedundantFrames() const {
+  return redundant_frames_;
+}
+
 void IncrementalMapper::ResetInitializationStats() {
   reg_stats_.init_image_pairs.clear();
   reg_stats_.init_num_reg_trials.clear();
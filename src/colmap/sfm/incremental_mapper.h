@@ -122,6 +122,23 @@ class IncrementalMapper {
     // of refine_focal_length, refine_principal_point, and refine_extra_params.
     std::unordered_set<camera_t> constant_cameras;
 
+    // Whether to subsample the tracks in global bundle adjustment of large
+    // reconstructions. The poses and intrinsics are then refined on up to
+    // `ba_global_max_points_per_cell` points per cell of a uniform grid over
+    // each image, and the remaining points are refined afterwards with fixed
+    // poses and intrinsics.
+    bool ba_global_subsample_tracks = false;
+
+    // Minimum number of 3D points in the reconstruction to subsample tracks.
+    int ba_global_subsample_min_num_points3D = 100000;
+
+    // Number of grid cells along each image dimension for track subsampling.
+    int ba_global_subsample_grid_size = 16;
+
+    // Maximum number of selected points per grid cell in each image. Points
+    // with longer tracks and smaller reprojection errors are preferred.
+    int ba_global_max_points_per_cell = 4;
+
     // Whether to use prior camera positions
     bool use_prior_position = false;
 
@@ -147,6 +164,19 @@ class IncrementalMapper {
     ImageSelectionMethod image_selection_method =
         ImageSelectionMethod::MIN_UNCERTAINTY;
 
+    // Whether to prune near-duplicate frames, e.g., in video sequences, before
+    // mapping. Redundant frames are skipped during incremental growth and only
+    // registered against the fixed 3D points at the end of a reconstruction.
+    bool prune_redundant_frames = false;
+
+    // Minimum fraction of a frame's observations with correspondences to an
+    // already kept frame for the frame to be considered redundant.
+    double redundant_frame_min_overlap = 0.9;
+
+    // Maximum median displacement of the correspondences to the kept frame,
+    // relative to the image diagonal, for the frame to be considered redundant.
+    double redundant_frame_max_disparity = 0.02;
+
     bool Check() const;
   };
 
@@ -186,6 +216,18 @@ class IncrementalMapper {
   // ignores images that failed to registered for `max_reg_trials`.
   std::vector<image_t> FindNextImages(const Options& options);
 
+  // Find frames that are redundant with respect to other, better connected
+  // frames based on their overlap and disparity in the correspondence graph.
+  // Redundant frames are ignored by `FindNextImages` and should be registered
+  // with `RegisterRedundantFrames` once the reconstruction has converged.
+  // Returns the number of redundant frames.
+  size_t PruneRedundantFrames(const Options& options);
+
+  // Attempt to register all unregistered redundant frames to the current
+  // reconstruction. The 3D points are kept fixed and only the tracks of
+  // existing 3D points are continued. Returns the number of registered frames.
+  size_t RegisterRedundantFrames(const Options& options);
+
   // Attempt to seed the reconstruction from an image pair.
   void RegisterInitialImagePair(const Options& options,
                                 image_t image_id1,
@@ -266,6 +308,7 @@ class IncrementalMapper {
   IncrementalTriangulator& Triangulator() const;
   const std::unordered_set<frame_t>& FilteredFrames() const;
   const std::unordered_set<frame_t>& ExistingFrameIds() const;
+  const std::unordered_set<frame_t>& RedundantFrames() const;
   const std::unordered_map<rig_t, size_t>& NumRegFramesPerRig() const;
   const std::unordered_map<camera_t, size_t>& NumRegImagesPerCamera() const;
 
@@ -331,6 +374,20 @@ class IncrementalMapper {
   // Registers a frame using generalized absolute pose estimation.
   bool RegisterNextGeneralFrame(const Options& options, Frame& frame);
 
+  // Local and global bundle adjustment that update the given bundle adjuster
+  // of a previous refinement round in place, if the problem is reused.
+  LocalBundleAdjustmentReport AdjustLocalBundleImpl(
+      const Options& options,
+      const BundleAdjustmentOptions& ba_options,
+      const IncrementalTriangulator::Options& tri_options,
+      image_t image_id,
+      const std::unordered_set<point3D_t>& point3D_ids,
+      std::unique_ptr<BundleAdjuster>& bundle_adjuster);
+  bool AdjustGlobalBundleImpl(
+      const Options& options,
+      const BundleAdjustmentOptions& ba_options,
+      std::unique_ptr<BundleAdjuster>& bundle_adjuster);
+
   // Register / De-register frame in current reconstruction and update
   // the (shared) registration statistics.
   void RegisterFrameEvent(frame_t frame_id);
@@ -354,6 +411,10 @@ class IncrementalMapper {
   // Frames that have been filtered in current reconstruction.
   std::unordered_set<frame_t> filtered_frames_;
 
+  // Frames that are deferred until the end of each reconstruction, as they are
+  // redundant to other frames. Shared across all reconstructions.
+  std::unordered_set<frame_t> redundant_frames_;
+
   // Frames that were registered before beginning the reconstruction.
   // This frame list will be non-empty, if the reconstruction is continued from
   // an existing reconstruction.
@@ -33,11 +33,13 @@
 #include "colmap/estimators/pose.h"
 #include "colmap/estimators/two_view_geometry.h"
 #include "colmap/geometry/triangulation.h"
+#include "colmap/math/math.h"
 #include "colmap/scene/projection.h"
 #include "colmap/util/misc.h"
 
 #include <array>
 #include <fstream>
+#include <set>
 
 namespace colmap {
 namespace {
@@ -362,6 +364,132 @@ std::vector<image_t> IncrementalMapperImpl::FindNextImages(
   return ranked_images_ids;
 }
 
+std::unordered_set<frame_t> IncrementalMapperImpl::FindRedundantFrames(
+    const IncrementalMapper::Options& options,
+    const DatabaseCache& database_cache) {
+  THROW_CHECK(options.Check());
+  const CorrespondenceGraph& correspondence_graph =
+      *database_cache.CorrespondenceGraph();
+
+  // Count the observations per frame. Frames without observations are neither
+  // kept nor redundant, as they cannot be registered anyway.
+  std::vector<std::pair<frame_t, size_t>> frame_num_observations;
+  frame_num_observations.reserve(database_cache.NumFrames());
+  std::unordered_map<frame_t, bool> is_single_image_frame;
+  is_single_image_frame.reserve(database_cache.NumFrames());
+  for (const auto& [frame_id, frame] : database_cache.Frames()) {
+    size_t num_images = 0;
+    size_t num_observations = 0;
+    for (const data_t& data_id : frame.ImageIds()) {
+      num_images += 1;
+      if (correspondence_graph.ExistsImage(data_id.id)) {
+        num_observations +=
+            correspondence_graph.NumObservationsForImage(data_id.id);
+      }
+    }
+    is_single_image_frame.emplace(frame_id, num_images == 1);
+    if (num_observations > 0) {
+      frame_num_observations.emplace_back(frame_id, num_observations);
+    }
+  }
+
+  // Visit the best connected frames first, such that they are kept.
+  std::sort(frame_num_observations.begin(),
+            frame_num_observations.end(),
+            [](const std::pair<frame_t, size_t>& frame1,
+               const std::pair<frame_t, size_t>& frame2) {
+              if (frame1.second == frame2.second) {
+                return frame1.first < frame2.first;
+              }
+              return frame1.second > frame2.second;
+            });
+
+  std::unordered_set<frame_t> kept_frames;
+  std::unordered_set<frame_t> redundant_frames;
+
+  std::unordered_map<frame_t, size_t> num_shared_observations;
+  std::unordered_map<frame_t, std::vector<double>> disparities;
+  std::vector<frame_t> point2D_frame_ids;
+
+  for (const auto& [frame_id, num_observations] : frame_num_observations) {
+    const Frame& frame = database_cache.Frame(frame_id);
+    const bool single_image_frame = is_single_image_frame.at(frame_id);
+
+    // Collect the number of shared observations and the normalized image
+    // displacements of the correspondences to all kept frames.
+    num_shared_observations.clear();
+    disparities.clear();
+    for (const data_t& data_id : frame.ImageIds()) {
+      const image_t image_id = data_id.id;
+      if (!correspondence_graph.ExistsImage(image_id)) {
+        continue;
+      }
+
+      const Image& image = database_cache.Image(image_id);
+      const Camera& camera = database_cache.Camera(image.CameraId());
+      const double diagonal = std::sqrt(static_cast<double>(
+          camera.width * camera.width + camera.height * camera.height));
+
+      for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+           ++point2D_idx) {
+        point2D_frame_ids.clear();
+        const auto corr_range =
+            correspondence_graph.FindCorrespondences(image_id, point2D_idx);
+        for (const auto* corr = corr_range.beg; corr < corr_range.end;
+             ++corr) {
+          const Image& corr_image = database_cache.Image(corr->image_id);
+          const frame_t corr_frame_id = corr_image.FrameId();
+          if (kept_frames.count(corr_frame_id) == 0) {
+            continue;
+          }
+
+          // Count every observation only once per kept frame.
+          if (std::find(point2D_frame_ids.begin(),
+                        point2D_frame_ids.end(),
+                        corr_frame_id) == point2D_frame_ids.end()) {
+            point2D_frame_ids.push_back(corr_frame_id);
+            num_shared_observations[corr_frame_id] += 1;
+          }
+
+          // Image displacements are only meaningful between the same sensors.
+          if (corr_image.CameraId() == image.CameraId() ||
+              (single_image_frame &&
+               is_single_image_frame.at(corr_frame_id))) {
+            disparities[corr_frame_id].push_back(
+                (corr_image.Point2D(corr->point2D_idx).xy -
+                 image.Point2D(point2D_idx).xy)
+                    .norm() /
+                diagonal);
+          }
+        }
+      }
+    }
+
+    bool is_redundant = false;
+    for (const auto& [kept_frame_id, num_shared] : num_shared_observations) {
+      if (num_shared <
+          options.redundant_frame_min_overlap * num_observations) {
+        continue;
+      }
+      auto disparities_it = disparities.find(kept_frame_id);
+      if (disparities_it != disparities.end() &&
+          Median(disparities_it->second) <=
+              options.redundant_frame_max_disparity) {
+        is_redundant = true;
+        break;
+      }
+    }
+
+    if (is_redundant) {
+      redundant_frames.insert(frame_id);
+    } else {
+      kept_frames.insert(frame_id);
+    }
+  }
+
+  return redundant_frames;
+}
+
 std::vector<image_t> IncrementalMapperImpl::FindLocalBundle(
     const IncrementalMapper::Options& options,
     image_t image_id,
@@ -535,6 +663,86 @@ std::vector<image_t> IncrementalMapperImpl::FindLocalBundle(
   return local_bundle_image_ids;
 }
 
+std::unordered_set<point3D_t> IncrementalMapperImpl::SelectGlobalBundlePoints(
+    const IncrementalMapper::Options& options,
+    const std::unordered_set<image_t>& image_ids,
+    const Reconstruction& reconstruction) {
+  THROW_CHECK(options.Check());
+
+  const int grid_size = options.ba_global_subsample_grid_size;
+  const size_t max_points_per_cell = options.ba_global_max_points_per_cell;
+
+  struct Candidate {
+    int cell_idx;
+    point3D_t point3D_id;
+    size_t track_length;
+    double error;
+  };
+
+  // Visit the images in a deterministic order, as the selection in one image
+  // depends on the points selected in the previous images.
+  const std::set<image_t> sorted_image_ids(image_ids.begin(), image_ids.end());
+
+  std::unordered_set<point3D_t> point3D_ids;
+  std::vector<Candidate> candidates;
+  for (const image_t image_id : sorted_image_ids) {
+    const Image& image = reconstruction.Image(image_id);
+    const Camera& camera = *image.CameraPtr();
+
+    candidates.clear();
+    candidates.reserve(image.NumPoints3D());
+    for (const Point2D& point2D : image.Points2D()) {
+      if (!point2D.HasPoint3D()) {
+        continue;
+      }
+      const Point3D& point3D = reconstruction.Point3D(point2D.point3D_id);
+      const int cell_x = Clamp<int>(
+          grid_size * point2D.xy.x() / camera.width, 0, grid_size - 1);
+      const int cell_y = Clamp<int>(
+          grid_size * point2D.xy.y() / camera.height, 0, grid_size - 1);
+      candidates.push_back({cell_y * grid_size + cell_x,
+                            point2D.point3D_id,
+                            point3D.track.Length(),
+                            point3D.error});
+    }
+
+    // Points already selected through other images count towards the cell
+    // capacity, so that well-covered regions do not accumulate points.
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [&point3D_ids](const Candidate& a, const Candidate& b) {
+                if (a.cell_idx != b.cell_idx) {
+                  return a.cell_idx < b.cell_idx;
+                }
+                const bool a_selected = point3D_ids.count(a.point3D_id) > 0;
+                const bool b_selected = point3D_ids.count(b.point3D_id) > 0;
+                if (a_selected != b_selected) {
+                  return a_selected;
+                }
+                if (a.track_length != b.track_length) {
+                  return a.track_length > b.track_length;
+                }
+                if (a.error != b.error) {
+                  return a.error < b.error;
+                }
+                return a.point3D_id < b.point3D_id;
+              });
+
+    size_t num_cell_points = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      if (i == 0 || candidates[i].cell_idx != candidates[i - 1].cell_idx) {
+        num_cell_points = 0;
+      }
+      if (num_cell_points < max_points_per_cell) {
+        point3D_ids.insert(candidates[i].point3D_id);
+        num_cell_points += 1;
+      }
+    }
+  }
+
+  return point3D_ids;
+}
+
 namespace {
 
 bool EstimateInitialGeneralizedTwoViewGeometry(
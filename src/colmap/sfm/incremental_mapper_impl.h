@@ -80,12 +80,29 @@ class IncrementalMapperImpl {
       const std::unordered_set<image_t>& filtered_images,
       std::unordered_map<image_t, size_t>& num_reg_trials);
 
+  // Implement IncrementalMapper::PruneRedundantFrames. Frames are visited in
+  // decreasing order of their number of observations and a frame is redundant,
+  // if it has sufficient overlap with small disparity to an already kept frame.
+  static std::unordered_set<frame_t> FindRedundantFrames(
+      const IncrementalMapper::Options& options,
+      const DatabaseCache& database_cache);
+
   // Implement IncrementalMapper::FindLocalBundle
   static std::vector<image_t> FindLocalBundle(
       const IncrementalMapper::Options& options,
       image_t image_id,
       const Reconstruction& reconstruction);
 
+  // Select a subset of the 3D points observed in the given images for global
+  // bundle adjustment, such that each image keeps a uniform coverage. Up to
+  // `ba_global_max_points_per_cell` points are selected in each cell of a
+  // uniform grid over each image, preferring points with longer tracks and
+  // smaller reprojection errors.
+  static std::unordered_set<point3D_t> SelectGlobalBundlePoints(
+      const IncrementalMapper::Options& options,
+      const std::unordered_set<image_t>& image_ids,
+      const Reconstruction& reconstruction);
+
   // Implement IncrementalMapper::EstimateInitialTwoViewGeometry
   static bool EstimateInitialTwoViewGeometry(
       const IncrementalMapper::Options& options,
@@ -407,18 +407,31 @@ size_t ObservationManager::FilterPoints3DWithLargeReprojectionError(
     const std::unordered_set<point3D_t>& point3D_ids) {
   const double max_squared_reproj_error = max_reproj_error * max_reproj_error;
 
-  // Number of filtered observations.
-  size_t num_filtered_observations = 0;
-
+  std::vector<point3D_t> existing_point3D_ids;
+  existing_point3D_ids.reserve(point3D_ids.size());
   for (const auto point3D_id : point3D_ids) {
-    if (!reconstruction_.ExistsPoint3D(point3D_id)) {
-      continue;
+    if (reconstruction_.ExistsPoint3D(point3D_id)) {
+      existing_point3D_ids.push_back(point3D_id);
     }
+  }
 
+  // Evaluate all observations in one batch before modifying any tracks.
+  const std::vector<double> squared_reproj_errors =
+      reconstruction_.ComputeSquaredReprojectionErrors(existing_point3D_ids);
+
+  // Number of filtered observations.
+  size_t num_filtered_observations = 0;
+
+  size_t error_idx = 0;
+  for (const auto point3D_id : existing_point3D_ids) {
     struct Point3D& point3D = reconstruction_.Point3D(point3D_id);
+    const size_t track_length = point3D.track.Length();
+    const double* track_squared_reproj_errors =
+        squared_reproj_errors.data() + error_idx;
+    error_idx += track_length;
 
-    if (point3D.track.Length() < 2) {
-      num_filtered_observations += point3D.track.Length();
+    if (track_length < 2) {
+      num_filtered_observations += track_length;
       DeletePoint3D(point3D_id);
       continue;
     }
@@ -427,21 +440,17 @@ size_t ObservationManager::FilterPoints3DWithLargeReprojectionError(
 
     std::vector<TrackElement> track_els_to_delete;
 
-    for (const auto& track_el : point3D.track.Elements()) {
-      const Image& image = reconstruction_.Image(track_el.image_id);
-      const struct Camera& camera = *image.CameraPtr();
-      const Point2D& point2D = image.Point2D(track_el.point2D_idx);
-      const double squared_reproj_error = CalculateSquaredReprojectionError(
-          point2D.xy, point3D.xyz, image.CamFromWorld(), camera);
+    for (size_t i = 0; i < track_length; ++i) {
+      const double squared_reproj_error = track_squared_reproj_errors[i];
       if (squared_reproj_error > max_squared_reproj_error) {
-        track_els_to_delete.push_back(track_el);
+        track_els_to_delete.push_back(point3D.track.Element(i));
       } else {
         reproj_error_sum += std::sqrt(squared_reproj_error);
       }
     }
 
-    if (track_els_to_delete.size() >= point3D.track.Length() - 1) {
-      num_filtered_observations += point3D.track.Length();
+    if (track_els_to_delete.size() >= track_length - 1) {
+      num_filtered_observations += track_length;
       DeletePoint3D(point3D_id);
     } else {
       num_filtered_observations += track_els_to_delete.size();
@@ -131,6 +131,30 @@ TEST(ObservationManager, FilterPoints3D) {
   EXPECT_EQ(reconstruction.NumPoints3D(), 0);
 }
 
+TEST(ObservationManager, FilterPoints3DWithLargeReprojectionError) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(3, reconstruction);
+  ObservationManager obs_manager(reconstruction);
+  reconstruction.Image(2).Point2D(0).xy = Eigen::Vector2d(0.1, 0);
+  reconstruction.Image(3).Point2D(0).xy = Eigen::Vector2d(1, 0);
+  const point3D_t point3D_id =
+      reconstruction.AddPoint3D(Eigen::Vector3d(-0.5, -0.5, 1), Track());
+  reconstruction.AddObservation(point3D_id, TrackElement(1, 0));
+  reconstruction.AddObservation(point3D_id, TrackElement(2, 0));
+  reconstruction.AddObservation(point3D_id, TrackElement(3, 0));
+  EXPECT_EQ(obs_manager.FilterPoints3DWithLargeReprojectionError(
+                0.5, std::unordered_set<point3D_t>{point3D_id}),
+            1);
+  EXPECT_EQ(reconstruction.NumPoints3D(), 1);
+  EXPECT_EQ(reconstruction.Point3D(point3D_id).track.Length(), 2);
+  // The error is averaged over the remaining observations only.
+  EXPECT_NEAR(reconstruction.Point3D(point3D_id).error, 0.05, 1e-12);
+  EXPECT_EQ(obs_manager.FilterPoints3DWithLargeReprojectionError(
+                0.05, std::unordered_set<point3D_t>{point3D_id}),
+            2);
+  EXPECT_EQ(reconstruction.NumPoints3D(), 0);
+}
+
 TEST(ObservationManager, FilterPoints3DInImages) {
   Reconstruction reconstruction;
   GenerateReconstruction(2, reconstruction);
@@ -55,6 +55,8 @@ class StereoOptionsTab : public OptionsWidget {
     AddOptionInt(
         &options->patch_match_stereo->max_image_size, "max_image_size", -1);
     AddOptionText(&options->patch_match_stereo->gpu_index, "gpu_index");
+    AddOptionBool(&options->patch_match_stereo->use_gpu, "use_gpu");
+    AddOptionInt(&options->patch_match_stereo->num_threads, "num_threads", -1);
     AddOptionDouble(&options->patch_match_stereo->depth_min, "depth_min", -1);
     AddOptionDouble(&options->patch_match_stereo->depth_max, "depth_max", -1);
     AddOptionInt(&options->patch_match_stereo->window_radius, "window_radius");
@@ -95,6 +97,12 @@ class StereoOptionsTab : public OptionsWidget {
                     1);
     AddOptionBool(&options->patch_match_stereo->write_consistency_graph,
                   "write_consistency_graph");
+    AddOptionText(&options->patch_match_stereo->output_format,
+                  "output_format {LEGACY, BIN}");
+    AddOptionBool(&options->patch_match_stereo->output_half_precision,
+                  "output_half_precision");
+    AddOptionBool(&options->patch_match_stereo->output_compress,
+                  "output_compress");
   }
 };
 
@@ -378,7 +386,6 @@ void DenseReconstructionWidget::Stereo() {
     return;
   }
 
-#if defined(COLMAP_CUDA_ENABLED)
   auto processor =
       std::make_unique<ControllerThread<mvs::PatchMatchController>>(
           std::make_shared<mvs::PatchMatchController>(
@@ -386,12 +393,6 @@ void DenseReconstructionWidget::Stereo() {
   processor->AddCallback(Thread::FINISHED_CALLBACK,
                          [this]() { refresh_workspace_action_->trigger(); });
   thread_control_widget_->StartThread("Stereo...", true, std::move(processor));
-#else
-  QMessageBox::critical(this,
-                        "",
-                        tr("Dense stereo reconstruction requires CUDA, which "
-                           "is not available on your system."));
-#endif
 }
 
 void DenseReconstructionWidget::Fusion() {
@@ -50,6 +50,7 @@ class MapperGeneralOptionsWidget : public OptionsWidget {
     AddOptionDirPath(&options->mapper->snapshot_path, "snapshot_path");
     AddOptionInt(
         &options->mapper->snapshot_frames_freq, "snapshot_frames_freq", 0);
+    AddOptionBool(&options->mapper->snapshot_async, "snapshot_async");
   }
 };
 
@@ -128,6 +129,13 @@ class MapperBundleAdjustmentOptionsWidget : public OptionsWidget {
                   "refine_extra_params");
     AddOptionBool(&options->mapper->ba_refine_sensor_from_rig,
                   "refine_sensor_from_rig");
+    AddOptionBool(&options->mapper->ba_reuse_problem, "reuse_problem");
+    AddOptionBool(&options->mapper->ba_use_batched_solver,
+                  "use_batched_solver");
+    AddOptionBool(&options->mapper->ba_use_mixed_precision,
+                  "use_mixed_precision");
+    AddOptionFilePath(&options->mapper->ba_solver_profile_path,
+                      "solver_profile_path");
 
     AddSpacer();
 
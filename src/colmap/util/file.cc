@@ -37,6 +37,18 @@
 #include <mutex>
 #include <sstream>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifdef COLMAP_DOWNLOAD_ENABLED
 #include <curl/curl.h>
 #if defined(COLMAP_USE_CRYPTOPP)
@@ -298,6 +310,89 @@ void WriteBinaryBlob(const std::string& path, const span<const char>& data) {
   file.write(data.begin(), data.size());
 }
 
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+  file_handle_ = CreateFileA(path.c_str(),
+                             GENERIC_READ,
+                             FILE_SHARE_READ,
+                             nullptr,
+                             OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+  THROW_CHECK(file_handle_ != INVALID_HANDLE_VALUE)
+      << "Could not open " << path;
+  LARGE_INTEGER file_size;
+  THROW_CHECK(GetFileSizeEx(file_handle_, &file_size));
+  num_bytes_ = static_cast<size_t>(file_size.QuadPart);
+  if (num_bytes_ > 0) {
+    mapping_handle_ = CreateFileMappingA(
+        file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    THROW_CHECK_NOTNULL(mapping_handle_);
+    data_ = static_cast<const char*>(
+        MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+    THROW_CHECK_NOTNULL(data_);
+  }
+#else
+  const int fd = open(path.c_str(), O_RDONLY);
+  THROW_CHECK_GE(fd, 0) << "Could not open " << path;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    LOG(FATAL_THROW) << "Could not stat " << path;
+  }
+  num_bytes_ = static_cast<size_t>(file_stat.st_size);
+  if (num_bytes_ > 0) {
+    void* data = mmap(nullptr, num_bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    THROW_CHECK(data != MAP_FAILED) << "Could not map " << path;
+    data_ = static_cast<const char*>(data);
+  } else {
+    close(fd);
+  }
+#endif
+}
+
+MappedFile::~MappedFile() { Close(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Close();
+    std::swap(data_, other.data_);
+    std::swap(num_bytes_, other.num_bytes_);
+#ifdef _WIN32
+    std::swap(file_handle_, other.file_handle_);
+    std::swap(mapping_handle_, other.mapping_handle_);
+#endif
+  }
+  return *this;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_ != nullptr) {
+    CloseHandle(mapping_handle_);
+    mapping_handle_ = nullptr;
+  }
+  if (file_handle_ != nullptr && file_handle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_handle_);
+  }
+  file_handle_ = nullptr;
+#else
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), num_bytes_);
+  }
+#endif
+  data_ = nullptr;
+  num_bytes_ = 0;
+}
+
 std::vector<std::string> ReadTextFileLines(const std::string& path) {
   std::ifstream file(path);
   THROW_CHECK_FILE_OPEN(file, path);
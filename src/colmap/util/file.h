@@ -135,6 +135,35 @@ void ReadBinaryBlob(const std::string& path, std::vector<char>* data);
 // Write contiguous binary blob to file.
 void WriteBinaryBlob(const std::string& path, const span<const char>& data);
 
+// Read-only memory mapping of a whole file. The file contents are paged in
+// lazily by the operating system, so that only the accessed parts of large
+// files are actually read from disk.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  inline const char* Data() const { return data_; }
+  inline size_t NumBytes() const { return num_bytes_; }
+
+  // Unmap the file.
+  void Close();
+
+ private:
+  const char* data_ = nullptr;
+  size_t num_bytes_ = 0;
+#ifdef _WIN32
+  void* file_handle_ = nullptr;
+  void* mapping_handle_ = nullptr;
+#endif
+};
+
 // Read each line of a text file into a separate element. Empty lines are
 // ignored and leading/trailing whitespace is removed.
 std::vector<std::string> ReadTextFileLines(const std::string& path);
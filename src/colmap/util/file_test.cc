@@ -192,6 +192,41 @@ TEST(ReadWriteBinaryBlob, Nominal) {
   EXPECT_EQ(read_data, data);
 }
 
+TEST(MappedFile, Nominal) {
+  const std::string file_path = CreateTestDir() + "/test.bin";
+  const int kNumBytes = 123;
+  std::vector<char> data(kNumBytes);
+  for (int i = 0; i < kNumBytes; ++i) {
+    data[i] = (i * 100 + 4 + i) % 256;
+  }
+
+  WriteBinaryBlob(file_path, {data.data(), data.size()});
+
+  MappedFile mapped_file(file_path);
+  ASSERT_EQ(mapped_file.NumBytes(), kNumBytes);
+  EXPECT_EQ(
+      std::vector<char>(mapped_file.Data(), mapped_file.Data() + kNumBytes),
+      data);
+
+  MappedFile moved_mapped_file = std::move(mapped_file);
+  EXPECT_EQ(mapped_file.Data(), nullptr);
+  EXPECT_EQ(mapped_file.NumBytes(), 0);
+  EXPECT_EQ(moved_mapped_file.NumBytes(), kNumBytes);
+  EXPECT_EQ(moved_mapped_file.Data()[kNumBytes - 1], data[kNumBytes - 1]);
+
+  moved_mapped_file.Close();
+  EXPECT_EQ(moved_mapped_file.Data(), nullptr);
+  EXPECT_EQ(moved_mapped_file.NumBytes(), 0);
+}
+
+TEST(MappedFile, Empty) {
+  const std::string file_path = CreateTestDir() + "/empty.bin";
+  WriteBinaryBlob(file_path, {nullptr, 0});
+  MappedFile mapped_file(file_path);
+  EXPECT_EQ(mapped_file.NumBytes(), 0);
+  EXPECT_THROW(MappedFile(file_path + ".missing"), std::exception);
+}
+
 TEST(IsURI, Nominal) {
   EXPECT_FALSE(IsURI(""));
   EXPECT_TRUE(IsURI("http://"));
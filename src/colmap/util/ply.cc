@@ -33,293 +33,215 @@
 #include "colmap/util/endian.h"
 #include "colmap/util/file.h"
 #include "colmap/util/logging.h"
+#include "colmap/util/threading.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <iomanip>
 
 #include <Eigen/Core>
 
 namespace colmap {
+namespace {
+
+template <typename T>
+double ReadBinaryPlyValue(std::istream* stream, const bool is_little_endian) {
+  T value;
+  stream->read(reinterpret_cast<char*>(&value), sizeof(T));
+  return is_little_endian ? LittleEndianToNative(value)
+                          : BigEndianToNative(value);
+}
 
-std::vector<PlyPoint> ReadPly(const std::string& path) {
-  std::ifstream file(path, std::ios::binary);
-  THROW_CHECK_FILE_OPEN(file, path);
+// Read a single scalar value of the given PLY data type.
+double ReadPlyValue(std::istream* stream,
+                    const std::string& type,
+                    const bool is_binary,
+                    const bool is_little_endian) {
+  if (!is_binary) {
+    double value;
+    *stream >> value;
+    return value;
+  }
+  if (type == "char" || type == "int8") {
+    return ReadBinaryPlyValue<int8_t>(stream, is_little_endian);
+  } else if (type == "uchar" || type == "uint8") {
+    return ReadBinaryPlyValue<uint8_t>(stream, is_little_endian);
+  } else if (type == "short" || type == "int16") {
+    return ReadBinaryPlyValue<int16_t>(stream, is_little_endian);
+  } else if (type == "ushort" || type == "uint16") {
+    return ReadBinaryPlyValue<uint16_t>(stream, is_little_endian);
+  } else if (type == "int" || type == "int32") {
+    return ReadBinaryPlyValue<int32_t>(stream, is_little_endian);
+  } else if (type == "uint" || type == "uint32") {
+    return ReadBinaryPlyValue<uint32_t>(stream, is_little_endian);
+  } else if (type == "float" || type == "float32") {
+    return ReadBinaryPlyValue<float>(stream, is_little_endian);
+  } else if (type == "double" || type == "float64") {
+    return ReadBinaryPlyValue<double>(stream, is_little_endian);
+  }
+  LOG(FATAL_THROW) << "Invalid data type: " << type;
+  return 0;
+}
 
-  std::vector<PlyPoint> points;
+struct PlyProperty {
+  std::string name;
+  std::string type;
+  // The data type of the number of values for list properties.
+  std::string list_size_type;
+};
 
-  std::string line;
+struct PlyElement {
+  std::string name;
+  size_t num_values = 0;
+  std::vector<PlyProperty> properties;
+};
 
-  // The index of the property for ASCII PLY files.
-  int X_index = -1;
-  int Y_index = -1;
-  int Z_index = -1;
-  int NX_index = -1;
-  int NY_index = -1;
-  int NZ_index = -1;
-  int R_index = -1;
-  int G_index = -1;
-  int B_index = -1;
-
-  // The position in number of bytes of the property for binary PLY files.
-  int X_byte_pos = -1;
-  int Y_byte_pos = -1;
-  int Z_byte_pos = -1;
-  int NX_byte_pos = -1;
-  int NY_byte_pos = -1;
-  int NZ_byte_pos = -1;
-  int R_byte_pos = -1;
-  int G_byte_pos = -1;
-  int B_byte_pos = -1;
-
-  // Flag to use double precision in binary PLY files
-  bool X_double = false;
-  bool Y_double = false;
-  bool Z_double = false;
-  bool NX_double = false;
-  bool NY_double = false;
-  bool NZ_double = false;
-
-  bool in_vertex_section = false;
+struct PlyHeader {
   bool is_binary = false;
   bool is_little_endian = false;
-  size_t num_bytes_per_line = 0;
-  size_t num_vertices = 0;
+  std::vector<PlyElement> elements;
+};
 
-  int index = 0;
-  while (std::getline(file, line)) {
+// Read the header up to and including the end_header line.
+PlyHeader ReadPlyHeader(std::istream* stream) {
+  PlyHeader header;
+  std::string line;
+  bool has_end_header = false;
+  while (std::getline(*stream, line)) {
     StringTrim(&line);
-
-    if (line.empty()) {
-      continue;
-    }
-
     if (line == "end_header") {
+      has_end_header = true;
       break;
     }
 
-    if (line.size() >= 6 && line.substr(0, 6) == "format") {
-      if (line == "format ascii 1.0") {
-        is_binary = false;
-      } else if (line == "format binary_little_endian 1.0") {
-        is_binary = true;
-        is_little_endian = true;
-      } else if (line == "format binary_big_endian 1.0") {
-        is_binary = true;
-        is_little_endian = false;
-      }
-    }
-
     const std::vector<std::string> line_elems = StringSplit(line, " ");
-
-    if (line_elems.size() >= 3 && line_elems[0] == "element") {
-      in_vertex_section = false;
-      if (line_elems[1] == "vertex") {
-        num_vertices = std::stoll(line_elems[2]);
-        in_vertex_section = true;
-      } else if (std::stoll(line_elems[2]) > 0) {
-        LOG(WARNING) << "Only vertex elements supported; ignoring "
-                     << line_elems[1];
-      }
-    }
-
-    if (!in_vertex_section) {
-      continue;
-    }
-
-    // Show diffuse, ambient, specular colors as regular colors.
-
-    if (line_elems.size() >= 3 && line_elems[0] == "property") {
-      THROW_CHECK(line_elems[1] == "float" || line_elems[1] == "float32" ||
-                  line_elems[1] == "double" || line_elems[1] == "float64" ||
-                  line_elems[1] == "uchar")
-          << "PLY import only supports float, double, and uchar data types";
-
-      if (line == "property float x" || line == "property float32 x" ||
-          line == "property double x" || line == "property float64 x") {
-        X_index = index;
-        X_byte_pos = num_bytes_per_line;
-        X_double = (line_elems[1] == "double" || line_elems[1] == "float64");
-      } else if (line == "property float y" || line == "property float32 y" ||
-                 line == "property double y" || line == "property float64 y") {
-        Y_index = index;
-        Y_byte_pos = num_bytes_per_line;
-        Y_double = (line_elems[1] == "double" || line_elems[1] == "float64");
-      } else if (line == "property float z" || line == "property float32 z" ||
-                 line == "property double z" || line == "property float64 z") {
-        Z_index = index;
-        Z_byte_pos = num_bytes_per_line;
-        Z_double = (line_elems[1] == "double" || line_elems[1] == "float64");
-      } else if (line == "property float nx" || line == "property float32 nx" ||
-                 line == "property double nx" ||
-                 line == "property float64 nx") {
-        NX_index = index;
-        NX_byte_pos = num_bytes_per_line;
-        NX_double = (line_elems[1] == "double" || line_elems[1] == "float64");
-      } else if (line == "property float ny" || line == "property float32 ny" ||
-                 line == "property double ny" ||
-                 line == "property float64 ny") {
-        NY_index = index;
-        NY_byte_pos = num_bytes_per_line;
-        NY_double = (line_elems[1] == "double" || line_elems[1] == "float64");
-      } else if (line == "property float nz" || line == "property float32 nz" ||
-                 line == "property double nz" ||
-                 line == "property float64 nz") {
-        NZ_index = index;
-        NZ_byte_pos = num_bytes_per_line;
-        NZ_double = (line_elems[1] == "double" || line_elems[1] == "float64");
-      } else if (line == "property uchar r" || line == "property uchar red" ||
-                 line == "property uchar diffuse_red" ||
-                 line == "property uchar ambient_red" ||
-                 line == "property uchar specular_red") {
-        R_index = index;
-        R_byte_pos = num_bytes_per_line;
-      } else if (line == "property uchar g" || line == "property uchar green" ||
-                 line == "property uchar diffuse_green" ||
-                 line == "property uchar ambient_green" ||
-                 line == "property uchar specular_green") {
-        G_index = index;
-        G_byte_pos = num_bytes_per_line;
-      } else if (line == "property uchar b" || line == "property uchar blue" ||
-                 line == "property uchar diffuse_blue" ||
-                 line == "property uchar ambient_blue" ||
-                 line == "property uchar specular_blue") {
-        B_index = index;
-        B_byte_pos = num_bytes_per_line;
+    if (line_elems.size() >= 2 && line_elems[0] == "format") {
+      if (line_elems[1] == "ascii") {
+        header.is_binary = false;
+      } else if (line_elems[1] == "binary_little_endian") {
+        header.is_binary = true;
+        header.is_little_endian = true;
+      } else if (line_elems[1] == "binary_big_endian") {
+        header.is_binary = true;
+        header.is_little_endian = false;
+      } else {
+        LOG(FATAL_THROW) << "Invalid PLY format: " << line_elems[1];
       }
-
-      index += 1;
-      if (line_elems[1] == "float" || line_elems[1] == "float32") {
-        num_bytes_per_line += 4;
-      } else if (line_elems[1] == "double" || line_elems[1] == "float64") {
-        num_bytes_per_line += 8;
-      } else if (line_elems[1] == "uchar") {
-        num_bytes_per_line += 1;
+    } else if (line_elems.size() >= 3 && line_elems[0] == "element") {
+      PlyElement element;
+      element.name = line_elems[1];
+      element.num_values = std::stoull(line_elems[2]);
+      header.elements.push_back(element);
+    } else if (line_elems.size() >= 3 && line_elems[0] == "property") {
+      THROW_CHECK(!header.elements.empty())
+          << "Invalid PLY file format: property without element";
+      PlyProperty property;
+      if (line_elems[1] == "list") {
+        THROW_CHECK_GE(line_elems.size(), 5);
+        property.list_size_type = line_elems[2];
+        property.type = line_elems[3];
+        property.name = line_elems[4];
       } else {
-        LOG(FATAL_THROW) << "Invalid data type: " << line_elems[1];
+        property.type = line_elems[1];
+        property.name = line_elems[2];
       }
+      header.elements.back().properties.push_back(property);
     }
   }
+  THROW_CHECK(has_end_header) << "Invalid PLY file format: no end_header";
+  return header;
+}
 
-  const bool is_normal_missing =
-      (NX_index == -1) || (NY_index == -1) || (NZ_index == -1);
-  const bool is_rgb_missing =
-      (R_index == -1) || (G_index == -1) || (B_index == -1);
-
-  THROW_CHECK(X_index != -1 && Y_index != -1 && Z_index != -1)
-      << "Invalid PLY file format: x, y, z properties missing";
-
-  points.reserve(num_vertices);
-
-  if (is_binary) {
-    std::vector<char> buffer(num_bytes_per_line);
-    for (size_t i = 0; i < num_vertices; ++i) {
-      file.read(buffer.data(), num_bytes_per_line);
-
-      PlyPoint point;
-
-      if (is_little_endian) {
-        point.x = LittleEndianToNative(
-            X_double ? *reinterpret_cast<double*>(&buffer[X_byte_pos])
-                     : *reinterpret_cast<float*>(&buffer[X_byte_pos]));
-        point.y = LittleEndianToNative(
-            Y_double ? *reinterpret_cast<double*>(&buffer[Y_byte_pos])
-                     : *reinterpret_cast<float*>(&buffer[Y_byte_pos]));
-        point.z = LittleEndianToNative(
-            Z_double ? *reinterpret_cast<double*>(&buffer[Z_byte_pos])
-                     : *reinterpret_cast<float*>(&buffer[Z_byte_pos]));
-
-        if (!is_normal_missing) {
-          point.nx = LittleEndianToNative(
-              NX_double ? *reinterpret_cast<double*>(&buffer[NX_byte_pos])
-                        : *reinterpret_cast<float*>(&buffer[NX_byte_pos]));
-          point.ny = LittleEndianToNative(
-              NY_double ? *reinterpret_cast<double*>(&buffer[NY_byte_pos])
-                        : *reinterpret_cast<float*>(&buffer[NY_byte_pos]));
-          point.nz = LittleEndianToNative(
-              NZ_double ? *reinterpret_cast<double*>(&buffer[NZ_byte_pos])
-                        : *reinterpret_cast<float*>(&buffer[NZ_byte_pos]));
-        }
-
-        if (!is_rgb_missing) {
-          point.r = LittleEndianToNative(
-              *reinterpret_cast<uint8_t*>(&buffer[R_byte_pos]));
-          point.g = LittleEndianToNative(
-              *reinterpret_cast<uint8_t*>(&buffer[G_byte_pos]));
-          point.b = LittleEndianToNative(
-              *reinterpret_cast<uint8_t*>(&buffer[B_byte_pos]));
-        }
-      } else {
-        point.x = BigEndianToNative(
-            X_double ? *reinterpret_cast<double*>(&buffer[X_byte_pos])
-                     : *reinterpret_cast<float*>(&buffer[X_byte_pos]));
-        point.y = BigEndianToNative(
-            Y_double ? *reinterpret_cast<double*>(&buffer[Y_byte_pos])
-                     : *reinterpret_cast<float*>(&buffer[Y_byte_pos]));
-        point.z = BigEndianToNative(
-            Z_double ? *reinterpret_cast<double*>(&buffer[Z_byte_pos])
-                     : *reinterpret_cast<float*>(&buffer[Z_byte_pos]));
-
-        if (!is_normal_missing) {
-          point.nx = BigEndianToNative(
-              NX_double ? *reinterpret_cast<double*>(&buffer[NX_byte_pos])
-                        : *reinterpret_cast<float*>(&buffer[NX_byte_pos]));
-          point.ny = BigEndianToNative(
-              NY_double ? *reinterpret_cast<double*>(&buffer[NY_byte_pos])
-                        : *reinterpret_cast<float*>(&buffer[NY_byte_pos]));
-          point.nz = BigEndianToNative(
-              NZ_double ? *reinterpret_cast<double*>(&buffer[NZ_byte_pos])
-                        : *reinterpret_cast<float*>(&buffer[NZ_byte_pos]));
-        }
+template <typename T>
+double DecodeBinaryPlyValue(const char* data, const bool is_little_endian) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return is_little_endian ? LittleEndianToNative(value)
+                          : BigEndianToNative(value);
+}
 
-        if (!is_rgb_missing) {
-          point.r = BigEndianToNative(
-              *reinterpret_cast<uint8_t*>(&buffer[R_byte_pos]));
-          point.g = BigEndianToNative(
-              *reinterpret_cast<uint8_t*>(&buffer[G_byte_pos]));
-          point.b = BigEndianToNative(
-              *reinterpret_cast<uint8_t*>(&buffer[B_byte_pos]));
-        }
-      }
+// Get the number of bytes and the decoding function of a PLY data type.
+std::pair<size_t, double (*)(const char*, bool)> GetPlyTypeDecoder(
+    const std::string& type) {
+  if (type == "char" || type == "int8") {
+    return {1, &DecodeBinaryPlyValue<int8_t>};
+  } else if (type == "uchar" || type == "uint8") {
+    return {1, &DecodeBinaryPlyValue<uint8_t>};
+  } else if (type == "short" || type == "int16") {
+    return {2, &DecodeBinaryPlyValue<int16_t>};
+  } else if (type == "ushort" || type == "uint16") {
+    return {2, &DecodeBinaryPlyValue<uint16_t>};
+  } else if (type == "int" || type == "int32") {
+    return {4, &DecodeBinaryPlyValue<int32_t>};
+  } else if (type == "uint" || type == "uint32") {
+    return {4, &DecodeBinaryPlyValue<uint32_t>};
+  } else if (type == "float" || type == "float32") {
+    return {4, &DecodeBinaryPlyValue<float>};
+  } else if (type == "double" || type == "float64") {
+    return {8, &DecodeBinaryPlyValue<double>};
+  }
+  LOG(FATAL_THROW) << "Invalid data type: " << type;
+  return {0, nullptr};
+}
 
-      points.push_back(point);
-    }
-  } else {
-    while (std::getline(file, line)) {
-      StringTrim(&line);
-      std::stringstream line_stream(line);
-
-      std::string item;
-      std::vector<std::string> items;
-      while (!line_stream.eof()) {
-        std::getline(line_stream, item, ' ');
-        StringTrim(&item);
-        items.push_back(item);
-      }
+// Minimum number of elements to run ParallelForRanges in parallel.
+constexpr size_t kMinNumParallelElems = 1024;
+
+// Run the function on consecutive ranges of [0, num_elems) in parallel or
+// serially without a thread pool. Exceptions thrown by the function are
+// rethrown in the calling thread.
+template <typename Func>
+void ParallelForRanges(ThreadPool* thread_pool,
+                       const size_t num_elems,
+                       const Func& func) {
+  if (thread_pool == nullptr || thread_pool->NumThreads() == 1 ||
+      num_elems < kMinNumParallelElems) {
+    func(0, num_elems);
+    return;
+  }
+  const size_t num_ranges = thread_pool->NumThreads();
+  std::vector<std::future<void>> futures;
+  futures.reserve(num_ranges);
+  for (size_t range_idx = 0; range_idx < num_ranges; ++range_idx) {
+    const size_t begin = range_idx * num_elems / num_ranges;
+    const size_t end = (range_idx + 1) * num_elems / num_ranges;
+    futures.push_back(
+        thread_pool->AddTask([&func, begin, end]() { func(begin, end); }));
+  }
+  // Wait for all ranges before rethrowing, as they reference the function.
+  for (auto& future : futures) {
+    future.wait();
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+}
 
-      PlyPoint point;
+// Fixed width of the number of points in the PLY header of the incremental
+// writer, which is only known after all points were written. The number is
+// padded with trailing spaces, which PLY readers ignore as whitespace.
+constexpr int kPlyNumPointsWidth = 20;
 
-      point.x = std::stold(items.at(X_index));
-      point.y = std::stold(items.at(Y_index));
-      point.z = std::stold(items.at(Z_index));
+}  // namespace
 
-      if (!is_normal_missing) {
-        point.nx = std::stold(items.at(NX_index));
-        point.ny = std::stold(items.at(NY_index));
-        point.nz = std::stold(items.at(NZ_index));
-      }
+std::vector<PlyPoint> ReadPly(const std::string& path) {
+  PlyPointsReader reader(path);
 
-      if (!is_rgb_missing) {
-        point.r = std::stoi(items.at(R_index));
-        point.g = std::stoi(items.at(G_index));
-        point.b = std::stoi(items.at(B_index));
-      }
+  std::vector<PlyPoint> points;
+  points.reserve(reader.NumPoints());
 
-      points.push_back(point);
-    }
+  const size_t kChunkSize = 1 << 20;
+  std::vector<PlyPoint> chunk;
+  while (reader.Read(kChunkSize, &chunk)) {
+    points.insert(points.end(), chunk.begin(), chunk.end());
   }
 
   return points;
 }
-
 void WriteTextPlyPoints(const std::string& path,
                         const std::vector<PlyPoint>& points,
                         const bool write_normal,
@@ -422,7 +344,471 @@ void WriteBinaryPlyPoints(const std::string& path,
   binary_file.close();
 }
 
-void WriteTextPlyMesh(const std::string& path, const PlyMesh& mesh) {
+PlyPointsReader::PlyPointsReader(const std::string& path, const int num_threads)
+    : path_(path), num_threads_(GetEffectiveNumThreads(num_threads)) {
+  std::ifstream header_file(path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(header_file, path);
+  const PlyHeader header = ReadPlyHeader(&header_file);
+  data_begin_ = header_file.tellg();
+  header_file.close();
+
+  is_binary_ = header.is_binary;
+  is_little_endian_ = header.is_little_endian;
+
+  file_ = MappedFile(path);
+  data_pos_ = data_begin_;
+
+  // Skip the elements before the vertex element.
+  const PlyElement* vertex_element = nullptr;
+  for (const auto& element : header.elements) {
+    if (element.name == "vertex") {
+      vertex_element = &element;
+      break;
+    }
+    if (element.num_values == 0) {
+      continue;
+    }
+    LOG(WARNING) << "Only vertex elements supported; ignoring "
+                 << element.name;
+    if (is_binary_) {
+      size_t num_bytes_per_value = 0;
+      for (const auto& property : element.properties) {
+        THROW_CHECK(property.list_size_type.empty())
+            << "List properties before vertex element not supported";
+        num_bytes_per_value += GetPlyTypeDecoder(property.type).first;
+      }
+      data_pos_ += element.num_values * num_bytes_per_value;
+    } else {
+      for (size_t i = 0; i < element.num_values; ++i) {
+        const void* line_end = std::memchr(file_.Data() + data_pos_,
+                                           '\n',
+                                           file_.NumBytes() - data_pos_);
+        THROW_CHECK_NOTNULL(line_end);
+        data_pos_ = static_cast<const char*>(line_end) - file_.Data() + 1;
+      }
+    }
+  }
+  THROW_CHECK_NOTNULL(vertex_element);
+  data_begin_ = data_pos_;
+
+  // Show diffuse, ambient, specular colors as regular colors.
+  const std::array<std::vector<std::string>, 9> property_names = {{
+      {"x"},
+      {"y"},
+      {"z"},
+      {"nx"},
+      {"ny"},
+      {"nz"},
+      {"r", "red", "diffuse_red", "ambient_red", "specular_red"},
+      {"g", "green", "diffuse_green", "ambient_green", "specular_green"},
+      {"b", "blue", "diffuse_blue", "ambient_blue", "specular_blue"},
+  }};
+
+  num_points_ = vertex_element->num_values;
+  num_properties_ = vertex_element->properties.size();
+  for (size_t i = 0; i < num_properties_; ++i) {
+    const auto& property = vertex_element->properties[i];
+    THROW_CHECK(property.list_size_type.empty())
+        << "List properties in vertex element not supported";
+    const auto [num_bytes, decode] = GetPlyTypeDecoder(property.type);
+    for (size_t j = 0; j < property_names.size(); ++j) {
+      if (std::find(property_names[j].begin(),
+                    property_names[j].end(),
+                    property.name) != property_names[j].end()) {
+        properties_[j].index = i;
+        properties_[j].offset = num_bytes_per_point_;
+        properties_[j].decode = decode;
+      }
+    }
+    num_bytes_per_point_ += num_bytes;
+  }
+
+  THROW_CHECK(properties_[0].index != -1 && properties_[1].index != -1 &&
+              properties_[2].index != -1)
+      << "Invalid PLY file format: x, y, z properties missing";
+
+  if (is_binary_) {
+    THROW_CHECK_LE(data_begin_ + num_points_ * num_bytes_per_point_,
+                   file_.NumBytes())
+        << "Truncated PLY file " << path;
+  }
+}
+
+PlyPointsReader::~PlyPointsReader() = default;
+
+size_t PlyPointsReader::NumPoints() const { return num_points_; }
+
+bool PlyPointsReader::HasNormal() const {
+  return properties_[3].index != -1 && properties_[4].index != -1 &&
+         properties_[5].index != -1;
+}
+
+bool PlyPointsReader::HasRGB() const {
+  return properties_[6].index != -1 && properties_[7].index != -1 &&
+         properties_[8].index != -1;
+}
+
+bool PlyPointsReader::Read(const size_t max_num_points,
+                           std::vector<PlyPoint>* points) {
+  THROW_CHECK_GT(max_num_points, 0);
+  THROW_CHECK_NOTNULL(points);
+
+  const size_t num_points =
+      std::min(max_num_points, num_points_ - num_read_points_);
+  points->clear();
+  if (num_points == 0) {
+    return false;
+  }
+
+  points->resize(num_points);
+
+  if (is_binary_) {
+    const char* data = file_.Data() + data_pos_;
+    ParallelForRanges(GetThreadPool(num_points),
+                      num_points,
+                      [&](const size_t begin, const size_t end) {
+                        DecodeBinaryPoints(data + begin * num_bytes_per_point_,
+                                           end - begin,
+                                           points->data() + begin);
+                      });
+    data_pos_ += num_points * num_bytes_per_point_;
+  } else {
+    // Find the non-empty lines serially and parse them in parallel.
+    std::vector<const char*> line_begins;
+    std::vector<const char*> line_ends;
+    line_begins.reserve(num_points);
+    line_ends.reserve(num_points);
+    const char* data_end = file_.Data() + file_.NumBytes();
+    const char* line_begin = file_.Data() + data_pos_;
+    while (line_begins.size() < num_points && line_begin < data_end) {
+      const char* line_end = static_cast<const char*>(
+          std::memchr(line_begin, '\n', data_end - line_begin));
+      if (line_end == nullptr) {
+        line_end = data_end;
+      }
+      if (std::any_of(line_begin, line_end, [](const char c) {
+            return !std::isspace(static_cast<unsigned char>(c));
+          })) {
+        line_begins.push_back(line_begin);
+        line_ends.push_back(line_end);
+      }
+      line_begin = std::min(line_end + 1, data_end);
+    }
+    THROW_CHECK_EQ(line_begins.size(), num_points)
+        << "Truncated PLY file " << path_;
+    data_pos_ = line_begin - file_.Data();
+
+    ParallelForRanges(
+        GetThreadPool(num_points),
+        num_points,
+        [&](const size_t begin, const size_t end) {
+          ParseTextPoints(
+              {line_begins.begin() + begin, line_begins.begin() + end},
+              {line_ends.begin() + begin, line_ends.begin() + end},
+              points->data() + begin);
+        });
+  }
+
+  num_read_points_ += num_points;
+
+  return true;
+}
+
+void PlyPointsReader::Reset() {
+  data_pos_ = data_begin_;
+  num_read_points_ = 0;
+}
+
+ThreadPool* PlyPointsReader::GetThreadPool(const size_t num_points) {
+  // The threads are only started once a chunk is large enough to be processed
+  // in parallel, so that reading small files does not spawn a thread pool.
+  if (!thread_pool_ && num_threads_ > 1 &&
+      num_points >= kMinNumParallelElems) {
+    thread_pool_ = std::make_unique<ThreadPool>(num_threads_);
+  }
+  return thread_pool_.get();
+}
+
+void PlyPointsReader::DecodeBinaryPoints(const char* data,
+                                         const size_t num_points,
+                                         PlyPoint* points) const {
+  const bool has_normal = HasNormal();
+  const bool has_rgb = HasRGB();
+  auto Decode = [this](const char* point_data, const int property_idx) {
+    const Property& property = properties_[property_idx];
+    return property.decode(point_data + property.offset, is_little_endian_);
+  };
+  for (size_t i = 0; i < num_points; ++i) {
+    const char* point_data = data + i * num_bytes_per_point_;
+    PlyPoint& point = points[i];
+    point.x = Decode(point_data, 0);
+    point.y = Decode(point_data, 1);
+    point.z = Decode(point_data, 2);
+    if (has_normal) {
+      point.nx = Decode(point_data, 3);
+      point.ny = Decode(point_data, 4);
+      point.nz = Decode(point_data, 5);
+    }
+    if (has_rgb) {
+      point.r = static_cast<uint8_t>(Decode(point_data, 6));
+      point.g = static_cast<uint8_t>(Decode(point_data, 7));
+      point.b = static_cast<uint8_t>(Decode(point_data, 8));
+    }
+  }
+}
+
+void PlyPointsReader::ParseTextPoints(
+    const std::vector<const char*>& line_begins,
+    const std::vector<const char*>& line_ends,
+    PlyPoint* points) const {
+  const bool has_normal = HasNormal();
+  const bool has_rgb = HasRGB();
+  std::string line;
+  std::vector<double> values(num_properties_);
+  for (size_t i = 0; i < line_begins.size(); ++i) {
+    line.assign(line_begins[i], line_ends[i]);
+    const char* value_begin = line.c_str();
+    for (size_t j = 0; j < num_properties_; ++j) {
+      char* value_end = nullptr;
+      values[j] = std::strtod(value_begin, &value_end);
+      THROW_CHECK_NE(value_begin, value_end)
+          << "Invalid PLY vertex in " << path_ << ": " << line;
+      value_begin = value_end;
+    }
+
+    PlyPoint& point = points[i];
+    point.x = values[properties_[0].index];
+    point.y = values[properties_[1].index];
+    point.z = values[properties_[2].index];
+    if (has_normal) {
+      point.nx = values[properties_[3].index];
+      point.ny = values[properties_[4].index];
+      point.nz = values[properties_[5].index];
+    }
+    if (has_rgb) {
+      point.r = static_cast<uint8_t>(values[properties_[6].index]);
+      point.g = static_cast<uint8_t>(values[properties_[7].index]);
+      point.b = static_cast<uint8_t>(values[properties_[8].index]);
+    }
+  }
+}
+
+PlyPointsWriter::PlyPointsWriter(const std::string& path,
+                                 const bool binary,
+                                 const bool write_normal,
+                                 const bool write_rgb)
+    : path_(path),
+      binary_(binary),
+      write_normal_(write_normal),
+      write_rgb_(write_rgb) {
+  file_.open(path_, std::ios::out | std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file_, path_);
+
+  file_ << "ply\n";
+  if (binary_) {
+    file_ << "format binary_little_endian 1.0\n";
+  } else {
+    file_ << "format ascii 1.0\n";
+  }
+  file_ << "element vertex ";
+  num_points_pos_ = file_.tellp();
+  file_ << std::string(kPlyNumPointsWidth, ' ') << '\n';
+
+  file_ << "property float x\n";
+  file_ << "property float y\n";
+  file_ << "property float z\n";
+
+  if (write_normal_) {
+    file_ << "property float nx\n";
+    file_ << "property float ny\n";
+    file_ << "property float nz\n";
+  }
+
+  if (write_rgb_) {
+    file_ << "property uchar red\n";
+    file_ << "property uchar green\n";
+    file_ << "property uchar blue\n";
+  }
+
+  file_ << "end_header\n";
+}
+
+PlyPointsWriter::~PlyPointsWriter() {
+  // Errors are only reported when the writer is closed explicitly, as
+  // destructors must not throw.
+  try {
+    Close();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << e.what();
+  }
+}
+
+void PlyPointsWriter::Write(const std::vector<PlyPoint>& points) {
+  THROW_CHECK(file_.is_open());
+
+  if (!binary_) {
+    for (const auto& point : points) {
+      file_ << point.x << " " << point.y << " " << point.z;
+      if (write_normal_) {
+        file_ << " " << point.nx << " " << point.ny << " " << point.nz;
+      }
+      if (write_rgb_) {
+        file_ << " " << static_cast<int>(point.r) << " "
+              << static_cast<int>(point.g) << " " << static_cast<int>(point.b);
+      }
+      file_ << '\n';
+    }
+    THROW_CHECK(file_.good()) << "Failed to write PLY file " << path_;
+    num_points_ += points.size();
+    return;
+  }
+
+  // Encode the points into a buffer to write them at once.
+  const size_t num_bytes_per_point =
+      3 * sizeof(float) + (write_normal_ ? 3 * sizeof(float) : 0) +
+      (write_rgb_ ? 3 * sizeof(uint8_t) : 0);
+  buffer_.resize(points.size() * num_bytes_per_point);
+  char* data = buffer_.data();
+  auto Encode = [&data](const auto value) {
+    const auto value_little_endian = NativeToLittleEndian(value);
+    std::memcpy(data, &value_little_endian, sizeof(value));
+    data += sizeof(value);
+  };
+  for (const auto& point : points) {
+    Encode(point.x);
+    Encode(point.y);
+    Encode(point.z);
+    if (write_normal_) {
+      Encode(point.nx);
+      Encode(point.ny);
+      Encode(point.nz);
+    }
+    if (write_rgb_) {
+      Encode(point.r);
+      Encode(point.g);
+      Encode(point.b);
+    }
+  }
+  file_.write(buffer_.data(), buffer_.size());
+  THROW_CHECK(file_.good()) << "Failed to write PLY file " << path_;
+
+  num_points_ += points.size();
+}
+
+void PlyPointsWriter::Close() {
+  if (!file_.is_open()) {
+    return;
+  }
+
+  file_.seekp(num_points_pos_);
+  file_ << std::left << std::setw(kPlyNumPointsWidth) << num_points_;
+  const bool good = file_.good();
+  file_.close();
+  THROW_CHECK(good && !file_.fail()) << "Failed to write PLY file " << path_;
+}
+
+size_t PlyPointsWriter::NumPoints() const { return num_points_; }
+
+PlyMesh ReadPlyMesh(const std::string& path, bool* has_rgb) {
+  std::ifstream file(path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, path);
+
+  const PlyHeader header = ReadPlyHeader(&file);
+  const bool is_binary = header.is_binary;
+  const bool is_little_endian = header.is_little_endian;
+  const std::vector<PlyElement>& elements = header.elements;
+
+  auto IsAnyOf = [](const std::string& name,
+                    const std::vector<std::string>& names) {
+    return std::find(names.begin(), names.end(), name) != names.end();
+  };
+
+  PlyMesh mesh;
+  bool has_vertex_xyz = false;
+  bool has_vertex_rgb = false;
+  std::vector<size_t> polygon;
+
+  for (const auto& element : elements) {
+    if (element.name == "vertex") {
+      has_vertex_xyz = true;
+      for (const char* name : {"x", "y", "z"}) {
+        has_vertex_xyz =
+            has_vertex_xyz &&
+            std::any_of(element.properties.begin(),
+                        element.properties.end(),
+                        [&](const PlyProperty& p) { return p.name == name; });
+      }
+      THROW_CHECK(has_vertex_xyz)
+          << "Invalid PLY file format: x, y, z properties missing";
+      mesh.vertices.resize(element.num_values);
+    } else if (element.name == "face") {
+      mesh.faces.reserve(element.num_values);
+    }
+
+    for (size_t i = 0; i < element.num_values; ++i) {
+      for (const auto& property : element.properties) {
+        if (!property.list_size_type.empty()) {
+          const size_t list_size = ReadPlyValue(
+              &file, property.list_size_type, is_binary, is_little_endian);
+          const bool is_face_indices =
+              element.name == "face" &&
+              IsAnyOf(property.name, {"vertex_indices", "vertex_index"});
+          polygon.clear();
+          for (size_t j = 0; j < list_size; ++j) {
+            const double value =
+                ReadPlyValue(&file, property.type, is_binary, is_little_endian);
+            if (is_face_indices) {
+              polygon.push_back(static_cast<size_t>(value));
+            }
+          }
+          for (size_t j = 2; j < polygon.size(); ++j) {
+            mesh.faces.emplace_back(polygon[0], polygon[j - 1], polygon[j]);
+          }
+          continue;
+        }
+
+        const double value =
+            ReadPlyValue(&file, property.type, is_binary, is_little_endian);
+        if (element.name != "vertex") {
+          continue;
+        }
+        PlyMeshVertex& vertex = mesh.vertices[i];
+        if (property.name == "x") {
+          vertex.x = value;
+        } else if (property.name == "y") {
+          vertex.y = value;
+        } else if (property.name == "z") {
+          vertex.z = value;
+        } else if (IsAnyOf(property.name, {"r", "red", "diffuse_red"})) {
+          vertex.r = static_cast<uint8_t>(value);
+          has_vertex_rgb = true;
+        } else if (IsAnyOf(property.name, {"g", "green", "diffuse_green"})) {
+          vertex.g = static_cast<uint8_t>(value);
+        } else if (IsAnyOf(property.name, {"b", "blue", "diffuse_blue"})) {
+          vertex.b = static_cast<uint8_t>(value);
+        }
+      }
+      THROW_CHECK(file) << "Truncated PLY file " << path;
+    }
+  }
+
+  THROW_CHECK(has_vertex_xyz) << "Invalid PLY file format: no vertex element";
+  for (const auto& face : mesh.faces) {
+    THROW_CHECK_LT(face.vertex_idx1, mesh.vertices.size());
+    THROW_CHECK_LT(face.vertex_idx2, mesh.vertices.size());
+    THROW_CHECK_LT(face.vertex_idx3, mesh.vertices.size());
+  }
+
+  if (has_rgb != nullptr) {
+    *has_rgb = has_vertex_rgb;
+  }
+
+  return mesh;
+}
+
+void WriteTextPlyMesh(const std::string& path,
+                      const PlyMesh& mesh,
+                      const bool write_rgb) {
   std::fstream file(path, std::ios::out);
   THROW_CHECK_FILE_OPEN(file, path);
 
@@ -432,12 +818,22 @@ void WriteTextPlyMesh(const std::string& path, const PlyMesh& mesh) {
   file << "property float x\n";
   file << "property float y\n";
   file << "property float z\n";
+  if (write_rgb) {
+    file << "property uchar red\n";
+    file << "property uchar green\n";
+    file << "property uchar blue\n";
+  }
   file << "element face " << mesh.faces.size() << '\n';
   file << "property list uchar int vertex_index\n";
   file << "end_header\n";
 
   for (const auto& vertex : mesh.vertices) {
-    file << vertex.x << " " << vertex.y << " " << vertex.z << '\n';
+    file << vertex.x << " " << vertex.y << " " << vertex.z;
+    if (write_rgb) {
+      file << " " << static_cast<int>(vertex.r) << " "
+           << static_cast<int>(vertex.g) << " " << static_cast<int>(vertex.b);
+    }
+    file << '\n';
   }
 
   for (const auto& face : mesh.faces) {
@@ -446,7 +842,9 @@ void WriteTextPlyMesh(const std::string& path, const PlyMesh& mesh) {
   }
 }
 
-void WriteBinaryPlyMesh(const std::string& path, const PlyMesh& mesh) {
+void WriteBinaryPlyMesh(const std::string& path,
+                        const PlyMesh& mesh,
+                        const bool write_rgb) {
   std::fstream text_file(path, std::ios::out);
   THROW_CHECK_FILE_OPEN(text_file, path);
 
@@ -456,6 +854,11 @@ void WriteBinaryPlyMesh(const std::string& path, const PlyMesh& mesh) {
   text_file << "property float x\n";
   text_file << "property float y\n";
   text_file << "property float z\n";
+  if (write_rgb) {
+    text_file << "property uchar red\n";
+    text_file << "property uchar green\n";
+    text_file << "property uchar blue\n";
+  }
   text_file << "element face " << mesh.faces.size() << '\n';
   text_file << "property list uchar int vertex_index\n";
   text_file << "end_header\n";
@@ -469,6 +872,11 @@ void WriteBinaryPlyMesh(const std::string& path, const PlyMesh& mesh) {
     WriteBinaryLittleEndian<float>(&binary_file, vertex.x);
     WriteBinaryLittleEndian<float>(&binary_file, vertex.y);
     WriteBinaryLittleEndian<float>(&binary_file, vertex.z);
+    if (write_rgb) {
+      WriteBinaryLittleEndian<uint8_t>(&binary_file, vertex.r);
+      WriteBinaryLittleEndian<uint8_t>(&binary_file, vertex.g);
+      WriteBinaryLittleEndian<uint8_t>(&binary_file, vertex.b);
+    }
   }
 
   for (const auto& face : mesh.faces) {
@@ -29,12 +29,19 @@
 
 #pragma once
 
+#include "colmap/util/file.h"
+
+#include <array>
 #include <cstdint>
+#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace colmap {
 
+class ThreadPool;
+
 struct PlyPoint {
   float x = 0.0f;
   float y = 0.0f;
@@ -55,6 +62,9 @@ struct PlyMeshVertex {
   float x = 0.0f;
   float y = 0.0f;
   float z = 0.0f;
+  uint8_t r = 0;
+  uint8_t g = 0;
+  uint8_t b = 0;
 };
 
 struct PlyMeshFace {
@@ -89,8 +99,104 @@ void WriteBinaryPlyPoints(const std::string& path,
                           bool write_normal = true,
                           bool write_rgb = true);
 
+// Read PLY point cloud from text or binary file in chunks of points, so that
+// point clouds larger than the available memory can be processed. The file is
+// memory mapped and the points of a chunk are decoded or, for text files,
+// parsed in parallel. Elements before the vertex element must not contain
+// list properties in binary files and elements after it are ignored.
+class PlyPointsReader {
+ public:
+  explicit PlyPointsReader(const std::string& path, int num_threads = -1);
+  ~PlyPointsReader();
+
+  size_t NumPoints() const;
+  bool HasNormal() const;
+  bool HasRGB() const;
+
+  // Read the next chunk of at most the given number of points. Returns false
+  // and clears the points if all points were read.
+  bool Read(size_t max_num_points, std::vector<PlyPoint>* points);
+
+  // Restart reading from the first point.
+  void Reset();
+
+ private:
+  using DecodeFunc = double (*)(const char* data, bool is_little_endian);
+
+  // Location of the x, y, z, nx, ny, nz, r, g, b properties in a vertex.
+  struct Property {
+    // Index of the property in the vertex element or -1 if missing.
+    int index = -1;
+    // Byte offset of the property in a binary vertex.
+    size_t offset = 0;
+    DecodeFunc decode = nullptr;
+  };
+
+  // Get the thread pool to process a chunk of the given number of points,
+  // which is created on first use, or null if processed serially.
+  ThreadPool* GetThreadPool(size_t num_points);
+
+  void DecodeBinaryPoints(const char* data,
+                          size_t num_points,
+                          PlyPoint* points) const;
+  void ParseTextPoints(const std::vector<const char*>& line_begins,
+                       const std::vector<const char*>& line_ends,
+                       PlyPoint* points) const;
+
+  std::string path_;
+  MappedFile file_;
+  int num_threads_ = 1;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  bool is_binary_ = false;
+  bool is_little_endian_ = false;
+  size_t num_points_ = 0;
+  size_t num_properties_ = 0;
+  size_t num_bytes_per_point_ = 0;
+  std::array<Property, 9> properties_;
+  size_t data_begin_ = 0;
+  size_t data_pos_ = 0;
+  size_t num_read_points_ = 0;
+};
+
+// Write PLY point cloud incrementally to text or binary file, so that the
+// points do not need to be held in memory at once. The number of points in
+// the header is only known and written when the writer is closed, which
+// throws if the file could not be written.
+class PlyPointsWriter {
+ public:
+  explicit PlyPointsWriter(const std::string& path,
+                           bool binary = true,
+                           bool write_normal = true,
+                           bool write_rgb = true);
+  ~PlyPointsWriter();
+
+  void Write(const std::vector<PlyPoint>& points);
+
+  void Close();
+
+  size_t NumPoints() const;
+
+ private:
+  std::string path_;
+  bool binary_;
+  bool write_normal_;
+  bool write_rgb_;
+  std::fstream file_;
+  std::streampos num_points_pos_;
+  size_t num_points_ = 0;
+  std::vector<char> buffer_;
+};
+
+// Read PLY mesh from text or binary file. Polygonal faces are triangulated as
+// fans and vertex colors are read if present, which is indicated by has_rgb.
+PlyMesh ReadPlyMesh(const std::string& path, bool* has_rgb = nullptr);
+
 // Write PLY mesh to text or binary file.
-void WriteTextPlyMesh(const std::string& path, const PlyMesh& mesh);
-void WriteBinaryPlyMesh(const std::string& path, const PlyMesh& mesh);
+void WriteTextPlyMesh(const std::string& path,
+                      const PlyMesh& mesh,
+                      bool write_rgb = false);
+void WriteBinaryPlyMesh(const std::string& path,
+                        const PlyMesh& mesh,
+                        bool write_rgb = false);
 
 }  // namespace colmap
@@ -0,0 +1,326 @@
+// Copyright (c), ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/util/ply.h"
+
+#include "colmap/util/endian.h"
+#include "colmap/util/file.h"
+#include "colmap/util/string.h"
+#include "colmap/util/testing.h"
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+std::vector<PlyPoint> CreateTestPoints(const size_t num_points) {
+  std::vector<PlyPoint> points(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    points[i].x = i;
+    points[i].y = 0.5f * i;
+    points[i].z = -0.25f * i;
+    points[i].nx = 1;
+    points[i].ny = 0;
+    points[i].nz = 0;
+    points[i].r = i % 256;
+    points[i].g = (2 * i) % 256;
+    points[i].b = (3 * i) % 256;
+  }
+  return points;
+}
+
+void ExpectEqualPoints(const std::vector<PlyPoint>& points1,
+                       const std::vector<PlyPoint>& points2,
+                       const bool compare_normal,
+                       const bool compare_rgb) {
+  ASSERT_EQ(points1.size(), points2.size());
+  for (size_t i = 0; i < points1.size(); ++i) {
+    EXPECT_EQ(points1[i].x, points2[i].x);
+    EXPECT_EQ(points1[i].y, points2[i].y);
+    EXPECT_EQ(points1[i].z, points2[i].z);
+    if (compare_normal) {
+      EXPECT_EQ(points1[i].nx, points2[i].nx);
+      EXPECT_EQ(points1[i].ny, points2[i].ny);
+      EXPECT_EQ(points1[i].nz, points2[i].nz);
+    }
+    if (compare_rgb) {
+      EXPECT_EQ(points1[i].r, points2[i].r);
+      EXPECT_EQ(points1[i].g, points2[i].g);
+      EXPECT_EQ(points1[i].b, points2[i].b);
+    }
+  }
+}
+
+TEST(PlyPoints, ReadWrite) {
+  const std::string path = JoinPaths(CreateTestDir(), "points.ply");
+  const std::vector<PlyPoint> points = CreateTestPoints(5000);
+
+  WriteBinaryPlyPoints(path, points);
+  ExpectEqualPoints(ReadPly(path), points, true, true);
+
+  WriteTextPlyPoints(path, points, /*write_normal=*/false);
+  ExpectEqualPoints(ReadPly(path), points, false, true);
+}
+
+class ParameterizedPlyPointsTests
+    : public ::testing::TestWithParam<std::tuple<bool, bool, bool, int>> {};
+
+TEST_P(ParameterizedPlyPointsTests, StreamingReadWrite) {
+  const auto [binary, write_normal, write_rgb, num_threads] = GetParam();
+  const std::string path = JoinPaths(CreateTestDir(), "points.ply");
+  const std::vector<PlyPoint> points = CreateTestPoints(5000);
+
+  PlyPointsWriter writer(path, binary, write_normal, write_rgb);
+  const size_t kWriteChunkSize = 1234;
+  for (size_t begin = 0; begin < points.size(); begin += kWriteChunkSize) {
+    const size_t end = std::min(begin + kWriteChunkSize, points.size());
+    writer.Write({points.begin() + begin, points.begin() + end});
+  }
+  EXPECT_EQ(writer.NumPoints(), points.size());
+  writer.Close();
+
+  // The number of points is padded with trailing spaces.
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    while (std::getline(file, line) && !StringStartsWith(line, "element")) {
+    }
+    EXPECT_EQ(line, "element vertex 5000                ");
+  }
+
+  PlyPointsReader reader(path, num_threads);
+  EXPECT_EQ(reader.NumPoints(), points.size());
+  EXPECT_EQ(reader.HasNormal(), write_normal);
+  EXPECT_EQ(reader.HasRGB(), write_rgb);
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<PlyPoint> read_points;
+    std::vector<PlyPoint> chunk;
+    while (reader.Read(2000, &chunk)) {
+      EXPECT_LE(chunk.size(), 2000);
+      read_points.insert(read_points.end(), chunk.begin(), chunk.end());
+    }
+    EXPECT_TRUE(chunk.empty());
+    ExpectEqualPoints(read_points, points, write_normal, write_rgb);
+    reader.Reset();
+  }
+
+  ExpectEqualPoints(ReadPly(path), points, write_normal, write_rgb);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PlyPointsTests,
+    ParameterizedPlyPointsTests,
+    ::testing::Values(std::make_tuple(true, true, true, 1),
+                      std::make_tuple(true, false, true, 3),
+                      std::make_tuple(false, true, true, 3),
+                      std::make_tuple(false, false, false, 1)));
+
+TEST(PlyPointsWriter, WriteFailure) {
+  // Writes to this device always fail, once the buffered data is flushed.
+  const std::string path = "/dev/full";
+  if (!std::ofstream(path)) {
+    GTEST_SKIP() << "Writes cannot be made to fail on this platform";
+  }
+  PlyPointsWriter writer(path);
+  writer.Write(CreateTestPoints(10));
+  EXPECT_ANY_THROW(writer.Close());
+}
+
+TEST(PlyPointsReader, MalformedText) {
+  const std::string path = JoinPaths(CreateTestDir(), "points.ply");
+  const size_t kNumPoints = 5000;
+  {
+    std::ofstream file(path);
+    file << "ply\n";
+    file << "format ascii 1.0\n";
+    file << "element vertex " << kNumPoints << "\n";
+    file << "property float x\n";
+    file << "property float y\n";
+    file << "property float z\n";
+    file << "end_header\n";
+    for (size_t i = 0; i < kNumPoints; ++i) {
+      if (i == kNumPoints - 10) {
+        file << "1 invalid 2\n";
+      } else {
+        file << i << " 0 0\n";
+      }
+    }
+  }
+
+  for (const int num_threads : {1, 4}) {
+    PlyPointsReader reader(path, num_threads);
+    std::vector<PlyPoint> points;
+    EXPECT_ANY_THROW(reader.Read(kNumPoints, &points));
+  }
+  EXPECT_ANY_THROW(ReadPly(path));
+}
+
+template <typename T>
+void WriteBigEndian(std::ostream* stream, const T value) {
+  const T value_big_endian = NativeToBigEndian(value);
+  stream->write(reinterpret_cast<const char*>(&value_big_endian), sizeof(T));
+}
+
+TEST(PlyPointsReader, BigEndianAndExtraElements) {
+  const std::string path = JoinPaths(CreateTestDir(), "points.ply");
+  std::ofstream file(path, std::ios::binary);
+  file << "ply\n";
+  file << "format binary_big_endian 1.0\n";
+  file << "element camera 1\n";
+  file << "property short id\n";
+  file << "element vertex 2\n";
+  file << "property double x\n";
+  file << "property double y\n";
+  file << "property double z\n";
+  file << "property uchar diffuse_red\n";
+  file << "property uchar diffuse_green\n";
+  file << "property uchar diffuse_blue\n";
+  file << "element face 0\n";
+  file << "property list uchar int vertex_indices\n";
+  file << "end_header\n";
+  WriteBigEndian<int16_t>(&file, 7);
+  for (int i = 0; i < 2; ++i) {
+    WriteBigEndian<double>(&file, i + 1);
+    WriteBigEndian<double>(&file, -i);
+    WriteBigEndian<double>(&file, 0.5);
+    WriteBigEndian<uint8_t>(&file, 10 + i);
+    WriteBigEndian<uint8_t>(&file, 20 + i);
+    WriteBigEndian<uint8_t>(&file, 30 + i);
+  }
+  file.close();
+
+  const std::vector<PlyPoint> points = ReadPly(path);
+  ASSERT_EQ(points.size(), 2);
+  EXPECT_EQ(points[1].x, 2);
+  EXPECT_EQ(points[1].y, -1);
+  EXPECT_EQ(points[1].z, 0.5);
+  EXPECT_EQ(points[1].nz, 0);
+  EXPECT_EQ(points[1].r, 11);
+  EXPECT_EQ(points[1].g, 21);
+  EXPECT_EQ(points[1].b, 31);
+}
+
+PlyMesh CreateTestMesh() {
+  PlyMesh mesh;
+  mesh.vertices.emplace_back(0, 0, 0);
+  mesh.vertices.emplace_back(1, 0, 0);
+  mesh.vertices.emplace_back(0, 1, 0);
+  mesh.vertices.emplace_back(1, 1, 0.5);
+  for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+    mesh.vertices[i].r = 10 * i;
+    mesh.vertices[i].g = 20 * i;
+    mesh.vertices[i].b = 30 * i;
+  }
+  mesh.faces.emplace_back(0, 1, 2);
+  mesh.faces.emplace_back(1, 3, 2);
+  return mesh;
+}
+
+void ExpectEqualMeshes(const PlyMesh& mesh1,
+                       const PlyMesh& mesh2,
+                       const bool compare_rgb) {
+  ASSERT_EQ(mesh1.vertices.size(), mesh2.vertices.size());
+  for (size_t i = 0; i < mesh1.vertices.size(); ++i) {
+    EXPECT_EQ(mesh1.vertices[i].x, mesh2.vertices[i].x);
+    EXPECT_EQ(mesh1.vertices[i].y, mesh2.vertices[i].y);
+    EXPECT_EQ(mesh1.vertices[i].z, mesh2.vertices[i].z);
+    if (compare_rgb) {
+      EXPECT_EQ(mesh1.vertices[i].r, mesh2.vertices[i].r);
+      EXPECT_EQ(mesh1.vertices[i].g, mesh2.vertices[i].g);
+      EXPECT_EQ(mesh1.vertices[i].b, mesh2.vertices[i].b);
+    }
+  }
+  ASSERT_EQ(mesh1.faces.size(), mesh2.faces.size());
+  for (size_t i = 0; i < mesh1.faces.size(); ++i) {
+    EXPECT_EQ(mesh1.faces[i].vertex_idx1, mesh2.faces[i].vertex_idx1);
+    EXPECT_EQ(mesh1.faces[i].vertex_idx2, mesh2.faces[i].vertex_idx2);
+    EXPECT_EQ(mesh1.faces[i].vertex_idx3, mesh2.faces[i].vertex_idx3);
+  }
+}
+
+TEST(PlyMesh, ReadWriteBinary) {
+  const std::string path = JoinPaths(CreateTestDir(), "mesh.ply");
+  const PlyMesh mesh = CreateTestMesh();
+
+  bool has_rgb = true;
+  WriteBinaryPlyMesh(path, mesh);
+  ExpectEqualMeshes(ReadPlyMesh(path, &has_rgb), mesh, false);
+  EXPECT_FALSE(has_rgb);
+
+  WriteBinaryPlyMesh(path, mesh, /*write_rgb=*/true);
+  ExpectEqualMeshes(ReadPlyMesh(path, &has_rgb), mesh, true);
+  EXPECT_TRUE(has_rgb);
+}
+
+TEST(PlyMesh, ReadWriteText) {
+  const std::string path = JoinPaths(CreateTestDir(), "mesh.ply");
+  const PlyMesh mesh = CreateTestMesh();
+
+  bool has_rgb = false;
+  WriteTextPlyMesh(path, mesh, /*write_rgb=*/true);
+  ExpectEqualMeshes(ReadPlyMesh(path, &has_rgb), mesh, true);
+  EXPECT_TRUE(has_rgb);
+}
+
+TEST(PlyMesh, ReadPolygonsAndExtraProperties) {
+  const std::string path = JoinPaths(CreateTestDir(), "mesh.ply");
+  std::ofstream file(path);
+  file << "ply\n";
+  file << "format ascii 1.0\n";
+  file << "comment test\n";
+  file << "element vertex 4\n";
+  file << "property double x\n";
+  file << "property double y\n";
+  file << "property double z\n";
+  file << "property float value\n";
+  file << "element face 1\n";
+  file << "property list uchar uint vertex_indices\n";
+  file << "property uchar flags\n";
+  file << "end_header\n";
+  file << "0 0 0 0.5\n1 0 0 0.5\n1 1 0 0.5\n0 1 0 0.5\n";
+  file << "4 0 1 2 3 7\n";
+  file.close();
+
+  const PlyMesh mesh = ReadPlyMesh(path);
+  ASSERT_EQ(mesh.vertices.size(), 4);
+  EXPECT_EQ(mesh.vertices[2].x, 1);
+  EXPECT_EQ(mesh.vertices[2].y, 1);
+  ASSERT_EQ(mesh.faces.size(), 2);
+  EXPECT_EQ(mesh.faces[0].vertex_idx1, 0);
+  EXPECT_EQ(mesh.faces[0].vertex_idx2, 1);
+  EXPECT_EQ(mesh.faces[0].vertex_idx3, 2);
+  EXPECT_EQ(mesh.faces[1].vertex_idx1, 0);
+  EXPECT_EQ(mesh.faces[1].vertex_idx2, 2);
+  EXPECT_EQ(mesh.faces[1].vertex_idx3, 3);
+}
+
+}  // namespace
+}  // namespace colmap
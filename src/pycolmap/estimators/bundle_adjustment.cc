@@ -1,4 +1,6 @@
 #include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/estimators/bundle_adjustment_calibration.h"
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
 
 #include "pycolmap/helpers.h"
 #include "pycolmap/pybind11_extension.h"
@@ -36,6 +38,7 @@ void BindBundleAdjuster(py::module& m) {
            &BACfg::NumConstantRigFromWorldPoses)
       .def("num_variable_points", &BACfg::NumVariablePoints)
       .def("num_constant_points", &BACfg::NumConstantPoints)
+      .def("num_ignored_points", &BACfg::NumIgnoredPoints)
       .def("num_residuals", &BACfg::NumResiduals, "reconstruction"_a)
       .def("add_image", &BACfg::AddImage, "image_id"_a)
       .def("has_image", &BACfg::HasImage, "image_id"_a)
@@ -74,11 +77,15 @@ void BindBundleAdjuster(py::module& m) {
       .def("has_constant_point", &BACfg::HasConstantPoint, "point3D_id"_a)
       .def("remove_variable_point", &BACfg::RemoveVariablePoint, "point3D_id"_a)
       .def("remove_constant_point", &BACfg::RemoveConstantPoint, "point3D_id"_a)
+      .def("ignore_point", &BACfg::IgnorePoint, "point3D_id"_a)
+      .def("has_ignored_point", &BACfg::HasIgnoredPoint, "point3D_id"_a)
+      .def("remove_ignored_point", &BACfg::RemoveIgnoredPoint, "point3D_id"_a)
       .def_property_readonly("constant_cam_intrinsics",
                              &BACfg::ConstantCamIntrinsics)
       .def_property_readonly("images", &BACfg::Images)
       .def_property_readonly("variable_points", &BACfg::VariablePoints)
       .def_property_readonly("constant_points", &BACfg::ConstantPoints)
+      .def_property_readonly("ignored_points", &BACfg::IgnoredPoints)
       .def_property_readonly("constant_sensor_from_rig_poses",
                              &BACfg::ConstantSensorFromRigPoses)
       .def_property_readonly("constant_rig_from_world_poses",
@@ -162,6 +169,27 @@ void BindBundleAdjuster(py::module& m) {
                          &BAOpts::max_num_images_direct_sparse_gpu_solver,
                          "Threshold to switch between direct, sparse, and "
                          "iterative solvers.")
+          .def_readwrite("reuse_problem",
+                         &BAOpts::reuse_problem,
+                         "Whether to keep the problem alive across updates of "
+                         "the bundle adjuster, e.g., between refinement "
+                         "rounds.")
+          .def_readwrite("use_batched_solver",
+                         &BAOpts::use_batched_solver,
+                         "Whether to use the batched bundle adjuster, which "
+                         "evaluates residuals in batches per camera model and "
+                         "solves the Schur complement with a dedicated "
+                         "Levenberg-Marquardt solver.")
+          .def_readwrite("use_mixed_precision",
+                         &BAOpts::use_mixed_precision,
+                         "Whether the batched bundle adjuster stores the "
+                         "Jacobians in single precision, while the normal "
+                         "equations are accumulated in double precision.")
+          .def_readwrite("solver_profile_path",
+                         &BAOpts::solver_profile_path,
+                         "Optional path to a solver profile calibrated on "
+                         "this host, which overrides the CPU solver and "
+                         "multi-threading thresholds.")
           .def_readwrite("solver_options",
                          &BAOpts::solver_options,
                          "Options for the Ceres solver. Using this member "
@@ -184,6 +212,98 @@ void BindBundleAdjuster(py::module& m) {
                          "RANSAC options for Sim3 alignment.");
   MakeDataclass(PyPosePriorBundleAdjustmentOptions);
 
+  using PartitionedBAOpts = PartitionedBundleAdjustmentOptions;
+  auto PyPartitionedBundleAdjustmentOptions =
+      py::class_<PartitionedBAOpts>(m, "PartitionedBundleAdjustmentOptions")
+          .def(py::init<>())
+          .def_readwrite("leaf_max_num_images",
+                         &PartitionedBAOpts::leaf_max_num_images,
+                         "The maximum number of images per partition.")
+          .def_readwrite("image_overlap",
+                         &PartitionedBAOpts::image_overlap,
+                         "The number of overlapping images between "
+                         "partitions.")
+          .def_readwrite("num_workers",
+                         &PartitionedBAOpts::num_workers,
+                         "The number of partitions solved in parallel.")
+          .def_readwrite("max_num_iterations",
+                         &PartitionedBAOpts::max_num_iterations,
+                         "The maximum number of consensus iterations.")
+          .def_readwrite("initial_penalty",
+                         &PartitionedBAOpts::initial_penalty,
+                         "The initial weight of the consensus penalty.")
+          .def_readwrite("adapt_penalty",
+                         &PartitionedBAOpts::adapt_penalty,
+                         "Whether to adapt the penalty by balancing the "
+                         "primal and dual residuals.")
+          .def_readwrite("tolerance",
+                         &PartitionedBAOpts::tolerance,
+                         "Convergence tolerance on the primal and dual "
+                         "residuals.");
+  MakeDataclass(PyPartitionedBundleAdjustmentOptions);
+
+  using BAProfile = BundleAdjustmentSolverProfile;
+  auto PyBundleAdjustmentSolverProfile =
+      py::class_<BAProfile>(m, "BundleAdjustmentSolverProfile")
+          .def(py::init<>())
+          .def_readwrite("max_num_images_direct_dense_cpu_solver",
+                         &BAProfile::max_num_images_direct_dense_cpu_solver)
+          .def_readwrite("max_num_images_direct_sparse_cpu_solver",
+                         &BAProfile::max_num_images_direct_sparse_cpu_solver)
+          .def_readwrite("min_num_residuals_for_cpu_multi_threading",
+                         &BAProfile::min_num_residuals_for_cpu_multi_threading);
+  MakeDataclass(PyBundleAdjustmentSolverProfile);
+
+  using BACalibOpts = BundleAdjustmentSolverCalibrationOptions;
+  auto PyBundleAdjustmentSolverCalibrationOptions =
+      py::class_<BACalibOpts>(m, "BundleAdjustmentSolverCalibrationOptions")
+          .def(py::init<>())
+          .def_readwrite("num_images",
+                         &BACalibOpts::num_images,
+                         "The numbers of images of the synthetic problems, in "
+                         "increasing order.")
+          .def_readwrite("num_observations_per_image",
+                         &BACalibOpts::num_observations_per_image,
+                         "The number of observations per image.")
+          .def_readwrite("track_length",
+                         &BACalibOpts::track_length,
+                         "The number of consecutive images observing each "
+                         "3D point.")
+          .def_readwrite("point2D_stddev",
+                         &BACalibOpts::point2D_stddev,
+                         "The standard deviation of the noise on the "
+                         "observations in pixels.")
+          .def_readwrite("num_iterations",
+                         &BACalibOpts::num_iterations,
+                         "The fixed number of iterations timed per solve.")
+          .def_readwrite("num_threads",
+                         &BACalibOpts::num_threads,
+                         "The number of threads of the multi-threaded "
+                         "solves.")
+          .def_readwrite("max_slowdown",
+                         &BACalibOpts::max_slowdown,
+                         "A solver is no longer timed for larger problems "
+                         "once it is slower than the fastest solver by this "
+                         "factor.");
+  MakeDataclass(PyBundleAdjustmentSolverCalibrationOptions);
+
+  m.def("read_bundle_adjustment_solver_profile",
+        &ReadBundleAdjustmentSolverProfile,
+        "path"_a);
+  m.def("write_bundle_adjustment_solver_profile",
+        &WriteBundleAdjustmentSolverProfile,
+        "path"_a,
+        "profile"_a);
+  m.def(
+      "calibrate_bundle_adjustment_solver_profile",
+      [](const BACalibOpts& options) {
+        py::gil_scoped_release release;
+        return CalibrateBundleAdjustmentSolverProfile(options);
+      },
+      "options"_a,
+      "Time the bundle adjustment solvers on synthetic problems and derive "
+      "the solver selection thresholds for this host.");
+
   class PyBundleAdjuster : public BundleAdjuster {
    public:
     PyBundleAdjuster(BundleAdjustmentOptions options,
@@ -205,6 +325,11 @@ void BindBundleAdjuster(py::module& m) {
            "options"_a,
            "config"_a)
       .def("solve", &BundleAdjuster::Solve)
+      .def("update",
+           &BundleAdjuster::Update,
+           "options"_a,
+           "config"_a,
+           "reconstruction"_a)
       .def_property_readonly("problem", &BundleAdjuster::Problem)
       .def_property_readonly("options", &BundleAdjuster::Options)
       .def_property_readonly("config", &BundleAdjuster::Config);
@@ -222,4 +347,11 @@ void BindBundleAdjuster(py::module& m) {
         "config"_a,
         "pose_priors"_a,
         "reconstruction"_a);
+
+  m.def("create_partitioned_bundle_adjuster",
+        CreatePartitionedBundleAdjuster,
+        "options"_a,
+        "partitioned_options"_a,
+        "config"_a,
+        "reconstruction"_a);
 }
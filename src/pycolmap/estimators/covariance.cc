@@ -4,6 +4,7 @@
 #include "pycolmap/pybind11_extension.h"
 
 #include <pybind11/eigen.h>
+#include <pybind11/functional.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
@@ -84,6 +85,21 @@ void BindCovarianceEstimator(py::module& m) {
           &BACovarianceOptions::damping,
           "Damping factor for the Hessian in the Schur complement solver. "
           "Enables to robustly deal with poorly conditioned parameters.")
+      .def_readwrite(
+          "use_selected_inversion",
+          &BACovarianceOptions::use_selected_inversion,
+          "Whether to compute the covariances of poses and other parameters "
+          "by selected inversion of the sparse Cholesky factor of the Schur "
+          "complement instead of inverting the factor densely. Scales to much "
+          "larger problems in memory and time.")
+      .def_readwrite("num_threads",
+                     &BACovarianceOptions::num_threads,
+                     "The number of threads for the selected inversion.")
+      .def_readwrite(
+          "pose_cov_callback",
+          &BACovarianceOptions::pose_cov_callback,
+          "Optional callback to stream pose covariances as soon as they are "
+          "computed by the selected inversion.")
       .def_readwrite(
           "experimental_custom_poses",
           &BACovarianceOptions::experimental_custom_poses,
@@ -164,5 +180,6 @@ void BindCovarianceEstimator(py::module& m) {
       "solving using the Schur complement trick. This is the case for the "
       "standard configuration of bundle adjustment problems, but be careful "
       "if you modify the underlying problem with custom residuals. Returns "
-      "null if the estimation was not successful.");
+      "null if the estimation was not successful. Raises if the bundle "
+      "adjuster has no problem, as for the batched solver.");
 }
@@ -57,6 +57,17 @@ void BindMeshing(py::module& m) {
               "num_threads",
               &PoissonMOpts::num_threads,
               "The number of threads used for the Poisson reconstruction.")
+          .def_readwrite("target_resolution",
+                         &PoissonMOpts::target_resolution,
+                         "If positive, the input points are reduced to this "
+                         "resolution in scene units before reconstruction, "
+                         "using the octree at <input_path>.octree if it "
+                         "exists or voxel averaging otherwise.")
+          .def_readwrite("simplify_face_ratio",
+                         &PoissonMOpts::simplify_face_ratio,
+                         "If smaller than 1, the trimmed mesh is simplified "
+                         "by quadric edge collapses to this ratio of its "
+                         "number of faces.")
           .def("check", &PoissonMOpts::Check);
   MakeDataclass(PyPoissonMeshingOptions);
 
@@ -115,6 +126,24 @@ void BindMeshing(py::module& m) {
                          &DMOpts::num_threads,
                          "The number of threads to use for reconstruction. "
                          "Default is all threads.")
+          .def_readwrite("target_resolution",
+                         &DMOpts::target_resolution,
+                         "If positive, the input points are reduced to this "
+                         "resolution in scene units before triangulation, "
+                         "using the octree at fused.ply.octree for dense "
+                         "meshing if it exists or voxel averaging otherwise.")
+          .def_readwrite("parallel_integration",
+                         &DMOpts::parallel_integration,
+                         "Whether to accumulate the visibility weights of all "
+                         "viewing rays in per-thread buffers, which are "
+                         "reduced in parallel after ray casting. Requires "
+                         "additional memory proportional to the number of "
+                         "threads times the number of Delaunay cells.")
+          .def_readwrite("simplify_face_ratio",
+                         &DMOpts::simplify_face_ratio,
+                         "If smaller than 1, the extracted surface mesh is "
+                         "simplified by quadric edge collapses to this ratio "
+                         "of its number of faces.")
           .def("check", &DMOpts::Check);
   MakeDataclass(PyDelaunayMeshingOptions);
 
@@ -1,13 +1,10 @@
 #include "colmap/mvs/fusion.h"
+#include "colmap/mvs/patch_match.h"
 #include "colmap/mvs/patch_match_options.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/util/file.h"
 #include "colmap/util/misc.h"
 
-#ifdef COLMAP_CUDA_ENABLED
-#include "colmap/mvs/patch_match.h"
-#endif  // COLMAP_CUDA_ENABLED
-
 #include "colmap/util/logging.h"
 
 #include "pycolmap/helpers.h"
@@ -25,7 +22,6 @@ void PatchMatchStereo(const std::string& workspace_path,
                       const std::string& pmvs_option_name,
                       const mvs::PatchMatchOptions& options,
                       const std::string& config_path) {
-#ifdef COLMAP_CUDA_ENABLED
   THROW_CHECK_DIR_EXISTS(workspace_path);
   StringToLower(&workspace_format);
   THROW_CHECK(workspace_format == "colmap" || workspace_format == "pmvs")
@@ -36,10 +32,6 @@ void PatchMatchStereo(const std::string& workspace_path,
   mvs::PatchMatchController controller(
       options, workspace_path, workspace_format, pmvs_option_name, config_path);
   controller.Run();
-#else
-  LOG_FATAL_THROW(std::runtime_error)
-      << "PatchMatch requires CUDA but COLMAP was not compiled with it.";
-#endif  // COLMAP_CUDA_ENABLED
 }
 
 Reconstruction StereoFusion(const std::string& output_path,
@@ -59,9 +51,17 @@ Reconstruction StereoFusion(const std::string& output_path,
       << "Invalid input type - supported values are 'photometric' and "
          "'geometric'.";
 
+  const bool tiled = options.tile_memory_budget > 0;
+  THROW_CHECK(!tiled || !ExistsDir(output_path))
+      << "Tiled fusion requires a PLY file as output path.";
+
   py::gil_scoped_release release;
   mvs::StereoFusion fuser(
       options, workspace_path, workspace_format, pmvs_option_name, input_type);
+  if (tiled) {
+    // The fused points are streamed to the output path and not kept in memory.
+    fuser.SetOutputPath(output_path);
+  }
   fuser.Run();
 
   Reconstruction reconstruction;
@@ -70,6 +70,12 @@ Reconstruction StereoFusion(const std::string& output_path,
     reconstruction.Read(JoinPaths(workspace_path, "sparse"));
   }
 
+  // In tiled mode, the fused points are only written to the output path and
+  // the returned reconstruction contains the sparse points.
+  if (tiled) {
+    return reconstruction;
+  }
+
   // overwrite sparse point cloud with dense point cloud from fuser
   reconstruction.ImportPLY(fuser.GetFusedPoints());
 
@@ -98,6 +104,14 @@ void BindMVS(py::module& m) {
               "Index of the GPU used for patch match. For multi-GPU usage, "
               "you should separate multiple GPU indices by comma, e.g., "
               "\"0,1,2,3\".")
+          .def_readwrite("use_gpu",
+                         &PMOpts::use_gpu,
+                         "Whether to use the CUDA implementation. If false or "
+                         "if COLMAP was compiled without CUDA, the "
+                         "multi-threaded CPU implementation is used instead.")
+          .def_readwrite("num_threads",
+                         &PMOpts::num_threads,
+                         "Number of threads used by the CPU implementation.")
           .def_readwrite("depth_min", &PMOpts::depth_min)
           .def_readwrite("depth_max", &PMOpts::depth_max)
           .def_readwrite(
@@ -171,6 +185,17 @@ void BindMVS(py::module& m) {
           .def_readwrite("write_consistency_graph",
                          &PMOpts::write_consistency_graph,
                          "Whether to write the consistency graph.")
+          .def_readwrite("output_format",
+                         &PMOpts::output_format,
+                         "Format of the output depth and normal maps, either "
+                         "'LEGACY' or the memory-mappable 'BIN'.")
+          .def_readwrite("output_half_precision",
+                         &PMOpts::output_half_precision,
+                         "Whether to store the values of binary maps as half "
+                         "precision floats.")
+          .def_readwrite("output_compress",
+                         &PMOpts::output_compress,
+                         "Whether to compress binary maps.")
           .def("check", &PMOpts::Check);
   MakeDataclass(PyPatchMatchOptions);
 
@@ -233,6 +258,17 @@ void BindMVS(py::module& m) {
           .def_readwrite("bounding_box",
                          &SFOpts::bounding_box,
                          "Bounding box Tuple[min, max]")
+          .def_readwrite(
+              "tile_memory_budget",
+              &SFOpts::tile_memory_budget,
+              "Memory budget in gigabytes for out-of-core tiled fusion. If "
+              "positive, the bounding box is split into cells that are fused "
+              "one after another and streamed to the output PLY file. The "
+              "returned reconstruction then contains the sparse points.")
+          .def_readwrite("tile_overlap",
+                         &SFOpts::tile_overlap,
+                         "Overlap of neighboring cells relative to the extent "
+                         "of their sparse points.")
           .def("check", &SFOpts::Check);
   MakeDataclass(PyStereoFusionOptions);
 
@@ -245,5 +281,7 @@ void BindMVS(py::module& m) {
       "pmvs_option_name"_a = "option-all",
       "input_type"_a = "geometric",
       py::arg_v("options", mvs::StereoFusionOptions(), "StereoFusionOptions()"),
-      "Stereo Fusion");
+      "Stereo Fusion. In tiled mode (tile_memory_budget > 0), the fused "
+      "points are only written to output_path and the returned "
+      "reconstruction contains the sparse points.");
 }
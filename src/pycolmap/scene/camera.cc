@@ -1,6 +1,7 @@
 #include "colmap/scene/camera.h"
 
 #include "colmap/scene/point2d.h"
+#include "colmap/sensor/inverse_distortion_grid.h"
 #include "colmap/sensor/models.h"
 #include "colmap/util/logging.h"
 #include "colmap/util/misc.h"
@@ -34,6 +35,23 @@ void BindCamera(py::module& m) {
   AddStringToEnumConstructor(PyCameraModelId);
   py::implicitly_convertible<int, CameraModelId>();
 
+  py::class_<InverseDistortionGridOptions> PyInverseDistortionGridOptions(
+      m, "InverseDistortionGridOptions");
+  PyInverseDistortionGridOptions.def(py::init<>())
+      .def_readwrite("node_spacing",
+                     &InverseDistortionGridOptions::node_spacing,
+                     "Spacing of the grid nodes in pixels.")
+      .def_readwrite("max_error",
+                     &InverseDistortionGridOptions::max_error,
+                     "Maximum reprojection error in pixels of the "
+                     "interpolated points. Points exceeding this error fall "
+                     "back to the iterative solve, so the error is bounded "
+                     "for all points.")
+      .def_readwrite("num_verification_intervals",
+                     &InverseDistortionGridOptions::num_verification_intervals,
+                     "Number of verification intervals along each cell edge.");
+  MakeDataclass(PyInverseDistortionGridOptions);
+
   py::class_<Camera, std::shared_ptr<Camera>> PyCamera(m, "Camera");
   PyCamera.def(py::init<>())
       .def_static("create",
@@ -109,6 +127,16 @@ void BindCamera(py::module& m) {
            "max_focal_length_ratio"_a,
            "max_extra_param"_a,
            "Check whether camera has bogus parameters.")
+      .def("build_inverse_distortion_grid",
+           py::overload_cast<const InverseDistortionGridOptions&>(
+               &Camera::BuildInverseDistortionGrid),
+           "options"_a = InverseDistortionGridOptions(),
+           "Cache the inverse distortion on a grid to accelerate "
+           "cam_from_img for models with an iterative inverse.")
+      .def("has_inverse_distortion_grid",
+           &Camera::HasInverseDistortionGrid,
+           "Whether the inverse distortion grid matches the current "
+           "parameters.")
       .def("cam_from_img",
            &Camera::CamFromImg,
            "image_point"_a,
@@ -117,17 +145,16 @@ void BindCamera(py::module& m) {
           "cam_from_img",
           [](const Camera& self,
              const py::EigenDRef<const Eigen::MatrixX2d>& image_points) {
-            std::vector<Eigen::Vector2d> cam_points(image_points.rows());
-            for (size_t i = 0; i < image_points.rows(); ++i) {
-              const std::optional<Eigen::Vector2d> cam_point =
-                  self.CamFromImg(image_points.row(i));
-              if (cam_point) {
-                cam_points[i] = *cam_point;
-              } else {
-                cam_points[i].setConstant(
-                    std::numeric_limits<double>::quiet_NaN());
-              }
+            const size_t num_points = image_points.rows();
+            std::vector<Eigen::Vector2d> image_points_vec(num_points);
+            for (size_t i = 0; i < num_points; ++i) {
+              image_points_vec[i] = image_points.row(i);
             }
+            std::vector<Eigen::Vector2d> cam_points(num_points);
+            self.CamFromImgBatch(
+                span<const Eigen::Vector2d>(image_points_vec.data(),
+                                            num_points),
+                span<Eigen::Vector2d>(cam_points.data(), num_points));
             return cam_points;
           },
           "image_points"_a,
@@ -175,17 +202,14 @@ void BindCamera(py::module& m) {
           [](const Camera& self,
              const py::EigenDRef<const Eigen::MatrixX3d>& cam_points) {
             const size_t num_points = cam_points.rows();
-            std::vector<Eigen::Vector2d> image_points(num_points);
+            std::vector<Eigen::Vector3d> cam_points_vec(num_points);
             for (size_t i = 0; i < num_points; ++i) {
-              const std::optional<Eigen::Vector2d> image_point =
-                  self.ImgFromCam(cam_points.row(i));
-              if (image_point) {
-                image_points[i] = *image_point;
-              } else {
-                image_points[i].setConstant(
-                    std::numeric_limits<double>::quiet_NaN());
-              }
+              cam_points_vec[i] = cam_points.row(i);
             }
+            std::vector<Eigen::Vector2d> image_points(num_points);
+            self.ImgFromCamBatch(
+                span<const Eigen::Vector3d>(cam_points_vec.data(), num_points),
+                span<Eigen::Vector2d>(image_points.data(), num_points));
             return image_points;
           },
           "cam_points"_a,
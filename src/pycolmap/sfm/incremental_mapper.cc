@@ -150,6 +150,25 @@ void BindIncrementalPipeline(py::module& m) {
           "ba_global_max_refinement_change",
           &Opts::ba_global_max_refinement_change,
           "The thresholds for iterative bundle adjustment refinements.")
+      .def_readwrite("ba_reuse_problem",
+                     &Opts::ba_reuse_problem,
+                     "Whether to keep the bundle adjustment problem alive "
+                     "across iterative refinement rounds and only update the "
+                     "changed observations.")
+      .def_readwrite("ba_use_batched_solver",
+                     &Opts::ba_use_batched_solver,
+                     "Whether to use the batched bundle adjuster with a "
+                     "dedicated Schur complement solver instead of one Ceres "
+                     "residual block per observation.")
+      .def_readwrite("ba_use_mixed_precision",
+                     &Opts::ba_use_mixed_precision,
+                     "Whether the batched bundle adjuster stores the Jacobians "
+                     "in single precision with double precision accumulation "
+                     "of the normal equations.")
+      .def_readwrite("ba_solver_profile_path",
+                     &Opts::ba_solver_profile_path,
+                     "Optional path to a solver profile calibrated on this "
+                     "host with the bundle_adjuster_calibrator command.")
       .def_readwrite("ba_use_gpu",
                      &IncrementalPipelineOptions::ba_use_gpu,
                      "Whether to use Ceres' CUDA sparse linear algebra "
@@ -175,6 +194,11 @@ void BindIncrementalPipeline(py::module& m) {
                      &Opts::snapshot_frames_freq,
                      "Frequency of registered images according to which "
                      "reconstruction snapshots will be saved.")
+      .def_readwrite("snapshot_async",
+                     &Opts::snapshot_async,
+                     "Whether to write snapshots on a background thread. "
+                     "Snapshots are skipped while the previous one is still "
+                     "being written.")
       .def_readwrite(
           "image_names",
           &Opts::image_names,
@@ -352,6 +376,25 @@ void BindIncrementalMapperOptions(py::module& m) {
                      "List of cameras for which to fix the camera parameters "
                      "independent of refine_focal_length, "
                      "refine_principal_point, and refine_extra_params.")
+      .def_readwrite("ba_global_subsample_tracks",
+                     &Opts::ba_global_subsample_tracks,
+                     "Whether to subsample the tracks in global bundle "
+                     "adjustment of large reconstructions. The poses and "
+                     "intrinsics are refined on a uniformly distributed subset "
+                     "of the points, and the remaining points are refined "
+                     "afterwards with fixed poses and intrinsics.")
+      .def_readwrite("ba_global_subsample_min_num_points3D",
+                     &Opts::ba_global_subsample_min_num_points3D,
+                     "Minimum number of 3D points in the reconstruction to "
+                     "subsample tracks.")
+      .def_readwrite("ba_global_subsample_grid_size",
+                     &Opts::ba_global_subsample_grid_size,
+                     "Number of grid cells along each image dimension for "
+                     "track subsampling.")
+      .def_readwrite("ba_global_max_points_per_cell",
+                     &Opts::ba_global_max_points_per_cell,
+                     "Maximum number of selected points per grid cell in each "
+                     "image.")
       .def_readwrite("num_threads", &Opts::num_threads, "Number of threads.")
       .def_readwrite(
           "random_seed",
@@ -360,6 +403,22 @@ void BindIncrementalMapperOptions(py::module& m) {
       .def_readwrite("image_selection_method",
                      &Opts::image_selection_method,
                      "Method to find and select next best image to register.")
+      .def_readwrite("prune_redundant_frames",
+                     &Opts::prune_redundant_frames,
+                     "Whether to prune near-duplicate frames before mapping. "
+                     "Redundant frames are skipped during incremental growth "
+                     "and only registered against the fixed 3D points at the "
+                     "end of a reconstruction.")
+      .def_readwrite("redundant_frame_min_overlap",
+                     &Opts::redundant_frame_min_overlap,
+                     "Minimum fraction of a frame's observations with "
+                     "correspondences to an already kept frame for the frame "
+                     "to be considered redundant.")
+      .def_readwrite("redundant_frame_max_disparity",
+                     &Opts::redundant_frame_max_disparity,
+                     "Maximum median displacement of the correspondences to "
+                     "the kept frame, relative to the image diagonal, for the "
+                     "frame to be considered redundant.")
       .def("check", &Opts::Check);
   MakeDataclass(PyOpts);
 }
@@ -443,6 +502,12 @@ void BindIncrementalMapperImpl(py::module& m) {
            "image_id1"_a,
            "image_id2"_a)
       .def("find_next_images", &IncrementalMapper::FindNextImages, "options"_a)
+      .def("prune_redundant_frames",
+           &IncrementalMapper::PruneRedundantFrames,
+           "options"_a)
+      .def("register_redundant_frames",
+           &IncrementalMapper::RegisterRedundantFrames,
+           "options"_a)
       .def("register_next_image",
            &IncrementalMapper::RegisterNextImage,
            "options"_a,
@@ -501,6 +566,8 @@ void BindIncrementalMapperImpl(py::module& m) {
                              &IncrementalMapper::FilteredFrames)
       .def_property_readonly("existing_frame_ids",
                              &IncrementalMapper::ExistingFrameIds)
+      .def_property_readonly("redundant_frames",
+                             &IncrementalMapper::RedundantFrames)
       .def("reset_initialization_stats",
            &IncrementalMapper::ResetInitializationStats)
       .def_property_readonly("num_reg_frames_per_rig",